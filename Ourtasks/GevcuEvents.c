@@ -177,7 +177,7 @@ pdbg07mbx = gevcufunction.pmbx_cid_cntctr_keepalive_r;
 	gevcufunction.evstat |= EVCANCNTCTR; // Show New Contactor CAN msg 
 	
 	/* Send pointer to CAN msg to contactor control. */
-	contactor_control_CANrcv(&gevcufunction.pmbx_cid_cntctr_keepalive_r->ncan.can);
+	contactor_control_CANrcv(&gevcufunction.snap.pcopy[GEVCUSNAP_CNTCTR_KA].ncan.can);
 		
 	return;
 }	
@@ -187,8 +187,9 @@ pdbg07mbx = gevcufunction.pmbx_cid_cntctr_keepalive_r;
  * *************************************************************************/
 void GevcuEvents_08(void)
 {
-	dmoc_control_GEVCUBIT08(&dmocctl[DMOC_SPEED],\
-        &gevcufunction.pmbx_cid_dmoc_actualtorq->ncan.can);
+	/* Copy made this pass (see GevcuTask loop) */
+	struct MAILBOXCAN* pmbx = &gevcufunction.snap.pcopy[GEVCUSNAP_ACTUALTORQ];
+	dmoc_control_GEVCUBIT08(&dmocctl[DMOC_SPEED], &pmbx->ncan.can);
 	return;
 }
 /* *************************************************************************
@@ -197,7 +198,17 @@ void GevcuEvents_08(void)
  * *************************************************************************/
 void GevcuEvents_09(void)
 {
-	dmoc_control_GEVCUBIT09(&dmocctl[DMOC_SPEED],&gevcufunction.pmbx_cid_dmoc_speed->ncan.can);
+	/* Copy made this pass (see GevcuTask loop) */
+	struct MAILBOXCAN* pmbx = &gevcufunction.snap.pcopy[GEVCUSNAP_SPEED];
+	struct MBXHISTVAL hv;  // Speed history window
+	dmoc_control_GEVCUBIT09(&dmocctl[DMOC_SPEED], &pmbx->ncan.can);
+
+	/* Speed rate of change (offset cancels in the difference).  The history
+	   is read live; if a speed msg came in after the copy, its window is
+	   newer than the copy, so leave it for that msg's own pass. */
+	if ((MailboxTask_hist_get(gevcufunction.pmbx_cid_dmoc_speed, &hv, DMOC_SPEEDDIFF) == 0) &&
+		 (hv.dtw == pmbx->ncan.toa))
+		dmocctl[DMOC_SPEED].speedacc = hv.deriv;
 	return;
 }
 /* *************************************************************************
@@ -231,8 +242,9 @@ void GevcuEvents_12(void)
  * *************************************************************************/
 void GevcuEvents_13(void)
 {
-	dmoc_control_GEVCUBIT13(&dmocctl[DMOC_SPEED],\
-        &gevcufunction.pmbx_cid_dmoc_hv_status->ncan.can);
+	/* Copy made this pass (see GevcuTask loop) */
+	struct MAILBOXCAN* pmbx = &gevcufunction.snap.pcopy[GEVCUSNAP_HV_STATUS];
+	dmoc_control_GEVCUBIT13(&dmocctl[DMOC_SPEED], &pmbx->ncan.can);
 	return;
 }
 /* *************************************************************************
@@ -241,8 +253,9 @@ void GevcuEvents_13(void)
  * *************************************************************************/
 void GevcuEvents_14(void)
 {
-	dmoc_control_GEVCUBIT14(&dmocctl[DMOC_SPEED],\
-        &gevcufunction.pmbx_cid_dmoc_hv_temps->ncan.can);
+	/* Copy made this pass (see GevcuTask loop) */
+	struct MAILBOXCAN* pmbx = &gevcufunction.snap.pcopy[GEVCUSNAP_HV_TEMPS];
+	dmoc_control_GEVCUBIT14(&dmocctl[DMOC_SPEED], &pmbx->ncan.can);
 	return;
 }
 /* *************************************************************************
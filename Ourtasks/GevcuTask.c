@@ -191,6 +191,16 @@ extern TIM_HandleTypeDef htim2;
 		/* Wait for notifications */
 		xTaskNotifyWait(0,0xffffffff, &noteval, portMAX_DELAY);
 		noteuse = 0;	// Accumulate bits in 'noteval' processed.
+
+		/* One coherent copy of the CAN mailboxes for all events in this pass. */
+		if ((noteval & GEVCUSNAPBITS) != 0)
+		{
+			if (MailboxTask_snap(&gevcufunction.snap) != 0)
+			{ // No coherent copy: skip the CAN msg events (their next msgs notify again)
+				gevcufunction.snapskipct += 1;
+				noteval &= ~GEVCUSNAPREADBITS;
+			}
+		}
   /* ========= Events =============================== */
 // NOTE: this could be made into a loop that shifts 'noteval' bits
 // and calls from table of addresses.  This would have an advantage
@@ -15,6 +15,7 @@
 #include "stm32f4xx_hal.h"
 #include "adc_idx_v_struct.h"
 #include "CanTask.h"
+#include "MailboxTask.h"
 
 
 /* 
@@ -79,6 +80,19 @@ NOTES:
 #define GEVCUBIT14 ( 1 << 14) // cid_dmoc_hv_temps
 #define GEVCUBIT15 ( 1 << 15) // cid_gevcur_keepalive_i
 
+/* Mailboxes copied together once per pass of the task loop ('snap') */
+#define GEVCUSNAP_CNTCTR_KA  0 // cid_cntctr_keepalive_r
+#define GEVCUSNAP_ACTUALTORQ 1 // cid_dmoc_actualtorq
+#define GEVCUSNAP_SPEED      2 // cid_dmoc_speed
+#define GEVCUSNAP_HV_STATUS  3 // cid_dmoc_hv_status
+#define GEVCUSNAP_HV_TEMPS   4 // cid_dmoc_hv_temps
+#define GEVCUSNAPNUM         5 // Number of mailboxes in set
+
+/* Notifications whose events use the snapshot */
+#define GEVCUSNAPBITS (GEVCUBIT04 | GEVCUBIT07 | GEVCUBIT08 | GEVCUBIT09 | GEVCUBIT13 | GEVCUBIT14)
+/* Of those, the ones that read the copies (skipped in a pass without a coherent copy) */
+#define GEVCUSNAPREADBITS (GEVCUBIT07 | GEVCUBIT08 | GEVCUBIT09 | GEVCUBIT13 | GEVCUBIT14)
+
 /* Event status bit assignments (CoNtaCTor EVent ....) */
 #define EVSWTIM1TICK (1 << 0) // 1 = timer1 timed out: counter incremented
 #define EVCNTCTR     (1 << 1) // 1 = contactor keepalive timer timeout
@@ -214,6 +228,10 @@ struct GEVCUFUNCTION
 	uint32_t timesyncrcvctr; // Time sync CAN msgs received
 	uint32_t timesynclimit;
 
+	uint32_t ctllaw_txdeferct; // CID_GEVCUR_CTL_LAWV1 xCanTxDirect: rate limited, CanTxTask sends it later
+	uint32_t ctllaw_txlostct;  // CID_GEVCUR_CTL_LAWV1 xCanTxDirect: not sent
+	uint32_t snapskipct;       // Passes whose CAN msg events were skipped: 'MailboxTask_snap' gave up
+
 
 	/* Pointers to incoming CAN msg mailboxes. */
 	struct MAILBOXCAN* pmbx_cid_cntctr_keepalive_r; // CANID_CMD_CNTCTRKAR: U8_VAR: Contactor1: R KeepAlive response to pollcid_gevcur_keepalive_i;
@@ -227,6 +245,9 @@ struct GEVCUFUNCTION
 	struct MAILBOXCAN* pmbx_cid_dmoc_hv_temps;   // CANID_DMOC_HV_TEMPS:  U8_U8_U8,  'DMOC: Temperature:rotor,invert,stator
 	struct MAILBOXCAN* pmbx_cid_gps_sync; // CANID_HB_TIMESYNC:  U8 : GPS_1: U8 GPS time sync distribution msg-GPS time sync msg
 
+	/* Copies of the mailboxes the control law uses, all from the same MailboxTask batch. */
+	struct MBXSNAP snap; // 'snap.pcopy[GEVCUSNAP_SPEED]', etc.
+
 	/* LCD buffer(s) */
 	struct SERIALSENDTASKBCB* pbuflcd1;
 	struct SERIALSENDTASKBCB* pbuflcd2;
@@ -48,6 +48,8 @@ static void payloadfloat(uint8_t *po, float f)
  * *************************************************************************/
 void GevcuUpdates(void)
 {
+	int ret;
+
 	/* Contactor keepalive/command msg sending. */
 	contactor_control_CANsend();
 	
@@ -69,8 +71,12 @@ void GevcuUpdates(void)
 		payloadfloat(&gevcufunction.canmsg[CID_GEVCUR_CTL_LAWV1].can.cd.uc[0],clv1.dsrdspd);
 		// Load control law integrator value
 		payloadfloat(&gevcufunction.canmsg[CID_GEVCUR_CTL_LAWV1].can.cd.uc[4],clv1.intgrtr);
-		// Queue CAN msg for sending
-		xQueueSendToBack(CanTxQHandle,&gevcufunction.canmsg[CID_GEVCUR_CTL_LAWV1],4);
+		// Send CAN msg (direct to CAN driver, not queued).  Not retried: next one is newer.
+		ret = xCanTxDirect(&gevcufunction.canmsg[CID_GEVCUR_CTL_LAWV1]);
+		if (ret == 1)
+			gevcufunction.ctllaw_txdeferct += 1; // Rate limited, on CanTxTask queue
+		else if (ret < 0)
+			gevcufunction.ctllaw_txlostct  += 1;
 	}
 
 	/* Send required suite of three dmoc command msgs, and reset send flag. */
@@ -5,8 +5,9 @@
 * Description        : Compute torque request for dmoc--PI Loop
 *******************************************************************************/
 /*
-Speed PI Loop
-
+Speed PI Loop, plus damping on the measured speed rate of change
+('speedacc', from the speed mailbox history).  Damping the measurement
+rather than the error keeps a control lever step from kicking the command.
 */
 #include <stdio.h>
 
@@ -33,6 +34,7 @@ void control_law_v1_init(void)
 	/* See: struct CTLLAWPILOOP in dmoc_control.h. */
 	clv1.kp = 1.0f;  		// Proportional constant
 	clv1.ki = 0.01f; 		// Integral constant
+	clv1.kd = 0.01f;		// Rate constant (1000 rpm/sec -> 10)
 	clv1.fllspd = 1500.0f;	//	100% control lever desired speed magnitude
 	clv1.clpi = 10.0f;		//	Integrator clipping level
 	clv1.clpcp = 300.0f;		//	Command clipping level positive
@@ -95,8 +97,8 @@ void control_law_v1_calc(struct DMOCCTL* pdmocctl)
 		clv1.intgrtr = -clv1.clpi;
 	}
 
-	//	Compute and limit torque command
-	pdmocctl->ftorquereq = clv1.spderr * clv1.kp + clv1.intgrtr;
+	//	Compute and limit torque command; rate term opposes speed change
+	pdmocctl->ftorquereq = clv1.spderr * clv1.kp + clv1.intgrtr - pdmocctl->speedacc * clv1.kd;
 	if (pdmocctl->ftorquereq > clv1.clpcp) 
 	{
 		pdmocctl->ftorquereq = clv1.clpcp;
@@ -19,6 +19,7 @@ struct CTLLAWPILOOP // Control Law PI Loop
 	//	Parameters
 	float kp;    	// Proportional constant
 	float ki;    	// Integral constant
+	float kd;    	// Rate constant (times speed rate of change, rpm/sec)
 	float clpi;		//	integrator anti-windup clip level
 	float clpcp;	//	command clip level positive
 	float clpcn;	//	command clip level negative
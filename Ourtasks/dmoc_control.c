@@ -391,6 +391,27 @@ void dmoc_control_GEVCUBIT14(struct DMOCCTL* pdmocctl, struct CANRCVBUF* pcan)
 	return;
 }
 
+/* ***********************************************************************************************************
+ * static void dmoc_txdirect(struct DMOCCTL* pdmocctl, struct CANTXQMSG* ptxq);
+ * @brief	: Send a command msg direct to the CAN driver; count the ones that did not go into the pool
+ * @param	: pdmocctl = pointer to struct with "everything" for this DMOC unit
+ * @param	: ptxq = pointer to command msg
+ ************************************************************************************************************* */
+/*
+A command that is not sent is not retried: the next one (DMOC_control_time
+rate) carries newer values.  The DMOC ids are exempt from the rate limit
+(gevcu_func_init.c), so 'txdeferct' should stay zero.
+*/
+static void dmoc_txdirect(struct DMOCCTL* pdmocctl, struct CANTXQMSG* ptxq)
+{
+	int ret = xCanTxDirect(ptxq);
+	if (ret == 0) return;
+	if (ret == 1)
+		pdmocctl->txdeferct += 1; // Rate limited, placed on CanTxTask queue
+	else
+		pdmocctl->txlostct  += 1; // -1 pool full, -6 defer queue full, -7 bus-off flush, -2,-3,-4
+	return;
+}
 /* ***********************************************************************************************************
  * void dmoc_control_CANsend(struct DMOCCTL* pdmocctl);
  * @brief	: Send group of three CAN msgs to DMOC
@@ -551,8 +572,8 @@ void dmoc_control_CANsend(struct DMOCCTL* pdmocctl)
 	/* Add the weird dmoc checksum. */
 	pdmocctl->cmd[CMD1].txqcan.can.cd.uc[7] = DMOCchecksum(&pdmocctl->cmd[CMD1].txqcan.can); 
 
-	// Queue CAN msg
-	xQueueSendToBack(CanTxQHandle,&pdmocctl->cmd[CMD1].txqcan,4);
+	// Send CAN msg (direct to CAN driver, not queued)
+	dmoc_txdirect(pdmocctl, &pdmocctl->cmd[CMD1].txqcan);
 
 	/* CMD2: Torque limits ****************************************** */
 
@@ -605,8 +626,8 @@ void dmoc_control_CANsend(struct DMOCCTL* pdmocctl)
 	pdmocctl->cmd[CMD2].txqcan.can.cd.uc[6] = pdmocctl->alive;
 	pdmocctl->cmd[CMD2].txqcan.can.cd.uc[7] = DMOCchecksum(&pdmocctl->cmd[CMD2].txqcan.can); 
 
-	// Queue CAN msg
-	xQueueSendToBack(CanTxQHandle,&pdmocctl->cmd[CMD2].txqcan,4);
+	// Send CAN msg (direct to CAN driver, not queued)
+	dmoc_txdirect(pdmocctl, &pdmocctl->cmd[CMD2].txqcan);
 
 	/* CMD3: Power limits plus setting ambient temp *************** */
   	  // [Could these two be an OTO init, or are they updated as the battery sags?]
@@ -623,8 +644,8 @@ void dmoc_control_CANsend(struct DMOCCTL* pdmocctl)
 	pdmocctl->cmd[CMD3].txqcan.can.cd.uc[6] = pdmocctl->alive;
 	pdmocctl->cmd[CMD3].txqcan.can.cd.uc[7] = DMOCchecksum(&pdmocctl->cmd[CMD3].txqcan.can); 
 
-	// Queue CAN msg
-	xQueueSendToBack(CanTxQHandle,&pdmocctl->cmd[CMD3].txqcan,4);
+	// Send CAN msg (direct to CAN driver, not queued)
+	dmoc_txdirect(pdmocctl, &pdmocctl->cmd[CMD3].txqcan);
 
 	return;
 }
@@ -20,6 +20,9 @@
 #define DMOC_TORQUE 1  // DMOC unit index for torque DMOC
 #define DMOC_SPEED  0  // DMOC unit index for speed DMOC
 
+#define DMOC_SPEEDHIST 8  // Speed mailbox history depth (samples)
+#define DMOC_SPEEDDIFF 4  // Samples back for 'speedacc' finite difference
+
 /* Number of sw1tim ticks to give 64/sec rate. */
 #define DMOC_KATICKS (2)	
 
@@ -71,6 +74,7 @@ struct DMOCCTL
 	int32_t maxspeed_pos; // Max speed (signed) (e.g. 9000)
 	int32_t maxspeed_neg; // Max speed (signed) (e.g.-9000)
 	int32_t speedact;     // Speed actual (reported)
+	float   speedacc;     // Speed rate of change (rpm/sec) from speed mailbox history
 	int32_t torqueact;    // Torque actual (signed)
 	int32_t regencalc;    // Calculated from maxregenwatts
 	int32_t accelcalc;    // Calculated from maxaccelwatts
@@ -93,6 +97,9 @@ struct DMOCCTL
 	uint32_t activitytimctr; // Number of sw timer ticks between activity check
 	uint32_t activitylimit;  // Number dmoc CAN msgs received during interval
 
+	uint32_t txdeferct;     // xCanTxDirect: rate limited, CanTxTask sends it later
+	uint32_t txlostct;      // xCanTxDirect: cmd not sent (pool or queue full, bus-off flush, rejected)
+
 	// Extracted and calculated (deg C) temperatures
 	uint8_t rotortemp;     // Temperature: rotor (raw)
 	uint8_t invtemp;       // Temperature: inverter (raw)
@@ -18,6 +18,7 @@
 #include "morse.h"
 #include "canfilter_setup.h"
 #include "gevcu_idx_v_struct.h"
+#include "dmoc_control.h"
 #include "../../../GliderWinchCommons/embed/svn_common/trunk/db/gen_db.h"
 
 /* From 'main.c' */
@@ -60,6 +61,26 @@ void gevcu_func_init_init(struct GEVCUFUNCTION* p, struct ADCFUNCTION* padc)
 	p->pmbx_cid_dmoc_hv_temps   =  MailboxTask_add(pctl0,p->lc.cid_dmoc_hv_temps,  NULL,GEVCUBIT14,0,U8_U8_U8);
 //	p->pmbx_cid_gevcur_keepalive_i = MailboxTask_add(pctl0,p->lc.cid_gevcur_keepalive_i,NULL,GEVCUBIT15,0,23);
 
+	/* Speed history (field 0: speed) for 'speedacc' */
+	MailboxTask_add_hist(p->pmbx_cid_dmoc_speed, DMOC_SPEEDHIST, 0);
+
+	/* Mailbox set copied together each pass (order: GEVCUSNAP_... indices) */
+	struct MAILBOXCAN* psnapset[GEVCUSNAPNUM];
+	psnapset[GEVCUSNAP_CNTCTR_KA ] = p->pmbx_cid_cntctr_keepalive_r;
+	psnapset[GEVCUSNAP_ACTUALTORQ] = p->pmbx_cid_dmoc_actualtorq;
+	psnapset[GEVCUSNAP_SPEED     ] = p->pmbx_cid_dmoc_speed;
+	psnapset[GEVCUSNAP_HV_STATUS ] = p->pmbx_cid_dmoc_hv_status;
+	psnapset[GEVCUSNAP_HV_TEMPS  ] = p->pmbx_cid_dmoc_hv_temps;
+	if (MailboxTask_snap_init(&p->snap, psnapset, GEVCUSNAPNUM) != 0) morse_trap(406);
+
+#ifdef CANRATELIMITINCLUDED
+	/* Exempt our time critical msgs from the CAN1 TX flood guard (main.c) */
+	if (can_iface_ratelimit_add(pctl0,p->lc.cid_dmoc_cmd_speed,    0xffe00000,0,0,CANRATE_DEFER) < 0) morse_trap(407);
+	if (can_iface_ratelimit_add(pctl0,p->lc.cid_dmoc_cmd_torq,     0xffe00000,0,0,CANRATE_DEFER) < 0) morse_trap(407);
+	if (can_iface_ratelimit_add(pctl0,p->lc.cid_dmoc_cmd_regen,    0xffe00000,0,0,CANRATE_DEFER) < 0) morse_trap(407);
+	if (can_iface_ratelimit_add(pctl0,p->lc.cid_cntctr_keepalive_i,0xffe00000,0,0,CANRATE_DEFER) < 0) morse_trap(407);
+#endif
+
 	/* Pre-load fixed data in CAN msgs */
 	for (i = 0; i < NUMCANMSGS; i++)
 	{
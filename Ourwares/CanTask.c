@@ -17,6 +17,9 @@ void StartCanRxTask(void const * argument);
 
 osThreadId CanTxTaskHandle;
 QueueHandle_t CanTxQHandle;
+uint32_t CanTxDeferLost; // Count of rate-limit deferred msgs lost re-queuing
+
+#define CANERRPOLLTICKS 8 // Max ticks between CAN error state polls (~16 ms)
 
 /* ====== Tx ==============================================================*/
 /* *************************************************************************
@@ -62,6 +65,39 @@ QueueHandle_t  xCanTxTaskCreate(uint32_t taskpriority, int32_t queuesize)
 	CanTxQHandle = xQueueCreate(queuesize, sizeof(struct CANTXQMSG));
 	return CanTxQHandle;
 }
+/* *************************************************************************
+ * int xCanTxDirect(struct CANTXQMSG* ptxq);
+ * @brief	: Add CAN msg directly to the CAN driver TX buffer (bypass CanTxTask queue)
+ * @param	: ptxq = pointer to msg and CAN control block (same as queued msgs)
+ * @return	: 0 = OK;  1 = rate limit deferred, msg placed on CanTxTask queue
+ *				: -1 = TX buffer full (msg discarded)
+ *				: -2 = Bogus CAN id rejected
+ *				: -3 = control block pointer NULL
+ *				: -4 = Rate limit exceeded, msg dropped
+ *				: -6 = Rate limit deferred and CanTxTask queue full (msg discarded)
+ *				: -7 = Bus-off with CANPOOL_FLUSH policy, msg discarded
+ * *************************************************************************/
+/*
+Time critical tasks (e.g. GevcuTask sending DMOC commands) call this rather
+than queuing for CanTxTask.  The msg goes into the driver pool (and the mailbox
+if CAN is idle) in the caller's context, which saves the queue copies and the
+switch to CanTxTask.  'can_driver_put' does its list work with interrupts
+disabled so it can be called from more than one task.
+*/
+int xCanTxDirect(struct CANTXQMSG* ptxq)
+{
+	int ret = can_driver_put(ptxq->pctl, &ptxq->can, ptxq->maxretryct, ptxq->bits);
+	if (ret == -5)
+	{ // Rate limit deferral: let CanTxTask retry it
+		if (xQueueSendToBack(CanTxQHandle,ptxq,0) != pdPASS)
+		{
+			CanTxDeferLost += 1;
+			return -6;
+		}
+		return 1;
+	}
+	return ret;
+}
 /* *************************************************************************
  * void StartCanTxTask(void const * argument);
  *	@brief	: Task startup
@@ -71,14 +107,17 @@ void StartCanTxTask(void const * argument)
    BaseType_t Qret;	// queue receive return
 	struct CANTXQMSG txq;
 	int ret;
+	uint32_t deferrun = 0; // Consecutive deferred msgs
 
   /* Infinite RTOS Task loop */
   for(;;)
   {
-HAL_GPIO_TogglePin(GPIOD, GPIO_PIN_14); // 14-RED, 13-ORANGE
-		Qret = xQueueReceive(CanTxQHandle,&txq,portMAX_DELAY);
+		/* Timeout so error states are polled and bus-off gets restarted */
+		Qret = xQueueReceive(CanTxQHandle,&txq,CANERRPOLLTICKS);
+		can_iface_errstate_poll();
 		if (Qret == pdPASS) // Break loop if not empty
 		{
+HAL_GPIO_TogglePin(GPIOD, GPIO_PIN_14); // 14-RED, 13-ORANGE
 			ret = can_driver_put(txq.pctl, &txq.can, txq.maxretryct, txq.bits);
 /* ===> Trap errors
  *				: -1 = Buffer overrun (no free slots for the new msg)
@@ -87,6 +126,26 @@ HAL_GPIO_TogglePin(GPIOD, GPIO_PIN_14); // 14-RED, 13-ORANGE
 //			if (ret == -1) morse_trap(91);
 			if (ret == -2) morse_trap(92);
 			if (ret == -3) morse_trap(93);
+
+			/* Rate limited msgs: -4 was dropped (and counted) by can_iface.
+            -5 goes to the back of the queue so other msgs are not held up. */
+			if (ret == -5)
+			{
+				if (xQueueSendToBack(CanTxQHandle,&txq,0) != pdPASS)
+					CanTxDeferLost += 1; // Queue full: msg lost
+				/* When every msg in the queue has been deferred, give the 
+               bucket time to refill rather than spin. */
+				deferrun += 1;
+				if (deferrun >= uxQueueMessagesWaiting(CanTxQHandle))
+				{
+					deferrun = 0;
+					osDelay(1);
+				}
+			}
+			else
+			{
+				deferrun = 0;
+			}
 		}
   }
 }
@@ -32,6 +32,18 @@ QueueHandle_t  xCanTxTaskCreate(uint32_t taskpriority, int32_t queuesize);
  * @param	: queuesize = number of items in Tx queue
  * @return	: QueueHandle_t = queue handle
  * *************************************************************************/
+int xCanTxDirect(struct CANTXQMSG* ptxq);
+/* @brief	: Add CAN msg directly to the CAN driver TX buffer (bypass CanTxTask queue)
+ * @param	: ptxq = pointer to msg and CAN control block (same as queued msgs)
+ * @return	: 0 = OK;  1 = rate limit deferred, msg placed on CanTxTask queue
+ *				: -1 = TX buffer full (msg discarded)
+ *				: -2 = Bogus CAN id rejected
+ *				: -3 = control block pointer NULL
+ *				: -4 = Rate limit exceeded, msg dropped
+ *				: -6 = Rate limit deferred and CanTxTask queue full (msg discarded)
+ *				: -7 = Bus-off with CANPOOL_FLUSH policy, msg discarded
+ * NOTE: Task context only.  Any number of tasks may call this.
+ * *************************************************************************/
 QueueHandle_t xCanRxTaskCreate(uint32_t taskpriority, int32_t queuesize);
 /* @brief	: Create task; task handle created is global for all to enjoy!
  * @param	: taskpriority = Task priority (just as it says!)
@@ -41,6 +53,7 @@ QueueHandle_t xCanRxTaskCreate(uint32_t taskpriority, int32_t queuesize);
 
 extern QueueHandle_t CanTxQHandle;
 extern QueueHandle_t CanRxQHandle;
+extern uint32_t CanTxDeferLost;
 
 #endif
 
@@ -6,13 +6,18 @@
 /*
   02/26/2019
 This task works in conjunction with 'MailboxTask'.  'MailboxTask' notifies this
-task when a CAN module circular buffer has one or more CAN msgs.  This task directly
-accesses the circular buffer via 'take' pointer.
+task when a CAN module circular buffer has one or more CAN msgs.  This task takes
+them from the 'mbxgate' handoff ring 'MailboxTask' fills for each CAN module.
 
 The 'MailboxTask' is likely a high FreeRTOS priority task.  This task might run at
-a lower priority since timing is not critical, however delays require that the 
-circular buffer be large enough to avoid overrun since there is no protection for
-buffer overflow (since CAN msgs are added to the circular buffer under interrupt).
+a lower priority since timing is not critical.  If it falls behind, the handoff
+ring policy decides which CAN msgs are lost, and they are counted.  When the 
+counts change a loss report (CANID_GATELOSS) is sent to the PC in the CAN msg
+stream, so gaps in the PC log can be seen.
+
+CAN->PC msgs are ascii/hex lines, one buffer each, or (GATEMODE_BIN, asked for
+by the PC) binary frames packed back to back until the buffer is full or
+the handoff is drained.  The binary frames are about half the bytes.
 
 This version only handles PC->CAN bus msgs for CAN1 module.  To mix CAN1 and CAN2
 requires implementing the scheme of commandeering the low order bit(s) from the
@@ -59,6 +64,139 @@ osThreadId GatewayTaskHandle;
 /* A notification to Gateway copies the internal notification word to this. */
 uint32_t GatewayTask_noteval = 0;    // Receives notification word upon an API notify
 
+/* CAN->PC format: GATEMODE_ASCII or GATEMODE_BIN */
+static uint8_t gatemode = GATEMODE_ASCII;
+
+/* Handoff counts last reported to the PC */
+static uint32_t gatelossrpt[STM32MAXCANNUM];
+static uint32_t gatecoalrpt[STM32MAXCANNUM];
+static uint32_t gatecdcrpt[STM32MAXCANNUM];
+
+/* CAN->PC msgs the usb-cdc did not take ('cdc_txbuff_add' gave up) */
+static uint32_t gatecdclost[STM32MAXCANNUM];
+
+/* *************************************************************************
+ * static int gate_lossreport(int i, struct CANRCVBUF* pcan);
+ * @brief	: Build a loss report for a handoff count changed since it was last sent
+ * @param	: i = index for CAN unit (0, 1)
+ * @param	: pcan = pointer to CAN msg to receive the report
+ * @return	: 0 = nothing new; 1 = report in 'pcan' (call again for the other counts)
+ * *************************************************************************/
+static int gate_lossreport(int i, struct CANRCVBUF* pcan)
+{
+	struct MBXGATE* p = MailboxTask_gate(i);
+	uint32_t lost;
+	uint32_t coal;
+
+	if (p == NULL) return 0;
+	lost = mbxgate_losses(p);
+	coal = p->stats.coalesced;
+	if (lost != gatelossrpt[i])
+	{
+		gatelossrpt[i] = lost;
+		pcan->cd.uc[2] = GATELOSS_LOST;
+		pcan->cd.ui[1] = lost;
+	}
+	else if (coal != gatecoalrpt[i])
+	{
+		gatecoalrpt[i] = coal;
+		pcan->cd.uc[2] = GATELOSS_COAL;
+		pcan->cd.ui[1] = coal;
+	}
+	else if (gatecdclost[i] != gatecdcrpt[i])
+	{
+		gatecdcrpt[i] = gatecdclost[i];
+		pcan->cd.uc[2] = GATELOSS_CDC;
+		pcan->cd.ui[1] = gatecdclost[i];
+	}
+	else
+		return 0;
+
+	pcan->id       = CANID_GATELOSS;
+	pcan->dlc      = 8;
+	pcan->cd.uc[0] = i;
+	pcan->cd.uc[1] = p->policy;
+	pcan->cd.uc[3] = 0;
+	return 1;
+}
+/* *************************************************************************
+ * static int gate_add(struct SERIALSENDTASKBCB* pbuf, int ct, struct CANRCVBUF* pcan);
+ * @brief	: Add a CAN msg for the PC to a buffer in the present format
+ * @param	: pbuf = pointer to buffer control block
+ * @param	: ct = bytes already in buffer (0 = buffer not yet taken)
+ * @param	: pcan = CAN msg
+ * @return	: bytes in buffer
+ * *************************************************************************/
+static int gate_add(struct SERIALSENDTASKBCB* pbuf, int ct, struct CANRCVBUF* pcan)
+{
+	if (ct == 0) xSemaphoreTake(pbuf->semaphore, 5000);
+
+	if (gatemode == GATEMODE_BIN)
+		return (ct + gateway_CANtoPC_bin(pbuf->pbuf + ct, (pbuf->maxsize - ct), pcan));
+
+	/* Convert binary to the ascii/hex format for PC. */
+	gateway_CANtoPC(&pbuf, pcan);
+	return pbuf->size;
+}
+/* *************************************************************************
+ * static int gate_full(struct SERIALSENDTASKBCB* pbuf, int ct);
+ * @brief	: Check if buffer should be sent now
+ * @return	: 1 = send; 0 = room for another binary frame
+ * *************************************************************************/
+static int gate_full(struct SERIALSENDTASKBCB* pbuf, int ct)
+{
+	if (gatemode != GATEMODE_BIN) return 1; // One line per buffer
+	return ((pbuf->maxsize - ct) < GATEWAYBINMAX);
+}
+/* *************************************************************************
+ * static void gate_send(int i, struct SERIALSENDTASKBCB** ppbuf, int ct, int n);
+ * @brief	: Queue buffer to uart, and a copy to usb-cdc
+ * @param	: i = index for CAN unit (0, 1) the msgs came from
+ * @param	: ppbuf = pointer to pointer to uart buffer control block
+ * @param	: ct = bytes in buffer
+ * @param	: n = CAN msgs in buffer to count if the usb-cdc can't take it
+ * *************************************************************************/
+static void gate_send(int i, struct SERIALSENDTASKBCB** ppbuf, int ct, int n)
+{
+	(*ppbuf)->size = ct;
+
+#ifdef USEUSBFORCANMSGS
+	/* Copy into the usb-cdc fill buffer before the uart has it. A 0 return
+	   means the usb-cdc gave up (full for CDCTXWAIT, or stalled). */
+	if (cdc_txbuff_add((*ppbuf)->pbuf, ct) == 0)
+		gatecdclost[i] += n;
+#endif
+
+	vSerialTaskSendQueueBuf(ppbuf); // Place on queue for usart sending
+	return;
+}
+/* *************************************************************************
+ * static void gate_mode(struct CANRCVBUF* preq, struct SERIALSENDTASKBCB** ppbuf);
+ * @brief	: PC asked for a CAN->PC format: reply in the old format, then switch
+ * @param	: preq = CANID_GATEMODE msg from PC
+ * @param	: ppbuf = pointer to pointer to CAN1 uart buffer (see 'gate_send')
+ * *************************************************************************/
+static void gate_mode(struct CANRCVBUF* preq, struct SERIALSENDTASKBCB** ppbuf)
+{
+	struct CANRCVBUF can;
+	uint8_t mode = preq->cd.uc[0];
+
+	can.id       = CANID_GATEMODE;
+	can.dlc      = 2;
+	can.cd.ull   = 0;
+	can.cd.uc[0] = mode;
+	if ((preq->dlc >= 1) && (mode <= GATEMODE_BIN))
+		can.cd.uc[1] = GATEMODE_ACK;
+	else
+		can.cd.uc[1] = GATEMODE_NAK;
+
+	gate_send(0, ppbuf, gate_add(*ppbuf, 0, &can), 0);
+
+	if (can.cd.uc[1] == GATEMODE_ACK)
+		gatemode = mode;
+	return;
+}
+
 /* *************************************************************************
  * osThreadId xGatewayTaskCreate(uint32_t taskpriority);
  * @brief	: Create task; task handle created is global for all to enjoy!
@@ -95,7 +233,10 @@ void StartGatewayTask(void const * argument)
 
 	struct SERIALRCVBCB* prbcb2;	// usart2 (PC->CAN msgs)
 	struct CANRCVBUFPLUS* pcanp;  // Basic CAN msg Plus error and seq number
-	struct CANRCVBUFN* pncan;
+	struct CANRCVBUFN ncan;       // CAN msg copied from the 'MailboxTask' handoff
+	int flag;                     // 1 = CAN msg; 2 = loss report (PC only)
+	int ct;                       // Bytes in PC buffer not yet sent
+	int nb;                       // CAN msgs (not loss reports) in PC buffer
 
 	/* PC, or other CAN, to CAN msg */
 	// Pre-load fixed elements for queue to CAN 'put' 
@@ -130,11 +271,7 @@ void StartGatewayTask(void const * argument)
 
 	/* Use usb-cdc for gateway data. */
 #ifdef  USEUSBFORCANMSGS
-	// CAN1
-	struct SERIALSENDTASKBCB* pbuf5 = getserialbuf(&HUARTGATE,128); // Gateway cdc, CAN1
-	if (pbuf5 == NULL) morse_trap(70);
-	struct CDCTXTASKBCB cdc2;
-	cdc2.pbuf = pbuf5->pbuf;
+	// CAN1, CAN2 msgs to the PC: 'gate_send' copies into the cdc buffer
 
 	// PC-cdc -> CAN1 (no PC->CAN2)
 	struct CANTXQMSG pccanc;
@@ -144,23 +281,12 @@ void StartGatewayTask(void const * argument)
 
 	struct CDCRXCANMSG* prxcanmsg;
 
-	// CAN2
-	#ifdef CONFIGCAN2 // CAN2 implemented
-		struct SERIALSENDTASKBCB* pbuf6 = getserialbuf(&HUARTGATE,128); // Gateway cdc, CAN2
-		if (pbuf6 == NULL) morse_trap(71);
-		struct CDCTXTASKBCB cdc3;
-		cdc3.pbuf = pbuf6->pbuf;
-	#endif
-
 	// CDC receiving (priority, our notification bit)
 	osThreadId ret = xCdcRxTaskReceiveCANCreate(1, TSKGATEWAYBITCDC);
 	if (ret == NULL) morse_trap(84);
 
 #endif
 
-	/* Pointers into the CAN  msg circular buffer for each CAN module. */
-	struct CANTAKEPTR* ptake[STM32MAXCANNUM] = {NULL};
-
 	/* Setup serial input buffering and line-ready notification */
      //   (ptr uart handle, dma flag, notiification bit, 
      //   ptr notification word, number line buffers, size of lines, 
@@ -178,13 +304,12 @@ void StartGatewayTask(void const * argument)
 
 gatercvflag = 1;
 
-	/* Get pointers to circular buffer pointers for each CAN module in list. */	
+	/* CAN msgs come from the 'MailboxTask' handoff for each CAN module in list. */	
 	for (i = 0; i < STM32MAXCANNUM; i++)
 	{
-		if ((mbxcannum[i].pmbxarray != NULL) && (mbxcannum[i].pctl != NULL))
+		if ((mbxcannum[i].ptbl != NULL) && (mbxcannum[i].pctl != NULL))
 		{
-			ptake[i] = can_iface_add_take(mbxcannum[i].pctl);
-			yprintf(&pbuf2,"\n\rStartGateway: mbxcannum[%i] setup OK. array: 0x%08X pctl: 0x%08X",i,mbxcannum[i].pmbxarray,mbxcannum[i].pctl);
+			yprintf(&pbuf2,"\n\rStartGateway: mbxcannum[%i] setup OK. array: 0x%08X pctl: 0x%08X",i,mbxcannum[i].ptbl,mbxcannum[i].pctl);
 		}
 		else
 		{
@@ -216,34 +341,36 @@ extern CAN_HandleTypeDef hcan1;
 			if ((GatewayTask_noteval & (1 << i)) != 0)
 			{
 				noteused |= (GatewayTask_noteval & (1 << i)); // We handled the bit			
+				ct = 0; nb = 0;
 				do
 				{
-					/* Get pointer into CAN msg circular buffer */
-					pncan = can_iface_get_CANmsg(ptake[i]);
-					if (pncan != NULL)
+					/* Get CAN msg from handoff; when empty, report any losses */
+					flag = MailboxTask_gate_get(i, &ncan);
+					if ((flag == 0) && (gate_lossreport(i, &ncan.can) != 0))
+						flag = 2;
+					if (flag != 0)
 					{			
-					/* Convert binary to the ascii/hex format for PC. */
-						canqtx2.can = pncan->can; // Save a local copy
-						xSemaphoreTake(pbuf3->semaphore, 5000);
-						gateway_CANtoPC(&pbuf3, &canqtx2.can);
+						canqtx2.can = ncan.can; // Save a local copy
 
 					/* === CAN1 -> PC === */			
-						vSerialTaskSendQueueBuf(&pbuf3); // Place on queue for usart2 sending
-
-#ifdef USEUSBFORCANMSGS
-						// Buffers are independent, so copy it
-						memcpy(pbuf5->pbuf,pbuf3->pbuf,pbuf3->size);
-						pbuf5->size = pbuf3->size;
-						cdc2.size = pbuf5->size;
-						xQueueSendToBack(CdcTxTaskSendQHandle,&cdc2,1500);
-#endif
+						ct = gate_add(pbuf3, ct, &canqtx2.can);
+						if (flag == 1) nb += 1;
+						if (gate_full(pbuf3, ct) != 0)
+						{
+							gate_send(i, &pbuf3, ct, nb);
+							ct = 0; nb = 0;
+						}
 
 #ifdef CONFIGCAN2 // CAN2 setup
 					/* === CAN1 -> CAN2 === */
-						xQueueSendToBack(CanTxQHandle,&canqtx2,portMAX_DELAY);
+						if (flag == 1)
+							xQueueSendToBack(CanTxQHandle,&canqtx2,portMAX_DELAY);
 #endif
 					}
-				} while (pncan != NULL);	// Drain the buffer
+				} while (flag != 0);	// Drain the buffer
+
+				/* Binary frames not yet sent */
+				if (ct != 0) gate_send(i, &pbuf3, ct, nb);
 			}
 		}
 #ifdef CONFIGCAN2 // CAN2 implemented
@@ -253,34 +380,34 @@ extern CAN_HandleTypeDef hcan1;
 			if ((GatewayTask_noteval & (1 << i)) != 0)
 			{
 				noteused |= (GatewayTask_noteval & (1 << i)); // We handled the bit			
+				ct = 0; nb = 0;
 				do
 				{
-					/* Get pointer into CAN msg circular buffer */
-//					pncan = can_iface_get_CANmsg(ptake[i]);
-					pncan = Mailboxgetbuf(i);
-					if (pncan != NULL)
+					/* Get CAN msg from handoff; when empty, report any losses */
+					flag = MailboxTask_gate_get(i, &ncan);
+					if ((flag == 0) && (gate_lossreport(i, &ncan.can) != 0))
+						flag = 2;
+					if (flag != 0)
 					{			
-					/* Convert binary to the ascii/hex format for PC. */
-						canqtx1.can = pncan->can;	// Save a local copy
-						xSemaphoreTake(pbuf4->semaphore, 5000);
-						gateway_CANtoPC(&pbuf4, &canqtx1.can);
+						canqtx1.can = ncan.can;	// Save a local copy
 
 					/* === CAN2 -> PC === */			
-						vSerialTaskSendQueueBuf(&pbuf4); // Place on queue for usart2 sendingpctocanc
-
-   #ifdef USEUSBFORCANMSGS
-						// Buffers are independent, so copy it
-						memcpy(pbuf6->pbuf,pbuf4->pbuf,pbuf4->size);
-						pbuf6->size = pbuf4->size;
-						cdc3.size = pbuf6->size;
-						xQueueSendToBack(CdcTxTaskSendQHandle,&cdc3,1500);
-   #endif
-
-
-					/* === CAN1 -> CAN2 === */
-						xQueueSendToBack(CanTxQHandle,&canqtx1,portMAX_DELAY);
+						ct = gate_add(pbuf4, ct, &canqtx1.can);
+						if (flag == 1) nb += 1;
+						if (gate_full(pbuf4, ct) != 0)
+						{
+							gate_send(i, &pbuf4, ct, nb);
+							ct = 0; nb = 0;
+						}
+
+					/* === CAN2 -> CAN1 === */
+						if (flag == 1)
+							xQueueSendToBack(CanTxQHandle,&canqtx1,portMAX_DELAY);
 					}
-				} while (pncan != NULL);	// Drain the buffer
+				} while (flag != 0);	// Drain the buffer
+
+				/* Binary frames not yet sent */
+				if (ct != 0) gate_send(i, &pbuf4, ct, nb);
 			}
 		}
 #endif
@@ -295,7 +422,11 @@ extern CAN_HandleTypeDef hcan1;
 				if (pcanp != NULL)
 				{
 					/* Check for errors */
-					if (pcanp->error == 0)
+					if (((pcanp->error & ~PCTOCAN_ERR_SEQ) == 0) && (pcanp->can.id == CANID_GATEMODE))
+					{ // Here, format switch for the gateway, not for the CAN bus
+						gate_mode(&pcanp->can, &pbuf3);
+					}
+					else if (pcanp->error == 0)
 					{
 						/* Place CAN msg on queue for sending to CAN bus */
 						pccan1.can = pcanp->can;
@@ -331,7 +462,11 @@ dbuggateway1 += 1;
 			{
 
 				/* Check for errors */
-				if (prxcanmsg->error == 0)
+				if (((prxcanmsg->error & ~PCTOCAN_ERR_SEQ) == 0) && (prxcanmsg->can.id == CANID_GATEMODE))
+				{ // Here, format switch for the gateway, not for the CAN bus
+					gate_mode(&prxcanmsg->can, &pbuf3);
+				}
+				else if (prxcanmsg->error == 0)
 				{ // Here, no errors.
 					/* Copy to preloaded local buffer. */
 					pccanc.can = prxcanmsg->can; // Copy CAN msg to preloaded local struct
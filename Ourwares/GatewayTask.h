@@ -14,7 +14,34 @@
 #include "malloc.h"
 #include "common_can.h"
 
+/* In-band loss report to the PC, sent as a CAN msg in the CAN->PC stream.
+   11b id 0x7FF is not allowed on a CAN bus, so it can't be a real msg.
+   Payload: [0] CAN module index (0 = CAN1), [1] handoff policy, 
+   [2] which count (below), [3] 0, [4]-[7] the count (u32, little endian).
+   Each count that changed goes in its own msg, lost first.  The counts
+   are running totals, so a missed report loses nothing. */
+#define CANID_GATELOSS 0xFFE00000
+#define GATELOSS_LOST  0  // Dropped + overwritten, not sent to the PC
+#define GATELOSS_COAL  1  // Replaced by a newer msg with the same id
+#define GATELOSS_CDC   2  // Not taken by the usb-cdc (buffers full, or USB stalled)
 
+/* PC->CAN1 flood guard (main.c): CAN1 TX ids share one token bucket of this
+   rate and depth; over the rate msgs are deferred (CanTxTask requeues them).
+   GevcuTask exempts its time critical ids (DMOC commands, contactor keepalive). */
+#define GATECAN1RATE  1000 // Msgs per sec (about 1/4 of the bus at 500K)
+#define GATECAN1BURST 32   // Msgs back-to-back
+
+/* CAN->PC format switch.  The PC sends (in ascii/hex) a msg with id
+   CANID_GATEMODE (11b 0x7FE, also not allowed on a bus), payload [0] = mode.
+   The gateway replies with the same id, [0] = mode, [1] = GATEMODE_ACK or
+   GATEMODE_NAK, as the last msg in the old format; all msgs after it are
+   in the new format.  PC->CAN msgs stay ascii/hex.  The request's sequence
+   number is not checked. */
+#define CANID_GATEMODE 0xFFC00000
+#define GATEMODE_ASCII 0  // Ascii/hex line for each msg (default)
+#define GATEMODE_BIN   1  // Byte stuffed binary frames, back to back
+#define GATEMODE_NAK   0
+#define GATEMODE_ACK   1
 
 /* *************************************************************************/
 osThreadId xGatewayTaskCreate(uint32_t taskpriority);
@@ -8,26 +8,61 @@
 #include "stm32f4xx_hal_can.h"
 #include "CanTask.h"
 #include "MailboxTask.h"
+#include <string.h>
 #include "morse.h"
 #include "DTW_counter.h"
 #include "payload_extract.h"
+#include "paydesc.h"
 #include "GatewayTask.h"
 #include "main.h"
+#include "semphr.h"
 
 extern osThreadId GatewayTaskHandle;
 
 /* One struct for each CAN module, e.g. CAN 1, 2, 3, ... */
 struct MAILBOXCANNUM mbxcannum[STM32MAXCANNUM] = {0};
 
+/* Tasks notified by mailboxes. Bits accumulate over a drained batch. */
+struct MBXNOTETASK
+{
+	osThreadId tskhandle;
+	uint32_t   bits;      // Notification bits accumulated for this batch
+};
+static struct MBXNOTETASK notetask[MBXNOTETASKMAX];
+static uint8_t notetaskct;   // Number of tasks in table
+static uint32_t notebatchhits; // Subscriber notifications in this batch
+
+struct MBXNOTESTATS mbxnotestats;
+
+/* Fixed pools that registrations draw from. */
+static struct MAILBOXCAN    mbxpool[MBXPOOLSIZE];
+static struct CANNOTIFYLIST notepool[MBXNOTEPOOLSIZE];
+static struct MBXFAMILY    fampool[MBXFAMPOOLSIZE];
+static uint16_t mbxpoolct;   // Number taken
+static uint16_t notepoolct;  // Number taken
+static uint8_t  fampoolct;   // Number taken
+
+/* Registrations (writers) are serialized with this mutex. */
+static SemaphoreHandle_t mbxaddmutex;
+
+/* MailboxTask passes (it holds no table pointer when this is incremented). */
+volatile uint32_t mbxqsct;
+
+/* Batch seqlock: odd while MailboxTask loads a batch (see 'MailboxTask_snap'). */
+volatile uint32_t mbxepoch;
+
 #ifdef GATEWAYTASKINCLUDED
-#define GATEWAYBUFSIZE 16
-	struct MBXTOGATEBUF mbxgatebuf[STM32MAXCANNUM] = {0};
+	struct MBXGATE mbxgate[STM32MAXCANNUM] = {0};
 #endif
 
 osThreadId MailboxTaskHandle; // This wonderful task handle
 
 void StartMailboxTask(void const * argument);
 static struct MAILBOXCAN* loadmbx(struct MAILBOXCANNUM* pmbxnum, struct CANRCVBUFN* pncan);
+static int lowerbound(struct MBXTABLE* ptbl, uint32_t canid);
+static void tbl_insert(struct MAILBOXCANNUM* pmbxnum, struct MAILBOXCAN* pmbx);
+static void notify_flush(void);
+static void stale_sweep(void);
 
 /* *************************************************************************
  * struct MAILBOXCANNUM* MailboxTask_add_CANlist(struct CAN_CTLBLOCK* pctl, uint16_t arraysize);
@@ -39,7 +74,8 @@ static struct MAILBOXCAN* loadmbx(struct MAILBOXCANNUM* pmbxnum, struct CANRCVBU
  * *************************************************************************/
 struct MAILBOXCANNUM* MailboxTask_add_CANlist(struct CAN_CTLBLOCK* pctl, uint16_t arraysize)
 {
-	struct MAILBOXCAN** ppmbxarray; // Pointer to array of pointers to mailboxes
+	struct MBXTABLE* ptbl;
+	int i;
 
 	if (pctl == NULL) morse_trap(21); // Oops
 
@@ -53,9 +89,17 @@ taskENTER_CRITICAL();
 	/* This is needed to find the CAN module in 'StartMailboxTask' */
 	mbxcannum[pctl->canidx].pctl = pctl;
 
-	/* Get memory for the array of mailbox pointers */
-	ppmbxarray = (struct MAILBOXCAN**)calloc(arraysize, sizeof(struct MAILBOXCAN*));
-	if (ppmbxarray == NULL) {taskEXIT_CRITICAL(); morse_trap(23);}
+	/* Get memory for the two lookup tables: arrays of mailbox pointers, and
+	   the sorted CAN ids for the lookup, in step with the mailbox pointers */
+	for (i = 0; i < 2; i++)
+	{
+		ptbl = &mbxcannum[pctl->canidx].tbl[i];
+		ptbl->pmbxarray = (struct MAILBOXCAN**)calloc(arraysize, sizeof(struct MAILBOXCAN*));
+		if (ptbl->pmbxarray == NULL) {taskEXIT_CRITICAL(); morse_trap(23);}
+		ptbl->pidarray = (uint32_t*)calloc(arraysize, sizeof(uint32_t));
+		if (ptbl->pidarray == NULL) {taskEXIT_CRITICAL(); morse_trap(20);}
+		ptbl->n = 0; // Start with no mailboxes created.
+	}
 
 	/* xMailboxTaskCreate needs to be called before this 'add to list' */
 	if (MailboxTaskHandle == NULL) {taskEXIT_CRITICAL(); morse_trap(24);}
@@ -64,14 +108,11 @@ taskENTER_CRITICAL();
 	// The first three notification bits are reserved for CAN modules 
 	mbxcannum[pctl->canidx].ptake = can_iface_mbx_init(pctl, MailboxTaskHandle, (1 << pctl->canidx) );
 
-	/* Save pointer to array of pointers to mailboxes. */
-	mbxcannum[pctl->canidx].pmbxarray = ppmbxarray;
-
 	/* Save number of mailbox pointers */
 	mbxcannum[pctl->canidx].arraysizemax = arraysize; // Max
 
-	/* Start with no mailboxes created. */
-	mbxcannum[pctl->canidx].arraysizecur = 0;
+	/* Publish table [0]; [1] is the spare. */
+	mbxcannum[pctl->canidx].ptbl = &mbxcannum[pctl->canidx].tbl[0];
 
 	/* What is important here is to return a non-NULL pointer to show success. */
 taskEXIT_CRITICAL();
@@ -87,23 +128,75 @@ taskEXIT_CRITICAL();
 static struct CANNOTIFYLIST* noteskip(struct MAILBOXCAN* pmbx, uint8_t skip)
 {
 	osThreadId tskhandle = xTaskGetCurrentTaskHandle();
-	struct CANNOTIFYLIST* pnotetmp;	
-	struct CANNOTIFYLIST* pnotex;	
+	struct CANNOTIFYLIST* pnotetmp = pmbx->pnote; // Ptr to array
+	int i;
 
-	// Traverse linked list to find task
-	pnotetmp = pmbx->pnote;	// Ptr to head of list
-	if (pnotetmp == NULL) return NULL; // No notifications setup!
-	do 
+	// Search array for task
+	for (i = 0; i < pmbx->notect; i++, pnotetmp++)
 	{
 		if (tskhandle == pnotetmp->tskhandle)
 		{ // Notification for "this" task found
 			pnotetmp->skip = skip; // Update 'skip' flag
 			return pnotetmp; // Ptr to notification struct
 		}
-			pnotex   = pnotetmp;
-			pnotetmp = pnotetmp->pnext;
-	} while (pnotetmp != pnotex);
-	return NULL; // Here, the current running task not found
+	}
+	return NULL; // Here, no notifications, or the current running task not found
+}
+/* *************************************************************************
+ * static int noteadd(struct MAILBOXCAN* pmbx, osThreadId tskhandle, uint32_t notebit, uint8_t skip);
+ *	@brief	: Add a notification block to a mailbox's array
+ * @param	: pmbx = pointer to mailbox
+ * @param	: tskhandle = task to notify
+ * @param	: notebit = notification bit
+ * @param	: skip = notify = 0; skip notification = 1;
+ * @return	: 0 = OK; -1 = task table full; -2 = notification pool used up
+ * NOTE: Call holding 'mbxaddmutex'.
+ * *************************************************************************/
+/*
+The array grows by one for each subscriber: a new run of blocks is taken
+from the pool and the old array copied into it.  MailboxTask reads 'notect' 
+before 'pnote', so 'pnote' is set before 'notect'.  The old blocks are left
+as they are since MailboxTask may be reading them.  Almost all mailboxes 
+have one subscriber, so little of the pool is lost this way.
+*/
+static int notetask_idx(osThreadId tskhandle)
+{ // Find the task in the table of tasks notified, or add it. 
+	int i;
+	for (i = 0; i < notetaskct; i++)
+	{
+		if (notetask[i].tskhandle == tskhandle) return i;
+	}
+	if (notetaskct >= MBXNOTETASKMAX) return -1;
+	notetask[i].tskhandle = tskhandle;
+	__DMB();
+	notetaskct += 1;
+	return i;
+}
+static int noteadd(struct MAILBOXCAN* pmbx, osThreadId tskhandle, uint32_t notebit, uint8_t skip)
+{
+	struct CANNOTIFYLIST* pnotex;
+	int i = notetask_idx(tskhandle);
+
+	if (i < 0) return -1;
+	if ((notepoolct + pmbx->notect + 1) > MBXNOTEPOOLSIZE) return -2;
+
+	/* Take a run of blocks, one larger, and copy the old array. */
+	pnotex = &notepool[notepoolct];
+	notepoolct += pmbx->notect + 1;
+	if (pmbx->pnote != NULL)
+		memcpy(pnotex, pmbx->pnote, pmbx->notect * sizeof(struct CANNOTIFYLIST));
+
+	/* Initialize new block at the end. */
+	(pnotex + pmbx->notect)->tskhandle = tskhandle; // Task to notify
+	(pnotex + pmbx->notect)->notebit   = notebit;   // Notification bit to use
+	(pnotex + pmbx->notect)->tidx      = i;         // Task table index
+	(pnotex + pmbx->notect)->skip      = skip;      // Skip notification flag
+
+	__DMB();
+	pmbx->pnote = pnotex;
+	__DMB();
+	pmbx->notect += 1;
+	return 0;
 }
 struct CANNOTIFYLIST* MailboxTask_disable_notifications(struct MAILBOXCAN* pmbx)
 {
@@ -128,7 +221,7 @@ struct CANNOTIFYLIST* MailboxTask_enable_notifications(struct MAILBOXCAN* pmbx)
  * @param	: notebit = notification bit; NULL = no notification
  * @paran	: noteskip = notify = 0; skip notification = 1;
  * @param	: paytype = payload type code (see 'PAYLOAD_TYPE_INSERT.sql' in 'GliderWinchCommons/embed/svn_common/db')
- * @return	: Pointer to mailbox; NULL = failed
+ * @return	: Pointer to mailbox (traps if a pool or the sorted table is used up)
  * *************************************************************************/
 struct MAILBOXCAN* MailboxTask_add(struct CAN_CTLBLOCK* pctl,\
 		 uint32_t canid,\
@@ -139,9 +232,8 @@ struct MAILBOXCAN* MailboxTask_add(struct CAN_CTLBLOCK* pctl,\
 {
 	int j;
 	struct MAILBOXCAN* pmbx;
-	struct CANNOTIFYLIST* pnotex;
-	struct CANNOTIFYLIST* pnotetmp;
-	struct MAILBOXCAN** ppmbx;
+	struct MBXTABLE* ptbl;
+	struct MAILBOXCANNUM* pmbxnum;
 
 	/* Check that the bozo programmer got the prior initializations done correctly. */
 	if (canid == 0)    morse_trap(25); 
@@ -152,61 +244,28 @@ struct MAILBOXCAN* MailboxTask_add(struct CAN_CTLBLOCK* pctl,\
 	if (tskhandle == NULL)
 		tskhandle = xTaskGetCurrentTaskHandle();
 
-	/* Pointer to beginning of array of mailbox pointers. */
-	ppmbx = mbxcannum[pctl->canidx].pmbxarray;
+	pmbxnum = &mbxcannum[pctl->canidx];
 
-taskENTER_CRITICAL();
+	/* One registration at a time. MailboxTask and the CAN ISRs keep going. */
+	xSemaphoreTake(mbxaddmutex, portMAX_DELAY);
 
-	/* We are working with the array of pointers to mailboxes. */
-	// Check if this 'canid' has a mailbox
-	for (j = 0; j < mbxcannum[pctl->canidx].arraysizecur; j++)
-	{
-		pmbx = *(ppmbx+j);  // Get pointer to a mailbox from array of pointers
-		if (pmbx == NULL) morse_trap(23); // jic|debug
-		if (pmbx->ncan.can.id == canid)
-		{ // Here, CAN id already has a mailbox, so a notification must be wanted by this task
-			if (notebit != 0)
-			{ // Here add a notification to the existing mailbox
-
-				/* Get a notification block. */
-				pnotex = (struct CANNOTIFYLIST*)calloc(1, sizeof(struct CANNOTIFYLIST));
-				if (pnotex == NULL){taskEXIT_CRITICAL(); morse_trap(29);}//return NULL;}
-
-				/* Check if this mailbox has any notifications */
-				if (pmbx->pnote == NULL)
-				{ // This is the first notification for this mailbox.
-					pmbx->pnote       = pnotex;   // Mailbox points to first notification
-					pnotex->pnext     = pnotex;	// Last on list points to self
-					pnotex->tskhandle = tskhandle;
- 					pnotex->notebit   = notebit;  // Notification bit to use
-					pnotex->skip      = noteskip; // Skip notification flag
-					/* Here, there is no need to sort array on CANID for a binary lookup
-						since a new mailbox was not added. */
-					taskEXIT_CRITICAL();
-					return pmbx;
-				}
-				else
-				{ // Here, one of more notifications.  Add to list.
-					/* Seach end of list */
-					pnotetmp = pmbx->pnote;
-					while (pnotetmp != pnotetmp->pnext) pnotetmp = pnotetmp->pnext;
-
-					/* Add to list and initialize. */
-					pnotetmp->pnext   = pnotex; // End block now points to new block
-					pnotex->pnext     = pnotex; // New block points to self
-					pnotex->tskhandle = tskhandle;
- 					pnotex->notebit   = notebit;  // Notification bit to use
-					pnotex->skip      = noteskip; // Skip notification flag
-					/* Here, there is no need to sort array on CANID for a binary lookup
-						since a new mailbox was not added. */
-					taskEXIT_CRITICAL();
-					return pmbx;
-				}
-			}
-			/* Here, no notification bit, but CAN id already has a mailbox!
+	// Check if this 'canid' has a mailbox. 'j' is where it is, or goes.
+	ptbl = pmbxnum->ptbl;
+	j = lowerbound(ptbl, canid);
+	if ((j < ptbl->n) && (*(ptbl->pidarray + j) == canid))
+	{ // Here, CAN id already has a mailbox, so a notification must be wanted by this task
+		pmbx = *(ptbl->pmbxarray + j);
+		if (notebit == 0)
+		{ /* Here, no notification bit, but CAN id already has a mailbox!
             Either the canid is wrong, or this call was not necessary. */
-			taskEXIT_CRITICAL(); morse_trap(34);//return NULL;
+			xSemaphoreGive(mbxaddmutex); morse_trap(34);
 		}
+		// Here add a notification to the existing mailbox
+		j = noteadd(pmbx, tskhandle, notebit, noteskip);
+		xSemaphoreGive(mbxaddmutex);
+		if (j == -1) morse_trap(35); // MBXNOTETASKMAX too small
+		if (j == -2) morse_trap(29); // MBXNOTEPOOLSIZE too small
+		return pmbx;
 	}
 
 	/* Here, a mailbox for 'canid' was not found in the list.  
@@ -214,61 +273,533 @@ taskENTER_CRITICAL();
 
       Create a mailbox for this canid                         */
 
-	// Point to next available location in array of mailbox pointers.
-   //                 pointer to beginning   + number of entries
-	ppmbx = mbxcannum[pctl->canidx].pmbxarray + mbxcannum[pctl->canidx].arraysizecur;
-
-
-
-	/* Create one mailbox */
-	pmbx = (struct MAILBOXCAN*)calloc(1, sizeof(struct MAILBOXCAN));
-	if (pmbx == NULL){taskEXIT_CRITICAL();morse_trap(33);}//return NULL;}
+	/* Room in pool and sorted table? */
+	if (mbxpoolct >= MBXPOOLSIZE)
+	{ // MBXPOOLSIZE too small
+		xSemaphoreGive(mbxaddmutex); morse_trap(33);
+	}
+	if ((ptbl->n + pmbxnum->reserved) >= pmbxnum->arraysizemax)
+	{ // Bozo programmer: 'MailboxTask_add_CANlist' arraysize too small
+		xSemaphoreGive(mbxaddmutex); morse_trap(31);
+	}
+	pmbx = &mbxpool[mbxpoolct];
 
-	pmbx->ctr          = 0;       // Redundant (calloc set it zero)
-	pmbx->pnote        = NULL;    // Redundant (calloc set it zero)
 	pmbx->paytype      = paytype; // Payload layout code
 	pmbx->ncan.can.id  = canid;   // Save CAN id
 	pmbx->ncan.toa     = DTWTIME; // Set current time for initial time-of-arrival
 
 	if (notebit != 0)
 	{ // Here, a notification is requested.  Add first instance of notification  
-		pnotex = (struct CANNOTIFYLIST*)calloc(1, sizeof(struct CANNOTIFYLIST));
-		if (pnotex == NULL){ taskEXIT_CRITICAL();morse_trap(31);}//return NULL;}
-
-		pmbx->pnote       = pnotex;    // Mailbox points to first notification
-		pnotex->pnext     = pnotex;	 // Last on list points to self
-		pnotex->tskhandle = tskhandle; // Task to notify
-		pnotex->notebit   = notebit;   // Notification bit to use
-		pnotex->skip      = noteskip;  // Skip notification flag
+		j = noteadd(pmbx, tskhandle, notebit, noteskip);
+		if (j != 0)
+		{ // Pool mailbox not taken
+			memset(pmbx, 0, sizeof(struct MAILBOXCAN));
+			xSemaphoreGive(mbxaddmutex);
+			morse_trap((j == -1) ? 35 : 29);
+		}
 	} 
+	mbxpoolct += 1;
 
-	/* Save pointer to mailbox in array of pointers to mailboxes. */
-	*(mbxcannum[pctl->canidx].pmbxarray+mbxcannum[pctl->canidx].arraysizecur) = pmbx;
+	/* Publish a new sorted table with this mailbox. */
+	tbl_insert(pmbxnum, pmbx);
 
-	/* Advance current size of number of mailboxes for this CAN module. */
-	    mbxcannum[pctl->canidx].arraysizecur += 1;
-	if (mbxcannum[pctl->canidx].arraysizecur 
-                             >=
-		 mbxcannum[pctl->canidx].arraysizemax)
-	{ // Here, the next addition will exceed size calloc'ed earlier!
-		{taskEXIT_CRITICAL();morse_trap(31);} // Bozo programmer. We gotcha.
+	xSemaphoreGive(mbxaddmutex);
+	return pmbx;
+}
+/* *************************************************************************
+ * struct MBXFAMILY* MailboxTask_add_family(struct CAN_CTLBLOCK* pctl,\
+		 uint32_t match,\
+		 uint32_t mask,\
+		 uint16_t poolsize,\
+       osThreadId tskhandle,\
+		 uint32_t notebit,\
+		 uint8_t noteskip,\
+		 uint8_t paytype);
+ *	@brief	: Add mailboxes for a CAN id family: ids with (id & mask) == match
+ * @param	: pctl = Pointer to CAN control block, i.e. CAN module/CAN bus, for mailbox
+ * @param	: match = CAN id bits that must match
+ * @param	: mask = CAN id bits compared
+ * @param	: poolsize = max number of members (mailboxes preallocated)
+ * @param	: tskhandle = Task handle; NULL for use current task; 
+ * @param	: notebit = notification bit; NULL = no notification
+ * @paran	: noteskip = notify = 0; skip notification = 1;
+ * @param	: paytype = payload type code for all members
+ * @return	: Pointer to family (traps if a pool or the sorted table is used up)
+ * *************************************************************************/
+/*
+The family is "compiled" into 'pfamidx': one byte for each value of the 
+top 11 bits of the id (the 11b id, or the high bits of a 29b id), with a
+bit set for each family that the id could match.  Most ids not in a family
+are rejected with one table read, and the candidates are checked with one
+mask compare each.
+
+The family and 'poolsize' member mailboxes come from the fixed pools.
+'poolsize' slots in the sorted mailbox arrays are held for the members,
+so 'MailboxTask_add_CANlist' arraysize must allow for them.
+*/
+struct MBXFAMILY* MailboxTask_add_family(struct CAN_CTLBLOCK* pctl,\
+		 uint32_t match,\
+		 uint32_t mask,\
+		 uint16_t poolsize,\
+       osThreadId tskhandle,\
+		 uint32_t notebit,\
+		 uint8_t noteskip,\
+		 uint8_t paytype)
+{
+	struct MAILBOXCANNUM* pmbxnum;
+	struct MBXFAMILY* pfam;
+	uint32_t b;
+	int i;
+
+	if (pctl  == NULL) morse_trap(26); 
+	if (pctl->canidx >= STM32MAXCANNUM) morse_trap(27);       
+	if (mbxcannum[pctl->canidx].pctl == NULL) morse_trap(28); 
+	if ((mask == 0) || (poolsize == 0)) morse_trap(40);
+	if ((match & ~mask) != 0) morse_trap(40); // Match bits outside mask
+
+	if (tskhandle == NULL)
+		tskhandle = xTaskGetCurrentTaskHandle();
+
+	pmbxnum = &mbxcannum[pctl->canidx];
+
+	xSemaphoreTake(mbxaddmutex, portMAX_DELAY);
+
+	/* The candidate table is allocated with the first family. */
+	if (pmbxnum->pfamidx == NULL)
+	{
+		pmbxnum->pfamidx = (uint8_t*)calloc(MBXFAMIDXSZ, sizeof(uint8_t));
+		if (pmbxnum->pfamidx == NULL) {xSemaphoreGive(mbxaddmutex); morse_trap(41);}
+	}
+	if ((pmbxnum->famct >= MBXFAMMAX) || (fampoolct >= MBXFAMPOOLSIZE))
+	{ // MBXFAMMAX or MBXFAMPOOLSIZE too small
+		xSemaphoreGive(mbxaddmutex); morse_trap(42);
+	}
+	if ((mbxpoolct + poolsize) > MBXPOOLSIZE)
+	{ // MBXPOOLSIZE too small
+		xSemaphoreGive(mbxaddmutex); morse_trap(33);
+	}
+	if ((pmbxnum->ptbl->n + pmbxnum->reserved + poolsize) >= pmbxnum->arraysizemax)
+	{ // Sorted arrays too small for members
+		xSemaphoreGive(mbxaddmutex); morse_trap(43);
 	}
-// TODO: Sort pointers for new Mailbox if later binary lookup on CAN ID.
 
-taskEXIT_CRITICAL();
+	/* Get the family and its member mailboxes. */
+	pfam = &fampool[fampoolct];
+	pfam->ppool    = &mbxpool[mbxpoolct];
+	pfam->match    = match;
+	pfam->mask     = mask;
+	pfam->poolsize = poolsize;
+	pfam->paytype  = paytype;
+
+	/* Shared notification block */
+	if (notebit != 0)
+	{
+		i = notetask_idx(tskhandle);
+		if (i < 0)
+		{ // MBXNOTETASKMAX too small
+			memset(pfam, 0, sizeof(struct MBXFAMILY));
+			xSemaphoreGive(mbxaddmutex);
+			morse_trap(35);
+		}
+		pfam->note.tskhandle = tskhandle;
+		pfam->note.notebit   = notebit;
+		pfam->note.tidx      = i;
+		pfam->note.skip      = noteskip;
+	}
+	fampoolct += 1;
+	mbxpoolct += poolsize;
+	pmbxnum->reserved += poolsize;
+
+	/* Family is complete before 'family_member' can find it. */
+	pmbxnum->pfam[pmbxnum->famct] = pfam;
+	__DMB();
+
+	/* Mark the family as a candidate for each top 11 bits it could match. */
+	for (b = 0; b < MBXFAMIDXSZ; b++)
+	{
+		if ((((b << 21) ^ match) & mask & 0xFFE00000) == 0)
+			*(pmbxnum->pfamidx + b) |= (1 << pmbxnum->famct);
+	}
+	pmbxnum->famct += 1;
+
+	xSemaphoreGive(mbxaddmutex);
+	return pfam;
+}
+/* *************************************************************************
+ * static struct MAILBOXCAN* family_member(struct MAILBOXCANNUM* pmbxnum, uint32_t canid);
+ *	@brief	: Create a mailbox for an id not in the list, if it is in a family
+ * @param	: pmbxnum = pointer to mailbox control block
+ * @param	: canid = CAN ID of received msg
+ * @return	: pointer to new mailbox; NULL = not in a family, or pool used up
+ * *************************************************************************/
+/*
+The member is inserted in the sorted arrays, so the next msg with this id
+is found by the binary search in 'lookup'.  MailboxTask does not wait for
+a registration in progress: the member is made with a later msg.
+*/
+static struct MAILBOXCAN* family_member(struct MAILBOXCANNUM* pmbxnum, uint32_t canid)
+{
+	struct MBXFAMILY* pfam = NULL;
+	struct MAILBOXCAN* pmbx;
+	uint32_t bits;
+	int f;
+
+	if (pmbxnum->pfamidx == NULL) return NULL; // No families
+
+	/* Candidate families for the top 11 bits of the id. */
+	bits = *(pmbxnum->pfamidx + (canid >> 21));
+	for (f = 0; bits != 0; f++, bits >>= 1)
+	{
+		if ((bits & 1) == 0) continue;
+		if ((canid & pmbxnum->pfam[f]->mask) == pmbxnum->pfam[f]->match)
+		{
+			pfam = pmbxnum->pfam[f];
+			break;
+		}
+	}
+	if (pfam == NULL) return NULL; // Not in a family
+
+	if ((pfam->ct >= pfam->poolsize) || (xSemaphoreTake(mbxaddmutex, 0) != pdPASS))
+	{ // Here, the pool is used up, or a registration is in progress
+		pfam->overct += 1;
+		return NULL;
+	}
+
+	/* Initialize the next mailbox in the pool. */
+	pmbx = pfam->ppool + pfam->ct;
+	pmbx->paytype     = pfam->paytype;
+	pmbx->ncan.can.id = canid;
+	pmbx->ncan.toa    = DTWTIME;
+	pmbx->pnote       = &pfam->note; // Shared notification block
+	if (pfam->note.notebit != 0)
+		pmbx->notect  = 1;
+
+	pmbxnum->reserved -= 1;
+	tbl_insert(pmbxnum, pmbx);
+
+	xSemaphoreGive(mbxaddmutex);
+
+	pfam->ct += 1; // Member is complete
 	return pmbx;
 }
 /* *************************************************************************
- * struct CANRCVBUFN* Mailboxgetbuf(int i);
- * @brief	: Get NCAN buffer from Mailbox circular buffer
- * @param	: i = index for CAN unit (0, 1)\
- * @return  : NULL = none available; otherwise, points to NCAN msg
+ * static void tbl_insert(struct MAILBOXCANNUM* pmbxnum, struct MAILBOXCAN* pmbx);
+ *	@brief	: Publish a new lookup table with a mailbox added
+ * @param	: pmbxnum = pointer to mailbox control block
+ * @param	: pmbx = pointer to mailbox (CAN id set)
+ * NOTE: Call holding 'mbxaddmutex'.
  * *************************************************************************/
-#ifdef GATEWAYTASKINCLUDED
-struct CANRCVBUFN* Mailboxgetbuf(int i)
+/*
+RCU style: the spare table is filled with a copy of the published table 
+plus the new entry, then published with one pointer store.  MailboxTask 
+reads 'ptbl' afresh for each msg and holds no table pointer when it goes
+back to its wait, where it bumps 'mbxqsct'.  The table replaced is not 
+written again until MailboxTask has passed its wait at least once.  
+
+A writer needing the spare nudges MailboxTask (MBXNOTEBITQS) and sleeps a 
+tick at a time.  No waiting is needed before the scheduler runs, or when
+MailboxTask is the writer ('family_member').
+*/
+static void tbl_insert(struct MAILBOXCANNUM* pmbxnum, struct MAILBOXCAN* pmbx)
 {
-	struct CANRCVBUFN* ptmp;
+	struct MBXTABLE* pold = pmbxnum->ptbl;
+	struct MBXTABLE* pnew = (pold == &pmbxnum->tbl[0]) ? &pmbxnum->tbl[1] : &pmbxnum->tbl[0];
+	uint32_t canid = pmbx->ncan.can.id;
+	int j;
+	int k;
 
+	/* Wait until MailboxTask is done with the spare table. */
+	if ((pmbxnum->retirewait != 0) &&
+		 (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) &&
+		 (xTaskGetCurrentTaskHandle() != MailboxTaskHandle))
+	{
+		while (mbxqsct == pmbxnum->retireqs)
+		{
+			xTaskNotify(MailboxTaskHandle, MBXNOTEBITQS, eSetBits);
+			osDelay(1);
+		}
+	}
+
+	/* Copy with a slot opened at 'j' so both arrays stay sorted by CAN id */
+	j = lowerbound(pold, canid);
+	for (k = 0; k < j; k++)
+	{
+		*(pnew->pmbxarray + k) = *(pold->pmbxarray + k);
+		*(pnew->pidarray  + k) = *(pold->pidarray  + k);
+	}
+	*(pnew->pmbxarray + j) = pmbx;
+	*(pnew->pidarray  + j) = canid;
+	for (k = j; k < pold->n; k++)
+	{
+		*(pnew->pmbxarray + k + 1) = *(pold->pmbxarray + k);
+		*(pnew->pidarray  + k + 1) = *(pold->pidarray  + k);
+	}
+	pnew->n = pold->n + 1;
+
+	/* Publish */
+	__DMB();
+	pmbxnum->ptbl = pnew;
+	__DMB();
+	pmbxnum->retireqs   = mbxqsct;
+	pmbxnum->retirewait = 1;
+	return;
+}
+/* *************************************************************************
+ * void MailboxTask_set_age(struct MAILBOXCAN* pmbx, uint32_t period, uint32_t maxage, uint32_t stalebit);
+ * @brief	: Set expected period and max age for staleness checking
+ * @param	: pmbx = pointer to mailbox
+ * @param	: period = expected msg period (ms)
+ * @param	: maxage = max age (ms) before stale; 0 = MBXSTALEPERIODS * period
+ * @param	: stalebit = notification bit sent to the mailbox subscribers when it goes stale; 0 = none
+ * *************************************************************************/
+void MailboxTask_set_age(struct MAILBOXCAN* pmbx, uint32_t period, uint32_t maxage, uint32_t stalebit)
+{
+	uint32_t dtwms = SystemCoreClock/1000; // DTW ticks per ms
+
+	if (pmbx == NULL) morse_trap(36);
+	if (maxage == 0) maxage = period * MBXSTALEPERIODS;
+	if (maxage > MBXMAXAGEMS) morse_trap(37); // DTW wrap would fool the age check
+
+taskENTER_CRITICAL();
+	pmbx->period   = period * dtwms;
+	pmbx->maxage   = maxage * dtwms;
+	pmbx->stalebit = stalebit;
+	/* No msg yet: start the age from now, not from when the mailbox was added. */
+	if (pmbx->ctr == 0)
+		pmbx->ncan.toa = DTWTIME;
+taskEXIT_CRITICAL();
+	return;
+}
+/* *************************************************************************
+ * uint32_t MailboxTask_age(struct MAILBOXCAN* pmbx);
+ * @brief	: Age of the last msg received (or mailbox creation if none)
+ * @param	: pmbx = pointer to mailbox
+ * @return	: DTW ticks since arrival; MBXAGESTALE = marked stale (age unknown)
+ * *************************************************************************/
+/*
+'toa' is a single word so no seqlock is needed.  The unsigned difference
+is good across the DTW wrap.  The hardware time stamp (TTCM) can put 'toa' 
+a bit ahead of a DTWTIME read, which shows up as a "negative" age.
+*/
+uint32_t MailboxTask_age(struct MAILBOXCAN* pmbx)
+{
+	uint32_t age;
+
+	if (pmbx->stale != 0) return MBXAGESTALE;
+	age = DTWTIME - pmbx->ncan.toa;
+	if ((int32_t)age < 0) return 0; // Arrival time just ahead of 'now'
+	return age;
+}
+/* *************************************************************************
+ * int MailboxTask_fresh(struct MAILBOXCAN* pmbx);
+ * @brief	: Check mailbox freshness
+ * @param	: pmbx = pointer to mailbox
+ * @return	: 1 = fresh (or no max age set); 0 = stale
+ * *************************************************************************/
+/*
+The age is checked here too, so a reading that went stale since the last
+sweep is caught.  Only the sweep (in MailboxTask) sets the 'stale' flag.
+*/
+int MailboxTask_fresh(struct MAILBOXCAN* pmbx)
+{
+	uint32_t age = MailboxTask_age(pmbx);
+
+	if (age == MBXAGESTALE) return 0;
+	if ((pmbx->maxage != 0) && (age > pmbx->maxage)) return 0;
+	return 1;
+}
+/* *************************************************************************
+ * struct MBXHIST* MailboxTask_add_hist(struct MAILBOXCAN* pmbx, uint16_t depth, uint8_t fld);
+ * @brief	: Keep a history of the last 'depth' readings of one payload field
+ * @param	: pmbx = pointer to mailbox
+ * @param	: depth = number of samples (>= 2)
+ * @param	: fld = payload field index (see 'paydesc.c' for the payload type)
+ * @return	: pointer to history struct
+ * *************************************************************************/
+struct MBXHIST* MailboxTask_add_hist(struct MAILBOXCAN* pmbx, uint16_t depth, uint8_t fld)
+{
+	struct MBXHIST* phist;
+
+	if (pmbx == NULL) morse_trap(38);
+	if (pmbx->phist != NULL) morse_trap(38); // Only one history per mailbox
+
+	phist = (struct MBXHIST*)calloc(1, sizeof(struct MBXHIST));
+	if (phist == NULL) morse_trap(39);
+	if (mbxhist_init(phist, depth, fld) != 0) morse_trap(39);
+
+	/* Ready before 'loadmbx' can see it. */
+	__DMB();
+	pmbx->phist = phist;
+	return phist;
+}
+/* *************************************************************************
+ * int MailboxTask_hist_get(struct MAILBOXCAN* pmbx, struct MBXHISTVAL* pv, uint16_t k);
+ * @brief	: Get consistent window results from a mailbox history
+ * @param	: pmbx = pointer to mailbox
+ * @param	: pv = pointer to struct for results (see 'mbxhist.h')
+ * @param	: k = samples back for the derivative (1 - depth-1)
+ * @return	: 0 = OK; -1 = no history or no samples; -2 = gave up after MBXREADRETRY tries
+ * *************************************************************************/
+/*
+'loadmbx' adds to the history inside the mailbox seqlock, so the window 
+results are computed the same way 'MailboxTask_read' copies.
+*/
+int MailboxTask_hist_get(struct MAILBOXCAN* pmbx, struct MBXHISTVAL* pv, uint16_t k)
+{
+	uint32_t dtwpersec = SystemCoreClock;
+	uint32_t seq;
+	int ret;
+	int i;
+
+	if (pmbx->phist == NULL) return -1;
+
+	for (i = 0; i < MBXREADRETRY; i++)
+	{
+		seq = pmbx->seq;
+		if ((seq & 1) != 0)
+		{ // Here, update in progress
+			if (i < MBXREADYIELDS)
+			{
+				taskYIELD();
+			}
+			else
+			{
+				osDelay(1);
+			}
+			continue;
+		}
+		__DMB();
+		ret = mbxhist_val(pmbx->phist, pv, k, dtwpersec);
+		__DMB();
+		if (pmbx->seq == seq) return ret; // Not changed during computation
+	}
+	return -2;
+}
+/* *************************************************************************
+ * int MailboxTask_read(struct MAILBOXCAN* pmbx, struct MAILBOXCAN* pcopy);
+ * @brief	: Copy a mailbox without a torn (half updated) CAN msg or readings
+ * @param	: pmbx = pointer to mailbox
+ * @param	: pcopy = pointer to mailbox struct to receive the copy
+ * @return	: 0 = OK; -1 = gave up after MBXREADRETRY tries (copy may be inconsistent)
+ * *************************************************************************/
+/*
+Seqlock: 'loadmbx' makes 'seq' odd before it changes the mailbox and even
+again after.  The copy is good if 'seq' was even and unchanged across the copy.
+The writer never waits, so MailboxTask needs no critical section.
+
+A reader with a higher priority than MailboxTask that interrupted an update
+would find 'seq' odd every time, so after a couple of yields it delays a tick
+to let MailboxTask finish.
+*/
+int MailboxTask_read(struct MAILBOXCAN* pmbx, struct MAILBOXCAN* pcopy)
+{
+	uint32_t seq;
+	int i;
+
+	for (i = 0; i < MBXREADRETRY; i++)
+	{
+		seq = pmbx->seq;
+		if ((seq & 1) != 0)
+		{ // Here, update in progress
+			if (i < MBXREADYIELDS)
+			{ // Let an equal priority MailboxTask finish
+				taskYIELD();
+			}
+			else
+			{ // Let a lower priority MailboxTask finish
+				osDelay(1);
+			}
+			continue;
+		}
+		__DMB();
+		*pcopy = *pmbx;
+		__DMB();
+		if (pmbx->seq == seq) return 0; // Not changed during copy
+	}
+	*pcopy = *pmbx; // Best we could do
+	return -1;
+}
+/* *************************************************************************
+ * int MailboxTask_snap_init(struct MBXSNAP* ps, struct MAILBOXCAN** ppmbx, uint8_t n);
+ * @brief	: Declare a set of mailboxes for 'MailboxTask_snap'
+ * @param	: ps = pointer to snapshot struct
+ * @param	: ppmbx = array of mailbox pointers [n] (copied; NULL entries allowed)
+ * @param	: n = number of mailboxes in set
+ * @return	: 0 = OK; -1 = calloc failed
+ * *************************************************************************/
+int MailboxTask_snap_init(struct MBXSNAP* ps, struct MAILBOXCAN** ppmbx, uint8_t n)
+{
+	int i;
+
+	ps->ppmbx = (struct MAILBOXCAN**)calloc(n, sizeof(struct MAILBOXCAN*));
+	ps->pcopy = (struct MAILBOXCAN*)calloc(n, sizeof(struct MAILBOXCAN));
+	if ((ps->ppmbx == NULL) || (ps->pcopy == NULL)) return -1;
+
+	for (i = 0; i < n; i++)
+		ps->ppmbx[i] = ppmbx[i];
+	ps->epoch = 0;
+	ps->redo  = 0;
+	ps->n     = n;
+	return 0;
+}
+/* *************************************************************************
+ * int MailboxTask_snap(struct MBXSNAP* ps);
+ * @brief	: Copy the set of mailboxes, all as of the same MailboxTask batch
+ * @param	: ps = pointer to snapshot struct (copies in 'ps->pcopy[]')
+ * @return	: 0 = OK; -1 = gave up after MBXREADRETRY tries (copies not to be used)
+ * *************************************************************************/
+/*
+The same seqlock as 'MailboxTask_read', but on 'mbxepoch', which MailboxTask
+makes odd for a whole batch (all CAN modules, and the staleness sweep).  The
+copies are good if 'mbxepoch' was even and unchanged across all of them, so
+no copy is older or newer than another.  The cost is 'n' mailbox copies. 
+*/
+int MailboxTask_snap(struct MBXSNAP* ps)
+{
+	uint32_t epoch;
+	int i;
+	int j;
+
+	for (i = 0; i < MBXREADRETRY; i++)
+	{
+		epoch = mbxepoch;
+		if ((epoch & 1) != 0)
+		{ // Here, batch in progress
+			if (i < MBXREADYIELDS)
+			{ // Let an equal priority MailboxTask finish
+				taskYIELD();
+			}
+			else
+			{ // Let a lower priority MailboxTask finish
+				osDelay(1);
+			}
+			continue;
+		}
+		__DMB();
+		for (j = 0; j < ps->n; j++)
+		{
+			if (ps->ppmbx[j] != NULL)
+				ps->pcopy[j] = *ps->ppmbx[j];
+		}
+		__DMB();
+		if (mbxepoch == epoch)
+		{ // Not changed during copies
+			ps->epoch = epoch;
+			return 0;
+		}
+		ps->redo += 1;
+	}
+	return -1; // Copies may be torn, or from different batches: not to be used
+}
+/* *************************************************************************
+ * struct MBXGATE* MailboxTask_gate(int i);
+ * @brief	: Get the handoff for a CAN unit (counters, policy)
+ * @param	: i = index for CAN unit (0, 1)
+ * @return  : pointer to handoff; NULL = not setup
+ * *************************************************************************/
+#ifdef GATEWAYTASKINCLUDED
+struct MBXGATE* MailboxTask_gate(int i)
+{
 	/* JIC: do not exceed setup indices. */
 	if ((i != 0) 
 	#ifdef CONFIGCAN2 
@@ -276,28 +807,46 @@ struct CANRCVBUFN* Mailboxgetbuf(int i)
 	#endif 
 		) return NULL;
 
-	if (mbxgatebuf[i].ptake == mbxgatebuf[i].padd) 
-		return NULL;
-
-	ptmp = mbxgatebuf[i].ptake++;
-	if (mbxgatebuf[i].ptake == mbxgatebuf[i].pend) 
-		mbxgatebuf[i].ptake = mbxgatebuf[i].pbegin;
-	return ptmp;
+	if (mbxgate[i].pslot == NULL) return NULL;
+	return &mbxgate[i];
+}
+/* *************************************************************************
+ * int MailboxTask_gate_get(int i, struct CANRCVBUFN* pncan);
+ * @brief	: Take the next CAN msg handed off to GatewayTask
+ * @param	: i = index for CAN unit (0, 1)
+ * @param	: pncan = pointer to where the NCAN msg is copied
+ * @return  : 1 = msg copied; 0 = none available
+ * *************************************************************************/
+int MailboxTask_gate_get(int i, struct CANRCVBUFN* pncan)
+{
+	struct MBXGATE* p = MailboxTask_gate(i);
+	if (p == NULL) return 0;
+	return mbxgate_get(p, pncan);
+}
+/* *************************************************************************
+ * int MailboxTask_gate_policy(int i, uint8_t policy);
+ * @brief	: Change the policy used when GatewayTask falls behind
+ * @param	: i = index for CAN unit (0, 1)
+ * @param	: policy = MBXGATE_DROPNEWEST, MBXGATE_DROPOLDEST, MBXGATE_COALESCE
+ * @return  : 0 = OK; -1 = bad index or policy
+ * *************************************************************************/
+int MailboxTask_gate_policy(int i, uint8_t policy)
+{
+	struct MBXGATE* p = MailboxTask_gate(i);
+	if ((p == NULL) || (policy > MBXGATE_COALESCE)) return -1;
+	p->policy = policy; // Only 'MailboxTask' reads it
+	return 0;
 }
 #endif
 /* *************************************************************************
- * static void gatebufsetup(struct CANTAKEPTR* p);
- * @brief	: Allocate array for CAN msgs to be passed to GatewayTask
- * @param	: p = pointer to pointer struct for managing circular buffer
+ * static void gatebufsetup(struct MBXGATE* p);
+ * @brief	: Allocate handoff ring for CAN msgs to be passed to GatewayTask
+ * @param	: p = pointer to handoff struct
  * *************************************************************************/
 #ifdef GATEWAYTASKINCLUDED
- static void gatebufsetup(struct MBXTOGATEBUF* p)
+ static void gatebufsetup(struct MBXGATE* p)
  {
-	p->padd = (struct CANRCVBUFN*)calloc(GATEWAYBUFSIZE, sizeof(struct CANRCVBUFN));
-	if (p->padd == NULL) morse_trap(341);
-	p->ptake  = p->padd;
-	p->pbegin = p->padd;
-	p->pend   = p->padd + GATEWAYBUFSIZE;
+	if (mbxgate_init(p, GATEWAYBUFSIZE, GATEWAYPOLICY) != 0) morse_trap(341);
 	return;
  }
 #endif
@@ -309,6 +858,10 @@ struct CANRCVBUFN* Mailboxgetbuf(int i)
  * *************************************************************************/
 osThreadId xMailboxTaskCreate(uint32_t taskpriority)
 {
+	/* Registrations take this; MailboxTask only tries it. */
+	mbxaddmutex = xSemaphoreCreateMutex();
+	if (mbxaddmutex == NULL) morse_trap(44);
+
  /* definition and creation of CanTask */
   osThreadDef(MailboxTask, StartMailboxTask, osPriorityNormal, 0,(192-32));
 
@@ -317,9 +870,9 @@ osThreadId xMailboxTaskCreate(uint32_t taskpriority)
 	vTaskPrioritySet( MailboxTaskHandle, taskpriority );
 
 #ifdef GATEWAYTASKINCLUDED
-	gatebufsetup(&mbxgatebuf[0]); // CAN1
+	gatebufsetup(&mbxgate[0]); // CAN1
   #ifdef CONFIGCAN2 // CAN2 setup
-	gatebufsetup(&mbxgatebuf[1]); // CAN2
+	gatebufsetup(&mbxgate[1]); // CAN2
   #endif
 #endif
 
@@ -342,7 +895,7 @@ void StartMailboxTask(void const * argument)
 	/* Get circular buffer pointers for each CAN module in list. */	
 	for (i = 0; i < STM32MAXCANNUM; i++)
 	{
-		if (mbxcannum[i].pmbxarray != NULL)
+		if (mbxcannum[i].ptbl != NULL)
 		{ // Here, array of pointers was initialized
 			ptake[i] = can_iface_mbx_init(mbxcannum[i].pctl, NULL, (1 << i));
 			if (ptake[i] == NULL) morse_trap(22);
@@ -355,13 +908,25 @@ void StartMailboxTask(void const * argument)
 	/* notification bits processed after a 'Wait. */
 	uint32_t noteused = 0;
 
+	/* Time of last staleness sweep. */
+	TickType_t sweeptick = xTaskGetTickCount();
+
   /* Infinite MailboxTask loop */
   for(;;)
   {
 		/* Wait for a CAN module to load its circular buffer. */
 		/* The notification bit identifies the CAN module. */
-		xTaskNotifyWait(noteused, 0, &noteval, portMAX_DELAY);
-		noteused = 0;	// Accumulate bits in 'noteval' processed.
+		/* Time out for the staleness sweep when the CAN buses are quiet. */
+		noteval = 0;
+		xTaskNotifyWait(noteused, 0, &noteval, MBXSWEEPTICKS);
+		noteused = MBXNOTEBITQS; // Accumulate bits in 'noteval' processed.
+
+		/* No lookup table pointer is held here (see 'tbl_insert'). */
+		mbxqsct += 1;
+
+		/* Mailboxes change from here until 'mbxepoch' is even again. */
+		mbxepoch += 1;
+		__DMB();
 
 		/* Step through possible notification bits */
 		for (i = 0; i < STM32MAXCANNUM; i++)
@@ -390,9 +955,8 @@ if (pmbxnum == NULL) morse_trap(77); // Debug trap
 						#endif 
 							)							
 						{
-							*mbxgatebuf[i].padd++ = *pncan; // Save CAN msg for gateway task.
-							if (mbxgatebuf[i].padd == mbxgatebuf[i].pend) 
-								mbxgatebuf[i].padd  = mbxgatebuf[i].pbegin;
+							/* Save CAN msg for gateway task; counted if it can't keep up. */
+							mbxgate_put(&mbxgate[i], pncan);
 						}
 				#endif
 					}
@@ -407,38 +971,159 @@ if (pmbxnum == NULL) morse_trap(77); // Debug trap
   #endif
 			}
 		}
+		/* Mark mailboxes that have gone stale. */
+		if ((TickType_t)(xTaskGetTickCount() - sweeptick) >= MBXSWEEPTICKS)
+		{
+			sweeptick = xTaskGetTickCount();
+			stale_sweep();
+		}
+
+		/* Batch loaded: snapshots see all of it, or none (see 'MailboxTask_snap'). */
+		__DMB();
+		mbxepoch += 1;
+
+		/* One notification for each task with mailbox updates in this batch. */
+		notify_flush();
   }
 }
 /* *************************************************************************
- * static struct MAILBOXCAN* lookup(struct MAILBOXCANNUM* pmbxnum, struct CANRCVBUFN* pncan);
- *	@brief	: (Bonehead) Lookup CAN ID by a straight pass down the array of mailbox pointers
- * @param	: pmbxnum = pointer to mailbox control block
- * @param	: pncan = pointer to CAN msg in can_face.c circular buffer
+ * static void stale_sweep(void);
+ *	@brief	: Mark mailboxes older than their max age stale, and notify
  * *************************************************************************/
-struct MAILBOXCAN** dbgppmbx;
-struct MAILBOXCAN*   dbgpmbx;
-int dbgi;
+/*
+The sweep runs every MBXSWEEPTICKS, much less than the DTW wrap, so a
+mailbox is marked before its age wraps.  Once marked, the age no longer 
+matters until the next msg clears the flag in 'loadmbx'.  The stale bit
+is merged with the other notifications for the batch.
+*/
+static void stale_sweep(void)
+{
+	struct MAILBOXCANNUM* pmbxnum = &mbxcannum[0];
+	struct MBXTABLE* ptbl;
+	struct MAILBOXCAN* pmbx;
+	struct CANNOTIFYLIST* pnotetmp;
+	uint32_t now = DTWTIME;
+	int32_t age;
+	int i;
+	int j;
+	int k;
+	int n;
+
+	for (i = 0; i < STM32MAXCANNUM; i++, pmbxnum++)
+	{
+		ptbl = pmbxnum->ptbl;
+		if (ptbl == NULL) continue;
+		for (j = 0; j < ptbl->n; j++)
+		{
+			pmbx = *(ptbl->pmbxarray + j);
+			if ((pmbx->maxage == 0) || (pmbx->stale != 0)) continue;
+
+			age = (int32_t)(now - pmbx->ncan.toa);
+			if (age <= (int32_t)pmbx->maxage) continue; // Fresh (or 'toa' ahead of 'now')
 
-static struct MAILBOXCAN* lookup(struct MAILBOXCANNUM* pmbxnum, struct CANRCVBUFN* pncan)
+			pmbx->stale = 1;
+			if (pmbx->stalebit == 0) continue;
+
+			n = pmbx->notect; // Read count before pointer (see 'noteadd')
+			__DMB();
+			pnotetmp = pmbx->pnote;
+			for (k = 0; k < n; k++, pnotetmp++)
+			{
+				if (pnotetmp->skip == 0)
+				{
+					notetask[pnotetmp->tidx].bits |= pmbx->stalebit;
+					notebatchhits += 1;
+					mbxnotestats.hits += 1;
+				}
+			}
+		}
+	}
+	return;
+}
+/* *************************************************************************
+ * static void notify_flush(void);
+ *	@brief	: Notify each task that has bits accumulated, then clear them
+ * *************************************************************************/
+/*
+'loadmbx' only ORs the subscriber's bit into the task's accumulated bits.
+A burst of CAN msgs for one task (e.g. DMOC msgs for GevcuTask) then costs
+one xTaskNotify, and at most one wakeup of that task, for the whole batch.
+*/
+static void notify_flush(void)
 {
-	struct MAILBOXCAN** ppmbx;
-	struct MAILBOXCAN*   pmbx;
+	struct MBXNOTETASK* pnt = &notetask[0];
 	int i;
 
-	ppmbx = pmbxnum->pmbxarray;
-dbgppmbx = ppmbx;
-dbgi = pmbxnum->arraysizecur;
-	for (i = 0; i < pmbxnum->arraysizecur; i++)
+	if (notebatchhits == 0) return;
+
+	for (i = 0; i < notetaskct; i++, pnt++)
 	{
-		pmbx = *(ppmbx + i); // Point to mailbox[i]
-dbgpmbx = pmbx;
-		if (pmbx->ncan.can.id == pncan->can.id)
-		{ // Here, found!
-			pmbx->ncan = *pncan; // Copy CAN msg to mailbox
-			return pmbx;
+		if (pnt->bits != 0)
+		{
+			xTaskNotify(pnt->tskhandle, pnt->bits, eSetBits);
+			pnt->bits = 0;
+			mbxnotestats.calls += 1;
 		}
 	}
-	return NULL;
+	mbxnotestats.batches += 1;
+	if (mbxnotestats.hitsmax < notebatchhits)
+		mbxnotestats.hitsmax = notebatchhits;
+	notebatchhits = 0;
+	return;
+}
+/* *************************************************************************
+ * static int lowerbound(struct MBXTABLE* ptbl, uint32_t canid);
+ *	@brief	: Binary search of sorted CAN id array
+ * @param	: ptbl = pointer to lookup table
+ * @param	: canid = CAN ID
+ * @return	: index of first id >= canid (n if none)
+ * *************************************************************************/
+static int lowerbound(struct MBXTABLE* ptbl, uint32_t canid)
+{
+	uint32_t* pid = ptbl->pidarray;
+	int lo = 0;
+	int hi = ptbl->n;
+	int mid;
+
+	while (lo < hi)
+	{
+		mid = (lo + hi) >> 1;
+		if (*(pid + mid) < canid)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+/* *************************************************************************
+ * static struct MAILBOXCAN* lookup(struct MAILBOXCANNUM* pmbxnum, uint32_t canid);
+ *	@brief	: Lookup CAN ID with binary search of the sorted id array
+ * @param	: pmbxnum = pointer to mailbox control block
+ * @param	: canid = CAN ID of received msg
+ * @return	: pointer to mailbox; NULL = not in list
+ * *************************************************************************/
+/*
+Most of the bus traffic has no mailbox, so ids outside the range of the
+mailbox ids are rejected before the search.
+
+The published table never changes (see 'tbl_insert'), so the search needs
+no locking.
+*/
+static struct MAILBOXCAN* lookup(struct MAILBOXCANNUM* pmbxnum, uint32_t canid)
+{
+	struct MBXTABLE* ptbl = pmbxnum->ptbl;
+	uint32_t* pid = ptbl->pidarray;
+	int n = ptbl->n;
+	int i;
+
+	/* Quick reject */
+	if (n == 0) return NULL;
+	if ((canid < *pid) || (canid > *(pid + n - 1))) return NULL;
+
+	i = lowerbound(ptbl, canid);
+	if ((i >= n) || (*(pid + i) != canid)) return NULL;
+
+	return *(ptbl->pmbxarray + i);
 }
 
 /* ************************************************************************* 
@@ -447,45 +1132,57 @@ dbgpmbx = pmbx;
  * @param	: pmbxnum = pointer to mailbox control block
  * @param	: pncan = pointer to CAN msg in can_face.c circular buffer
  * *************************************************************************/
-uint32_t dbgmbxctr;
-
 static struct MAILBOXCAN* loadmbx(struct MAILBOXCANNUM* pmbxnum, struct CANRCVBUFN* pncan)
 {
 	struct CANNOTIFYLIST* pnotetmp;	
-	struct CANNOTIFYLIST* pnotex;
-//	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+	float fhist;
+	int n;
+	int i;
 
 	/* Check if received CAN id is in the mailbox CAN id list. */
-	// 'lookup' is a straight loop; use 'lookupq' for binary search (when implemented)
-	struct MAILBOXCAN* pmbx = lookup(pmbxnum, pncan);
-	if (pmbx == NULL) return NULL; // Return: CAN id not in mailbox list
+	struct MAILBOXCAN* pmbx = lookup(pmbxnum, pncan->can.id);
+	if (pmbx == NULL)
+	{ // Not in the list; first msg of a family member?
+		pmbx = family_member(pmbxnum, pncan->can.id);
+		if (pmbx == NULL) return NULL; // Return: CAN id not in mailbox list
+	}
 
 	/* Here, this CAN msg has a mailbox. */
-	// Extract payload (above 'lookup' copied ncan into mailbox)
-	payload_extract(pmbx);
+	pmbx->seq += 1; // Odd: readers retry
+	__DMB();
+	pmbx->ncan = *pncan; // Copy CAN msg to mailbox
+
+	// Extract payload
+	if ((payload_extract(pmbx) == 0) && (pmbx->phist != NULL))
+	{ // Add the field reading to the history
+		if (paydesc_field(&pmbx->ncan.can.cd.uc[0], pmbx->ncan.can.dlc, 
+			pmbx->paytype, pmbx->phist->fld, &fhist) == 0)
+		{
+			mbxhist_add(pmbx->phist, pmbx->ncan.toa, fhist);
+		}
+	}
+	__DMB();
+	pmbx->seq += 1; // Even: mailbox is consistent
+	pmbx->stale = 0;
 
-	/* Execute notifications */
-	pnotetmp = pmbx->pnote; // Get ptr to head of linked list
-	if (pnotetmp == NULL) return pmbx; // CANID found, but no notifications
+	/* Accumulate notifications ('notify_flush' sends them) */
+	n = pmbx->notect;       // Read count before pointer (see 'noteadd')
+	__DMB();
+	pnotetmp = pmbx->pnote; // Get ptr to array
+	if (n == 0) return pmbx; // CANID found, but no notifications
 
 	pmbx->ctr += 1; // Count updates
 	
-	// Traverse linked list making notifications
-	do 
+	for (i = 0; i < n; i++, pnotetmp++)
 	{
-		/* Make a notification if "not skip" and 'taskhandle and 'notebit' were setup */
-		if ((pnotetmp->skip == 0) && (pnotetmp->tskhandle != NULL) && (pnotetmp->notebit != 0))
+		/* Make a notification if "not skip" and 'notebit' was setup */
+		if ((pnotetmp->skip == 0) && (pnotetmp->notebit != 0))
 		{
-dbgmbxctr += 1;
-			xTaskNotify(pnotetmp->tskhandle, pnotetmp->notebit, eSetBits);	
+			notetask[pnotetmp->tidx].bits |= pnotetmp->notebit;
+			notebatchhits += 1;
+			mbxnotestats.hits += 1;
 		}
-
-		/* Step to next item in list. */
-			pnotex   = pnotetmp;
-			pnotetmp = pnotetmp->pnext;
-
-	} while (pnotetmp != pnotex);
-
+	}
 	return pmbx;
 }
 
@@ -14,6 +14,8 @@
 #include "malloc.h"
 #include "common_can.h"
 #include "can_iface.h"
+#include "mbxhist.h"
+#include "mbxgate.h"
 
 #define STM32MAXCANNUM 2	// F103 only has one CAN module
 
@@ -22,27 +24,38 @@
 #define MBXNOTEBITCAN1 (1 << 0)	// Notification bit for CAN1 msgs
 #define MBXNOTEBITCAN2 (1 << 1)	// Notification bit for CAN2 msgs
 #define MBXNOTEBITCAN3 (1 << 2)	// Notification bit for CAN3 msgs
+#define MBXNOTEBITQS   (1 << 3)	// Wake up: a registration is waiting for MailboxTask to pass its wait
 
+/* Fixed pools for registrations (see 'MailboxTask_add') */
+#define MBXPOOLSIZE     48 // Mailboxes, all CAN modules, including family members
+#define MBXNOTEPOOLSIZE 48 // Notification blocks
+#define MBXFAMPOOLSIZE   4 // Families, all CAN modules
 
-/* Circular buffer pointers for Mailbox-to-Gateway CAN msgs */
-struct MBXTOGATEBUF
-{
-	struct CANRCVBUFN* pbegin;
-	struct CANRCVBUFN* pend;
-	struct CANRCVBUFN* padd;
-	struct CANRCVBUFN* ptake;
-	struct CANRCVBUFN* pbuf;
-};
 
-/* Notification block for linked list */
+/* Mailbox-to-Gateway CAN msg handoff (see 'mbxgate.h') */
+#define GATEWAYBUFSIZE 16                 // Slots for each CAN module (power of 2)
+#define GATEWAYPOLICY MBXGATE_DROPOLDEST  // Policy when GatewayTask falls behind
+
+#define MBXNOTETASKMAX 8 // Max number of different tasks notified by mailboxes
+
+/* Notification block: one for each subscriber, compact array for each mailbox */
 struct CANNOTIFYLIST
 {
-	struct CANNOTIFYLIST* pnext; // Points to next; Last points to self
-	osThreadId tskhandle;        // Task handle (usually 'MailboxTask')
+	osThreadId tskhandle;        // Task handle
 	uint32_t   notebit;          // Notification bit within task
+	uint8_t tidx;                // Index of task in MailboxTask's accumulated bits table
 	uint8_t skip;                // 0 = notifications enabled; 1 = skip notification
 };
 
+/* Notification counts (see 'loadmbx' and 'notify_flush') */
+struct MBXNOTESTATS
+{
+	uint32_t hits;     // Subscriber notifications due (one per subscriber per CAN msg)
+	uint32_t calls;    // xTaskNotify calls made (one per task per drained batch)
+	uint32_t batches;  // Drained batches with one or more notifications
+	uint32_t hitsmax;  // Max subscriber notifications merged in one batch
+};
+
 /* Combine variable types for payload readings */
 union MAILBOXVALUES
 {
@@ -67,20 +80,76 @@ struct MAILBOXCAN
 {
 	struct CANRCVBUFN ncan;      // CAN msg plus DTW and CAN control block pointer (pctl)
 	struct MAILBOXREADINGS mbx;  // Readings extracted from CAN msg
-	struct CANNOTIFYLIST* pnote; // Pointer to notification block; NULL = none 
+	struct CANNOTIFYLIST* pnote; // Pointer to notification block array; NULL = none 
 	uint32_t ctr;                // Update counter (increment each update)
+	volatile uint32_t seq;       // Seqlock: odd = MailboxTask is updating (see MailboxTask_read)
+	uint32_t period;             // Expected msg period (DTW ticks); 0 = not set
+	uint32_t maxage;             // Max age before stale (DTW ticks); 0 = no staleness check
+	uint32_t stalebit;           // Notification bit to subscribers upon going stale; 0 = none
+	struct MBXHIST* phist;       // Sample history of one payload field; NULL = none
+	volatile uint8_t stale;      // 1 = stale (set by sweep, cleared by next msg)
 	uint8_t paytype;             // Code for payload type
+	uint8_t notect;              // Number of notification blocks in 'pnote' array
+};
+
+/* Staleness (see 'MailboxTask_set_age') */
+#define MBXSWEEPTICKS     32  // Staleness sweep interval (FreeRTOS ticks: 62.5 ms)
+#define MBXSTALEPERIODS    3  // Default max age: number of expected periods
+#define MBXMAXAGEMS    10000  // Max 'maxage' (ms). Ages are good to 2^31 DTW ticks (12.7 s)
+#define MBXAGESTALE 0xFFFFFFFF // 'MailboxTask_age' return for a mailbox marked stale
+
+#define MBXREADRETRY  8 // Max tries for a consistent copy in 'MailboxTask_read'
+#define MBXREADYIELDS 2 // Tries that just yield before delaying a tick for the writer
+
+/* Snapshot: copies of a set of mailboxes all from the same MailboxTask batch */
+struct MBXSNAP
+{
+	struct MAILBOXCAN** ppmbx; // Mailboxes in the set [n] (NULL entries allowed)
+	struct MAILBOXCAN*  pcopy; // Copies [n]
+	uint32_t epoch;            // 'mbxepoch' the copies were made in
+	uint32_t redo;             // Count of sets copied again (a batch was loaded meanwhile)
+	uint8_t n;                 // Number of mailboxes in set
+};
+
+/* CAN id family: one mailbox per id that matches, created on first sight */
+#define MBXFAMMAX    8    // Max number of families for each CAN module
+#define MBXFAMIDXSZ  2048 // Family candidate table size (indexed by id >> 21)
+
+struct MBXFAMILY
+{
+	struct CANNOTIFYLIST note;  // Notification block shared by all members
+	struct MAILBOXCAN* ppool;   // Member mailboxes [poolsize]; [0]-[ct-1] in use
+	uint32_t match;             // Member if: (id & mask) == match
+	uint32_t mask;              // Mask of id bits compared
+	uint32_t overct;            // Count msgs for new members dropped: pool used up (or registration busy)
+	uint16_t poolsize;          // Number of mailboxes preallocated
+	volatile uint16_t ct;       // Number of members created
+	uint8_t paytype;            // Payload type code for members
+};
+
+/* Sorted lookup table. Two for each CAN module: one published, one spare. */
+struct MBXTABLE
+{
+	struct MAILBOXCAN** pmbxarray; // Point to sorted mailbox pointer array[0]
+	uint32_t* pidarray;            // Sorted CAN ids, same order as pmbxarray (compact for lookup)
+	uint16_t n;                    // Number of mailboxes in table
 };
 
 /* One of these for each CAN module. */
 struct MAILBOXCANNUM
 {
 	struct CAN_CTLBLOCK* pctl;     // CAN control block pointer associated with this mailbox list
-	struct MAILBOXCAN** pmbxarray; // Point to sorted mailbox pointer array[0]
+	struct MBXTABLE* volatile ptbl;// Published lookup table; NULL = CAN module not setup
+	struct MBXTABLE tbl[2];        // Lookup tables: 'ptbl' points to one of these
+	uint32_t retireqs;             // MailboxTask pass count when the spare table was retired
+	uint8_t  retirewait;           // 1 = spare table may still be in use by MailboxTask
 	struct CANTAKEPTR* ptake;      // "Take" pointer for can_iface circular buffer
 	uint32_t notebit;              // Notification bit for this CAN module circular buffer
 	uint16_t arraysizemax;         // Mailbox pointer array size that was calloc'd  
-	uint16_t arraysizecur;         // Mailbox pointer array populated count
+	uint16_t reserved;             // Array slots held for family members not yet created
+	uint8_t* pfamidx;              // Candidate family bits [MBXFAMIDXSZ]; NULL = no families
+	struct MBXFAMILY* pfam[MBXFAMMAX]; // Families
+	uint8_t famct;                 // Number of families
 };
 
 /* *************************************************************************/
@@ -104,7 +173,30 @@ struct MAILBOXCAN* MailboxTask_add(struct CAN_CTLBLOCK* pctl,\
  * @param	: notebit = notification bit; NULL = no notification
  * @paran	: noteskip = notify = 0; skip notification = 1;
  * @param	: paytype = payload type code (see 'PAYLOAD_TYPE_INSERT.sql' in 'GliderWinchCommons/embed/svn_common/db')
- * @return	: Pointer to mailbox; NULL = failed
+ * @return	: Pointer to mailbox (never NULL: traps if a pool or the sorted table is used up)
+ * NOTE: Can be called before or after the scheduler starts. Interrupts are not
+ *       disabled; the CAN path is not blocked. Not from MailboxTask.
+ * *************************************************************************/
+struct MBXFAMILY* MailboxTask_add_family(struct CAN_CTLBLOCK* pctl,\
+		 uint32_t match,\
+		 uint32_t mask,\
+		 uint16_t poolsize,\
+       osThreadId tskhandle,\
+		 uint32_t notebit,\
+		 uint8_t noteskip,\
+		 uint8_t paytype);
+/*	@brief	: Add mailboxes for a CAN id family: ids with (id & mask) == match
+ * @param	: pctl = Pointer to CAN control block, i.e. CAN module/CAN bus, for mailbox
+ * @param	: match = CAN id bits that must match
+ * @param	: mask = CAN id bits compared (e.g. 0xFFE00004 for all 11b ids in a range)
+ * @param	: poolsize = max number of members (mailboxes preallocated)
+ * @param	: tskhandle = Task handle; NULL for use current task; 
+ * @param	: notebit = notification bit; NULL = no notification
+ * @paran	: noteskip = notify = 0; skip notification = 1;
+ * @param	: paytype = payload type code for all members
+ * @return	: Pointer to family; members are ppool[0] - ppool[ct-1] (traps if a pool is used up)
+ * NOTE: The notification block is shared, so enable/disable affects the whole family.
+ *       An id with an exact mailbox (MailboxTask_add) does not become a member.
  * *************************************************************************/
 osThreadId xMailboxTaskCreate(uint32_t taskpriority);
 /* @brief	: Create task; task handle created is global for all to enjoy!
@@ -120,14 +212,84 @@ struct CANNOTIFYLIST* MailboxTask_enable_notifications (struct MAILBOXCAN* pmbx)
  * @param	: pmbx = pointer to mailbox
  * @return	: Pointer to notification block, for calling task; NULL = task not found
  * *************************************************************************/
-struct CANRCVBUFN* Mailboxgetbuf(int i);
-/* @brief	: Get NCAN buffer from Mailbox circular buffer
- * @param	: i = index for CAN unit (0, 1)\
- * @return  : NULL = none available; otherwise, points to NCAN msg
+void MailboxTask_set_age(struct MAILBOXCAN* pmbx, uint32_t period, uint32_t maxage, uint32_t stalebit);
+/* @brief	: Set expected period and max age for staleness checking
+ * @param	: pmbx = pointer to mailbox
+ * @param	: period = expected msg period (ms)
+ * @param	: maxage = max age (ms) before stale; 0 = MBXSTALEPERIODS * period
+ * @param	: stalebit = notification bit sent to the mailbox subscribers when it goes stale; 0 = none
+ * NOTE: maxage of zero and period of zero turns staleness checking off.
+ * *************************************************************************/
+uint32_t MailboxTask_age(struct MAILBOXCAN* pmbx);
+/* @brief	: Age of the last msg received (or mailbox creation if none)
+ * @param	: pmbx = pointer to mailbox
+ * @return	: DTW ticks since arrival; MBXAGESTALE = marked stale (age unknown)
+ * NOTE: Without a max age the age is good only to 2^31 DTW ticks (12.7 s).
+ * *************************************************************************/
+int MailboxTask_fresh(struct MAILBOXCAN* pmbx);
+/* @brief	: Check mailbox freshness
+ * @param	: pmbx = pointer to mailbox
+ * @return	: 1 = fresh (or no max age set); 0 = stale
+ * *************************************************************************/
+struct MBXHIST* MailboxTask_add_hist(struct MAILBOXCAN* pmbx, uint16_t depth, uint8_t fld);
+/* @brief	: Keep a history of the last 'depth' readings of one payload field
+ * @param	: pmbx = pointer to mailbox
+ * @param	: depth = number of samples (>= 2)
+ * @param	: fld = payload field index (see 'paydesc.c' for the payload type)
+ * @return	: pointer to history struct
+ * NOTE: This is normally called during startup, after 'MailboxTask_add'.
+ * *************************************************************************/
+int MailboxTask_hist_get(struct MAILBOXCAN* pmbx, struct MBXHISTVAL* pv, uint16_t k);
+/* @brief	: Get consistent window results from a mailbox history
+ * @param	: pmbx = pointer to mailbox
+ * @param	: pv = pointer to struct for results (see 'mbxhist.h')
+ * @param	: k = samples back for the derivative (1 - depth-1)
+ * @return	: 0 = OK; -1 = no history or no samples; -2 = gave up after MBXREADRETRY tries
+ * NOTE: Task context only.
+ * *************************************************************************/
+int MailboxTask_read(struct MAILBOXCAN* pmbx, struct MAILBOXCAN* pcopy);
+/* @brief	: Copy a mailbox without a torn (half updated) CAN msg or readings
+ * @param	: pmbx = pointer to mailbox
+ * @param	: pcopy = pointer to mailbox struct to receive the copy
+ * @return	: 0 = OK; -1 = gave up after MBXREADRETRY tries (copy may be inconsistent)
+ * NOTE: Task context only.
+ * *************************************************************************/
+int MailboxTask_snap_init(struct MBXSNAP* ps, struct MAILBOXCAN** ppmbx, uint8_t n);
+/* @brief	: Declare a set of mailboxes for 'MailboxTask_snap'
+ * @param	: ps = pointer to snapshot struct
+ * @param	: ppmbx = array of mailbox pointers [n] (copied; NULL entries allowed)
+ * @param	: n = number of mailboxes in set
+ * @return	: 0 = OK; -1 = calloc failed
+ * *************************************************************************/
+int MailboxTask_snap(struct MBXSNAP* ps);
+/* @brief	: Copy the set of mailboxes, all as of the same MailboxTask batch
+ * @param	: ps = pointer to snapshot struct (copies in 'ps->pcopy[]')
+ * @return	: 0 = OK; -1 = gave up after MBXREADRETRY tries (copies not to be used)
+ * NOTE: Task context only.
+ * *************************************************************************/
+int MailboxTask_gate_get(int i, struct CANRCVBUFN* pncan);
+/* @brief	: Take the next CAN msg handed off to GatewayTask
+ * @param	: i = index for CAN unit (0, 1)
+ * @param	: pncan = pointer to where the NCAN msg is copied
+ * @return  : 1 = msg copied; 0 = none available
+ * *************************************************************************/
+struct MBXGATE* MailboxTask_gate(int i);
+/* @brief	: Get the handoff for a CAN unit (counters, policy)
+ * @param	: i = index for CAN unit (0, 1)
+ * @return  : pointer to handoff; NULL = not setup
+ * *************************************************************************/
+int MailboxTask_gate_policy(int i, uint8_t policy);
+/* @brief	: Change the policy used when GatewayTask falls behind
+ * @param	: i = index for CAN unit (0, 1)
+ * @param	: policy = MBXGATE_DROPNEWEST, MBXGATE_DROPOLDEST, MBXGATE_COALESCE
+ * @return  : 0 = OK; -1 = bad index or policy
  * *************************************************************************/
 
 extern osThreadId MailboxTaskHandle;
 extern struct MAILBOXCANNUM mbxcannum[STM32MAXCANNUM];
+extern struct MBXNOTESTATS mbxnotestats;
+extern volatile uint32_t mbxqsct;
+extern volatile uint32_t mbxepoch;
 
 #endif
 
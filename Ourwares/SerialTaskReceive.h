@@ -27,17 +27,16 @@ struct CANRCVBUFPLUS
 	uint8_t seq;
 };
 
+#define GATEWAYPCTOCANASC ((1 + 4 + 1 + 8 + 1) * 2) // Ascii/hex chars in longest CAN msg line
+
 struct GATEWAYPCTOCAN
 {
 	struct CANRCVBUFPLUS*	pcanp; // Ptr into buffer for received CAN Plus msg
-	uint32_t chksumx;       // Checksum in progress
+	char asc[GATEWAYPCTOCANASC]; // Ascii/hex chars of line in progress
 	uint8_t binseq;         // Received sequence number (binary)
 	uint8_t ctrseq;			// Software maintained sequence number
-	uint8_t state;          // State of decoding
 	uint8_t error;          // Error code: 0 = no errors
-	uint8_t bin;            // Bin byte in progress
-	uint8_t odd;            // Nibble: Odd = 1, even = 0;
-	uint8_t ctr;            // Data storing counter
+	uint8_t ctr;            // Chars in line (stops at 255)
 };
 
 
@@ -47,6 +47,14 @@ extern CAN_HandleTypeDef hcan2;
 /* subroutine declarations */
 static void loadmbx2(struct CAN_CTLBLOCK* pctl);
 static void moveremove2(struct CAN_CTLBLOCK* pctl);
+#ifdef CANRATELIMITINCLUDED
+static int ratelimit(struct CANRATELIMIT* prate, uint32_t id);
+#endif
+#ifdef CANSTATSINCLUDED
+static void stats_txcomplete(struct CAN_CTLBLOCK* pctl, volatile struct CAN_POOLBLOCK* p);
+#endif
+static uint32_t tstamp_dtw(struct CAN_CTLBLOCK* pctl, uint32_t ts, struct CANRCVBUF* pcan);
+static void errstate_check(struct CAN_CTLBLOCK* pctl, uint32_t tick);
 
 #define MAXCANMODULES	4	// Max number of CAN modules + 1
 /* Pointers to control blocks for each CAN module */
@@ -152,6 +160,229 @@ struct CANTAKEPTR* can_iface_mbx_init(struct CAN_CTLBLOCK* pctl, osThreadId tskh
 
 	return ptmp;	
 }
+/******************************************************************************
+ * void can_iface_errstate_config(struct CAN_CTLBLOCK* pctl, uint8_t policy, uint32_t backoffmin, uint32_t backoffmax);
+ * @brief 	: Set bus-off policy and recovery backoff
+ * @param	: pctl = pointer to our CAN control block
+ * @param	: policy = CANPOOL_KEEP or CANPOOL_FLUSH
+ * @param	: backoffmin = ticks to wait before first restart attempt
+ * @param	: backoffmax = max ticks (wait doubles on repeated bus-off)
+*******************************************************************************/
+void can_iface_errstate_config(struct CAN_CTLBLOCK* pctl, uint8_t policy, uint32_t backoffmin, uint32_t backoffmax)
+{
+	if (backoffmin == 0) backoffmin = 1;
+	if (backoffmax < backoffmin) backoffmax = backoffmin;
+taskENTER_CRITICAL();
+	pctl->errst.policy     = policy;
+	pctl->errst.backoffmin = backoffmin;
+	pctl->errst.backoffmax = backoffmax;
+	pctl->errst.backoff    = backoffmin;
+taskEXIT_CRITICAL();
+	return;
+}
+/******************************************************************************
+ * void can_iface_errstate_poll(void);
+ * @brief 	: Update error states and restart CAN modules that are bus-off (task context)
+*******************************************************************************/
+/*
+ABOM (automatic bus-off management) is off, so leaving bus-off takes a
+software request: enter and leave init mode.  The hardware then waits for
+128 occurrences of 11 recessive bits before it is back on the bus, which on
+a busy bus can take a while, hence the CANERR_RECOVER state.
+
+CanTxTask calls this periodically.  HAL_CAN_Stop/Start busy-wait (10 ms max),
+so this is not for interrupt context.
+*/
+void can_iface_errstate_poll(void)
+{
+	struct CAN_CTLBLOCK** ppx;
+	struct CAN_CTLBLOCK*  pctl;
+	struct CANERRSTATE*   pe;
+	uint32_t tick;
+	uint8_t state;
+
+	if (ppctllist == NULL) return; // No CAN modules initialized
+
+	for (ppx = &pctllist[0]; ppx != ppctllist; ppx++)
+	{
+		pctl = *ppx;
+		pe   = &pctl->errst;
+		tick = xTaskGetTickCount();
+
+		/* Error warning/passive have no interrupt for leaving the state */
+	taskENTER_CRITICAL();
+		errstate_check(pctl, tick);
+		state = pe->state;
+	taskEXIT_CRITICAL();
+
+		if (state != CANERR_BUSOFF) continue;
+		if ((tick - pe->tbusoff) < pe->backoff) continue;
+
+		/* Restart: init mode request and release */
+		if ((HAL_CAN_Stop(pctl->phcan) != HAL_OK) || (HAL_CAN_Start(pctl->phcan) != HAL_OK))
+		{ // HAL timed out and left its state as "error". Set it so Stop will be tried again.
+			pctl->phcan->State = HAL_CAN_STATE_LISTENING;
+			pe->restartfail += 1;
+			pe->tbusoff = tick; // Try again after another backoff
+			continue;
+		}
+
+	taskENTER_CRITICAL();
+		pe->state    = CANERR_RECOVER;
+		pe->tbusexit = tick;
+		if (pctl->pxprv == NULL) // Mailbox idle?
+			loadmbx2(pctl); // Start sending whatever is pending
+	taskEXIT_CRITICAL();
+	}
+	return;
+}
+#ifdef CANRATELIMITINCLUDED
+/******************************************************************************
+ * int can_iface_ratelimit_add(struct CAN_CTLBLOCK* pctl, uint32_t id, uint32_t mask, uint32_t rate, uint32_t burst, uint8_t policy);
+ * @brief 	: Add a token bucket rate limit for a CAN id, or range of CAN ids
+ * @param	: pctl = pointer to our CAN control block
+ * @param	: id = CAN id (our format, i.e. StdId << 21 or ExtId << 3)
+ * @param	: mask = bits of id that must match (only the high 11 bits, 0xffe00000, are used)
+ * @param	: rate = msgs per second (0 = no limit, i.e. exempt ids from a wider range)
+ * @param	: burst = number of msgs that can be sent back-to-back (bucket depth)
+ * @param	: policy = CANRATE_DROP or CANRATE_DEFER
+ * @return	: bucket index (0 - CANRATEMAX-1); -1 = too many; -2 = calloc failed; -3 = bad args
+*******************************************************************************/
+/*
+The lookup is a table indexed by the 11 high bits of the CAN id, so that 'can_driver_put'
+finds the bucket in one step.  Extended ids share the bucket of their high 11 bits.
+*/
+int can_iface_ratelimit_add(struct CAN_CTLBLOCK* pctl, uint32_t id, uint32_t mask, uint32_t rate, uint32_t burst, uint8_t policy)
+{
+	struct CANRATELIMIT* prate;
+	struct CANRATEBUCKET* pb;
+	int i;
+
+	if (pctl == NULL) return -3;
+	if ((rate != 0) && (burst == 0)) return -3;
+	if (policy > CANRATE_DEFER) return -3;
+
+taskENTER_CRITICAL();
+	prate = pctl->prate;
+	if (prate == NULL)
+	{ // First bucket for this CAN module
+		prate = (struct CANRATELIMIT*)calloc(1, sizeof(struct CANRATELIMIT));
+		if (prate == NULL){ taskEXIT_CRITICAL();return -2;}
+		pctl->prate = prate;
+	}
+	if (prate->n >= CANRATEMAX){ taskEXIT_CRITICAL();return -1;}
+
+	pb = &prate->bkt[prate->n];
+	pb->rate   = rate;
+	pb->tokmax = burst << 8;
+	pb->tokens = pb->tokmax; // Start full
+	pb->tick   = xTaskGetTickCount();
+	pb->frac   = 0;
+	pb->policy = policy;
+	prate->n  += 1;
+
+	/* Point the table entries for matching ids to this bucket */
+	mask &= 0xffe00000;
+	for (i = 0; i < CANRATEIDXSZ; i++)
+	{
+		if ((((uint32_t)i << 21) & mask) == (id & mask))
+			prate->idx[i] = prate->n; // Index + 1
+	}
+taskEXIT_CRITICAL();
+	return (prate->n - 1);
+}
+/* --------------------------------------------------------------------------------------
+* static int ratelimit(struct CANRATELIMIT* prate, uint32_t id);
+* @brief	: Refill bucket for this id and take a token (call with interrupts disabled)
+* @param	: prate = pointer to rate limit buckets
+* @param	: id = CAN id of msg
+* @return	: 0 = OK to send; -4 = drop; -5 = defer
+  --------------------------------------------------------------------------------------- */
+static int ratelimit(struct CANRATELIMIT* prate, uint32_t id)
+{
+	struct CANRATEBUCKET* pb;
+	uint32_t tick;
+	uint32_t elapsed;
+	uint64_t add;
+	uint8_t k = prate->idx[id >> 21];
+
+	if (k == 0) return 0; // Not rate limited
+	pb = &prate->bkt[k - 1];
+	if (pb->rate == 0) { pb->passct += 1; return 0;} // Exempt
+
+	/* Refill for the ticks since last refill.  What is left over of a 1/256
+      token is kept in 'frac' so that frequent calls at slow rates neither
+      lose the fraction nor round it up. */
+	tick     = xTaskGetTickCount();
+	elapsed  = tick - pb->tick;
+	pb->tick = tick;
+	add = (uint64_t)elapsed * pb->rate * 256 + pb->frac;
+	pb->frac = add % configTICK_RATE_HZ;
+	add      = add / configTICK_RATE_HZ;
+	if (add >= (pb->tokmax - pb->tokens))
+	{ // Full: refill beyond the bucket depth is lost
+		pb->tokens = pb->tokmax;
+		pb->frac   = 0;
+	}
+	else
+		pb->tokens += add;
+
+	if (pb->tokens >= 256)
+	{ // Here, a msg worth of tokens is available
+		pb->tokens -= 256;
+		pb->passct += 1;
+		return 0;
+	}
+	if (pb->policy == CANRATE_DEFER)
+	{
+		pb->deferct += 1;
+		return -5;
+	}
+	pb->dropct += 1;
+	return -4;
+}
+#endif
+#ifdef CANSTATSINCLUDED
+/******************************************************************************
+ * void can_iface_stats_reset(struct CAN_CTLBLOCK* pctl);
+ * @brief 	: Zero the latency/throughput statistics and restart the elapsed time
+ * @param	: pctl = pointer to our CAN control block
+*******************************************************************************/
+void can_iface_stats_reset(struct CAN_CTLBLOCK* pctl)
+{
+	uint32_t pendct;
+	int i;
+
+taskENTER_CRITICAL();
+	pendct = pctl->stats.txpendct; // Msgs still in the pending list remain counted
+	pctl->stats.txlatsum   = 0;
+	pctl->stats.txct       = 0;
+	pctl->stats.txlatmax   = 0;
+	pctl->stats.txlatmin   = 0xffffffff;
+	for (i = 0; i < CANSTATSHISTSZ; i++) pctl->stats.txhist[i] = 0;
+	pctl->stats.txabortct  = 0;
+	pctl->stats.txpendmax  = pendct;
+	pctl->stats.txpendct   = pendct;
+	pctl->stats.rxct       = 0;
+	pctl->stats.rxdrainmax = 0;
+	pctl->stats.dtwbegin   = DTWTIME;
+taskEXIT_CRITICAL();
+	return;
+}
+/******************************************************************************
+ * void can_iface_stats_get(struct CAN_CTLBLOCK* pctl, struct CANIFACESTATS* pstats);
+ * @brief 	: Get a consistent copy of the latency/throughput statistics
+ * @param	: pctl = pointer to our CAN control block
+ * @param	: pstats = pointer to struct that receives the copy
+*******************************************************************************/
+void can_iface_stats_get(struct CAN_CTLBLOCK* pctl, struct CANIFACESTATS* pstats)
+{
+taskENTER_CRITICAL();
+	*pstats = pctl->stats;
+taskEXIT_CRITICAL();
+	return;
+}
+#endif
 /******************************************************************************
  * struct CAN_CTLBLOCK* can_iface_init(CAN_HandleTypeDef *phcan, uint8_t canidx, uint16_t numtx, uint16_t numrx);
  * @brief 	: Setup linked list for TX priority sorted buffering
@@ -242,6 +473,17 @@ taskENTER_CRITICAL();
 	pctl->cirptrs.pwork  = pcann;
 	pctl->cirptrs.pend   = pcann + numrx;
 
+#ifdef CANSTATSINCLUDED
+	pctl->stats.txlatmin = 0xffffffff;
+	pctl->stats.dtwbegin = DTWTIME;
+#endif
+
+	/* Bus-off recovery defaults */
+	pctl->errst.backoffmin = CANBACKOFFMIN;
+	pctl->errst.backoffmax = CANBACKOFFMAX;
+	pctl->errst.backoff    = CANBACKOFFMIN;
+	pctl->errst.policy     = CANPOOL_KEEP;
+
 	/* NOTE: pctl->tsknote gets initialized
       when 'MailboxTask' calls 'can_iface_mbx_init' */
 
@@ -260,6 +502,9 @@ taskEXIT_CRITICAL();
  *				: -1 = Buffer overrun (no free slots for the new msg)
  *				: -2 = Bogus CAN id rejected
  *				: -3 = control block pointer NULL
+ *				: -4 = Rate limit exceeded, msg dropped (CANRATE_DROP)
+ *				: -5 = Rate limit exceeded, msg not accepted (CANRATE_DEFER)
+ *				: -7 = Bus-off with CANPOOL_FLUSH policy, msg discarded
  ******************************************************************************/
 
 extern uint32_t debugTX1c;
@@ -275,7 +520,7 @@ int can_driver_put(struct CAN_CTLBLOCK* pctl,struct CANRCVBUF *pcan,uint8_t maxr
 	// If 11b is specified && bits in extended address are present it is bogus
 	if (((pcan->id & CAN_ID_EXT) == 0) && ((pcan->id & CAN_EXTENDED_MASK) != 0))
 	{
-		pctl->bogusct += 1;
+		pctl->bogusct += 1; // (Not locked: a lost count is harmless)
 		return -2;
 	}
 
@@ -283,14 +528,34 @@ int can_driver_put(struct CAN_CTLBLOCK* pctl,struct CANRCVBUF *pcan,uint8_t maxr
 //	disable_TXints(pctl, save);	// TX interrupt might move a msg to the free list.
 	taskENTER_CRITICAL();
 
+	if ((pctl->errst.state == CANERR_BUSOFF) && (pctl->errst.policy == CANPOOL_FLUSH))
+	{ // Off the bus: do not fill the pool with msgs that will be stale
+		pctl->errst.flushct += 1;
+		taskEXIT_CRITICAL();
+		return -7;
+	}
+
 	pnew = pctl->frii.plinknext;
 	if (pnew == NULL)
 	{ // Here, either no free list blocks OR this TX reached its limit
 //		reenable_TXints(save);
-		taskEXIT_CRITICAL();
 		pctl->can_errors.can_msgovrflow += 1;	// Count overflows
+		taskEXIT_CRITICAL();
 		return -1;	// Return failure: no space & screwed
 	}	
+#ifdef CANRATELIMITINCLUDED
+	if (pctl->prate != NULL)
+	{ // Token bucket check: one table lookup (after the free block check so a
+	  // token is not used up by a msg that could not be buffered)
+		int rret = ratelimit(pctl->prate, pcan->id);
+		if (rret != 0)
+		{
+			taskEXIT_CRITICAL();
+			return rret;
+		}
+	}
+#endif
+
 	pctl->frii.plinknext = pnew->plinknext;
 
 //	reenable_TXints(save);
@@ -307,6 +572,12 @@ int can_driver_put(struct CAN_CTLBLOCK* pctl,struct CANRCVBUF *pcan,uint8_t maxr
 	pnew->x.xb[2] = bits;// Use these bits to set some conditions (see .h file)
 	pnew->x.xb[3] = 0;   // not used for now
 	pnew->x.xb[0] = 0;   // Retry counter for TERRs
+#ifdef CANSTATSINCLUDED
+	pnew->dtw     = DTWTIME; // Start of put-to-TX-complete latency
+	pctl->stats.txpendct += 1;
+	if (pctl->stats.txpendct > pctl->stats.txpendmax)
+		pctl->stats.txpendmax = pctl->stats.txpendct;
+#endif
 
 	/* Find location to insert new msg.  Lower value CAN ids are higher priority, 
            and when the CAN id msg to be inserted has the same CAN id as the 'pfor' one
@@ -345,6 +616,9 @@ int can_driver_put(struct CAN_CTLBLOCK* pctl,struct CANRCVBUF *pcan,uint8_t maxr
 /* &&&&&&&&&&&&&& BEGIN ABORT MODS &&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&& */
 #ifdef YESABORTCODE
 			pctl->abortflag = 1;	// Set flag for interrupt routine use
+#ifdef CANSTATSINCLUDED
+			pctl->stats.txabortct += 1;
+#endif
 		taskEXIT_CRITICAL(); // ==> NOTE: allow interrupts before setting abort!
 			HAL_CAN_AbortTxRequest(pctl->phcan, CAN_TX_MAILBOX0);
 //		taskEXIT_CRITICAL(); // ==> AFTER! Which fails!
@@ -390,6 +664,7 @@ static void loadmbx2(struct CAN_CTLBLOCK* pctl)
 	halmsg.IDE   = (p->can.id & CAN_ID_EXT);
 	halmsg.RTR   = (p->can.id & CAN_RTR_REMOTE);
 	halmsg.DLC   = (p->can.dlc & 0xf);
+	halmsg.TransmitGlobalTime = DISABLE; // TTCM: do not replace payload bytes 6,7 with time
 	uidata[0]   = p->can.cd.ui[0];
 	uidata[1]   = p->can.cd.ui[1];
 	pctl->mbx0  = p->can.id;	// Shadow MBX0 ID
@@ -417,9 +692,37 @@ static void moveremove2(struct CAN_CTLBLOCK* pctl)
 	pmov->plinknext = pctl->frii.plinknext; 
 	pctl->frii.plinknext  = pmov;
 
+#ifdef CANSTATSINCLUDED
+	pctl->stats.txpendct -= 1;
+#endif
+
 //	reenable_TXints(save);
 	return;
 }
+#ifdef CANSTATSINCLUDED
+/* --------------------------------------------------------------------------------------
+* static void stats_txcomplete(struct CAN_CTLBLOCK* pctl, volatile struct CAN_POOLBLOCK* p);
+* @brief	: Update latency stats for msg that just completed TX (called from ISR)
+* @param	: pctl = pointer to our CAN control block
+* @param	: p = pointer to pool block of msg sent
+  --------------------------------------------------------------------------------------- */
+static void stats_txcomplete(struct CAN_CTLBLOCK* pctl, volatile struct CAN_POOLBLOCK* p)
+{
+	uint32_t lat = DTWTIME - p->dtw; // Wraps ok for latencies < 25 secs
+	uint32_t bin = 0;
+
+	pctl->stats.txct     += 1;
+	pctl->stats.txlatsum += lat;
+	if (lat > pctl->stats.txlatmax) pctl->stats.txlatmax = lat;
+	if (lat < pctl->stats.txlatmin) pctl->stats.txlatmin = lat;
+
+	/* Bin number is the number of significant bits in the latency */
+	if (lat != 0) bin = 32 - __builtin_clz(lat);
+	if (bin >= CANSTATSHISTSZ) bin = CANSTATSHISTSZ - 1;
+	pctl->stats.txhist[bin] += 1;
+	return;
+}
+#endif
 
 /*#######################################################################################
  * ISR CAN Callback routines
@@ -447,6 +750,37 @@ struct CAN_CTLBLOCK* getpctl(CAN_HandleTypeDef *phcan)
 	return *ppx;
 }
 
+/* *********************************************************************
+ * static uint32_t tstamp_dtw(struct CAN_CTLBLOCK* pctl, uint32_t ts, struct CANRCVBUF* pcan);
+ * @brief	: Convert TTCM time stamp of msg to DTW time of msg SOF
+ * @param	: pctl = pointer to our CAN control block
+ * @param	: ts = 16b time stamp from HAL (RX header Timestamp, or TX mailbox)
+ * @return	: DTW time; pctl->tstamp.ext = extended time stamp
+ * *********************************************************************/
+/*
+The CAN TX, RX0, RX1 interrupts are at the same priority so they cannot 
+interrupt each other while updating the estimate.
+
+The HAL Init values are not set when 'can_iface_init' is called, so the
+bit time is computed here the first time.
+*/
+static uint32_t tstamp_dtw(struct CAN_CTLBLOCK* pctl, uint32_t ts, struct CANRCVBUF* pcan)
+{
+	uint32_t tq;
+	uint32_t dtwperbit;
+
+	if (pctl->tstamp.dtwperbit == 0)
+	{ // Time quanta per bit = SYNC_SEG + BS1 + BS2
+		tq = 1 + ((pctl->phcan->Init.TimeSeg1 >> CAN_BTR_TS1_Pos) + 1) +
+			      ((pctl->phcan->Init.TimeSeg2 >> CAN_BTR_TS2_Pos) + 1);
+		dtwperbit = ((uint64_t)SystemCoreClock * pctl->phcan->Init.Prescaler * tq) / 
+			HAL_RCC_GetPCLK1Freq();
+		can_tstamp_init(&pctl->tstamp, dtwperbit, SystemCoreClock/configTICK_RATE_HZ);
+	}
+	return can_tstamp_extend(&pctl->tstamp, (uint16_t)ts, DTWTIME, xTaskGetTickCountFromISR(),
+		CANTSTAMPMINBITS(pcan->id & CAN_ID_EXT, pcan->id & CAN_RTR_REMOTE, pcan->dlc));
+}
+
 /* Transmission Mailbox 0 complete callback. */
 void HAL_CAN_TxMailbox0CompleteCallback(CAN_HandleTypeDef *phcan)
 {
@@ -457,7 +791,23 @@ volatile	struct CAN_POOLBLOCK* p = pctl->pxprv->plinknext;//pctl->pend.plinknext
 	struct CANRCVBUFN ncan;
 	ncan.pctl = pctl;
 	ncan.can = p->can;
+
+	/* Time stamp loopback copy with the SOF of the msg that went out */
+	if (phcan->Init.TimeTriggeredMode == ENABLE)
+	{
+		ncan.toa = tstamp_dtw(pctl, HAL_CAN_GetTxTimestamp(phcan, CAN_TX_MAILBOX0), &ncan.can);
+		ncan.ttc = (uint32_t)pctl->tstamp.ext;
+	}
+	else
+	{
+		ncan.toa = DTWTIME;
+		ncan.ttc = 0;
+	}
 	
+#ifdef CANSTATSINCLUDED
+	stats_txcomplete(pctl, p);
+#endif
+
 	/* Either loop back all, or msg-by-msg select loopback */
 #ifndef CANMSGLOOPBACKALL
 	// Check of loopback bit in msg is set
@@ -493,11 +843,126 @@ void HAL_CAN_TxMailbox0AbortCallback(CAN_HandleTypeDef *phcan)
 #endif
 }
 
+/* --------------------------------------------------------------------------------------
+* static void flushpending(struct CAN_CTLBLOCK* pctl);
+* @brief	: Move pending msgs to free list, except one in mailbox (interrupts disabled)
+  --------------------------------------------------------------------------------------- */
+static void flushpending(struct CAN_CTLBLOCK* pctl)
+{
+	volatile struct CAN_POOLBLOCK* pkeep = NULL;
+	volatile struct CAN_POOLBLOCK* p;
+	volatile struct CAN_POOLBLOCK* pnext;
+
+	/* The msg in the mailbox stays on the pending list for the TX complete */
+	if (pctl->pxprv != NULL)
+		pkeep = pctl->pxprv->plinknext;
+
+	p = pctl->pend.plinknext;
+	while (p != NULL)
+	{
+		pnext = p->plinknext;
+		if (p != pkeep)
+		{ // Add to free list
+			p->plinknext = pctl->frii.plinknext;
+			pctl->frii.plinknext = p;
+			pctl->errst.flushct += 1;
+#ifdef CANSTATSINCLUDED
+			pctl->stats.txpendct -= 1;
+#endif
+		}
+		p = pnext;
+	}
+	pctl->pend.plinknext = pkeep;
+	if (pkeep != NULL)
+	{
+		pkeep->plinknext = NULL;
+		pctl->pxprv = &pctl->pend;
+	}
+	return;
+}
+/* --------------------------------------------------------------------------------------
+* static void errstate_check(struct CAN_CTLBLOCK* pctl, uint32_t tick);
+* @brief	: Update error state from the ESR register (interrupts disabled)
+* @param	: pctl = pointer to our CAN control block
+* @param	: tick = FreeRTOS tick count
+  --------------------------------------------------------------------------------------- */
+static void errstate_check(struct CAN_CTLBLOCK* pctl, uint32_t tick)
+{
+	struct CANERRSTATE* pe = &pctl->errst;
+	uint32_t esr = pctl->phcan->Instance->ESR;
+	uint32_t backoff;
+	uint8_t state;
+
+	pe->tec = (esr & CAN_ESR_TEC) >> CAN_ESR_TEC_Pos;
+	pe->rec = (esr & CAN_ESR_REC) >> CAN_ESR_REC_Pos;
+
+	if ((esr & CAN_ESR_BOFF) != 0)
+	{ // Here, bus-off
+		if (pe->state == CANERR_BUSOFF) return; // Waiting for backoff
+		if (pe->state == CANERR_RECOVER)
+		{ // Restarted: hardware still waiting for recessive bits
+			if ((tick - pe->tbusexit) < pe->backoffmax) return;
+			pe->restartfail += 1; // Too long: count as a new bus-off
+		}
+		/* Bus-off entry.  Back off longer if it just recovered from one. */
+		backoff = pe->backoffmin;
+		if ((pe->busoffct != 0) && ((tick - pe->tbusexit) < (4 * pe->backoff)))
+		{
+			backoff = pe->backoff * 2;
+			if (backoff > pe->backoffmax) backoff = pe->backoffmax;
+		}
+		pe->backoff  = backoff;
+		pe->tbusoff  = tick;
+		pe->busoffct += 1;
+		pe->state    = CANERR_BUSOFF;
+		if (pe->policy == CANPOOL_FLUSH)
+			flushpending(pctl);
+		return;
+	}
+
+	if ((esr & CAN_ESR_EPVF) != 0)
+		state = CANERR_PASSIVE;
+	else if ((esr & CAN_ESR_EWGF) != 0)
+		state = CANERR_WARNING;
+	else
+		state = CANERR_ACTIVE;
+
+	if (pe->state >= CANERR_BUSOFF)
+	{ // Back on the bus
+		pe->restartct += 1;
+		pe->tbusexit   = tick;
+	}
+	else if (state > pe->state)
+	{ // Count entries into worse states
+		if (state == CANERR_WARNING) pe->warningct += 1;
+		if (state == CANERR_PASSIVE) pe->passivect += 1;
+	}
+	pe->state = state;
+	return;
+}
+
 /* Error callback */
+/*
+HAL ORs new error bits into ErrorCode, so it is reset here.  Otherwise an old
+ALST0 would look like a new one on every later error interrupt.
+*/
+#define CANLECERRORS (HAL_CAN_ERROR_STF | HAL_CAN_ERROR_FOR | HAL_CAN_ERROR_ACK |\
+	                   HAL_CAN_ERROR_BR  | HAL_CAN_ERROR_BD  | HAL_CAN_ERROR_CRC )
 void HAL_CAN_ErrorCallback(CAN_HandleTypeDef *phcan)
 {
 	struct CAN_CTLBLOCK* pctl = getpctl(phcan);
-	if ((phcan->ErrorCode & HAL_CAN_ERROR_TX_ALST0) != 0 )
+	uint32_t ec = phcan->ErrorCode;
+
+	HAL_CAN_ResetError(phcan);
+	pctl->errst.lasterr = ec;
+	if ((ec & CANLECERRORS) != 0) 
+		pctl->errst.lecct += 1;
+
+	/* Error state: warning, passive, bus-off */
+	errstate_check(pctl, xTaskGetTickCountFromISR());
+
+	/* Mailbox 0 TX errors */
+	if ((ec & HAL_CAN_ERROR_TX_ALST0) != 0 )
 	{
 		pctl->can_errors.can_tx_alst0_err += 1; // Running ct of arb lost: Mostly for debugging/monitoring
 		if ((pctl->pxprv->plinknext->x.xb[2] & SOFTNART) != 0)
@@ -505,8 +970,9 @@ void HAL_CAN_ErrorCallback(CAN_HandleTypeDef *phcan)
 			moveremove2(pctl);	// Remove msg from pending queue
 		}
 debugTX1c += 1;
+		loadmbx2(pctl);		// Load mailbox 0.  Mailbox should be available/empty.
 	}
-	else if ((phcan->ErrorCode & HAL_CAN_ERROR_TX_TERR0) != 0 )
+	else if ((ec & HAL_CAN_ERROR_TX_TERR0) != 0 )
 	{
 		pctl->pxprv->plinknext->x.xb[0] += 1;	// Count errors for this msg
 		if (pctl->pxprv->plinknext->x.xb[0] > pctl->pxprv->plinknext->x.xb[1])
@@ -514,8 +980,8 @@ debugTX1c += 1;
 			pctl->can_errors.can_tx_bombed += 1;	// Number of bombouts
 			moveremove2(pctl);	// Remove msg from pending queue
 		}
+		loadmbx2(pctl);		// Load mailbox 0.  Mailbox should be available/empty.
 	}	
-	loadmbx2(pctl);		// Load mailbox 0.  Mailbox should be available/empty.
 	return;
 }
 /* *********************************************************************
@@ -529,12 +995,15 @@ uint32_t debug1;
 static void unloadfifo(CAN_HandleTypeDef *phcan, uint32_t RxFifo)
 {
 	struct CANRCVBUFN ncan; // CAN msg plus pctl
-	ncan.toa = DTWTIME;
+	ncan.ttc = 0;
 debug1 += 1;
 	HAL_StatusTypeDef ret;
 	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
 	CAN_RxHeaderTypeDef header;
 	uint8_t data[8];
+#ifdef CANSTATSINCLUDED
+	uint32_t drainct = 0;
+#endif
 
 	struct CAN_CTLBLOCK* pctl = getpctl(phcan); // Lookup pctl given phcan
 
@@ -555,6 +1024,20 @@ if (pctl == NULL) morse_trap (557);
 			ncan.pctl = pctl;
 			canmsg_compress(&ncan.can, &header, &data[0]);
 
+			/* Time stamp each msg, not once per drain */
+			if (phcan->Init.TimeTriggeredMode == ENABLE)
+			{ // SOF time from the hardware capture
+				ncan.toa = tstamp_dtw(pctl, header.Timestamp, &ncan.can);
+				ncan.ttc = (uint32_t)pctl->tstamp.ext;
+			}
+			else
+			{
+				ncan.toa = DTWTIME;
+			}
+#ifdef CANSTATSINCLUDED
+			drainct += 1;
+#endif
+
 			/* Place on queue for Mailbox task to filter, distribute, notify, etc. */
 			*pctl->cirptrs.pwork = ncan; // Copy struct
 			pctl->cirptrs.pwork++;       // Advance 'add' pointer
@@ -568,6 +1051,10 @@ if (pctl == NULL) morse_trap (557);
 			}
 		}
 	} while (ret == HAL_OK); //JIC there is more than one in the hw fifo
+#ifdef CANSTATSINCLUDED
+	pctl->stats.rxct += drainct;
+	if (drainct > pctl->stats.rxdrainmax) pctl->stats.rxdrainmax = drainct;
+#endif
 	portYIELD_FROM_ISR( xHigherPriorityTaskWoken ); // Trigger scheduler
 	return;
 }
@@ -16,6 +16,12 @@ at all times.
 
 #define LDR_RESET	8
 
+/* Uncomment for the TX latency/throughput statistics (DTW timing; PC/cansim builds with them) */
+//#define CANSTATSINCLUDED
+
+/* Comment out to remove per-CAN-ID TX rate limiting (token buckets) */
+#define CANRATELIMITINCLUDED
+
 #ifndef NULL 
 #define NULL	0
 #endif
@@ -23,6 +29,7 @@ at all times.
 #include "stm32f4xx_hal.h"
 #include "stm32f4xx_hal_can.h"
 #include "common_can.h"
+#include "can_tstamp.h"
 #include "CanTask.h"
 #include "FreeRTOS.h"
 #include "task.h"
@@ -33,7 +40,8 @@ struct CANRCVBUFN
 {
 	struct CANRCVBUF can;	   // Our standard CAN msg
 	struct CAN_CTLBLOCK* pctl;	// Pointer to control block for this CAN
-	uint32_t toa;              // Time-Of-Arrival: CAN msg arrival
+	uint32_t toa;              // Time-Of-Arrival: DTW at SOF of msg (TTCM), else DTW at interrupt
+	uint32_t ttc;              // TTCM: low 32b of extended time stamp (CAN bit times); else 0
 };
 
 struct CANRXNOTIFY
@@ -98,6 +106,93 @@ struct CAN_POOLBLOCK	// Used for common CAN TX/RX linked lists
 volatile struct CAN_POOLBLOCK* volatile plinknext;	// Linked list pointer (low value id -> high value)
 	 struct CANRCVBUF can;		// Msg queued
 	 union  CAN_X x;			// Extra goodies that are different for TX and RX
+#ifdef CANSTATSINCLUDED
+	 uint32_t dtw;        // DTWTIME when msg was added to pending list
+#endif
+};
+
+#ifdef CANSTATSINCLUDED
+#define CANSTATSHISTSZ 32 // Latency histogram bins: bin n = latency < 2^n DTW ticks
+/* Driver throughput and latency measurements (DTW ticks, 168 MHz) */
+struct CANIFACESTATS
+{
+	uint64_t txlatsum;   // Sum of put-to-TX-complete latencies
+	uint32_t txct;       // Number of msgs TX completed
+	uint32_t txlatmax;   // Max put-to-TX-complete latency
+	uint32_t txlatmin;   // Min put-to-TX-complete latency
+	uint32_t txhist[CANSTATSHISTSZ]; // log2 latency histogram
+	uint32_t txabortct;  // Mailbox aborts for a higher priority msg (inversion fixups)
+	uint32_t txpendmax;  // Max number of msgs in pending list
+	uint32_t txpendct;   // Current number of msgs in pending list
+	uint32_t rxct;       // Number of msgs received (not including loopback)
+	uint32_t rxdrainmax; // Max msgs unloaded from a fifo in one interrupt
+	uint32_t dtwbegin;   // DTWTIME at reset of stats (throughput = ct/elapsed)
+};
+#endif
+
+#ifdef CANRATELIMITINCLUDED
+#define CANRATEMAX    15   // Max number of rate limit buckets per CAN module
+#define CANRATEIDXSZ  2048 // Lookup table size: one entry per 11b (high bits) CAN id
+#define CANRATE_DROP  0    // Policy: over-limit msg is discarded (can_driver_put returns -4)
+#define CANRATE_DEFER 1    // Policy: over-limit msg is refused (returns -5), caller retries later
+
+/* Token bucket. Tokens are in 1/256ths of a msg; each msg costs 256. */
+struct CANRATEBUCKET
+{
+	uint32_t tokens;  // Tokens currently in bucket
+	uint32_t tokmax;  // Bucket depth: burst * 256
+	uint32_t rate;    // Refill rate: msgs per second (0 = no limit)
+	uint32_t tick;    // FreeRTOS tick count of last refill
+	uint32_t frac;    // Refill left over, less than 1/256 token (in 1/configTICK_RATE_HZ)
+	uint32_t passct;  // Msgs accepted
+	uint32_t dropct;  // Msgs discarded (CANRATE_DROP)
+	uint32_t deferct; // Msgs refused (CANRATE_DEFER)
+	uint8_t  policy;  // CANRATE_DROP or CANRATE_DEFER
+};
+
+struct CANRATELIMIT
+{
+	/* Index (+1) of bucket for each 11b id (or high 11b of 29b id). 0 = not limited. */
+	uint8_t idx[CANRATEIDXSZ];
+	struct CANRATEBUCKET bkt[CANRATEMAX];
+	uint8_t n;        // Number of buckets in use
+};
+#endif
+
+/* CAN error states (bxCAN ESR flags) */
+#define CANERR_ACTIVE   0 // Error active: TEC and REC < 96
+#define CANERR_WARNING  1 // EWGF: TEC or REC >= 96
+#define CANERR_PASSIVE  2 // EPVF: TEC or REC > 127
+#define CANERR_BUSOFF   3 // BOFF: TEC > 255. Off the bus until restarted.
+#define CANERR_RECOVER  4 // Restarted: waiting for 128 x 11 recessive bits to clear BOFF
+
+/* What to do with buffered TX msgs when bus-off */
+#define CANPOOL_KEEP    0 // Keep msgs and accept new ones (until pool is full)
+#define CANPOOL_FLUSH   1 // Discard pending msgs; new msgs refused (-7) until restarted
+
+/* Recovery backoff defaults (FreeRTOS ticks) */
+#define CANBACKOFFMIN   8   // ~16 ms
+#define CANBACKOFFMAX   512 // ~1 sec
+
+struct CANERRSTATE
+{
+	uint32_t tbusoff;     // Tick: last bus-off entry
+	uint32_t tbusexit;    // Tick: last bus-off exit (CANERR_RECOVER: tick of restart)
+	uint32_t backoff;     // Current wait (ticks) between bus-off and restart
+	uint32_t backoffmin;  // Backoff after bus-off following a quiet period
+	uint32_t backoffmax;  // Backoff doubles for repeated bus-offs up to this
+	uint32_t busoffct;    // Count: bus-off entries
+	uint32_t passivect;   // Count: error passive entries
+	uint32_t warningct;   // Count: error warning entries
+	uint32_t lecct;       // Count: protocol errors (stuff, form, ack, bit, crc)
+	uint32_t restartct;   // Count: successful restarts
+	uint32_t restartfail; // Count: restarts failed (HAL Stop/Start timeout)
+	uint32_t flushct;     // Count: msgs discarded by CANPOOL_FLUSH
+	uint32_t lasterr;     // HAL ErrorCode bits of last error interrupt
+	uint8_t  tec;         // Transmit error counter at last error interrupt/poll
+	uint8_t  rec;         // Receive error counter at last error interrupt/poll
+	uint8_t  state;       // CANERR_ACTIVE, _WARNING, _PASSIVE, _BUSOFF, _RECOVER
+	uint8_t  policy;      // CANPOOL_KEEP or CANPOOL_FLUSH
 };
 
 /* Here: everything you wanted to know about a CAN module (i.e. CAN1, CAN2, CAN3) */
@@ -123,6 +218,18 @@ volatile struct CAN_POOLBLOCK* volatile pxprv;	// pxprv->plinknext points to msg
 	s8 	ret;		   // Return code from routine call
 
 	uint8_t canidx;
+
+	struct CANERRSTATE errst; // Error state tracking and bus-off recovery
+
+	/* Time stamp extension when TTCM is enabled (hcan Init.TimeTriggeredMode) */
+	struct CANTSTAMP tstamp;
+
+#ifdef CANSTATSINCLUDED
+	struct CANIFACESTATS stats; // Latency/throughput measurements
+#endif
+#ifdef CANRATELIMITINCLUDED
+	struct CANRATELIMIT* prate; // Rate limit buckets; NULL = none configured
+#endif
 };
 
 /******************************************************************************/
@@ -146,6 +253,9 @@ int can_driver_put(struct CAN_CTLBLOCK* pctl, struct CANRCVBUF *pcan, u8 maxretr
  *				: -1 = Buffer overrun (no free slots for the new msg)
  *				: -2 = Bogus CAN id rejected
  *				: -3 = control block pointer NULL
+ *				: -4 = Rate limit exceeded, msg dropped (CANRATE_DROP)
+ *				: -5 = Rate limit exceeded, msg not accepted (CANRATE_DEFER)
+ *				: -7 = Bus-off with CANPOOL_FLUSH policy, msg discarded
  ******************************************************************************/
 struct CANTAKEPTR* can_iface_add_take(struct CAN_CTLBLOCK*  pctl);
 /* @brief 	: Create a 'take' pointer for accessing CAN msgs in the circular buffer
@@ -164,6 +274,40 @@ struct CANRCVBUFN* can_iface_get_CANmsg(struct CANTAKEPTR* p);
  * @brief	: p = pointer to struct with 'take' and 'add' pointers
  * @return	: pointer to CAN msg struct; NULL = no msgs available.
 *******************************************************************************/
+void can_iface_errstate_config(struct CAN_CTLBLOCK* pctl, uint8_t policy, uint32_t backoffmin, uint32_t backoffmax);
+/* @brief 	: Set bus-off policy and recovery backoff
+ * @param	: pctl = pointer to our CAN control block
+ * @param	: policy = CANPOOL_KEEP or CANPOOL_FLUSH
+ * @param	: backoffmin = ticks to wait before first restart attempt
+ * @param	: backoffmax = max ticks (wait doubles on repeated bus-off)
+*******************************************************************************/
+void can_iface_errstate_poll(void);
+/* @brief 	: Update error states and restart CAN modules that are bus-off (task context)
+*******************************************************************************/
+#ifdef CANRATELIMITINCLUDED
+int can_iface_ratelimit_add(struct CAN_CTLBLOCK* pctl, uint32_t id, uint32_t mask, uint32_t rate, uint32_t burst, uint8_t policy);
+/* @brief 	: Add a token bucket rate limit for a CAN id, or range of CAN ids
+ * @param	: pctl = pointer to our CAN control block
+ * @param	: id = CAN id (our format, i.e. StdId << 21 or ExtId << 3)
+ * @param	: mask = bits of id that must match (only the high 11 bits, 0xffe00000, are used)
+ * @param	: rate = msgs per second (0 = no limit, i.e. exempt ids from a wider range)
+ * @param	: burst = number of msgs that can be sent back-to-back (bucket depth)
+ * @param	: policy = CANRATE_DROP or CANRATE_DEFER
+ * @return	: bucket index (0 - CANRATEMAX-1); -1 = too many; -2 = calloc failed; -3 = bad args
+ * NOTE: call during init. Later calls overwrite overlapping ids of earlier calls.
+*******************************************************************************/
+#endif
+#ifdef CANSTATSINCLUDED
+void can_iface_stats_reset(struct CAN_CTLBLOCK* pctl);
+/* @brief 	: Zero the latency/throughput statistics and restart the elapsed time
+ * @param	: pctl = pointer to our CAN control block
+*******************************************************************************/
+void can_iface_stats_get(struct CAN_CTLBLOCK* pctl, struct CANIFACESTATS* pstats);
+/* @brief 	: Get a consistent copy of the latency/throughput statistics
+ * @param	: pctl = pointer to our CAN control block
+ * @param	: pstats = pointer to struct that receives the copy
+*******************************************************************************/
+#endif
 
 #endif 
 
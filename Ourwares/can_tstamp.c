@@ -0,0 +1,86 @@
+/******************************************************************************
+* File Name          : can_tstamp.c
+* Date First Issued  : 10/19/2026
+* Description        : Extend bxCAN TTCM 16b time stamps and correlate to DTW
+*******************************************************************************/
+
+#include "can_tstamp.h"
+
+/* *************************************************************************
+ * void can_tstamp_init(struct CANTSTAMP* p, uint32_t dtwperbit, uint32_t dtwpertick);
+ * @brief	: Initialize time stamp extension
+ * @param	: p = pointer to time stamp struct (one per CAN module)
+ * @param	: dtwperbit = DTW ticks per CAN bit, e.g. 168E6/500E3 = 336
+ * @param	: dtwpertick = DTW ticks per FreeRTOS tick, e.g. 168E6/512 = 328125
+ * *************************************************************************/
+void can_tstamp_init(struct CANTSTAMP* p, uint32_t dtwperbit, uint32_t dtwpertick)
+{
+	if (dtwperbit == 0) dtwperbit = 1; // JIC
+	p->hwref      = 0;
+	p->ext        = 0;
+	p->dtwref     = 0;
+	p->tickref    = 0;
+	p->dtwperbit  = dtwperbit;
+	p->dtwpertick = dtwpertick;
+	p->bumpct     = 0;
+	p->init       = 0;
+	return;
+}
+/* *************************************************************************
+ * uint32_t can_tstamp_extend(struct CANTSTAMP* p, uint16_t ts16, uint32_t dtwnow, uint32_t ticknow, uint32_t minbits);
+ * @brief	: Extend a 16b bxCAN time stamp and convert it to DTW time
+ * @param	: p = pointer to time stamp struct
+ * @param	: ts16 = time stamp from CAN_RDTxR or CAN_TDTxR TIME field
+ * @param	: dtwnow = DTWTIME when called
+ * @param	: ticknow = FreeRTOS tick count when called
+ * @param	: minbits = bits the msg took at least, SOF to interrupt (CANTSTAMPMINBITS)
+ * @return	: DTW time of msg SOF; p->ext = 64b extended time stamp
+ * *************************************************************************/
+uint32_t can_tstamp_extend(struct CANTSTAMP* p, uint16_t ts16, uint32_t dtwnow, uint32_t ticknow, uint32_t minbits)
+{
+	uint32_t ticks;
+	uint32_t ddtw;
+	uint64_t dbits;
+	uint16_t behind; // Bits from SOF to 'now'
+
+	if (p->init == 0)
+	{ // First stamp: assume the frame just ended.  Later stamps will correct upward.
+		p->init    = 1;
+		p->hwref   = (uint64_t)ts16 + minbits;
+		p->ext     = ts16;
+		p->dtwref  = dtwnow;
+		p->tickref = ticknow;
+		return dtwnow - minbits * p->dtwperbit;
+	}
+
+	/* Advance the counter estimate to 'now' */
+	ticks = ticknow - p->tickref;
+	p->tickref = ticknow;
+	if (ticks > CANTSTAMPTICKMAX)
+	{ // DTW may have wrapped: use the coarse tick count. Error is << 65536 bits.
+	  // One tick less keeps the estimate a lower bound; later stamps move it up.
+		dbits = ((uint64_t)(ticks - 1) * p->dtwpertick) / p->dtwperbit;
+		p->dtwref = dtwnow;
+	}
+	else
+	{ // Keep the remainder in 'dtwref' so the estimate does not drift
+		ddtw  = dtwnow - p->dtwref;
+		if ((int32_t)ddtw < 0) ddtw = 0; // JIC caller's 'now' is out of order
+		dbits = ddtw / p->dtwperbit;
+		p->dtwref += (uint32_t)dbits * p->dtwperbit;
+	}
+	p->hwref += dbits;
+
+	/* Bits between the SOF and the estimated counter "now" */
+	behind = (uint16_t)((uint16_t)p->hwref - ts16);
+	if ((behind > CANTSTAMPAHEAD) || (behind < minbits))
+	{ // Stamp is ahead of the estimate, or too close for the frame to have ended:
+	  // estimate was low, move it up to the end of the shortest such frame
+		p->hwref  += (uint16_t)(ts16 + minbits - (uint16_t)p->hwref);
+		p->bumpct += 1;
+		behind     = minbits;
+	}
+	p->ext = p->hwref - behind;
+
+	return (p->dtwref - (uint32_t)behind * p->dtwperbit);
+}
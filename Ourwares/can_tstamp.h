@@ -0,0 +1,70 @@
+/******************************************************************************
+* File Name          : can_tstamp.h
+* Date First Issued  : 10/19/2026
+* Description        : Extend bxCAN TTCM 16b time stamps and correlate to DTW
+*******************************************************************************/
+/*
+With TTCM (Time Triggered Communication Mode) enabled the bxCAN has a 16b
+counter that increments once per CAN bit time and is captured at the SOF of
+each received msg (CAN_RDTxR) and each transmitted msg (CAN_TDTxR).  At 500K
+it wraps every 131 ms.
+
+The counter cannot be read directly, so its value "now" is estimated from the
+DTW cycles (or FreeRTOS ticks after a long idle) since the previous stamp.  The
+estimate is a lower bound: the interrupt for a msg runs after its frame is on
+the bus, so "now" is at least the shortest frame with that id type and dlc
+(stuff bits not counted) past the SOF.  A stamp closer to the estimate than
+that pushes the estimate up.  The number of bits between SOF and "now" gives
+the DTW time of the SOF.  It comes out late by the stuff bits and interrupt
+latency of the msg that last pushed the estimate, a few bits once a short
+frame has been seen.
+
+No HAL or FreeRTOS dependencies, so this compiles for the PC as well.
+*/
+
+#ifndef __CAN_TSTAMP
+#define __CAN_TSTAMP
+
+#include <stdint.h>
+
+/* Elapsed ticks beyond which DTW (wraps at 25.6 secs) is not used for the estimate */
+#define CANTSTAMPTICKMAX  (512*8)
+
+/* (estimate - stamp) mod 2^16 above this means the stamp is ahead of the estimate */
+#define CANTSTAMPAHEAD    0xF000
+
+/* Bits from SOF to the RX (EOF bit 6) or TX complete interrupt of the shortest
+   frame: standard 19 + 8*dlc + 24, extended 39 + 8*dlc + 24, no stuff bits */
+#define CANTSTAMPMINBITS(ext, rtr, dlc) (((ext) ? 63 : 43) + ((rtr) ? 0 : 8 * (((dlc) > 8) ? 8 : (dlc))))
+
+struct CANTSTAMP
+{
+	uint64_t hwref;     // Extended (64b) estimate of bxCAN counter at 'dtwref'
+	uint64_t ext;       // Extended time stamp of most recent msg
+	uint32_t dtwref;    // DTWTIME corresponding to 'hwref'
+	uint32_t tickref;   // FreeRTOS tick of last update
+	uint32_t dtwperbit; // DTW ticks per CAN bit time
+	uint32_t dtwpertick;// DTW ticks per FreeRTOS tick
+	uint32_t bumpct;    // Count of stamps that moved the estimate up
+	uint8_t  init;      // 0 = first stamp not yet seen
+};
+
+/* *************************************************************************/
+ void can_tstamp_init(struct CANTSTAMP* p, uint32_t dtwperbit, uint32_t dtwpertick);
+/* @brief	: Initialize time stamp extension
+ * @param	: p = pointer to time stamp struct (one per CAN module)
+ * @param	: dtwperbit = DTW ticks per CAN bit, e.g. 168E6/500E3 = 336
+ * @param	: dtwpertick = DTW ticks per FreeRTOS tick, e.g. 168E6/512 = 328125
+ * *************************************************************************/
+ uint32_t can_tstamp_extend(struct CANTSTAMP* p, uint16_t ts16, uint32_t dtwnow, uint32_t ticknow, uint32_t minbits);
+/* @brief	: Extend a 16b bxCAN time stamp and convert it to DTW time
+ * @param	: p = pointer to time stamp struct
+ * @param	: ts16 = time stamp from CAN_RDTxR or CAN_TDTxR TIME field
+ * @param	: dtwnow = DTWTIME when called
+ * @param	: ticknow = FreeRTOS tick count when called
+ * @param	: minbits = bits the msg took at least, SOF to interrupt (CANTSTAMPMINBITS)
+ * @return	: DTW time of msg SOF; p->ext = 64b extended time stamp
+ * NOTE: Calls must be in time order, i.e. caller serializes with interrupts disabled
+ * *************************************************************************/
+
+#endif
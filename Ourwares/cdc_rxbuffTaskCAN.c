@@ -8,6 +8,7 @@
 #include "usbd_cdc_if.h"
 #include "CanTask.h"
 #include "SerialTaskReceive.h"
+#include "gateway_PCtoCAN.h"
 
 /* CDC buffers. */
 struct CDCOUTBUFF cdcbuf[CDCOUTNUMBUF];
@@ -18,14 +19,11 @@ struct CDCOUTBUFF* pcdcbuf_take;
 struct GATEWAYPCTOCAN
 {
 	struct CANRCVBUFPLUS*	pcanp; // Ptr into buffer for received CAN Plus msg
-	uint32_t chksumx;       // Checksum in progress
+	char asc[GATEWAYPCTOCANASC]; // Ascii/hex chars of line in progress
 	uint8_t binseq;         // Received sequence number (binary)
 	uint8_t ctrseq;			// Software maintained sequence number
-	uint8_t state;          // State of decoding
 	uint8_t error;          // Error code: 0 = no errors
-	uint8_t bin;            // Bin byte in progress
-	uint8_t odd;            // Nibble: Odd = 1, even = 0;
-	uint8_t ctr;            // Data storing counter
+	uint8_t ctr;            // Chars in line (stops at 255)
 };
 struct CANTXQMSG
 {
@@ -54,26 +52,6 @@ static uint32_t notebit;
 osThreadId CdcRxTaskReceiveCANHandle = NULL; // We met the task and it is us.
 void StartCdcRxTaskReceiveCAN(void const * argument);
 
-/* Lookup table to convert one hex char to binary (4 bits), no checking for illegal incoming hex */
-static const uint8_t hexbin[256] = {
-/*          0   1   2   3   4   5   6   7   8   9  10  11  12  13  14  15   */
-/*  0  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/*  1  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/*  2  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/*  3  */   0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  0,  0,  0,  0,  0,  0,
-/*  4  */   0, 10, 11, 12, 13, 14, 15,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/*  5  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/*  6  */   0, 10, 11, 12, 13, 14, 15,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/*  7  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/*  8  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/*  9  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/* 10  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/* 11  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/* 12  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/* 13  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/* 14  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/* 15  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-};
 /* ****************************************************************************
   * static void newcan_init(void);
   * @brief	: set initial vars for building a new CAN msg
@@ -83,11 +61,8 @@ static void newcan_init(void)
 	/* Initialize for new CAN msg construction */
 
 	struct GATEWAYPCTOCAN* p = &pctocan;
-	p->state   = 0;
 	p->error   = 0;
 	p->ctr     = 0;
-	p->odd     = 1;
-	p->chksumx = CHECKSUM_INITIAL;	// Checksum initial value
 
 	return;
 }
@@ -141,7 +116,7 @@ osThreadId xCdcRxTaskReceiveCANCreate(uint32_t taskpriority, uint32_t nb)
  *	@brief	: Task startup
  * @return	: struct CDCRXCANMSG->error holds results for each CAN msg     
  *				:      0  = no errors
- *				: (1<<0) |=  1 not assigned
+ *				: (1<<0) |=  1 a char was not ascii/hex
  *          : (1<<1) |=  2 completed, but bad checksum
  *  		   : (1<<2) |=  4 line terminator and state sequence not complete
  *		      : (1<<3) |=  8 sequence number did not mismatch
@@ -188,14 +163,11 @@ if (pcdcbuf_take->len <= CDCOUTBUFFSIZE) // Bogus length?
 					{ // Here End of Line
 						
 						/* End of line signals end of CAN msg; beginning of new.  */
-						if (p->state != 7) // Did it end correctly?
-						{ // Here, no.
-							p->error |= (1<<2);	// Line terminator came at wrong place.
-						}
+						gateway_PCtoCAN_line(p, &pcan_add->can);
 
 						/* Give the user of the CAN msg some info. */
-//						pcan_add->seq   = p->binseq;
-//						pcan_add->error = p->error;
+						pcan_add->binseq = p->binseq;
+						pcan_add->error  = p->error;
 
 						/* Step to next CANXQ buffer. */
 						pcan_add += 1;
@@ -211,89 +183,11 @@ dbrxbuff += 1;
 						newcan_init();
 					}
 					else
-					{ // Not end-of-line.  Convert ascii/hex to binary bytes
-						if (p->odd == 1)
-						{ // High order nibble
-							p->odd = 0;
-							p->bin = hexbin[(uint8_t)c] << 4; // Lookup binary, given ascii
-						}
-						else
-						{ // Low order nibble completes byte
-							p->odd = 1;
-							p->bin |= hexbin[(uint8_t)c];
-				
-							/* Store binary bytes directly into CAN buffer location */
-							/* Build checksum as we go. */
-							switch(p->state)
-							{
-							case 0: // Sequence number
-								p->binseq   = p->bin;
-								p->chksumx += p->bin;
-								p->state   += 1;
-								break;
-							case 1: // Low order byte of CAN id word
-								pcan_add->can.id   = (p->bin << 0);
-								p->state   += 1;
-								p->chksumx += p->bin;
-								break;
-							case 2:
-								pcan_add->can.id  |= (p->bin << 8);
-								p->chksumx += p->bin;
-								p->state   += 1;
-								break;
-							case 3:
-								pcan_add->can.id  |= (p->bin << 16);
-								p->chksumx += p->bin;
-								p->state   += 1;
-								break;
-							case 4: // High order byte of CAN id word
-								pcan_add->can.id  |= (p->bin << 24);
-								p->chksumx += p->bin;
-								p->state   += 1;
-								break;
-							case 5: // DLC byte -> CAN msg dlc word
-								if (p->bin > 8)
-								{ // DLC too large.
-									p->bin = 8; //Do not overrun array!
-									p->error |= (1<<5);
-								}
-								pcan_add->can.dlc = p->bin;
-								p->chksumx   += p->bin;
-								p->state     += 1;
-								break;
-							case 6: // Fill data bytes per dlc
-								if (p->ctr < pcan_add->can.dlc)
-								{
-									pcan_add->can.cd.uc[p->ctr] = p->bin;
-									p->chksumx += p->bin;
-									p->ctr     += 1;
-									break;
-								}
-								/* Here, checksum check.  Complete checksum calculation. */
-								p->chksumx += (p->chksumx >> 16); // Add carries into high half word
-								p->chksumx += (p->chksumx >> 16); // Add carry if previous add generated a carry
-								p->chksumx += (p->chksumx >> 8);  // Add high byte of low half word
-								p->chksumx += (p->chksumx >> 8);  // Add carry if previous add generated a carry
-								if ((p->chksumx & 0xff) != p->bin)
-								{ // Here, checksums mismatch
-									p->error |=  (1<<1);
-								}
-			
-								/* Check for missing msgs. */
-								p->ctrseq += 1;	// Advance software maintained sequence number
-								if (p->binseq != p->ctrseq)
-								{
-									p->error  |= (1<<3);	// Sequence number mismatch
-									p->ctrseq = p->binseq; // Reset
-								}
-								p->state = 7;
-								break;
-			
-							case 7:
-								p->error |= (1<<4); // Too many chars
-								break;
-							} // End: switch(p->state)	
-						} // End: Low order nibble completes byte
+					{ // Not end-of-line.  Save char; the line is converted at the terminator
+						if (p->ctr < GATEWAYPCTOCANASC)
+							p->asc[p->ctr] = c;
+						if (p->ctr < 255)
+							p->ctr += 1;
 					} // End: if ((c == 0XD) || (c == LINETERMINATOR))
 				} // End: while (pcdcbuf_take->len > 0)
 }
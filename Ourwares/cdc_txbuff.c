@@ -5,25 +5,31 @@
   ******************************************************************************
 Updates:
 2018 12 30 Multiple Tasks can call, plus timer polling (allows unmodified HAL code)
-   
-Strategy:
-A circular array of local buffers are created during initialization.  Tasks that
-have data to send via cdc tx place a block holding a pointer to the data plus the
-number of bytes on a queue.
-
-The cdc serial task send routine waits for blocks to be added to the queue.  When it receives
-the notification it checks for NULL pointer and zero size and calls the 'add' routine
-that copies the data into the local buffer(s).  It starts the cdc tx sending if it
-is not busy.  
+2026 10 19 Double buffer swapped on TX complete; no task, queue, or timer (see cdc_txdbl.h)
 
-When the timer, or modified HAL program, executes a callback the callback routine 
-checks if more buffers are to be sent and initiates the sending of the next buffer.
-
-When data is added to the local buffer and the cdc tx is busy sending the previous
-local buffer, the new data is appended to the local buffer.  This allows the lower
-level cdc routines to send longer runs of data.  Otherwise, it would be likely that
-sending short strings would result in the usb causing 1 ms delays between each
-string, thus limiting the throughput.
+Strategy:
+Two buffers, one the USB is sending and one that tasks add to.  A task
+reserves space in the fill buffer, formats its bytes there, and commits.
+If the USB is idle the commit starts it sending; otherwise the TX complete
+callback ('CDC_TransmitCplt_FS' in usbd_cdc_if.c) swaps the buffers and
+starts the one filled meanwhile.  Previously tasks queued a pointer, a
+task copied the bytes into a ring of local buffers, and a 5 ms timer
+started the next buffer after each transfer.
+
+While the USB is busy sending the previous buffer, new data is appended to
+the fill buffer.  This allows the lower level cdc routines to send longer
+runs of data.  Otherwise, it would be likely that sending short strings
+would result in the usb causing 1 ms delays between each string, thus
+limiting the throughput.
+
+A mutex holds off other tasks from reserve to commit.  The swap state is
+changed with interrupts masked (the USB interrupt is below
+configMAX_SYSCALL_INTERRUPT_PRIORITY), so only the formatting itself runs
+with interrupts on.
+
+When both buffers are full the task waits for TX complete (a semaphore the
+callback gives), up to CDCTXWAIT ticks, then gives up and the caller drops
+its bytes.  Polling each tick instead would let only one buffer go per ms.
 
 ==> NOTE: STM32CubeMX places MX_USB_DEVICE_Init(); in "StartDefaultTask".  A time
 delay is needed for the PC to recognize our usb device, e.g. 'osDelay(1000)'.
@@ -31,299 +37,151 @@ delay is needed for the PC to recognize our usb device, e.g. 'osDelay(1000)'.
 */
 
 #include <malloc.h>
+#include <string.h>
 #include "cdc_txbuff.h"
 #include "usbd_cdc_if.h"
 #include "morse.h"
 
 #include "main.h"
 
-#define CDCTIMEDURATION 5	// Timer time period (ms)
-
-/* Prototypes */
-static uint32_t cdc_txbuff_add(struct CDCTXTASKBCB* p);
-void cdc_txbuff_callback(void const * argument);
-
-/* Pointers for each buffer */
-static struct CDCBUFFPTR* pbuff_begin;
-static struct CDCBUFFPTR* pbuff_end;
-static struct CDCBUFFPTR* pbuff_m;	// Pointer to buffer that 'main' is adding to
-static struct CDCBUFFPTR* pbuff_i;	// Pointer to buffer that 'interrupt' (or poll) taking from
-
-/* Task */
-#define SSPRIORITY 1	// Priority for this task (0 = Normal, -3 = Idle)
-
-//static uint32_t CdcTxTaskSendBuffer[ 64 ];
-//static osStaticThreadDef_t CdcTxTaskSendControlBlock;
-osThreadId CdcTxTaskSendHandle = NULL;
-void StartCdcTxTaskSend(void const * argument);
-osTimerId CdcTxTimerHandle;
+struct CDCTXDBL cdctxdbl;
 
-/* Queue */
-#define CDCTXQUEUESIZE 8	// Total size of bcb's tasks can queue up
+static SemaphoreHandle_t cdctxmutex;
+static SemaphoreHandle_t cdctxfree; // Given on TX complete
+static uint32_t stallxfers; // 'stats.xfers' when a reserve last timed out
+static uint8_t  stalled;    // 1 = timed out, and the USB has not moved since
 
-osMessageQId CdcTxTaskSendQHandle;
-static uint8_t CdcTxTaskSendQBuffer[ CDCTXQUEUESIZE * sizeof( struct CDCTXTASKBCB ) ];
-static osStaticMessageQDef_t CdcTxTaskSendQCB;
-
-/* *************************************************************************
- * osMessageQId xCdcTxTaskSendCreate(uint32_t taskpriority);
- * @brief	: Create task; task handle created is global for all to enjoy!
- * @param	: taskpriority = Task priority (just as it says!)
- * @return	: Handle to queue
- * *************************************************************************/
-osMessageQId xCdcTxTaskSendCreate(uint32_t taskpriority)
-{
-	/* definition and creation of task: CdcTxTaskSend */
-   osThreadDef(CdcTxTaskSend, StartCdcTxTaskSend, osPriorityNormal, 0,128);
-   CdcTxTaskSendHandle = osThreadCreate(osThread(CdcTxTaskSend), NULL);
-	vTaskPrioritySet( CdcTxTaskSendHandle, taskpriority );
-	if (CdcTxTaskSendHandle == NULL) return NULL;
-
-	/* FreeRTOS queue for task with data to send. */
-  osMessageQStaticDef(CdcTxSendQ, CDCTXQUEUESIZE, struct CDCTXTASKBCB, CdcTxTaskSendQBuffer, &CdcTxTaskSendQCB);
-  CdcTxTaskSendQHandle = osMessageCreate(osMessageQ(CdcTxSendQ), NULL);
-
-  /* definition and creation of CdcTxTimer */
-  osTimerDef(CdcTxTim, cdc_txbuff_callback);
-  CdcTxTimerHandle = osTimerCreate(osTimer(CdcTxTim), osTimerPeriodic, NULL);
-
-	/* Start timer callback polling */
-	osTimerStart (CdcTxTimerHandle, pdMS_TO_TICKS(CDCTIMEDURATION));	
-
-	return CdcTxTaskSendQHandle;
-}
-/* *****************************************************************************
-  Advance buffer pointer
-********************************************************************************/
-static struct CDCBUFFPTR* step_ptr(struct CDCBUFFPTR* pb)
-{
-		pb++;	//Step to next struct of pointers for a buffer
-		if (pb >= pbuff_end)
-			pb = pbuff_begin; // Wrap around
-		return pb;
-}
 /** ****************************************************************************
-  * struct CDCBUFFPTR* cdc_txbuff_init(uint16_t numbuff, uint16_t size);
+  * struct CDCTXDBL* cdc_txbuff_init(uint16_t size);
   * @brief	: Setup buffer pair for CDC TX
-  * @param	: numbuff = number of buffers (of size 'size')
-  * @param	: size = number of bytes in each buffer
-  * @return	: NULL = calloc failed; not NULL = pointer to 1st struct with buff ptrs
+  * @param	: size = number of bytes in each buffer (multiple of usb packet size best)
+  * @return	: pointer to double buffer (stats)
   ******************************************************************************
   */
-// Debug: save and have listed in .map
-struct CDCBUFFPTR* dbgflash1;
-uint8_t* dbgflash3;
-uint32_t* dbgflash4;
-uint8_t* dbgflash2;
-
-
-struct CDCBUFFPTR* cdc_txbuff_init(uint16_t numbuff, uint16_t size)
+struct CDCTXDBL* cdc_txbuff_init(uint16_t size)
 {
-	struct CDCBUFFPTR* pb;
-	uint8_t* pc;
-
-	/* Minimum of 2 buffers required */
-	if (numbuff < 2)
-	{ // Here, we force 2, but we *could* just bomb, but what if the hapless Programmer
-		// doesn't check the return!
-		morse_trap(201);
-	}
 	/* Miminum of one char for the buffer (is this a duh?) */
 	if (size == 0)
 	{
 		morse_trap(202);
 	}
-taskENTER_CRITICAL();
-
-dbgflash4 = calloc(8, sizeof(uint32_t));
-memset (dbgflash4,0xcc,4*8); // Easy id
-
-	pb = calloc(numbuff, sizeof(struct CDCBUFFPTR));
-	if (pb == NULL)  morse_trap(203);
-
-dbgflash1 = pb;
-
-	/* Array of pointers to byte buffers. */
-	pbuff_begin = pb;
-	pbuff_end   = pbuff_begin;
-	pbuff_end  += numbuff;
-
-	/* Get memory for byte buffer. */
-// Debug: add padding of 64
-	pc = calloc(numbuff, size * sizeof(uint8_t) + 128);
-	if (pc == NULL) morse_trap(204);
-
-memset(pc,0x7,size * sizeof(uint8_t) + 128);
-dbgflash2 = pc;
-
-	/* Init array of pointers to byte buffers. */
-	uint8_t k;
-	for (k = 0; k < numbuff; k++)
-	{
-		(pb+k)->begin = (pc+k*size);
-		(pb+k)->work  = (pc+k*size);
-		(pb+k)->end   = (pc+k*size+size);
-dbgflash3 = (pb+k)->end;
-	}
+	if (cdc_txdbl_init(&cdctxdbl, size) != 0) morse_trap(204);
 
-if (dbgflash3 < (uint8_t*)0x20000000 ) morse_trap(205);
+	cdctxmutex = xSemaphoreCreateMutex();
+	if (cdctxmutex == NULL) morse_trap(203);
 
-taskEXIT_CRITICAL();
-	/* Init pointers for adding/taking */
-	pbuff_m = pbuff_begin;	// Adding
-	pbuff_i = pbuff_begin;	// Taking
-	pbuff_i += numbuff;		//  (initially one behind Adding)
+	cdctxfree = xSemaphoreCreateBinary();
+	if (cdctxfree == NULL) morse_trap(205);
 
-   return pbuff_m;	// Probably not used except for debugging
+   return &cdctxdbl;
 }
-/** ****************************************************************************
-  * uint32_t cdc_txbuff_poll(void);
-  * @brief	: Start USBD sending if it is not busy
-  * @return	: 0 = busy; 1 = new buffer started sending; 2 = no new data to send
-  *****************************************************************************
-  */
-static uint32_t poll(void);
-static volatile uint32_t cdcaddbusy = 0;	// 0 = cdc_txbuff_add routine not active; 1 = in process
-
-uint32_t cdc_txbuff_poll(void)
+/* *****************************************************************************
+  Start a transfer the double buffer handed back (interrupts masked)
+********************************************************************************/
+static void start(struct CDCTXDBLXFER* px)
 {
-	cdcaddbusy = 1;	// Show callback that adding data is active
-	uint32_t ret = poll();
-	cdcaddbusy = 0;	// Done adding	
-	return ret;
+	if (CDC_Transmit_FS(px->pbuf, px->len) != USBD_OK)
+		cdc_txdbl_failed(&cdctxdbl, px);
+	return;
 }
-
-uint32_t cdcct5;
-
-/* static version called by callback */
-static uint32_t poll(void)
+/** ****************************************************************************
+  * uint8_t* cdc_txbuff_reserve(uint16_t n);
+  * @brief	: Get space to format 'n' bytes in place; hold until 'cdc_txbuff_commit'
+  * @param	: n = bytes wanted
+  * @return	: pointer to write at; NULL = timed out, or 'n' larger than a buffer
+  ******************************************************************************
+  */
+uint8_t* cdc_txbuff_reserve(uint16_t n)
 {
-	struct CDCBUFFPTR* pbuff_tmp;
+	uint8_t* p;
+	TickType_t t0;
+	TickType_t dt;
 
-	/* Return if caught up with buffer ptrs AND no new data */
-	pbuff_tmp = step_ptr(pbuff_i);	// Advance last sent ptr JIC
-	if ((pbuff_m == pbuff_tmp)	&& ((pbuff_m->work - pbuff_m->begin) == 0)) return 2;
+	if (n > cdctxdbl.size) return NULL;
+	if (xSemaphoreTake(cdctxmutex, CDCTXWAIT) != pdTRUE) return NULL;
 
-	/* Start next buffer sending if USBD is ready */
-	if ((CDC_Transmit_FS( (uint8_t*)pbuff_tmp->begin, (pbuff_tmp->work - pbuff_tmp->begin))) == USBD_OK)
-	{ // Here, not busy, AND sending of next-buffer-to-send has been started
-cdcct5 +=1;	// DEBUG: Count number of buffer "sends"
-		pbuff_i = pbuff_tmp;	// Save buffer pointer being sent
-		pbuff_i->work = pbuff_i->begin;  // Reset char pointer for buffer just sent
-		if (pbuff_m == pbuff_i)
+	t0 = xTaskGetTickCount();
+	for (;;)
+	{
+		taskENTER_CRITICAL();
+		p = cdc_txdbl_reserve(&cdctxdbl, n);
+		taskEXIT_CRITICAL();
+		if (p != NULL)
 		{
-			pbuff_m = step_ptr(pbuff_m);
-			pbuff_m->work = pbuff_m->begin;
+			stalled = 0;
+			return p;
 		}
-		return 1;
+		/* Don't wait again if the USB (e.g. unplugged) has not moved. */
+		if ((stalled != 0) && (stallxfers == cdctxdbl.stats.xfers))
+			break;
+
+		/* Both buffers full: TX complete frees one. A give left over from
+		   an earlier TX complete only costs one more try. */
+		dt = xTaskGetTickCount() - t0;
+		if (dt >= CDCTXWAIT) break;
+		xSemaphoreTake(cdctxfree, CDCTXWAIT - dt);
 	}
-	return 0;	
+	stalled    = 1;
+	stallxfers = cdctxdbl.stats.xfers;
+	xSemaphoreGive(cdctxmutex);
+	return NULL;
 }
-/* *************************************************************************
- * void StartCdcTxTaskSend(void const * argument);
- *	@brief	: Task startup
- * *************************************************************************/
-void StartCdcTxTaskSend(void const * argument)
+/** ****************************************************************************
+  * void cdc_txbuff_commit(uint16_t n);
+  * @brief	: Bytes written at 'cdc_txbuff_reserve' pointer are ready; start USB if idle
+  * @param	: n = bytes actually written (0 - number reserved)
+  ******************************************************************************
+  */
+void cdc_txbuff_commit(uint16_t n)
 {
-	BaseType_t Qret;	// queue receive return
-	struct CDCTXTASKBCB   ssb; // Copied item from queue
+	struct CDCTXDBLXFER x;
 
-  /* Infinite RTOS Task loop */
-  for(;;)
-  {
-		do
-		{
-		/* Wait indefinitely for someone to load something into the queue */
-		/* Skip over empty returns, and NULL pointers that would cause trouble */
-			Qret = xQueueReceive(CdcTxTaskSendQHandle,&ssb,portMAX_DELAY);
-			if (Qret == pdPASS) // Break loop if not empty
-				break;
-		} while ( (ssb.pbuf == NULL) || (ssb.size == 0));
-	   cdc_txbuff_add(&ssb);  // Add data to local cdc tx buffer
-  }
-  return;
+	taskENTER_CRITICAL();
+	if (cdc_txdbl_commit(&cdctxdbl, n, &x) != 0)
+		start(&x);
+	taskEXIT_CRITICAL();
+
+	xSemaphoreGive(cdctxmutex);
+	return;
 }
-		
 /** ****************************************************************************
-  * static uint32_t cdc_txbuff_add(struct CDCTXTASKBCB* p);
-  * @brief	: Add chars to buffer and start USBD TX if not busy
-  * @param	: p = pointer data/size to be added
-  * @return	: number chars added to buffer;
+  * uint32_t cdc_txbuff_add(uint8_t* pbuf, uint16_t n);
+  * @brief	: Copy bytes already formatted elsewhere (reserve, copy, commit)
+  * @param	: pbuf = pointer to bytes
+  * @param	: n = number of bytes
+  * @return	: number of bytes added; 0 = no room
   ******************************************************************************
   */
-uint32_t cdcct3;
-uint32_t cdcct4;
-uint32_t cdcT0;
-uint32_t cdcMax;
-
-static uint32_t cdc_txbuff_add(struct CDCTXTASKBCB* p)
+uint32_t cdc_txbuff_add(uint8_t* pbuf, uint16_t n)
 {
-	cdcaddbusy = 1;	// Show callback that adding data is active
-	uint16_t csize = 0;	// Count of chars added
-
-	/* Add data to current buffer */
- 	while (p->size > 0)
-   {
-		// Copy into current "add-to" buffer
-		*pbuff_m->work++ = *p->pbuf++;
-		p->size -= 1;	// Count down chars copied
-
-		if (pbuff_m->work == pbuff_m->end) // End of local buffer?
-		{ // Here, yes
-			pbuff_m = step_ptr(pbuff_m);	// Advance ptr to next buff
-			pbuff_m->work = pbuff_m->begin; // Start at beginning 
-			if (pbuff_m == pbuff_i)
-			{ // Here, we point to output buffer; about to OVERRUN
-cdcct4 += 1;	// DEBUG: Count number of instances
-#include "DTW_counter.h"
-cdcT0 = DTWTIME;	// DEBUG: Time wasted in loop
-//$				while(poll() == 0)	// Loop until buffer is free   
-					poll();
-				{
-cdcct3+=1;	// DEBUG: count loops
-					
-				}
-// DEBUG: time wasted in loop
-cdcT0 = DTWTIME - cdcT0;
-cdcMax += cdcT0;
-			}
-		}
-		csize += 1;
-	}
-
-	/* All chars in the input string were added to the buffer. */
-	cdc_txbuff_poll();	// Start sending if not already sending   
-
-	cdcaddbusy = 0;	// Done adding	
-	return csize;
+	uint8_t* p = cdc_txbuff_reserve(n);
+	if (p == NULL) return 0;
+	memcpy(p, pbuf, n);
+	cdc_txbuff_commit(n);
+	return n;
 }
 /** ############################################################################
-  * void cdc_txbuff_callback(void const * argument);
-  * @brief	: Send next buffer, if available NOTE: routine is under CDC interrupt
+  * void cdc_txbuff_txcplt(void);
+  * @brief	: USB TX complete: start the buffer filled meanwhile (under USB interrupt)
   ##############################################################################
   */
 /*
- For modified HAL:
-	This routine is entered when the USB is complete and the busy has been set 
-   to zero. 
-	Entry is from 'usbd_cdc.c'  See routine beginning at line 664.
-
- For unmodified HAL, use timer polling:
-	Entry is from software timer callback (in 'main')
+	Entry is from 'CDC_TransmitCplt_FS' (usbd_cdc_if.c), which 'usbd_cdc.c'
+	calls with TxState already set back to zero.
 */
-int cdcct1 = 0;
-int cdcct2 = 0;
-
-void cdc_txbuff_callback(void const * argument)
+void cdc_txbuff_txcplt(void)
 {
-	if (cdcaddbusy != 0)
-	{ // Here, 'cdc_txbuff_add' is busy adding chars to a buffer
-cdcct2 += 1;
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+	struct CDCTXDBLXFER x;
+	UBaseType_t s = taskENTER_CRITICAL_FROM_ISR();
 
-		return;
-	}
-cdcct1 += 1;
-	poll();	// Send next buffer, if available
+	if (cdc_txdbl_cplt(&cdctxdbl, &x) != 0)
+		start(&x);
+
+	taskEXIT_CRITICAL_FROM_ISR(s);
+
+	/* Wake a task waiting in 'cdc_txbuff_reserve' */
+	xSemaphoreGiveFromISR(cdctxfree, &xHigherPriorityTaskWoken);
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 	return;
 }
-
@@ -6,55 +6,46 @@
 Updates:
 
 2018 12 30 Multiple Tasks can call, plus timer polling (allows unmodified HAL code)
-   
+2026 10 19 Double buffer swapped on TX complete; no task, queue, or timer (see cdc_txdbl.h)
+
 */
 #ifndef CDC_TXBUFF_H
 #define CDC_TXBUFF_H
 
 #include "FreeRTOS.h"
 #include "task.h"
-#include "queue.h"
+#include "semphr.h"
 #include "cmsis_os.h"
 #include "stm32f4xx_hal.h"
+#include "cdc_txdbl.h"
 
-/* Pointers for each local buffer */
-struct CDCBUFFPTR
-{
-   uint8_t* begin;
-   uint8_t* end;
-   uint8_t* work;
-};
-
-/* Queue of Buffer Control Blocks */
-struct CDCTXTASKBCB
-{
-	uint8_t	*pbuf;             // Pointer to byte buffer to be sent
-	uint32_t size;              // Number of bytes to be sent
-};
+#define CDCTXWAIT 8	// Max ticks to wait for a buffer to free up
 
 /** ****************************************************************************/
-  struct CDCBUFFPTR* cdc_txbuff_init(uint16_t numbuff, uint16_t size);
+  struct CDCTXDBL* cdc_txbuff_init(uint16_t size);
  /* @brief	: Setup buffer pair for CDC TX
-  * @param	: numbuff = number of buffers (of size 'size')
-  * @param	: size = number of bytes in each buffer
-  * @return	: NULL = calloc failed; not NULL = pointer to 1st struct with buff ptrs
+  * @param	: size = number of bytes in each buffer (multiple of usb packet size best)
+  * @return	: pointer to double buffer (stats)
   ******************************************************************************/
- osMessageQId xCdcTxTaskSendCreate(uint32_t taskpriority);
-/* @brief	: Create task; task handle created is global for all to enjoy!
- * @param	: taskpriority = Task priority (just as it says!)
- * @return	: Handle to queue
+uint8_t* cdc_txbuff_reserve(uint16_t n);
+/* @brief	: Get space to format 'n' bytes in place; hold until 'cdc_txbuff_commit'
+ * @param	: n = bytes wanted
+ * @return	: pointer to write at; NULL = timed out, or 'n' larger than a buffer
  * *****************************************************************************/
-  uint32_t cdc_txbuff_poll(void);
- /* @brief	: Start USBD sending if it is not busy
-  * @return	: 0 = busy; 1 = new buffer started sending
-  ******************************************************************************/
-void StartCdcTxTaskSend(void const * argument);
-/*	@brief	: Task startup
+void cdc_txbuff_commit(uint16_t n);
+/* @brief	: Bytes written at 'cdc_txbuff_reserve' pointer are ready; start USB if idle
+ * @param	: n = bytes actually written (0 - number reserved)
+ * *****************************************************************************/
+uint32_t cdc_txbuff_add(uint8_t* pbuf, uint16_t n);
+/* @brief	: Copy bytes already formatted elsewhere (reserve, copy, commit)
+ * @param	: pbuf = pointer to bytes
+ * @param	: n = number of bytes
+ * @return	: number of bytes added; 0 = no room
+ * *****************************************************************************/
+void cdc_txbuff_txcplt(void);
+/* @brief	: USB TX complete: start the buffer filled meanwhile (under USB interrupt)
  * *****************************************************************************/
 
-extern osMessageQId CdcTxTaskSendQHandle;
-extern osThreadId CdcTxTaskSendHandle;
-
-
+extern struct CDCTXDBL cdctxdbl;
 
 #endif
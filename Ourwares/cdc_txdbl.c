@@ -0,0 +1,133 @@
+/******************************************************************************
+* File Name          : cdc_txdbl.c
+* Date First Issued  : 10/19/2026
+* Description        : USB-CDC TX double buffer state machine
+*******************************************************************************/
+/*
+States (fill buffer 'F', other buffer 'S'):
+  idle:     busy = 0; F empty, or a producer has it reserved
+  sending:  busy = 1; the USB owns S; producers add to F
+A commit with the USB idle, or a TX complete with F not empty and not
+reserved, swaps: F goes to the USB, S (finished) becomes the empty F.
+
+While the USB is sending, F fills up to 'size'.  A transfer of 'ct' bytes
+goes as ct/64 full packets and one short (or zero length) packet, so the
+more that piles up while the USB is busy the fewer packets are short.
+*/
+#include <stdlib.h>
+#include "cdc_txdbl.h"
+
+/* *************************************************************************
+ * int cdc_txdbl_init(struct CDCTXDBL* p, uint16_t size);
+ * @brief	: Allocate the two buffers, and reset
+ * @param	: p = pointer to double buffer struct
+ * @param	: size = bytes per buffer (rounded up to a multiple of CDCTXDBLPKT)
+ * @return	: 0 = OK; -1 = size zero; -2 = calloc failed
+ * *************************************************************************/
+int cdc_txdbl_init(struct CDCTXDBL* p, uint16_t size)
+{
+	if (size == 0) return -1;
+	size = (size + (CDCTXDBLPKT - 1)) & ~(CDCTXDBLPKT - 1);
+
+	p->pbuf[0] = (uint8_t*)calloc(2, size);
+	if (p->pbuf[0] == NULL) return -2;
+	p->pbuf[1] = p->pbuf[0] + size;
+
+	p->ct[0] = 0;
+	p->ct[1] = 0;
+	p->size  = size;
+	p->fill  = 0;
+	p->busy  = 0;
+	p->resv  = 0;
+	p->stats.xfers   = 0;
+	p->stats.bytes   = 0;
+	p->stats.full    = 0;
+	p->stats.chained = 0;
+	p->stats.failed  = 0;
+	return 0;
+}
+/* *************************************************************************
+ * static void swap(struct CDCTXDBL* p, struct CDCTXDBLXFER* px);
+ * @brief	: Hand the fill buffer to the USB, and start filling the other
+ * *************************************************************************/
+static void swap(struct CDCTXDBL* p, struct CDCTXDBLXFER* px)
+{
+	uint8_t f = p->fill;
+
+	px->pbuf = p->pbuf[f];
+	px->len  = p->ct[f];
+	f ^= 1;
+	p->ct[f] = 0;
+	p->fill  = f;
+	p->busy  = 1;
+	p->stats.xfers += 1;
+	p->stats.bytes += px->len;
+	return;
+}
+/* *************************************************************************
+ * uint8_t* cdc_txdbl_reserve(struct CDCTXDBL* p, uint16_t n);
+ * @brief	: Producer: get space for 'n' bytes in the fill buffer
+ * @param	: p = pointer to double buffer struct
+ * @param	: n = bytes wanted
+ * @return	: pointer to write at; NULL = no room (or already reserved)
+ * *************************************************************************/
+uint8_t* cdc_txdbl_reserve(struct CDCTXDBL* p, uint16_t n)
+{
+	uint8_t f = p->fill;
+
+	if (p->resv != 0) return NULL;
+	if ((p->ct[f] + n) > p->size)
+	{
+		p->stats.full += 1;
+		return NULL;
+	}
+	p->resv = 1;
+	return (p->pbuf[f] + p->ct[f]);
+}
+/* *************************************************************************
+ * int cdc_txdbl_commit(struct CDCTXDBL* p, uint16_t n, struct CDCTXDBLXFER* px);
+ * @brief	: Producer: 'n' bytes written at the reserved pointer (n may be 0)
+ * @param	: p = pointer to double buffer struct
+ * @param	: n = bytes actually written (not more than reserved)
+ * @param	: px = pointer to transfer to start, if USB idle
+ * @return	: 1 = start 'px' now; 0 = nothing to start
+ * *************************************************************************/
+int cdc_txdbl_commit(struct CDCTXDBL* p, uint16_t n, struct CDCTXDBLXFER* px)
+{
+	p->ct[p->fill] += n;
+	p->resv = 0;
+
+	/* A TX complete while reserved left the start to us. */
+	if ((p->busy != 0) || (p->ct[p->fill] == 0)) return 0;
+	swap(p, px);
+	return 1;
+}
+/* *************************************************************************
+ * int cdc_txdbl_cplt(struct CDCTXDBL* p, struct CDCTXDBLXFER* px);
+ * @brief	: USB TX complete: swap and start the filled buffer
+ * @param	: p = pointer to double buffer struct
+ * @param	: px = pointer to transfer to start
+ * @return	: 1 = start 'px' now; 0 = nothing to start (or producer will)
+ * *************************************************************************/
+int cdc_txdbl_cplt(struct CDCTXDBL* p, struct CDCTXDBLXFER* px)
+{
+	p->busy = 0;
+	if ((p->resv != 0) || (p->ct[p->fill] == 0)) return 0;
+	swap(p, px);
+	p->stats.chained += 1;
+	return 1;
+}
+/* *************************************************************************
+ * void cdc_txdbl_failed(struct CDCTXDBL* p, struct CDCTXDBLXFER* px);
+ * @brief	: The transfer from 'commit' or 'cplt' did not start: discard it
+ * @param	: p = pointer to double buffer struct
+ * @param	: px = pointer to transfer that failed
+ * *************************************************************************/
+void cdc_txdbl_failed(struct CDCTXDBL* p, struct CDCTXDBLXFER* px)
+{
+	p->busy = 0;
+	p->stats.failed += 1;
+	p->stats.xfers  -= 1;
+	p->stats.bytes  -= px->len;
+	return;
+}
@@ -0,0 +1,85 @@
+/******************************************************************************
+* File Name          : cdc_txdbl.h
+* Date First Issued  : 10/19/2026
+* Description        : USB-CDC TX double buffer state machine
+*******************************************************************************/
+/*
+Two buffers: producers format into the 'fill' buffer in place, while the
+USB sends the other one.  When the USB finishes (TX complete callback) the
+buffers swap and the filled one starts sending at once, so there is no
+polling timer and no copy into a separate send buffer.
+
+Nothing here touches the RTOS or HAL.  All calls are made with the USB
+interrupt masked (see 'cdc_txbuff.c'), except that the producer writes the
+bytes it reserved with interrupts enabled; the 'resv' flag keeps the
+callback from swapping that buffer out from under it.  One producer at a
+time.
+*/
+
+#ifndef __CDC_TXDBL
+#define __CDC_TXDBL
+
+#include <stdint.h>
+
+#define CDCTXDBLPKT 64 // USB full speed bulk packet size (CDC_DATA_FS_MAX_PACKET_SIZE)
+
+/* Transfer to start (returned by 'commit' and 'cplt') */
+struct CDCTXDBLXFER
+{
+	uint8_t* pbuf;
+	uint16_t len;
+};
+
+struct CDCTXDBLSTATS
+{
+	uint32_t xfers;   // Transfers started
+	uint32_t bytes;   // Bytes in those transfers
+	uint32_t full;    // 'reserve' refused: no room until the USB finishes
+	uint32_t chained; // Transfers started by the TX complete callback
+	uint32_t failed;  // Transfers the USB would not start (bytes discarded)
+};
+
+struct CDCTXDBL
+{
+	uint8_t* pbuf[2];          // Buffers [size]
+	volatile uint16_t ct[2];   // Bytes in each buffer
+	uint16_t size;             // Bytes in each buffer (multiple of CDCTXDBLPKT)
+	volatile uint8_t fill;     // Buffer producers add to (0, 1)
+	volatile uint8_t busy;     // 1 = USB sending the other buffer
+	volatile uint8_t resv;     // 1 = producer writing into 'fill'
+	struct CDCTXDBLSTATS stats;
+};
+
+/* *************************************************************************/
+int cdc_txdbl_init(struct CDCTXDBL* p, uint16_t size);
+/* @brief	: Allocate the two buffers, and reset
+ * @param	: p = pointer to double buffer struct
+ * @param	: size = bytes per buffer (rounded up to a multiple of CDCTXDBLPKT)
+ * @return	: 0 = OK; -1 = size zero; -2 = calloc failed
+ * *************************************************************************/
+uint8_t* cdc_txdbl_reserve(struct CDCTXDBL* p, uint16_t n);
+/* @brief	: Producer: get space for 'n' bytes in the fill buffer
+ * @param	: p = pointer to double buffer struct
+ * @param	: n = bytes wanted
+ * @return	: pointer to write at; NULL = no room (or already reserved)
+ * *************************************************************************/
+int cdc_txdbl_commit(struct CDCTXDBL* p, uint16_t n, struct CDCTXDBLXFER* px);
+/* @brief	: Producer: 'n' bytes written at the reserved pointer (n may be 0)
+ * @param	: p = pointer to double buffer struct
+ * @param	: n = bytes actually written (not more than reserved)
+ * @param	: px = pointer to transfer to start, if USB idle
+ * @return	: 1 = start 'px' now; 0 = nothing to start
+ * *************************************************************************/
+int cdc_txdbl_cplt(struct CDCTXDBL* p, struct CDCTXDBLXFER* px);
+/* @brief	: USB TX complete: swap and start the filled buffer
+ * @param	: p = pointer to double buffer struct
+ * @param	: px = pointer to transfer to start
+ * @return	: 1 = start 'px' now; 0 = nothing to start (or producer will)
+ * *************************************************************************/
+void cdc_txdbl_failed(struct CDCTXDBL* p, struct CDCTXDBLXFER* px);
+/* @brief	: The transfer from 'commit' or 'cplt' did not start: discard it
+ * @param	: p = pointer to double buffer struct
+ * @param	: px = pointer to transfer that failed
+ * *************************************************************************/
+
+#endif
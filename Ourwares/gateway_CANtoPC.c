@@ -7,21 +7,39 @@
 /*
 Implements LINK_MODE 2 (see PC_gateway_comm and USB_PC_gateway, in svn_common/trunk)
 and see gateway_format.txt in svn_discovery/docs/trunk/Userdocs)
+
+The binary mode sends the same bytes (sequence number, id, dlc, payload,
+checksum) as the ascii/hex line, but byte stuffed and framed by 'PC_msg_prep'
+instead of hex and newline.  Both use the one sequence number.
 */
+#include <string.h>
 #include "gateway_CANtoPC.h"
+#include "PC_gateway_comm.h"
+#include "hexcodec.h"
 
 static uint8_t seq = 0; // Running sequence number for checking for missing CAN msgs
 
 /* **************************************************************************************
- * static char* hex(char *p, u8 c)	// Convert 'c' to hex, placing in output *p.
+ * static int rawmsg(uint8_t* b, struct CANRCVBUF* pcan);
+ * @brief	: Sequence number, id, dlc, payload as bytes (both formats)
+ * @param	: b = pointer to output [1 + 4 + 1 + 8 + 1] (room for checksum)
+ * @param	: pcan = CAN msg
+ * @return	: number of bytes (without checksum)
  * ************************************************************************************** */
-/* bin to ascii lookup table */
-static const char h[16] = {'0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F'};
-static uint8_t* hex(uint8_t *p, uint8_t c)	// Convert 'c' to hex, placing in output *p.
+static int rawmsg(uint8_t* b, struct CANRCVBUF* pcan)
 {
-		*p++ = h[((c >> 4) & 0x0f)];	// Hi order nibble
-		*p++ = h[(c & 0x0f)];		// Lo order nibble
-		return p;			// Return new output pointer position
+	if ((pcan->dlc & 0xf) > 8) pcan->dlc = 8; // Prevent bogus runaway
+
+	b[0] = seq;
+	seq += 1;
+	b[1] = (pcan->id >>  0);
+	b[2] = (pcan->id >>  8);
+	b[3] = (pcan->id >> 16);
+	b[4] = (pcan->id >> 24);
+	b[5] = pcan->dlc;
+	memcpy(&b[6], pcan->cd.uc, 8); // All 8 (fixed size copy); 'dlc' says how many count
+
+	return (6 + pcan->dlc);
 }
 /* **************************************************************************************
  * void gateway_CANtoPC(struct SERIALSENDTASKBCB** ppbcb, struct CANRCVBUF* pcan);
@@ -33,40 +51,16 @@ static uint8_t* hex(uint8_t *p, uint8_t c)	// Convert 'c' to hex, placing in out
 void gateway_CANtoPC(struct SERIALSENDTASKBCB** ppbcb, struct CANRCVBUF* pcan)
 {
 	struct SERIALSENDTASKBCB* pbcb = *ppbcb;
-	int i;
-	uint32_t x = CHECKSUM_INITIAL;
+	uint8_t b[1 + 4 + 1 + 8 + 1]; // Binary msg, with checksum
 	uint8_t* pout = pbcb->pbuf; // Pointer into output buffer
+	int n;
 
-	/* Convert sequence number */
-	x += seq;	// Checksum;
-	pout = hex(pout,seq);
-	seq += 1;
-
-	/* Convert CAN ID */
-	x += (pcan->id >>  0) & 0xff; pout = hex(pout, (pcan->id >>  0));
-	x += (pcan->id >>  8) & 0xff; pout = hex(pout, (pcan->id >>  8));
-	x += (pcan->id >> 16) & 0xff; pout = hex(pout, (pcan->id >> 16));
-	x += (pcan->id >> 24) & 0xff; pout = hex(pout, (pcan->id >> 24));
-
-	/* Convert DLC */
-	x += pcan->dlc & 0xf; pout = hex(pout, pcan->dlc);
-
-	/* Convert payload */
-	if ((pcan->dlc & 0xf) > 8) pcan->dlc = 8; // Prevent bogus runaway
-	for (i = 0; i < pcan->dlc; i++)
-	{
-		x += pcan->cd.uc[i];
-		pout = hex(pout, pcan->cd.uc[i]);
-	}
-
-	/* Complete checksum */
-	x += (x >> 16);	// Add carries into high half word
-	x += (x >> 16);	// Add carry if previous add generated a carry
-	x += (x >> 8);  // Add high byte of low half word
-	x += (x >> 8);  // Add carry if previous add generated a carry
+	/* Sequence number, id, dlc, payload, and checksum */
+	n = rawmsg(b, pcan);
+	b[n] = CANgenchksum(b, n);
 
-	/* Convert checksum */
-	pout = hex(pout, x);
+	/* Whole msg to ascii/hex */
+	pout += hexcodec_encode((char*)pout, b, (n + 1));
 
 	/* Frame terminator */
 	*pout++ = ASCIIMSGTERMINATOR;
@@ -79,6 +73,26 @@ void gateway_CANtoPC(struct SERIALSENDTASKBCB** ppbcb, struct CANRCVBUF* pcan)
 
 	return;
 }
+/* **************************************************************************************
+ * int gateway_CANtoPC_bin(uint8_t* pout, int outsize, struct CANRCVBUF* pcan);
+ * @brief	: Convert CAN msg into a byte stuffed binary frame (see 'PC_msg_prep')
+ * @param	: pout = pointer to output (frames can be placed back to back)
+ * @param	: outsize = bytes available at 'pout'
+ * @param	: pcan = CAN msg
+ * @return	: number of bytes in frame; 0 = 'outsize' less than GATEWAYBINMAX
+ * ************************************************************************************** */
+int gateway_CANtoPC_bin(uint8_t* pout, int outsize, struct CANRCVBUF* pcan)
+{
+	uint8_t b[1 + 4 + 1 + 8 + 1]; // Binary msg before stuffing
+	int n;
+
+	if (outsize < GATEWAYBINMAX) return 0;
+
+	n = rawmsg(b, pcan);
+
+	/* Stuffing, checksum and frame end */
+	return PC_msg_prep(pout, outsize, b, n);
+}
 #ifdef CHECKSUMCODEFORREFERENCE
 /* **************************************************************************************
  * u8 CANgenchksum(u8* p, int ct);
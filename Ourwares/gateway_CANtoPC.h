@@ -12,6 +12,9 @@
 #include "getserialbuf.h"
 #include "common_can.h"
 
+/* Binary frame: seq, id (4), dlc, payload (8), checksum, each maybe escaped, plus frame end */
+#define GATEWAYBINMAX ((1 + 4 + 1 + 8 + 1) * 2 + 1)
+
 /* **************************************************************************************/
 void gateway_CANtoPC(struct SERIALSENDTASKBCB** ppbcb, struct CANRCVBUF* pcan);
 /* @brief	: Convert CAN msg into ascii/hex in a buffer for SerialTaskSend
@@ -19,5 +22,12 @@ void gateway_CANtoPC(struct SERIALSENDTASKBCB** ppbcb, struct CANRCVBUF* pcan);
  * @param	: pcan = CAN msg
  * @return	: 
  * ************************************************************************************** */
+int gateway_CANtoPC_bin(uint8_t* pout, int outsize, struct CANRCVBUF* pcan);
+/* @brief	: Convert CAN msg into a byte stuffed binary frame (see 'PC_msg_prep')
+ * @param	: pout = pointer to output (frames can be placed back to back)
+ * @param	: outsize = bytes available at 'pout'
+ * @param	: pcan = CAN msg
+ * @return	: number of bytes in frame; 0 = 'outsize' less than GATEWAYBINMAX
+ * ************************************************************************************** */
 
 #endif
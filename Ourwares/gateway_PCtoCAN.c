@@ -6,33 +6,102 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "gateway_PCtoCAN.h"
+#include "PC_gateway_comm.h"
+#include "hexcodec.h"
 #include "malloc.h"
 
 /*
 struct GATEWAYPCTOCAN
 {
-	struct CANRCVBUF*	pcan; // Ptr into buffer for received CAN msg
-	uint32_t chksumx;       // Checksum in progress
+	struct CANRCVBUFPLUS*	pcanp; // Ptr into buffer for received CAN Plus msg
+	char asc[GATEWAYPCTOCANASC]; // Ascii/hex chars of line in progress
 	uint8_t binseq;         // Received sequence number (binary)
 	uint8_t ctrseq;			// Software maintained sequence number
-	uint8_t state;          // State of decoding
 	uint8_t error;          // Error code: 0 = no errors
-	uint8_t bin;            // Bin byte in progress
-	uint8_t odd;            // Nibble: Odd = 1, even = 0;
-	uint8_t ctr;            // Data storing counter
+	uint8_t ctr;            // Chars in line (stops at 255)
 };
 */
 
 static void new_init(struct GATEWAYPCTOCAN* p)
 {
 	/* Initialize for new CAN msg construction */
-	p->state   = 0;
 	p->error   = 0;
 	p->ctr     = 0;
-	p->odd     = 1;
-	p->chksumx = CHECKSUM_INITIAL;	// Checksum initial value
 	return;
 }
+/* **************************************************************************************
+ * uint8_t gateway_PCtoCAN_line(struct GATEWAYPCTOCAN* p, struct CANRCVBUF* pcan);
+ * @brief	: Decode the ascii/hex line collected in 'p->asc' to a CAN msg
+ * @param	: p = pointer to decode block ('ctr' chars in 'asc')
+ * @param	: pcan = pointer to CAN msg output
+ * @return	: error bits (PCTOCAN_ERR_...), also or'ed into 'p->error'
+ * ************************************************************************************** */
+/*
+The whole line is decoded in one pass (hexcodec), then unpacked:
+  seq, id (4, low byte first), dlc, payload (dlc), checksum
+Previously a char that was not hex was read as zero.
+*/
+uint8_t gateway_PCtoCAN_line(struct GATEWAYPCTOCAN* p, struct CANRCVBUF* pcan)
+{
+	uint8_t b[GATEWAYPCTOCANASC / 2];
+	uint8_t err = 0;
+	int nc = p->ctr;
+	int n;
+	int i;
+
+	if (nc > GATEWAYPCTOCANASC)
+	{ // Chars past the longest msg were not saved
+		err |= PCTOCAN_ERR_TOOMANY;
+		nc = GATEWAYPCTOCANASC;
+	}
+	if ((nc & 1) != 0)
+	{ // Odd char count: last nibble is dangling
+		err |= PCTOCAN_ERR_SHORT;
+		nc -= 1;
+	}
+	if (hexcodec_decode(b, p->asc, nc) < 0)
+		err |= PCTOCAN_ERR_NOTHEX;
+	n = nc >> 1;
+
+	if (n < 7)
+	{ // Here, not even seq, id, dlc, checksum
+		p->error |= (err | PCTOCAN_ERR_SHORT);
+		return p->error;
+	}
+	p->binseq = b[0];
+	pcan->id  = b[1] | (b[2] << 8) | (b[3] << 16) | (b[4] << 24);
+	pcan->dlc = b[5];
+	if (pcan->dlc > 8)
+	{ // DLC too large.
+		pcan->dlc = 8; //Do not overrun array!
+		err |= PCTOCAN_ERR_DLC;
+	}
+	for (i = 0; (i < pcan->dlc) && ((6 + i) < n); i++)
+		pcan->cd.uc[i] = b[6 + i];
+
+	if (n < (7 + (int)pcan->dlc))
+	{
+		err |= PCTOCAN_ERR_SHORT;
+	}
+	else
+	{
+		if (n > (7 + (int)pcan->dlc))
+			err |= PCTOCAN_ERR_TOOMANY;
+
+		if (CANgenchksum(b, (6 + pcan->dlc)) != b[6 + pcan->dlc])
+			err |= PCTOCAN_ERR_CHKSUM;
+
+		/* Check for missing msgs. */
+		p->ctrseq += 1;	// Advance software maintained sequence number
+		if (p->binseq != p->ctrseq)
+		{
+			err |= PCTOCAN_ERR_SEQ;	// Sequence number mismatch
+			p->ctrseq = p->binseq; // Reset
+		}
+	}
+	p->error |= err;
+	return p->error;
+}
 /* **************************************************************************************
  * struct GATEWAYPCTOCAN* gateway_PCtoCAN_init(struct SERIALRCVBCB* prbcb);
  * @brief	: Get decode block calloc'd and initialized
@@ -57,7 +126,7 @@ struct GATEWAYPCTOCAN* gateway_PCtoCAN_init(struct SERIALRCVBCB* prbcb)
  * @brief	: build CAN msgs and add to line buffers for dma data available
  * @return	: prbcb->pgptc->error:
  *          :      0  = no errors
- *				: (1<<0) |=  1 not assigned
+ *				: (1<<0) |=  1 a char was not ascii/hex
  *          : (1<<1) |=  2 completed, but bad checksum
  *  		   : (1<<2) |=  4 line terminator and state sequence not complete
  *		      : (1<<3) |=  8 sequence number did not mismatch
@@ -69,33 +138,10 @@ incoming ascii expects is--
 	seq,asciihex...,checksum, newline
 (seq = one byte sequence number converted to ascii/hex)
 (note: checksum is on the *binary* not ascii data):~/GliderWinch/sensor/gateway_ftdi/trunk
-and converts to binary data returned in--
-	ptr->c[]
-where--
-	ptr->ct = count of binary bytes of data.
+Chars are saved until the line terminator, then 'gateway_PCtoCAN_line'
+converts the whole line.
 */
 
-/* Lookup table to convert one hex char to binary (4 bits), no checking for illegal incoming hex */
-const uint8_t hexbin[256] = {
-/*          0   1   2   3   4   5   6   7   8   9  10  11  12  13  14  15   */
-/*  0  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/*  1  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/*  2  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/*  3  */   0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  0,  0,  0,  0,  0,  0,
-/*  4  */   0, 10, 11, 12, 13, 14, 15,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/*  5  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/*  6  */   0, 10, 11, 12, 13, 14, 15,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/*  7  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/*  8  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/*  9  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/* 10  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/* 11  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/* 12  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/* 13  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/* 14  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-/* 15  */   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-};
-
 void gateway_PCtoCAN_unloaddma(struct SERIALRCVBCB* prbcb)
 {	// Here, a DMA interrupt means there is new data in the DMA buffer
 
@@ -129,10 +175,7 @@ void gateway_PCtoCAN_unloaddma(struct SERIALRCVBCB* prbcb)
 		{ // Here End of Line
 			
 			/* End of line signals end of CAN msg; beginning of new.  */
-			if (p->state != 7) // Did it end correctly?
-			{ // Here, no.
-				p->error |= (1<<2);	// Line terminator came at wrong place.
-			}
+			gateway_PCtoCAN_line(p, &p->pcanp->can);
 
 			/* Give the user of the CAN msg some info. */
 			p->pcanp->seq   = p->binseq;
@@ -160,89 +203,11 @@ void gateway_PCtoCAN_unloaddma(struct SERIALRCVBCB* prbcb)
 			p->pcanp = (struct CANRCVBUFPLUS*)prbcb->padd;
 		}
 		else
-		{ // Not end-of-line.  Convert ascii/hex to binary bytes
-			if (p->odd == 1)
-			{ // High order nibble
-				p->odd = 0;
-				p->bin = hexbin[(uint8_t)c] << 4; // Lookup binary, given ascii
-			}
-			else
-			{ // Low order nibble completes byte
-				p->odd = 1;
-				p->bin |= hexbin[(uint8_t)c];
-				
-				/* Store binary bytes directly into CAN buffer location */
-				/* Build checksum as we go. */
-				switch(p->state)
-				{
-				case 0: // Sequence number
-					p->binseq   = p->bin;
-					p->chksumx += p->bin;
-					p->state   += 1;
-					break;
-				case 1: // Low order byte of CAN id word
-					p->pcanp->can.id   = (p->bin << 0);
-					p->state   += 1;
-					p->chksumx += p->bin;
-					break;
-				case 2:
-					p->pcanp->can.id  |= (p->bin << 8);
-					p->chksumx += p->bin;
-					p->state   += 1;
-					break;
-				case 3:
-					p->pcanp->can.id  |= (p->bin << 16);
-					p->chksumx += p->bin;
-					p->state   += 1;
-					break;
-				case 4: // High order byte of CAN id word
-					p->pcanp->can.id  |= (p->bin << 24);
-					p->chksumx += p->bin;
-					p->state   += 1;
-					break;
-				case 5: // DLC byte -> CAN msg dlc word
-					if (p->bin > 8)
-					{ // DLC too large.
-						p->bin = 8; //Do not overrun array!
-						p->error |= (1<<5);
-					}
-					p->pcanp->can.dlc = p->bin;
-					p->chksumx   += p->bin;
-					p->state     += 1;
-					break;
-				case 6: // Fill data bytes per dlc
-					if (p->ctr < p->pcanp->can.dlc)
-					{
-						p->pcanp->can.cd.uc[p->ctr] = p->bin;
-						p->chksumx += p->bin;
-						p->ctr     += 1;
-						break;
-					}
-					/* Here, checksum check.  Complete checksum calculation. */
-					p->chksumx += (p->chksumx >> 16); // Add carries into high half word
-					p->chksumx += (p->chksumx >> 16); // Add carry if previous add generated a carry
-					p->chksumx += (p->chksumx >> 8);  // Add high byte of low half word
-					p->chksumx += (p->chksumx >> 8);  // Add carry if previous add generated a carry
-					if ((p->chksumx & 0xff) != p->bin)
-					{ // Here, checksums mismatch
-						p->error |=  (1<<1);
-					}
-
-					/* Check for missing msgs. */
-					p->ctrseq += 1;	// Advance software maintained sequence number
-					if (p->binseq != p->ctrseq)
-					{
-						p->error  |= (1<<3);	// Sequence number mismatch
-						p->ctrseq = p->binseq; // Reset
-					}
-					p->state = 7;
-					break;
-
-				case 7:
-					p->error |= (1<<4); // Too many chars
-					break;
-				}		
-			}
+		{ // Not end-of-line.  Save char; the line is converted at the terminator
+			if (p->ctr < GATEWAYPCTOCANASC)
+				p->asc[p->ctr] = c;
+			if (p->ctr < 255)
+				p->ctr += 1;
 		}
 	}
 	return;
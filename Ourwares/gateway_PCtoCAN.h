@@ -9,7 +9,13 @@
 
 #include "SerialTaskReceive.h"
 
-
+/* CAN msg 'error' bits */
+#define PCTOCAN_ERR_NOTHEX  (1<<0) // A char was not ascii/hex
+#define PCTOCAN_ERR_CHKSUM  (1<<1) // Completed, but bad checksum
+#define PCTOCAN_ERR_SHORT   (1<<2) // Line terminator before msg complete
+#define PCTOCAN_ERR_SEQ     (1<<3) // Sequence number did not match
+#define PCTOCAN_ERR_TOOMANY (1<<4) // Too many chars
+#define PCTOCAN_ERR_DLC     (1<<5) // DLC greater than 8
 
 
 /* ************************************************************************************** */
@@ -17,7 +23,7 @@ void gateway_PCtoCAN_unloaddma(struct SERIALRCVBCB* prbcb);
 /* @brief	: build CAN msgs and add to line buffers for dma data available
  * @return	: prbcb->pgptc->error:
  *          :      0  = no errors
- *				: (1<<0) |=  1 not assigned
+ *				: (1<<0) |=  1 a char was not ascii/hex
  *          : (1<<1) |=  2 completed, but bad checksum
  *  		   : (1<<2) |=  4 line terminator and state sequence not complete
  *		      : (1<<3) |=  8 sequence number did not mismatch
@@ -29,6 +35,12 @@ struct GATEWAYPCTOCAN* gateway_PCtoCAN_init(struct SERIALRCVBCB* prbcb);
  * @param	: 
  * @return	: pointer: NULL = failed.
  * ************************************************************************************** */
+uint8_t gateway_PCtoCAN_line(struct GATEWAYPCTOCAN* p, struct CANRCVBUF* pcan);
+/* @brief	: Decode the ascii/hex line collected in 'p->asc' to a CAN msg
+ * @param	: p = pointer to decode block ('ctr' chars in 'asc')
+ * @param	: pcan = pointer to CAN msg output
+ * @return	: error bits (PCTOCAN_ERR_...), also or'ed into 'p->error'
+ * ************************************************************************************** */
 struct CANRCVBUFPLUS* gateway_PCtoCAN_getCAN(struct SERIALRCVBCB* pbcb);
 /*	@brief	: Get pointer to next available CAN msg
  * @param	: pbcb = Pointer to Buffer Control Block
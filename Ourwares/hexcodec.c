@@ -0,0 +1,107 @@
+/******************************************************************************
+* File Name          : hexcodec.c
+* Date First Issued  : 10/19/2026
+* Description        : Table driven ascii/hex encode and decode
+*******************************************************************************/
+#include <string.h>
+#include "hexcodec.h"
+
+/* Encode table: both chars of byte 'b' in the order they are stored. */
+#define HC(n) ((n) < 10 ? ('0' + (n)) : ('A' - 10 + (n)))
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+  #define HE(b) ((HC((b) >> 4) << 8) | HC((b) & 0xf))
+#else
+  #define HE(b) (HC((b) >> 4) | (HC((b) & 0xf) << 8))
+#endif
+#define HE16(r) HE(r+ 0),HE(r+ 1),HE(r+ 2),HE(r+ 3),HE(r+ 4),HE(r+ 5),HE(r+ 6),HE(r+ 7),\
+                HE(r+ 8),HE(r+ 9),HE(r+10),HE(r+11),HE(r+12),HE(r+13),HE(r+14),HE(r+15)
+
+const uint16_t hexcodec_enc[256] = {
+	HE16(0x00),HE16(0x10),HE16(0x20),HE16(0x30),HE16(0x40),HE16(0x50),HE16(0x60),HE16(0x70),
+	HE16(0x80),HE16(0x90),HE16(0xA0),HE16(0xB0),HE16(0xC0),HE16(0xD0),HE16(0xE0),HE16(0xF0),
+};
+
+/* Decode table: X = not a hex char */
+#define X HEXCODEC_NOTHEX
+const uint16_t hexcodec_dec[256] = {
+/*          0   1   2   3   4   5   6   7   8   9  10  11  12  13  14  15   */
+/*  0  */   X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+/*  1  */   X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+/*  2  */   X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+/*  3  */   0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  X,  X,  X,  X,  X,  X,
+/*  4  */   X, 10, 11, 12, 13, 14, 15,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+/*  5  */   X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+/*  6  */   X, 10, 11, 12, 13, 14, 15,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+/*  7  */   X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+/*  8  */   X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+/*  9  */   X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+/* 10  */   X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+/* 11  */   X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+/* 12  */   X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+/* 13  */   X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+/* 14  */   X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+/* 15  */   X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,  X,
+};
+#undef X
+
+/* Invalid bits of a decoded pair: (t[c0] << 4) | t[c1] */
+#define PAIRBAD ((HEXCODEC_NOTHEX << 4) | HEXCODEC_NOTHEX)
+
+/* *************************************************************************
+ * int hexcodec_encode(char* pout, const uint8_t* pin, int n);
+ * @brief	: Bytes to ascii/hex (no terminator)
+ * @param	: pout = pointer to output [2 * n]
+ * @param	: pin = pointer to bytes
+ * @param	: n = number of bytes
+ * @return	: number of chars (2 * n)
+ * *************************************************************************/
+int hexcodec_encode(char* pout, const uint8_t* pin, int n)
+{
+	int i;
+	for (i = 0; i < n; i++)
+	{
+		memcpy(pout, &hexcodec_enc[*pin++], 2); // (compiles to one halfword store)
+		pout += 2;
+	}
+	return (2 * n);
+}
+/* *************************************************************************
+ * int hexcodec_decode(uint8_t* pout, const char* pin, int nchar);
+ * @brief	: Ascii/hex to bytes
+ * @param	: pout = pointer to output [nchar / 2]
+ * @param	: pin = pointer to chars
+ * @param	: nchar = number of chars
+ * @return	: number of bytes; -1 = odd number of chars; -2 = a char was not hex
+ *          : (bytes are stored either way; a bad pair's byte is garbage)
+ * *************************************************************************/
+int hexcodec_decode(uint8_t* pout, const char* pin, int nchar)
+{
+	const uint8_t* p = (const uint8_t*)pin;
+	uint32_t bad = 0;
+	uint32_t v;
+	int n = nchar >> 1;
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		v = (hexcodec_dec[p[0]] << 4) | hexcodec_dec[p[1]];
+		bad |= v;
+		*pout++ = v;
+		p += 2;
+	}
+	if ((nchar & 1) != 0) return -1;
+	if ((bad & PAIRBAD) != 0) return -2;
+	return n;
+}
+/* *************************************************************************
+ * int hexcodec_pair(const char* pin);
+ * @brief	: Two ascii/hex chars to a byte
+ * @param	: pin = pointer to chars
+ * @return	: 0 - 255; -1 = a char was not hex
+ * *************************************************************************/
+int hexcodec_pair(const char* pin)
+{
+	uint32_t v = (hexcodec_dec[(uint8_t)pin[0]] << 4) | hexcodec_dec[(uint8_t)pin[1]];
+	if ((v & PAIRBAD) != 0) return -1;
+	return v;
+}
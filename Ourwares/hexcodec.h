@@ -0,0 +1,50 @@
+/******************************************************************************
+* File Name          : hexcodec.h
+* Date First Issued  : 10/19/2026
+* Description        : Table driven ascii/hex encode and decode
+*******************************************************************************/
+/*
+Encode: one 512 byte table gives both chars of a byte as a halfword, stored
+in output order, so each byte is one load and one (unaligned) halfword store.
+
+Decode: one 256 halfword table gives the nibble for a hex char (upper or
+lower case), or HEXCODEC_NOTHEX for any other char.  A pair is
+(t[c0] << 4) | t[c1]; the invalid bits of every pair in a frame are or'ed
+together and checked once at the end.
+
+No RTOS or HAL: used by the firmware and the PC programs.
+*/
+
+#ifndef __HEXCODEC
+#define __HEXCODEC
+
+#include <stdint.h>
+
+#define HEXCODEC_NOTHEX 0x0800 // 'hexcodec_dec' entry for a char that is not hex
+
+extern const uint16_t hexcodec_enc[256]; // Byte -> two uppercase hex chars
+extern const uint16_t hexcodec_dec[256]; // Char -> nibble, or HEXCODEC_NOTHEX
+
+/* *************************************************************************/
+int hexcodec_encode(char* pout, const uint8_t* pin, int n);
+/* @brief	: Bytes to ascii/hex (no terminator)
+ * @param	: pout = pointer to output [2 * n]
+ * @param	: pin = pointer to bytes
+ * @param	: n = number of bytes
+ * @return	: number of chars (2 * n)
+ * *************************************************************************/
+int hexcodec_decode(uint8_t* pout, const char* pin, int nchar);
+/* @brief	: Ascii/hex to bytes
+ * @param	: pout = pointer to output [nchar / 2]
+ * @param	: pin = pointer to chars
+ * @param	: nchar = number of chars
+ * @return	: number of bytes; -1 = odd number of chars; -2 = a char was not hex
+ *          : (bytes are stored either way; a bad pair's byte is garbage)
+ * *************************************************************************/
+int hexcodec_pair(const char* pin);
+/* @brief	: Two ascii/hex chars to a byte
+ * @param	: pin = pointer to chars
+ * @return	: 0 - 255; -1 = a char was not hex
+ * *************************************************************************/
+
+#endif
@@ -0,0 +1,192 @@
+/******************************************************************************
+* File Name          : mbxgate.c
+* Date First Issued  : 10/19/2026
+* Description        : Bounded MailboxTask -> GatewayTask CAN msg handoff
+*******************************************************************************/
+/*
+Positions 'widx' and 'ridx' run free; the fill is 'widx - ridx' and the
+slot for position n is n & mask.  While the ring is not full the producer
+writes a slot the consumer cannot be looking at.  Only when it is full do
+both sides contend for a slot: the oldest (drop oldest), or a pending msg
+with the same CAN id (coalesce).  The compare and swap on the state word
+decides which side gets it; the loser drops (producer) or retries
+(consumer) and nothing waits.
+
+The gcc __atomic builtins compile to LDREX/STREX and DMB on the M4.
+*/
+#include <stdlib.h>
+#include "mbxgate.h"
+
+/* 'state' bits */
+#define SLOTBUSY 1 // Owned by one side
+#define SLOTFULL 2 // Holds a msg not yet taken
+#define SLOTVER  4 // Version increment
+
+static int slot_take(struct MBXGATESLOT* ps, uint32_t e)
+{
+	if ((e & SLOTBUSY) != 0) return 0;
+	return __atomic_compare_exchange_n(&ps->state, &e, (e | SLOTBUSY), 0,
+		__ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+static void slot_give(struct MBXGATESLOT* ps, uint32_t e, uint32_t full)
+{
+	__atomic_store_n(&ps->state, (((e & ~(SLOTBUSY | SLOTFULL)) + SLOTVER) | full),
+		__ATOMIC_RELEASE);
+	return;
+}
+/* *************************************************************************
+ * int mbxgate_init(struct MBXGATE* p, uint16_t size, uint8_t policy);
+ * @brief	: Allocate ring, and reset
+ * @param	: p = pointer to handoff struct
+ * @param	: size = number of slots (power of 2)
+ * @param	: policy = MBXGATE_DROPNEWEST, MBXGATE_DROPOLDEST, MBXGATE_COALESCE
+ * @return	: 0 = OK; -1 = size not a power of 2; -2 = calloc failed; -3 = bad policy
+ * *************************************************************************/
+int mbxgate_init(struct MBXGATE* p, uint16_t size, uint8_t policy)
+{
+	if ((size < 2) || ((size & (size - 1)) != 0)) return -1;
+	if (policy > MBXGATE_COALESCE) return -3;
+
+	p->pslot = (struct MBXGATESLOT*)calloc(size, sizeof(struct MBXGATESLOT));
+	if (p->pslot == NULL) return -2;
+
+	p->widx   = 0;
+	p->ridx   = 0;
+	p->size   = size;
+	p->mask   = size - 1;
+	p->policy = policy;
+	p->stats.added     = 0;
+	p->stats.dropped   = 0;
+	p->stats.coalesced = 0;
+	p->stats.lost      = 0;
+	p->stats.hwm       = 0;
+	return 0;
+}
+/* *************************************************************************
+ * static int coalesce(struct MBXGATE* p, struct CANRCVBUFN* pncan, uint32_t r, uint32_t w);
+ * @brief	: Replace the newest pending msg with the same CAN id
+ * @return	: 1 = replaced; 0 = none pending, or the consumer has it
+ * *************************************************************************/
+static int coalesce(struct MBXGATE* p, struct CANRCVBUFN* pncan, uint32_t r, uint32_t w)
+{
+	struct MBXGATESLOT* ps;
+	uint32_t e;
+	uint32_t k = w;
+
+	while (k != r)
+	{
+		k -= 1;
+		ps = &p->pslot[k & p->mask];
+		e  = ps->state;
+		if (ps->ncan.can.id != pncan->can.id) continue;
+
+		/* The consumer clears 'full' when it gives the slot back, and 'r' may
+         be stale, so 'full' (not the position) says it is still pending. */
+		if ((e & SLOTFULL) == 0) return 0;
+		if (slot_take(ps, e) == 0) return 0;
+		ps->ncan = *pncan;
+		slot_give(ps, e, SLOTFULL);
+		p->stats.coalesced += 1;
+		return 1;
+	}
+	return 0;
+}
+/* *************************************************************************
+ * void mbxgate_put(struct MBXGATE* p, struct CANRCVBUFN* pncan);
+ * @brief	: Producer: add a CAN msg, applying the policy if the ring is full
+ * @param	: p = pointer to handoff struct
+ * @param	: pncan = pointer to CAN msg
+ * *************************************************************************/
+void mbxgate_put(struct MBXGATE* p, struct CANRCVBUFN* pncan)
+{
+	struct MBXGATESLOT* ps;
+	uint32_t w = p->widx;
+	uint32_t r = __atomic_load_n(&p->ridx, __ATOMIC_ACQUIRE);
+	uint32_t fill = w - r;
+	uint32_t e;
+
+	if (fill >= p->size)
+	{ // Here, ring is full
+		if (p->policy == MBXGATE_COALESCE)
+		{
+			if (coalesce(p, pncan, r, w) != 0) return;
+		}
+		if (p->policy != MBXGATE_DROPOLDEST)
+		{
+			p->stats.dropped += 1;
+			return;
+		}
+		fill = p->size - 1; // The consumer counts the one overwritten
+	}
+
+	/* Only contended if overwriting the oldest msg. */
+	ps = &p->pslot[w & p->mask];
+	e  = ps->state;
+	if (slot_take(ps, e) == 0)
+	{ // Consumer is copying the oldest right now
+		p->stats.dropped += 1;
+		return;
+	}
+	ps->ncan = *pncan;
+	ps->pos  = w;
+	slot_give(ps, e, SLOTFULL);
+	__atomic_store_n(&p->widx, (w + 1), __ATOMIC_RELEASE);
+
+	p->stats.added += 1;
+	if ((fill + 1) > p->stats.hwm) p->stats.hwm = (fill + 1);
+	return;
+}
+/* *************************************************************************
+ * int mbxgate_get(struct MBXGATE* p, struct CANRCVBUFN* pncan);
+ * @brief	: Consumer: take the oldest CAN msg
+ * @param	: p = pointer to handoff struct
+ * @param	: pncan = pointer to where the CAN msg is copied
+ * @return	: 1 = msg copied; 0 = none available (or the next one is being written)
+ * *************************************************************************/
+int mbxgate_get(struct MBXGATE* p, struct CANRCVBUFN* pncan)
+{
+	struct MBXGATESLOT* ps;
+	uint32_t r = p->ridx;
+	uint32_t w;
+	uint32_t e;
+
+	for (;;)
+	{
+		w = __atomic_load_n(&p->widx, __ATOMIC_ACQUIRE);
+		if (r == w) break;
+
+		if ((w - r) > p->size)
+		{ // Here, producer lapped us
+			p->stats.lost += (w - r) - p->size;
+			r = w - p->size;
+		}
+		ps = &p->pslot[r & p->mask];
+		e  = ps->state;
+		if ((e & SLOTBUSY) != 0) break; // Producer is writing it; it notifies again
+		if (slot_take(ps, e) == 0) continue;
+
+		if (ps->pos != r)
+		{ // Here, overwritten since 'widx' was read: skip what was lost
+			__atomic_store_n(&ps->state, e, __ATOMIC_RELEASE); // Unchanged
+			p->stats.lost += (ps->pos - p->size + 1) - r;
+			r = ps->pos - p->size + 1;
+			continue;
+		}
+		*pncan = ps->ncan;
+		slot_give(ps, e, 0);
+		__atomic_store_n(&p->ridx, (r + 1), __ATOMIC_RELEASE);
+		return 1;
+	}
+	__atomic_store_n(&p->ridx, r, __ATOMIC_RELEASE);
+	return 0;
+}
+/* *************************************************************************
+ * uint32_t mbxgate_losses(struct MBXGATE* p);
+ * @brief	: Total msgs lost: dropped + overwritten (coalesced not included)
+ * @param	: p = pointer to handoff struct
+ * @return	: count (wraps)
+ * *************************************************************************/
+uint32_t mbxgate_losses(struct MBXGATE* p)
+{
+	return (p->stats.dropped + p->stats.lost);
+}
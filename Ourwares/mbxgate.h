@@ -0,0 +1,85 @@
+/******************************************************************************
+* File Name          : mbxgate.h
+* Date First Issued  : 10/19/2026
+* Description        : Bounded MailboxTask -> GatewayTask CAN msg handoff
+*******************************************************************************/
+/*
+Single producer ('MailboxTask'), single consumer ('GatewayTask') ring of
+CAN msgs, one per CAN module.  Neither side disables interrupts or blocks.
+When the ring is full the policy decides what is lost, and every lost msg
+is counted, so the gateway can report the gaps to the PC.
+
+Each slot has a state word: a version number, a bit set while one side
+owns the slot, and a bit set while it holds a msg not yet taken.  Either
+side takes a slot with a compare and swap on the state it read, and gives
+it back with the version advanced.  The
+slot also holds the position it was written for, so the consumer can tell
+that the producer lapped it.  This holds whatever the task priorities are,
+and neither side ever waits for the other.
+*/
+
+#ifndef __MBXGATE
+#define __MBXGATE
+
+#include <stdint.h>
+#include "can_iface.h"
+
+/* Full ring policies */
+#define MBXGATE_DROPNEWEST 0 // Discard the incoming msg
+#define MBXGATE_DROPOLDEST 1 // Overwrite the oldest msg not yet taken
+#define MBXGATE_COALESCE   2 // Replace the pending msg with the same CAN id; else drop newest
+
+struct MBXGATESLOT
+{
+	struct CANRCVBUFN ncan;   // CAN msg
+	uint32_t pos;             // Producer position this slot was written for
+	volatile uint32_t state;  // Version (bits 2-31); bit 1 = msg not taken; bit 0 = owned
+};
+
+/* Counters: each is written by one side only. */
+struct MBXGATESTATS
+{
+	uint32_t added;     // Producer: msgs placed in ring
+	uint32_t dropped;   // Producer: incoming msgs discarded (ring full)
+	uint32_t coalesced; // Producer: pending msgs replaced by a newer one
+	uint32_t lost;      // Consumer: msgs overwritten before they were taken
+	uint16_t hwm;       // Producer: high water mark of ring fill
+};
+
+struct MBXGATE
+{
+	struct MBXGATESLOT* pslot; // Ring [size]
+	volatile uint32_t widx;    // Producer position (free running)
+	volatile uint32_t ridx;    // Consumer position (free running)
+	struct MBXGATESTATS stats;
+	uint16_t size;             // Number of slots (power of 2)
+	uint16_t mask;             // size - 1
+	uint8_t  policy;           // MBXGATE_DROPNEWEST, etc.
+};
+
+/* *************************************************************************/
+int mbxgate_init(struct MBXGATE* p, uint16_t size, uint8_t policy);
+/* @brief	: Allocate ring, and reset
+ * @param	: p = pointer to handoff struct
+ * @param	: size = number of slots (power of 2)
+ * @param	: policy = MBXGATE_DROPNEWEST, MBXGATE_DROPOLDEST, MBXGATE_COALESCE
+ * @return	: 0 = OK; -1 = size not a power of 2; -2 = calloc failed; -3 = bad policy
+ * *************************************************************************/
+void mbxgate_put(struct MBXGATE* p, struct CANRCVBUFN* pncan);
+/* @brief	: Producer: add a CAN msg, applying the policy if the ring is full
+ * @param	: p = pointer to handoff struct
+ * @param	: pncan = pointer to CAN msg
+ * *************************************************************************/
+int mbxgate_get(struct MBXGATE* p, struct CANRCVBUFN* pncan);
+/* @brief	: Consumer: take the oldest CAN msg
+ * @param	: p = pointer to handoff struct
+ * @param	: pncan = pointer to where the CAN msg is copied
+ * @return	: 1 = msg copied; 0 = none available (or the next one is being written)
+ * *************************************************************************/
+uint32_t mbxgate_losses(struct MBXGATE* p);
+/* @brief	: Total msgs lost: dropped + overwritten (coalesced not included)
+ * @param	: p = pointer to handoff struct
+ * @return	: count (wraps)
+ * *************************************************************************/
+
+#endif
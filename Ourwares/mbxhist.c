@@ -0,0 +1,206 @@
+/******************************************************************************
+* File Name          : mbxhist.c
+* Date First Issued  : 10/19/2026
+* Description        : Mailbox sample history ring with windowed helpers
+*******************************************************************************/
+/*
+Window sum: 'sumnew' accumulates the samples written in the current pass
+around the ring, and 'sumold' is what is left of the previous pass.  When 
+the index wraps 'sumold' is replaced by 'sumnew', so float round off from 
+the subtractions does not build up beyond one pass.
+
+Min/max: monotonic queues of ring indices.  The head is the min (max) of 
+the window.  A new sample removes the queue entries at the tail it beats,
+and the head is dropped when its ring slot is about to be overwritten.
+*/
+#include <stdlib.h>
+#include "mbxhist.h"
+
+/* *************************************************************************
+ * int mbxhist_init(struct MBXHIST* p, uint16_t n, uint8_t fld);
+ * @brief	: Allocate ring and queues, and reset
+ * @param	: p = pointer to history struct
+ * @param	: n = ring size (number of samples in window) (>= 2)
+ * @param	: fld = payload field index the samples are from
+ * @return	: 0 = OK; -1 = n too small; -2 = calloc failed
+ * *************************************************************************/
+int mbxhist_init(struct MBXHIST* p, uint16_t n, uint8_t fld)
+{
+	if (n < 2) return -1;
+
+	p->pbuf  = (struct MBXHISTSAMP*)calloc(n, sizeof(struct MBXHISTSAMP));
+	p->pmaxq = (uint16_t*)calloc(n, sizeof(uint16_t));
+	p->pminq = (uint16_t*)calloc(n, sizeof(uint16_t));
+	if ((p->pbuf == NULL) || (p->pmaxq == NULL) || (p->pminq == NULL))
+		return -2;
+
+	p->sumold = 0;
+	p->sumnew = 0;
+	p->n      = n;
+	p->ct     = 0;
+	p->idx    = 0;
+	p->maxh   = 0;
+	p->maxct  = 0;
+	p->minh   = 0;
+	p->minct  = 0;
+	p->fld    = fld;
+	return 0;
+}
+/* *************************************************************************
+ * void mbxhist_add(struct MBXHIST* p, uint32_t dtw, float v);
+ * @brief	: Add a sample: O(1) (min/max queues amortized)
+ * @param	: p = pointer to history struct
+ * @param	: dtw = DTW time of sample
+ * @param	: v = sample value
+ * *************************************************************************/
+void mbxhist_add(struct MBXHIST* p, uint32_t dtw, float v)
+{
+	uint16_t i = p->idx;
+	uint16_t j;
+
+	if (p->ct == p->n)
+	{ // Here, slot 'i' holds the oldest sample, which leaves the window
+		p->sumold -= (p->pbuf + i)->v;
+		if ((p->maxct != 0) && (*(p->pmaxq + p->maxh) == i))
+		{
+			p->maxh += 1; if (p->maxh >= p->n) p->maxh = 0;
+			p->maxct -= 1;
+		}
+		if ((p->minct != 0) && (*(p->pminq + p->minh) == i))
+		{
+			p->minh += 1; if (p->minh >= p->n) p->minh = 0;
+			p->minct -= 1;
+		}
+	}
+	else
+	{
+		p->ct += 1;
+	}
+
+	(p->pbuf + i)->dtw = dtw;
+	(p->pbuf + i)->v   = v;
+	p->sumnew += v;
+
+	/* Max queue: drop tail entries not greater than the new sample. */
+	while (p->maxct != 0)
+	{
+		j = p->maxh + p->maxct - 1; if (j >= p->n) j -= p->n;
+		if ((p->pbuf + *(p->pmaxq + j))->v > v) break;
+		p->maxct -= 1;
+	}
+	j = p->maxh + p->maxct; if (j >= p->n) j -= p->n;
+	*(p->pmaxq + j) = i;
+	p->maxct += 1;
+
+	/* Min queue: drop tail entries not less than the new sample. */
+	while (p->minct != 0)
+	{
+		j = p->minh + p->minct - 1; if (j >= p->n) j -= p->n;
+		if ((p->pbuf + *(p->pminq + j))->v < v) break;
+		p->minct -= 1;
+	}
+	j = p->minh + p->minct; if (j >= p->n) j -= p->n;
+	*(p->pminq + j) = i;
+	p->minct += 1;
+
+	/* Advance index; start a new pass for the sums upon wrap around. */
+	i += 1;
+	if (i >= p->n)
+	{
+		i = 0;
+		p->sumold = p->sumnew;
+		p->sumnew = 0;
+	}
+	p->idx = i;
+	return;
+}
+/* *************************************************************************
+ * struct MBXHISTSAMP* mbxhist_get(struct MBXHIST* p, uint16_t k);
+ * @brief	: Get sample
+ * @param	: p = pointer to history struct
+ * @param	: k = 0 for newest, 1 for previous, ...
+ * @return	: pointer to sample; NULL = not that many samples
+ * *************************************************************************/
+struct MBXHISTSAMP* mbxhist_get(struct MBXHIST* p, uint16_t k)
+{
+	int i;
+
+	if (k >= p->ct) return NULL;
+	i = (int)p->idx - 1 - k;
+	if (i < 0) i += p->n;
+	return (p->pbuf + i);
+}
+/* *************************************************************************
+ * float mbxhist_avg(struct MBXHIST* p);
+ * float mbxhist_min(struct MBXHIST* p);
+ * float mbxhist_max(struct MBXHIST* p);
+ * @brief	: Moving average, min, max over the samples in the ring
+ * @param	: p = pointer to history struct
+ * @return	: value; 0 if no samples
+ * *************************************************************************/
+float mbxhist_avg(struct MBXHIST* p)
+{
+	if (p->ct == 0) return 0;
+	return (p->sumold + p->sumnew) / p->ct;
+}
+float mbxhist_min(struct MBXHIST* p)
+{
+	if (p->minct == 0) return 0;
+	return (p->pbuf + *(p->pminq + p->minh))->v;
+}
+float mbxhist_max(struct MBXHIST* p)
+{
+	if (p->maxct == 0) return 0;
+	return (p->pbuf + *(p->pmaxq + p->maxh))->v;
+}
+/* *************************************************************************
+ * int mbxhist_deriv(struct MBXHIST* p, uint16_t k, uint32_t dtwpersec, float* pd);
+ * @brief	: Finite difference derivative: (newest - k back) / time between
+ * @param	: p = pointer to history struct
+ * @param	: k = samples back (1 = previous sample; n-1 = whole window)
+ * @param	: dtwpersec = DTW ticks per second
+ * @param	: pd = pointer for derivative (per second)
+ * @return	: 0 = OK; -1 = not enough samples, or zero time difference
+ * *************************************************************************/
+int mbxhist_deriv(struct MBXHIST* p, uint16_t k, uint32_t dtwpersec, float* pd)
+{
+	struct MBXHISTSAMP* pa;
+	struct MBXHISTSAMP* pb;
+	uint32_t dt;
+
+	if (k == 0) return -1;
+	pa = mbxhist_get(p, 0);
+	pb = mbxhist_get(p, k);
+	if (pb == NULL) return -1;
+
+	dt = pa->dtw - pb->dtw; // (Good across DTW wrap)
+	if (dt == 0) return -1;
+
+	*pd = (pa->v - pb->v) * ((float)dtwpersec / (float)dt);
+	return 0;
+}
+/* *************************************************************************
+ * int mbxhist_val(struct MBXHIST* p, struct MBXHISTVAL* pv, uint16_t k, uint32_t dtwpersec);
+ * @brief	: Fill struct with last, avg, min, max, deriv
+ * @param	: p = pointer to history struct
+ * @param	: pv = pointer to struct for results
+ * @param	: k = samples back for 'deriv' (see 'mbxhist_deriv')
+ * @param	: dtwpersec = DTW ticks per second
+ * @return	: 0 = OK; -1 = no samples
+ * *************************************************************************/
+int mbxhist_val(struct MBXHIST* p, struct MBXHISTVAL* pv, uint16_t k, uint32_t dtwpersec)
+{
+	struct MBXHISTSAMP* pa = mbxhist_get(p, 0);
+
+	pv->ct = p->ct;
+	if (pa == NULL) return -1;
+
+	pv->last = pa->v;
+	pv->dtw  = pa->dtw;
+	pv->avg  = mbxhist_avg(p);
+	pv->min  = mbxhist_min(p);
+	pv->max  = mbxhist_max(p);
+	if (mbxhist_deriv(p, k, dtwpersec, &pv->deriv) != 0)
+		pv->deriv = 0;
+	return 0;
+}
@@ -0,0 +1,101 @@
+/******************************************************************************
+* File Name          : mbxhist.h
+* Date First Issued  : 10/19/2026
+* Description        : Mailbox sample history ring with windowed helpers
+*******************************************************************************/
+/*
+A ring of the last 'n' time stamped readings of one payload field.  Each
+new sample updates the window sum and the min/max queues, so the average,
+min, max and a finite difference derivative are all O(1) to read, and 
+O(1) (amortized for min/max) to update.
+
+No HAL or FreeRTOS dependencies.
+*/
+
+#ifndef __MBXHIST
+#define __MBXHIST
+
+#include <stdint.h>
+
+/* One sample */
+struct MBXHISTSAMP
+{
+	uint32_t dtw;  // DTW time of arrival
+	float    v;    // Decoded reading
+};
+
+/* History ring and window state */
+struct MBXHIST
+{
+	struct MBXHISTSAMP* pbuf; // Ring of samples [n]
+	uint16_t* pmaxq;  // Max queue [n]: ring indices, values decreasing
+	uint16_t* pminq;  // Min queue [n]: ring indices, values increasing
+	float sumold;     // Sum of samples from the previous pass not yet overwritten
+	float sumnew;     // Sum of samples written during the current pass
+	uint16_t n;       // Ring size (window depth)
+	uint16_t ct;      // Samples in ring (0 - n)
+	uint16_t idx;     // Ring index for next sample
+	uint16_t maxh;    // Max queue: index of head
+	uint16_t maxct;   // Max queue: number in queue
+	uint16_t minh;    // Min queue: index of head
+	uint16_t minct;   // Min queue: number in queue
+	uint8_t fld;      // Payload field index stored (see 'paydesc_field')
+};
+
+/* Window results, see 'mbxhist_val' */
+struct MBXHISTVAL
+{
+	float last;     // Newest sample
+	float avg;      // Moving average of window
+	float min;      // Min in window
+	float max;      // Max in window
+	float deriv;    // (newest - k back)/time (per second); 0 if not enough samples
+	uint32_t dtw;   // DTW time of newest sample
+	uint16_t ct;    // Number of samples in window
+};
+
+/* *************************************************************************/
+int mbxhist_init(struct MBXHIST* p, uint16_t n, uint8_t fld);
+/* @brief	: Allocate ring and queues, and reset
+ * @param	: p = pointer to history struct
+ * @param	: n = ring size (number of samples in window) (>= 2)
+ * @param	: fld = payload field index the samples are from
+ * @return	: 0 = OK; -1 = n too small; -2 = calloc failed
+ * *************************************************************************/
+void mbxhist_add(struct MBXHIST* p, uint32_t dtw, float v);
+/* @brief	: Add a sample: O(1) (min/max queues amortized)
+ * @param	: p = pointer to history struct
+ * @param	: dtw = DTW time of sample
+ * @param	: v = sample value
+ * *************************************************************************/
+struct MBXHISTSAMP* mbxhist_get(struct MBXHIST* p, uint16_t k);
+/* @brief	: Get sample
+ * @param	: p = pointer to history struct
+ * @param	: k = 0 for newest, 1 for previous, ...
+ * @return	: pointer to sample; NULL = not that many samples
+ * *************************************************************************/
+float mbxhist_avg(struct MBXHIST* p);
+float mbxhist_min(struct MBXHIST* p);
+float mbxhist_max(struct MBXHIST* p);
+/* @brief	: Moving average, min, max over the samples in the ring
+ * @param	: p = pointer to history struct
+ * @return	: value; 0 if no samples
+ * *************************************************************************/
+int mbxhist_deriv(struct MBXHIST* p, uint16_t k, uint32_t dtwpersec, float* pd);
+/* @brief	: Finite difference derivative: (newest - k back) / time between
+ * @param	: p = pointer to history struct
+ * @param	: k = samples back (1 = previous sample; n-1 = whole window)
+ * @param	: dtwpersec = DTW ticks per second
+ * @param	: pd = pointer for derivative (per second)
+ * @return	: 0 = OK; -1 = not enough samples, or zero time difference
+ * *************************************************************************/
+int mbxhist_val(struct MBXHIST* p, struct MBXHISTVAL* pv, uint16_t k, uint32_t dtwpersec);
+/* @brief	: Fill struct with last, avg, min, max, deriv
+ * @param	: p = pointer to history struct
+ * @param	: pv = pointer to struct for results
+ * @param	: k = samples back for 'deriv' (see 'mbxhist_deriv')
+ * @param	: dtwpersec = DTW ticks per second
+ * @return	: 0 = OK; -1 = no samples
+ * *************************************************************************/
+
+#endif
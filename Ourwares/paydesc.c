@@ -0,0 +1,266 @@
+/******************************************************************************
+* File Name          : paydesc.c
+* Date First Issued  : 10/19/2026
+* Description        : Payload type descriptors: table driven payload decoding
+*******************************************************************************/
+/*
+Table entries follow the payload type list copied in 'Ourtasks/paycnvt.c'.
+Where that list and the code in use disagree, the code in use wins--
+ U8_S32 (8):       list says [4]-[7], payload_extract used [1]-[4].
+ I16_I16_X6 (28):  list gives no offset for 'X'; taken as [6], same as I16_X6
+                   (dmoc_control reads the speed msg status from [6]).
+ I16_I16_I16_X7 (33): list describes [6], i.e. 'X6' as in dmoc_control.
+'x' (skipped) bytes are not fields.
+*/
+#include <string.h>
+#include "paydesc.h"
+
+#define U8   PAYFMT_U8
+#define S8   PAYFMT_S8
+#define U16  PAYFMT_U16
+#define S16  PAYFMT_S16
+#define I16  PAYFMT_I16
+#define U32  PAYFMT_U32
+#define S32  PAYFMT_S32
+#define FF   PAYFMT_FF
+#define HF   PAYFMT_HF
+#define F34F PAYFMT_F34F
+
+#define PAYDESCNUM 38	// Codes 0 - 37 are indexed directly
+
+/* Descriptor table: {dlc, n, {{offset,format},...}}  */
+static const struct PAYDESC paydesc[PAYDESCNUM] =
+{
+	[ 0] = {0, 0, {{0,0}}},                             // NONE
+	[ 1] = {4, 1, {{0,FF}}},                            // FF
+	[ 2] = {8, 2, {{0,FF},{4,FF}}},                     // FF_FF
+	[ 3] = {4, 1, {{0,U32}}},                           // U32
+	[ 4] = {8, 2, {{0,U32},{4,U32}}},                   // U32_U32
+	[ 5] = {5, 2, {{0,U8},{1,U32}}},                    // U8_U32
+	[ 6] = {4, 1, {{0,S32}}},                           // S32
+	[ 7] = {8, 2, {{0,S32},{4,S32}}},                   // S32_S32
+	[ 8] = {5, 2, {{0,U8},{1,S32}}},                    // U8_S32
+	[ 9] = {2, 1, {{0,HF}}},                            // HF
+	[10] = {3, 1, {{0,F34F}}},                          // F34F
+	[11] = {5, 1, {{1,FF}}},                            // xFF
+	[12] = {6, 1, {{2,FF}}},                            // xxFF
+	[13] = {6, 1, {{2,U32}}},                           // xxU32
+	[14] = {6, 1, {{2,S32}}},                           // xxS32
+	[15] = {6, 3, {{0,U8},{1,U8},{2,U32}}},             // U8_U8_U32
+	[16] = {6, 3, {{0,U8},{1,U8},{2,S32}}},             // U8_U8_S32
+	[17] = {6, 3, {{0,U8},{1,U8},{2,FF}}},              // U8_U8_FF
+	[18] = {2, 1, {{0,U16}}},                           // U16
+	[19] = {2, 1, {{0,S16}}},                           // S16
+	[20] = {0, 0, {{0,0}}},                             // LAT_LON_HT (raw)
+	[21] = {5, 2, {{0,U8},{1,FF}}},                     // U8_FF
+	[22] = {3, 2, {{0,U8},{1,HF}}},                     // U8_HF
+	[23] = {1, 1, {{0,U8}}},                            // U8
+	[24] = {5, 2, {{0,U8},{1,U32}}},                    // UNIXTIME
+	[25] = {2, 2, {{0,U8},{1,U8}}},                     // U8_U8
+	[26] = {7, 4, {{0,U8},{1,U8},{2,U8},{3,U32}}},      // U8_U8_U8_U32
+	[27] = {4, 2, {{0,I16},{2,I16}}},                   // I16_I16
+	[28] = {7, 3, {{0,I16},{2,I16},{6,U8}}},            // I16_I16_X6
+	[29] = {3, 3, {{0,U8},{1,U8},{2,U8}}},              // U8_U8_U8
+	[30] = {7, 2, {{0,I16},{6,U8}}},                    // I16_X6
+	[31] = {8, 4, {{0,I16},{2,I16},{4,I16},{6,I16}}},   // I16_I16_I16_I16
+	[32] = {7, 2, {{0,I16},{5,I16}}},                   // I16__I16
+	[33] = {7, 4, {{0,I16},{2,I16},{4,I16},{6,U8}}},    // I16_I16_I16_X6(X7)
+	[34] = {7, 4, {{0,I16},{2,I16},{5,U8},{6,U8}}},     // I16_I16_X_U8_U8
+	[35] = {2, 1, {{0,I16}}},                           // I16
+	[36] = {1, 1, {{0,U8}}},                            // U8_VAR
+	[37] = {5, 5, {{0,U8},{1,S8},{2,S8},{3,S8},{4,S8}}},// U8_S8_S8_S8_S8
+};
+/* Level 2 commands: first two bytes, [2]-[5] depend on the command. */
+static const struct PAYDESC paydesc_lvl2 = {6, 3, {{0,U8},{1,U8},{2,U32}}}; // LVL2B (249), LVL2R (250)
+
+/* Bytes each format occupies in the payload. */
+static const uint8_t fmtsize[] = {0,1,1,2,2,2,4,4,4,2,3};
+
+/* *************************************************************************
+ * const struct PAYDESC* paydesc_get(uint8_t paytype);
+ * @brief	: Get descriptor for a payload type
+ * @param	: paytype = payload type code
+ * @return	: pointer to descriptor; NULL = no descriptor (raw 8 bytes)
+ * *************************************************************************/
+const struct PAYDESC* paydesc_get(uint8_t paytype)
+{
+	if (paytype < PAYDESCNUM)
+	{
+		if (paydesc[paytype].n == 0) // NONE and LAT_LON_HT
+		{
+			if (paytype == 0) return &paydesc[0];
+			return NULL;
+		}
+		return &paydesc[paytype];
+	}
+	if ((paytype == 249) || (paytype == 250))
+		return &paydesc_lvl2;
+	return NULL; // UNDEF and codes not in the list
+}
+/* *************************************************************************
+ * float paydesc_halftofloat(uint16_t h);
+ * @brief	: Convert IEEE 754 half precision to float
+ * @param	: h = half float bits
+ * @return	: float
+ * *************************************************************************/
+float paydesc_halftofloat(uint16_t h)
+{
+	union {uint32_t u; float f;} x;
+	uint32_t s = (uint32_t)(h & 0x8000) << 16;
+	uint32_t e = (h >> 10) & 0x1f;
+	uint32_t m = h & 0x3ff;
+
+	if (e == 0)
+	{
+		if (m == 0)
+		{ // Signed zero
+			x.u = s;
+			return x.f;
+		}
+		/* Subnormal: normalize */
+		e = 127 - 15 + 1;
+		while ((m & 0x400) == 0)
+		{
+			m <<= 1; e -= 1;
+		}
+		m &= 0x3ff;
+		x.u = s | (e << 23) | (m << 13);
+		return x.f;
+	}
+	if (e == 0x1f)
+	{ // Inf or NaN
+		x.u = s | 0x7f800000 | (m << 13);
+		return x.f;
+	}
+	x.u = s | ((e + 127 - 15) << 23) | (m << 13);
+	return x.f;
+}
+/* *************************************************************************
+ * uint32_t paydesc_bits(const uint8_t* p, uint8_t fmt);
+ * @brief	: Assemble field bits (floats expanded to float bits)
+ * @param	: p = pointer to first payload byte of field
+ * @param	: fmt = PAYFMT_...
+ * @return	: bits of the field
+ * *************************************************************************/
+uint32_t paydesc_bits(const uint8_t* p, uint8_t fmt)
+{
+	union {uint32_t u; float f;} x;
+	switch (fmt)
+	{
+	case U8:
+	case S8:
+		return p[0];
+	case U16:
+	case S16:
+	case HF:
+		x.u = p[0] | (p[1] << 8);
+		if (fmt == HF)
+			x.f = paydesc_halftofloat((uint16_t)x.u);
+		return x.u;
+	case I16:
+		return (p[0] << 8) | p[1];
+	case F34F:
+		return ((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24);
+	default: // U32, S32, FF
+		return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+	}
+}
+/* *************************************************************************
+ * int paydesc_extract(const uint8_t* ppay, uint32_t dlc, uint8_t paytype, uint8_t* pu, uint8_t* ppre8);
+ * @brief	: Decode payload into mailbox readings layout (see paydesc.h)
+ * @param	: ppay = pointer to payload bytes [0]-[7]
+ * @param	: dlc = payload byte count
+ * @param	: paytype = payload type code
+ * @param	: pu = pointer to 8 byte union
+ * @param	: ppre8 = pointer to 4 byte 'pre8' array
+ * @return	: 0 = OK; -1 = dlc too small for payload type (nothing stored)
+ * *************************************************************************/
+int paydesc_extract(const uint8_t* ppay, uint32_t dlc, uint8_t paytype, uint8_t* pu, uint8_t* ppre8)
+{
+	const struct PAYDESC* pd = paydesc_get(paytype);
+	const struct PAYFIELD* pf;
+	uint32_t v;
+	int i;
+	int upos = 0;  // Next byte position in union
+	int npre = 0;  // Next pre8 index
+	int wide = 0;  // A wider than byte field has been stored
+
+	if (pd == NULL)
+	{ // No descriptor: the eight payload bytes go to the union
+		memcpy(pu, ppay, 8);
+		return 0;
+	}
+	if (dlc < pd->dlc) return -1;
+
+	for (i = 0; i < pd->n; i++)
+	{
+		pf = &pd->f[i];
+		v = paydesc_bits(&ppay[pf->off], pf->fmt);
+		switch (pf->fmt)
+		{
+		case U8:
+		case S8:
+			if ((wide == 0) && (npre < 4))
+			{ 
+				ppre8[npre++] = v;
+			}
+			else
+			{
+				if (upos >= 8) break;
+				pu[upos++] = v;
+			}
+			break;
+		case U16:
+		case S16:
+		case I16:
+			wide = 1;
+			upos = (upos + 1) & ~1;
+			if (upos > 6) break;
+			memcpy(&pu[upos], &v, 2); // (little endian target)
+			upos += 2;
+			break;
+		default: // 4 byte readings
+			wide = 1;
+			upos = (upos + 3) & ~3;
+			if (upos > 4) break;
+			memcpy(&pu[upos], &v, 4);
+			upos += 4;
+			break;
+		}
+	}
+	return 0;
+}
+/* *************************************************************************
+ * int paydesc_field(const uint8_t* ppay, uint32_t dlc, uint8_t paytype, int k, float* pf);
+ * @brief	: Get one field of a payload as a float
+ * @param	: ppay = pointer to payload bytes [0]-[7]
+ * @param	: dlc = payload byte count
+ * @param	: paytype = payload type code
+ * @param	: k = field index (0 - n-1)
+ * @param	: pf = pointer to float for value
+ * @return	: 0 = OK; -1 = no such field, or dlc too small
+ * *************************************************************************/
+int paydesc_field(const uint8_t* ppay, uint32_t dlc, uint8_t paytype, int k, float* pf)
+{
+	const struct PAYDESC* pd = paydesc_get(paytype);
+	const struct PAYFIELD* pfld;
+	union {uint32_t u; float f;} x;
+
+	if (pd == NULL) return -1;
+	if ((k < 0) || (k >= pd->n)) return -1;
+	pfld = &pd->f[k];
+	if (dlc < (uint32_t)(pfld->off + fmtsize[pfld->fmt])) return -1;
+
+	x.u = paydesc_bits(&ppay[pfld->off], pfld->fmt);
+	switch (pfld->fmt)
+	{
+	case S8:  *pf = (int8_t)x.u;  break;
+	case S16: *pf = (int16_t)x.u; break;
+	case S32: *pf = (int32_t)x.u; break;
+	case FF:
+	case HF:
+	case F34F: *pf = x.f;         break;
+	default:   *pf = x.u;         break; // U8, U16, I16, U32
+	}
+	return 0;
+}
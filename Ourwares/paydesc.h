@@ -0,0 +1,89 @@
+/******************************************************************************
+* File Name          : paydesc.h
+* Date First Issued  : 10/19/2026
+* Description        : Payload type descriptors: table driven payload decoding
+*******************************************************************************/
+/*
+One descriptor per payload type code (see the list in 'paycnvt.c', a copy of
+PAYLOAD_TYPE_INSERT.sql).  Each gives the byte offset and format of the
+fields in the CAN payload.  Codes are numeric here so that this compiles
+without 'gen_db.h', e.g. for the PC programs.
+
+Readings layout filled by 'paydesc_extract' (same as the older switch):
+ - Byte fields ahead of any wider field go in pre8[0]-[3].
+ - The remaining fields are packed in order into the 8 byte union, each on
+   its natural alignment: bytes, 16b, then 32b.  Half and 3/4 floats are
+   expanded to 4 byte floats.  16b big endian (I16) are byte swapped.
+ - Types without a descriptor (LAT_LON_HT, UNDEF, unknown codes) copy the
+   eight payload bytes to the union.
+*/
+
+#ifndef __PAYDESC
+#define __PAYDESC
+
+#include <stdint.h>
+
+/* Field formats */
+#define PAYFMT_U8    1 // uint8_t
+#define PAYFMT_S8    2 // int8_t
+#define PAYFMT_U16   3 // uint16_t little endian
+#define PAYFMT_S16   4 // int16_t  little endian
+#define PAYFMT_I16   5 // uint16_t big endian, e.g. DMOC
+#define PAYFMT_U32   6 // uint32_t little endian
+#define PAYFMT_S32   7 // int32_t  little endian
+#define PAYFMT_FF    8 // float (4 bytes)
+#define PAYFMT_HF    9 // half float (2 bytes)
+#define PAYFMT_F34F 10 // 3/4 float: upper 3 bytes of a float
+
+#define PAYDESCMAXFLD 8  // Max fields in a payload
+
+struct PAYFIELD
+{
+	uint8_t off;  // Byte offset in payload
+	uint8_t fmt;  // PAYFMT_...
+};
+
+struct PAYDESC
+{
+	uint8_t dlc;  // Min payload bytes for all fields to be present
+	uint8_t n;    // Number of fields
+	struct PAYFIELD f[PAYDESCMAXFLD];
+};
+
+/* *************************************************************************/
+const struct PAYDESC* paydesc_get(uint8_t paytype);
+/* @brief	: Get descriptor for a payload type
+ * @param	: paytype = payload type code
+ * @return	: pointer to descriptor; NULL = no descriptor (raw 8 bytes)
+ * *************************************************************************/
+int paydesc_extract(const uint8_t* ppay, uint32_t dlc, uint8_t paytype, uint8_t* pu, uint8_t* ppre8);
+/* @brief	: Decode payload into mailbox readings layout (see above)
+ * @param	: ppay = pointer to payload bytes [0]-[7]
+ * @param	: dlc = payload byte count
+ * @param	: paytype = payload type code
+ * @param	: pu = pointer to 8 byte union
+ * @param	: ppre8 = pointer to 4 byte 'pre8' array
+ * @return	: 0 = OK; -1 = dlc too small for payload type (nothing stored)
+ * *************************************************************************/
+int paydesc_field(const uint8_t* ppay, uint32_t dlc, uint8_t paytype, int k, float* pf);
+/* @brief	: Get one field of a payload as a float
+ * @param	: ppay = pointer to payload bytes [0]-[7]
+ * @param	: dlc = payload byte count
+ * @param	: paytype = payload type code
+ * @param	: k = field index (0 - n-1)
+ * @param	: pf = pointer to float for value
+ * @return	: 0 = OK; -1 = no such field, or dlc too small
+ * *************************************************************************/
+uint32_t paydesc_bits(const uint8_t* p, uint8_t fmt);
+/* @brief	: Assemble field bits (floats expanded to float bits)
+ * @param	: p = pointer to first payload byte of field
+ * @param	: fmt = PAYFMT_...
+ * @return	: bits of the field
+ * *************************************************************************/
+float paydesc_halftofloat(uint16_t h);
+/* @brief	: Convert IEEE 754 half precision to float
+ * @param	: h = half float bits
+ * @return	: float
+ * *************************************************************************/
+
+#endif
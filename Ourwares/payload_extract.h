@@ -11,9 +11,10 @@
 #include "MailboxTask.h"
 
 /* *************************************************************************/
-void payload_extract(struct MAILBOXCAN* pmbx);
-/*	@brief	: Lookup CAN ID and load mailbox with extract payload reading(s)
+int payload_extract(struct MAILBOXCAN* pmbx);
+/*	@brief	: Load mailbox with extracted payload reading(s)
  * @param	: pmbx  = pointer to mailbox
+ * @return	: 0 = OK; -1 = dlc too small for payload type
  * *************************************************************************/
 
 #endif
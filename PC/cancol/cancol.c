@@ -0,0 +1,731 @@
+/* *****************************************************************************
+* File Name          : cancol.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Gateway CAN logs to column files (one per signal) for analysis
+****************************************************************************** */
+/*
+Library for 'ccol' and 'ccolbench' (see those for gcc lines).
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cancol.h"
+#include "gatewaybin.h"
+#include "hexcodec.h"
+
+/* Width and numpy dtype of a stored field, by PAYFMT_... */
+static const uint8_t fmtwidth[] = {0, 1, 1, 2, 2, 2, 4, 4, 4, 4, 4};
+static const char* fmtdtype[]   = {"", "|u1", "|i1", "<u2", "<i2", "<u2", "<u4", "<i4", "<f4", "<f4", "<f4"};
+
+#define LNSZ (GBIN_RAWMAX * 2)  // Longest gateway line (chars)
+
+/* A column being written */
+struct COL
+{
+	char     file[CCOL_NAME];
+	char     name[CFMTMAPNAME];
+	const char* dtype;
+	uint8_t  width;
+	uint8_t  created;  // 1 = file made (later writes append)
+	uint32_t nbuf;     // Bytes in 'pbuf'
+	uint8_t* pbuf;     // [CCOL_BUFSZ]
+};
+
+/* A CAN id: its columns (time, dlc, then signals or payload) */
+struct CID
+{
+	uint32_t id;
+	const struct CFMTMAPE* pe; // Map entry; NULL = payload column
+	uint64_t rows;
+	uint32_t ncol;
+	struct COL* pcol;
+};
+
+/* Lines for a decode thread */
+struct LN
+{
+	uint32_t tick;
+	char     c[LNSZ + 1];  // Line, '\0' terminated
+};
+struct BATCH
+{
+	uint32_t n;
+	struct LN ln[CCOL_BATCH];
+};
+
+struct CTX;
+
+/* A decode thread: the ids hashed to it, and its queue of line batches */
+struct WRK
+{
+	struct CTX*   pctx;
+	struct CID**  ptbl;   // Open addressed on id [2 * CCOL_MAXID]
+	struct CID**  plist;  // Ids in the order first seen [CCOL_MAXID]
+	uint32_t      nid;
+	struct GBIN   g;      // Decode counts
+	int           err;    // errno of a failed write; -1 = too many ids; -2 = out of memory
+	/* Queue */
+	struct BATCH* pb;     // [CCOL_NBATCH]
+	struct BATCH* pcur;   // Batch the split thread is filling (NULL = none)
+	uint32_t      head;   // Batches put
+	uint32_t      tail;   // Batches done
+	int           done;   // No more batches
+	pthread_mutex_t mx;
+	pthread_cond_t  cv;
+	pthread_t     th;
+};
+
+struct CTX
+{
+	const struct CCOLCFG* pcfg;
+	struct WRK* pw;       // [nthr]
+	int         nthr;
+	uint32_t    nid;      // Ids, all threads
+};
+
+static uint32_t hash(uint32_t id)
+{
+	return (id * 2654435761u) >> 16;
+}
+/* ************************************************************************************************************
+ * static void flush(struct WRK* pw, struct COL* pc);
+ * @brief	: Write out a column's buffer (the file is opened only for this: no limit on open files)
+ * ************************************************************************************************************ */
+static void flush(struct WRK* pw, struct COL* pc)
+{
+	char path[4096];
+	ssize_t k;
+	uint32_t n = 0;
+	int fd;
+
+	snprintf(path, sizeof(path), "%s/%s", pw->pctx->pcfg->dir, pc->file);
+	fd = open(path, O_WRONLY | O_CREAT | ((pc->created == 0) ? O_TRUNC : O_APPEND), 0644);
+	if (fd < 0)
+	{
+		pw->err = errno;
+		return;
+	}
+	pc->created = 1;
+	while (n < pc->nbuf)
+	{
+		k = write(fd, pc->pbuf + n, pc->nbuf - n);
+		if (k <= 0)
+		{
+			if ((k < 0) && (errno == EINTR)) continue;
+			pw->err = (k < 0) ? errno : ENOSPC;
+			break;
+		}
+		n += k;
+	}
+	if (close(fd) != 0) pw->err = errno;
+	pc->nbuf = 0;
+	return;
+}
+static void put(struct WRK* pw, struct COL* pc, uint32_t v)
+{
+	uint8_t* p;
+
+	if ((pc->nbuf + pc->width) > CCOL_BUFSZ) flush(pw, pc);
+	p = pc->pbuf + pc->nbuf;
+	switch (pc->width)
+	{ // Little endian whatever the host
+	case 4: p[3] = v >> 24; p[2] = v >> 16; /* FALLTHRU */
+	case 2: p[1] = v >> 8;                  /* FALLTHRU */
+	default: p[0] = v;
+	}
+	pc->nbuf += pc->width;
+	return;
+}
+static int col(struct COL* pc, uint32_t id, const char* pname, const char* pdtype, uint8_t width)
+{
+	memset(pc, 0, sizeof(struct COL));
+	snprintf(pc->file, CCOL_NAME, "%08X.%s", id, pname);
+	snprintf(pc->name, CFMTMAPNAME, "%s", pname);
+	pc->dtype = pdtype;
+	pc->width = width;
+	pc->pbuf  = (uint8_t*)malloc(CCOL_BUFSZ);
+	return (pc->pbuf == NULL) ? -1 : 0;
+}
+/* ************************************************************************************************************
+ * static struct CID* cid(struct WRK* pw, uint32_t id);
+ * @brief	: Find an id, or add it and its columns
+ * @return	: pointer; NULL = too many ids or out of memory ('err' set)
+ * ************************************************************************************************************ */
+static struct CID* cid(struct WRK* pw, uint32_t id)
+{
+	const struct CFMTFLD* pf;
+	struct CID* p;
+	uint32_t h = hash(id) & (2 * CCOL_MAXID - 1);
+	uint32_t i;
+	int ret;
+
+	while ((p = pw->ptbl[h]) != NULL)
+	{
+		if (p->id == id) return p;
+		h = (h + 1) & (2 * CCOL_MAXID - 1);
+	}
+	if (__atomic_add_fetch(&pw->pctx->nid, 1, __ATOMIC_RELAXED) > CCOL_MAXID)
+	{
+		pw->err = -1;
+		return NULL;
+	}
+	p = (struct CID*)calloc(1, sizeof(struct CID));
+	if (p == NULL) goto nomem;
+	p->id = id;
+	p->pe = (pw->pctx->pcfg->pmap == NULL) ? NULL : cfmtmap_find(pw->pctx->pcfg->pmap, id);
+	p->ncol = 2 + ((p->pe == NULL) ? 1 : p->pe->n);
+	p->pcol = (struct COL*)calloc(p->ncol, sizeof(struct COL));
+	if (p->pcol == NULL) goto nomem;
+
+	ret  = col(&p->pcol[0], id, "time", "<u4", 4);
+	ret |= col(&p->pcol[1], id, "dlc", "|u1", 1);
+	if (p->pe == NULL)
+		ret |= col(&p->pcol[2], id, "payload", "|u1", 8);
+	else
+	{
+		for (i = 0; i < p->pe->n; i++)
+		{
+			pf = &p->pe->f[i];
+			ret |= col(&p->pcol[2 + i], id, pf->name, fmtdtype[pf->fmt], fmtwidth[pf->fmt]);
+		}
+	}
+	if (ret != 0) goto nomem;
+	pw->ptbl[h] = p;
+	pw->plist[pw->nid++] = p;
+	return p;
+
+nomem:
+	pw->err = -2;
+	return NULL;
+}
+/* ************************************************************************************************************
+ * static void line(struct WRK* pw, const char* pc, uint32_t tick);
+ * @brief	: Decode a gateway line and add its msg to its id's columns
+ * ************************************************************************************************************ */
+static void line(struct WRK* pw, const char* pc, uint32_t tick)
+{
+	const struct CFMTFLD* pf;
+	struct GBINMSG m;
+	struct CID* p;
+	struct COL* pk;
+	uint32_t i;
+
+	if (gbin_line(&pw->g, pc, &m) != 1) return;
+	p = cid(pw, m.id);
+	if (p == NULL) return;
+
+	put(pw, &p->pcol[0], tick);
+	put(pw, &p->pcol[1], m.dlc);
+	if (p->pe == NULL)
+	{
+		pk = &p->pcol[2];
+		if ((pk->nbuf + 8) > CCOL_BUFSZ) flush(pw, pk);
+		memcpy(pk->pbuf + pk->nbuf, m.uc, 8);
+		pk->nbuf += 8;
+	}
+	else
+	{
+		for (i = 0; i < p->pe->n; i++)
+		{
+			pf = &p->pe->f[i];
+			put(pw, &p->pcol[2 + i], (pf->end <= m.dlc) ? paydesc_bits(&m.uc[pf->off], pf->fmt) : 0);
+		}
+	}
+	p->rows += 1;
+	return;
+}
+/* ************************************************************************************************************
+ * Decode thread: batches until 'done'
+ * ************************************************************************************************************ */
+static void* wrkthread(void* parg)
+{
+	struct WRK* pw = (struct WRK*)parg;
+	struct BATCH* pb;
+	uint32_t i;
+
+	for (;;)
+	{
+		pthread_mutex_lock(&pw->mx);
+		while ((pw->tail == pw->head) && (pw->done == 0))
+			pthread_cond_wait(&pw->cv, &pw->mx);
+		if (pw->tail == pw->head)
+		{
+			pthread_mutex_unlock(&pw->mx);
+			break;
+		}
+		pb = &pw->pb[pw->tail % CCOL_NBATCH];
+		pthread_mutex_unlock(&pw->mx);
+
+		for (i = 0; i < pb->n; i++)
+			line(pw, pb->ln[i].c, pb->ln[i].tick);
+
+		pthread_mutex_lock(&pw->mx);
+		pw->tail += 1;
+		pthread_cond_broadcast(&pw->cv);
+		pthread_mutex_unlock(&pw->mx);
+	}
+	return NULL;
+}
+/* Split thread: hand the batch being filled to its decode thread */
+static void post(struct WRK* pw)
+{
+	pthread_mutex_lock(&pw->mx);
+	pw->head += 1;
+	pthread_cond_broadcast(&pw->cv);
+	pthread_mutex_unlock(&pw->mx);
+	pw->pcur = NULL;
+	return;
+}
+/* Split thread: a line for the decode thread of its id */
+static void give(struct CTX* pctx, uint32_t id, const char* pc, uint32_t len, uint32_t tick)
+{
+	struct WRK* pw = &pctx->pw[hash(id) % pctx->nthr];
+	struct LN* pl;
+	char c[LNSZ + 1];
+
+	if (pctx->nthr == 1)
+	{ // Here, no threads: decode now
+		memcpy(c, pc, len);
+		c[len] = 0;
+		line(pw, c, tick);
+		return;
+	}
+	if (pw->pcur == NULL)
+	{ // Wait for a free batch
+		pthread_mutex_lock(&pw->mx);
+		while ((pw->head - pw->tail) >= CCOL_NBATCH)
+			pthread_cond_wait(&pw->cv, &pw->mx);
+		pthread_mutex_unlock(&pw->mx);
+		pw->pcur = &pw->pb[pw->head % CCOL_NBATCH];
+		pw->pcur->n = 0;
+	}
+	pl = &pw->pcur->ln[pw->pcur->n++];
+	pl->tick = tick;
+	memcpy(pl->c, pc, len);
+	pl->c[len] = 0;
+	if (pw->pcur->n == CCOL_BATCH) post(pw);
+	return;
+}
+/* Split thread: one line (no terminator) */
+static void split(struct CTX* pctx, struct CCOLSTAT* pst, const char* pc, size_t len)
+{
+	uint8_t b[6];
+	uint32_t id;
+
+	pst->lines += 1;
+	if ((len > 0) && (pc[len - 1] == '\r')) len -= 1;
+	if ((len < 12) || (hexcodec_decode(b, pc, 12) != 6))
+	{
+		pst->other += 1;
+		return;
+	}
+	id = b[1] | (b[2] << 8) | (b[3] << 16) | ((uint32_t)b[4] << 24);
+	if (id == pctx->pcfg->syncid) pst->ticks += 1;
+	if ((len < 14) || (len > LNSZ))
+	{
+		pst->other += 1;
+		return;
+	}
+	give(pctx, id, pc, len, pst->ticks);
+	return;
+}
+static int cmpcid(const void* pa, const void* pb)
+{
+	uint32_t a = (*(struct CID* const*)pa)->id;
+	uint32_t b = (*(struct CID* const*)pb)->id;
+	return (a > b) - (a < b);
+}
+/* ************************************************************************************************************
+ * static int schema(struct CTX* pctx, struct CID** pl, uint32_t n, const struct CCOLSTAT* pst);
+ * @brief	: Write schema.json (to a temp name, then renamed)
+ * @return	: 0 = OK; -1 = write error
+ * ************************************************************************************************************ */
+static int schema(struct CTX* pctx, struct CID** pl, uint32_t n, const struct CCOLSTAT* pst)
+{
+	const struct CCOLCFG* pcfg = pctx->pcfg;
+	const struct CFMTFLD* pf;
+	const char* ps;
+	char path[4096];
+	char tmp[4096 + 8];
+	uint32_t i;
+	uint32_t k;
+	FILE* fp;
+
+	snprintf(path, sizeof(path), "%s/%s", pcfg->dir, CCOL_SCHEMA);
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	fp = fopen(tmp, "w");
+	if (fp == NULL) return -1;
+
+	fprintf(fp, "{\n\"format\": \"cancol 1\",\n\"source\": \"");
+	for (ps = (pcfg->src == NULL) ? "" : pcfg->src; *ps != 0; ps++)
+	{
+		if ((*ps == '"') || (*ps == '\\')) fputc('\\', fp);
+		fputc(*ps, fp);
+	}
+	fprintf(fp, "\",\n\"tickhz\": %d,\n\"syncid\": \"%08X\",\n\"ticks\": %u,\n\"msgs\": %lu,\n\"columns\": [\n",
+		CCOL_TICKHZ, pcfg->syncid, pst->ticks, (unsigned long)pst->msgs);
+	for (i = 0; i < n; i++)
+	{
+		for (k = 0; k < pl[i]->ncol; k++)
+		{
+			pf = ((k >= 2) && (pl[i]->pe != NULL)) ? &pl[i]->pe->f[k - 2] : NULL;
+			fprintf(fp, "{\"id\": \"%08X\", \"name\": \"%s\", \"file\": \"%s\", \"dtype\": \"%s\", \"width\": %u, "
+				"\"rows\": %lu, \"scale\": %.17g, \"offset\": %d, \"hex\": %d}%s\n",
+				pl[i]->id, pl[i]->pcol[k].name, pl[i]->pcol[k].file, pl[i]->pcol[k].dtype, pl[i]->pcol[k].width,
+				(unsigned long)pl[i]->rows, (pf == NULL) ? 1.0 : pf->scale, (pf == NULL) ? 0 : pf->offset,
+				((pf != NULL) && (pf->dec == -1)), ((i + 1 == n) && (k + 1 == pl[i]->ncol)) ? "" : ",");
+		}
+	}
+	fprintf(fp, "]\n}\n");
+	if ((ferror(fp) != 0) | (fclose(fp) != 0)) return -1;
+	return rename(tmp, path);
+}
+/* ************************************************************************************************************
+ * int cancol_convert(int fd, const struct CCOLCFG* pcfg, struct CCOLSTAT* pst, char* perr, int errsz);
+ * @brief	: Convert a log to column files
+ * @param	: fd = log (file or pipe), read to its end
+ * @param	: pcfg = pointer to settings
+ * @param	: pst = pointer to counts (filled in)
+ * @param	: perr = error message
+ * @param	: errsz = size of 'perr'
+ * @return	: 0 = OK; -1 = error (see 'perr')
+ * ************************************************************************************************************ */
+int cancol_convert(int fd, const struct CCOLCFG* pcfg, struct CCOLSTAT* pst, char* perr, int errsz)
+{
+	struct CTX ctx;
+	struct WRK* pw;
+	struct CID** pall = NULL;
+	const char* pnl;
+	char* pin;
+	size_t have = 0;
+	size_t s;
+	ssize_t k;
+	uint32_t i;
+	uint32_t j;
+	uint32_t m;
+	int nthr = (pcfg->nthr < 1) ? 1 : pcfg->nthr;
+	int skip = 0;  // 1 = in a line too long to be a gateway line
+	int nstart = 0;
+	int err = 0;
+
+	memset(pst, 0, sizeof(struct CCOLSTAT));
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.pcfg = pcfg;
+	ctx.nthr = nthr;
+
+	/* Map field names must not be the fixed column names */
+	for (i = 0; (pcfg->pmap != NULL) && (i < pcfg->pmap->n); i++)
+		for (j = 0; j < pcfg->pmap->pe[i].n; j++)
+			if ((strcmp(pcfg->pmap->pe[i].f[j].name, "time") == 0) || (strcmp(pcfg->pmap->pe[i].f[j].name, "dlc") == 0))
+			{
+				snprintf(perr, errsz, "map: id %08X: field name '%s' is a column every id has", pcfg->pmap->pe[i].id,
+					pcfg->pmap->pe[i].f[j].name);
+				return -1;
+			}
+	if ((mkdir(pcfg->dir, 0755) != 0) && (errno != EEXIST))
+	{
+		snprintf(perr, errsz, "%s: %s", pcfg->dir, strerror(errno));
+		return -1;
+	}
+
+	pin = (char*)malloc(CCOL_INSZ);
+	ctx.pw = (struct WRK*)calloc(nthr, sizeof(struct WRK));
+	if ((pin == NULL) || (ctx.pw == NULL)) goto nomem;
+	for (i = 0; i < (uint32_t)nthr; i++)
+	{
+		pw = &ctx.pw[i];
+		pw->pctx  = &ctx;
+		pw->ptbl  = (struct CID**)calloc(2 * CCOL_MAXID, sizeof(struct CID*));
+		pw->plist = (struct CID**)calloc(CCOL_MAXID, sizeof(struct CID*));
+		if ((pw->ptbl == NULL) || (pw->plist == NULL)) goto nomem;
+		gbin_init(&pw->g, GBIN_MODE_ASCII);
+		if (nthr == 1) continue;
+		pw->pb = (struct BATCH*)malloc(CCOL_NBATCH * sizeof(struct BATCH));
+		if (pw->pb == NULL) goto nomem;
+		pthread_mutex_init(&pw->mx, NULL);
+		pthread_cond_init(&pw->cv, NULL);
+		if (pthread_create(&pw->th, NULL, wrkthread, pw) != 0)
+		{
+			err = -2;
+			break;
+		}
+		nstart += 1;
+	}
+
+	/* Split lines as they are read; a piece of a line is moved to the front */
+	while (err == 0)
+	{
+		k = read(fd, pin + have, CCOL_INSZ - have);
+		if (k < 0)
+		{
+			if (errno == EINTR) continue;
+			err = errno;
+			break;
+		}
+		pst->bytes += k;
+		have += k;
+		s = 0;
+		while ((pnl = memchr(pin + s, '\n', have - s)) != NULL)
+		{
+			if (skip == 0)
+				split(&ctx, pst, pin + s, pnl - (pin + s));
+			skip = 0;
+			s = pnl - pin + 1;
+		}
+		if (k == 0)
+		{ // End: last line without a '\n'
+			if ((have > s) && (skip == 0)) split(&ctx, pst, pin + s, have - s);
+			break;
+		}
+		if ((have - s) > (CCOL_INSZ / 2))
+		{ // Here, no '\n' in a long way: not gateway lines
+			if (skip == 0)
+			{
+				pst->lines += 1;
+				pst->other += 1;
+			}
+			skip = 1;
+			s = have;
+		}
+		memmove(pin, pin + s, have - s);
+		have -= s;
+	}
+
+	/* Decode threads: last batches, then wait for them */
+	for (i = 0; i < (uint32_t)nstart; i++)
+	{
+		pw = &ctx.pw[i];
+		if (pw->pcur != NULL) post(pw);
+		pthread_mutex_lock(&pw->mx);
+		pw->done = 1;
+		pthread_cond_broadcast(&pw->cv);
+		pthread_mutex_unlock(&pw->mx);
+		pthread_join(pw->th, NULL);
+	}
+
+	/* Rest of the columns out; counts; all the ids, by id */
+	pall = (struct CID**)malloc((ctx.nid + 1) * sizeof(struct CID*));
+	if (pall == NULL) goto nomem;
+	for (i = 0; i < (uint32_t)nthr; i++)
+	{
+		pw = &ctx.pw[i];
+		for (j = 0; j < pw->nid; j++)
+		{
+			for (m = 0; m < pw->plist[j]->ncol; m++)
+				flush(pw, &pw->plist[j]->pcol[m]);
+			pall[pst->nid++] = pw->plist[j];
+			pst->ncol += pw->plist[j]->ncol;
+		}
+		pst->msgs    += pw->g.msgs;
+		pst->chkerr  += pw->g.chkerr;
+		pst->sizeerr += pw->g.sizeerr;
+		if ((pw->err != 0) && (err == 0)) err = pw->err;
+	}
+	qsort(pall, pst->nid, sizeof(struct CID*), cmpcid);
+	if (err == -1)
+		snprintf(perr, errsz, "more than %d CAN ids", CCOL_MAXID);
+	else if (err == -2)
+		snprintf(perr, errsz, "out of memory");
+	else if (err != 0)
+		snprintf(perr, errsz, "%s: %s", pcfg->dir, strerror(err));
+	else if (schema(&ctx, pall, pst->nid, pst) != 0)
+	{
+		snprintf(perr, errsz, "%s/%s: %s", pcfg->dir, CCOL_SCHEMA, strerror(errno));
+		err = -3;
+	}
+	goto done;
+
+nomem:
+	snprintf(perr, errsz, "out of memory");
+	err = -2;
+done:
+	for (i = 0; (ctx.pw != NULL) && (i < (uint32_t)nthr); i++)
+	{
+		pw = &ctx.pw[i];
+		for (j = 0; j < pw->nid; j++)
+		{
+			for (m = 0; m < pw->plist[j]->ncol; m++)
+				free(pw->plist[j]->pcol[m].pbuf);
+			free(pw->plist[j]->pcol);
+			free(pw->plist[j]);
+		}
+		free(pw->ptbl);
+		free(pw->plist);
+		free(pw->pb);
+	}
+	free(ctx.pw);
+	free(pall);
+	free(pin);
+	return (err == 0) ? 0 : -1;
+}
+/* ************************************************************************************************************
+ * Schema line fields (cancol_open)
+ * ************************************************************************************************************ */
+static const char* key(const char* pl, const char* pkey)
+{
+	char k[24];
+	const char* p;
+
+	snprintf(k, sizeof(k), "\"%s\": ", pkey);
+	p = strstr(pl, k);
+	return (p == NULL) ? NULL : (p + strlen(k));
+}
+static int keystr(const char* pl, const char* pkey, char* pout, int size)
+{
+	const char* p = key(pl, pkey);
+	int i;
+
+	if ((p == NULL) || (*p++ != '"')) return -1;
+	for (i = 0; (p[i] != '"') && (p[i] != 0); i++)
+	{
+		if (i >= (size - 1)) return -1;
+		pout[i] = p[i];
+	}
+	pout[i] = 0;
+	return 0;
+}
+static double keynum(const char* pl, const char* pkey)
+{
+	const char* p = key(pl, pkey);
+	return (p == NULL) ? 0 : strtod(p, NULL);
+}
+/* ************************************************************************************************************
+ * int cancol_open(struct CANCOL* p, const char* dir);
+ * @brief	: Map the columns of a converted log
+ * @param	: p = pointer to columns (filled in)
+ * @param	: dir = directory 'cancol_convert' made
+ * @return	: 0 = OK; -1 = no schema; -2 = a column file missing or short; -3 = out of memory
+ * ************************************************************************************************************ */
+int cancol_open(struct CANCOL* p, const char* dir)
+{
+	struct CCOLCOL* pc;
+	struct stat sb;
+	char path[4096];
+	char ln[512];
+	char sid[12];
+	uint32_t size = 0;
+	size_t len;
+	void* pm;
+	FILE* fp;
+	int fd;
+
+	memset(p, 0, sizeof(struct CANCOL));
+	snprintf(path, sizeof(path), "%s/%s", dir, CCOL_SCHEMA);
+	fp = fopen(path, "r");
+	if (fp == NULL) return -1;
+	while (fgets(ln, sizeof(ln), fp) != NULL)
+	{
+		if (strncmp(ln, "\"ticks\": ", 9) == 0) p->ticks = strtoul(ln + 9, NULL, 10);
+		if (key(ln, "file") == NULL) continue;
+
+		if (p->n == size)
+		{
+			size = (size == 0) ? 64 : (size * 2);
+			pc = (struct CCOLCOL*)realloc(p->pc, size * sizeof(struct CCOLCOL));
+			if (pc == NULL)
+			{
+				fclose(fp);
+				cancol_close(p);
+				return -3;
+			}
+			p->pc = pc;
+		}
+		pc = &p->pc[p->n];
+		memset(pc, 0, sizeof(struct CCOLCOL));
+		if ((keystr(ln, "id", sid, sizeof(sid)) != 0) || (keystr(ln, "name", pc->name, CFMTMAPNAME) != 0)
+		 || (keystr(ln, "file", pc->file, CCOL_NAME) != 0) || (keystr(ln, "dtype", pc->dtype, sizeof(pc->dtype)) != 0))
+			continue;
+		pc->id     = strtoul(sid, NULL, 16);
+		pc->width  = keynum(ln, "width");
+		pc->rows   = keynum(ln, "rows");
+		pc->scale  = keynum(ln, "scale");
+		pc->offset = keynum(ln, "offset");
+		pc->hex    = keynum(ln, "hex");
+		p->n += 1;
+
+		len = pc->rows * pc->width;
+		if (len == 0) continue;
+		snprintf(path, sizeof(path), "%s/%s", dir, pc->file);
+		fd = open(path, O_RDONLY);
+		if ((fd < 0) || (fstat(fd, &sb) != 0) || ((size_t)sb.st_size < len))
+		{
+			if (fd >= 0) close(fd);
+			fclose(fp);
+			cancol_close(p);
+			return -2;
+		}
+		pm = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (pm == MAP_FAILED)
+		{
+			fclose(fp);
+			cancol_close(p);
+			return -3;
+		}
+		pc->p = pm;
+	}
+	fclose(fp);
+	return (p->n == 0) ? -1 : 0;
+}
+/* ************************************************************************************************************
+ * void cancol_close(struct CANCOL* p);
+ * @brief	: Unmap columns
+ * ************************************************************************************************************ */
+void cancol_close(struct CANCOL* p)
+{
+	uint32_t i;
+
+	for (i = 0; i < p->n; i++)
+		if (p->pc[i].p != NULL) munmap((void*)p->pc[i].p, p->pc[i].rows * p->pc[i].width);
+	free(p->pc);
+	memset(p, 0, sizeof(struct CANCOL));
+	return;
+}
+/* ************************************************************************************************************
+ * const struct CCOLCOL* cancol_find(const struct CANCOL* p, uint32_t id, const char* name);
+ * @brief	: Look up a column
+ * @param	: p = pointer to columns
+ * @param	: id = CAN id
+ * @param	: name = "time", "dlc", "payload" or a signal name
+ * @return	: pointer to column; NULL = none
+ * ************************************************************************************************************ */
+const struct CCOLCOL* cancol_find(const struct CANCOL* p, uint32_t id, const char* name)
+{
+	uint32_t i;
+
+	for (i = 0; i < p->n; i++)
+		if ((p->pc[i].id == id) && (strcmp(p->pc[i].name, name) == 0)) return &p->pc[i];
+	return NULL;
+}
+/* ************************************************************************************************************
+ * double cancol_value(const struct CCOLCOL* pc, uint64_t k);
+ * @brief	: A row of a signal column, scaled: (raw + offset) * scale
+ * @param	: pc = pointer to column (not payload)
+ * @param	: k = row
+ * @return	: value
+ * ************************************************************************************************************ */
+double cancol_value(const struct CCOLCOL* pc, uint64_t k)
+{
+	const uint8_t* p = (const uint8_t*)pc->p + k * pc->width;
+	union {uint32_t u; float f;} x;
+	double v;
+
+	x.u = p[0];
+	if (pc->width >= 2) x.u |= p[1] << 8;
+	if (pc->width >= 4) x.u |= (p[2] << 16) | ((uint32_t)p[3] << 24);
+	switch (pc->dtype[1])
+	{
+	case 'f': v = x.f; break;
+	case 'i': v = (pc->width == 1) ? (int8_t)x.u : (pc->width == 2) ? (int16_t)x.u : (int32_t)x.u; break;
+	default:  v = x.u; break;
+	}
+	return (v + pc->offset) * pc->scale;
+}
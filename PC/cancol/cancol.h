@@ -0,0 +1,137 @@
+/* *****************************************************************************
+* File Name          : cancol.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Gateway CAN logs to column files (one per signal) for analysis
+****************************************************************************** */
+/*
+A log converts to a directory--
+  schema.json           what the columns are (below)
+  <id>.time             <u4  ticks (time sync msgs, 64/sec) up to and including the msg
+  <id>.dlc              |u1  payload byte count
+  <id>.<signal>         one per field the CAN id map (../canfmt/cfmtmap.h) gives the id
+  <id>.payload          |u1 x 8, for ids not in the map (or no map)
+
+Every file of an id has one row per msg with that id (good checksum), in
+log order, fixed width, little endian, no header: row k of every file
+of the id is the same msg.  A field past the msg's dlc is 0 (see .dlc).
+Signal values are the raw field, as the map file would print it when
+(raw + offset) * scale; the scale and offset are in the schema.  Big
+endian (I16) fields are stored little endian; half and 3/4 floats are
+stored as 4 byte floats.
+
+Time: as in ../canidx, the count of time sync msgs (CANID_HB_TIMESYNC,
+00400000) in lines with a hex header, from the start of the log.
+
+schema.json has one column per line, so it can be read without a JSON
+parser (cancol_open does), e.g.
+  {"id": "47600000", "name": "rpm", "file": "47600000.rpm", "dtype": "<u2", "width": 2, "rows": 2279, "scale": 1, "offset": -20000, "hex": 0},
+The 'dtype' strings are numpy's: in Python
+  c = [x for x in json.load(open(d + "/schema.json"))["columns"] if x["id"] == "47600000"]
+  rpm = (numpy.memmap(d + "/47600000.rpm", dtype = "<u2", mode = "r") - 20000) * 1
+
+Conversion streams: the input is read in pieces; one thread splits lines
+and counts time, and each CAN id belongs to one of 'nthr' decode threads
+(by a hash of the id), which decodes (gatewaybin), checks the checksum,
+pulls out the fields and appends to that id's columns.  Memory is the
+line batches between the threads plus CCOL_BUFSZ per column, whatever the
+size of the log; the output does not depend on the number of threads.
+*/
+
+#ifndef __CANCOL
+#define __CANCOL
+
+#include <stdint.h>
+#include <stddef.h>
+#include "cfmtmap.h"
+
+#define CCOL_SCHEMA  "schema.json"
+#define CCOL_SYNCID  0x00400000  // CANID_HB_TIMESYNC: 64 per sec
+#define CCOL_TICKHZ  64
+#define CCOL_MAXID   4096        // CAN ids in a log
+#define CCOL_BUFSZ   (16 << 10)  // Column write buffer (bytes)
+#define CCOL_BATCH   4096        // Lines passed to a decode thread at a time
+#define CCOL_NBATCH  4           // Batches queued per decode thread
+#define CCOL_INSZ    (1 << 20)   // Input read size
+#define CCOL_NAME    (CFMTMAPNAME + 12) // File name chars: id, '.', name, '\0'
+
+/* Conversion settings */
+struct CCOLCFG
+{
+	const char* dir;               // Output directory (made if not there)
+	const char* src;               // Log name, for the schema
+	const struct CFMTMAP* pmap;    // CAN id map; NULL = payload columns only
+	uint32_t syncid;               // Id counted for time
+	int      nthr;                 // Decode threads (1 = none: all in the caller's)
+};
+
+/* Conversion counts */
+struct CCOLSTAT
+{
+	uint64_t bytes;   // Chars read
+	uint64_t lines;   // Lines
+	uint64_t other;   // Not gateway lines (not hex header, length)
+	uint64_t msgs;    // Msgs stored
+	uint64_t chkerr;  // Bad checksum
+	uint64_t sizeerr; // dlc and length disagree, or not hex
+	uint32_t ticks;
+	uint32_t nid;     // CAN ids
+	uint32_t ncol;    // Column files
+};
+
+/* A column, mapped */
+struct CCOLCOL
+{
+	uint32_t id;
+	char     name[CFMTMAPNAME];
+	char     file[CCOL_NAME];
+	char     dtype[8];
+	uint8_t  width;   // Bytes per row
+	uint8_t  hex;     // 1 = map printed it in hex
+	uint64_t rows;
+	double   scale;
+	int32_t  offset;
+	const void* p;    // Rows (NULL if none)
+};
+
+struct CANCOL
+{
+	struct CCOLCOL* pc; // Columns [n], in schema order (by id)
+	uint32_t n;
+	uint32_t ticks;
+};
+
+/* ************************************************************************************************************ */
+int cancol_convert(int fd, const struct CCOLCFG* pcfg, struct CCOLSTAT* pst, char* perr, int errsz);
+/* @brief	: Convert a log to column files
+ * @param	: fd = log (file or pipe), read to its end
+ * @param	: pcfg = pointer to settings
+ * @param	: pst = pointer to counts (filled in)
+ * @param	: perr = error message
+ * @param	: errsz = size of 'perr'
+ * @return	: 0 = OK; -1 = error (see 'perr')
+ * ************************************************************************************************************ */
+int cancol_open(struct CANCOL* p, const char* dir);
+/* @brief	: Map the columns of a converted log
+ * @param	: p = pointer to columns (filled in)
+ * @param	: dir = directory 'cancol_convert' made
+ * @return	: 0 = OK; -1 = no schema; -2 = a column file missing or short; -3 = out of memory
+ * ************************************************************************************************************ */
+void cancol_close(struct CANCOL* p);
+/* @brief	: Unmap columns
+ * ************************************************************************************************************ */
+const struct CCOLCOL* cancol_find(const struct CANCOL* p, uint32_t id, const char* name);
+/* @brief	: Look up a column
+ * @param	: p = pointer to columns
+ * @param	: id = CAN id
+ * @param	: name = "time", "dlc", "payload" or a signal name
+ * @return	: pointer to column; NULL = none
+ * ************************************************************************************************************ */
+double cancol_value(const struct CCOLCOL* pc, uint64_t k);
+/* @brief	: A row of a signal column, scaled: (raw + offset) * scale
+ * @param	: pc = pointer to column (not payload)
+ * @param	: k = row
+ * @return	: value
+ * ************************************************************************************************************ */
+
+#endif
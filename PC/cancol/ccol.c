@@ -0,0 +1,166 @@
+/* *****************************************************************************
+* File Name          : ccol.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Convert a gateway CAN log to column files (cancol.h)
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 ccol.c cancol.c ../canfmt/cfmtmap.c ../gatewaybin/gatewaybin.c ../../Ourwares/hexcodec.c ../../Ourwares/paydesc.c -I. -I../canfmt -I../gatewaybin -I../../Ourwares -pthread -lm -o ccol
+
+Convert (log file, or stdin; -j 0 = one decode thread per core)--
+./ccol -m ../canfmt/dmoc.map -j 0 -v /tmp/day1 bigday.txt
+minicom ... | ./ccol -m ../canfmt/dmoc.map /tmp/day1
+
+List the columns of a converted log (rows, min, max, scaled)--
+./ccol -l /tmp/day1
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <time.h>
+#include "cancol.h"
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec + ts.tv_nsec * 1E-9);
+}
+/* List columns */
+static int list(const char* dir)
+{
+	struct CANCOL cc;
+	const struct CCOLCOL* pc;
+	double v, vmin, vmax;
+	uint64_t k;
+	uint32_t i;
+	int ret;
+
+	ret = cancol_open(&cc, dir);
+	if (ret != 0)
+	{
+		fprintf(stderr, "ccol: %s: %s\n", dir, (ret == -1) ? "no schema" : (ret == -2) ? "column file missing or short" : "out of memory");
+		return 1;
+	}
+	printf("%u ticks (%.1f sec)\n%-8s %-16s %-5s %10s %14s %14s\n", cc.ticks, (double)cc.ticks / CCOL_TICKHZ,
+		"id", "column", "dtype", "rows", "min", "max");
+	for (i = 0; i < cc.n; i++)
+	{
+		pc = &cc.pc[i];
+		printf("%08X %-16s %-5s %10lu", pc->id, pc->name, pc->dtype, (unsigned long)pc->rows);
+		if ((pc->width > 4) || (pc->rows == 0))
+		{
+			printf("\n");
+			continue;
+		}
+		vmin = vmax = cancol_value(pc, 0);
+		for (k = 1; k < pc->rows; k++)
+		{
+			v = cancol_value(pc, k);
+			if (v < vmin) vmin = v;
+			if (v > vmax) vmax = v;
+		}
+		if (pc->hex != 0)
+			printf(" %#14lx %#14lx\n", (unsigned long)vmin, (unsigned long)vmax);
+		else
+			printf(" %14.6g %14.6g\n", vmin, vmax);
+	}
+	cancol_close(&cc);
+	return 0;
+}
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	struct CCOLCFG cfg;
+	struct CCOLSTAT st;
+	struct CFMTMAP map;
+	char err[256];
+	FILE* fp;
+	int verbose = 0;
+	int fd = 0;
+	int c;
+	double t;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.syncid = CCOL_SYNCID;
+	cfg.nthr   = 1;
+	cfg.src    = "-";
+
+	while ((c = getopt(argc, argv, "m:j:s:lv")) != -1)
+	{
+		switch (c)
+		{
+		case 'm':
+			fp = fopen(optarg, "r");
+			if (fp == NULL)
+			{
+				perror(optarg);
+				return 1;
+			}
+			if (cfmtmap_load(&map, fp, err, sizeof(err)) != 0)
+			{
+				fprintf(stderr, "%s: %s\n", optarg, err);
+				return 1;
+			}
+			fclose(fp);
+			cfg.pmap = &map;
+			break;
+		case 'j': // Decode threads; 0 = one per core
+			cfg.nthr = atoi(optarg);
+			if (cfg.nthr <= 0) cfg.nthr = sysconf(_SC_NPROCESSORS_ONLN);
+			if (cfg.nthr <= 0) cfg.nthr = 1;
+			break;
+		case 's': // Time sync CAN id
+			cfg.syncid = strtoul(optarg, NULL, 16);
+			break;
+		case 'l':
+			if (optind != (argc - 1)) goto usage;
+			return list(argv[optind]);
+		case 'v': verbose = 1; break;
+		default:
+			goto usage;
+		}
+	}
+	if ((optind != (argc - 1)) && (optind != (argc - 2))) goto usage;
+	cfg.dir = argv[optind];
+	if (optind == (argc - 2))
+	{
+		cfg.src = argv[optind + 1];
+		fd = open(cfg.src, O_RDONLY);
+		if (fd < 0)
+		{
+			perror(cfg.src);
+			return 1;
+		}
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	}
+
+	t = now();
+	if (cancol_convert(fd, &cfg, &st, err, sizeof(err)) != 0)
+	{
+		fprintf(stderr, "ccol: %s\n", err);
+		return 1;
+	}
+	t = now() - t;
+	if (verbose != 0)
+	{
+		fprintf(stderr, "%.1f MB in %.2f s (%.0f MB/s), %d decode threads\n", st.bytes / 1E6, t, st.bytes / t / 1E6, cfg.nthr);
+		fprintf(stderr, "lines %lu: msgs %lu, bad checksum %lu, bad size %lu, other %lu; %u ticks (%.1f sec)\n",
+			(unsigned long)st.lines, (unsigned long)st.msgs, (unsigned long)st.chkerr, (unsigned long)st.sizeerr,
+			(unsigned long)st.other, st.ticks, (double)st.ticks / CCOL_TICKHZ);
+		fprintf(stderr, "%s: %u ids, %u columns\n", cfg.dir, st.nid, st.ncol);
+	}
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-m mapfile] [-j threads] [-s syncid] [-v] outdir [logfile]\n"
+	                "       %s -l outdir\n", argv[0], argv[0]);
+	return 1;
+}
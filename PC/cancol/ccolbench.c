@@ -0,0 +1,245 @@
+/* *****************************************************************************
+* File Name          : ccolbench.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : cancol: conversion speed, and column load vs reparsing the text log
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 ccolbench.c cancol.c ../canfmt/cfmtmap.c ../gatewaybin/gatewaybin.c ../../Ourwares/hexcodec.c ../../Ourwares/paydesc.c -I. -I../canfmt -I../gatewaybin -I../../Ourwares -pthread -lm -o ccolbench
+./ccolbench ../../docs/data/log200220-2.txt ../canfmt/dmoc.map /tmp/big.txt /tmp/bigcol [MB [threads]]
+
+Makes 'big.txt' (default 512 MB) from copies of the sample log, if it is
+not already there at that size, and converts it to 'bigcol' with 1 and
+'threads' decode threads (default: one per core); the peak memory of the
+process is shown after each.  Then an analysis step, done on the columns
+(map, then sum) and on the text log (parse every line, as the scripts do
+now): the mean of one signal (DMOC speed), and the sum of every signal.
+The results are checked the same both ways (the sum of every signal to
+1E-9: it is added up in a different order).  Files in the page cache.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include "cancol.h"
+#include "gatewaybin.h"
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec + ts.tv_nsec * 1E-9);
+}
+static long maxrss(void)
+{
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_maxrss; // KB
+}
+
+/* Text: parse every line, sum the signals of the ids in the map */
+struct TSUM
+{
+	double   rpm;   // Sum of 47600000 rpm...
+	uint64_t nrpm;  // ...and rows
+	double   all;   // Sum of every signal
+};
+static void text(const char* plog, size_t n, const struct CFMTMAP* pmap, struct TSUM* ps)
+{
+	const struct CFMTMAPE* pe;
+	const struct CFMTFLD* pf;
+	struct GBINMSG m;
+	struct GBIN g;
+	union {uint32_t u; float f;} x;
+	const char* pnl;
+	char ln[GBIN_RAWMAX * 2 + 1];
+	size_t s = 0;
+	size_t len;
+	double v;
+	int i;
+
+	gbin_init(&g, GBIN_MODE_ASCII);
+	memset(ps, 0, sizeof(struct TSUM));
+	while (s < n)
+	{
+		pnl = memchr(plog + s, '\n', n - s);
+		len = ((pnl == NULL) ? (plog + n) : pnl) - (plog + s);
+		if (len < sizeof(ln))
+		{
+			memcpy(ln, plog + s, len);
+			ln[len] = 0;
+			if ((gbin_line(&g, ln, &m) == 1) && ((pe = cfmtmap_find(pmap, m.id)) != NULL))
+			{
+				for (i = 0; i < pe->n; i++)
+				{
+					pf = &pe->f[i];
+					x.u = (pf->end <= m.dlc) ? paydesc_bits(&m.uc[pf->off], pf->fmt) : 0;
+					switch (pf->fmt)
+					{
+					case PAYFMT_S8:  v = (int8_t)x.u;  break;
+					case PAYFMT_S16: v = (int16_t)x.u; break;
+					case PAYFMT_S32: v = (int32_t)x.u; break;
+					case PAYFMT_FF:
+					case PAYFMT_HF:
+					case PAYFMT_F34F: v = x.f; break;
+					default:         v = x.u; break;
+					}
+					v = (v + pf->offset) * pf->scale;
+					ps->all += v;
+					if ((m.id == 0x47600000) && (i == 0))
+					{
+						ps->rpm  += v;
+						ps->nrpm += 1;
+					}
+				}
+			}
+		}
+		s += len + 1;
+	}
+	return;
+}
+
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	struct CFMTMAP map;
+	struct CCOLCFG cfg;
+	struct CCOLSTAT st;
+	struct CANCOL cc;
+	struct TSUM ts;
+	struct stat sb;
+	const struct CCOLCOL* pc;
+	char err[256];
+	size_t nmb = 512;
+	size_t n;
+	size_t nsmp;
+	uint64_t k;
+	uint32_t i;
+	char* psmp;
+	char* plog;
+	FILE* fp;
+	int nthr;
+	int j;
+	int fd;
+	double t, tcol, ttext;
+	double rpm, all;
+
+	if (argc < 5)
+	{
+		fprintf(stderr, "usage: %s samplelog mapfile biglog outdir [MB [threads]]\n", argv[0]);
+		return 1;
+	}
+	if (argc > 5) nmb = atoi(argv[5]);
+	nthr = (argc > 6) ? atoi(argv[6]) : sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthr <= 0) nthr = 1;
+
+	fp = fopen(argv[2], "r");
+	if ((fp == NULL) || (cfmtmap_load(&map, fp, err, sizeof(err)) != 0))
+	{
+		fprintf(stderr, "%s: %s\n", argv[2], (fp == NULL) ? "can't open" : err);
+		return 1;
+	}
+	fclose(fp);
+
+	/* Big log from copies of the sample */
+	if ((stat(argv[3], &sb) != 0) || ((size_t)sb.st_size < (nmb << 20)))
+	{
+		fp = fopen(argv[1], "r");
+		if (fp == NULL)
+		{
+			perror(argv[1]);
+			return 1;
+		}
+		fseek(fp, 0, SEEK_END);
+		nsmp = ftell(fp);
+		rewind(fp);
+		psmp = (char*)malloc(nsmp);
+		if ((psmp == NULL) || (nsmp == 0) || (fread(psmp, 1, nsmp, fp) != nsmp)) return 1;
+		fclose(fp);
+		fp = fopen(argv[3], "w");
+		if (fp == NULL)
+		{
+			perror(argv[3]);
+			return 1;
+		}
+		for (i = 0; (size_t)i * nsmp < (nmb << 20); i++)
+			if (fwrite(psmp, 1, nsmp, fp) != nsmp) return 1;
+		fclose(fp);
+		free(psmp);
+	}
+
+	/* Convert */
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.dir    = argv[4];
+	cfg.src    = argv[3];
+	cfg.pmap   = &map;
+	cfg.syncid = CCOL_SYNCID;
+	for (j = 1; j <= nthr; j += (nthr - 1 > 0) ? (nthr - 1) : 1)
+	{
+		fd = open(argv[3], O_RDONLY);
+		if (fd < 0) return 1;
+		cfg.nthr = j;
+		t = now();
+		if (cancol_convert(fd, &cfg, &st, err, sizeof(err)) != 0)
+		{
+			fprintf(stderr, "convert: %s\n", err);
+			return 1;
+		}
+		t = now() - t;
+		close(fd);
+		printf("convert -j %d: %.1f MB in %.2f s, %.0f MB/s, %.2f M msgs/s; peak memory %ld KB\n", j, st.bytes / 1E6,
+			t, st.bytes / t / 1E6, st.msgs / t / 1E6, maxrss());
+	}
+	printf("%lu msgs, %u ids, %u columns\n", (unsigned long)st.msgs, st.nid, st.ncol);
+
+	/* Load: columns */
+	t = now();
+	if (cancol_open(&cc, argv[4]) != 0) return 1;
+	pc = cancol_find(&cc, 0x47600000, "rpm");
+	if (pc == NULL) return 1;
+	for (rpm = 0, k = 0; k < pc->rows; k++)
+		rpm += cancol_value(pc, k);
+	tcol = now() - t;
+
+	/* Load: text */
+	fd = open(argv[3], O_RDONLY);
+	if ((fd < 0) || (fstat(fd, &sb) != 0)) return 1;
+	n = sb.st_size;
+	plog = (char*)mmap(NULL, n, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (plog == MAP_FAILED) return 1;
+	madvise(plog, n, MADV_SEQUENTIAL);
+	t = now();
+	text(plog, n, &map, &ts);
+	ttext = now() - t;
+	printf("%-26s %10s %10s %8s\n", "analysis", "text s", "columns s", "x");
+	printf("%-26s %10.3f %10.4f %8.0f%s\n", "mean DMOC speed", ttext, tcol, ttext / tcol,
+		((pc->rows == ts.nrpm) && (rpm == ts.rpm)) ? "" : "  DIFFERENT");
+
+	/* Every signal column (not time, dlc, payload) */
+	t = now();
+	for (all = 0, i = 0; i < cc.n; i++)
+	{
+		pc = &cc.pc[i];
+		if ((pc->width > 4) || (strcmp(pc->name, "time") == 0) || (strcmp(pc->name, "dlc") == 0)) continue;
+		for (k = 0; k < pc->rows; k++)
+			all += cancol_value(pc, k);
+	}
+	tcol = now() - t;
+	printf("%-26s %10.3f %10.4f %8.0f%s\n", "sum of every signal", ttext, tcol, ttext / tcol,
+		(fabs(all - ts.all) <= (1E-9 * fabs(ts.all))) ? "" : "  DIFFERENT"); // Summed in another order
+	cancol_close(&cc);
+	munmap(plog, n);
+	close(fd);
+	return 0;
+}
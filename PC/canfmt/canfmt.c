@@ -6,9 +6,17 @@
 ****************************************************************************** */
 
 /*
-gcc -Wall canfmt.c -o canfmt 
-gcc -Wall canfmt.c -o canfmt && ./canfmt < ~/GliderWinchItems/GEVCUr/docs/data/log200315.txt | tee x
+gcc -Wall -O2 canfmt.c cfmt.c cfmtmap.c ../../Ourwares/hexcodec.c ../../Ourwares/paydesc.c -I../../Ourwares -pthread -lm -o canfmt
 ./canfmt < ~/GliderWinchItems/GEVCUr/docs/data/log200315.txt | tee x
+./canfmt -j 0 < bigday.txt > bigday.fmt   (all cores)
+./canfmt -m dmoc.map < ~/GliderWinchItems/GEVCUr/docs/data/log200315.txt  (decoded fields)
+
+Updates:
+10/19/2026 Input memory mapped (or read whole from a pipe), table lookups in
+place of sscanf, one large write buffer, and '-j' to split the input into
+line aligned blocks done on threads.  Output is unchanged (see cfmt.h).
+10/19/2026 '-m mapfile': CAN id -> payload type map; lines for ids in the
+map get the payload fields decoded and scaled (see cfmtmap.h, dmoc.map).
 */
 
 #include <stdio.h>
@@ -17,59 +25,116 @@ gcc -Wall canfmt.c -o canfmt && ./canfmt < ~/GliderWinchItems/GEVCUr/docs/data/l
 #include <unistd.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cfmt.h"
+#include "cfmtmap.h"
 
-/* Line buffer size */
-#define LINESZ 512	// Longest CAN msg line length
-char buf[LINESZ];
-
-/* Line number used for locating problems */
-unsigned int linect = 0;
-
-FILE* fpIn;
-
-struct CANTBL
+static void out(const char* p, size_t n, void* parg)
 {
-	uint8_t seq;
-	uint32_t id;
-	uint8_t dlc;
-	uint8_t uc[8];
-};
+	ssize_t k;
+
+	while (n > 0)
+	{
+		k = write(1, p, n);
+		if (k <= 0)
+		{
+			perror("canfmt: write");
+			exit(1);
+		}
+		p += k;
+		n -= k;
+	}
+	return;
+}
 
 /* ************************************************************************************************************ */
 /*  Yes, this is where it starts.                                                                               */
 /* ************************************************************************************************************ */
 int main(int argc, char **argv)
 {
-	int m;
-	struct CANTBL cantblx;
-	uint32_t ui;
+	struct stat sb;
+	struct CFMTMAP map;
+	struct CFMTMAP* pmap = NULL;
+	char err[128];
+	FILE* fp;
+	char* pin = NULL;
+	size_t n = 0;
+	size_t size = 0;
+	ssize_t k;
+	int nthr = 1;
+	int mapped = 0;
+	int c;
 
-	while ( (fgets (&buf[0],LINESZ,stdin)) != NULL)	// Get a line from stdin
+	while ((c = getopt(argc, argv, "j:m:")) != -1)
 	{
-		if ((strlen(buf) > 12) && (strlen(buf) < 32))
+		switch (c)
 		{
-			sscanf(buf,"%2x",&cantblx.seq);
-
-			// The ascii hex order is little endian.  Convert to an unsigned int
-			cantblx.id = 0;
-			for (m = 10; m >= 2; m-=2)
+		case 'j': // Threads; 0 = one per core
+			nthr = atoi(optarg);
+			if (nthr <= 0) nthr = sysconf(_SC_NPROCESSORS_ONLN);
+			if (nthr <= 0) nthr = 1;
+			break;
+		case 'm': // CAN id -> payload type map
+			fp = fopen(optarg, "r");
+			if (fp == NULL)
 			{
-				sscanf(&buf[m],"%2x",&ui);
-				cantblx.id = (cantblx.id << 8) + ui;
+				perror(optarg);
+				return 1;
 			}
-			sscanf(&buf[10],"%2x",(char*)&cantblx.dlc);
-
-			printf("%03u %08X %1d ", cantblx.seq,cantblx.id,cantblx.dlc);
-
-			// Get payload bytes	converted to binary
-			for (m = 0; m < cantblx.dlc; m++)
+			if (cfmtmap_load(&map, fp, err, sizeof(err)) != 0)
 			{
-				sscanf(&buf[12+2*m]," %2x",(unsigned int*)&cantblx.uc[m]);
-				printf(" %02X",cantblx.uc[m]);
+				fprintf(stderr, "canfmt: %s: %s\n", optarg, err);
+				return 1;
 			}
-			printf ("\n");
+			fclose(fp);
+			pmap = &map;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-j threads] [-m mapfile] < gateway log\n", argv[0]);
+			return 1;
 		}
 	}
-	return 0;
-}	
 
+	/* A file: map it.  A pipe (or an empty file): read it all. */
+	if ((fstat(0, &sb) == 0) && S_ISREG(sb.st_mode) && (sb.st_size > 0))
+	{
+		n = sb.st_size;
+		pin = (char*)mmap(NULL, n, PROT_READ, MAP_PRIVATE, 0, 0);
+		if (pin != MAP_FAILED)
+		{
+			mapped = 1;
+			madvise(pin, n, MADV_SEQUENTIAL);
+		}
+		else
+		{
+			pin = NULL;
+			n = 0;
+		}
+	}
+	if (mapped == 0)
+	{
+		do
+		{
+			if (n == size)
+			{
+				size = (size == 0) ? (1 << 20) : (size * 2);
+				pin = (char*)realloc(pin, size);
+				if (pin == NULL)
+				{
+					fprintf(stderr, "canfmt: out of memory\n");
+					return 1;
+				}
+			}
+			k = read(0, pin + n, size - n);
+			if (k > 0) n += k;
+		} while (k > 0);
+	}
+
+	if (cfmt_run(pin, n, nthr, pmap, out, NULL) != 0)
+	{
+		fprintf(stderr, "canfmt: out of memory\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,296 @@
+/* *****************************************************************************
+* File Name          : cfmt.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : canfmt conversion: gateway ascii/hex lines to readable lines
+****************************************************************************** */
+/*
+Library for 'canfmt' and 'cfmtbench' (see those for gcc lines).  See cfmt.h
+for what is kept from the 03/16/2020 version.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "cfmt.h"
+#include "cfmtmap.h"
+#include "hexcodec.h"
+
+#define OUTFLUSH (1 << 20) // Output buffer size when writing in order
+
+/* ************************************************************************************************************
+ * void cfmt_init(struct CFMTST* ps);
+ * @brief	: Reset the old version's state (as at program start)
+ * @param	: ps = pointer to state
+ * ************************************************************************************************************ */
+void cfmt_init(struct CFMTST* ps)
+{
+	memset(ps, 0, sizeof(struct CFMTST));
+	return;
+}
+/* ************************************************************************************************************
+ * static int room(struct CFMTOUT* po);
+ * @brief	: Make room for one output line
+ * @return	: 0 = OK; -2 = out of memory
+ * ************************************************************************************************************ */
+static int room(struct CFMTOUT* po)
+{
+	char* p;
+
+	if ((po->size - po->n) >= CFMT_OUTLINE) return 0;
+	if (po->pflush != NULL)
+	{
+		(*po->pflush)(po->p, po->n, po->parg);
+		po->n = 0;
+		if (po->size >= CFMT_OUTLINE) return 0;
+	}
+	p = (char*)realloc(po->p, (po->size * 2) + CFMT_OUTLINE);
+	if (p == NULL) return -2;
+	po->p = p;
+	po->size = (po->size * 2) + CFMT_OUTLINE;
+	return 0;
+}
+/* ************************************************************************************************************
+ * static void put4(uint8_t* p, unsigned v);
+ * @brief	: What sscanf "%2x" into a byte did: an unsigned int stored at the byte
+ * ************************************************************************************************************ */
+static void put4(uint8_t* p, unsigned v)
+{
+	memcpy(p, &v, 4);
+	return;
+}
+/* ************************************************************************************************************
+ * static char* slow(struct CFMTST* ps, char* o);
+ * @brief	: The 03/16/2020 loop body, on the copy of its buffer and struct
+ * @param	: ps->buf = piece, as 'fgets' left it
+ * @return	: output pointer advanced
+ * ************************************************************************************************************ */
+static char* slow(struct CFMTST* ps, char* o)
+{
+	char* buf = ps->buf;
+	unsigned v;
+	int m;
+
+	if (sscanf(buf, "%2x", &v) == 1) put4(&ps->st[0], v);
+
+	// The ascii hex order is little endian.  Convert to an unsigned int
+	ps->id = 0;
+	for (m = 10; m >= 2; m -= 2)
+	{
+		sscanf(&buf[m], "%2x", &ps->ui);
+		ps->id = (ps->id << 8) + ps->ui;
+	}
+	if (sscanf(&buf[10], "%2x", &v) == 1) put4(&ps->st[8], v);
+
+	o += sprintf(o, "%03u %08X %1d ", ps->st[0], ps->id, ps->st[8]);
+
+	// Get payload bytes	converted to binary
+	for (m = 0; m < ps->st[8]; m++)
+	{
+		if (sscanf(&buf[12 + 2 * m], " %2x", &v) == 1) put4(&ps->st[9 + m], v);
+		o += sprintf(o, " %02X", ps->st[9 + m]);
+	}
+	*o++ = '\n';
+	return o;
+}
+/* ************************************************************************************************************
+ * int cfmt_block(struct CFMTST* ps, const struct CFMTMAP* pmap, struct CFMTOUT* po, const char* pin, size_t n);
+ * @brief	: Convert lines
+ * @param	: ps = state, for lines done in order; NULL = block on its own
+ * @param	: pmap = CAN id map for typed columns; NULL = none
+ * @param	: po = output
+ * @param	: pin = chars, starting at a line start
+ * @param	: n = number of chars (ends at a line end, or end of input)
+ * @return	: 0 = OK; -1 = 'ps' NULL and a line needs the previous lines' state;
+ *          : -2 = out of memory
+ * ************************************************************************************************************ */
+int cfmt_block(struct CFMTST* ps, const struct CFMTMAP* pmap, struct CFMTOUT* po, const char* pin, size_t n)
+{
+	const struct CFMTMAPE* pme;
+	const char* pe = pin + n;
+	const char* pnl;
+	const char* pnul;
+	uint8_t b[6 + 8];
+	char* o;
+	size_t len; // Piece length, as 'fgets' read it
+	size_t sl;  // strlen of piece
+	uint8_t dlc;
+	int i;
+
+	while (pin < pe)
+	{
+		/* Next piece: through '\n', or CFMT_LINESZ - 1 chars */
+		len = pe - pin;
+		if (len > (CFMT_LINESZ - 1)) len = CFMT_LINESZ - 1;
+		pnl = memchr(pin, '\n', len);
+		if (pnl != NULL) len = (pnl - pin) + 1;
+		pnul = memchr(pin, 0, len);
+		sl = (pnul == NULL) ? len : (size_t)(pnul - pin);
+
+		if (ps != NULL)
+		{ // Here, keep the old buffer, stale tail and all
+			memcpy(ps->buf, pin, len);
+			ps->buf[len] = 0;
+		}
+		if ((sl <= 12) || (sl >= 32))
+		{ // Here, the old version skipped it
+			pin += len;
+			continue;
+		}
+		if (room(po) != 0) return -2;
+		o = po->p + po->n;
+
+		/* A gateway line: hex wherever a field is read */
+		if ((pnl != NULL) && (pnul == NULL)
+		 && (hexcodec_decode(b, pin, 12) == 6) && ((dlc = b[5]) <= 8)
+		 && ((size_t)(12 + 2 * dlc) < len) && (hexcodec_decode(&b[6], pin + 12, 2 * dlc) == dlc))
+		{
+			*o++ = '0' + (b[0] / 100);
+			*o++ = '0' + ((b[0] / 10) % 10);
+			*o++ = '0' + (b[0] % 10);
+			*o++ = ' ';
+			for (i = 4; i >= 1; i--)
+			{
+				memcpy(o, &hexcodec_enc[b[i]], 2);
+				o += 2;
+			}
+			*o++ = ' ';
+			*o++ = '0' + dlc;
+			*o++ = ' ';
+			for (i = 0; i < dlc; i++)
+			{
+				*o++ = ' ';
+				memcpy(o, &hexcodec_enc[b[6 + i]], 2);
+				o += 2;
+			}
+			if (pmap != NULL)
+			{ // Here, typed columns if the id is in the map
+				pme = cfmtmap_find(pmap, b[1] | (b[2] << 8) | (b[3] << 16) | ((uint32_t)b[4] << 24));
+				if (pme != NULL) o = cfmtmap_fmt(pme, &b[6], dlc, o);
+			}
+			*o++ = '\n';
+
+			if (ps != NULL)
+			{ // Here, what the sscanf's would have left
+				put4(&ps->st[0], b[0]);
+				ps->id = b[1] | (b[2] << 8) | (b[3] << 16) | ((uint32_t)b[4] << 24);
+				ps->ui = b[1];
+				put4(&ps->st[8], dlc);
+				for (i = 0; i < dlc; i++)
+					put4(&ps->st[9 + i], b[6 + i]);
+			}
+		}
+		else
+		{ // Here, something else: needs what the lines before left
+			if (ps == NULL) return -1;
+			o = slow(ps, o);
+		}
+		po->n = o - po->p;
+		pin += len;
+	}
+	return 0;
+}
+/* ************************************************************************************************************
+ * Threads: one block each
+ * ************************************************************************************************************ */
+struct BLOCK
+{
+	pthread_t thr;
+	int throk; // 1 = 'thr' started
+	const struct CFMTMAP* pmap;
+	const char* pin;
+	size_t n;
+	struct CFMTOUT out;
+	int ret;
+};
+static void* blockthread(void* parg)
+{
+	struct BLOCK* pb = (struct BLOCK*)parg;
+	pb->ret = cfmt_block(NULL, pb->pmap, &pb->out, pb->pin, pb->n);
+	return NULL;
+}
+/* ************************************************************************************************************
+ * int cfmt_run(const char* pin, size_t n, int nthr, const struct CFMTMAP* pmap,
+ *	void (*pwrite)(const char* p, size_t n, void* parg), void* parg);
+ * @brief	: Convert all of the input; blocks on 'nthr' threads, output in order
+ * @param	: pin = chars
+ * @param	: n = number of chars
+ * @param	: nthr = number of threads (1 = no threads)
+ * @param	: pmap = CAN id map for typed columns; NULL = none
+ * @param	: pwrite = called with output, in order
+ * @param	: parg = passed to 'pwrite'
+ * @return	: 0 = OK; -2 = out of memory
+ * ************************************************************************************************************ */
+int cfmt_run(const char* pin, size_t n, int nthr, const struct CFMTMAP* pmap,
+	void (*pwrite)(const char* p, size_t n, void* parg), void* parg)
+{
+	struct BLOCK* pb;
+	struct CFMTST* ps;
+	struct CFMTOUT out;
+	const char* p;
+	size_t k;
+	int ret = 0;
+	int i;
+
+	if (n < ((size_t)nthr << 16)) nthr = 1; // Not worth a thread under 64K each
+
+	if (nthr > 1)
+	{
+		pb = (struct BLOCK*)calloc(nthr, sizeof(struct BLOCK));
+		if (pb == NULL) return -2;
+
+		/* Blocks of about n / nthr, each ending after a '\n' */
+		p = pin;
+		for (i = 0; i < nthr; i++)
+		{
+			pb[i].pin = p;
+			pb[i].pmap = pmap;
+			k = (n * (i + 1)) / nthr;
+			if (p < (pin + k)) p = pin + k;
+			while ((p < (pin + n)) && (p[-1] != '\n')) p += 1;
+			pb[i].n = p - pb[i].pin;
+			pb[i].out.size = (pb[i].n * 3) + CFMT_OUTLINE; // Lines at least 13 chars in, 40 out
+			pb[i].out.p = (char*)malloc(pb[i].out.size);
+			if (pb[i].out.p == NULL) ret = -2;
+		}
+		for (i = 0; (i < nthr) && (ret == 0); i++)
+		{
+			pb[i].throk = (pthread_create(&pb[i].thr, NULL, blockthread, &pb[i]) == 0);
+			if (pb[i].throk == 0) blockthread(&pb[i]); // No thread: do it here
+		}
+		for (i = 0; (i < nthr) && (ret == 0); i++)
+			if (pb[i].throk != 0) pthread_join(pb[i].thr, NULL);
+		for (i = 0; (i < nthr) && (ret == 0); i++)
+		{
+			if (pb[i].ret == -2) ret = -2;
+			if (pb[i].ret == -1) ret = -1;
+		}
+		for (i = 0; (i < nthr) && (ret == 0); i++)
+			(*pwrite)(pb[i].out.p, pb[i].out.n, parg);
+		for (i = 0; i < nthr; i++)
+			free(pb[i].out.p);
+		free(pb);
+		if (ret != -1) return ret;
+		/* Here, a line needs the lines before it: do it all in order */
+	}
+
+	ps = (struct CFMTST*)malloc(sizeof(struct CFMTST));
+	out.p = (char*)malloc(OUTFLUSH);
+	if ((ps == NULL) || (out.p == NULL))
+	{
+		free(ps);
+		free(out.p);
+		return -2;
+	}
+	cfmt_init(ps);
+	out.n      = 0;
+	out.size   = OUTFLUSH;
+	out.pflush = pwrite;
+	out.parg   = parg;
+	ret = cfmt_block(ps, pmap, &out, pin, n);
+	if (out.n != 0) (*pwrite)(out.p, out.n, parg);
+	free(ps);
+	free(out.p);
+	return ret;
+}
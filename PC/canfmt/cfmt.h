@@ -0,0 +1,89 @@
+/* *****************************************************************************
+* File Name          : cfmt.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : canfmt conversion: gateway ascii/hex lines to readable lines
+****************************************************************************** */
+/*
+Output is byte for byte what the 03/16/2020 'canfmt' (fgets + sscanf) made.
+
+That version took each 'fgets' piece (a line, or 511 chars of a longer
+one) with 12 < strlen < 32, and sscanf'ed the seq, id, dlc and 'dlc'
+payload bytes at fixed places.  A field sscanf could not read kept
+whatever the previous line left there, and past the end of a short line
+it read the rest of an earlier, longer line still in the buffer.
+
+A line that is hex everywhere those fields are read (every gateway line)
+is done with table lookups and no state.  Any other line in that length
+range goes through the same sscanf calls as before, on a copy of the old
+buffer and struct, which needs every line before it done in order.  So a
+block done on its own ('cfmt_block' with 'ps' NULL) reports when it hits
+one, and 'cfmt_run' then does the whole input in order.
+
+Differences: a dlc over 8 ran the old version off the end of its struct
+(the minicom capture in docs/data ends with "stack smashing detected");
+here the struct copy is big enough for 255.
+
+With a CAN id map (cfmtmap.h), gateway lines whose id is in the map get
+the decoded fields appended, e.g.
+  126 47600000 8  4E 20 00 00 00 FC 3F 19  rpm=0 status=0x3F
+Without a map the output is as above.
+*/
+
+#ifndef __CFMT
+#define __CFMT
+
+#include <stdint.h>
+#include <stddef.h>
+#include "cfmtmap.h"
+
+#define CFMT_LINESZ  512  // Old 'fgets' buffer: 511 chars per piece
+#define CFMT_OUTLINE 1024 // Longest output line (dlc 255, all bytes)
+
+/* What the old sscanf's left behind */
+struct CFMTST
+{
+	char     buf[CFMT_LINESZ * 2];  // 'fgets' buffer; [CFMT_LINESZ..] stays zero
+	uint8_t  st[9 + 255 + 4];       // seq, pad, id, dlc, uc[] as bytes (4 byte writes)
+	uint32_t id;
+	unsigned ui;
+};
+
+/* Output buffer: grows, or is handed to 'pflush' when full */
+struct CFMTOUT
+{
+	char*  p;
+	size_t n;     // Chars in 'p'
+	size_t size;  // Size of 'p'
+	void (*pflush)(const char* p, size_t n, void* parg); // NULL = realloc
+	void*  parg;
+};
+
+/* ************************************************************************************************************ */
+void cfmt_init(struct CFMTST* ps);
+/* @brief	: Reset the old version's state (as at program start)
+ * @param	: ps = pointer to state
+ * ************************************************************************************************************ */
+int cfmt_block(struct CFMTST* ps, const struct CFMTMAP* pmap, struct CFMTOUT* po, const char* pin, size_t n);
+/* @brief	: Convert lines
+ * @param	: ps = state, for lines done in order; NULL = block on its own
+ * @param	: pmap = CAN id map for typed columns; NULL = none
+ * @param	: po = output
+ * @param	: pin = chars, starting at a line start
+ * @param	: n = number of chars (ends at a line end, or end of input)
+ * @return	: 0 = OK; -1 = 'ps' NULL and a line needs the previous lines' state;
+ *          : -2 = out of memory
+ * ************************************************************************************************************ */
+int cfmt_run(const char* pin, size_t n, int nthr, const struct CFMTMAP* pmap,
+	void (*pwrite)(const char* p, size_t n, void* parg), void* parg);
+/* @brief	: Convert all of the input; blocks on 'nthr' threads, output in order
+ * @param	: pin = chars
+ * @param	: n = number of chars
+ * @param	: nthr = number of threads (1 = no threads)
+ * @param	: pmap = CAN id map for typed columns; NULL = none
+ * @param	: pwrite = called with output, in order
+ * @param	: parg = passed to 'pwrite'
+ * @return	: 0 = OK; -2 = out of memory
+ * ************************************************************************************************************ */
+
+#endif
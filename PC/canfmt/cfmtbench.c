@@ -0,0 +1,190 @@
+/* *****************************************************************************
+* File Name          : cfmtbench.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : canfmt: old (fgets + sscanf) vs new, MB/s
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 cfmtbench.c cfmt.c cfmtmap.c ../../Ourwares/hexcodec.c ../../Ourwares/paydesc.c -I../../Ourwares -pthread -lm -o cfmtbench
+./cfmtbench ../../docs/data/log200220-2.txt [threads [mapfile]]
+
+The log is repeated in memory to at least 64 MB.  Both versions write to
+/dev/null; the outputs are also compared byte for byte.  With a map file
+the new version is also timed with typed columns.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include "cfmt.h"
+
+/* The 03/16/2020 canfmt main loop, stdin/stdout made arguments */
+#define LINESZ 512	// Longest CAN msg line length
+static char buf[LINESZ];
+struct CANTBL
+{
+	uint8_t seq;
+	uint32_t id;
+	uint8_t dlc;
+	uint8_t uc[8];
+};
+static void old_canfmt(FILE* fin, FILE* fout)
+{
+	int m;
+	struct CANTBL cantblx;
+	uint32_t ui;
+
+	while ( (fgets (&buf[0],LINESZ,fin)) != NULL)	// Get a line from stdin
+	{
+		if ((strlen(buf) > 12) && (strlen(buf) < 32))
+		{
+			sscanf(buf,"%2x",(unsigned int*)&cantblx.seq);
+
+			// The ascii hex order is little endian.  Convert to an unsigned int
+			cantblx.id = 0;
+			for (m = 10; m >= 2; m-=2)
+			{
+				sscanf(&buf[m],"%2x",&ui);
+				cantblx.id = (cantblx.id << 8) + ui;
+			}
+			sscanf(&buf[10],"%2x",(unsigned int*)&cantblx.dlc);
+
+			fprintf(fout,"%03u %08X %1d ", cantblx.seq,cantblx.id,cantblx.dlc);
+
+			// Get payload bytes	converted to binary
+			for (m = 0; m < cantblx.dlc; m++)
+			{
+				sscanf(&buf[12+2*m]," %2x",(unsigned int*)&cantblx.uc[m]);
+				fprintf(fout," %02X",cantblx.uc[m]);
+			}
+			fprintf (fout,"\n");
+		}
+	}
+	return;
+}
+
+struct SINK
+{
+	FILE* fp;
+};
+static void sink(const char* p, size_t n, void* parg)
+{
+	fwrite(p, 1, n, ((struct SINK*)parg)->fp);
+	return;
+}
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec + ts.tv_nsec * 1E-9);
+}
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	struct SINK s;
+	struct CFMTMAP map;
+	char err[128];
+	FILE* fp;
+	FILE* fin;
+	char* plog;
+	char* pin;
+	char* pold;
+	char* pnew;
+	size_t nlog;
+	size_t nold;
+	size_t nnew;
+	size_t n = 0;
+	int nthr;
+	int i;
+	double t, told;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s logfile [threads [mapfile]]\n", argv[0]);
+		return 1;
+	}
+	nthr = (argc > 2) ? atoi(argv[2]) : sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthr <= 0) nthr = 1;
+
+	fp = fopen(argv[1], "r");
+	if (fp == NULL)
+	{
+		perror(argv[1]);
+		return 1;
+	}
+	fseek(fp, 0, SEEK_END);
+	nlog = ftell(fp);
+	rewind(fp);
+	plog = (char*)malloc(nlog);
+	if ((plog == NULL) || (nlog == 0) || (fread(plog, 1, nlog, fp) != nlog)) return 1;
+	fclose(fp);
+
+	/* Repeat the log up to 64 MB (whole copies) */
+	pin = (char*)malloc((64 << 20) + nlog);
+	if (pin == NULL) return 1;
+	do
+	{
+		memcpy(pin + n, plog, nlog);
+		n += nlog;
+	} while (n < (64 << 20));
+
+	/* Same output? */
+	fin = fmemopen(pin, n, "r");
+	s.fp = open_memstream(&pold, &nold);
+	old_canfmt(fin, s.fp);
+	fclose(fin);
+	fclose(s.fp);
+	for (i = 1; i <= nthr; i += (nthr - 1 > 0) ? (nthr - 1) : 1)
+	{
+		s.fp = open_memstream(&pnew, &nnew);
+		cfmt_run(pin, n, i, NULL, sink, &s);
+		fclose(s.fp);
+		printf("%d thread%s: output %s\n", i, (i == 1) ? "" : "s",
+			((nold == nnew) && (memcmp(pold, pnew, nold) == 0)) ? "same" : "DIFFERENT");
+		free(pnew);
+	}
+	free(pold);
+
+	/* Speed, to /dev/null */
+	s.fp = fopen("/dev/null", "w");
+	fin = fmemopen(pin, n, "r");
+	t = now();
+	old_canfmt(fin, s.fp);
+	told = now() - t;
+	fclose(fin);
+	printf("%s x %zu: %.1f MB\n", argv[1], n / nlog, n / 1E6);
+	printf("old      %7.1f MB/s\n", n / told / 1E6);
+	for (i = 1; i <= nthr; i += (nthr - 1 > 0) ? (nthr - 1) : 1)
+	{
+		t = now();
+		cfmt_run(pin, n, i, NULL, sink, &s);
+		t = now() - t;
+		printf("new -j %d %7.1f MB/s (x%.1f)\n", i, n / t / 1E6, told / t);
+	}
+	if (argc > 3)
+	{ // Here, with typed columns
+		fp = fopen(argv[3], "r");
+		if ((fp == NULL) || (cfmtmap_load(&map, fp, err, sizeof(err)) != 0))
+		{
+			fprintf(stderr, "%s: %s\n", argv[3], (fp == NULL) ? "can't open" : err);
+			return 1;
+		}
+		fclose(fp);
+		for (i = 1; i <= nthr; i += (nthr - 1 > 0) ? (nthr - 1) : 1)
+		{
+			t = now();
+			cfmt_run(pin, n, i, &map, sink, &s);
+			t = now() - t;
+			printf("-m  -j %d %7.1f MB/s (x%.1f)\n", i, n / t / 1E6, told / t);
+		}
+		cfmtmap_free(&map);
+	}
+	fclose(s.fp);
+	return 0;
+}
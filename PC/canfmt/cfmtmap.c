@@ -0,0 +1,379 @@
+/* *****************************************************************************
+* File Name          : cfmtmap.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : canfmt: CAN id -> payload type map, typed and scaled columns
+****************************************************************************** */
+/*
+Map file format is in cfmtmap.h; 'dmoc.map' is the GEVCUr/DMOC set.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "cfmtmap.h"
+
+/* Payload type names: the list in 'Ourtasks/paycnvt.c' (PAYLOAD_TYPE_INSERT.sql) */
+struct PAYNAME
+{
+	const char* name;
+	uint8_t code;
+};
+static const struct PAYNAME payname[] =
+{
+	{"NONE",             0}, {"FF",               1}, {"FF_FF",            2},
+	{"U32",              3}, {"U32_U32",          4}, {"U8_U32",           5},
+	{"S32",              6}, {"S32_S32",          7}, {"U8_S32",           8},
+	{"HF",               9}, {"F34F",            10}, {"xFF",             11},
+	{"xxFF",            12}, {"xxU32",           13}, {"xxS32",           14},
+	{"U8_U8_U32",       15}, {"U8_U8_S32",       16}, {"U8_U8_FF",        17},
+	{"U16",             18}, {"S16",             19}, {"LAT_LON_HT",      20},
+	{"U8_FF",           21}, {"U8_HF",           22}, {"U8",              23},
+	{"UNIXTIME",        24}, {"U8_U8",           25}, {"U8_U8_U8_U32",    26},
+	{"I16_I16",         27}, {"I16_I16_X6",      28}, {"U8_U8_U8",        29},
+	{"I16_X6",          30}, {"I16_I16_I16_I16", 31}, {"I16__I16",        32},
+	{"I16_I16_I16_X7",  33}, {"I16_I16_I16_X6",  33}, {"I16_I16_X_U8_U8", 34},
+	{"I16",             35}, {"U8_VAR",          36}, {"U8_S8_S8_S8_S8",  37},
+	{"LVL2B",          249}, {"LVL2R",          250}, {"UNDEF",          255},
+};
+#define PAYNAMENUM (sizeof(payname) / sizeof(payname[0]))
+
+/* Bytes each format occupies in the payload (same as paydesc.c). */
+static const uint8_t fmtsize[] = {0,1,1,2,2,2,4,4,4,2,3};
+
+static uint32_t hash(const struct CFMTMAP* p, uint32_t id)
+{
+	return ((id * 2654435761u) >> p->hshift);
+}
+/* ************************************************************************************************************
+ * static int paytype(const char* ps);
+ * @brief	: Payload type name or code to code
+ * @return	: code; -1 = not known
+ * ************************************************************************************************************ */
+static int paytype(const char* ps)
+{
+	char* pe;
+	unsigned long k;
+	unsigned i;
+
+	k = strtoul(ps, &pe, 10);
+	if ((*ps != 0) && (*pe == 0))
+	{
+		for (i = 0; i < PAYNAMENUM; i++)
+			if (payname[i].code == k) return k;
+		return -1;
+	}
+	for (i = 0; i < PAYNAMENUM; i++)
+		if (strcmp(ps, payname[i].name) == 0) return payname[i].code;
+	return -1;
+}
+/* ************************************************************************************************************
+ * static int field(struct CFMTFLD* pf, char* ps);
+ * @brief	: Field spec name[:scale[:offset]] (offset/format already set)
+ * @return	: 0 = OK; -1 = bad scale; -2 = bad offset; -3 = name too long
+ * ************************************************************************************************************ */
+static int field(struct CFMTFLD* pf, char* ps)
+{
+	char* pscale = strchr(ps, ':');
+	char* poff = NULL;
+	char* pe;
+	double m;
+	int d;
+
+	if (pscale != NULL)
+	{
+		*pscale++ = 0;
+		poff = strchr(pscale, ':');
+		if (poff != NULL) *poff++ = 0;
+	}
+	if (strlen(ps) >= CFMTMAPNAME) return -3;
+	if (ps != pf->name) strcpy(pf->name, ps); // Not named: already "f<n>"
+
+	pf->offset = 0;
+	if ((poff != NULL) && (*poff != 0))
+	{
+		pf->offset = strtol(poff, &pe, 0);
+		if (*pe != 0) return -2;
+	}
+
+	pf->scale = 1;
+	pf->dec   = 0;
+	pf->mul   = 1;
+	if ((pscale != NULL) && (strcmp(pscale, "x") == 0))
+	{
+		pf->dec = -1;
+		return 0;
+	}
+	if ((pscale != NULL) && (*pscale != 0))
+	{
+		pf->scale = strtod(pscale, &pe);
+		if ((*pe != 0) || (isfinite(pf->scale) == 0)) return -1;
+	}
+	if ((pf->fmt == PAYFMT_FF) || (pf->fmt == PAYFMT_HF) || (pf->fmt == PAYFMT_F34F))
+	{
+		pf->dec = -2;
+		return 0;
+	}
+	/* Fewest decimals that make the scale a whole multiplier */
+	pf->dec = -2;
+	for (d = 0, m = pf->scale; d <= 6; d++, m *= 10)
+	{
+		if (fabs(m - llround(m)) < (1E-9 * fmax(1, fabs(m))))
+		{
+			pf->dec = d;
+			pf->mul = llround(m);
+			break;
+		}
+	}
+	return 0;
+}
+/* ************************************************************************************************************
+ * int cfmtmap_load(struct CFMTMAP* p, FILE* fp, char* perr, int errsz);
+ * @brief	: Read a map file and compile it
+ * @param	: p = pointer to map (filled in)
+ * @param	: fp = map file
+ * @param	: perr = error message, with line number
+ * @param	: errsz = size of 'perr'
+ * @return	: 0 = OK; -1 = error (see 'perr')
+ * ************************************************************************************************************ */
+int cfmtmap_load(struct CFMTMAP* p, FILE* fp, char* perr, int errsz)
+{
+	const struct PAYDESC* pd;
+	struct CFMTMAPE* pe;
+	struct CFMTMAPE* pnew;
+	char line[1024];
+	char* ps;
+	char* psave;
+	char* pend;
+	char* ptype;
+	uint32_t size = 0;
+	uint32_t h;
+	int linect = 0;
+	int code;
+	int ret;
+	int i;
+
+	memset(p, 0, sizeof(struct CFMTMAP));
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		linect += 1;
+		ps = strchr(line, '#');
+		if (ps != NULL) *ps = 0;
+		ps = strtok_r(line, " \t\r\n", &psave);
+		if (ps == NULL) continue; // Blank or comment line
+
+		if (p->n >= 65535)
+		{
+			snprintf(perr, errsz, "line %d: too many ids", linect);
+			goto err;
+		}
+		if (p->n == size)
+		{
+			size = (size == 0) ? 64 : (size * 2);
+			pnew = (struct CFMTMAPE*)realloc(p->pe, size * sizeof(struct CFMTMAPE));
+			if (pnew == NULL)
+			{
+				snprintf(perr, errsz, "out of memory");
+				goto err;
+			}
+			p->pe = pnew;
+		}
+		pe = &p->pe[p->n];
+		memset(pe, 0, sizeof(struct CFMTMAPE));
+
+		pe->id = strtoul(ps, &pend, 16);
+		if ((*pend != 0) || (strlen(ps) > 8))
+		{
+			snprintf(perr, errsz, "line %d: CAN id '%s' not hex", linect, ps);
+			goto err;
+		}
+		ptype = strtok_r(NULL, " \t\r\n", &psave);
+		code = (ptype == NULL) ? -1 : paytype(ptype);
+		if (code < 0)
+		{
+			snprintf(perr, errsz, "line %d: payload type '%s' not in the list", linect, (ptype == NULL) ? "" : ptype);
+			goto err;
+		}
+		pd = paydesc_get(code);
+		if (pd == NULL)
+		{
+			snprintf(perr, errsz, "line %d: payload type '%s' has no field layout", linect, ptype);
+			goto err;
+		}
+		pe->paytype = code;
+
+		/* Fields: layout from paydesc, names and scales from the line */
+		for (i = 0; i < pd->n; i++)
+		{
+			pe->f[pe->n].off = pd->f[i].off;
+			pe->f[pe->n].fmt = pd->f[i].fmt;
+			pe->f[pe->n].end = pd->f[i].off + fmtsize[pd->f[i].fmt];
+			ps = strtok_r(NULL, " \t\r\n", &psave);
+			if (ps == NULL)
+			{
+				snprintf(pe->f[pe->n].name, CFMTMAPNAME, "f%d", i);
+				field(&pe->f[pe->n], pe->f[pe->n].name);
+			}
+			else
+			{
+				ret = field(&pe->f[pe->n], ps);
+				if (ret != 0)
+				{
+					snprintf(perr, errsz, "line %d: field %d: %s", linect, i,
+						(ret == -1) ? "bad scale" : (ret == -2) ? "bad offset" : "name too long");
+					goto err;
+				}
+				if (strcmp(pe->f[pe->n].name, "-") == 0) continue; // Left out
+			}
+			pe->n += 1;
+		}
+		if (strtok_r(NULL, " \t\r\n", &psave) != NULL)
+		{
+			snprintf(perr, errsz, "line %d: more fields than payload type '%s' has", linect, ptype);
+			goto err;
+		}
+		p->n += 1;
+	}
+
+	/* Compile: open addressed table, at least twice the ids */
+	for (i = 4; (1u << i) < (2 * p->n); i++);
+	p->hmask  = (1u << i) - 1;
+	p->hshift = 32 - i;
+	p->phash  = (uint16_t*)calloc(p->hmask + 1, sizeof(uint16_t));
+	if (p->phash == NULL)
+	{
+		snprintf(perr, errsz, "out of memory");
+		goto err;
+	}
+	for (i = 0; i < (int)p->n; i++)
+	{
+		if (cfmtmap_find(p, p->pe[i].id) != NULL)
+		{
+			snprintf(perr, errsz, "CAN id %08X in the map twice", p->pe[i].id);
+			goto err;
+		}
+		h = hash(p, p->pe[i].id);
+		while (p->phash[h] != 0)
+			h = (h + 1) & p->hmask;
+		p->phash[h] = i + 1;
+	}
+	return 0;
+
+err:
+	cfmtmap_free(p);
+	return -1;
+}
+/* ************************************************************************************************************
+ * void cfmtmap_free(struct CFMTMAP* p);
+ * @brief	: Release a loaded map
+ * @param	: p = pointer to map
+ * ************************************************************************************************************ */
+void cfmtmap_free(struct CFMTMAP* p)
+{
+	free(p->pe);
+	free(p->phash);
+	memset(p, 0, sizeof(struct CFMTMAP));
+	return;
+}
+/* ************************************************************************************************************
+ * const struct CFMTMAPE* cfmtmap_find(const struct CFMTMAP* p, uint32_t id);
+ * @brief	: Look up a CAN id
+ * @param	: p = pointer to map
+ * @param	: id = CAN id
+ * @return	: pointer to entry; NULL = not in map
+ * ************************************************************************************************************ */
+const struct CFMTMAPE* cfmtmap_find(const struct CFMTMAP* p, uint32_t id)
+{
+	uint32_t h = hash(p, id);
+	uint16_t k;
+
+	while ((k = p->phash[h]) != 0)
+	{
+		if (p->pe[k - 1].id == id) return &p->pe[k - 1];
+		h = (h + 1) & p->hmask;
+	}
+	return NULL;
+}
+/* ************************************************************************************************************
+ * static char* fixed(char* o, int64_t v, int dec);
+ * @brief	: Integer with 'dec' implied decimals, e.g. (-5, 1) -> "-0.5"
+ * ************************************************************************************************************ */
+static char* fixed(char* o, int64_t v, int dec)
+{
+	char t[24];
+	uint64_t u = (v < 0) ? -(uint64_t)v : (uint64_t)v;
+	int n = 0;
+
+	do
+	{
+		t[n++] = '0' + (u % 10);
+		u /= 10;
+	} while ((u != 0) || (n <= dec));
+
+	if (v < 0) *o++ = '-';
+	while (n > 0)
+	{
+		if (n == dec) *o++ = '.';
+		*o++ = t[--n];
+	}
+	return o;
+}
+/* ************************************************************************************************************
+ * char* cfmtmap_fmt(const struct CFMTMAPE* pe, const uint8_t* ppay, uint8_t dlc, char* o);
+ * @brief	: Typed columns for a payload: "  name=value name=value ..."
+ * @param	: pe = pointer to map entry
+ * @param	: ppay = pointer to payload bytes
+ * @param	: dlc = payload byte count (fields past it are left out)
+ * @param	: o = output (up to PAYDESCMAXFLD * (CFMTMAPNAME + 24) chars)
+ * @return	: output pointer advanced
+ * ************************************************************************************************************ */
+char* cfmtmap_fmt(const struct CFMTMAPE* pe, const uint8_t* ppay, uint8_t dlc, char* o)
+{
+	const struct CFMTFLD* pf;
+	union {uint32_t u; float f;} x;
+	int64_t v;
+	int i;
+	int k;
+
+	*o++ = ' ';
+	for (i = 0; i < pe->n; i++)
+	{
+		pf = &pe->f[i];
+		if (pf->end > dlc) continue;
+
+		*o++ = ' ';
+		k = strlen(pf->name);
+		memcpy(o, pf->name, k);
+		o += k;
+		*o++ = '=';
+
+		if (pf->dec == -1)
+		{ // Here, raw hex (half float as its two bytes)
+			x.u = paydesc_bits(&ppay[pf->off], (pf->fmt == PAYFMT_HF) ? PAYFMT_U16 : pf->fmt);
+			*o++ = '0';
+			*o++ = 'x';
+			for (k = (fmtsize[pf->fmt] * 8) - 4; k >= 0; k -= 4)
+				*o++ = "0123456789ABCDEF"[(x.u >> k) & 0xf];
+			continue;
+		}
+		x.u = paydesc_bits(&ppay[pf->off], pf->fmt);
+		switch (pf->fmt)
+		{
+		case PAYFMT_S8:  v = (int8_t)x.u;  break;
+		case PAYFMT_S16: v = (int16_t)x.u; break;
+		case PAYFMT_S32: v = (int32_t)x.u; break;
+		case PAYFMT_FF:
+		case PAYFMT_HF:
+		case PAYFMT_F34F:
+			o += sprintf(o, "%g", ((double)x.f + pf->offset) * pf->scale);
+			continue;
+		default:         v = x.u;          break; // U8, U16, I16, U32
+		}
+		if (pf->dec == -2)
+			o += sprintf(o, "%g", (double)(v + pf->offset) * pf->scale);
+		else
+			o = fixed(o, (v + pf->offset) * pf->mul, pf->dec);
+	}
+	return o;
+}
@@ -0,0 +1,90 @@
+/* *****************************************************************************
+* File Name          : cfmtmap.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : canfmt: CAN id -> payload type map, typed and scaled columns
+****************************************************************************** */
+/*
+Map file, one CAN id per line ('#' to end of line is a comment)--
+  <CAN id hex> <payload type> [field ...]
+Payload type is the name or code in the 'paycnvt.c' list (e.g. I16_X6, 30);
+the field offsets and formats come from 'paydesc' (Ourwares/paydesc.c), the
+same table the firmware's payload_extract uses.
+
+A field is name[:scale[:offset]], printed as name=(raw + offset) * scale.
+Scale 'x' prints the raw value in hex.  Name '-' leaves the field out.
+Fields not listed print as f0, f1, ... unscaled.  E.g.
+  47600000 I16_X6     rpm:1:-20000  status:x
+
+The map compiles to an open addressed table on the id, and each field to
+an integer multiplier and a number of decimals (scale 0.1 = x1, one
+decimal), so there is no floating point except for float payload fields.
+*/
+
+#ifndef __CFMTMAP
+#define __CFMTMAP
+
+#include <stdio.h>
+#include <stdint.h>
+#include "paydesc.h"
+
+#define CFMTMAPNAME 16 // Field name chars, with '\0'
+
+struct CFMTFLD
+{
+	uint8_t off;             // Payload byte offset
+	uint8_t fmt;             // PAYFMT_...
+	uint8_t end;             // off + bytes: payload dlc needed
+	int8_t  dec;             // Decimals; -1 = hex; -2 = floating point
+	int64_t mul;             // (raw + offset) * mul, 'dec' decimals
+	int32_t offset;          // Added to raw value
+	double  scale;           // For floating point
+	char    name[CFMTMAPNAME];
+};
+
+struct CFMTMAPE
+{
+	uint32_t id;
+	uint8_t  paytype;
+	uint8_t  n;              // Fields printed
+	struct CFMTFLD f[PAYDESCMAXFLD];
+};
+
+struct CFMTMAP
+{
+	struct CFMTMAPE* pe;     // Entries [n]
+	uint32_t n;
+	uint16_t* phash;         // Entry index + 1; 0 = empty
+	uint32_t hmask;          // Table size - 1
+	uint8_t  hshift;         // 32 - log2(table size)
+};
+
+/* ************************************************************************************************************ */
+int cfmtmap_load(struct CFMTMAP* p, FILE* fp, char* perr, int errsz);
+/* @brief	: Read a map file and compile it
+ * @param	: p = pointer to map (filled in)
+ * @param	: fp = map file
+ * @param	: perr = error message, with line number
+ * @param	: errsz = size of 'perr'
+ * @return	: 0 = OK; -1 = error (see 'perr')
+ * ************************************************************************************************************ */
+void cfmtmap_free(struct CFMTMAP* p);
+/* @brief	: Release a loaded map
+ * @param	: p = pointer to map
+ * ************************************************************************************************************ */
+const struct CFMTMAPE* cfmtmap_find(const struct CFMTMAP* p, uint32_t id);
+/* @brief	: Look up a CAN id
+ * @param	: p = pointer to map
+ * @param	: id = CAN id
+ * @return	: pointer to entry; NULL = not in map
+ * ************************************************************************************************************ */
+char* cfmtmap_fmt(const struct CFMTMAPE* pe, const uint8_t* ppay, uint8_t dlc, char* o);
+/* @brief	: Typed columns for a payload: "  name=value name=value ..."
+ * @param	: pe = pointer to map entry
+ * @param	: ppay = pointer to payload bytes
+ * @param	: dlc = payload byte count (fields past it are left out)
+ * @param	: o = output (up to PAYDESCMAXFLD * (CFMTMAPNAME + 24) chars)
+ * @return	: output pointer advanced
+ * ************************************************************************************************************ */
+
+#endif
@@ -0,0 +1,322 @@
+/* *****************************************************************************
+* File Name          : cfmtmaptest.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : canfmt: checks of the CAN id -> payload type map against frames from a sample log
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 cfmtmaptest.c cfmtmap.c ../../Ourwares/hexcodec.c ../../Ourwares/paydesc.c -I../../Ourwares -lm -o cfmtmaptest
+./cfmtmaptest [test...]
+
+Run from PC/canfmt: it reads 'dmoc.map' and '../../docs/data/log200220-2.txt'.
+The frames are gateway lines copied from that log; each is checked to be
+there, then decoded (seq, id, dlc, payload) and put through cfmtmap_fmt.
+Each test runs in its own process.  Prints PASS/FAIL for each; exit code
+is the number that failed.
+
+dmoc (user-046): dmoc.map on DMOC frames, exact output: I16 with offset
+and 0.1 scale (CA000000 volts/amps, 47400000 torq), raw hex (47600000
+status), a negative scale (05683004), U8 with offset (CA200000), and a
+CA200000 frame with its dlc cut to 2, where the field past it is left out.
+
+types (user-046): a map written here on log frames for the types dmoc.map
+does not use: signed (U8_S8_S8_S8_S8, S32_S32), float (FF_FF, with and
+without a scale), '-' to leave a field out, f0.. for fields not named, a
+scale needing floating point (1/3), and a field past the dlc of a real 1
+byte frame (00400000 as U8_U8).
+
+find (user-046): every line of the log: cfmtmap_find gives the entry for
+ids in dmoc.map and NULL for the rest, as a search of the map's own list
+does.  10089 lines, 7859 in the map.
+
+errors (user-046): map lines with a bad id, type, scale, offset, name,
+too many fields, or an id twice are refused, with the line number.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "cfmtmap.h"
+#include "hexcodec.h"
+
+#define MAPFILE "dmoc.map"
+#define LOGFILE "../../docs/data/log200220-2.txt"
+
+static char why[256];
+static int fail(const char* fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	vsnprintf(why, sizeof(why), fmt, ap);
+	va_end(ap);
+	return 1;
+}
+
+/* ======= Helpers ======================================================================================= */
+static char* plog; // Whole log, '\0' at the end
+static int logread(void)
+{
+	FILE* fp = fopen(LOGFILE, "rb");
+	long n;
+
+	if (fp == NULL) return -1;
+	fseek(fp, 0, SEEK_END);
+	n = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	plog = (char*)malloc(n + 2);
+	plog[0] = '\n'; // So every line has a '\n' ahead of it
+	if ((plog == NULL) || (fread(plog + 1, 1, n, fp) != (size_t)n)) return -1;
+	plog[n + 1] = 0;
+	fclose(fp);
+	return 0;
+}
+static int inlog(const char* line)
+{ // 1 = 'line' is a whole line of the log
+	const char* p = plog;
+	int n = strlen(line);
+
+	while ((p = strstr(p, line)) != NULL)
+	{
+		if ((p[-1] == '\n') && ((p[n] == '\n') || (p[n] == '\r') || (p[n] == 0))) return 1;
+		p += 1;
+	}
+	return 0;
+}
+struct FRAME
+{
+	const char* line;  // Gateway line from the log
+	int dlc;           // -1 = as sent; else cut to this
+	const char* want;  // cfmtmap_fmt output
+};
+static int frame(const struct CFMTMAP* pm, const struct FRAME* pf, char* pout)
+{ // Decode the line, format it; -1 = id not in map
+	const struct CFMTMAPE* pe;
+	uint8_t b[32];
+	uint32_t id;
+	int dlc;
+
+	hexcodec_decode(b, pf->line, strlen(pf->line));
+	id  = b[1] | (b[2] << 8) | (b[3] << 16) | ((uint32_t)b[4] << 24);
+	dlc = (pf->dlc < 0) ? b[5] : pf->dlc;
+	pe  = cfmtmap_find(pm, id);
+	if (pe == NULL) return -1;
+	*cfmtmap_fmt(pe, &b[6], dlc, pout) = 0;
+	return 0;
+}
+static int frames(const struct CFMTMAP* pm, const struct FRAME* pf, int n)
+{
+	char out[PAYDESCMAXFLD * (CFMTMAPNAME + 24) + 8];
+	int i;
+
+	for (i = 0; i < n; i++, pf++)
+	{
+		if (inlog(pf->line) == 0) return fail("'%s' is not a line of the log", pf->line);
+		if (frame(pm, pf, out) != 0) return fail("'%s': id not in the map", pf->line);
+		if (strcmp(out, pf->want) != 0) return fail("'%s': got '%s', want '%s'", pf->line, out, pf->want);
+	}
+	return 0;
+}
+static int mapstr(struct CFMTMAP* pm, const char* ps, char* perr)
+{ // Load a map from a string
+	FILE* fp = fmemopen((void*)ps, strlen(ps), "r");
+	int ret;
+
+	if (fp == NULL) return -2;
+	ret = cfmtmap_load(pm, fp, perr, 128);
+	fclose(fp);
+	return ret;
+}
+
+/* ======= dmoc: dmoc.map on DMOC frames ================================================================= */
+static const struct FRAME dmocframe[] =
+{
+	{"85000000CA080C651388006400FCBB", -1, "  volts=317.3 amps=0.0 status=0x00"},
+	{"890000404708753006FE6E31017AD3", -1, "  torq=0.0"},
+	{"7E00006047084E20000000FC3F19E5", -1, "  rpm=0 status=0x3F"},
+	{"8B04306805080000753000000008D5", -1, "  torq=3000.0 torq2=0.0"},
+	{"9E0430680508024272ED00000008E8", -1, "  torq=2942.2 torq2=57.9"},
+	{"7C000020CA08373B37053F00000050", -1, "  rotor=15 inv=19 stator=15"},
+	{"7C000020CA08373B37053F00000050",  2, "  rotor=15 inv=19"},
+	{"870000C047087D1F47D1F47D31694F", -1, "  dvolt=32031 damp=18385 qvolt=62589 qamp=12649"},
+};
+static int t_dmoc(void)
+{
+	struct CFMTMAP m;
+	char err[128];
+	FILE* fp;
+
+	if (logread() != 0) return fail("%s not read (run from PC/canfmt)", LOGFILE);
+	fp = fopen(MAPFILE, "r");
+	if (fp == NULL) return fail("%s not found", MAPFILE);
+	if (cfmtmap_load(&m, fp, err, sizeof(err)) != 0) return fail("%s: %s", MAPFILE, err);
+	fclose(fp);
+	if (m.n != 12) return fail("%s: %u ids", MAPFILE, m.n);
+	return frames(&m, dmocframe, sizeof(dmocframe) / sizeof(dmocframe[0]));
+}
+
+/* ======= types: signed, float, past the dlc ============================================================ */
+static const char typemap[] =
+	"05683004 U8_S8_S8_S8_S8  n:x a b:0.5 c:-1:10 -   # signed bytes\n"
+	"46800000 I16_I16_X_U8_U8                          # no names\n"
+	"47C00000 S32_S32         lo hi:0.001\n"
+	"50400000 FF_FF           t u:1000\n"
+	"00400000 U8_U8           gps sec                   # 1 byte frames\n"
+	"CA000000 I16_I16_X6      v:0.333333333333333333 -  status\n";
+static const struct FRAME typeframe[] =
+{
+	{"9E0430680508024272ED00000008E8", -1, "  n=0x02 a=66 b=57.0 c=9"},
+	{"870000C047087D1F47D1F47D31694F", -1, "  lo=-783868035 hi=1764851.188"},
+	{"800000405008B1919E43FE3D37BD65", -1, "  t=317.138 u=-44.7369"},
+	{"7F000040000113C5",               -1, "  gps=19"},
+	{"85000000CA080C651388006400FCBB", -1, "  v=1057.67 status=0"},
+};
+static int t_types(void)
+{
+	struct CFMTMAP m;
+	char err[128];
+
+	if (logread() != 0) return fail("%s not read (run from PC/canfmt)", LOGFILE);
+	if (mapstr(&m, typemap, err) != 0) return fail("map: %s", err);
+	if (strcmp(cfmtmap_find(&m, 0x46800000)->f[1].name, "f1") != 0) return fail("field not named is not 'f1'");
+	return frames(&m, typeframe, sizeof(typeframe) / sizeof(typeframe[0]));
+}
+
+/* ======= find: every log line against the map's own list =============================================== */
+static int t_find(void)
+{
+	struct CFMTMAP m;
+	const struct CFMTMAPE* pe;
+	char err[128];
+	char* p;
+	char* pn;
+	uint8_t b[128];
+	uint32_t id;
+	uint32_t i;
+	int lines = 0;
+	int hits = 0;
+	int nc;
+	FILE* fp;
+
+	if (logread() != 0) return fail("%s not read (run from PC/canfmt)", LOGFILE);
+	fp = fopen(MAPFILE, "r");
+	if ((fp == NULL) || (cfmtmap_load(&m, fp, err, sizeof(err)) != 0)) return fail("%s", MAPFILE);
+	fclose(fp);
+	for (p = plog + 1; *p != 0; p = pn)
+	{
+		pn = strchr(p, '\n');
+		pn = (pn == NULL) ? p + strlen(p) : pn + 1;
+		nc = strcspn(p, "\r\n");
+		if ((nc < 14) || (nc > 2 * (int)sizeof(b)) || (hexcodec_decode(b, p, nc & ~1) < 0)) continue;
+		id = b[1] | (b[2] << 8) | (b[3] << 16) | ((uint32_t)b[4] << 24);
+		lines += 1;
+		pe = cfmtmap_find(&m, id);
+		for (i = 0; (i < m.n) && (m.pe[i].id != id); i++);
+		if (pe != ((i < m.n) ? &m.pe[i] : NULL)) return fail("line %d: id %08X: %p, want %p", lines, id, pe, (i < m.n) ? &m.pe[i] : NULL);
+		if (pe != NULL) hits += 1;
+	}
+	printf("    find: %d lines, %d in the map\n", lines, hits);
+	if ((lines < 10000) || (hits == 0)) return fail("%d lines, %d hits", lines, hits);
+	return 0;
+}
+
+/* ======= errors: map lines refused ===================================================================== */
+struct BADMAP
+{
+	const char* map;
+	const char* err;  // Start of the message
+};
+static const struct BADMAP badmap[] =
+{
+	{"47400000 I16 torq\n4740000G I16\n",            "line 2: CAN id"},
+	{"# c\n\n123456789 I16\n",                        "line 3: CAN id"},
+	{"47400000 I17\n",                               "line 1: payload type"},
+	{"47400000\n",                                   "line 1: payload type"},
+	{"47400000 I16 torq:0.1x\n",                     "line 1: field 0: bad scale"},
+	{"47400000 I16 torq:0.1:-3e\n",                  "line 1: field 0: bad offset"},
+	{"47400000 I16 abcdefghijklmnop\n",              "line 1: field 0: name too long"},
+	{"47400000 I16 torq rpm\n",                      "line 1: more fields"},
+	{"47400000 I16\n47600000 I16_X6\n47400000 U8\n", "CAN id 47400000 in the map twice"},
+};
+static int t_errors(void)
+{
+	struct CFMTMAP m;
+	char err[128];
+	unsigned i;
+
+	for (i = 0; i < sizeof(badmap) / sizeof(badmap[0]); i++)
+	{
+		err[0] = 0;
+		if (mapstr(&m, badmap[i].map, err) != -1) return fail("map %u loaded", i);
+		if (strncmp(err, badmap[i].err, strlen(badmap[i].err)) != 0) return fail("map %u: '%s'", i, err);
+	}
+	if (mapstr(&m, "47400000 35 torq:0.1:-30000 # code for I16\n", err) != 0) return fail("type code: %s", err);
+	if (cfmtmap_find(&m, 0x47400000)->paytype != 35) return fail("type code");
+	return 0;
+}
+
+struct TEST
+{
+	const char* name;
+	int (*fn)(void);
+};
+static const struct TEST test[] =
+{
+	{"dmoc",   t_dmoc},
+	{"types",  t_types},
+	{"find",   t_find},
+	{"errors", t_errors},
+};
+#define NTEST (int)(sizeof(test) / sizeof(test[0]))
+
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	int nfail = 0;
+	int st;
+	int i, j;
+	int fd[2];
+	pid_t pid;
+	ssize_t n;
+
+	for (i = 0; i < NTEST; i++)
+	{
+		if (argc > 1)
+		{
+			for (j = 1; j < argc; j++)
+				if (strcmp(argv[j], test[i].name) == 0) break;
+			if (j == argc) continue;
+		}
+		if (pipe(fd) != 0) return 1;
+		fflush(stdout);
+		pid = fork();
+		if (pid == 0)
+		{
+			close(fd[0]);
+			why[0] = 0;
+			st = test[i].fn();
+			fflush(stdout);
+			if (write(fd[1], why, strlen(why)) < 0) _exit(1);
+			_exit(st);
+		}
+		close(fd[1]);
+		memset(why, 0, sizeof(why));
+		n = read(fd[0], why, sizeof(why) - 1);
+		close(fd[0]);
+		waitpid(pid, &st, 0);
+		if ((n >= 0) && WIFEXITED(st) && (WEXITSTATUS(st) == 0))
+			printf("PASS %s\n", test[i].name);
+		else
+		{
+			nfail += 1;
+			printf("FAIL %s: %s\n", test[i].name, (why[0] != 0) ? why : "crashed");
+		}
+	}
+	return nfail;
+}
@@ -0,0 +1,597 @@
+/* *****************************************************************************
+* File Name          : canidx.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Seek index for gateway ascii/hex CAN logs: CAN id, time -> blocks
+****************************************************************************** */
+/*
+Library for 'cidx' and 'cidxbench' (see those for gcc lines).
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "canidx.h"
+#include "hexcodec.h"
+
+/* One thread's ids: block numbers for each, ascending */
+struct TID
+{
+	uint32_t  id;
+	uint32_t  n;
+	uint32_t  size;
+	uint32_t* pb;
+};
+struct THR
+{
+	pthread_t   thr;
+	int         throk;   // 1 = 'thr' started
+	const char* plog;
+	size_t      n;
+	uint32_t    blksz;
+	uint32_t    syncid;
+	uint32_t    k0;      // Blocks [k0, k1)
+	uint32_t    k1;
+	struct CIDXBLK* pblk;
+	uint64_t*   poff;
+	struct TID* ptid;    // Ids [nid]
+	uint32_t    nid;
+	uint32_t    nidsz;
+	uint32_t*   phash;   // Id index + 1; 0 = empty
+	uint32_t    hmask;
+	int         ret;
+};
+
+static uint32_t hash(uint32_t id, uint32_t hmask)
+{
+	return ((id * 2654435761u) >> 7) & hmask;
+}
+/* ************************************************************************************************************
+ * static uint64_t blkstart(const char* plog, size_t n, uint32_t blksz, uint32_t k);
+ * @brief	: Block 'k' starts at the first line start at or after k * blksz
+ * ************************************************************************************************************ */
+static uint64_t blkstart(const char* plog, size_t n, uint32_t blksz, uint32_t k)
+{
+	uint64_t s = (uint64_t)k * blksz;
+	const char* pnl;
+
+	if (s == 0) return 0;
+	if (s >= n) return n;
+	pnl = memchr(plog + s - 1, '\n', n - (s - 1));
+	if (pnl == NULL) return n;
+	return (pnl - plog) + 1;
+}
+/* ************************************************************************************************************
+ * static int lineid(const char* pc, size_t len, uint32_t* pid);
+ * @brief	: CAN id of a gateway line
+ * @param	: pc = line; len = chars, without '\n'
+ * @return	: 1 = a gateway line; 0 = not
+ * ************************************************************************************************************ */
+static int lineid(const char* pc, size_t len, uint32_t* pid)
+{
+	uint8_t b[6];
+
+	if ((len < 12) || (hexcodec_decode(b, pc, 12) != 6)) return 0;
+	*pid = b[1] | (b[2] << 8) | (b[3] << 16) | ((uint32_t)b[4] << 24);
+	return 1;
+}
+/* ************************************************************************************************************
+ * static struct TID* tid(struct THR* pt, uint32_t id);
+ * @brief	: Find or add a thread's id
+ * @return	: pointer; NULL = out of memory
+ * ************************************************************************************************************ */
+static struct TID* tid(struct THR* pt, uint32_t id)
+{
+	struct TID* ptid;
+	uint32_t* phash;
+	uint32_t h;
+	uint32_t i;
+
+	for (h = hash(id, pt->hmask); pt->phash[h] != 0; h = (h + 1) & pt->hmask)
+		if (pt->ptid[pt->phash[h] - 1].id == id) return &pt->ptid[pt->phash[h] - 1];
+
+	if (pt->nid == pt->nidsz)
+	{
+		ptid = (struct TID*)realloc(pt->ptid, 2 * pt->nidsz * sizeof(struct TID));
+		if (ptid == NULL) return NULL;
+		pt->ptid = ptid;
+		pt->nidsz *= 2;
+	}
+	if ((2 * (pt->nid + 1)) > pt->hmask)
+	{ // Here, rehash twice as big
+		phash = (uint32_t*)calloc(2 * (pt->hmask + 1), sizeof(uint32_t));
+		if (phash == NULL) return NULL;
+		free(pt->phash);
+		pt->phash = phash;
+		pt->hmask = (2 * (pt->hmask + 1)) - 1;
+		for (i = 0; i < pt->nid; i++)
+		{
+			for (h = hash(pt->ptid[i].id, pt->hmask); phash[h] != 0; h = (h + 1) & pt->hmask);
+			phash[h] = i + 1;
+		}
+		for (h = hash(id, pt->hmask); phash[h] != 0; h = (h + 1) & pt->hmask);
+	}
+	pt->phash[h] = pt->nid + 1;
+	ptid = &pt->ptid[pt->nid++];
+	memset(ptid, 0, sizeof(struct TID));
+	ptid->id = id;
+	return ptid;
+}
+/* ************************************************************************************************************
+ * static void* blockthread(void* parg);
+ * @brief	: Index blocks [k0, k1): length, time sync count, ids
+ * ************************************************************************************************************ */
+static void* blockthread(void* parg)
+{
+	struct THR* pt = (struct THR*)parg;
+	struct TID* ptid;
+	const char* pc;
+	const char* pe;
+	const char* pnl;
+	uint32_t* pb;
+	uint64_t s;
+	uint32_t nsync;
+	uint32_t id;
+	uint32_t k;
+
+	pt->nidsz = 64;
+	pt->hmask = 127;
+	pt->ptid  = (struct TID*)malloc(pt->nidsz * sizeof(struct TID));
+	pt->phash = (uint32_t*)calloc(pt->hmask + 1, sizeof(uint32_t));
+	if ((pt->ptid == NULL) || (pt->phash == NULL)) goto nomem;
+
+	s = blkstart(pt->plog, pt->n, pt->blksz, pt->k0);
+	for (k = pt->k0; k < pt->k1; k++)
+	{
+		pt->poff[k] = s;
+		pc = pt->plog + s;
+		s  = blkstart(pt->plog, pt->n, pt->blksz, k + 1);
+		pe = pt->plog + s;
+		if ((s - pt->poff[k]) > UINT32_MAX)
+		{
+			pt->ret = -2;
+			return NULL;
+		}
+		pt->pblk[k].len = s - pt->poff[k];
+
+		nsync = 0;
+		while (pc < pe)
+		{
+			pnl = memchr(pc, '\n', pe - pc);
+			if (pnl == NULL) pnl = pe;
+			if (lineid(pc, pnl - pc, &id) != 0)
+			{
+				if (id == pt->syncid) nsync += 1;
+				ptid = tid(pt, id);
+				if (ptid == NULL) goto nomem;
+				if ((ptid->n == 0) || (ptid->pb[ptid->n - 1] != k))
+				{
+					if (ptid->n == ptid->size)
+					{
+						ptid->size = (ptid->size == 0) ? 64 : (ptid->size * 2);
+						pb = (uint32_t*)realloc(ptid->pb, ptid->size * sizeof(uint32_t));
+						if (pb == NULL) goto nomem;
+						ptid->pb = pb;
+					}
+					ptid->pb[ptid->n++] = k;
+				}
+			}
+			pc = pnl + 1;
+		}
+		pt->pblk[k].tstart = nsync; // Made cumulative after
+	}
+	pt->ret = 0;
+	return NULL;
+
+nomem:
+	pt->ret = -1;
+	return NULL;
+}
+static int cmpu32(const void* pa, const void* pb)
+{
+	uint32_t a = *(const uint32_t*)pa;
+	uint32_t b = *(const uint32_t*)pb;
+	return (a > b) - (a < b);
+}
+/* ************************************************************************************************************
+ * static uint8_t* putvar(uint8_t* p, uint32_t v);
+ * @brief	: 7 bits per byte, low first, 0x80 = more
+ * ************************************************************************************************************ */
+static uint8_t* putvar(uint8_t* p, uint32_t v)
+{
+	while (v >= 0x80)
+	{
+		*p++ = v | 0x80;
+		v >>= 7;
+	}
+	*p++ = v;
+	return p;
+}
+/* ************************************************************************************************************
+ * int canidx_build(struct CANIDX* p, const char* plog, size_t n, uint32_t blksz, uint32_t syncid, int nthr);
+ * @brief	: Index a log in memory (e.g. mapped); blocks done in order on 'nthr' threads
+ * @param	: p = pointer to index (filled in; 'logsize' = n, 'logmtime' = 0)
+ * @param	: plog = log chars
+ * @param	: n = number of chars
+ * @param	: blksz = block size (bytes)
+ * @param	: syncid = CAN id counted for time
+ * @param	: nthr = number of threads
+ * @return	: 0 = OK; -1 = out of memory; -2 = too many blocks or ticks
+ * ************************************************************************************************************ */
+int canidx_build(struct CANIDX* p, const char* plog, size_t n, uint32_t blksz, uint32_t syncid, int nthr)
+{
+	struct THR* pt;
+	struct TID* ptid;
+	uint32_t* pids = NULL;
+	uint8_t* pp;
+	uint64_t nblk = (n + blksz - 1) / blksz;
+	uint64_t tick;
+	uint64_t npost;
+	uint32_t nid;
+	uint32_t last;
+	uint32_t ns;
+	uint32_t i, j, k;
+	int t;
+	int ret = 0;
+
+	memset(p, 0, sizeof(struct CANIDX));
+	if (nblk >= UINT32_MAX) return -2;
+	if ((uint64_t)nthr > nblk) nthr = (nblk == 0) ? 1 : nblk;
+	if (nthr < 1) nthr = 1;
+
+	memcpy(p->hdr.magic, CIDX_MAGIC, 4);
+	p->hdr.blksz   = blksz;
+	p->hdr.logsize = n;
+	p->hdr.syncid  = syncid;
+	p->hdr.nblk    = nblk;
+	p->pblk = (struct CIDXBLK*)calloc(nblk + 1, sizeof(struct CIDXBLK));
+	p->poff = (uint64_t*)calloc(nblk + 1, sizeof(uint64_t));
+	pt = (struct THR*)calloc(nthr, sizeof(struct THR));
+	if ((p->pblk == NULL) || (p->poff == NULL) || (pt == NULL))
+	{
+		free(pt);
+		canidx_free(p);
+		return -1;
+	}
+
+	for (t = 0; t < nthr; t++)
+	{
+		pt[t].plog   = plog;
+		pt[t].n      = n;
+		pt[t].blksz  = blksz;
+		pt[t].syncid = syncid;
+		pt[t].k0     = (nblk * t) / nthr;
+		pt[t].k1     = (nblk * (t + 1)) / nthr;
+		pt[t].pblk   = p->pblk;
+		pt[t].poff   = p->poff;
+		pt[t].throk  = (nthr > 1) && (pthread_create(&pt[t].thr, NULL, blockthread, &pt[t]) == 0);
+		if (pt[t].throk == 0) blockthread(&pt[t]); // No thread: do it here
+	}
+	for (t = 0; t < nthr; t++)
+	{
+		if (pt[t].throk != 0) pthread_join(pt[t].thr, NULL);
+		if (pt[t].ret != 0) ret = pt[t].ret;
+	}
+	p->poff[nblk] = n;
+
+	/* Time sync counts per block -> ticks before each block */
+	for (k = 0, tick = 0; (k < nblk) && (ret == 0); k++)
+	{
+		ns = p->pblk[k].tstart;
+		p->pblk[k].tstart = tick;
+		tick += ns;
+		if (tick > UINT32_MAX) ret = -2;
+	}
+	p->hdr.ntick = tick;
+
+	/* Ids from all threads, ascending */
+	for (t = 0, nid = 0; t < nthr; t++)
+		nid += pt[t].nid;
+	if (ret == 0)
+	{
+		pids = (uint32_t*)malloc((nid + 1) * sizeof(uint32_t));
+		if (pids == NULL) ret = -1;
+	}
+	if (ret == 0)
+	{
+		for (t = 0, nid = 0; t < nthr; t++)
+			for (i = 0; i < pt[t].nid; i++)
+				pids[nid++] = pt[t].ptid[i].id;
+		qsort(pids, nid, sizeof(uint32_t), cmpu32);
+		for (i = 0, j = 0; i < nid; i++)
+			if ((j == 0) || (pids[j - 1] != pids[i])) pids[j++] = pids[i];
+		nid = j;
+
+		/* Postings: each id, threads in block order (5 bytes per block at most) */
+		for (t = 0, npost = 0; t < nthr; t++)
+			for (i = 0; i < pt[t].nid; i++)
+				npost += 5 * (uint64_t)pt[t].ptid[i].n;
+		p->pid   = (struct CIDXFID*)calloc(nid + 1, sizeof(struct CIDXFID));
+		p->ppost = (uint8_t*)malloc(npost + 1);
+		if ((p->pid == NULL) || (p->ppost == NULL)) ret = -1;
+	}
+	if (ret == 0)
+	{
+		pp = p->ppost;
+		for (i = 0; i < nid; i++)
+		{
+			p->pid[i].id   = pids[i];
+			p->pid[i].post = pp - p->ppost;
+			last = 0;
+			for (t = 0; t < nthr; t++)
+			{
+				for (j = 0; j < pt[t].nid; j++)
+				{
+					ptid = &pt[t].ptid[j];
+					if (ptid->id != pids[i]) continue;
+					for (k = 0; k < ptid->n; k++)
+					{
+						pp = putvar(pp, ptid->pb[k] - last);
+						last = ptid->pb[k];
+					}
+					p->pid[i].nblk += ptid->n;
+					break;
+				}
+			}
+		}
+		p->hdr.nid   = nid;
+		p->hdr.npost = pp - p->ppost;
+	}
+
+	for (t = 0; t < nthr; t++)
+	{
+		for (i = 0; i < pt[t].nid; i++)
+			free(pt[t].ptid[i].pb);
+		free(pt[t].ptid);
+		free(pt[t].phash);
+	}
+	free(pt);
+	free(pids);
+	if (ret != 0) canidx_free(p);
+	return ret;
+}
+/* ************************************************************************************************************
+ * int canidx_write(const struct CANIDX* p, FILE* fp);
+ * @brief	: Write index side file
+ * @return	: 0 = OK; -1 = write error
+ * ************************************************************************************************************ */
+int canidx_write(const struct CANIDX* p, FILE* fp)
+{
+	if (fwrite(&p->hdr, sizeof(struct CIDXHDR), 1, fp) != 1) return -1;
+	if (fwrite(p->pblk, sizeof(struct CIDXBLK), p->hdr.nblk, fp) != p->hdr.nblk) return -1;
+	if (fwrite(p->pid, sizeof(struct CIDXFID), p->hdr.nid, fp) != p->hdr.nid) return -1;
+	if (fwrite(p->ppost, 1, p->hdr.npost, fp) != p->hdr.npost) return -1;
+	if (fflush(fp) != 0) return -1;
+	return 0;
+}
+/* ************************************************************************************************************
+ * int canidx_read(struct CANIDX* p, FILE* fp);
+ * @brief	: Read index side file
+ * @return	: 0 = OK; -1 = read error; -2 = not an index file; -3 = out of memory
+ * ************************************************************************************************************ */
+int canidx_read(struct CANIDX* p, FILE* fp)
+{
+	uint32_t k;
+	int ret = 0;
+
+	memset(p, 0, sizeof(struct CANIDX));
+	if (fread(&p->hdr, sizeof(struct CIDXHDR), 1, fp) != 1) return -1;
+	if ((memcmp(p->hdr.magic, CIDX_MAGIC, 4) != 0) || (p->hdr.nblk == UINT32_MAX)) return -2;
+
+	p->pblk  = (struct CIDXBLK*)malloc((p->hdr.nblk + 1) * sizeof(struct CIDXBLK));
+	p->poff  = (uint64_t*)malloc((p->hdr.nblk + 1) * sizeof(uint64_t));
+	p->pid   = (struct CIDXFID*)malloc((p->hdr.nid + 1) * sizeof(struct CIDXFID));
+	p->ppost = (uint8_t*)malloc(p->hdr.npost + 1);
+	if ((p->pblk == NULL) || (p->poff == NULL) || (p->pid == NULL) || (p->ppost == NULL))
+		ret = -3;
+	else if ((fread(p->pblk, sizeof(struct CIDXBLK), p->hdr.nblk, fp) != p->hdr.nblk)
+	      || (fread(p->pid, sizeof(struct CIDXFID), p->hdr.nid, fp) != p->hdr.nid)
+	      || (fread(p->ppost, 1, p->hdr.npost, fp) != p->hdr.npost))
+		ret = -1;
+	if (ret != 0)
+	{
+		canidx_free(p);
+		return ret;
+	}
+	p->poff[0] = 0;
+	for (k = 0; k < p->hdr.nblk; k++)
+		p->poff[k + 1] = p->poff[k] + p->pblk[k].len;
+	if (p->poff[p->hdr.nblk] != p->hdr.logsize)
+	{
+		canidx_free(p);
+		return -2;
+	}
+	return 0;
+}
+/* ************************************************************************************************************
+ * void canidx_free(struct CANIDX* p);
+ * @brief	: Release index
+ * ************************************************************************************************************ */
+void canidx_free(struct CANIDX* p)
+{
+	free(p->pblk);
+	free(p->poff);
+	free(p->pid);
+	free(p->ppost);
+	memset(p, 0, sizeof(struct CANIDX));
+	return;
+}
+/* ************************************************************************************************************
+ * uint32_t canidx_blocks(const struct CANIDX* p, const struct CIDXQ* pq, uint32_t* pb);
+ * @brief	: Blocks a query needs (id in block and time overlaps)
+ * @param	: p = pointer to index
+ * @param	: pq = pointer to query
+ * @param	: pb = block numbers, ascending (room for hdr.nblk)
+ * @return	: number of blocks
+ * ************************************************************************************************************ */
+uint32_t canidx_blocks(const struct CANIDX* p, const struct CIDXQ* pq, uint32_t* pb)
+{
+	const struct CIDXFID* pf;
+	const uint8_t* pp;
+	uint32_t* pmap;
+	uint32_t tend;
+	uint32_t nb = 0;
+	uint32_t k, v, m;
+	int lo, hi, mid;
+	int i;
+	int sh;
+
+	pmap = (pq->nid == 0) ? NULL : (uint32_t*)calloc((p->hdr.nblk + 31) / 32, sizeof(uint32_t));
+	if (pmap == NULL)
+	{ // Here, all blocks (no ids given, or no memory for the bit map)
+		for (k = 0; k < p->hdr.nblk; k++)
+			pb[nb++] = k;
+	}
+	else
+	{ // Here, mark the blocks of each id in a bit map
+		for (i = 0; i < pq->nid; i++)
+		{
+			lo = 0;
+			hi = p->hdr.nid - 1;
+			pf = NULL;
+			while (lo <= hi)
+			{
+				mid = (lo + hi) / 2;
+				if (p->pid[mid].id == pq->pid[i]) { pf = &p->pid[mid]; break; }
+				if (p->pid[mid].id < pq->pid[i]) lo = mid + 1; else hi = mid - 1;
+			}
+			if (pf == NULL) continue; // Not in the log
+
+			pp = p->ppost + pf->post;
+			for (k = 0, m = 0; m < pf->nblk; m++)
+			{
+				v = 0;
+				sh = 0;
+				do
+				{
+					v |= (uint32_t)(*pp & 0x7f) << sh;
+					sh += 7;
+				} while ((*pp++ & 0x80) != 0);
+				k += v;
+				pmap[k / 32] |= 1u << (k % 32);
+			}
+		}
+		/* Bit map -> block numbers */
+		m = (p->hdr.nblk + 31) / 32;
+		for (k = 0; k < m; k++)
+		{
+			v = pmap[k];
+			while (v != 0)
+			{
+				pb[nb++] = (k * 32) + __builtin_ctz(v);
+				v &= v - 1;
+			}
+		}
+		free(pmap);
+	}
+
+	/* Time: keep blocks that overlap [t0, t1] */
+	for (k = 0, m = 0; k < nb; k++)
+	{
+		tend = ((pb[k] + 1) < p->hdr.nblk) ? p->pblk[pb[k] + 1].tstart : p->hdr.ntick;
+		if ((tend >= pq->t0) && (p->pblk[pb[k]].tstart <= pq->t1))
+			pb[m++] = pb[k];
+	}
+	return m;
+}
+/* ************************************************************************************************************
+ * int canidx_scan(const char* plog, size_t n, uint32_t tstart, uint32_t syncid, const struct CIDXQ* pq,
+ *	void (*pline)(const char* pc, size_t len, uint32_t tick, void* parg), void* parg);
+ * @brief	: Lines a query wants, from part of a log (a block, or all of it)
+ * @param	: plog = chars, starting at a line start
+ * @param	: n = number of chars
+ * @param	: tstart = ticks before 'plog'
+ * @param	: syncid = CAN id counted for time
+ * @param	: pq = pointer to query
+ * @param	: pline = called with each line wanted ('\n' included if there is one)
+ * @param	: parg = passed to 'pline'
+ * @return	: 1 = passed t1 (nothing more to find after); 0 = not
+ * ************************************************************************************************************ */
+int canidx_scan(const char* plog, size_t n, uint32_t tstart, uint32_t syncid, const struct CIDXQ* pq,
+	void (*pline)(const char* pc, size_t len, uint32_t tick, void* parg), void* parg)
+{
+	const char* pe = plog + n;
+	const char* pnl;
+	size_t len;
+	uint32_t tick = tstart;
+	uint32_t id;
+	int i;
+
+	while (plog < pe)
+	{
+		pnl = memchr(plog, '\n', pe - plog);
+		len = (pnl == NULL) ? (size_t)(pe - plog) : (size_t)(pnl - plog) + 1; // Last line may have no '\n'
+		if (lineid(plog, (pnl == NULL) ? len : (len - 1), &id) != 0)
+		{
+			if (id == syncid)
+			{
+				tick += 1;
+				if (tick > pq->t1) return 1;
+			}
+			if (tick >= pq->t0)
+			{
+				for (i = 0; (i < pq->nid) && (pq->pid[i] != id); i++);
+				if ((pq->nid == 0) || (i < pq->nid))
+					(*pline)(plog, len, tick, parg);
+			}
+		}
+		plog += len;
+	}
+	return 0;
+}
+/* ************************************************************************************************************
+ * int canidx_query(const struct CANIDX* p, const char* plog, const struct CIDXQ* pq,
+ *	void (*pline)(const char* pc, size_t len, uint32_t tick, void* parg), void* parg, uint64_t* pnread);
+ * @brief	: Lines a query wants, scanning only the blocks it needs
+ * @param	: p = pointer to index
+ * @param	: plog = log, mapped (blocks ahead are asked for with MADV_WILLNEED)
+ * @param	: pq = pointer to query
+ * @param	: pline = called with each line wanted, in log order
+ * @param	: parg = passed to 'pline'
+ * @param	: pnread = bytes of log scanned (NULL = not wanted)
+ * @return	: blocks scanned; -1 = out of memory
+ * ************************************************************************************************************ */
+int canidx_query(const struct CANIDX* p, const char* plog, const struct CIDXQ* pq,
+	void (*pline)(const char* pc, size_t len, uint32_t tick, void* parg), void* parg, uint64_t* pnread)
+{
+	uint32_t* pb;
+	uint32_t nb;
+	uint32_t k;
+	uint32_t ka = 0; // Blocks asked for, [0, ka)
+	uint64_t nread = 0;
+	uintptr_t s, e;
+	long pgsz = sysconf(_SC_PAGESIZE);
+
+	pb = (uint32_t*)malloc((p->hdr.nblk + 1) * sizeof(uint32_t));
+	if (pb == NULL) return -1;
+	nb = canidx_blocks(p, pq, pb);
+
+	/* Most of the log: read ahead as for a scan.  Otherwise, random access
+	   (no read around), but keep CIDX_AHEAD of wanted blocks coming in. */
+	if (p->hdr.logsize > 0)
+		madvise((void*)plog, p->hdr.logsize, ((2 * nb) > p->hdr.nblk) ? MADV_SEQUENTIAL : MADV_RANDOM);
+	if ((2 * nb) > p->hdr.nblk) ka = nb;
+	for (k = 0; k < nb; k++)
+	{
+		while ((ka < nb) && (p->poff[pb[ka]] < (p->poff[pb[k]] + CIDX_AHEAD)))
+		{
+			s = ((uintptr_t)plog + p->poff[pb[ka]]) & ~(uintptr_t)(pgsz - 1);
+			e = (uintptr_t)plog + p->poff[pb[ka]] + p->pblk[pb[ka]].len;
+			if (e > s) madvise((void*)s, e - s, MADV_WILLNEED);
+			ka += 1;
+		}
+		nread += p->pblk[pb[k]].len;
+		if (canidx_scan(plog + p->poff[pb[k]], p->pblk[pb[k]].len, p->pblk[pb[k]].tstart,
+			p->hdr.syncid, pq, pline, parg) != 0)
+		{
+			k += 1;
+			break;
+		}
+	}
+	free(pb);
+	if (pnread != NULL) *pnread = nread;
+	return k;
+}
@@ -0,0 +1,140 @@
+/* *****************************************************************************
+* File Name          : canidx.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Seek index for gateway ascii/hex CAN logs: CAN id, time -> blocks
+****************************************************************************** */
+/*
+The log is cut into blocks of about CIDX_BLKSZ bytes: block k starts at
+the first line start at or after k * blksz, so the blocks do not depend on
+how many threads built the index.  For each block the index keeps its
+length and the time at its start; for each CAN id, the blocks it is in.
+
+Time: the gateway lines have no time stamp.  The GPS time sync msg
+(CANID_HB_TIMESYNC, 00400000) goes out every 1/64 sec, so "time" is the
+count of time sync msgs from the start of the log, in ticks.  A line's
+tick is the count up to and including it.  Block k holds ticks
+blk[k].tstart through blk[k+1].tstart (the last block, through 'ntick').
+
+A line is indexed if its first 12 chars are hex (seq, id, dlc); anything
+else (minicom text, noise) is skipped by the index and by the scans.
+
+Side file, host byte order--
+  struct CIDXHDR
+  struct CIDXBLK [nblk]
+  struct CIDXFID [nid]  (ascending id)
+  postings: per id, its block numbers as deltas, 7 bits per byte, low
+            first, 0x80 = more
+*/
+
+#ifndef __CANIDX
+#define __CANIDX
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define CIDX_MAGIC   "CIX1"
+#define CIDX_BLKSZ   (32 << 10)  // Default block size (bytes)
+#define CIDX_SYNCID  0x00400000  // CANID_HB_TIMESYNC: 64 per sec
+#define CIDX_TICKHZ  64          // Time sync msgs per sec
+#define CIDX_AHEAD   (4 << 20)   // Query: bytes of blocks asked for ahead of the scan
+
+struct CIDXHDR
+{
+	char     magic[4];  // CIDX_MAGIC
+	uint32_t blksz;     // Block size used
+	uint64_t logsize;   // Log file size...
+	int64_t  logmtime;  // ...and modify time, when indexed
+	uint32_t syncid;    // Id counted for time
+	uint32_t nblk;      // Number of blocks
+	uint32_t nid;       // Number of CAN ids
+	uint32_t ntick;     // Time sync msgs in the log
+	uint64_t npost;     // Bytes of postings
+};
+
+struct CIDXBLK
+{
+	uint32_t len;       // Bytes (offset is the sum of the ones before)
+	uint32_t tstart;    // Ticks before the block
+};
+
+struct CIDXFID
+{
+	uint32_t id;
+	uint32_t nblk;      // Blocks with this id
+	uint64_t post;      // Offset of its postings
+};
+
+struct CANIDX
+{
+	struct CIDXHDR  hdr;
+	struct CIDXBLK* pblk;  // [nblk]
+	uint64_t*       poff;  // [nblk + 1] block offsets (not in the file)
+	struct CIDXFID* pid;   // [nid]
+	uint8_t*        ppost; // [npost]
+};
+
+/* Which lines a query wants */
+struct CIDXQ
+{
+	const uint32_t* pid;   // CAN ids...
+	int      nid;          // ...how many (0 = all ids)
+	uint32_t t0;           // Ticks, inclusive
+	uint32_t t1;
+};
+
+/* ************************************************************************************************************ */
+int canidx_build(struct CANIDX* p, const char* plog, size_t n, uint32_t blksz, uint32_t syncid, int nthr);
+/* @brief	: Index a log in memory (e.g. mapped); blocks done in order on 'nthr' threads
+ * @param	: p = pointer to index (filled in; 'logsize' = n, 'logmtime' = 0)
+ * @param	: plog = log chars
+ * @param	: n = number of chars
+ * @param	: blksz = block size (bytes)
+ * @param	: syncid = CAN id counted for time
+ * @param	: nthr = number of threads
+ * @return	: 0 = OK; -1 = out of memory; -2 = too many blocks or ticks
+ * ************************************************************************************************************ */
+int canidx_write(const struct CANIDX* p, FILE* fp);
+/* @brief	: Write index side file
+ * @return	: 0 = OK; -1 = write error
+ * ************************************************************************************************************ */
+int canidx_read(struct CANIDX* p, FILE* fp);
+/* @brief	: Read index side file
+ * @return	: 0 = OK; -1 = read error; -2 = not an index file; -3 = out of memory
+ * ************************************************************************************************************ */
+void canidx_free(struct CANIDX* p);
+/* @brief	: Release index
+ * ************************************************************************************************************ */
+uint32_t canidx_blocks(const struct CANIDX* p, const struct CIDXQ* pq, uint32_t* pb);
+/* @brief	: Blocks a query needs (id in block and time overlaps)
+ * @param	: p = pointer to index
+ * @param	: pq = pointer to query
+ * @param	: pb = block numbers, ascending (room for hdr.nblk)
+ * @return	: number of blocks
+ * ************************************************************************************************************ */
+int canidx_scan(const char* plog, size_t n, uint32_t tstart, uint32_t syncid, const struct CIDXQ* pq,
+	void (*pline)(const char* pc, size_t len, uint32_t tick, void* parg), void* parg);
+/* @brief	: Lines a query wants, from part of a log (a block, or all of it)
+ * @param	: plog = chars, starting at a line start
+ * @param	: n = number of chars
+ * @param	: tstart = ticks before 'plog'
+ * @param	: syncid = CAN id counted for time
+ * @param	: pq = pointer to query
+ * @param	: pline = called with each line wanted ('\n' included if there is one)
+ * @param	: parg = passed to 'pline'
+ * @return	: 1 = passed t1 (nothing more to find after); 0 = not
+ * ************************************************************************************************************ */
+int canidx_query(const struct CANIDX* p, const char* plog, const struct CIDXQ* pq,
+	void (*pline)(const char* pc, size_t len, uint32_t tick, void* parg), void* parg, uint64_t* pnread);
+/* @brief	: Lines a query wants, scanning only the blocks it needs
+ * @param	: p = pointer to index
+ * @param	: plog = log, mapped (blocks ahead are asked for with MADV_WILLNEED)
+ * @param	: pq = pointer to query
+ * @param	: pline = called with each line wanted, in log order
+ * @param	: parg = passed to 'pline'
+ * @param	: pnread = bytes of log scanned (NULL = not wanted)
+ * @return	: blocks scanned; -1 = out of memory
+ * ************************************************************************************************************ */
+
+#endif
@@ -0,0 +1,181 @@
+/* *****************************************************************************
+* File Name          : cidx.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Build/query a CAN id + time seek index for a gateway log
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 cidx.c canidx.c ../../Ourwares/hexcodec.c -I../../Ourwares -pthread -o cidx
+
+Build (writes bigday.txt.cidx; -j 0 = one thread per core):
+./cidx -j 0 bigday.txt
+
+Query: lines for the ids (hex, comma separated), seconds t0:t1 from the
+start of the log (either may be left off), in gateway format--
+./cidx -q 47600000,CA000000 -t 600:660 bigday.txt | ../canfmt/canfmt -m ../canfmt/dmoc.map
+
+-v: blocks and bytes read to stderr.  The index is rebuilt if the log
+size or modify time no longer match it.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "canidx.h"
+
+#define MAXIDS 64
+
+static void out(const char* pc, size_t len, uint32_t tick, void* parg)
+{
+	fwrite(pc, 1, len, stdout);
+	return;
+}
+static uint32_t secs(const char* ps, uint32_t dflt)
+{
+	if (*ps == 0) return dflt;
+	return strtod(ps, NULL) * CIDX_TICKHZ;
+}
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	struct CANIDX idx;
+	struct CIDXQ q;
+	struct stat sb;
+	uint32_t ids[MAXIDS];
+	uint32_t blksz  = CIDX_BLKSZ;
+	uint32_t syncid = CIDX_SYNCID;
+	uint64_t nread = 0;
+	char* pids = NULL;
+	char* ptime = NULL;
+	char* pidx;
+	char* plog;
+	char* ps;
+	FILE* fp;
+	int nthr = 1;
+	int verbose = 0;
+	int fd;
+	int c;
+	int ret;
+
+	while ((c = getopt(argc, argv, "j:B:s:q:t:v")) != -1)
+	{
+		switch (c)
+		{
+		case 'j': // Threads for the build; 0 = one per core
+			nthr = atoi(optarg);
+			if (nthr <= 0) nthr = sysconf(_SC_NPROCESSORS_ONLN);
+			if (nthr <= 0) nthr = 1;
+			break;
+		case 'B': // Block size, KB
+			blksz = atoi(optarg) << 10;
+			if (blksz == 0) blksz = CIDX_BLKSZ;
+			break;
+		case 's': // Time sync CAN id
+			syncid = strtoul(optarg, NULL, 16);
+			break;
+		case 'q': pids  = optarg; break;
+		case 't': ptime = optarg; break;
+		case 'v': verbose = 1;    break;
+		default:
+			goto usage;
+		}
+	}
+	if (optind != (argc - 1)) goto usage;
+
+	/* Map the log */
+	fd = open(argv[optind], O_RDONLY);
+	if ((fd < 0) || (fstat(fd, &sb) != 0))
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+	plog = NULL;
+	if (sb.st_size > 0)
+	{
+		plog = (char*)mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (plog == MAP_FAILED)
+		{
+			perror("cidx: mmap");
+			return 1;
+		}
+	}
+	pidx = (char*)malloc(strlen(argv[optind]) + 6);
+	if (pidx == NULL) return 1;
+	sprintf(pidx, "%s.cidx", argv[optind]);
+
+	/* Index up to date? */
+	ret = -1;
+	fp = fopen(pidx, "r");
+	if (fp != NULL)
+	{
+		ret = canidx_read(&idx, fp);
+		fclose(fp);
+		if ((ret == 0) && ((idx.hdr.logsize != (uint64_t)sb.st_size) || (idx.hdr.logmtime != sb.st_mtime)
+		 || ((pids == NULL) && ((idx.hdr.blksz != blksz) || (idx.hdr.syncid != syncid)))))
+		{
+			canidx_free(&idx);
+			ret = -1;
+		}
+	}
+	if (ret != 0)
+	{ // Here, build it
+		if (plog != NULL) madvise(plog, sb.st_size, MADV_SEQUENTIAL);
+		ret = canidx_build(&idx, plog, sb.st_size, blksz, syncid, nthr);
+		if (ret != 0)
+		{
+			fprintf(stderr, "cidx: %s\n", (ret == -1) ? "out of memory" : "log too big for the block size");
+			return 1;
+		}
+		idx.hdr.logmtime = sb.st_mtime;
+		fp = fopen(pidx, "w");
+		if ((fp == NULL) || (canidx_write(&idx, fp) != 0) || (fclose(fp) != 0))
+		{
+			perror(pidx);
+			return 1;
+		}
+		if (verbose != 0)
+			fprintf(stderr, "%s: %u blocks, %u ids, %u ticks (%.1f sec)\n", pidx,
+				idx.hdr.nblk, idx.hdr.nid, idx.hdr.ntick, (double)idx.hdr.ntick / CIDX_TICKHZ);
+	}
+	if (pids == NULL) return 0;
+
+	/* Query */
+	memset(&q, 0, sizeof(q));
+	q.pid = ids;
+	q.t0  = 0;
+	q.t1  = UINT32_MAX;
+	for (ps = strtok(pids, ","); (ps != NULL) && (strcmp(ps, "all") != 0); ps = strtok(NULL, ","))
+	{
+		if (q.nid >= MAXIDS) goto usage;
+		ids[q.nid++] = strtoul(ps, NULL, 16);
+	}
+	if (ptime != NULL)
+	{
+		ps = strchr(ptime, ':');
+		if (ps != NULL) *ps++ = 0;
+		q.t0 = secs(ptime, 0);
+		if (ps != NULL) q.t1 = secs(ps, UINT32_MAX);
+	}
+	ret = canidx_query(&idx, plog, &q, out, NULL, &nread);
+	fflush(stdout);
+	if (ret < 0)
+	{
+		fprintf(stderr, "cidx: out of memory\n");
+		return 1;
+	}
+	if (verbose != 0)
+		fprintf(stderr, "blocks %d of %u, %.1f of %.1f MB\n", ret, idx.hdr.nblk, nread / 1E6, sb.st_size / 1E6);
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-j threads] [-B blockKB] [-s syncid] [-q id,id...|all [-t t0:t1]] [-v] logfile\n", argv[0]);
+	return 1;
+}
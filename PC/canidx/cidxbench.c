@@ -0,0 +1,190 @@
+/* *****************************************************************************
+* File Name          : cidxbench.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : canidx: index query vs full scan on a big synthetic log
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 cidxbench.c canidx.c ../../Ourwares/hexcodec.c -I../../Ourwares -pthread -o cidxbench
+./cidxbench ../../docs/data/log200220-2.txt /tmp/big.txt [MB [threads]]
+
+Makes 'big.txt' (default 1024 MB) from copies of the sample log, if it is
+not already there at that size.  Then times the index build, and some
+queries with the index against a scan of the whole log, with the log in
+the page cache ("warm") and dropped from it ("cold", posix_fadvise; a
+file system that ignores that shows warm times for both).  The lines found
+are checked the same both ways.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "canidx.h"
+
+struct SUM
+{
+	uint64_t n;   // Lines
+	uint64_t h;   // Sum of line hashes
+};
+static void sum(const char* pc, size_t len, uint32_t tick, void* parg)
+{
+	struct SUM* ps = (struct SUM*)parg;
+	uint64_t h = 14695981039346656037ull;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ (uint8_t)pc[i]) * 1099511628211ull;
+	ps->n += 1;
+	ps->h += h ^ tick;
+	return;
+}
+/* Drop the log from the page cache (mapped pages stay, so map it again) */
+static char* drop(int fd, char* plog, size_t n)
+{
+	munmap(plog, n);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	plog = (char*)mmap(NULL, n, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (plog == MAP_FAILED) exit(1);
+	return plog;
+}
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec + ts.tv_nsec * 1E-9);
+}
+
+struct QUERY
+{
+	const char* name;
+	uint32_t id[2];
+	int      nid;
+	double   t0;  // Fraction of the log's time
+	double   secs;
+};
+static const struct QUERY query[] =
+{
+	{"DMOC speed, all",          {0x47600000},             1, 0.0, 0},
+	{"E1800000 (rare), all",     {0xE1800000},             1, 0.0, 0},
+	{"DMOC speed + HV, 60 s",    {0x47600000, 0xCA000000}, 2, 0.5, 60},
+	{"DMOC temps, 10 min",       {0xCA200000},             1, 0.8, 600},
+	{"all ids, 5 s",             {0},                      0, 0.3, 5},
+};
+#define NQUERY (sizeof(query) / sizeof(query[0]))
+
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	struct CANIDX idx;
+	struct CIDXQ q;
+	struct SUM sidx;
+	struct SUM sscan;
+	struct stat sb;
+	uint64_t nread;
+	size_t nmb = 1024;
+	size_t n;
+	char* psmp;
+	char* plog;
+	FILE* fp;
+	int nthr = 1;
+	int fd;
+	int cold;
+	unsigned i;
+	double t, tidx, tscan;
+
+	if (argc < 3)
+	{
+		fprintf(stderr, "usage: %s samplelog biglog [MB [threads]]\n", argv[0]);
+		return 1;
+	}
+	if (argc > 3) nmb = atoi(argv[3]);
+	nthr = (argc > 4) ? atoi(argv[4]) : sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthr <= 0) nthr = 1;
+
+	/* Big log from copies of the sample */
+	if ((stat(argv[2], &sb) != 0) || ((size_t)sb.st_size < (nmb << 20)))
+	{
+		fp = fopen(argv[1], "r");
+		if (fp == NULL)
+		{
+			perror(argv[1]);
+			return 1;
+		}
+		fseek(fp, 0, SEEK_END);
+		n = ftell(fp);
+		rewind(fp);
+		psmp = (char*)malloc(n);
+		if ((psmp == NULL) || (n == 0) || (fread(psmp, 1, n, fp) != n)) return 1;
+		fclose(fp);
+		fp = fopen(argv[2], "w");
+		if (fp == NULL)
+		{
+			perror(argv[2]);
+			return 1;
+		}
+		for (i = 0; (size_t)i * n < (nmb << 20); i++)
+			if (fwrite(psmp, 1, n, fp) != n) return 1;
+		fclose(fp);
+		free(psmp);
+	}
+	fd = open(argv[2], O_RDONLY);
+	if ((fd < 0) || (fstat(fd, &sb) != 0)) return 1;
+	n = sb.st_size;
+	plog = (char*)mmap(NULL, n, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (plog == MAP_FAILED) return 1;
+
+	/* Build */
+	for (i = 1; i <= (unsigned)nthr; i += (nthr - 1 > 0) ? (nthr - 1) : 1)
+	{
+		t = now();
+		if (canidx_build(&idx, plog, n, CIDX_BLKSZ, CIDX_SYNCID, i) != 0) return 1;
+		t = now() - t;
+		printf("build -j %u: %.2f s, %.0f MB/s\n", i, t, n / t / 1E6);
+		if (i != (unsigned)nthr) canidx_free(&idx);
+	}
+	printf("%s: %.1f MB, %.1f sec of ticks; index %u blocks, %u ids, %.0f KB\n", argv[2], n / 1E6,
+		(double)idx.hdr.ntick / CIDX_TICKHZ, idx.hdr.nblk, idx.hdr.nid,
+		(sizeof(struct CIDXHDR) + idx.hdr.nblk * sizeof(struct CIDXBLK)
+		 + idx.hdr.nid * sizeof(struct CIDXFID) + idx.hdr.npost) / 1E3);
+
+	printf("%-24s %5s %10s %9s %9s %9s %8s\n", "query", "cache", "lines", "MB read", "scan s", "index s", "x");
+	for (i = 0; i < NQUERY; i++)
+	{
+		q.pid = query[i].id;
+		q.nid = query[i].nid;
+		q.t0  = query[i].t0 * idx.hdr.ntick;
+		q.t1  = (query[i].secs == 0) ? UINT32_MAX : (q.t0 + (query[i].secs * CIDX_TICKHZ));
+		for (cold = 1; cold >= 0; cold--)
+		{
+			/* Whole log scan (stops past t1, as a scan could) */
+			memset(&sscan, 0, sizeof(sscan));
+			if (cold) plog = drop(fd, plog, n);
+			madvise(plog, n, MADV_SEQUENTIAL);
+			t = now();
+			canidx_scan(plog, n, 0, idx.hdr.syncid, &q, sum, &sscan);
+			tscan = now() - t;
+
+			/* With the index */
+			memset(&sidx, 0, sizeof(sidx));
+			if (cold) plog = drop(fd, plog, n);
+			t = now();
+			if (canidx_query(&idx, plog, &q, sum, &sidx, &nread) < 0) return 1;
+			tidx = now() - t;
+
+			printf("%-24s %5s %10lu %9.1f %9.4f %9.4f %8.1f%s\n", query[i].name, cold ? "cold" : "warm",
+				(unsigned long)sidx.n, nread / 1E6, tscan, tidx, tscan / tidx,
+				((sidx.n == sscan.n) && (sidx.h == sscan.h)) ? "" : "  DIFFERENT");
+		}
+	}
+	canidx_free(&idx);
+	return 0;
+}
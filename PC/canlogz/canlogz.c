@@ -0,0 +1,365 @@
+/* *****************************************************************************
+* File Name          : canlogz.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Compressed CAN log: streaming encode/decode of gateway lines
+****************************************************************************** */
+/*
+Library for 'clz' and 'clzbench' (see those for gcc lines).  Record format
+is in canlogz.h.
+*/
+
+#include <string.h>
+#include "canlogz.h"
+#include "hexcodec.h"
+
+/* ************************************************************************************************************
+ * void clz_init(struct CLZ* p);
+ * @brief	: Reset encoder or decoder (one struct for each direction)
+ * @param	: p = pointer to struct
+ * ************************************************************************************************************ */
+void clz_init(struct CLZ* p)
+{
+	memset(p, 0, sizeof(struct CLZ));
+	return;
+}
+/* ************************************************************************************************************
+ * int clz_enc_magic(uint8_t* pout);
+ * @brief	: Start of stream
+ * @param	: pout = output [CLZ_MAGICSZ]
+ * @return	: number of bytes
+ * ************************************************************************************************************ */
+int clz_enc_magic(uint8_t* pout)
+{
+	memcpy(pout, CLZ_MAGIC, CLZ_MAGICSZ);
+	return CLZ_MAGICSZ;
+}
+/* ************************************************************************************************************
+ * static struct CLZID* lookup(struct CLZ* p, uint32_t id, int* pk);
+ * @brief	: Encoder: find id, or add it if there is room
+ * @param	: pk = dictionary index; -1 = new id (just added, or no room)
+ * @return	: pointer to previous msg for id
+ * ************************************************************************************************************ */
+static struct CLZID* lookup(struct CLZ* p, uint32_t id, int* pk)
+{
+	uint32_t h = (id * 2654435761u) >> 22; // 10 bits: CLZ_HASHSZ
+	struct CLZID* pd;
+
+	while (p->hash[h] != 0)
+	{
+		pd = &p->dict[p->hash[h] - 1];
+		if (pd->id == id)
+		{
+			*pk = p->hash[h] - 1;
+			return pd;
+		}
+		h = (h + 1) & (CLZ_HASHSZ - 1);
+	}
+	*pk = -1;
+	p->newids += 1;
+	if (p->nid >= CLZ_DICTMAX)
+	{ // Here, full: code against "no previous"
+		memset(&p->lit, 0, sizeof(struct CLZID));
+		return &p->lit;
+	}
+	pd = &p->dict[p->nid];
+	memset(pd, 0, sizeof(struct CLZID));
+	pd->id = id;
+	p->nid += 1;
+	p->hash[h] = p->nid;
+	return pd;
+}
+/* ************************************************************************************************************
+ * int clz_enc_msg(struct CLZ* p, uint8_t* pout, const struct GBINMSG* pm);
+ * @brief	: Encode a msg
+ * @param	: p = pointer to encoder
+ * @param	: pout = output [CLZ_MSGMAX]
+ * @param	: pm = pointer to msg (dlc 0 - 8)
+ * @return	: number of bytes
+ * ************************************************************************************************************ */
+int clz_enc_msg(struct CLZ* p, uint8_t* pout, const struct GBINMSG* pm)
+{
+	uint8_t* po = pout + 1;
+	uint8_t* pmask;
+	struct CLZID* pd;
+	uint8_t tag;
+	uint8_t x;
+	int k;
+	int i;
+
+	pd = lookup(p, pm->id, &k);
+
+	/* Id */
+	if (k < 0)
+	{
+		tag = CLZ_TNEWID;
+		*po++ = pm->id;
+		*po++ = pm->id >> 8;
+		*po++ = pm->id >> 16;
+		*po++ = pm->id >> 24;
+	}
+	else if (k < CLZ_TDICT)
+	{
+		tag = k;
+	}
+	else
+	{
+		tag = CLZ_TDICT;
+		*po++ = k;
+	}
+
+	/* Sequence number delta */
+	if (pm->seq != p->seqnext)
+	{
+		tag |= CLZ_TSEQ;
+		*po++ = pm->seq - p->seqnext;
+	}
+	p->seqnext = pm->seq + 1;
+
+	/* Dlc */
+	if (pm->dlc != pd->dlc)
+	{
+		tag |= CLZ_TDLC;
+		*po++ = pm->dlc;
+		pd->dlc = pm->dlc;
+	}
+
+	/* Payload: bytes that changed */
+	if ((k >= 0) && (memcmp(pm->uc, pd->uc, pm->dlc) == 0))
+	{
+		tag |= CLZ_TSAME;
+	}
+	else
+	{
+		pmask = po++;
+		*pmask = 0;
+		for (i = 0; i < pm->dlc; i++)
+		{
+			x = pm->uc[i] ^ pd->uc[i];
+			if (x != 0)
+			{
+				*pmask |= (1 << i);
+				*po++ = x;
+			}
+		}
+		memcpy(pd->uc, pm->uc, pm->dlc);
+	}
+	p->msgs += 1;
+	*pout = tag;
+	return (po - pout);
+}
+/* ************************************************************************************************************
+ * static int enc_text(struct CLZ* p, uint8_t* pout, const char* pc, int n, int nl);
+ * @brief	: Encoder: line as text record(s)
+ * ************************************************************************************************************ */
+static int enc_text(struct CLZ* p, uint8_t* pout, const char* pc, int n, int nl)
+{
+	uint8_t* po = pout;
+	int ct;
+
+	do
+	{
+		ct = (n > CLZ_TEXTMAX) ? CLZ_TEXTMAX : n;
+		n -= ct;
+		*po++ = ((n == 0) && (nl != 0)) ? CLZ_TEXTNL : CLZ_TEXT;
+		*po++ = ct;
+		memcpy(po, pc, ct);
+		po += ct;
+		pc += ct;
+		p->texts += 1;
+	} while (n > 0);
+	return (po - pout);
+}
+/* ************************************************************************************************************
+ * int clz_enc_line(struct CLZ* p, uint8_t* pout, const char* pline, int n, int nl);
+ * @brief	: Encode a log line: a msg if it is a good gateway line, else text
+ * @param	: p = pointer to encoder
+ * @param	: pout = output [CLZ_OUTMAX(n)]
+ * @param	: pline = chars, without the '\n'
+ * @param	: n = number of chars
+ * @param	: nl = 1 = the line ended with '\n'; 0 = end of file without one
+ * @return	: number of bytes
+ * ************************************************************************************************************ */
+int clz_enc_line(struct CLZ* p, uint8_t* pout, const char* pline, int n, int nl)
+{
+	uint8_t b[GBIN_RAWMAX];
+	char asc[GBIN_ASCMAX];
+	struct GBINMSG m;
+	int nb;
+
+	/* Only a line the decoder will make again exactly is a msg */
+	if ((nl == 0) || (n < 14) || (n > (GBIN_RAWMAX * 2)))
+		return enc_text(p, pout, pline, n, nl);
+	nb = hexcodec_decode(b, pline, n);
+	if ((nb < 7) || (b[5] > 8) || (nb != (7 + b[5])))
+		return enc_text(p, pout, pline, n, nl);
+
+	m.seq = b[0];
+	m.id  = b[1] | (b[2] << 8) | (b[3] << 16) | ((uint32_t)b[4] << 24);
+	m.dlc = b[5];
+	memset(m.uc, 0, 8);
+	memcpy(m.uc, &b[6], m.dlc);
+	if ((gbin_fmtline(asc, &m) != (n + 1)) || (memcmp(asc, pline, n) != 0))
+		return enc_text(p, pout, pline, n, nl); // Checksum, or lower case
+
+	return clz_enc_msg(p, pout, &m);
+}
+/* ************************************************************************************************************
+ * static int reclen(struct CLZ* p);
+ * @brief	: Decoder: length of the record in 'rec', as far as known from 'nrec' bytes
+ * @return	: bytes needed (more than 'nrec' = keep going); -1 = bad record
+ * ************************************************************************************************************ */
+static int reclen(struct CLZ* p)
+{
+	uint8_t tag = p->rec[0];
+	uint8_t k   = tag & 0x1F;
+	int n = 1;
+
+	if ((tag == CLZ_TEXTNL) || (tag == CLZ_TEXT))
+	{
+		if (p->nrec < 2) return 2;
+		return (2 + p->rec[1]);
+	}
+	if (k == CLZ_TNEWID)
+	{
+		if ((tag & CLZ_TSAME) != 0) return -1;
+		n += 4;
+	}
+	else if (k == CLZ_TDICT)
+	{
+		n += 1;
+	}
+	if ((tag & CLZ_TSEQ) != 0) n += 1;
+	if ((tag & CLZ_TDLC) != 0) n += 1;
+	if ((tag & CLZ_TSAME) != 0) return n;
+
+	/* Mask, and a byte for each bit set */
+	n += 1;
+	if (p->nrec < n) return n;
+	return (n + __builtin_popcount(p->rec[n - 1]));
+}
+/* ************************************************************************************************************
+ * static int dec_msg(struct CLZ* p, struct GBINMSG* pm);
+ * @brief	: Decoder: msg record in 'rec' (complete)
+ * @return	: 0 = OK; -1 = bad record
+ * ************************************************************************************************************ */
+static int dec_msg(struct CLZ* p, struct GBINMSG* pm)
+{
+	uint8_t* pr = &p->rec[1];
+	uint8_t tag = p->rec[0];
+	uint8_t k   = tag & 0x1F;
+	struct CLZID* pd;
+	uint8_t mask;
+	uint32_t id;
+	int i;
+
+	if (k == CLZ_TNEWID)
+	{
+		id = pr[0] | (pr[1] << 8) | (pr[2] << 16) | ((uint32_t)pr[3] << 24);
+		pr += 4;
+		p->newids += 1;
+		if (p->nid < CLZ_DICTMAX)
+		{
+			pd = &p->dict[p->nid];
+			p->nid += 1;
+		}
+		else
+		{
+			pd = &p->lit;
+		}
+		memset(pd, 0, sizeof(struct CLZID));
+		pd->id = id;
+	}
+	else
+	{
+		if (k == CLZ_TDICT)
+			k = *pr++;
+		if (k >= p->nid) return -1;
+		pd = &p->dict[k];
+	}
+
+	pm->seq = p->seqnext;
+	if ((tag & CLZ_TSEQ) != 0)
+		pm->seq += *pr++;
+	p->seqnext = pm->seq + 1;
+
+	if ((tag & CLZ_TDLC) != 0)
+	{
+		if (*pr > 8) return -1;
+		pd->dlc = *pr++;
+	}
+
+	if ((tag & CLZ_TSAME) == 0)
+	{
+		mask = *pr++;
+		if ((mask >> pd->dlc) != 0) return -1;
+		for (i = 0; i < pd->dlc; i++)
+		{
+			if ((mask & (1 << i)) != 0)
+				pd->uc[i] ^= *pr++;
+		}
+	}
+	pm->id  = pd->id;
+	pm->dlc = pd->dlc;
+	memset(pm->uc, 0, 8);
+	memcpy(pm->uc, pd->uc, pd->dlc);
+	p->msgs += 1;
+	return 0;
+}
+/* ************************************************************************************************************
+ * int clz_dec(struct CLZ* p, const uint8_t* pin, int n, void (*pfunc)(const char* pc, int ct, const struct GBINMSG* pm, void* parg), void* parg);
+ * @brief	: Decode bytes of a stream (any size pieces)
+ * @param	: p = pointer to decoder
+ * @param	: pin = pointer to bytes
+ * @param	: n = number of bytes
+ * @param	: pfunc = called for each record: chars to output, and the msg (NULL for text)
+ * @param	: parg = passed to 'pfunc'
+ * @return	: number of records; -1 = bad stream ('p->err' set)
+ * ************************************************************************************************************ */
+int clz_dec(struct CLZ* p, const uint8_t* pin, int n, void (*pfunc)(const char* pc, int ct, const struct GBINMSG* pm, void* parg), void* parg)
+{
+	char asc[CLZ_RECMAX];
+	struct GBINMSG m;
+	int ct = 0;
+	int len;
+	int i;
+
+	if (p->err != 0) return -1;
+
+	for (i = 0; i < n; i++)
+	{
+		if (p->magic < CLZ_MAGICSZ)
+		{ // Here, start of stream
+			if (pin[i] != CLZ_MAGIC[p->magic]) goto bad;
+			p->magic += 1;
+			continue;
+		}
+		p->rec[p->nrec++] = pin[i];
+		len = reclen(p);
+		if (len < 0) goto bad;
+		if (p->nrec < len) continue;
+		p->nrec = 0;
+
+		if ((p->rec[0] == CLZ_TEXTNL) || (p->rec[0] == CLZ_TEXT))
+		{
+			len = p->rec[1];
+			memcpy(asc, &p->rec[2], len);
+			if (p->rec[0] == CLZ_TEXTNL)
+				asc[len++] = '\n';
+			p->texts += 1;
+			(*pfunc)(asc, len, NULL, parg);
+		}
+		else
+		{
+			if (dec_msg(p, &m) != 0) goto bad;
+			len = gbin_fmtline(asc, &m);
+			(*pfunc)(asc, len, &m, parg);
+		}
+		ct += 1;
+	}
+	return ct;
+
+bad:
+	p->err = 1;
+	return -1;
+}
@@ -0,0 +1,120 @@
+/* *****************************************************************************
+* File Name          : canlogz.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Compressed CAN log: streaming encode/decode of gateway lines
+****************************************************************************** */
+/*
+The msg fields are the ones 'CANcompress_G' (Ourwares/PC_gateway_comm.c)
+packs: seq, id, dlc, payload.  The checksum is not stored; the decoder
+makes it again with 'gbin_fmtline', so a decoded log is byte for byte the
+ascii/hex lines that went in.  A line that 'gbin_fmtline' would not make
+exactly (bad checksum, lower case, noise) is kept as text.
+
+The gateway lines have no time stamp; the sequence number is the running
+count, so that is what gets delta coded.
+
+Stream: CLZ_MAGIC, then records.  Record tag byte T--
+  T & 0x1F = k: 0 - 29  dictionary index k
+                30      dictionary index in the next byte
+                31      new id: 4 bytes (low byte first); added to the
+                        dictionary at the next index, if there is room
+  T & 0x20: seq delta byte follows (seq - (previous seq + 1)); else 0
+  T & 0x40: dlc byte follows; else the previous dlc for this id
+  T & 0x80: payload the same as the previous for this id; else a mask
+            byte (bit i = payload byte i changed) and, for each bit set,
+            that byte xor the previous byte
+  A new id starts with dlc 0 and all zero payload as "previous".
+
+  A new id never has 0x80, which leaves two text records--
+  CLZ_TEXTNL: length byte, chars; then '\n'
+  CLZ_TEXT:   length byte, chars (line continues, or file ends with no '\n')
+*/
+
+#ifndef __CANLOGZ
+#define __CANLOGZ
+
+#include <stdint.h>
+#include "gatewaybin.h"
+
+#define CLZ_MAGIC     "CLZ1"
+#define CLZ_MAGICSZ   4
+
+#define CLZ_TDICT     30   // Tag: index in next byte
+#define CLZ_TNEWID    31   // Tag: new id follows
+#define CLZ_TSEQ      0x20 // Tag: seq delta byte follows
+#define CLZ_TDLC      0x40 // Tag: dlc byte follows
+#define CLZ_TSAME     0x80 // Tag: payload unchanged (no mask)
+#define CLZ_TEXTNL    0xFF // Tag: text line with '\n'
+#define CLZ_TEXT      0xDF // Tag: text without '\n'
+
+#define CLZ_DICTMAX   256  // Ids in the dictionary
+#define CLZ_HASHSZ    1024 // Encoder id lookup (power of 2, > 2 * CLZ_DICTMAX)
+#define CLZ_TEXTMAX   255  // Chars in one text record
+#define CLZ_MSGMAX    (1 + 4 + 1 + 1 + 1 + 8)       // Longest msg record
+#define CLZ_RECMAX    (2 + CLZ_TEXTMAX)              // Longest record
+#define CLZ_OUTMAX(n) ((n) + 2 * ((n) / CLZ_TEXTMAX + 1) + CLZ_MSGMAX) // 'clz_enc_line' output for n chars
+
+/* Previous msg for an id */
+struct CLZID
+{
+	uint32_t id;
+	uint8_t  dlc;
+	uint8_t  uc[8];
+};
+
+struct CLZ
+{
+	struct CLZID dict[CLZ_DICTMAX];
+	struct CLZID lit;          // "Previous" for an id not in the dictionary (dlc 0, zeros)
+	uint16_t hash[CLZ_HASHSZ]; // Encoder: dictionary index + 1; 0 = empty
+	uint16_t nid;              // Ids in the dictionary
+	uint8_t  seqnext;          // Previous seq + 1
+	/* Decoder */
+	uint8_t  rec[CLZ_RECMAX];  // Record being built
+	uint16_t nrec;             // Bytes in 'rec'
+	uint8_t  magic;            // Magic bytes checked so far
+	uint8_t  err;              // 1 = bad stream; the rest is ignored
+	/* Counts */
+	uint32_t msgs;             // Msg records
+	uint32_t texts;            // Text records
+	uint32_t newids;           // New id records
+};
+
+/* ************************************************************************************************************ */
+void clz_init(struct CLZ* p);
+/* @brief	: Reset encoder or decoder (one struct for each direction)
+ * @param	: p = pointer to struct
+ * ************************************************************************************************************ */
+int clz_enc_magic(uint8_t* pout);
+/* @brief	: Start of stream
+ * @param	: pout = output [CLZ_MAGICSZ]
+ * @return	: number of bytes
+ * ************************************************************************************************************ */
+int clz_enc_msg(struct CLZ* p, uint8_t* pout, const struct GBINMSG* pm);
+/* @brief	: Encode a msg
+ * @param	: p = pointer to encoder
+ * @param	: pout = output [CLZ_MSGMAX]
+ * @param	: pm = pointer to msg (dlc 0 - 8)
+ * @return	: number of bytes
+ * ************************************************************************************************************ */
+int clz_enc_line(struct CLZ* p, uint8_t* pout, const char* pline, int n, int nl);
+/* @brief	: Encode a log line: a msg if it is a good gateway line, else text
+ * @param	: p = pointer to encoder
+ * @param	: pout = output [CLZ_OUTMAX(n)]
+ * @param	: pline = chars, without the '\n'
+ * @param	: n = number of chars
+ * @param	: nl = 1 = the line ended with '\n'; 0 = end of file without one
+ * @return	: number of bytes
+ * ************************************************************************************************************ */
+int clz_dec(struct CLZ* p, const uint8_t* pin, int n, void (*pfunc)(const char* pc, int ct, const struct GBINMSG* pm, void* parg), void* parg);
+/* @brief	: Decode bytes of a stream (any size pieces)
+ * @param	: p = pointer to decoder
+ * @param	: pin = pointer to bytes
+ * @param	: n = number of bytes
+ * @param	: pfunc = called for each record: chars to output, and the msg (NULL for text)
+ * @param	: parg = passed to 'pfunc'
+ * @return	: number of records; -1 = bad stream ('p->err' set)
+ * ************************************************************************************************************ */
+
+#endif
@@ -0,0 +1,106 @@
+/* *****************************************************************************
+* File Name          : clz.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Compress/uncompress a gateway ascii/hex CAN log
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 clz.c canlogz.c ../gatewaybin/gatewaybin.c ../../Ourwares/hexcodec.c -I../gatewaybin -I../../Ourwares -o clz
+./clz < ../../docs/data/log200220-2.txt > log.clz
+./clz -d < log.clz | ../canfmt/canfmt
+
+Counts go to stderr at EOF.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdint.h>
+#include "canlogz.h"
+
+static void out(const char* pc, int ct, const struct GBINMSG* pm, void* parg)
+{
+	fwrite(pc, 1, ct, stdout);
+	return;
+}
+
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	struct CLZ* pclz;
+	uint8_t* pb;
+	size_t pbsz = CLZ_OUTMAX(4096);
+	char* pline = NULL;
+	size_t sz = 0;
+	ssize_t n;
+	uint32_t in  = 0;
+	uint32_t cmp = 0;
+	int dec = 0;
+	int nl;
+	int c;
+
+	while ((c = getopt(argc, argv, "d")) != -1)
+	{
+		switch (c)
+		{
+		case 'd': // Uncompress
+			dec = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-d] < in > out\n", argv[0]);
+			return 1;
+		}
+	}
+
+	pclz = (struct CLZ*)malloc(sizeof(struct CLZ));
+	pb   = (uint8_t*)malloc(pbsz);
+	if ((pclz == NULL) || (pb == NULL)) return 1;
+	clz_init(pclz);
+
+	if (dec != 0)
+	{
+		while ((n = fread(pb, 1, 4096, stdin)) > 0)
+		{
+			cmp += n;
+			if (clz_dec(pclz, pb, n, out, NULL) < 0)
+			{
+				fprintf(stderr, "bad stream near byte %u\n", cmp);
+				return 1;
+			}
+		}
+		if ((pclz->magic < CLZ_MAGICSZ) || (pclz->nrec != 0))
+		{
+			fprintf(stderr, "stream ends short\n");
+			return 1;
+		}
+	}
+	else
+	{
+		cmp = clz_enc_magic(pb);
+		fwrite(pb, 1, cmp, stdout);
+		while ((n = getline(&pline, &sz, stdin)) > 0)
+		{
+			in += n;
+			nl = (pline[n - 1] == '\n');
+			if (CLZ_OUTMAX(n) > pbsz)
+			{ // Here, a long line of something
+				pbsz = CLZ_OUTMAX(n);
+				pb = (uint8_t*)realloc(pb, pbsz);
+				if (pb == NULL) return 1;
+			}
+			n = clz_enc_line(pclz, pb, pline, n - nl, nl);
+			fwrite(pb, 1, n, stdout);
+			cmp += n;
+		}
+		free(pline);
+		fprintf(stderr, "in %u out %u (%.2f:1) ", in, cmp, (cmp == 0) ? 0 : (double)in / cmp);
+	}
+	fflush(stdout);
+	fprintf(stderr, "msgs %u text %u newids %u dict %u\n",
+		pclz->msgs, pclz->texts, pclz->newids, pclz->nid);
+	return 0;
+}
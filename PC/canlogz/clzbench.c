@@ -0,0 +1,161 @@
+/* *****************************************************************************
+* File Name          : clzbench.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Compressed CAN log: size and speed on a log file
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 clzbench.c canlogz.c ../gatewaybin/gatewaybin.c ../../Ourwares/hexcodec.c -I../gatewaybin -I../../Ourwares -o clzbench
+./clzbench ../../docs/data/log200220-2.txt
+
+Compresses the log, checks that it decodes back byte for byte (in one
+piece, and fed a few bytes at a time), then times encode and decode.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "canlogz.h"
+
+struct OUTBUF
+{
+	char* p;
+	int n;
+};
+
+static void out(const char* pc, int ct, const struct GBINMSG* pm, void* parg)
+{
+	struct OUTBUF* po = (struct OUTBUF*)parg;
+	memcpy(po->p + po->n, pc, ct);
+	po->n += ct;
+	return;
+}
+static void none(const char* pc, int ct, const struct GBINMSG* pm, void* parg)
+{
+	*(int*)parg += ct;
+	return;
+}
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec + ts.tv_nsec * 1E-9);
+}
+/* Compress the whole log; return bytes */
+static int enc(struct CLZ* p, uint8_t* pz, const char* pin, int n)
+{
+	const char* pe = pin + n;
+	const char* pnl;
+	uint8_t* pz0 = pz;
+
+	clz_init(p);
+	pz += clz_enc_magic(pz);
+	while (pin < pe)
+	{
+		pnl = memchr(pin, '\n', pe - pin);
+		if (pnl == NULL)
+		{ // Here, last line with no '\n'
+			pz += clz_enc_line(p, pz, pin, pe - pin, 0);
+			break;
+		}
+		pz += clz_enc_line(p, pz, pin, pnl - pin, 1);
+		pin = pnl + 1;
+	}
+	return (pz - pz0);
+}
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	static struct CLZ clz;
+	struct OUTBUF ob;
+	FILE* fp;
+	char* pin;
+	uint8_t* pz;
+	long nin;
+	int nz;
+	int nbin;
+	int reps;
+	int ct;
+	int i;
+	int k;
+	double t0, tenc, tdec;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s logfile\n", argv[0]);
+		return 1;
+	}
+	fp = fopen(argv[1], "r");
+	if (fp == NULL)
+	{
+		perror(argv[1]);
+		return 1;
+	}
+	fseek(fp, 0, SEEK_END);
+	nin = ftell(fp);
+	rewind(fp);
+	pin  = (char*)malloc(nin + 1);
+	pz   = (uint8_t*)malloc(CLZ_OUTMAX(nin) + nin);
+	ob.p = (char*)malloc(nin + CLZ_RECMAX);
+	if ((pin == NULL) || (pz == NULL) || (ob.p == NULL)) return 1;
+	if (fread(pin, 1, nin, fp) != nin) return 1;
+	fclose(fp);
+
+	/* Size */
+	nz = enc(&clz, pz, pin, nin);
+	nbin = 0; // Same msgs as gateway binary frames would be (CANcompress_G + checksum, no stuffing)
+	for (i = 0; i < nin; i++)
+		if (pin[i] == '\n') nbin += 1;
+	nbin = (nin - nbin) / 2;
+	printf("%s: %ld bytes, %u msgs, %u text, %u ids\n", argv[1], nin, clz.msgs, clz.texts, clz.nid);
+	printf("compressed %d bytes: %.2f:1 vs ascii/hex, %.2f:1 vs binary (%d), %.2f bytes/msg\n",
+		nz, (double)nin / nz, (double)nbin / nz, nbin, (clz.msgs == 0) ? 0 : (double)(nz - CLZ_MAGICSZ) / clz.msgs);
+
+	/* Round trip: one piece, then 1 - 7 bytes at a time */
+	clz_init(&clz);
+	ob.n = 0;
+	clz_dec(&clz, pz, nz, out, &ob);
+	if ((ob.n != nin) || (memcmp(ob.p, pin, nin) != 0))
+	{
+		printf("round trip FAILED (one piece)\n");
+		return 1;
+	}
+	clz_init(&clz);
+	ob.n = 0;
+	for (i = 0; i < nz; i += k)
+	{
+		k = 1 + (i % 7);
+		if (k > (nz - i)) k = nz - i;
+		if (clz_dec(&clz, pz + i, k, out, &ob) < 0) break;
+	}
+	if ((ob.n != nin) || (memcmp(ob.p, pin, nin) != 0))
+	{
+		printf("round trip FAILED (pieces)\n");
+		return 1;
+	}
+	printf("round trip OK (one piece, and 1 - 7 byte pieces)\n");
+
+	/* Speed */
+	reps = 1 + (50000000 / nin);
+	t0 = now();
+	for (i = 0; i < reps; i++)
+		enc(&clz, pz, pin, nin);
+	tenc = now() - t0;
+
+	ct = 0;
+	t0 = now();
+	for (i = 0; i < reps; i++)
+	{
+		clz_init(&clz);
+		clz_dec(&clz, pz, nz, none, &ct);
+	}
+	tdec = now() - t0;
+	printf("encode %.3g msgs/s (%.0f MB/s of log)\n", reps * (double)clz.msgs / tenc, reps * (double)nin / tenc / 1E6);
+	printf("decode %.3g msgs/s (%.0f MB/s of log out)\n", reps * (double)clz.msgs / tdec, (double)ct / tdec / 1E6);
+	return 0;
+}
@@ -0,0 +1,1002 @@
+/* *****************************************************************************
+* File Name          : cansim.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Simulated bxCAN and bus for running the firmware CAN driver on the PC
+****************************************************************************** */
+/*
+Library for 'csim' and 'cansimtest' (see those for gcc lines).
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "cansim.h"
+#include "FreeRTOS.h"
+#include "morse.h"
+#include "gatewaybin.h"
+
+struct CANSIM cansim;
+
+uint32_t SystemCoreClock = 168000000;
+uint32_t debugTX1c; // main.c: counted by can_iface.c
+
+#define PCLK1   42000000
+#define TICKNS  (1000000000ull / configTICK_RATE_HZ) // 1953125 ns
+
+#define ERRFRAME 14 // Error flag 6 + delimiter 8 (bits)
+#define IFS      3  // Intermission
+
+static void irq(void);
+static int inirq;
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+	return PCLK1;
+}
+uint32_t cansim_dtw(void)
+{
+	return (uint32_t)(cansim.t * 21 / 125); // 168 MHz
+}
+uint32_t cansim_tick(void)
+{
+	return (uint32_t)(cansim.t / TICKNS);
+}
+uint64_t cansim_tickns(uint32_t tick)
+{
+	return (uint64_t)tick * TICKNS;
+}
+void morse_trap(uint16_t x)
+{
+	fprintf(stderr, "cansim: morse_trap(%u) at %.6f s\n", x, cansim.t * 1E-9);
+	exit(2);
+}
+static uint64_t rnd(void)
+{ // xorshift64
+	cansim.rng ^= cansim.rng << 13;
+	cansim.rng ^= cansim.rng >> 7;
+	cansim.rng ^= cansim.rng << 17;
+	return cansim.rng;
+}
+
+/* ======= Timed calls (heap on time, then order made) ================================================== */
+static int evless(struct CSIMEV* pa, struct CSIMEV* pb)
+{
+	if (pa->t != pb->t) return (pa->t < pb->t);
+	return (pa->seq < pb->seq);
+}
+void cansim_at(uint64_t t, void (*fn)(void* parg), void* parg)
+{
+	struct CSIMEV e;
+	int i, k;
+
+	if (cansim.nev == cansim.evsize)
+	{
+		cansim.evsize = (cansim.evsize == 0) ? 256 : (cansim.evsize * 2);
+		cansim.pev = (struct CSIMEV*)realloc(cansim.pev, cansim.evsize * sizeof(struct CSIMEV));
+		if (cansim.pev == NULL) morse_trap(1);
+	}
+	e.t    = (t < cansim.t) ? cansim.t : t;
+	e.seq  = cansim.evseq++;
+	e.fn   = fn;
+	e.parg = parg;
+	i = cansim.nev++;
+	while (i > 0)
+	{
+		k = (i - 1) / 2;
+		if (!evless(&e, &cansim.pev[k])) break;
+		cansim.pev[i] = cansim.pev[k];
+		i = k;
+	}
+	cansim.pev[i] = e;
+	return;
+}
+static struct CSIMEV evpop(void)
+{
+	struct CSIMEV top = cansim.pev[0];
+	struct CSIMEV e = cansim.pev[--cansim.nev];
+	int i = 0, k;
+
+	for (;;)
+	{
+		k = 2 * i + 1;
+		if (k >= cansim.nev) break;
+		if ((k + 1 < cansim.nev) && evless(&cansim.pev[k + 1], &cansim.pev[k])) k += 1;
+		if (!evless(&cansim.pev[k], &e)) break;
+		cansim.pev[i] = cansim.pev[k];
+		i = k;
+	}
+	if (cansim.nev > 0) cansim.pev[i] = e;
+	return top;
+}
+
+/* ======= Frames ======================================================================================== */
+/* ************************************************************************************************************
+ * uint16_t cansim_framebits(const struct CSIMFRAME* pf);
+ * @brief	: Frame length on the bus, SOF to end of EOF, stuff bits included
+ * ************************************************************************************************************ */
+uint16_t cansim_framebits(const struct CSIMFRAME* pf)
+{
+	uint8_t b[160];
+	uint32_t id = pf->id;
+	uint32_t rtr = (id & CAN_RTR_REMOTE) ? 1 : 0;
+	uint16_t crc = 0;
+	int dlc = pf->dlc & 0xf;
+	int nd = (rtr != 0) ? 0 : ((dlc > 8) ? 8 : dlc);
+	int n = 0;
+	int stuff = 0;
+	int run, last;
+	int i, k, nxt;
+
+#define PUT(v, nb) for (k = (nb) - 1; k >= 0; k--) b[n++] = ((v) >> k) & 1
+	PUT(0, 1);                  // SOF
+	PUT(id >> 21, 11);          // Base id
+	if ((id & CAN_ID_EXT) != 0)
+	{
+		PUT(3, 2);               // SRR, IDE
+		PUT((id >> 3) & 0x3ffff, 18);
+		PUT(rtr, 1);
+		PUT(0, 2);               // r1, r0
+	}
+	else
+	{
+		PUT(rtr, 1);
+		PUT(0, 2);               // IDE, r0
+	}
+	PUT(dlc, 4);
+	for (i = 0; i < nd; i++)
+	{
+		PUT(pf->uc[i], 8);
+	}
+	for (i = 0; i < n; i++)
+	{ // CRC-15
+		nxt = b[i] ^ ((crc >> 14) & 1);
+		crc = (crc << 1) & 0x7fff;
+		if (nxt != 0) crc ^= 0x4599;
+	}
+	PUT(crc, 15);
+#undef PUT
+
+	/* Stuff bits: after 5 the same, one the other way (which starts the next run) */
+	run  = 1;
+	last = b[0];
+	for (i = 1; i < n; i++)
+	{
+		if (b[i] == last)
+			run += 1;
+		else
+		{
+			last = b[i];
+			run  = 1;
+		}
+		if (run == 5)
+		{
+			stuff += 1;
+			last = !last;
+			run  = 1;
+		}
+	}
+	return (n + stuff + 1 + 2 + 7); // CRC delimiter, ACK slot and delimiter, EOF
+}
+/* ************************************************************************************************************
+ * uint32_t cansim_key(uint32_t id);
+ * @brief	: Arbitration bits of an id (our format); lower wins
+ * ************************************************************************************************************ */
+/*
+Std:  id[10:0] RTR IDE(0)
+Ext:  id[28:18] SRR(1) IDE(1) id[17:0] RTR
+*/
+uint32_t cansim_key(uint32_t id)
+{
+	uint32_t rtr = (id & CAN_RTR_REMOTE) ? 1 : 0;
+
+	if ((id & CAN_ID_EXT) != 0)
+		return ((id >> 21) << 21) | (3u << 19) | (((id >> 3) & 0x3ffff) << 1) | rtr;
+	return ((id >> 21) << 21) | (rtr << 20);
+}
+
+/* ======= Other nodes =================================================================================== */
+/* ************************************************************************************************************
+ * int cansim_mixadd(const struct CSIMFRAME* pf, uint64_t period, uint64_t phase, int node);
+ * @brief	: Add a periodic msg for another node
+ * @return	: index; -1 = table full
+ * ************************************************************************************************************ */
+int cansim_mixadd(const struct CSIMFRAME* pf, uint64_t period, uint64_t phase, int node)
+{
+	struct CSIMMIX* pm;
+
+	if ((cansim.nmix >= CSIM_MAXMIX) || (period == 0) || (node < 0) || (node >= CSIM_MAXNODE)) return -1;
+	pm = &cansim.mix[cansim.nmix];
+	memset(pm, 0, sizeof(struct CSIMMIX));
+	pm->f      = *pf;
+	pm->period = period;
+	pm->next   = cansim.t + phase;
+	pm->key    = cansim_key(pf->id);
+	pm->bits   = cansim_framebits(pf);
+	pm->node   = node;
+	if (node >= cansim.nnode) cansim.nnode = node + 1;
+	return cansim.nmix++;
+}
+/* ************************************************************************************************************
+ * void cansim_mixremove(uint32_t id);
+ * @brief	: Take an id out of the mix (e.g. one the node under test sends)
+ * ************************************************************************************************************ */
+void cansim_mixremove(uint32_t id)
+{
+	int i, j = 0;
+
+	for (i = 0; i < cansim.nmix; i++)
+	{
+		if ((cansim.mix[i].f.id & ~1u) == (id & ~1u)) continue;
+		cansim.mix[j++] = cansim.mix[i];
+	}
+	cansim.nmix = j;
+	return;
+}
+/* ************************************************************************************************************
+ * void cansim_mixscale(double load);
+ * @brief	: Scale the periods of the mix to a bus load (0 - 1)
+ * ************************************************************************************************************ */
+void cansim_mixscale(double load)
+{
+	double k = cansim_mixload_of() / load;
+	int i;
+
+	if ((load <= 0) || (k <= 0)) return;
+	for (i = 0; i < cansim.nmix; i++)
+	{
+		cansim.mix[i].period = (uint64_t)(cansim.mix[i].period * k);
+		if (cansim.mix[i].period == 0) cansim.mix[i].period = 1;
+	}
+	return;
+}
+/* ************************************************************************************************************
+ * double cansim_mixload_of(void);
+ * @brief	: Bus load of the mix as set up (0 - 1)
+ * ************************************************************************************************************ */
+double cansim_mixload_of(void)
+{
+	double l = 0;
+	int i;
+
+	for (i = 0; i < cansim.nmix; i++)
+		l += (double)(cansim.mix[i].bits + IFS) * cansim.bit / cansim.mix[i].period;
+	return l;
+}
+
+struct MIXID
+{
+	struct CSIMFRAME f;
+	uint64_t ct;
+};
+struct MIXCT
+{
+	struct MIXID id[CSIM_MAXMIX];
+	int n;
+	uint64_t ntime;
+};
+static void mixct(struct GBINMSG* pm, void* parg)
+{
+	struct MIXCT* pc = (struct MIXCT*)parg;
+	int i;
+
+	if (pm->id == 0x00400000) pc->ntime += 1; // Time sync, 64 per sec
+	for (i = 0; i < pc->n; i++)
+		if (pc->id[i].f.id == pm->id) break;
+	if (i == pc->n)
+	{
+		if (pc->n == CSIM_MAXMIX) return;
+		pc->n += 1;
+		pc->id[i].f.id = pm->id;
+	}
+	pc->id[i].ct   += 1;
+	pc->id[i].f.dlc = pm->dlc;
+	memcpy(pc->id[i].f.uc, pm->uc, 8);
+	return;
+}
+static int idcmp(const void* pa, const void* pb)
+{
+	uint32_t a = cansim_key(((const struct MIXID*)pa)->f.id);
+	uint32_t b = cansim_key(((const struct MIXID*)pb)->f.id);
+	return (a > b) - (a < b);
+}
+/* ************************************************************************************************************
+ * int cansim_mixload(const char* fname, double load, int nnode, uint32_t seed);
+ * @brief	: Add the msg mix of a gateway log, spread over 'nnode' nodes
+ * @param	: fname = gateway ascii/hex log
+ * @param	: load = bus load (0 - 1) of the mix; 0 = rates as in the log
+ * @param	: seed = for the start phases
+ * @return	: number of ids; -1 = can't read; -2 = no time msgs (rates unknown)
+ * ************************************************************************************************************ */
+/*
+Rates are counts over the log's length, which is the number of time sync
+msgs (id 00400000, 64 per sec).  Ids go to the nodes in turn, lowest first.
+The payload sent is the last one in the log (it sets the stuff bits).
+*/
+int cansim_mixload(const char* fname, double load, int nnode, uint32_t seed)
+{
+	static struct MIXCT c;
+	struct GBIN g;
+	uint8_t buf[65536];
+	size_t n;
+	double secs, rate, bps = 0, scale = 1;
+	FILE* fp;
+	int i, k;
+
+	memset(&c, 0, sizeof(c));
+	fp = fopen(fname, "r");
+	if (fp == NULL) return -1;
+	gbin_init(&g, GBIN_MODE_ASCII);
+	while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+		gbin_feed(&g, buf, n, mixct, &c);
+	fclose(fp);
+	if (c.ntime == 0) return -2;
+	secs = c.ntime / 64.0;
+	qsort(c.id, c.n, sizeof(struct MIXID), idcmp);
+
+	if (nnode < 1) nnode = 1;
+	if (nnode > CSIM_MAXNODE) nnode = CSIM_MAXNODE;
+	for (i = 0; i < c.n; i++)
+		bps += (c.id[i].ct / secs) * (cansim_framebits(&c.id[i].f) + IFS);
+	if (load > 0) scale = (load * 1E9 / cansim.bit) / bps;
+
+	if (seed != 0) cansim.rng = seed;
+	for (i = 0; i < c.n; i++)
+	{
+		rate = c.id[i].ct / secs * scale;
+		k = cansim_mixadd(&c.id[i].f, (uint64_t)(1E9 / rate), 0, i % nnode);
+		if (k < 0) break;
+		cansim.mix[k].next = cansim.t + rnd() % cansim.mix[k].period;
+	}
+	return c.n;
+}
+
+/* ======= bxCAN, node under test ======================================================================== */
+static void esr(void)
+{
+	struct CSIMBX* pb = &cansim.bx;
+	uint32_t v;
+
+	if (pb->tec > 255) pb->boff = 1;
+	v  = ((pb->tec > 255) ? 255 : pb->tec) << CAN_ESR_TEC_Pos;
+	v |= (uint32_t)pb->rec << CAN_ESR_REC_Pos;
+	v |= (uint32_t)pb->lec << CAN_ESR_LEC_Pos;
+	if (pb->boff != 0) v |= CAN_ESR_BOFF;
+	if ((pb->tec > 127) || (pb->rec > 127)) v |= CAN_ESR_EPVF;
+	if ((pb->tec >= 96) || (pb->rec >= 96)) v |= CAN_ESR_EWGF;
+	pb->reg.ESR = v;
+	return;
+}
+/* Filter match: returns FIFO, or -1; sets filter match index */
+static int filter(uint32_t id, uint8_t* pfmi)
+{
+	struct CSIMFILT* pf;
+	uint32_t v32 = id & ~1u;
+	uint32_t v16 = ((id >> 21) << 5) | ((id & CAN_RTR_REMOTE) ? 0x10 : 0) | ((id & CAN_ID_EXT) ? 0x08 : 0) | ((id >> 18) & 7);
+	int scale, mode, i, j;
+
+	/* 32 bit before 16 bit, list before mask, then by number */
+	for (scale = CAN_FILTERSCALE_32BIT; scale >= 0; scale--)
+	{
+		for (mode = CAN_FILTERMODE_IDLIST; mode >= 0; mode--)
+		{
+			for (i = 0; i < CSIM_NFILT; i++)
+			{
+				pf = &cansim.bx.filt[i];
+				if ((pf->on == 0) || (pf->scale != scale) || (pf->mode != mode)) continue;
+				if (scale == CAN_FILTERSCALE_32BIT)
+				{
+					if (mode == CAN_FILTERMODE_IDLIST)
+					{
+						if ((v32 != (pf->id[0] & ~1u)) && (v32 != (pf->mask[0] & ~1u))) continue;
+					}
+					else if ((v32 & pf->mask[0]) != (pf->id[0] & pf->mask[0])) continue;
+					*pfmi = i;
+					return pf->fifo;
+				}
+				for (j = 0; j < 2; j++)
+				{
+					if (mode == CAN_FILTERMODE_IDLIST)
+					{
+						if ((v16 != (pf->id[j] & 0xffff)) && (v16 != (pf->mask[j] & 0xffff))) continue;
+					}
+					else if ((v16 & pf->mask[j]) != (pf->id[j] & pf->mask[j] & 0xffff)) continue;
+					*pfmi = i;
+					return pf->fifo;
+				}
+			}
+		}
+	}
+	return -1;
+}
+static void rxpush(const struct CSIMFRAME* pf, uint16_t time)
+{
+	struct CSIMBX* pb = &cansim.bx;
+	uint8_t fmi = 0;
+	int f = filter(pf->id, &fmi);
+	int k;
+
+	if (f < 0)
+	{
+		pb->rxnofilt += 1;
+		return;
+	}
+	if (pb->fn[f] == CSIM_FIFOSZ)
+	{ // Overrun: newest msg goes over the last one
+		pb->rxovr[f] += 1;
+		k = (pb->fhead[f] + CSIM_FIFOSZ - 1) % CSIM_FIFOSZ;
+	}
+	else
+	{
+		k = (pb->fhead[f] + pb->fn[f]) % CSIM_FIFOSZ;
+		pb->fn[f] += 1;
+	}
+	pb->fifo[f][k]  = *pf;
+	pb->ftime[f][k] = time;
+	pb->fidx[f][k]  = fmi;
+	pb->rxct += 1;
+	if (pb->rec > 0) pb->rec -= 1;
+	return;
+}
+
+/* ======= HAL CAN calls ================================================================================= */
+HAL_StatusTypeDef HAL_CAN_Init(CAN_HandleTypeDef* hcan)
+{
+	hcan->ErrorCode = HAL_CAN_ERROR_NONE;
+	hcan->State     = HAL_CAN_STATE_READY;
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_CAN_ConfigFilter(CAN_HandleTypeDef* hcan, CAN_FilterTypeDef* p)
+{
+	struct CSIMFILT* pf;
+
+	if (p->FilterBank >= CSIM_NFILT)
+	{
+		hcan->ErrorCode |= HAL_CAN_ERROR_PARAM;
+		return HAL_ERROR;
+	}
+	pf = &cansim.bx.filt[p->FilterBank];
+	pf->mode  = p->FilterMode;
+	pf->scale = p->FilterScale;
+	pf->fifo  = p->FilterFIFOAssignment;
+	pf->on    = (p->FilterActivation == CAN_FILTER_ENABLE);
+	if (p->FilterScale == CAN_FILTERSCALE_32BIT)
+	{
+		pf->id[0]   = (p->FilterIdHigh << 16) | (p->FilterIdLow & 0xffff);
+		pf->mask[0] = (p->FilterMaskIdHigh << 16) | (p->FilterMaskIdLow & 0xffff);
+	}
+	else
+	{ // FR1 = MaskIdLow:IdLow, FR2 = MaskIdHigh:IdHigh
+		pf->id[0]   = p->FilterIdLow & 0xffff;
+		pf->mask[0] = p->FilterMaskIdLow & 0xffff;
+		pf->id[1]   = p->FilterIdHigh & 0xffff;
+		pf->mask[1] = p->FilterMaskIdHigh & 0xffff;
+	}
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_CAN_Start(CAN_HandleTypeDef* hcan)
+{
+	struct CSIMBX* pb = &cansim.bx;
+
+	if (hcan->State != HAL_CAN_STATE_READY)
+	{
+		hcan->ErrorCode |= HAL_CAN_ERROR_NOT_READY;
+		return HAL_ERROR;
+	}
+	if (pb->startfail != 0)
+	{ // INAK did not clear in time
+		pb->startfail -= 1;
+		hcan->ErrorCode |= HAL_CAN_ERROR_TIMEOUT;
+		hcan->State = HAL_CAN_STATE_ERROR;
+		return HAL_ERROR;
+	}
+	hcan->State = HAL_CAN_STATE_LISTENING;
+	pb->init = 0;
+	if (pb->boff != 0)
+	{ // Bus-off recovery starts: 128 x 11 recessive bits
+		pb->recover  = 1;
+		pb->reccount = 0;
+		cansim.idlefrom = (cansim.busfree > cansim.t) ? cansim.busfree : cansim.t;
+	}
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_CAN_Stop(CAN_HandleTypeDef* hcan)
+{
+	if (hcan->State != HAL_CAN_STATE_LISTENING)
+	{
+		hcan->ErrorCode |= HAL_CAN_ERROR_NOT_STARTED;
+		return HAL_ERROR;
+	}
+	cansim.bx.init    = 1;
+	cansim.bx.recover = 0;
+	hcan->State = HAL_CAN_STATE_READY;
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_CAN_ActivateNotification(CAN_HandleTypeDef* hcan, uint32_t ActiveITs)
+{
+	cansim.bx.ier |= ActiveITs;
+	hcan->Instance->IER = cansim.bx.ier;
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_CAN_AddTxMessage(CAN_HandleTypeDef* hcan, CAN_TxHeaderTypeDef* pHeader, uint8_t aData[], uint32_t* pTxMailbox)
+{
+	struct CSIMMBX* pm;
+	int i;
+
+	if ((hcan->State != HAL_CAN_STATE_READY) && (hcan->State != HAL_CAN_STATE_LISTENING))
+	{
+		hcan->ErrorCode |= HAL_CAN_ERROR_NOT_INITIALIZED;
+		return HAL_ERROR;
+	}
+	for (i = 0; i < CSIM_NMBX; i++)
+		if (cansim.bx.mbx[i].state == 0) break;
+	if (i == CSIM_NMBX)
+	{ // No free mailbox
+		hcan->ErrorCode |= HAL_CAN_ERROR_PARAM;
+		return HAL_ERROR;
+	}
+	pm = &cansim.bx.mbx[i];
+	if (pHeader->IDE == CAN_ID_STD)
+		pm->f.id = pHeader->StdId << 21;
+	else
+		pm->f.id = (pHeader->ExtId << 3) | CAN_ID_EXT;
+	pm->f.id  |= pHeader->RTR & CAN_RTR_REMOTE;
+	pm->f.dlc  = pHeader->DLC & 0xf;
+	memcpy(pm->f.uc, aData, 8);
+	pm->key    = cansim_key(pm->f.id);
+	pm->state  = 1;
+	pm->abrq   = 0;
+	*pTxMailbox = 1u << i;
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_CAN_AbortTxRequest(CAN_HandleTypeDef* hcan, uint32_t TxMailboxes)
+{
+	struct CSIMMBX* pm;
+	int i;
+
+	for (i = 0; i < CSIM_NMBX; i++)
+	{
+		if ((TxMailboxes & (1u << i)) == 0) continue;
+		pm = &cansim.bx.mbx[i];
+		if (pm->state == 1)
+		{ // Not on the bus: aborted now
+			pm->state = 0;
+			pm->rqcp  = 1;
+			cansim.bx.abortct += 1;
+		}
+		else if (pm->state == 2)
+			pm->abrq = 1; // At the end of the frame, if it fails
+	}
+	if (inirq == 0) irq(); // The TX interrupt comes straight away
+	return HAL_OK;
+}
+uint32_t HAL_CAN_GetTxTimestamp(CAN_HandleTypeDef* hcan, uint32_t TxMailbox)
+{
+	int i = (TxMailbox == CAN_TX_MAILBOX2) ? 2 : ((TxMailbox == CAN_TX_MAILBOX1) ? 1 : 0);
+	return cansim.bx.mbx[i].time;
+}
+HAL_StatusTypeDef HAL_CAN_GetRxMessage(CAN_HandleTypeDef* hcan, uint32_t RxFifo, CAN_RxHeaderTypeDef* pHeader, uint8_t aData[])
+{
+	struct CSIMBX* pb = &cansim.bx;
+	struct CSIMFRAME* pf;
+	int f = (RxFifo == CAN_RX_FIFO1);
+	int k = pb->fhead[f];
+
+	if (pb->fn[f] == 0)
+	{
+		hcan->ErrorCode |= HAL_CAN_ERROR_PARAM;
+		return HAL_ERROR;
+	}
+	pf = &pb->fifo[f][k];
+	pHeader->IDE   = pf->id & CAN_ID_EXT;
+	pHeader->StdId = pf->id >> 21;
+	pHeader->ExtId = (pf->id >> 3) & 0x1fffffff;
+	pHeader->RTR   = pf->id & CAN_RTR_REMOTE;
+	pHeader->DLC   = pf->dlc;
+	pHeader->Timestamp = pb->ftime[f][k];
+	pHeader->FilterMatchIndex = pb->fidx[f][k];
+	memcpy(aData, pf->uc, 8);
+	pb->fhead[f] = (k + 1) % CSIM_FIFOSZ;
+	pb->fn[f]   -= 1;
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_CAN_ResetError(CAN_HandleTypeDef* hcan)
+{
+	hcan->ErrorCode = HAL_CAN_ERROR_NONE;
+	return HAL_OK;
+}
+
+/* HAL __weak callbacks: the ones the driver does not have */
+__attribute__((weak)) void HAL_CAN_TxMailbox0CompleteCallback(CAN_HandleTypeDef* hcan) {}
+__attribute__((weak)) void HAL_CAN_TxMailbox1CompleteCallback(CAN_HandleTypeDef* hcan) { cansim.bx.cb12 += 1; }
+__attribute__((weak)) void HAL_CAN_TxMailbox2CompleteCallback(CAN_HandleTypeDef* hcan) { cansim.bx.cb12 += 1; }
+__attribute__((weak)) void HAL_CAN_TxMailbox0AbortCallback(CAN_HandleTypeDef* hcan) {}
+__attribute__((weak)) void HAL_CAN_TxMailbox1AbortCallback(CAN_HandleTypeDef* hcan) { cansim.bx.cb12 += 1; }
+__attribute__((weak)) void HAL_CAN_TxMailbox2AbortCallback(CAN_HandleTypeDef* hcan) { cansim.bx.cb12 += 1; }
+__attribute__((weak)) void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef* hcan) {}
+__attribute__((weak)) void HAL_CAN_RxFifo1MsgPendingCallback(CAN_HandleTypeDef* hcan) {}
+__attribute__((weak)) void HAL_CAN_ErrorCallback(CAN_HandleTypeDef* hcan) {}
+
+/* Interrupts that are pending, as HAL_CAN_IRQHandler takes them */
+static const uint32_t lecbit[8] = {0, HAL_CAN_ERROR_STF, HAL_CAN_ERROR_FOR, HAL_CAN_ERROR_ACK,
+	HAL_CAN_ERROR_BR, HAL_CAN_ERROR_BD, HAL_CAN_ERROR_CRC, 0};
+static void irq(void)
+{
+	struct CSIMBX* pb = &cansim.bx;
+	CAN_HandleTypeDef* phcan = pb->phcan;
+	struct CSIMMBX* pm;
+	uint32_t errorcode;
+	uint32_t esrflags;
+	int again = 1;
+	int loop = 0;
+	int i, n;
+
+	if ((phcan == NULL) || (inirq != 0)) return;
+	inirq = 1;
+	while ((again != 0) && (loop++ < 16))
+	{
+		again = 0;
+		errorcode = HAL_CAN_ERROR_NONE;
+
+		/* TX: request completed */
+		if ((pb->ier & CAN_IT_TX_MAILBOX_EMPTY) != 0)
+		{
+			for (i = 0; i < CSIM_NMBX; i++)
+			{
+				pm = &pb->mbx[i];
+				if (pm->rqcp == 0) continue;
+				again = 1;
+				pm->rqcp = 0;
+				if (pm->txok != 0)
+				{
+					pm->txok = 0;
+					if (i == 0) HAL_CAN_TxMailbox0CompleteCallback(phcan);
+					if (i == 1) HAL_CAN_TxMailbox1CompleteCallback(phcan);
+					if (i == 2) HAL_CAN_TxMailbox2CompleteCallback(phcan);
+				}
+				else if (pm->alst != 0)
+				{
+					pm->alst = 0;
+					errorcode |= HAL_CAN_ERROR_TX_ALST0 << (2 * i);
+				}
+				else if (pm->terr != 0)
+				{
+					pm->terr = 0;
+					errorcode |= HAL_CAN_ERROR_TX_TERR0 << (2 * i);
+				}
+				else
+				{
+					if (i == 0) HAL_CAN_TxMailbox0AbortCallback(phcan);
+					if (i == 1) HAL_CAN_TxMailbox1AbortCallback(phcan);
+					if (i == 2) HAL_CAN_TxMailbox2AbortCallback(phcan);
+				}
+			}
+		}
+
+		/* RX: the interrupt stays while the FIFO is not empty */
+		for (i = 0; i < 2; i++)
+		{
+			if ((pb->ier & ((i == 0) ? CAN_IT_RX_FIFO0_MSG_PENDING : CAN_IT_RX_FIFO1_MSG_PENDING)) == 0) continue;
+			while (pb->fn[i] != 0)
+			{
+				n = pb->fn[i];
+				if (i == 0)
+					HAL_CAN_RxFifo0MsgPendingCallback(phcan);
+				else
+					HAL_CAN_RxFifo1MsgPendingCallback(phcan);
+				if (pb->fn[i] >= n) break; // Callback took none (would hang the hardware)
+			}
+		}
+
+		/* Status change and error (SCE vector) */
+		esrflags = pb->reg.ESR & (CAN_ESR_EWGF | CAN_ESR_EPVF | CAN_ESR_BOFF);
+		if ((cansim.sce != 0) && ((pb->ier & CAN_IT_ERROR) != 0) &&
+			 (((esrflags & ~pb->esrflags) != 0) || (pb->lecnew != 0)))
+		{
+			if (((esrflags & CAN_ESR_EWGF) != 0) && ((pb->ier & CAN_IT_ERROR_WARNING) != 0))
+				errorcode |= HAL_CAN_ERROR_EWG;
+			if (((esrflags & CAN_ESR_EPVF) != 0) && ((pb->ier & CAN_IT_ERROR_PASSIVE) != 0))
+				errorcode |= HAL_CAN_ERROR_EPV;
+			if (((esrflags & CAN_ESR_BOFF) != 0) && ((pb->ier & CAN_IT_BUSOFF) != 0))
+				errorcode |= HAL_CAN_ERROR_BOF;
+			if ((pb->lecnew != 0) && ((pb->ier & CAN_IT_LAST_ERROR_CODE) != 0))
+				errorcode |= lecbit[pb->lec & 7];
+		}
+		pb->esrflags = esrflags;
+		pb->lecnew   = 0;
+
+		if (errorcode != HAL_CAN_ERROR_NONE)
+		{
+			phcan->ErrorCode |= errorcode;
+			pb->errcb += 1;
+			HAL_CAN_ErrorCallback(phcan);
+			again = 1;
+		}
+	}
+	inirq = 0;
+	return;
+}
+
+/* ======= Bus =========================================================================================== */
+/* Mailbox of the node under test that would go next; -1 = none */
+static int dutmbx(void)
+{
+	struct CSIMBX* pb = &cansim.bx;
+	int i, k = -1;
+
+	if ((pb->boff != 0) || (pb->init != 0) || (pb->phcan == NULL)) return -1;
+	for (i = 0; i < CSIM_NMBX; i++)
+	{
+		if (pb->mbx[i].state != 1) continue;
+		if ((k < 0) || (pb->mbx[i].key < pb->mbx[k].key)) k = i;
+	}
+	return k;
+}
+static uint64_t busnext(void)
+{
+	struct CSIMBX* pb = &cansim.bx;
+	uint64_t t, tn = UINT64_MAX;
+	int i;
+
+	if (cansim.frameend != 0) return cansim.frameend;
+	t = (cansim.busfree > cansim.t) ? cansim.busfree : cansim.t;
+	if (dutmbx() >= 0) tn = (pb->suspend > t) ? pb->suspend : t;
+	for (i = 0; i < cansim.nmix; i++)
+	{
+		if (cansim.mix[i].next < tn)
+			tn = (cansim.mix[i].next > t) ? cansim.mix[i].next : t;
+	}
+	if (pb->recover != 0)
+	{ // Recovery ends on an idle bus
+		uint64_t tr = cansim.idlefrom + (uint64_t)(128 - pb->reccount) * 11 * cansim.bit;
+		if (tr < tn) tn = (tr > t) ? tr : t;
+	}
+	return tn;
+}
+static void recovered(void)
+{
+	struct CSIMBX* pb = &cansim.bx;
+
+	if ((pb->recover == 0) || (pb->reccount < 128)) return;
+	pb->recover = 0;
+	pb->boff    = 0;
+	pb->tec     = 0;
+	pb->rec     = 0;
+	esr();
+	return;
+}
+static void framestart(void)
+{
+	struct CSIMBX* pb = &cansim.bx;
+	struct CSIMMIX* px;
+	struct CSIMMIX* pbest[CSIM_MAXNODE];
+	uint32_t kwin = UINT32_MAX;
+	uint32_t pid;
+	uint16_t bits;
+	int m = -1;
+	int w = -1;
+	int i;
+
+	/* Bus-off recovery: idle 11 recessive bit sequences */
+	if (pb->recover != 0)
+	{
+		while ((pb->reccount < 128) && ((cansim.t - cansim.idlefrom) >= 11 * cansim.bit))
+		{
+			pb->reccount += 1;
+			cansim.idlefrom += 11 * cansim.bit;
+		}
+		recovered();
+	}
+
+	/* Each node puts up one msg */
+	memset(pbest, 0, sizeof(pbest));
+	for (i = 0; i < cansim.nmix; i++)
+	{
+		px = &cansim.mix[i];
+		if (px->next > cansim.t) continue;
+		if ((pbest[px->node] == NULL) ||
+			 ((cansim.node[px->node].type == CSIM_PRIO) && (px->key < pbest[px->node]->key)) ||
+			 ((cansim.node[px->node].type == CSIM_FIFO) && (px->next < pbest[px->node]->next)))
+			pbest[px->node] = px;
+	}
+	for (i = 0; i < CSIM_MAXNODE; i++)
+	{
+		if ((pbest[i] != NULL) && (pbest[i]->key < kwin))
+		{
+			kwin = pbest[i]->key;
+			w = pbest[i] - cansim.mix;
+		}
+	}
+	if (cansim.t >= pb->suspend) m = dutmbx();
+	if ((m < 0) && (w < 0)) return; // Nothing to send
+
+	if ((m >= 0) && (pb->mbx[m].key <= kwin))
+	{ // Node under test wins (a tie would be a bit error later: ids must differ)
+		if (w >= 0)
+		{ // Lost by the others: they try again at the next SOF
+		}
+		kwin = pb->mbx[m].key;
+		cansim.winner = m;
+		cansim.wnode  = CSIM_NODEDUT;
+		cansim.fbus   = pb->mbx[m].f;
+		pb->mbx[m].state = 2;
+		pb->mbx[m].time  = (uint16_t)(cansim.t / cansim.bit);
+	}
+	else
+	{
+		if (m >= 0)
+		{ // Lost arbitration
+			pb->alstct += 1;
+			if (pb->phcan->Init.AutoRetransmission == DISABLE)
+			{ // NART: request completes with ALST
+				pb->mbx[m].state = 0;
+				pb->mbx[m].rqcp  = 1;
+				pb->mbx[m].alst  = 1;
+			}
+		}
+		cansim.winner = -1;
+		cansim.wnode  = cansim.mix[w].node;
+		cansim.wmix   = w;
+		cansim.fbus   = cansim.mix[w].f;
+	}
+
+	/* Priority inversion: driver holds something that would have won */
+	if ((cansim.pdutpend != NULL) && (cansim.pdutpend(&pid) != 0) && (cansim_key(pid) < kwin))
+	{
+		cansim.invct += 1;
+		cansim.invns += cansim_framebits(&cansim.fbus) * cansim.bit;
+	}
+
+	cansim.sof = cansim.t;
+	bits = cansim_framebits(&cansim.fbus);
+	cansim.werr = 0;
+	if ((cansim.winner >= 0) && (cansim.t >= cansim.errt0) && (cansim.t < cansim.errt1) &&
+		 ((rnd() % 1000000) < cansim.errppm))
+	{ // Bit error somewhere after arbitration, then the error frame
+		cansim.werr = 1;
+		bits = 20 + rnd() % (bits - 30) + ERRFRAME;
+	}
+	cansim.frameend = cansim.t + bits * cansim.bit;
+	cansim.busfree  = cansim.frameend + IFS * cansim.bit;
+	cansim.busybits += bits + IFS;
+	return;
+}
+static void frameend(void)
+{
+	struct CSIMBX* pb = &cansim.bx;
+	struct CSIMMBX* pm;
+	struct CSIMMIX* px;
+
+	cansim.t = cansim.frameend;
+	cansim.frameend = 0;
+	if (cansim.winner >= 0)
+	{ // Node under test sent
+		pm = &pb->mbx[cansim.winner];
+		if (cansim.werr != 0)
+		{
+			pb->txerr += 1;
+			pb->tec   += 8;
+			pb->lec    = 5; // Bit dominant error
+			pb->lecnew = 1;
+			if ((pb->phcan->Init.AutoRetransmission == DISABLE) || (pm->abrq != 0))
+			{
+				pm->state = 0;
+				pm->rqcp  = 1;
+				pm->terr  = 1;
+			}
+			else
+				pm->state = 1; // Sent again
+		}
+		else
+		{
+			pb->txct += 1;
+			if (pb->tec > 0) pb->tec -= 1;
+			pm->state = 0;
+			pm->rqcp  = 1;
+			pm->txok  = 1;
+			if (cansim.pframe != NULL)
+				cansim.pframe(&pm->f, CSIM_NODEDUT, cansim.sof, cansim.t, cansim.pframearg);
+		}
+		esr();
+		if ((pb->reg.ESR & CAN_ESR_EPVF) != 0) // Error passive: suspend transmission
+			pb->suspend = cansim.busfree + 8 * cansim.bit;
+	}
+	else
+	{
+		px = &cansim.mix[cansim.wmix];
+		px->sent += 1;
+		cansim.node[px->node].sent += 1;
+		px->next += px->period;
+		while (px->next + px->period <= cansim.t)
+		{ // Fell behind: one waiting at most
+			px->next += px->period;
+			px->late += 1;
+		}
+		if ((pb->init == 0) && (pb->boff == 0) && (pb->phcan != NULL))
+			rxpush(&cansim.fbus, (uint16_t)(cansim.sof / cansim.bit));
+		esr();
+		if (cansim.pframe != NULL)
+			cansim.pframe(&cansim.fbus, px->node, cansim.sof, cansim.t, cansim.pframearg);
+	}
+	if (pb->recover != 0)
+	{ // ACK delimiter, EOF, intermission: 11 recessive
+		pb->reccount += 1;
+		recovered();
+	}
+	cansim.idlefrom = cansim.busfree;
+	return;
+}
+
+/* ************************************************************************************************************
+ * void cansim_init(CAN_HandleTypeDef* phcan);
+ * @brief	: Reset the simulation; 'phcan' is the node under test (Init values set)
+ * ************************************************************************************************************ */
+void cansim_init(CAN_HandleTypeDef* phcan)
+{
+	struct CSIMEV* pev = cansim.pev;
+	int evsize = cansim.evsize;
+	uint32_t tq;
+
+	memset(&cansim, 0, sizeof(cansim));
+	cansim.pev    = pev;
+	cansim.evsize = evsize;
+	cansim.rng    = 88172645463325252ull;
+	cansim.sce    = 1;
+	cansim.bit    = 2000; // 500 kbit
+	cansim.bx.phcan = phcan;
+	if (phcan != NULL)
+	{
+		phcan->Instance = &cansim.bx.reg;
+		tq = 1 + ((phcan->Init.TimeSeg1 >> CAN_BTR_TS1_Pos) + 1) + ((phcan->Init.TimeSeg2 >> CAN_BTR_TS2_Pos) + 1);
+		if (phcan->Init.Prescaler != 0)
+			cansim.bit = (uint64_t)phcan->Init.Prescaler * tq * 1000000000ull / PCLK1;
+	}
+	cansim.bx.init = 1; // Until HAL_CAN_Start
+	esr();
+	simrtos_init();
+	return;
+}
+/* ************************************************************************************************************
+ * void cansim_txerr(uint64_t t0, uint64_t t1, uint32_t ppm);
+ * @brief	: Frames sent by the node under test that start in [t0, t1) fail with chance ppm/1000000
+ * ************************************************************************************************************ */
+void cansim_txerr(uint64_t t0, uint64_t t1, uint32_t ppm)
+{
+	cansim.errt0  = t0;
+	cansim.errt1  = t1;
+	cansim.errppm = ppm;
+	return;
+}
+/* ************************************************************************************************************
+ * void cansim_run(uint64_t tend);
+ * @brief	: Run the simulation up to time 'tend' (ns)
+ * ************************************************************************************************************ */
+void cansim_run(uint64_t tend)
+{
+	struct CSIMEV e;
+	uint64_t tb, te;
+
+	for (;;)
+	{
+		tb = busnext();
+		te = (cansim.nev > 0) ? cansim.pev[0].t : UINT64_MAX;
+		if ((tb > tend) && (te > tend)) break;
+		if (te <= tb)
+		{ // Timed call (tasks run this way too)
+			e = evpop();
+			if (e.t > cansim.t) cansim.t = e.t;
+			e.fn(e.parg);
+		}
+		else
+		{
+			cansim.t = tb;
+			if (cansim.frameend != 0)
+				frameend();
+			else
+				framestart();
+		}
+		irq();
+	}
+	if (cansim.t < tend) cansim.t = tend;
+	return;
+}
@@ -0,0 +1,257 @@
+/* *****************************************************************************
+* File Name          : cansim.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Simulated bxCAN and bus for running the firmware CAN driver on the PC
+****************************************************************************** */
+/*
+The firmware files are compiled as they are, with 'stub/' ahead of the
+FreeRTOS/HAL includes--
+  Ourwares/can_iface.c   TX pool, mailbox loading, ISR callbacks
+  Ourwares/CanTask.c     CanTxTask (queue path) and xCanTxDirect
+  Ourwares/can_tstamp.c  TTCM time stamp extension
+
+Clock: discrete events in ns.  Nothing takes time except the bus, and
+'cansim.ctxsw' for each switch to a task.  DTWTIME (168 MHz) and the
+FreeRTOS tick (512 Hz) come from the clock.
+
+bxCAN (the node under test): 3 TX mailboxes (lowest id goes first, as
+TXFP = 0), 2 RX FIFOs of 3 (a 4th msg overwrites the last: RFLM = 0), 28
+filter banks (32 and 16 bit, mask and list), TEC/REC and the ESR flags,
+the TTCM 16 bit bit-time counter, NART as 'Init.AutoRetransmission'.
+Interrupts go through the HAL callbacks in the order HAL_CAN_IRQHandler
+uses.  The error interrupts (SCE vector) only when 'cansim.sce' is set, as
+the NVIC enable in stm32f4xx_hal_msp.c.
+
+Bus: bit times from the Init values (Prescaler, BS1, BS2, 42 MHz PCLK1).
+Frame length is counted bit by bit: SOF to CRC with stuff bits, then CRC
+delimiter, ACK, EOF; 3 bits intermission.  Arbitration on the identifier
+bits as on the wire (a standard id beats an extended one with the same 11
+bits).
+
+Other nodes: periodic msgs, each node sending its released msgs lowest id
+first (CSIM_PRIO) or oldest first (CSIM_FIFO, a node with one TX buffer).
+'cansim_mixload' takes the id/dlc/payload mix and rates of a gateway log
+(docs/data) and scales the rates to a bus load.
+
+Errors: 'cansim_txerr' makes transmissions of the node under test fail (bit
+error, then an error frame) for a time, with a chance per frame.  TEC +8
+for each, -1 for each good one; warning at 96, passive at 128, bus-off
+over 255.  Leaving bus-off takes the init mode request and release
+(HAL_CAN_Stop, HAL_CAN_Start) and then 128 x 11 recessive bits.
+*/
+
+#ifndef __CANSIM
+#define __CANSIM
+
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+
+#define CSIM_NMBX     3
+#define CSIM_FIFOSZ   3
+#define CSIM_NFILT    28
+#define CSIM_MAXNODE  16
+#define CSIM_MAXMIX   512   // Periodic msgs of the other nodes
+#define CSIM_NODEDUT  -1    // 'node' of frames sent by the node under test
+
+#define CSIM_PRIO     0     // Node sends lowest id first
+#define CSIM_FIFO     1     // Node sends oldest first
+
+/* A frame, id in our format (StdId << 21 | ExtId << 3 | IDE | RTR) */
+struct CSIMFRAME
+{
+	uint32_t id;
+	uint8_t  dlc;
+	uint8_t  uc[8];
+};
+
+/* A periodic msg of another node */
+struct CSIMMIX
+{
+	struct CSIMFRAME f;
+	uint64_t period;  // ns
+	uint64_t next;    // Release time of the next one
+	uint64_t sent;
+	uint64_t late;    // Releases skipped: still waiting when the next was due
+	uint32_t key;     // Arbitration bits
+	uint16_t bits;    // Frame length
+	uint8_t  node;
+};
+
+struct CSIMMBX
+{
+	struct CSIMFRAME f;
+	uint32_t key;
+	uint16_t time;    // TTCM time of SOF
+	uint8_t  state;   // 0 = empty, 1 = pending, 2 = on the bus
+	uint8_t  abrq;    // Abort requested while on the bus
+	/* Request completed (TSR RQCP/TXOK/ALST/TERR) */
+	uint8_t  rqcp;
+	uint8_t  txok;
+	uint8_t  alst;
+	uint8_t  terr;
+};
+
+struct CSIMFILT
+{
+	uint32_t id[2];   // 32 bit: id[0] = FR1; 16 bit: the four 16 bit values
+	uint32_t mask[2];
+	uint8_t  mode;
+	uint8_t  scale;
+	uint8_t  fifo;
+	uint8_t  on;
+};
+
+/* The node under test */
+struct CSIMBX
+{
+	CAN_HandleTypeDef* phcan;
+	CAN_TypeDef reg;
+	struct CSIMMBX mbx[CSIM_NMBX];
+	struct CSIMFRAME fifo[2][CSIM_FIFOSZ];
+	uint16_t ftime[2][CSIM_FIFOSZ];
+	uint8_t  fidx[2][CSIM_FIFOSZ];
+	uint8_t  fn[2];       // Msgs in FIFO
+	uint8_t  fhead[2];
+	struct CSIMFILT filt[CSIM_NFILT];
+	uint32_t ier;         // HAL_CAN_ActivateNotification bits
+	uint16_t tec;         // 0 - 256+
+	uint8_t  rec;
+	uint8_t  lec;
+	uint8_t  init;        // Init mode (INRQ)
+	uint8_t  boff;
+	uint8_t  recover;     // 1 = counting 11 recessive bit sequences
+	uint16_t reccount;
+	uint8_t  esrflags;    // ESR EWGF/EPVF/BOFF last reported to the SCE interrupt
+	uint8_t  lecnew;      // LEC set since last SCE interrupt
+	uint8_t  startfail;   // HAL_CAN_Start fails this many times (timeout)
+	uint64_t suspend;     // Error passive: no SOF before this (8 bits after own frame)
+	/* Counts */
+	uint64_t rxct;        // Msgs into a FIFO
+	uint64_t rxovr[2];    // FIFO overruns (msg lost)
+	uint64_t rxnofilt;    // Msgs no filter took
+	uint64_t txct;        // Frames sent OK
+	uint64_t txerr;       // Frames with an error
+	uint64_t alstct;      // Arbitrations lost
+	uint64_t abortct;     // Aborts carried out
+	uint64_t cb12;        // Mailbox 1, 2 callbacks (driver only uses 0)
+	uint64_t errcb;       // HAL_CAN_ErrorCallback calls
+};
+
+struct CSIMNODE
+{
+	uint8_t  type;        // CSIM_PRIO, CSIM_FIFO
+	uint64_t sent;
+};
+
+/* Timed call */
+struct CSIMEV
+{
+	uint64_t t;
+	uint64_t seq;
+	void (*fn)(void* parg);
+	void* parg;
+};
+
+struct CANSIM
+{
+	uint64_t t;           // Now (ns)
+	uint64_t bit;         // Bit time (ns)
+	uint64_t ctxsw;       // Cost of a switch to a task (ns)
+	uint8_t  sce;         // 1 = error interrupts enabled in the NVIC
+	struct CSIMBX bx;
+
+	/* Bus */
+	uint64_t busfree;     // Bus idle (intermission done) from
+	uint64_t idlefrom;    // Bus-off recovery: idle bits counted up to here
+	uint64_t frameend;    // Frame on the bus ends (0 = idle)
+	uint64_t sof;
+	struct CSIMFRAME fbus;
+	int      winner;      // Mailbox index (node under test), or -1
+	int      wnode;       // Node of the frame on the bus, CSIM_NODEDUT
+	int      werr;        // 1 = this frame (node under test) gets an error
+	uint64_t busybits;    // Bits used (frames + error frames)
+
+	/* Other nodes */
+	struct CSIMMIX mix[CSIM_MAXMIX];
+	int nmix;
+	struct CSIMNODE node[CSIM_MAXNODE];
+	int nnode;
+	int wmix;             // Mix entry of the frame on the bus
+
+	/* Errors on frames sent by the node under test */
+	uint64_t errt0, errt1;
+	uint32_t errppm;
+	uint64_t rng;
+
+	/* Priority inversion: the node under test had a higher priority msg
+	   in its driver pool than the frame that won the bus */
+	int (*pdutpend)(uint32_t* pid); // Lowest id buffered by the driver; 0 = none
+	uint64_t invct;
+	uint64_t invns;
+
+	/* Called when a frame ends OK on the bus */
+	void (*pframe)(const struct CSIMFRAME* pf, int node, uint64_t tsof, uint64_t tend, void* parg);
+	void* pframearg;
+
+	/* Timed calls */
+	struct CSIMEV* pev;
+	int nev, evsize;
+	uint64_t evseq;
+};
+
+extern struct CANSIM cansim;
+
+/* ************************************************************************************************************ */
+void cansim_init(CAN_HandleTypeDef* phcan);
+/* @brief	: Reset the simulation; 'phcan' is the node under test (Init values set)
+ * ************************************************************************************************************ */
+uint16_t cansim_framebits(const struct CSIMFRAME* pf);
+/* @brief	: Frame length on the bus, SOF to end of EOF, stuff bits included
+ * ************************************************************************************************************ */
+uint32_t cansim_key(uint32_t id);
+/* @brief	: Arbitration bits of an id (our format); lower wins
+ * ************************************************************************************************************ */
+int cansim_mixadd(const struct CSIMFRAME* pf, uint64_t period, uint64_t phase, int node);
+/* @brief	: Add a periodic msg for another node
+ * @param	: period, phase = ns
+ * @param	: node = 0 - CSIM_MAXNODE-1
+ * @return	: index; -1 = table full
+ * ************************************************************************************************************ */
+int cansim_mixload(const char* fname, double load, int nnode, uint32_t seed);
+/* @brief	: Add the msg mix of a gateway log, spread over 'nnode' nodes
+ * @param	: fname = gateway ascii/hex log
+ * @param	: load = bus load (0 - 1) of the mix; 0 = rates as in the log
+ * @param	: seed = for the start phases
+ * @return	: number of ids; -1 = can't read; -2 = no time msgs (rates unknown)
+ * ************************************************************************************************************ */
+void cansim_mixremove(uint32_t id);
+/* @brief	: Take an id out of the mix (e.g. one the node under test sends)
+ * ************************************************************************************************************ */
+void cansim_mixscale(double load);
+/* @brief	: Scale the periods of the mix to a bus load (0 - 1)
+ * ************************************************************************************************************ */
+double cansim_mixload_of(void);
+/* @brief	: Bus load of the mix as set up (0 - 1)
+ * ************************************************************************************************************ */
+void cansim_txerr(uint64_t t0, uint64_t t1, uint32_t ppm);
+/* @brief	: Frames sent by the node under test that start in [t0, t1) fail with chance ppm/1000000
+ * ************************************************************************************************************ */
+void cansim_at(uint64_t t, void (*fn)(void* parg), void* parg);
+/* @brief	: Call 'fn' at time t (ns)
+ * ************************************************************************************************************ */
+void cansim_run(uint64_t tend);
+/* @brief	: Run the simulation up to time 'tend' (ns)
+ * ************************************************************************************************************ */
+uint32_t cansim_tick(void);
+/* @brief	: FreeRTOS tick count now
+ * ************************************************************************************************************ */
+uint64_t cansim_tickns(uint32_t tick);
+/* @brief	: Time (ns) of a tick
+ * ************************************************************************************************************ */
+
+void simrtos_init(void);
+/* @brief	: Forget all tasks and queues (simrtos.c; cansim_init calls this)
+ * ************************************************************************************************************ */
+
+#endif
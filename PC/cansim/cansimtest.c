@@ -0,0 +1,742 @@
+/* *****************************************************************************
+* File Name          : cansimtest.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : cansim: checks of the simulator and of the firmware CAN driver on it
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 -DCANSTATSINCLUDED cansimtest.c cansim.c simrtos.c ../../Ourwares/can_iface.c ../../Ourwares/CanTask.c ../../Ourwares/can_tstamp.c ../../Ourwares/canfilter_setup.c ../gatewaybin/gatewaybin.c ../../Ourwares/hexcodec.c -Istub -I../../Ourwares -I../gatewaybin -o cansimtest
+./cansimtest [test...]
+
+Each test runs in its own process (the driver keeps its control blocks).
+Prints PASS/FAIL for each; exit code is the number that failed.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "cansim.h"
+#include "can_iface.h"
+#include "CanTask.h"
+#include "canfilter_setup.h"
+#include "GatewayTask.h"
+#include "can_tstamp.h"
+
+#define US  1000ull
+#define MS  1000000ull
+
+CAN_HandleTypeDef hcan1;
+struct CAN_CTLBLOCK* pctl0;
+
+static char why[256];
+static int fail(const char* fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	vsnprintf(why, sizeof(why), fmt, ap);
+	va_end(ap);
+	return 1;
+}
+
+/* Frames the node under test sent, in order */
+struct SENT
+{
+	uint32_t id[256];
+	uint64_t tsof[256];
+	uint64_t tend[256];
+	int n;
+};
+static struct SENT sent;
+static void frame(const struct CSIMFRAME* pf, int node, uint64_t tsof, uint64_t tend, void* parg)
+{
+	if ((node != CSIM_NODEDUT) || (sent.n == 256)) return;
+	sent.id[sent.n]   = pf->id;
+	sent.tsof[sent.n] = tsof;
+	sent.tend[sent.n] = tend;
+	sent.n += 1;
+	return;
+}
+
+/* Node under test set up as main.c does CAN1 */
+static void dut(uint32_t its)
+{
+	memset(&hcan1, 0, sizeof(hcan1));
+	hcan1.Init.Prescaler = 12;
+	hcan1.Init.Mode = CAN_MODE_NORMAL;
+	hcan1.Init.SyncJumpWidth = CAN_SJW_1TQ;
+	hcan1.Init.TimeSeg1 = CAN_BS1_5TQ;
+	hcan1.Init.TimeSeg2 = CAN_BS2_1TQ;
+	hcan1.Init.TimeTriggeredMode = ENABLE;
+	hcan1.Init.AutoBusOff = DISABLE;
+	hcan1.Init.AutoWakeUp = DISABLE;
+	hcan1.Init.AutoRetransmission = DISABLE;
+	hcan1.Init.ReceiveFifoLocked = DISABLE;
+	hcan1.Init.TransmitFifoPriority = DISABLE;
+	cansim_init(&hcan1);
+	cansim.pframe = frame;
+	memset(&sent, 0, sizeof(sent));
+
+	pctl0 = can_iface_init(&hcan1, 0, 32, 32);
+	if ((pctl0 == NULL) || (pctl0->ret < 0)) exit(3);
+	HAL_CAN_Init(&hcan1);
+	canfilter_setup_first(0, &hcan1, 15);
+	HAL_CAN_Start(&hcan1);
+	HAL_CAN_ActivateNotification(&hcan1, its);
+	return;
+}
+#define ITALL (CAN_IT_TX_MAILBOX_EMPTY | CAN_IT_RX_FIFO0_MSG_PENDING | CAN_IT_RX_FIFO1_MSG_PENDING | \
+	CAN_IT_ERROR_WARNING | CAN_IT_ERROR_PASSIVE | CAN_IT_BUSOFF | CAN_IT_LAST_ERROR_CODE | CAN_IT_ERROR)
+
+static int put(uint32_t id)
+{
+	struct CANRCVBUF can;
+
+	memset(&can, 0, sizeof(can));
+	can.id  = id;
+	can.dlc = 8;
+	can.cd.ui[0] = 0x55aa55aa;
+	return can_driver_put(pctl0, &can, 4, 0);
+}
+static void putev(void* parg)
+{
+	put((uint32_t)(uintptr_t)parg);
+	return;
+}
+/* A frame from another node, once, at time t */
+static void other(uint32_t id, uint64_t t, int node)
+{
+	struct CSIMFRAME f;
+	int k;
+
+	memset(&f, 0, sizeof(f));
+	f.id  = id;
+	f.dlc = 8;
+	k = cansim_mixadd(&f, 1000000 * MS, t - cansim.t, node);
+	(void)k;
+	return;
+}
+
+/* ======= Tests ========================================================================================= */
+
+/* Frame lengths: all dominant frame by hand; bounds on the rest */
+static int t_framebits(void)
+{
+	struct CSIMFRAME f;
+	uint16_t b;
+	int i;
+
+	memset(&f, 0, sizeof(f));
+	/* SOF..DLC 19 zeros, CRC of zeros is 0: 34 zeros, a stuff bit after each 5 */
+	b = cansim_framebits(&f);
+	if (b != 34 + 6 + 10) return fail("std id 0, dlc 0: %u bits, expect 50", b);
+
+	srand(1);
+	for (i = 0; i < 10000; i++)
+	{
+		f.dlc = 8;
+		f.id  = (uint32_t)rand() << 21;
+		memcpy(f.uc, &i, sizeof(i));
+		f.uc[5] = rand();
+		b = cansim_framebits(&f);
+		if ((b < 111) || (b > 135)) return fail("std dlc 8 %08x: %u bits", f.id, b);
+		f.id = ((uint32_t)rand() << 3) | CAN_ID_EXT;
+		b = cansim_framebits(&f);
+		if ((b < 131) || (b > 160)) return fail("ext dlc 8 %08x: %u bits", f.id, b);
+	}
+	return 0;
+}
+/* Arbitration order: lower id; std before ext with the same 11 bits; data before remote */
+static int t_key(void)
+{
+	if (!(cansim_key(0x46400000) < cansim_key(0x46600000))) return fail("lower id");
+	if (!(cansim_key(0x46400000) < cansim_key(0x46400000 | CAN_ID_EXT))) return fail("std vs ext");
+	if (!(cansim_key(0x46400000) < cansim_key(0x46400000 | CAN_RTR_REMOTE))) return fail("data vs remote");
+	if (!(cansim_key(0x46400000 | CAN_ID_EXT | CAN_RTR_REMOTE) < cansim_key(0x46400008 | CAN_ID_EXT)))
+		return fail("ext remote vs next ext");
+	return 0;
+}
+/* Driver sends its pool lowest id first; loopback copies are time stamped with their SOFs */
+static int t_txorder(void)
+{
+	struct CANTAKEPTR* ptake;
+	struct CANRCVBUFN* pn;
+	struct CANIFACESTATS st;
+	static const uint32_t id[4] = {0x7E000000, 0x46800000, 0x46600000, 0x46400000};
+	uint32_t toa0 = 0;
+	int32_t d;
+	int i;
+
+	dut(ITALL);
+	ptake = can_iface_add_take(pctl0);
+	other(0x00200000, 1 * MS, 0); // Bus busy while they are put
+	for (i = 0; i < 4; i++)
+		cansim_at(1 * MS + 20 * US, putev, (void*)(uintptr_t)id[i]);
+	cansim_run(10 * MS);
+
+	if (sent.n != 4) return fail("%d sent, expect 4", sent.n);
+	/* 7E000000 went to the mailbox first; each lower id after it aborted it */
+	for (i = 0; i < 4; i++)
+		if (sent.id[i] != id[3 - i]) return fail("frame %d is %08x, expect %08x", i, sent.id[i], id[3 - i]);
+	can_iface_stats_get(pctl0, &st);
+	if (st.txct != 4) return fail("stats txct %u", st.txct);
+	if (st.txabortct != 3) return fail("stats txabortct %u, expect 3", st.txabortct);
+	if (st.txpendmax != 4) return fail("stats txpendmax %u", st.txpendmax);
+
+	for (i = 0; i < 5; i++)
+	{
+		pn = can_iface_get_CANmsg(ptake);
+		if (pn == NULL) return fail("loopback %d missing", i);
+		if (i == 0)
+		{
+			if (pn->can.id != 0x00200000) return fail("rx %08x", pn->can.id);
+			continue;
+		}
+		if (pn->can.id != sent.id[i - 1]) return fail("loopback %d id %08x", i, pn->can.id);
+		/* Time between SOFs as on the bus, to a bit */
+		if (i == 1) toa0 = pn->toa;
+		d = (int32_t)(pn->toa - toa0) - (int32_t)((sent.tsof[i - 1] - sent.tsof[0]) * 21 / 125);
+		if ((d < -340) || (d > 340)) return fail("loopback %d toa off by %d DTW", i, d);
+		/* and to the SOF itself, within the stuff bits (can_tstamp.h) */
+		d = (int32_t)(pn->toa - (uint32_t)(sent.tsof[i - 1] * 21 / 125));
+		if ((d < -340) || (d > 25 * 336)) return fail("loopback %d toa %d DTW after the SOF", i, d);
+	}
+	if (can_iface_get_CANmsg(ptake) != NULL) return fail("extra msgs");
+	return 0;
+}
+/* Lost arbitration with NART: driver loads the mailbox again */
+static int t_alst(void)
+{
+	dut(ITALL);
+	other(0x00100000, 1 * MS, 0);  // Bus busy while both are made ready
+	other(0x00200000, 1 * MS + 20 * US, 1);
+	cansim_at(1 * MS + 20 * US, putev, (void*)(uintptr_t)0x46400000);
+	cansim_run(5 * MS);
+	if (cansim.bx.alstct != 1) return fail("alstct %lu, expect 1", (unsigned long)cansim.bx.alstct);
+	if (pctl0->can_errors.can_tx_alst0_err != 1) return fail("driver alst count %u", pctl0->can_errors.can_tx_alst0_err);
+	if ((sent.n != 1) || (sent.id[0] != 0x46400000)) return fail("not sent after arbitration loss");
+	return 0;
+}
+/* 16 bit list filter to FIFO1; the rest nowhere */
+static int t_filter(void)
+{
+	CAN_FilterTypeDef f;
+	struct CANTAKEPTR* ptake;
+	struct CANRCVBUFN* pn;
+
+	dut(ITALL);
+	memset(&f, 0, sizeof(f));
+	f.FilterBank = 0;
+	f.FilterMode = CAN_FILTERMODE_IDLIST;
+	f.FilterScale = CAN_FILTERSCALE_16BIT;
+	f.FilterIdLow = (0x232 << 5);
+	f.FilterIdHigh = (0x233 << 5);
+	f.FilterMaskIdLow = (0x234 << 5);
+	f.FilterMaskIdHigh = (0x235 << 5);
+	f.FilterFIFOAssignment = CAN_FILTER_FIFO1;
+	f.FilterActivation = CAN_FILTER_ENABLE;
+	HAL_CAN_ConfigFilter(&hcan1, &f);
+	ptake = can_iface_add_take(pctl0);
+	other(0x233u << 21, 1 * MS, 0);
+	other(0x236u << 21, 2 * MS, 0);
+	other((0x233u << 21) | CAN_ID_EXT, 3 * MS, 1);
+	cansim_run(5 * MS);
+	pn = can_iface_get_CANmsg(ptake);
+	if ((pn == NULL) || (pn->can.id != (0x233u << 21))) return fail("233 not received");
+	if (can_iface_get_CANmsg(ptake) != NULL) return fail("filter passed another");
+	if (cansim.bx.rxnofilt != 2) return fail("rxnofilt %lu", (unsigned long)cansim.bx.rxnofilt);
+	return 0;
+}
+/* No RX interrupt: the 4th msg goes over the 3rd */
+static int t_overrun(void)
+{
+	int i;
+
+	dut(CAN_IT_TX_MAILBOX_EMPTY);
+	for (i = 0; i < 4; i++)
+		other((0x100u + i) << 21, (1 + i) * MS, 0);
+	cansim_run(10 * MS);
+	if ((cansim.bx.fn[0] != 3) || (cansim.bx.rxovr[0] != 1)) return fail("fifo %u, overruns %lu", cansim.bx.fn[0], (unsigned long)cansim.bx.rxovr[0]);
+	if (cansim.bx.fifo[0][2].id != (0x103u << 21)) return fail("last in fifo %08x", cansim.bx.fifo[0][2].id);
+	return 0;
+}
+/* Bus load of the log mix as scaled */
+static int t_mixload(void)
+{
+	uint64_t tend = 2000 * MS;
+	double l;
+
+	dut(ITALL);
+	if (cansim_mixload("../../docs/data/log200220-2.txt", 0.5, 4, 7) < 10) return fail("log not read");
+	cansim_run(tend);
+	l = (double)cansim.busybits * cansim.bit / tend;
+	if ((l < 0.47) || (l > 0.53)) return fail("bus load %.3f, expect 0.5", l);
+	return 0;
+}
+
+/* ======= Time stamps (user-028) ======================================================================== */
+/* can_tstamp by itself, 500K and 168 MHz: SOFs a few ms apart with gaps up
+   to 300 s, so the 16 bit counter, DTW (25.6 s) and the tick path (over
+   CANTSTAMPTICKMAX) all wrap or get used.  Frames are the shortest for the
+   id type and dlc plus 1 - 21 bits (stuff bits, last EOF bit), interrupt 0 -
+   8 us after the frame. */
+static int t_tstamp(void)
+{
+	struct CANTSTAMP ts;
+	uint64_t rng = 1;
+	uint64_t tb = 2500;          // SOF in bit times
+	uint64_t tirq;               // ns
+	uint64_t off = 0;
+	uint32_t r, r2, minb, bits, toa;
+	int32_t err, errmin = 0, errmax = 0;
+	double errsum = 0;
+	int i, nlong = 0, ndtw = 0;
+	const uint64_t phase = 777;  // ns, bit counter vs DTW
+
+	can_tstamp_init(&ts, 336, 328125);
+	for (i = 0; i < 400000; i++)
+	{
+		rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+		r = (uint32_t)(rng >> 32);
+		minb = CANTSTAMPMINBITS((r & 1), 0, (r >> 1) % 9);
+		bits = minb + 1 + (r >> 5) % 21;
+		tirq = (tb + bits) * 2000 + phase + (r >> 10) % 8000;
+		toa = can_tstamp_extend(&ts, (uint16_t)tb, (uint32_t)(tirq * 21 / 125), (uint32_t)(tirq / 1953125), minb);
+
+		if (i == 0) off = ts.ext - tb;
+		else if (ts.ext - tb != off)
+			return fail("stamp %d (%.3f s): extended count off by %ld bits", i, tb * 2E-6, (long)(ts.ext - tb - off));
+		err = (int32_t)(toa - (uint32_t)((tb * 2000 + phase) * 21 / 125));
+		if (i > 0)
+		{
+			if (err < errmin) errmin = err;
+			if (err > errmax) errmax = err;
+			errsum += err;
+		}
+
+		/* Next SOF: after 3 bits intermission, mostly soon, now and then after a long gap */
+		tb += bits + 1 + 3 + (r >> 14) % 2500;
+		r2 = (uint32_t)(rng >> 16) % 20000;
+		if (r2 == 0)
+		{ // Over CANTSTAMPTICKMAX: tick path
+			tb += 5000000 + (uint64_t)(r % 1000) * 150000;
+			nlong += 1;
+		}
+		else if (r2 == 1)
+		{ // 0.1 - 7.9 s: DTW path, many 16 bit wraps
+			tb += 50000 + (uint64_t)(r % 1000) * 3900;
+			ndtw += 1;
+		}
+	}
+	printf("    tstamp: %.0f s, %d gaps over %d ticks, %d of 0.1-8 s; SOF error %.2f..%.2f us, mean %.2f\n",
+		tb * 2E-6, nlong, CANTSTAMPTICKMAX, ndtw, errmin / 168.0, errmax / 168.0, errsum / (i - 1) / 168.0);
+	if ((nlong < 5) || (ndtw < 5)) return fail("test did not make the gaps");
+	/* Late by the stuff bits and latency of the stamp that last moved the
+	   estimate (under 22 bits + 8 us); early by under a bit (counter phase) */
+	if (errmin < -336) return fail("SOF early by %d DTW", -errmin);
+	if (errmax > 22 * 336 + 8 * 168) return fail("SOF late by %d DTW", errmax);
+	return 0;
+}
+
+/* Driver RX time stamps against the bus: 3 msgs every 5 ms over 40 s (DTW
+   wraps at 25.6 s), with 12 s of silence (tick path) */
+struct RXSOF
+{
+	uint64_t tsof[4096];
+	uint32_t id[4096];
+	uint32_t put, get;
+	struct CANTAKEPTR* ptake;
+	int32_t errmin, errmax;
+	uint32_t n;
+	int bad;
+};
+static struct RXSOF rs;
+static void rxsofframe(const struct CSIMFRAME* pf, int node, uint64_t tsof, uint64_t tend, void* parg)
+{
+	if (node == CSIM_NODEDUT) return;
+	rs.tsof[rs.put & 4095] = tsof;
+	rs.id[rs.put & 4095]   = pf->id;
+	rs.put += 1;
+	return;
+}
+static void rxsofdrain(void* parg)
+{
+	struct CANRCVBUFN* pn;
+	int32_t err;
+
+	while ((pn = can_iface_get_CANmsg(rs.ptake)) != NULL)
+	{
+		if ((rs.get == rs.put) || (pn->can.id != rs.id[rs.get & 4095])) { rs.bad += 1; return; }
+		err = (int32_t)(pn->toa - (uint32_t)(rs.tsof[rs.get & 4095] * 21 / 125));
+		rs.get += 1;
+		if (err < rs.errmin) rs.errmin = err;
+		if (err > rs.errmax) rs.errmax = err;
+		rs.n += 1;
+	}
+	cansim_at(cansim.t + 10 * MS, rxsofdrain, NULL);
+	return;
+}
+static void rxsofquiet(void* parg)
+{
+	int i;
+	for (i = 0; i < cansim.nmix; i++)
+		cansim.mix[i].next = 32000 * MS + i * 100 * US;
+	return;
+}
+static int t_tstamprx(void)
+{
+	struct CSIMFRAME f;
+	int i;
+
+	dut(ITALL);
+	memset(&rs, 0, sizeof(rs));
+	cansim.pframe = rxsofframe;
+	rs.ptake = can_iface_add_take(pctl0);
+	memset(&f, 0, sizeof(f));
+	for (i = 0; i < 3; i++)
+	{
+		f.id  = (i == 1) ? (0x12345678 & ~7u) | CAN_ID_EXT : (0x300u + i) << 21;
+		f.dlc = (i == 2) ? 0 : 8;
+		f.uc[0] = 0xff; f.uc[3] = 0x0f;
+		cansim_mixadd(&f, 5 * MS, 1 * MS + i * 300 * US, i);
+	}
+	cansim_at(20 * MS, rxsofdrain, NULL);
+	cansim_at(20000 * MS, rxsofquiet, NULL);
+	cansim_run(40000 * MS);
+	rxsofdrain(NULL);
+
+	printf("  tstamprx: %u msgs, SOF error %.2f..%.2f us, %u estimate moves\n",
+		rs.n, rs.errmin / 168.0, rs.errmax / 168.0, pctl0->tstamp.bumpct);
+	if ((rs.bad != 0) || (rs.n < 16000)) return fail("%u msgs, %d out of order", rs.n, rs.bad);
+	/* Sim interrupts at the end of EOF: 1 bit past the bound plus stuff bits */
+	if ((rs.errmin < -336) || (rs.errmax > 25 * 336)) return fail("SOF error %d..%d DTW", rs.errmin, rs.errmax);
+	return 0;
+}
+
+/* ======= Rate limit (user-027) ========================================================================= */
+/* Slow rate, a put every tick: the refill fractions must add up (3/s is 1.5/256 token per tick) */
+static int t_ratefrac(void)
+{
+	struct CANRATEBUCKET* pb;
+	uint32_t tk;
+	double r;
+
+	dut(ITALL);
+	if (can_iface_ratelimit_add(pctl0, 0x70000000, 0xffe00000, 3, 1, CANRATE_DROP) != 0) return fail("add");
+	for (tk = 1; tk <= 512 * 20; tk++)
+	{
+		cansim_run(cansim_tickns(tk) + 1);
+		put(0x70000000);
+	}
+	pb = &pctl0->prate->bkt[0];
+	r = (pb->passct - 1) / 20.0; // Less the one the bucket started with
+	if ((r < 2.95) || (r > 3.05)) return fail("%.2f msgs/s, expect 3 (pass %u drop %u)", r, pb->passct, pb->dropct);
+	return 0;
+}
+
+/* Flood through the CanTxTask queue (as GatewayTask does PC->CAN) of an id
+   that outranks the DMOC commands, which go by xCanTxDirect at 64/s */
+struct FLOOD
+{
+	uint64_t tput[3];
+	uint64_t latmax;
+	uint32_t lost;
+	uint32_t nput;
+};
+static struct FLOOD fl;
+static const uint32_t dmocid[3] = {0x46400000, 0x46600000, 0x46800000};
+static void floodframe(const struct CSIMFRAME* pf, int node, uint64_t tsof, uint64_t tend, void* parg)
+{
+	int i;
+	for (i = 0; i < 3; i++)
+	{
+		if ((node != CSIM_NODEDUT) || (pf->id != dmocid[i]) || (fl.tput[i] == 0)) continue;
+		if ((tend - fl.tput[i]) > fl.latmax) fl.latmax = tend - fl.tput[i];
+		fl.tput[i] = 0;
+	}
+	return;
+}
+static void StartDmocTask(void const* argument)
+{
+	struct CANTXQMSG txq;
+	int i;
+
+	memset(&txq, 0, sizeof(txq));
+	txq.pctl = pctl0;
+	txq.maxretryct = 8;
+	txq.can.dlc = 8;
+	for (;;)
+	{
+		for (i = 0; i < 3; i++)
+		{
+			if (fl.tput[i] != 0) fl.lost += 1; // Previous one never went out
+			txq.can.id = dmocid[i];
+			fl.tput[i] = (xCanTxDirect(&txq) < 0) ? 0 : cansim.t;
+			fl.nput += 1;
+		}
+		vTaskDelay(configTICK_RATE_HZ / 64);
+	}
+}
+static void StartFloodTask(void const* argument)
+{
+	struct CANTXQMSG txq;
+
+	memset(&txq, 0, sizeof(txq));
+	txq.pctl = pctl0;
+	txq.maxretryct = 8;
+	txq.can.id  = 0x10000000;
+	txq.can.dlc = 8;
+	for (;;)
+	{
+		while (xQueueSendToBack(CanTxQHandle, &txq, 0) == pdPASS);
+		vTaskDelay(1);
+	}
+}
+static void flood(int guard)
+{
+	int i;
+
+	dut(ITALL);
+	cansim.pframe = floodframe;
+	memset(&fl, 0, sizeof(fl));
+	if (guard != 0)
+	{ // As main.c and gevcu_func_init.c
+		can_iface_ratelimit_add(pctl0, 0, 0, GATECAN1RATE, GATECAN1BURST, CANRATE_DEFER);
+		for (i = 0; i < 3; i++)
+			can_iface_ratelimit_add(pctl0, dmocid[i], 0xffe00000, 0, 0, CANRATE_DEFER);
+	}
+	xCanTxTaskCreate(2, 64);
+	{
+		osThreadDef(DmocTask, StartDmocTask, osPriorityNormal, 0, 128);
+		vTaskPrioritySet(osThreadCreate(osThread(DmocTask), NULL), 2);
+		osThreadDef(FloodTask, StartFloodTask, osPriorityNormal, 0, 128);
+		vTaskPrioritySet(osThreadCreate(osThread(FloodTask), NULL), 2);
+	}
+	cansim_mixload("../../docs/data/log200220-2.txt", 0.4, 4, 3);
+	for (i = 0; i < 3; i++)
+		cansim_mixremove(dmocid[i]);
+	cansim_mixscale(0.4);
+	cansim_run(5000 * MS);
+	return;
+}
+static int t_flood(void)
+{
+	struct FLOOD nog;
+	double r;
+	int fd[2];
+	pid_t pid;
+
+	/* Without the guard first, in its own process (the driver keeps its control blocks) */
+	memset(&nog, 0, sizeof(nog));
+	if (pipe(fd) != 0) return fail("pipe");
+	pid = fork();
+	if (pid == 0)
+	{
+		flood(0);
+		if (write(fd[1], &fl, sizeof(fl)) < 0) _exit(1);
+		_exit(0);
+	}
+	if (read(fd[0], &nog, sizeof(nog)) != sizeof(nog)) return fail("no guard run crashed");
+	waitpid(pid, NULL, 0);
+	close(fd[0]);
+	close(fd[1]);
+
+	flood(1);
+	r = (double)pctl0->prate->bkt[0].passct / 5;
+	printf("     flood: no guard: DMOC max %.2f ms, %u of %u lost; guard: max %.2f ms, %u lost, flood %.0f msgs/s\n",
+		nog.latmax * 1E-6, nog.lost, nog.nput, fl.latmax * 1E-6, fl.lost, r);
+	if ((fl.lost != 0) || (fl.latmax > 3 * MS)) return fail("guard: DMOC max %.2f ms, %u lost", fl.latmax * 1E-6, fl.lost);
+	if ((r < GATECAN1RATE * 0.98) || (r > GATECAN1RATE * 1.02 + GATECAN1BURST)) return fail("flood %.0f msgs/s", r);
+	return 0;
+}
+
+/* ======= Error states (user-030) ======================================================================= */
+/* Every frame the node under test sends fails for 4 s: error warning,
+   passive, bus-off; CanTxTask restarts it after the backoff, which doubles
+   for each bus-off that follows soon after a restart, up to CANBACKOFFMAX.
+   CANPOOL_FLUSH refuses msgs while bus-off.  Then the errors stop. */
+struct ERRST
+{
+	uint8_t  seq[16];      // First states, repeats left out
+	int      nseq;
+	uint8_t  state;
+	uint32_t backoff[32];  // 'backoff' at each bus-off entry
+	uint32_t tboff[32];    // Tick of each bus-off entry
+	uint32_t trestart[32]; // Tick of each restart
+	int      nboff, nrestart;
+	uint32_t put, refused;
+};
+static struct ERRST es;
+static void errsample(void* parg)
+{
+	struct CANERRSTATE* pe = &pctl0->errst;
+
+	if (pe->state != es.state)
+	{
+		if (es.nseq < 16) es.seq[es.nseq++] = pe->state;
+		if ((pe->state == CANERR_BUSOFF) && (es.nboff < 32))
+		{
+			es.backoff[es.nboff] = pe->backoff;
+			es.tboff[es.nboff++] = pe->tbusoff;
+		}
+		if ((pe->state == CANERR_RECOVER) && (es.nrestart < 32))
+			es.trestart[es.nrestart++] = pe->tbusexit;
+		es.state = pe->state;
+	}
+	cansim_at(cansim.t + 20 * US, errsample, NULL);
+	return;
+}
+static void errput(void* parg)
+{
+	int ret = put(0x46400000);
+	es.put += 1;
+	if (ret == -7) es.refused += 1;
+	cansim_at(cansim.t + 1 * MS, errput, NULL);
+	return;
+}
+static void errstate(int sce)
+{
+	dut(ITALL);
+	cansim.sce = sce;
+	can_iface_errstate_config(pctl0, CANPOOL_FLUSH, CANBACKOFFMIN, CANBACKOFFMAX);
+	xCanTxTaskCreate(2, 64);
+	memset(&es, 0, sizeof(es));
+	cansim_at(1 * MS, errsample, NULL);
+	cansim_at(1 * MS, errput, NULL);
+	cansim_txerr(10 * MS, 4000 * MS, 1000000);
+	cansim_run(5000 * MS);
+	return;
+}
+static int t_errstate(void)
+{
+	struct CANERRSTATE* pe;
+	uint32_t b;
+	uint32_t lecpoll;
+	int i;
+	int fd[2];
+	pid_t pid;
+
+	/* Without the SCE vector (as before) the TX error interrupts and the
+	   CanTxTask poll still find bus-off, but protocol errors go uncounted */
+	if (pipe(fd) != 0) return fail("pipe");
+	pid = fork();
+	if (pid == 0)
+	{
+		errstate(0);
+		if (write(fd[1], &pctl0->errst.lecct, sizeof(uint32_t)) < 0) _exit(1);
+		_exit(0);
+	}
+	lecpoll = UINT32_MAX;
+	if (read(fd[0], &lecpoll, sizeof(lecpoll)) < 0) lecpoll = UINT32_MAX;
+	waitpid(pid, NULL, 0);
+	close(fd[0]);
+	close(fd[1]);
+
+	errstate(1);
+	pe = &pctl0->errst;
+	printf("  errstate: protocol errors counted %u (SCE), %u (no SCE); %u bus-offs, backoff",
+		pe->lecct, lecpoll, pe->busoffct);
+	for (i = 0; i < es.nboff; i++)
+		printf(" %u", es.backoff[i]);
+	printf("; %u of %u puts refused\n", es.refused, es.put);
+
+	if ((es.nseq < 4) || (es.seq[0] != CANERR_WARNING) || (es.seq[1] != CANERR_PASSIVE) ||
+		 (es.seq[2] != CANERR_BUSOFF) || (es.seq[3] != CANERR_RECOVER))
+		return fail("states %u %u %u %u, expect warning, passive, bus-off, recover", es.seq[0], es.seq[1], es.seq[2], es.seq[3]);
+	if ((pe->warningct == 0) || (pe->passivect == 0) || (pe->lecct == 0)) return fail("counts warning %u passive %u lec %u", pe->warningct, pe->passivect, pe->lecct);
+	if (lecpoll != 0) return fail("%u protocol errors counted without the SCE interrupt", lecpoll);
+	if (es.nboff < 8) return fail("%d bus-offs", es.nboff);
+
+	/* Backoff: CANBACKOFFMIN, doubling to CANBACKOFFMAX; restart at the end of it (polled) */
+	b = CANBACKOFFMIN;
+	for (i = 0; i < es.nboff; i++)
+	{
+		if (es.backoff[i] != b) return fail("bus-off %d: backoff %u, expect %u", i, es.backoff[i], b);
+		if (i < es.nrestart)
+		{
+			if ((es.trestart[i] - es.tboff[i]) < b) return fail("bus-off %d: restart after %u ticks, backoff %u", i, es.trestart[i] - es.tboff[i], b);
+			if ((es.trestart[i] - es.tboff[i]) > b + 8 + 1) return fail("bus-off %d: restart after %u ticks, backoff %u", i, es.trestart[i] - es.tboff[i], b);
+		}
+		if ((b * 2) <= CANBACKOFFMAX) b *= 2;
+	}
+	if ((es.refused == 0) || (pe->flushct == 0)) return fail("CANPOOL_FLUSH: %u refused, %u flushed", es.refused, pe->flushct);
+
+	/* Errors stopped at 4 s: back on the bus and sending */
+	if (pe->state != CANERR_ACTIVE) return fail("state %u at the end", pe->state);
+	if (pe->restartct != pe->busoffct) return fail("%u restarts, %u bus-offs", pe->restartct, pe->busoffct);
+	if (cansim.bx.txct < 500) return fail("%lu sent after the errors", (unsigned long)cansim.bx.txct);
+	return 0;
+}
+
+struct TEST
+{
+	const char* name;
+	int (*fn)(void);
+};
+static const struct TEST test[] =
+{
+	{"framebits", t_framebits},
+	{"key",       t_key},
+	{"txorder",   t_txorder},
+	{"alst",      t_alst},
+	{"filter",    t_filter},
+	{"overrun",   t_overrun},
+	{"mixload",   t_mixload},
+	{"tstamp",    t_tstamp},
+	{"tstamprx",  t_tstamprx},
+	{"ratefrac",  t_ratefrac},
+	{"flood",     t_flood},
+	{"errstate",  t_errstate},
+};
+#define NTEST (int)(sizeof(test) / sizeof(test[0]))
+
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	int nfail = 0;
+	int st;
+	int i, j;
+	int fd[2];
+	pid_t pid;
+	ssize_t n;
+
+	for (i = 0; i < NTEST; i++)
+	{
+		if (argc > 1)
+		{
+			for (j = 1; j < argc; j++)
+				if (strcmp(argv[j], test[i].name) == 0) break;
+			if (j == argc) continue;
+		}
+		if (pipe(fd) != 0) return 1;
+		fflush(stdout);
+		pid = fork();
+		if (pid == 0)
+		{
+			close(fd[0]);
+			why[0] = 0;
+			st = test[i].fn();
+			fflush(stdout);
+			if (write(fd[1], why, strlen(why)) < 0) _exit(1);
+			_exit(st);
+		}
+		close(fd[1]);
+		memset(why, 0, sizeof(why));
+		n = read(fd[0], why, sizeof(why) - 1);
+		close(fd[0]);
+		waitpid(pid, &st, 0);
+		if ((n >= 0) && WIFEXITED(st) && (WEXITSTATUS(st) == 0))
+			printf("PASS %s\n", test[i].name);
+		else
+		{
+			nfail += 1;
+			printf("FAIL %s: %s\n", test[i].name, (why[0] != 0) ? why : "crashed");
+		}
+	}
+	return nfail;
+}
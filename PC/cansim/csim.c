@@ -0,0 +1,292 @@
+/* *****************************************************************************
+* File Name          : csim.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : cansim: CAN driver latency, throughput, priority inversion vs bus load
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 -DCANSTATSINCLUDED csim.c cansim.c simrtos.c ../../Ourwares/can_iface.c ../../Ourwares/CanTask.c ../../Ourwares/can_tstamp.c ../../Ourwares/canfilter_setup.c ../gatewaybin/gatewaybin.c ../../Ourwares/hexcodec.c -Istub -I../../Ourwares -I../gatewaybin -o csim
+./csim ../../docs/data/log200220-2.txt [direct|queue] [secs] [load...]
+
+The other nodes send the msg mix of the gateway log, scaled to each bus
+load in turn (default 0.2 - 0.95), spread over 4 nodes that send lowest id
+first.  The node under test runs the firmware driver (can_iface.c) and
+CanTxTask (CanTask.c) with the main.c setup for CAN1.  Its app task sends
+the three DMOC commands (ids 46400000, 46600000, 46800000) 64 times a
+second; a lower priority task sends bursts of 8 low priority msgs (id
+7E000000) every 37 ticks.  Both send either with 'xCanTxDirect' or through
+the CanTxTask queue.
+
+Latency is from the send call to the end of the frame on the bus.
+Inversion: a frame that won the bus while the driver held a higher
+priority msg not yet in the mailbox.  'late' is releases of the other
+nodes that had to wait past their next one.
+
+Direct vs queue (user-029), log200220-2.txt, 20 s each, ctxsw 2 us--
+                 direct               queue
+ load  bus    p50    p99    max    p50    p99    max   (DMOC latency, us)
+ 0.20 0.28  490.0  961.8 1265.1  492.0  961.9 1265.1
+ 0.40 0.48  490.0 1066.1 1354.9  492.0 1072.5 1354.9
+ 0.60 0.68  563.0 1107.8 1350.9  564.1 1107.8 1350.9
+ 0.70 0.77  598.0 1161.4 1388.2  598.8 1161.4 1388.2
+ 0.80 0.87  620.6 1214.8 1375.5  623.1 1214.8 1375.5
+ 0.90 0.96  641.0 1248.6 1389.8  644.6 1253.3 1389.8
+ 0.95 0.99  646.5 1264.9 1386.8  647.3 1267.5 1386.8
+The direct path saves the switch to CanTxTask (and, on the board, the two
+queue copies), about 2 us of a p50 that is mostly waiting for the bus.
+Inversions are 0 both ways; the max is set by the frames already on the
+bus and the lower ids of the other nodes, not by the path.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "cansim.h"
+#include "can_iface.h"
+#include "CanTask.h"
+#include "canfilter_setup.h"
+
+#define NODES    4
+#define LATMAX   65536
+
+CAN_HandleTypeDef hcan1;
+struct CAN_CTLBLOCK* pctl0;
+
+static const uint32_t dmocid[3] = {0x46400000, 0x46600000, 0x46800000};
+#define BULKID   0x7E000000
+#define BULKN    8
+#define BULKTICKS 37 // Not a multiple of the DMOC period
+
+struct LAT
+{
+	uint64_t tput[4][64];  // Send time, ring per id (3 DMOC, bulk)
+	uint8_t  nput[4];
+	uint8_t  nend[4];
+	uint32_t lat[LATMAX];  // DMOC latencies (ns / 100)
+	int nlat;
+	uint64_t latbulk;      // Sum of bulk latencies
+	uint32_t nbulk;
+	uint64_t senderr;      // xCanTxDirect/queue refusals
+};
+static struct LAT lt;
+static int usequeue;
+
+static int latidx(uint32_t id)
+{
+	int i;
+	if (id == BULKID) return 3;
+	for (i = 0; i < 3; i++)
+		if (id == dmocid[i]) return i;
+	return -1;
+}
+static void frame(const struct CSIMFRAME* pf, int node, uint64_t tsof, uint64_t tend, void* parg)
+{
+	int k;
+	uint64_t l;
+
+	if (node != CSIM_NODEDUT) return;
+	k = latidx(pf->id);
+	if ((k < 0) || (lt.nend[k] == lt.nput[k])) return;
+	l = tend - lt.tput[k][lt.nend[k] & 63];
+	lt.nend[k] += 1;
+	if (k == 3)
+	{
+		lt.latbulk += l;
+		lt.nbulk   += 1;
+	}
+	else if (lt.nlat < LATMAX)
+		lt.lat[lt.nlat++] = l / 100;
+	return;
+}
+/* Lowest id in the driver pool, not counting what is in a mailbox */
+static int dutpend(uint32_t* pid)
+{
+	volatile struct CAN_POOLBLOCK* p;
+	int i;
+
+	for (p = pctl0->pend.plinknext; p != NULL; p = p->plinknext)
+	{
+		for (i = 0; i < CSIM_NMBX; i++)
+			if ((cansim.bx.mbx[i].state != 0) && (cansim.bx.mbx[i].f.id == (p->can.id & ~1u))) break;
+		if (i < CSIM_NMBX) continue;
+		*pid = p->can.id;
+		return 1;
+	}
+	return 0;
+}
+static void send(uint32_t id)
+{
+	struct CANTXQMSG txq;
+	int k = latidx(id);
+
+	memset(&txq, 0, sizeof(txq));
+	txq.pctl = pctl0;
+	txq.can.id  = id;
+	txq.can.dlc = 8;
+	if (((uint8_t)(lt.nput[k] - lt.nend[k])) >= 64) lt.nend[k] += 1; // Ring full: oldest forgotten
+	lt.tput[k][lt.nput[k] & 63] = cansim.t;
+	lt.nput[k] += 1;
+	if (usequeue != 0)
+	{
+		if (xQueueSendToBack(CanTxQHandle, &txq, 0) != pdPASS)
+		{
+			lt.senderr += 1;
+			lt.nput[k] -= 1;
+		}
+		return;
+	}
+	if (xCanTxDirect(&txq) < 0)
+	{
+		lt.senderr += 1;
+		lt.nput[k] -= 1;
+	}
+	return;
+}
+static void StartAppTask(void const* argument)
+{
+	int i;
+
+	for (;;)
+	{
+		for (i = 0; i < 3; i++)
+			send(dmocid[i]);
+		vTaskDelay(configTICK_RATE_HZ / 64);
+	}
+}
+static void StartBulkTask(void const* argument)
+{
+	int i;
+
+	for (;;)
+	{
+		for (i = 0; i < BULKN; i++)
+			send(BULKID);
+		vTaskDelay(BULKTICKS);
+	}
+}
+static int ucmp(const void* pa, const void* pb)
+{
+	uint32_t a = *(const uint32_t*)pa, b = *(const uint32_t*)pb;
+	return (a > b) - (a < b);
+}
+
+static void run(const char* flog, double load, double secs)
+{
+	struct CANIFACESTATS st;
+	uint64_t late = 0;
+	uint64_t tend = (uint64_t)(secs * 1E9);
+	int i;
+
+	memset(&hcan1, 0, sizeof(hcan1));
+	hcan1.Init.Prescaler = 12;
+	hcan1.Init.Mode = CAN_MODE_NORMAL;
+	hcan1.Init.SyncJumpWidth = CAN_SJW_1TQ;
+	hcan1.Init.TimeSeg1 = CAN_BS1_5TQ;
+	hcan1.Init.TimeSeg2 = CAN_BS2_1TQ;
+	hcan1.Init.TimeTriggeredMode = ENABLE;
+	hcan1.Init.AutoBusOff = DISABLE;
+	hcan1.Init.AutoWakeUp = DISABLE;
+	hcan1.Init.AutoRetransmission = DISABLE;
+	hcan1.Init.ReceiveFifoLocked = DISABLE;
+	hcan1.Init.TransmitFifoPriority = DISABLE;
+	cansim_init(&hcan1);
+	cansim.ctxsw = 2000; // ~340 cycles
+	cansim.pframe = frame;
+	cansim.pdutpend = dutpend;
+
+	/* As main.c */
+	pctl0 = can_iface_init(&hcan1, 0, 32, 32);
+	if ((pctl0 == NULL) || (pctl0->ret < 0)) exit(3);
+	xCanTxTaskCreate(2, 64);
+	HAL_CAN_Init(&hcan1);
+	canfilter_setup_first(0, &hcan1, 15);
+	HAL_CAN_Start(&hcan1);
+	HAL_CAN_ActivateNotification(&hcan1,
+		CAN_IT_TX_MAILBOX_EMPTY     |
+		CAN_IT_RX_FIFO0_MSG_PENDING |
+		CAN_IT_RX_FIFO1_MSG_PENDING |
+		CAN_IT_ERROR_WARNING        |
+		CAN_IT_ERROR_PASSIVE        |
+		CAN_IT_BUSOFF               |
+		CAN_IT_LAST_ERROR_CODE      |
+		CAN_IT_ERROR                   );
+	{
+		osThreadDef(AppTask, StartAppTask, osPriorityNormal, 0, 128);
+		osThreadCreate(osThread(AppTask), NULL);
+		osThreadDef(BulkTask, StartBulkTask, osPriorityBelowNormal, 0, 128);
+		osThreadCreate(osThread(BulkTask), NULL);
+	}
+
+	if (cansim_mixload(flog, load, NODES, 12345) < 0) exit(4);
+	for (i = 0; i < 3; i++)
+		cansim_mixremove(dmocid[i]);
+	cansim_mixremove(BULKID);
+	cansim_mixscale(load);
+
+	can_iface_stats_reset(pctl0);
+	cansim_run(tend);
+	can_iface_stats_get(pctl0, &st);
+
+	for (i = 0; i < cansim.nmix; i++)
+		late += cansim.mix[i].late;
+	qsort(lt.lat, lt.nlat, sizeof(uint32_t), ucmp);
+	if (lt.nlat == 0) lt.nlat = 1;
+	printf("%5.2f %5.2f %7lu %7.1f %7.1f %7.1f %7.1f %8.1f %5lu %6lu %5u %4u %5lu %6lu %4lu\n",
+		cansim_mixload_of(), (double)cansim.busybits * cansim.bit / tend,
+		(unsigned long)cansim.bx.txct,
+		lt.lat[lt.nlat / 2] / 10.0, lt.lat[lt.nlat * 99 / 100] / 10.0, lt.lat[lt.nlat - 1] / 10.0,
+		(st.txct != 0) ? (st.txlatsum / st.txct) / 168.0 : 0,
+		(lt.nbulk != 0) ? lt.latbulk / lt.nbulk / 1000.0 : 0,
+		(unsigned long)cansim.invct, (unsigned long)(cansim.invns / 1000),
+		st.txabortct, st.txpendmax,
+		(unsigned long)cansim.bx.alstct, (unsigned long)late, (unsigned long)lt.senderr);
+	return;
+}
+
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	static const double loaddef[] = {0.2, 0.4, 0.6, 0.7, 0.8, 0.9, 0.95};
+	double load[32];
+	double secs = 10;
+	int nload = 0;
+	int i;
+	pid_t pid;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s gatewaylog [direct|queue] [secs] [load...]\n", argv[0]);
+		return 1;
+	}
+	if ((argc > 2) && (strcmp(argv[2], "queue") == 0)) usequeue = 1;
+	if (argc > 3) secs = atof(argv[3]);
+	for (i = 4; (i < argc) && (nload < 32); i++)
+		load[nload++] = atof(argv[i]);
+	if (nload == 0)
+	{
+		for (i = 0; i < (int)(sizeof(loaddef) / sizeof(loaddef[0])); i++)
+			load[nload++] = loaddef[i];
+	}
+
+	printf("%s path, %.0f s each; latency us (DMOC p50 p99 max, driver mean, bulk mean)\n",
+		(usequeue != 0) ? "queue" : "direct", secs);
+	printf(" load   bus  dut tx     p50     p99     max  drvmean  bulk  inv  invus abort pmax  alst   late  err\n");
+	fflush(stdout);
+	for (i = 0; i < nload; i++)
+	{ // Driver keeps its control blocks: a fresh process for each
+		pid = fork();
+		if (pid == 0)
+		{
+			run(argv[1], load[i], secs);
+			fflush(stdout);
+			_exit(0);
+		}
+		if (pid > 0) waitpid(pid, NULL, 0);
+	}
+	return 0;
+}
@@ -0,0 +1,347 @@
+/* *****************************************************************************
+* File Name          : simrtos.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : cansim: FreeRTOS tasks, queues, notifications on the simulated clock
+****************************************************************************** */
+/*
+Each task is a coroutine (ucontext) that runs until it blocks; tasks take
+no time except 'cansim.ctxsw' when one is switched in.  The highest
+priority ready task runs, the one ready longest first when they tie.  A
+task is not pre-empted: a higher priority one made ready while it runs
+goes next.  Interrupts (cansim.c) run between these steps.
+
+Timeouts are in ticks of the simulated clock, as the firmware counts them.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ucontext.h>
+#include "cansim.h"
+#include "cmsis_os.h"
+#include "morse.h"
+
+#define SIMSTACK  (256 * 1024)
+#define SIMMAXTSK 16
+#define SIMMAXQ   16
+
+enum
+{
+	TSK_READY,
+	TSK_BLOCK,
+	TSK_SUSPEND,
+	TSK_DEAD
+};
+
+struct SIMTASK
+{
+	ucontext_t uc;
+	void* stack;
+	os_pthread fn;
+	void* arg;
+	UBaseType_t prio;
+	int state;
+	struct SIMQ* pq;      // Blocked on receive from this queue
+	int nwait;            // 1 = blocked in xTaskNotifyWait
+	int npend;            // Notification pending
+	uint32_t nval;        // Notification value
+	uint64_t tmo;         // Time the block ends (0 = none)
+	int timedout;
+	uint64_t rdyseq;      // Order made ready
+	uint64_t runs;        // Times switched in
+};
+
+struct SIMQ
+{
+	uint8_t* p;
+	UBaseType_t len;
+	UBaseType_t size;
+	UBaseType_t n;
+	UBaseType_t head;
+	struct SIMTASK* pwait; // Task blocked on receive
+};
+
+static struct SIMTASK tsk[SIMMAXTSK];
+static int ntsk;
+static struct SIMQ q[SIMMAXQ];
+static int nq;
+static struct SIMTASK* prun;  // Running task; NULL = scheduler/interrupts
+static ucontext_t ucmain;
+static uint64_t rdyseq;
+static int cpuset;            // 1 = a 'cpu' call is in the event list
+
+static void cpu(void* parg);
+
+static void cpusched(void)
+{
+	if ((cpuset != 0) || (prun != NULL)) return;
+	cpuset = 1;
+	cansim_at(cansim.t, cpu, NULL);
+	return;
+}
+static void ready(struct SIMTASK* pt)
+{
+	if (pt->state != TSK_BLOCK) return;
+	pt->state  = TSK_READY;
+	pt->pq     = NULL;
+	pt->nwait  = 0;
+	pt->tmo    = 0;
+	pt->rdyseq = rdyseq++;
+	cpusched();
+	return;
+}
+/* Highest priority ready task switched in, until it blocks */
+static void cpu(void* parg)
+{
+	struct SIMTASK* pt = NULL;
+	int i;
+
+	cpuset = 0;
+	for (i = 0; i < ntsk; i++)
+	{
+		if (tsk[i].state != TSK_READY) continue;
+		if ((pt == NULL) || (tsk[i].prio > pt->prio) ||
+			 ((tsk[i].prio == pt->prio) && (tsk[i].rdyseq < pt->rdyseq)))
+			pt = &tsk[i];
+	}
+	if (pt == NULL) return;
+	if ((parg == NULL) && (cansim.ctxsw != 0))
+	{ // Switch cost first
+		cpuset = 1;
+		cansim_at(cansim.t + cansim.ctxsw, cpu, pt);
+		return;
+	}
+	if ((parg != NULL) && (((struct SIMTASK*)parg)->state != TSK_READY))
+	{
+		cpusched();
+		return;
+	}
+	if (parg != NULL) pt = (struct SIMTASK*)parg;
+	pt->runs += 1;
+	prun = pt;
+	swapcontext(&ucmain, &pt->uc);
+	prun = NULL;
+	for (i = 0; i < ntsk; i++)
+		if (tsk[i].state == TSK_READY) break;
+	if (i < ntsk) cpusched();
+	return;
+}
+/* Running task gives up the cpu */
+static void block(int state)
+{
+	struct SIMTASK* pt = prun;
+
+	if (pt == NULL) morse_trap(801); // Blocking call from an interrupt
+	pt->state = state;
+	swapcontext(&pt->uc, &ucmain);
+	return;
+}
+static void timeout(void* parg)
+{
+	struct SIMTASK* pt = (struct SIMTASK*)parg;
+
+	if ((pt->state != TSK_BLOCK) || (pt->tmo != cansim.t)) return; // Ended some other way
+	pt->timedout = 1;
+	ready(pt);
+	return;
+}
+static void waitticks(struct SIMTASK* pt, TickType_t ticks)
+{
+	pt->timedout = 0;
+	pt->tmo = 0;
+	if (ticks == portMAX_DELAY) return;
+	pt->tmo = cansim_tickns(cansim_tick() + ticks);
+	cansim_at(pt->tmo, timeout, pt);
+	return;
+}
+static void entry(void)
+{
+	struct SIMTASK* pt = prun;
+
+	pt->fn(pt->arg);
+	pt->state = TSK_DEAD;
+	swapcontext(&pt->uc, &ucmain);
+	return;
+}
+
+/* ************************************************************************************************************
+ * void simrtos_init(void);
+ * @brief	: Forget all tasks and queues (cansim_init calls this)
+ * ************************************************************************************************************ */
+void simrtos_init(void)
+{
+	int i;
+
+	for (i = 0; i < ntsk; i++)
+		free(tsk[i].stack);
+	for (i = 0; i < nq; i++)
+		free(q[i].p);
+	memset(tsk, 0, sizeof(tsk));
+	memset(q, 0, sizeof(q));
+	ntsk   = 0;
+	nq     = 0;
+	prun   = NULL;
+	cpuset = 0;
+	rdyseq = 0;
+	return;
+}
+
+/* ======= cmsis_os ====================================================================================== */
+osThreadId osThreadCreate(const osThreadDef_t* pdef, void* argument)
+{
+	struct SIMTASK* pt;
+
+	if (ntsk == SIMMAXTSK) return NULL;
+	pt = &tsk[ntsk++];
+	memset(pt, 0, sizeof(struct SIMTASK));
+	pt->stack = malloc(SIMSTACK);
+	if (pt->stack == NULL) morse_trap(802);
+	getcontext(&pt->uc);
+	pt->uc.uc_stack.ss_sp   = pt->stack;
+	pt->uc.uc_stack.ss_size = SIMSTACK;
+	pt->uc.uc_link = NULL;
+	makecontext(&pt->uc, entry, 0);
+	pt->fn    = pdef->pthread;
+	pt->arg   = argument;
+	pt->prio  = pdef->tpriority + 3; // osPriorityIdle = FreeRTOS 0
+	pt->state = TSK_BLOCK;
+	ready(pt);
+	return pt;
+}
+int osDelay(uint32_t millisec)
+{
+	TickType_t ticks = millisec / portTICK_PERIOD_MS;
+
+	vTaskDelay((ticks == 0) ? 1 : ticks);
+	return 0;
+}
+
+/* ======= Tasks ========================================================================================= */
+TickType_t xTaskGetTickCount(void)
+{
+	return cansim_tick();
+}
+TickType_t xTaskGetTickCountFromISR(void)
+{
+	return cansim_tick();
+}
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+	return prun;
+}
+void vTaskPrioritySet(TaskHandle_t h, UBaseType_t prio)
+{
+	if (h == NULL) h = prun;
+	if (h != NULL) h->prio = prio;
+	return;
+}
+void vTaskSuspend(TaskHandle_t h)
+{
+	if ((h == NULL) || (h == prun))
+	{
+		block(TSK_SUSPEND);
+		return;
+	}
+	h->state = TSK_SUSPEND;
+	return;
+}
+void vTaskDelay(TickType_t ticks)
+{
+	waitticks(prun, ticks);
+	block(TSK_BLOCK);
+	return;
+}
+BaseType_t xTaskNotify(TaskHandle_t h, uint32_t v, eNotifyAction a)
+{
+	if (h == NULL) return pdFAIL;
+	switch (a)
+	{
+	case eSetBits:               h->nval |= v; break;
+	case eIncrement:             h->nval += 1; break;
+	case eSetValueWithOverwrite: h->nval  = v; break;
+	case eSetValueWithoutOverwrite:
+		if (h->npend != 0) return pdFAIL;
+		h->nval = v;
+		break;
+	default: break;
+	}
+	h->npend = 1;
+	if ((h->state == TSK_BLOCK) && (h->nwait != 0)) ready(h);
+	return pdPASS;
+}
+BaseType_t xTaskNotifyFromISR(TaskHandle_t h, uint32_t v, eNotifyAction a, BaseType_t* pw)
+{
+	if (pw != NULL) *pw = pdTRUE;
+	return xTaskNotify(h, v, a);
+}
+BaseType_t xTaskNotifyWait(uint32_t clrentry, uint32_t clrexit, uint32_t* pval, TickType_t ticks)
+{
+	struct SIMTASK* pt = prun;
+
+	if (pt->npend == 0)
+	{
+		pt->nval &= ~clrentry;
+		if (ticks != 0)
+		{
+			pt->nwait = 1;
+			waitticks(pt, ticks);
+			block(TSK_BLOCK);
+		}
+	}
+	if (pval != NULL) *pval = pt->nval;
+	if (pt->npend == 0) return pdFALSE;
+	pt->npend = 0;
+	pt->nval &= ~clrexit;
+	return pdTRUE;
+}
+
+/* ======= Queues ======================================================================================== */
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t size)
+{
+	struct SIMQ* pq;
+
+	if ((nq == SIMMAXQ) || (len == 0)) return NULL;
+	pq = &q[nq++];
+	memset(pq, 0, sizeof(struct SIMQ));
+	pq->p = (uint8_t*)calloc(len, size);
+	if (pq->p == NULL) return NULL;
+	pq->len  = len;
+	pq->size = size;
+	return pq;
+}
+BaseType_t xQueueSendToBack(QueueHandle_t pq, const void* pitem, TickType_t ticks)
+{
+	if (pq == NULL) return errQUEUE_FULL;
+	if (pq->n == pq->len) return errQUEUE_FULL;
+	memcpy(pq->p + ((pq->head + pq->n) % pq->len) * pq->size, pitem, pq->size);
+	pq->n += 1;
+	if (pq->pwait != NULL)
+	{
+		ready(pq->pwait);
+		pq->pwait = NULL;
+	}
+	return pdPASS;
+}
+BaseType_t xQueueReceive(QueueHandle_t pq, void* pitem, TickType_t ticks)
+{
+	struct SIMTASK* pt = prun;
+
+	if ((pq->n == 0) && (ticks != 0) && (pt != NULL))
+	{
+		pq->pwait = pt;
+		pt->pq = pq;
+		waitticks(pt, ticks);
+		block(TSK_BLOCK);
+		if (pq->pwait == pt) pq->pwait = NULL;
+	}
+	if (pq->n == 0) return pdFALSE;
+	memcpy(pitem, pq->p + pq->head * pq->size, pq->size);
+	pq->head = (pq->head + 1) % pq->len;
+	pq->n -= 1;
+	return pdTRUE;
+}
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t pq)
+{
+	return pq->n;
+}
@@ -0,0 +1,16 @@
+/* *****************************************************************************
+* File Name          : DTW_counter.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : cansim: DTW cycle counter from the simulated clock
+****************************************************************************** */
+
+#ifndef __DTW_COUNTER
+#define __DTW_COUNTER
+
+#include <stdint.h>
+
+uint32_t cansim_dtw(void);
+#define DTWTIME (cansim_dtw()) // 168 MHz, wraps as the hardware counter
+
+#endif
@@ -0,0 +1,35 @@
+/* *****************************************************************************
+* File Name          : FreeRTOS.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : cansim: host stand-in for the FreeRTOS types and config
+****************************************************************************** */
+/*
+Tasks, queues and notifications are run by the simulator (simrtos.c) on
+the simulated clock; see cansim.h.
+*/
+
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef long          BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t      TickType_t;
+typedef void*         SemaphoreHandle_t;
+typedef struct SIMQ*  QueueHandle_t;
+typedef struct SIMTASK* TaskHandle_t;
+
+#define pdFALSE        ((BaseType_t)0)
+#define pdTRUE         ((BaseType_t)1)
+#define pdPASS         pdTRUE
+#define pdFAIL         pdFALSE
+#define errQUEUE_FULL  ((BaseType_t)0)
+#define portMAX_DELAY  ((TickType_t)0xffffffffUL)
+
+#define configTICK_RATE_HZ  ((TickType_t)512) // As Inc/FreeRTOSConfig.h
+#define portTICK_PERIOD_MS  ((TickType_t)1000 / configTICK_RATE_HZ)
+
+#endif
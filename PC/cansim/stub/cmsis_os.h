@@ -0,0 +1,46 @@
+/* *****************************************************************************
+* File Name          : cmsis_os.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : cansim: host stand-in for the CMSIS-RTOS thread calls
+****************************************************************************** */
+
+#ifndef _CMSIS_OS_H
+#define _CMSIS_OS_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+typedef TaskHandle_t  osThreadId;
+typedef QueueHandle_t osMessageQId;
+typedef void (*os_pthread)(void const* argument);
+
+typedef enum
+{
+	osPriorityIdle        = -3,
+	osPriorityLow         = -2,
+	osPriorityBelowNormal = -1,
+	osPriorityNormal      =  0,
+	osPriorityAboveNormal = +1,
+	osPriorityHigh        = +2,
+	osPriorityRealtime    = +3
+} osPriority;
+
+typedef struct os_thread_def
+{
+	char*      name;
+	os_pthread pthread;
+	osPriority tpriority;
+	uint32_t   instances;
+	uint32_t   stacksize;
+} osThreadDef_t;
+
+#define osThreadDef(name, thread, priority, instances, stacksz) \
+	const osThreadDef_t os_thread_def_##name = { #name, (thread), (priority), (instances), (stacksz) }
+#define osThread(name) &os_thread_def_##name
+
+osThreadId osThreadCreate(const osThreadDef_t* pdef, void* argument);
+int        osDelay(uint32_t millisec);
+
+#endif
@@ -0,0 +1,15 @@
+/* *****************************************************************************
+* File Name          : main.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : cansim: what the CAN files take from Inc/main.h
+****************************************************************************** */
+
+#ifndef __MAIN_H__
+#define __MAIN_H__
+
+#define GPIOD       0
+#define GPIO_PIN_14 0x4000
+#define HAL_GPIO_TogglePin(port, pin) ((void)0)
+
+#endif
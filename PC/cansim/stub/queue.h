@@ -0,0 +1,22 @@
+/* *****************************************************************************
+* File Name          : queue.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : cansim: host stand-in for FreeRTOS queues
+****************************************************************************** */
+/*
+A send to a full queue does not block: it returns errQUEUE_FULL whatever
+the wait (the firmware only sends with a wait of 0).
+*/
+
+#ifndef INC_QUEUE_H
+#define INC_QUEUE_H
+
+#include "FreeRTOS.h"
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t size);
+BaseType_t    xQueueSendToBack(QueueHandle_t q, const void* pitem, TickType_t ticks);
+BaseType_t    xQueueReceive(QueueHandle_t q, void* pitem, TickType_t ticks);
+UBaseType_t   uxQueueMessagesWaiting(QueueHandle_t q);
+
+#endif
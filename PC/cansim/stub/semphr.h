@@ -0,0 +1,17 @@
+/* *****************************************************************************
+* File Name          : semphr.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Host stand-in for the FreeRTOS mutex calls (PC/mbxtest)
+****************************************************************************** */
+
+#ifndef SEMAPHORE_H
+#define SEMAPHORE_H
+
+#include "FreeRTOS.h"
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+BaseType_t        xSemaphoreTake(SemaphoreHandle_t h, TickType_t ticks);
+BaseType_t        xSemaphoreGive(SemaphoreHandle_t h);
+
+#endif
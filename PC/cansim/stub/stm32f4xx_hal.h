@@ -0,0 +1,23 @@
+/* *****************************************************************************
+* File Name          : stm32f4xx_hal.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : cansim: host stand-in for the HAL, CAN and clocks only
+****************************************************************************** */
+
+#ifndef __STM32F4xx_HAL_H
+#define __STM32F4xx_HAL_H
+
+#include "stm32f4xx_hal_def.h"
+#include "stm32f4xx_hal_can.h"
+
+/* Ourwares/DTW_counter.h is found first by the firmware files in Ourwares
+   (same directory); this one has the same guard and comes in ahead of it. */
+#include "DTW_counter.h"
+
+#define __DMB() __sync_synchronize()
+
+extern uint32_t SystemCoreClock; // 168 MHz
+uint32_t HAL_RCC_GetPCLK1Freq(void); // 42 MHz
+
+#endif
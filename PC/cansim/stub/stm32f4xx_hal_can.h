@@ -0,0 +1,196 @@
+/* *****************************************************************************
+* File Name          : stm32f4xx_hal_can.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : cansim: host stand-in for the HAL CAN driver interface
+****************************************************************************** */
+/*
+Types, values and calls as Drivers/STM32F4xx_HAL_Driver/Inc/stm32f4xx_hal_can.h
+(only what the CAN files use).  The calls are carried out on the simulated
+bxCAN (cansim.c), which also calls the HAL callbacks the way
+HAL_CAN_IRQHandler does.  'Instance' registers hold what the firmware reads
+directly (ESR); the rest of the peripheral state is in the simulator.
+*/
+
+#ifndef __STM32F4xx_HAL_CAN_H
+#define __STM32F4xx_HAL_CAN_H
+
+#include "stm32f4xx_hal_def.h"
+
+typedef struct
+{
+	volatile uint32_t MCR;
+	volatile uint32_t MSR;
+	volatile uint32_t TSR;
+	volatile uint32_t RF0R;
+	volatile uint32_t RF1R;
+	volatile uint32_t IER;
+	volatile uint32_t ESR;
+	volatile uint32_t BTR;
+} CAN_TypeDef;
+
+typedef enum
+{
+	HAL_CAN_STATE_RESET         = 0x00U,
+	HAL_CAN_STATE_READY         = 0x01U,
+	HAL_CAN_STATE_LISTENING     = 0x02U,
+	HAL_CAN_STATE_SLEEP_PENDING = 0x03U,
+	HAL_CAN_STATE_SLEEP_ACTIVE  = 0x04U,
+	HAL_CAN_STATE_ERROR         = 0x05U
+} HAL_CAN_StateTypeDef;
+
+typedef struct
+{
+	uint32_t Prescaler;
+	uint32_t Mode;
+	uint32_t SyncJumpWidth;
+	uint32_t TimeSeg1;
+	uint32_t TimeSeg2;
+	FunctionalState TimeTriggeredMode;
+	FunctionalState AutoBusOff;
+	FunctionalState AutoWakeUp;
+	FunctionalState AutoRetransmission;
+	FunctionalState ReceiveFifoLocked;
+	FunctionalState TransmitFifoPriority;
+} CAN_InitTypeDef;
+
+typedef struct
+{
+	uint32_t FilterIdHigh;
+	uint32_t FilterIdLow;
+	uint32_t FilterMaskIdHigh;
+	uint32_t FilterMaskIdLow;
+	uint32_t FilterFIFOAssignment;
+	uint32_t FilterBank;
+	uint32_t FilterMode;
+	uint32_t FilterScale;
+	uint32_t FilterActivation;
+	uint32_t SlaveStartFilterBank;
+} CAN_FilterTypeDef;
+
+typedef struct
+{
+	uint32_t StdId;
+	uint32_t ExtId;
+	uint32_t IDE;
+	uint32_t RTR;
+	uint32_t DLC;
+	FunctionalState TransmitGlobalTime;
+} CAN_TxHeaderTypeDef;
+
+typedef struct
+{
+	uint32_t StdId;
+	uint32_t ExtId;
+	uint32_t IDE;
+	uint32_t RTR;
+	uint32_t DLC;
+	uint32_t Timestamp;
+	uint32_t FilterMatchIndex;
+} CAN_RxHeaderTypeDef;
+
+typedef struct __CAN_HandleTypeDef
+{
+	CAN_TypeDef* Instance;
+	CAN_InitTypeDef Init;
+	volatile HAL_CAN_StateTypeDef State;
+	volatile uint32_t ErrorCode;
+} CAN_HandleTypeDef;
+
+#define HAL_CAN_ERROR_NONE            (0x00000000U)
+#define HAL_CAN_ERROR_EWG             (0x00000001U)
+#define HAL_CAN_ERROR_EPV             (0x00000002U)
+#define HAL_CAN_ERROR_BOF             (0x00000004U)
+#define HAL_CAN_ERROR_STF             (0x00000008U)
+#define HAL_CAN_ERROR_FOR             (0x00000010U)
+#define HAL_CAN_ERROR_ACK             (0x00000020U)
+#define HAL_CAN_ERROR_BR              (0x00000040U)
+#define HAL_CAN_ERROR_BD              (0x00000080U)
+#define HAL_CAN_ERROR_CRC             (0x00000100U)
+#define HAL_CAN_ERROR_RX_FOV0         (0x00000200U)
+#define HAL_CAN_ERROR_RX_FOV1         (0x00000400U)
+#define HAL_CAN_ERROR_TX_ALST0        (0x00000800U)
+#define HAL_CAN_ERROR_TX_TERR0        (0x00001000U)
+#define HAL_CAN_ERROR_TX_ALST1        (0x00002000U)
+#define HAL_CAN_ERROR_TX_TERR1        (0x00004000U)
+#define HAL_CAN_ERROR_TX_ALST2        (0x00008000U)
+#define HAL_CAN_ERROR_TX_TERR2        (0x00010000U)
+#define HAL_CAN_ERROR_TIMEOUT         (0x00020000U)
+#define HAL_CAN_ERROR_NOT_INITIALIZED (0x00040000U)
+#define HAL_CAN_ERROR_NOT_READY       (0x00080000U)
+#define HAL_CAN_ERROR_NOT_STARTED     (0x00100000U)
+#define HAL_CAN_ERROR_PARAM           (0x00200000U)
+
+#define CAN_MODE_NORMAL        (0x00000000U)
+#define CAN_SJW_1TQ            (0x00000000U)
+#define CAN_BTR_TS1_Pos        (16U)
+#define CAN_BTR_TS2_Pos        (20U)
+#define CAN_BS1_5TQ            (0x4UL << CAN_BTR_TS1_Pos)
+#define CAN_BS2_1TQ            (0x00000000U)
+
+#define CAN_FILTERMODE_IDMASK  (0x00000000U)
+#define CAN_FILTERMODE_IDLIST  (0x00000001U)
+#define CAN_FILTERSCALE_16BIT  (0x00000000U)
+#define CAN_FILTERSCALE_32BIT  (0x00000001U)
+#define CAN_FILTER_DISABLE     (0x00000000U)
+#define CAN_FILTER_ENABLE      (0x00000001U)
+#define CAN_FILTER_FIFO0       (0x00000000U)
+#define CAN_FILTER_FIFO1       (0x00000001U)
+
+#define CAN_ID_STD             (0x00000000U)
+#define CAN_ID_EXT             (0x00000004U)
+#define CAN_RTR_DATA           (0x00000000U)
+#define CAN_RTR_REMOTE         (0x00000002U)
+#define CAN_RX_FIFO0           (0x00000000U)
+#define CAN_RX_FIFO1           (0x00000001U)
+#define CAN_TX_MAILBOX0        (0x00000001U)
+#define CAN_TX_MAILBOX1        (0x00000002U)
+#define CAN_TX_MAILBOX2        (0x00000004U)
+
+/* IER bits */
+#define CAN_IT_TX_MAILBOX_EMPTY     (1U <<  0)
+#define CAN_IT_RX_FIFO0_MSG_PENDING (1U <<  1)
+#define CAN_IT_RX_FIFO0_FULL        (1U <<  2)
+#define CAN_IT_RX_FIFO0_OVERRUN     (1U <<  3)
+#define CAN_IT_RX_FIFO1_MSG_PENDING (1U <<  4)
+#define CAN_IT_RX_FIFO1_FULL        (1U <<  5)
+#define CAN_IT_RX_FIFO1_OVERRUN     (1U <<  6)
+#define CAN_IT_ERROR_WARNING        (1U <<  8)
+#define CAN_IT_ERROR_PASSIVE        (1U <<  9)
+#define CAN_IT_BUSOFF               (1U << 10)
+#define CAN_IT_LAST_ERROR_CODE      (1U << 11)
+#define CAN_IT_ERROR                (1U << 15)
+
+/* ESR */
+#define CAN_ESR_EWGF     (1U << 0)
+#define CAN_ESR_EPVF     (1U << 1)
+#define CAN_ESR_BOFF     (1U << 2)
+#define CAN_ESR_LEC_Pos  (4U)
+#define CAN_ESR_LEC      (0x7U << CAN_ESR_LEC_Pos)
+#define CAN_ESR_TEC_Pos  (16U)
+#define CAN_ESR_TEC      (0xFFU << CAN_ESR_TEC_Pos)
+#define CAN_ESR_REC_Pos  (24U)
+#define CAN_ESR_REC      (0xFFU << CAN_ESR_REC_Pos)
+
+HAL_StatusTypeDef HAL_CAN_Init(CAN_HandleTypeDef* hcan);
+HAL_StatusTypeDef HAL_CAN_ConfigFilter(CAN_HandleTypeDef* hcan, CAN_FilterTypeDef* sFilterConfig);
+HAL_StatusTypeDef HAL_CAN_Start(CAN_HandleTypeDef* hcan);
+HAL_StatusTypeDef HAL_CAN_Stop(CAN_HandleTypeDef* hcan);
+HAL_StatusTypeDef HAL_CAN_ActivateNotification(CAN_HandleTypeDef* hcan, uint32_t ActiveITs);
+HAL_StatusTypeDef HAL_CAN_AddTxMessage(CAN_HandleTypeDef* hcan, CAN_TxHeaderTypeDef* pHeader, uint8_t aData[], uint32_t* pTxMailbox);
+HAL_StatusTypeDef HAL_CAN_AbortTxRequest(CAN_HandleTypeDef* hcan, uint32_t TxMailboxes);
+uint32_t          HAL_CAN_GetTxTimestamp(CAN_HandleTypeDef* hcan, uint32_t TxMailbox);
+HAL_StatusTypeDef HAL_CAN_GetRxMessage(CAN_HandleTypeDef* hcan, uint32_t RxFifo, CAN_RxHeaderTypeDef* pHeader, uint8_t aData[]);
+HAL_StatusTypeDef HAL_CAN_ResetError(CAN_HandleTypeDef* hcan);
+
+void HAL_CAN_TxMailbox0CompleteCallback(CAN_HandleTypeDef* hcan);
+void HAL_CAN_TxMailbox1CompleteCallback(CAN_HandleTypeDef* hcan);
+void HAL_CAN_TxMailbox2CompleteCallback(CAN_HandleTypeDef* hcan);
+void HAL_CAN_TxMailbox0AbortCallback(CAN_HandleTypeDef* hcan);
+void HAL_CAN_TxMailbox1AbortCallback(CAN_HandleTypeDef* hcan);
+void HAL_CAN_TxMailbox2AbortCallback(CAN_HandleTypeDef* hcan);
+void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef* hcan);
+void HAL_CAN_RxFifo1MsgPendingCallback(CAN_HandleTypeDef* hcan);
+void HAL_CAN_ErrorCallback(CAN_HandleTypeDef* hcan);
+
+#endif
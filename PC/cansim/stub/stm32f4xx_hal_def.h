@@ -0,0 +1,28 @@
+/* *****************************************************************************
+* File Name          : stm32f4xx_hal_def.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : cansim: host stand-in for the HAL common definitions
+****************************************************************************** */
+
+#ifndef __STM32F4xx_HAL_DEF
+#define __STM32F4xx_HAL_DEF
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum
+{
+	HAL_OK      = 0x00U,
+	HAL_ERROR   = 0x01U,
+	HAL_BUSY    = 0x02U,
+	HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+	DISABLE = 0U,
+	ENABLE  = !DISABLE
+} FunctionalState;
+
+#endif
@@ -0,0 +1,48 @@
+/* *****************************************************************************
+* File Name          : task.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : cansim: host stand-in for the FreeRTOS task calls
+****************************************************************************** */
+/*
+Interrupts (the simulated bxCAN callbacks) only run between tasks, never
+in the middle of one, so the critical sections are empty.  PC/mbxtest runs
+the same calls on threads (pthrtos.c); there the firmware only uses critical
+sections during setup.
+*/
+
+#ifndef INC_TASK_H
+#define INC_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef enum
+{
+	eNoAction = 0,
+	eSetBits,
+	eIncrement,
+	eSetValueWithOverwrite,
+	eSetValueWithoutOverwrite
+} eNotifyAction;
+
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+#define portYIELD_FROM_ISR(x) ((void)(x))
+
+#define taskSCHEDULER_SUSPENDED   ((BaseType_t)0)
+#define taskSCHEDULER_NOT_STARTED ((BaseType_t)1)
+#define taskSCHEDULER_RUNNING     ((BaseType_t)2)
+
+TickType_t   xTaskGetTickCount(void);
+TickType_t   xTaskGetTickCountFromISR(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t   xTaskNotify(TaskHandle_t h, uint32_t v, eNotifyAction a);
+BaseType_t   xTaskNotifyFromISR(TaskHandle_t h, uint32_t v, eNotifyAction a, BaseType_t* pw);
+BaseType_t   xTaskNotifyWait(uint32_t clrentry, uint32_t clrexit, uint32_t* pval, TickType_t ticks);
+void         vTaskPrioritySet(TaskHandle_t h, UBaseType_t prio);
+void         vTaskSuspend(TaskHandle_t h);
+void         vTaskDelay(TickType_t ticks);
+void         taskYIELD(void);
+BaseType_t   xTaskGetSchedulerState(void);
+
+#endif
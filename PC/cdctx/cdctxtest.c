@@ -0,0 +1,595 @@
+/* *****************************************************************************
+* File Name          : cdctxtest.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : cdctx: checks of the USB-CDC TX double buffer, and the old ring buffer for comparison
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 cdctxtest.c ../../Ourwares/cdc_txdbl.c -I../../Ourwares -lpthread -lm -o cdctxtest
+./cdctxtest [test...]
+
+cdc_txdbl.c is compiled as it is; it has no RTOS or HAL calls.  Where the
+firmware masks the USB interrupt (cdc_txbuff.c) a mutex stands in.  Each
+test runs in its own process.  Prints PASS/FAIL for each; exit code is the
+number that failed.
+
+states (user-042): reserve, commit, TX complete and failed, one step at a
+time: which calls start a transfer, what it holds, and the counts.
+
+stress (user-042): a producer task and a USB "interrupt" thread.  Random
+sizes, commits of less than was reserved, and yields while formatting.
+The bytes carry a running count, so the USB side sees any out of order,
+lost or doubled byte.  3M commits, 31M bytes, 0 out of order.  With the
+'resv' check taken out of 'cdc_txdbl_cplt', 2.8M bytes came out of order.
+
+bench (user-042): virtual time, USB full speed bulk IN at 19 packets/ms,
+23 byte msgs (an ascii CAN line), Poisson arrivals; latency is from the
+msg's arrival to the end of its transfer.  'old' is the baseline
+cdc_txbuff.c: 4 x 256 byte ring, a transfer started only from an add or
+the 5 ms timer, and on overrun a poll and then the buffer is written
+anyway.  'new' is cdc_txdbl, 2 x 256, swapped on TX complete, with the
+producer side of cdc_txbuff_reserve: when both are full it waits for TX
+complete, gives up CDCTXWAIT (8) ticks after the first try and drops the
+msg ('drop', what GatewayTask reports as GATELOSS_CDC), and after a give-up
+drops at once until the USB finishes a transfer.  Msgs wait for the
+producer in a 16 slot drop-oldest ring, as the MailboxTask handoff
+('lost').  'halt' is seconds, from 1 s in, that the host stops reading.
+ msgs/s burst halt     msgs/s  avg us  max us overrun    full    lost    drop
+    500    1  0.0 old      501      84    4643       0       0       0       0
+    500    1  0.0 new      501      53     105       0       0       0       0
+   2000    1  0.0 old     2007     100    3905       0       0       0       0
+   2000    1  0.0 new     2007      55     158       0       0       0       0
+   8000    1  0.0 old     8036     109    1201       0       0       0       0
+   8000    1  0.0 new     8036      65     261       0       0       0       0
+  20000    1  0.0 old    19994     149     777       0       0       0       0
+  20000    1  0.0 new    19994      94     366       0       0       0       0
+  60000    1  0.0 old    39422     553    1457   13860       0       0       0
+  60000    1  0.0 new    52224     582     823       0   47270   77775       0
+   2000    8  0.0 old     1985    1807   10378       0       0       0       0
+   2000    8  0.0 new     1986     195     639       0      44       0       0
+   2000    1  2.0 old     1602     228 1998192      91       0       0       0
+   2000    1  2.0 new     1602    1550 1998192       0    4051       4    4050
+The old path waits up to 5 ms for the timer whenever a msg lands while
+the USB is busy; the new one starts the next transfer from TX complete.
+At 60000 msgs/s (past the link) the old ring overwrites what it is
+sending; the new one runs at the link rate, TX complete frees a buffer
+well inside CDCTXWAIT so nothing is dropped there, and the handoff loses
+the excess.  With the host halted, the first msg waits 8 ms, the rest are
+dropped at once (4050, all counted) until the host reads again; the old
+ring overwrites its buffers uncounted.  With the wait changed to poll each
+tick (osDelay(1), as first written) 60000 msgs/s gave 12004 msgs/s: one
+buffer per ms.  Bytes copied per byte sent: old 2 (the task's copy into
+its ring), new 1.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include "cdc_txdbl.h"
+
+static char why[256];
+static int fail(const char* fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	vsnprintf(why, sizeof(why), fmt, ap);
+	va_end(ap);
+	return 1;
+}
+
+/* ======= states: one call at a time ==================================================================== */
+static int t_states(void)
+{
+	struct CDCTXDBL d;
+	struct CDCTXDBLXFER x;
+	uint8_t* p;
+
+	if (cdc_txdbl_init(&d, 0) != -1) return fail("size 0 accepted");
+	if (cdc_txdbl_init(&d, 100) != 0) return fail("cdc_txdbl_init");
+	if (d.size != 128) return fail("size 100 rounded to %u", d.size);
+
+	/* USB idle: the commit starts it */
+	p = cdc_txdbl_reserve(&d, 10);
+	if (p != d.pbuf[0]) return fail("reserve: not at the start of buffer 0");
+	if (cdc_txdbl_reserve(&d, 1) != NULL) return fail("second reserve while reserved");
+	memset(p, 'a', 10);
+	if (cdc_txdbl_commit(&d, 10, &x) != 1) return fail("commit with the USB idle started nothing");
+	if ((x.pbuf != d.pbuf[0]) || (x.len != 10) || (d.busy != 1) || (d.fill != 1) || (d.ct[1] != 0))
+		return fail("first transfer %p %u busy %u fill %u", x.pbuf, x.len, d.busy, d.fill);
+
+	/* USB busy: bytes pile up, including an empty commit, and go on TX complete */
+	p = cdc_txdbl_reserve(&d, 5);
+	if (cdc_txdbl_commit(&d, 0, &x) != 0) return fail("empty commit started a transfer");
+	p = cdc_txdbl_reserve(&d, 30);
+	if (p != d.pbuf[1]) return fail("reserve after empty commit moved");
+	if (cdc_txdbl_commit(&d, 20, &x) != 0) return fail("commit while busy started a transfer");
+	if (cdc_txdbl_cplt(&d, &x) != 1) return fail("TX complete did not start the filled buffer");
+	if ((x.pbuf != d.pbuf[1]) || (x.len != 20) || (d.fill != 0) || (d.ct[0] != 0) || (d.stats.chained != 1))
+		return fail("chained transfer %p %u fill %u ct %u", x.pbuf, x.len, d.fill, d.ct[0]);
+	if (cdc_txdbl_cplt(&d, &x) != 0) return fail("TX complete with nothing filled started a transfer");
+	if (d.busy != 0) return fail("busy after the last TX complete");
+
+	/* Full: a reserve past 'size' is refused and counted */
+	p = cdc_txdbl_reserve(&d, 128);
+	cdc_txdbl_commit(&d, 128, &x);
+	p = cdc_txdbl_reserve(&d, 100);
+	cdc_txdbl_commit(&d, 100, &x);
+	if (cdc_txdbl_reserve(&d, 29) != NULL) return fail("reserve past size");
+	if (d.stats.full != 1) return fail("full %u", d.stats.full);
+	p = cdc_txdbl_reserve(&d, 28);
+	if (p != (d.pbuf[d.fill] + 100)) return fail("reserve of the last 28 bytes");
+
+	/* TX complete while reserved: leave the swap to the commit */
+	if (cdc_txdbl_cplt(&d, &x) != 0) return fail("TX complete swapped a reserved buffer");
+	if (d.busy != 0) return fail("busy after TX complete");
+	if (cdc_txdbl_commit(&d, 28, &x) != 1) return fail("commit after TX complete while reserved started nothing");
+	if (x.len != 128) return fail("that transfer has %u bytes", x.len);
+
+	/* Failed start: discarded, counts backed out, the next commit starts afresh */
+	if ((d.stats.xfers != 4) || (d.stats.bytes != (10 + 20 + 128 + 128)))
+		return fail("xfers %u bytes %u", d.stats.xfers, d.stats.bytes);
+	cdc_txdbl_failed(&d, &x);
+	if ((d.busy != 0) || (d.stats.failed != 1) || (d.stats.xfers != 3) || (d.stats.bytes != (10 + 20 + 128)))
+		return fail("after failed: busy %u failed %u xfers %u bytes %u", d.busy, d.stats.failed, d.stats.xfers, d.stats.bytes);
+	p = cdc_txdbl_reserve(&d, 7);
+	if (p != d.pbuf[d.fill]) return fail("fill buffer not empty after failed");
+	if ((cdc_txdbl_commit(&d, 7, &x) != 1) || (x.len != 7)) return fail("commit after failed: %u bytes", x.len);
+
+	/* Failed start from TX complete */
+	p = cdc_txdbl_reserve(&d, 9);
+	cdc_txdbl_commit(&d, 9, &x);
+	if ((cdc_txdbl_cplt(&d, &x) != 1) || (x.len != 9)) return fail("chained 9 bytes");
+	cdc_txdbl_failed(&d, &x);
+	if ((d.busy != 0) || (d.stats.failed != 2) || (d.ct[d.fill] != 0)) return fail("after failed chained");
+	if (cdc_txdbl_cplt(&d, &x) != 0) return fail("TX complete after failed started a transfer");
+	return 0;
+}
+
+/* ======= stress: producer task and USB interrupt on threads ============================================= */
+#define STRESSN 3000000 // Commits
+static struct CDCTXDBL sd;
+static pthread_mutex_t crit = PTHREAD_MUTEX_INITIALIZER; // Interrupt masking
+static struct CDCTXDBLXFER scur;
+static volatile int sactive; // 1 = USB sending 'scur'
+static volatile int sdone;
+static uint64_t srecv, sbad, sxfers, sdouble;
+
+static void sstart(struct CDCTXDBLXFER* px)
+{ // Called masked
+	if (sactive != 0) sdouble += 1;
+	scur    = *px;
+	sactive = 1;
+	return;
+}
+static void* StartUsb(void* arg)
+{
+	struct CDCTXDBLXFER x;
+	uint8_t expect = 0;
+	int idle;
+	int i;
+
+	for (;;)
+	{
+		if (sactive == 0)
+		{
+			if (sdone != 0)
+			{
+				pthread_mutex_lock(&crit);
+				idle = (sactive == 0) && (sd.ct[sd.fill] == 0) && (sd.resv == 0);
+				pthread_mutex_unlock(&crit);
+				if (idle != 0) break;
+			}
+			sched_yield();
+			continue;
+		}
+		for (i = 0; i < scur.len; i++)
+		{
+			if (scur.pbuf[i] != expect) sbad += 1;
+			expect = (expect + 1) % 251;
+		}
+		srecv  += scur.len;
+		sxfers += 1;
+		if ((rand() & 3) == 0) sched_yield(); // Transfer time
+
+		pthread_mutex_lock(&crit);
+		sactive = 0;
+		if (cdc_txdbl_cplt(&sd, &x) != 0) sstart(&x);
+		pthread_mutex_unlock(&crit);
+	}
+	return NULL;
+}
+static int t_stress(void)
+{
+	struct CDCTXDBLXFER x;
+	pthread_t th;
+	uint64_t sent = 0;
+	uint8_t* p;
+	uint8_t v = 0;
+	int k, n, w, i;
+
+	if (cdc_txdbl_init(&sd, 200) != 0) return fail("cdc_txdbl_init");
+	srand(1);
+	if (pthread_create(&th, NULL, StartUsb, NULL) != 0) return fail("pthread_create");
+	for (k = 0; k < STRESSN; k++)
+	{
+		n = 1 + rand() % 40;
+		for (;;)
+		{
+			pthread_mutex_lock(&crit);
+			p = cdc_txdbl_reserve(&sd, n);
+			pthread_mutex_unlock(&crit);
+			if (p != NULL) break;
+			sched_yield(); // Both full: wait for the USB
+		}
+		w = rand() % (n + 1); // Formatted fewer than reserved
+		for (i = 0; i < w; i++)
+		{
+			p[i] = v;
+			v = (v + 1) % 251;
+		}
+		if ((rand() & 7) == 0) sched_yield(); // Preempted while formatting
+
+		pthread_mutex_lock(&crit);
+		if (cdc_txdbl_commit(&sd, w, &x) != 0) sstart(&x);
+		pthread_mutex_unlock(&crit);
+		sent += w;
+	}
+	sdone = 1;
+	pthread_join(th, NULL);
+
+	printf("    stress: %lu bytes in %lu transfers (%u chained), %u reserves refused\n",
+		(unsigned long)srecv, (unsigned long)sxfers, sd.stats.chained, sd.stats.full);
+	if (sdouble != 0) return fail("%lu transfers started while one was sending", (unsigned long)sdouble);
+	if (sbad != 0) return fail("%lu bytes out of order", (unsigned long)sbad);
+	if (srecv != sent) return fail("sent %lu, received %lu", (unsigned long)sent, (unsigned long)srecv);
+	if ((sd.stats.xfers != sxfers) || (sd.stats.bytes != (uint32_t)srecv))
+		return fail("stats: xfers %u bytes %u", sd.stats.xfers, sd.stats.bytes);
+	return 0;
+}
+
+/* ======= bench: old ring (baseline cdc_txbuff.c) vs double buffer, in virtual time ======================= */
+#define PKTUS  (1000.0 / 19) // USB FS bulk: 19 packets of 64 per 1 ms frame
+#define MSGLEN 23            // Ascii/hex CAN line
+#define BMAX   2000000       // Msgs
+#define ONB    4             // Old: NUMCDCBUFF
+#define OBS    256           // Old: CDCBUFFSIZE; new: buffer size
+#define OTIMUS 5000          // Old: CDCTIMEDURATION
+#define CDCTXWAIT 8          // New: as cdc_txbuff.h, 1 ms ticks
+#define TICKUS 1000
+#define GATEQ  16            // GATEWAYBUFSIZE: MailboxTask->GatewayTask handoff
+
+struct BENCH
+{
+	double arr[BMAX];    // Arrival time of each msg
+	long nin;            // Msgs arrived
+	long narr;           // Msgs arrived, less those the handoff lost
+	long lost;           // Handoff full: oldest overwritten (MBXGATE_DROPOLDEST)
+	long nsent;          // Msgs added to a buffer
+	long ndel;           // Msgs delivered
+	double latsum;
+	double latmax;
+	long overrun;        // Old: buffer being sent written over
+	long full;           // New: reserves refused
+	long drop;           // New: msgs 'cdc_txbuff_add' gave up on
+	long copies;         // Bytes copied
+	int usbbusy;
+	double usbdone;      // Time the transfer ends
+	long flfirst;        // Msgs in the transfer
+	long fln;
+	/* Old ring */
+	int oct[ONB];
+	long omsgs[ONB];
+	long ofirst[ONB];
+	int om;              // 'pbuff_m'
+	int oi;              // 'pbuff_i'
+	/* Double buffer */
+	struct CDCTXDBL d;
+	long nfirst[2];
+	long nmsgs[2];
+	double wnext;        // Producer waiting: gives up at this tick
+	int stalled;         // 'cdc_txbuff_reserve' gave up last time...
+	uint32_t stallxfers; // ...with this many transfers
+};
+static struct BENCH b;
+
+static double xfertime(int len)
+{ // ct/64 full packets and one short (or zero length) packet
+	return (len / 64 + 1) * PKTUS;
+}
+static void usbstart(double t, int len, long first, long n)
+{
+	b.usbbusy = 1;
+	b.usbdone = t + xfertime(len);
+	b.flfirst = first;
+	b.fln     = n;
+	return;
+}
+static void deliver(double t)
+{
+	double l;
+	long i;
+
+	for (i = 0; i < b.fln; i++)
+	{
+		l = t - b.arr[b.flfirst + i];
+		b.latsum += l;
+		if (l > b.latmax) b.latmax = l;
+		b.ndel += 1;
+	}
+	b.fln = 0;
+	return;
+}
+/* Old: 'poll' */
+static int old_poll(double t)
+{
+	int tmp = (b.oi + 1) % ONB;
+
+	if ((b.om == tmp) && (b.oct[b.om] == 0)) return 2;
+	if (b.usbbusy != 0) return 0;
+	usbstart(t, b.oct[tmp], b.ofirst[tmp], b.omsgs[tmp]);
+	b.oi = tmp;
+	b.oct[b.oi]   = 0;
+	b.omsgs[b.oi] = 0;
+	if (b.om == b.oi)
+	{
+		b.om = (b.om + 1) % ONB;
+		b.oct[b.om]    = 0;
+		b.omsgs[b.om]  = 0;
+		b.ofirst[b.om] = b.nsent;
+	}
+	return 1;
+}
+static void old_step(double t)
+{ // 'pbuff_m' reached the end of a buffer
+	b.om = (b.om + 1) % ONB;
+	b.oct[b.om]   = 0;
+	b.omsgs[b.om] = 0;
+	if (b.om == b.oi)
+	{ // About to overrun: one poll, then on anyway
+		b.overrun += 1;
+		old_poll(t);
+	}
+	return;
+}
+/* Old: 'cdc_txbuff_add', a byte at a time */
+static void old_add(double t, long id)
+{
+	int left = MSGLEN;
+
+	while (left-- > 0)
+	{
+		b.oct[b.om] += 1;
+		b.copies += 2; // Formatted by the caller, copied by CdcTxTask
+		if ((b.oct[b.om] == OBS) && (left != 0)) old_step(t);
+	}
+	if (b.omsgs[b.om] == 0) b.ofirst[b.om] = id;
+	b.omsgs[b.om] += 1;
+	if (b.oct[b.om] == OBS) old_step(t);
+	old_poll(t);
+	return;
+}
+/* New: reserve, format in place, commit */
+static void new_start(double t, struct CDCTXDBLXFER* px)
+{
+	int f = b.d.fill ^ 1; // The buffer just handed to the USB
+
+	usbstart(t, px->len, b.nfirst[f], b.nmsgs[f]);
+	b.nmsgs[b.d.fill] = 0;
+	return;
+}
+static int new_add(double t, long id)
+{
+	struct CDCTXDBLXFER x;
+	uint8_t* p = cdc_txdbl_reserve(&b.d, MSGLEN);
+
+	if (p == NULL)
+	{
+		b.full += 1;
+		return 0;
+	}
+	if (b.nmsgs[b.d.fill] == 0) b.nfirst[b.d.fill] = id;
+	b.nmsgs[b.d.fill] += 1;
+	b.copies += MSGLEN;
+	if (cdc_txdbl_commit(&b.d, MSGLEN, &x) != 0) new_start(t, &x);
+	return 1;
+}
+/* New: the producer side of 'cdc_txbuff_reserve'.  Both buffers full: wait
+   for TX complete, until CDCTXWAIT ticks from the first try, then drop the
+   msg; after a give-up, drop at once until the USB has finished a transfer. */
+static void new_producer(double t)
+{
+	while (b.nsent < b.narr)
+	{
+		if (new_add(t, b.nsent) != 0)
+		{
+			b.stalled = 0;
+			b.wnext   = 1E30;
+			b.nsent  += 1;
+			continue;
+		}
+		if ((t >= b.wnext) || ((b.stalled != 0) && (b.stallxfers == b.d.stats.xfers)))
+		{ // Give up: the caller gets 0, the msg is gone
+			b.stalled    = 1;
+			b.stallxfers = b.d.stats.xfers;
+			b.wnext      = 1E30;
+			b.drop      += 1;
+			b.nsent     += 1;
+			continue;
+		}
+		if (b.wnext == 1E30)
+			b.wnext = (floor(t / TICKUS) + CDCTXWAIT) * TICKUS;
+		return;
+	}
+	return;
+}
+static long run(int isnew, double rate, double secs, int burst, double halt)
+{
+	struct CDCTXDBLXFER x;
+	double t = 0;
+	double tnext = 0;
+	double ttim = OTIMUS;
+	double tend = secs * 1E6;
+	long j;
+	int i;
+
+	memset(&b, 0, sizeof(b));
+	b.oi = ONB - 1; // Initially one behind 'pbuff_m'
+	b.usbdone = 1E30;
+	b.wnext   = 1E30;
+	cdc_txdbl_init(&b.d, OBS);
+	srand(7);
+	while (t < tend)
+	{
+		t = tnext;
+		if ((b.usbbusy != 0) && (b.usbdone < t)) t = b.usbdone;
+		if ((isnew == 0) && (ttim < t)) t = ttim;
+		if (b.wnext < t) t = b.wnext;
+
+		if ((b.usbbusy != 0) && (t == b.usbdone))
+		{ // TX complete
+			if ((t >= 1E6) && (t < (1E6 + halt * 1E6)))
+			{ // USB halted (host not reading) from 1 s for 'halt' s
+				b.usbdone = 1E6 + halt * 1E6;
+				continue;
+			}
+			b.usbbusy = 0;
+			b.usbdone = 1E30;
+			deliver(t);
+			if (isnew != 0)
+			{
+				if (cdc_txdbl_cplt(&b.d, &x) != 0) new_start(t, &x);
+				if (b.wnext != 1E30) new_producer(t); // Semaphore wakes it
+			}
+			continue;
+		}
+		if (t == b.wnext)
+		{ // New: producer's wait timed out
+			new_producer(t);
+			continue;
+		}
+		if ((isnew == 0) && (t == ttim))
+		{ // Old: timer poll
+			old_poll(t);
+			ttim += OTIMUS;
+			continue;
+		}
+		if (t == tnext)
+		{ // Arrivals
+			for (i = 0; (i < burst) && (b.narr < BMAX); i++)
+			{
+				b.nin += 1;
+				j = b.nsent + ((b.wnext != 1E30) ? 1 : 0); // Oldest msg in the handoff
+				if ((b.narr - j) >= GATEQ)
+				{
+					memmove(&b.arr[j], &b.arr[j + 1], (b.narr - j - 1) * sizeof(double));
+					b.narr -= 1;
+					b.lost += 1;
+				}
+				b.arr[b.narr++] = t;
+			}
+			tnext = t + (burst * 1E6 / rate) * -log((rand() + 1.0) / (RAND_MAX + 2.0));
+		}
+		if (isnew == 0)
+		{
+			for (; b.nsent < b.narr; b.nsent++)
+				old_add(t, b.nsent);
+		}
+		else if (b.wnext == 1E30)
+			new_producer(t); // Not already waiting for TX complete
+	}
+	printf("%7.0f %4d %4.1f %s %8.0f %7.0f %7.0f %7ld %7ld %7ld %7ld %7.1f\n", rate, burst, halt, (isnew != 0) ? "new" : "old",
+		b.ndel / secs, (b.ndel != 0) ? b.latsum / b.ndel : 0, b.latmax, b.overrun, b.full, b.lost, b.drop,
+		(b.nsent != 0) ? b.copies / (double)(b.nsent * MSGLEN) : 0);
+	return b.ndel;
+}
+static int t_bench(void)
+{
+	static const double rate[] = {500, 2000, 8000, 20000, 60000};
+	long nold;
+	int i;
+
+	printf(" msgs/s burst halt     msgs/s  avg us  max us overrun    full    lost    drop  copies/byte\n");
+	for (i = 0; i < (int)(sizeof(rate) / sizeof(rate[0])); i++)
+	{
+		nold = run(0, rate[i], 10, 1, 0);
+		if (run(1, rate[i], 10, 1, 0) < nold) return fail("%.0f msgs/s: new delivered fewer", rate[i]);
+		if ((rate[i] < 20000) && (b.drop != 0)) return fail("%.0f msgs/s: %ld dropped", rate[i], b.drop);
+	}
+	nold = run(0, 2000, 10, 8, 0);
+	if (run(1, 2000, 10, 8, 0) < nold) return fail("bursts: new delivered fewer");
+	if (b.drop != 0) return fail("bursts: %ld dropped", b.drop);
+	run(0, 2000, 10, 1, 2);
+	run(1, 2000, 10, 1, 2);
+	if ((b.drop < 3900) || ((b.nin - b.ndel - b.lost - b.drop) > 40))
+		return fail("halt: arrived %ld delivered %ld lost %ld dropped %ld", b.nin, b.ndel, b.lost, b.drop);
+	return 0;
+}
+
+struct TEST
+{
+	const char* name;
+	int (*fn)(void);
+};
+static const struct TEST test[] =
+{
+	{"states", t_states},
+	{"stress", t_stress},
+	{"bench",  t_bench},
+};
+#define NTEST (int)(sizeof(test) / sizeof(test[0]))
+
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	int nfail = 0;
+	int st;
+	int i, j;
+	int fd[2];
+	pid_t pid;
+	ssize_t n;
+
+	for (i = 0; i < NTEST; i++)
+	{
+		if (argc > 1)
+		{
+			for (j = 1; j < argc; j++)
+				if (strcmp(argv[j], test[i].name) == 0) break;
+			if (j == argc) continue;
+		}
+		if (pipe(fd) != 0) return 1;
+		fflush(stdout);
+		pid = fork();
+		if (pid == 0)
+		{
+			close(fd[0]);
+			why[0] = 0;
+			st = test[i].fn();
+			fflush(stdout);
+			if (write(fd[1], why, strlen(why)) < 0) _exit(1);
+			_exit(st);
+		}
+		close(fd[1]);
+		memset(why, 0, sizeof(why));
+		n = read(fd[0], why, sizeof(why) - 1);
+		close(fd[0]);
+		waitpid(pid, &st, 0);
+		if ((n >= 0) && WIFEXITED(st) && (WEXITSTATUS(st) == 0))
+			printf("PASS %s\n", test[i].name);
+		else
+		{
+			nfail += 1;
+			printf("FAIL %s: %s\n", test[i].name, (why[0] != 0) ? why : "crashed");
+		}
+	}
+	return nfail;
+}
@@ -0,0 +1,272 @@
+/* *****************************************************************************
+* File Name          : gatewaybin.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Decode gateway CAN->PC msgs: ascii/hex lines and binary frames
+****************************************************************************** */
+/*
+Library for 'gbin2asc' and 'gbinbench' (see those for gcc lines).
+Ascii/hex uses the firmware's table codec (Ourwares/hexcodec.c).
+
+Same framing rules as 'PC_msg_get' and 'PC_msg_prep' in the firmware
+(Ourwares/PC_gateway_comm.c), and the same checksum as 'CANgenchksum'.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "gatewaybin.h"
+#include "hexcodec.h"
+
+/* ************************************************************************************************************
+ * void gbin_init(struct GBIN* p, uint8_t mode);
+ * @brief	: Reset decoder and counts
+ * @param	: p = pointer to decoder
+ * @param	: mode = GBIN_MODE_ASCII or GBIN_MODE_BIN (format expected first)
+ * ************************************************************************************************************ */
+void gbin_init(struct GBIN* p, uint8_t mode)
+{
+	memset(p, 0, sizeof(struct GBIN));
+	p->mode = mode;
+	return;
+}
+/* ************************************************************************************************************
+ * uint8_t gbin_chksum(const uint8_t* p, int ct);
+ * @brief	: Gateway checksum
+ * @param	: p = pointer to bytes
+ * @param	: ct = number of bytes
+ * @return	: checksum
+ * ************************************************************************************************************ */
+uint8_t gbin_chksum(const uint8_t* p, int ct)
+{
+	uint32_t x = GBIN_CHKINITIAL;
+	int i;
+	for (i = 0; i < ct; i++)
+		x += *p++;
+	x += (x >> 16);	// Add carries into high half word
+	x += (x >> 16);	// Add carry if previous add generated a carry
+	x += (x >> 8);  // Add high byte of low half word
+	x += (x >> 8);  // Add carry if previous add generated a carry
+	return (uint8_t)x;
+}
+/* ************************************************************************************************************
+ * static int unpack(struct GBIN* p, const uint8_t* pr, int n, struct GBINMSG* pm);
+ * @brief	: Check and unpack seq, id, dlc, payload, checksum
+ * @return	: 1 = msg; -1 = bad checksum; -2 = bad size
+ * ************************************************************************************************************ */
+static int unpack(struct GBIN* p, const uint8_t* pr, int n, struct GBINMSG* pm)
+{
+	uint8_t gap;
+
+	if ((n < 7) || (pr[5] > 8) || (n != (7 + pr[5])))
+	{
+		p->sizeerr += 1;
+		return -2;
+	}
+	if (gbin_chksum(pr, n - 1) != pr[n - 1])
+	{
+		p->chkerr += 1;
+		return -1;
+	}
+	pm->seq = pr[0];
+	pm->id  = pr[1] | (pr[2] << 8) | (pr[3] << 16) | ((uint32_t)pr[4] << 24);
+	pm->dlc = pr[5];
+	memset(pm->uc, 0, 8);
+	memcpy(pm->uc, &pr[6], pm->dlc);
+
+	/* Sequence number: count msgs missing */
+	gap = pm->seq - p->seqnext;
+	if (p->seqok != 0) p->seqgap += gap;
+	p->seqnext = pm->seq + 1;
+	p->seqok   = 1;
+
+	p->msgs += 1;
+	return 1;
+}
+/* ************************************************************************************************************
+ * int gbin_byte(struct GBIN* p, uint8_t c, struct GBINMSG* pm);
+ * @brief	: Add a byte of a binary frame
+ * @param	: p = pointer to decoder
+ * @param	: c = byte
+ * @param	: pm = pointer to msg filled in when a frame completes
+ * @return	: 1 = msg; 0 = frame not complete; -1 = bad checksum; -2 = bad size
+ * ************************************************************************************************************ */
+int gbin_byte(struct GBIN* p, uint8_t c, struct GBINMSG* pm)
+{
+	int n;
+
+	if ((p->esc == 0) && (c == GBIN_ESCAPE))
+	{ // Here, the next byte is data whatever it is
+		p->esc = 1;
+		return 0;
+	}
+	if ((p->esc == 0) && (c == GBIN_FRAME))
+	{ // Here, end of frame
+		n = p->n;
+		p->n = 0;
+		if (p->over != 0)
+		{
+			p->over = 0;
+			p->sizeerr += 1;
+			return -2;
+		}
+		return unpack(p, p->raw, n, pm);
+	}
+	p->esc = 0;
+	if (p->n >= GBIN_RAWMAX)
+	{
+		p->over = 1;
+		return 0;
+	}
+	p->raw[p->n++] = c;
+	return 0;
+}
+/* ************************************************************************************************************
+ * int gbin_line(struct GBIN* p, const char* pline, struct GBINMSG* pm);
+ * @brief	: Decode an ascii/hex line
+ * @param	: p = pointer to decoder (counts)
+ * @param	: pline = line, with or without '\n'
+ * @param	: pm = pointer to msg
+ * @return	: 1 = msg; -1 = bad checksum; -2 = bad size or not hex
+ * ************************************************************************************************************ */
+int gbin_line(struct GBIN* p, const char* pline, struct GBINMSG* pm)
+{
+	uint8_t b[GBIN_RAWMAX];
+	int nc = strcspn(pline, "\r\n");
+	int n;
+
+	if (nc > (GBIN_RAWMAX * 2))
+	{
+		p->sizeerr += 1;
+		return -2;
+	}
+	n = hexcodec_decode(b, pline, nc);
+	if (n < 0)
+	{ // Odd length, or not hex
+		p->sizeerr += 1;
+		return -2;
+	}
+	return unpack(p, b, n, pm);
+}
+/* ************************************************************************************************************
+ * int gbin_feed(struct GBIN* p, const uint8_t* pin, int n, void (*pfunc)(struct GBINMSG* pm, void* parg), void* parg);
+ * @brief	: Decode a stream, following the gateway's format switch
+ * @param	: p = pointer to decoder
+ * @param	: pin = pointer to bytes received
+ * @param	: n = number of bytes
+ * @param	: pfunc = called for each good msg
+ * @param	: parg = passed to 'pfunc'
+ * @return	: number of good msgs
+ * ************************************************************************************************************ */
+int gbin_feed(struct GBIN* p, const uint8_t* pin, int n, void (*pfunc)(struct GBINMSG* pm, void* parg), void* parg)
+{
+	struct GBINMSG m;
+	int ret;
+	int ct = 0;
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		if (p->mode == GBIN_MODE_BIN)
+		{
+			ret = gbin_byte(p, pin[i], &m);
+		}
+		else
+		{
+			ret = 0;
+			if (pin[i] == '\n')
+			{
+				p->asc[p->ln] = 0;
+				if (p->ln > 0) ret = gbin_line(p, p->asc, &m);
+				p->ln = 0;
+			}
+			else if (p->ln < (GBIN_ASCMAX - 1))
+			{
+				p->asc[p->ln++] = pin[i];
+			}
+		}
+		if (ret != 1) continue;
+
+		ct += 1;
+		if (pfunc != NULL) (*pfunc)(&m, parg);
+
+		/* Gateway switched format after this msg? */
+		if ((m.id == GBIN_CANID_GATEMODE) && (m.dlc >= 2) && (m.uc[1] == 1) && (m.uc[0] <= GBIN_MODE_BIN))
+		{
+			p->mode = m.uc[0];
+			p->n    = 0;
+			p->ln   = 0;
+			p->esc  = 0;
+		}
+	}
+	return ct;
+}
+/* ************************************************************************************************************
+ * int gbin_fmtline(char* pout, struct GBINMSG* pm);
+ * @brief	: Make the ascii/hex line the gateway would have sent
+ * @param	: pout = output [GBIN_ASCMAX]
+ * @param	: pm = pointer to msg
+ * @return	: number of chars (with '\n', not '\0')
+ * ************************************************************************************************************ */
+static int raw(uint8_t* pr, struct GBINMSG* pm)
+{
+	pr[0] = pm->seq;
+	pr[1] = pm->id;
+	pr[2] = pm->id >> 8;
+	pr[3] = pm->id >> 16;
+	pr[4] = pm->id >> 24;
+	pr[5] = pm->dlc;
+	memcpy(&pr[6], pm->uc, pm->dlc);
+	pr[6 + pm->dlc] = gbin_chksum(pr, 6 + pm->dlc);
+	return (7 + pm->dlc);
+}
+int gbin_fmtline(char* pout, struct GBINMSG* pm)
+{
+	uint8_t b[GBIN_RAWMAX];
+	char* p = pout;
+	int n = raw(b, pm);
+
+	p += hexcodec_encode(p, b, n);
+	*p++ = '\n';
+	*p = 0;
+	return (p - pout);
+}
+/* ************************************************************************************************************
+ * int gbin_fmtframe(uint8_t* pout, struct GBINMSG* pm);
+ * @brief	: Make the binary frame the gateway would have sent
+ * @param	: pout = output [GBIN_RAWMAX * 2 + 1]
+ * @param	: pm = pointer to msg
+ * @return	: number of bytes
+ * ************************************************************************************************************ */
+int gbin_fmtframe(uint8_t* pout, struct GBINMSG* pm)
+{
+	uint8_t b[GBIN_RAWMAX];
+	uint8_t* p = pout;
+	int n = raw(b, pm);
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		if ((b[i] == GBIN_FRAME) || (b[i] == GBIN_ESCAPE))
+			*p++ = GBIN_ESCAPE;
+		*p++ = b[i];
+	}
+	*p++ = GBIN_FRAME;
+	return (p - pout);
+}
+/* ************************************************************************************************************
+ * int gbin_modereq(char* pout, uint8_t seq, uint8_t mode);
+ * @brief	: Make the ascii/hex line the PC sends to ask for a CAN->PC format
+ * @param	: pout = output [GBIN_ASCMAX]
+ * @param	: seq = PC->gateway sequence number
+ * @param	: mode = GBIN_MODE_ASCII or GBIN_MODE_BIN
+ * @return	: number of chars (with '\n', not '\0')
+ * ************************************************************************************************************ */
+int gbin_modereq(char* pout, uint8_t seq, uint8_t mode)
+{
+	struct GBINMSG m;
+	m.seq   = seq;
+	m.id    = GBIN_CANID_GATEMODE;
+	m.dlc   = 1;
+	m.uc[0] = mode;
+	return gbin_fmtline(pout, &m);
+}
@@ -0,0 +1,116 @@
+/* *****************************************************************************
+* File Name          : gatewaybin.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Decode gateway CAN->PC msgs: ascii/hex lines and binary frames
+****************************************************************************** */
+/*
+Both formats carry the same bytes--
+  seq (1), CAN id (4, low byte first), dlc (1), payload (dlc), checksum (1)
+Ascii/hex: each byte as two hex chars, then '\n'.
+Binary:    bytes as is, with GBIN_ESCAPE in front of any GBIN_FRAME or
+           GBIN_ESCAPE byte, then an unescaped GBIN_FRAME.
+
+The gateway starts in ascii/hex.  'gbin_modereq' makes the line the PC sends
+to switch; the reply (CANID_GATEMODE) is the last msg in the old format.
+*/
+
+#ifndef __GATEWAYBIN
+#define __GATEWAYBIN
+
+#include <stdint.h>
+
+#define GBIN_FRAME      '\n'   // CAN_PC_FRAMEBOUNDARY
+#define GBIN_ESCAPE     0x7D   // CAN_PC_ESCAPE
+#define GBIN_CHKINITIAL 0xa5a5 // CHECKSUM_INITIAL
+
+#define GBIN_CANID_GATEMODE 0xFFC00000 // See GatewayTask.h
+#define GBIN_CANID_GATELOSS 0xFFE00000
+#define GBIN_MODE_ASCII 0
+#define GBIN_MODE_BIN   1
+
+#define GBIN_RAWMAX 16 // seq + id + dlc + 8 payload + checksum, plus one spare
+#define GBIN_ASCMAX (GBIN_RAWMAX * 2 + 2) // Ascii/hex line, '\n', '\0'
+
+struct GBINMSG
+{
+	uint32_t id;
+	uint8_t  seq;
+	uint8_t  dlc;
+	uint8_t  uc[8];
+};
+
+struct GBIN
+{
+	uint8_t raw[GBIN_RAWMAX]; // Unstuffed bytes of frame being built
+	char    asc[GBIN_ASCMAX]; // Ascii/hex line being built
+	uint8_t n;                // Bytes in 'raw'
+	uint8_t ln;               // Chars in 'asc'
+	uint8_t esc;              // 1 = previous byte was an escape
+	uint8_t over;             // 1 = frame too long; drop until frame end
+	uint8_t mode;             // GBIN_MODE_ASCII, GBIN_MODE_BIN
+	uint8_t seqnext;          // Expected next sequence number
+	uint8_t seqok;            // 1 = 'seqnext' is valid
+	/* Counts */
+	uint32_t msgs;            // Good msgs
+	uint32_t chkerr;          // Checksum errors
+	uint32_t sizeerr;         // Too short, too long, or dlc disagrees with length
+	uint32_t seqgap;          // Msgs missing by sequence number
+};
+
+/* ************************************************************************************************************ */
+void gbin_init(struct GBIN* p, uint8_t mode);
+/* @brief	: Reset decoder and counts
+ * @param	: p = pointer to decoder
+ * @param	: mode = GBIN_MODE_ASCII or GBIN_MODE_BIN (format expected first)
+ * ************************************************************************************************************ */
+uint8_t gbin_chksum(const uint8_t* p, int ct);
+/* @brief	: Gateway checksum
+ * @param	: p = pointer to bytes
+ * @param	: ct = number of bytes
+ * @return	: checksum
+ * ************************************************************************************************************ */
+int gbin_byte(struct GBIN* p, uint8_t c, struct GBINMSG* pm);
+/* @brief	: Add a byte of a binary frame
+ * @param	: p = pointer to decoder
+ * @param	: c = byte
+ * @param	: pm = pointer to msg filled in when a frame completes
+ * @return	: 1 = msg; 0 = frame not complete; -1 = bad checksum; -2 = bad size
+ * ************************************************************************************************************ */
+int gbin_line(struct GBIN* p, const char* pline, struct GBINMSG* pm);
+/* @brief	: Decode an ascii/hex line
+ * @param	: p = pointer to decoder (counts)
+ * @param	: pline = line, with or without '\n'
+ * @param	: pm = pointer to msg
+ * @return	: 1 = msg; -1 = bad checksum; -2 = bad size or not hex
+ * ************************************************************************************************************ */
+int gbin_feed(struct GBIN* p, const uint8_t* pin, int n, void (*pfunc)(struct GBINMSG* pm, void* parg), void* parg);
+/* @brief	: Decode a stream, following the gateway's format switch
+ * @param	: p = pointer to decoder
+ * @param	: pin = pointer to bytes received
+ * @param	: n = number of bytes
+ * @param	: pfunc = called for each good msg
+ * @param	: parg = passed to 'pfunc'
+ * @return	: number of good msgs
+ * ************************************************************************************************************ */
+int gbin_fmtline(char* pout, struct GBINMSG* pm);
+/* @brief	: Make the ascii/hex line the gateway would have sent
+ * @param	: pout = output [GBIN_ASCMAX]
+ * @param	: pm = pointer to msg
+ * @return	: number of chars (with '\n', not '\0')
+ * ************************************************************************************************************ */
+int gbin_fmtframe(uint8_t* pout, struct GBINMSG* pm);
+/* @brief	: Make the binary frame the gateway would have sent
+ * @param	: pout = output [GBIN_RAWMAX * 2 + 1]
+ * @param	: pm = pointer to msg
+ * @return	: number of bytes
+ * ************************************************************************************************************ */
+int gbin_modereq(char* pout, uint8_t seq, uint8_t mode);
+/* @brief	: Make the ascii/hex line the PC sends to ask for a CAN->PC format
+ * @param	: pout = output [GBIN_ASCMAX]
+ * @param	: seq = PC->gateway sequence number
+ * @param	: mode = GBIN_MODE_ASCII or GBIN_MODE_BIN
+ * @return	: number of chars (with '\n', not '\0')
+ * ************************************************************************************************************ */
+
+#endif
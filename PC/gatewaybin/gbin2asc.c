@@ -0,0 +1,70 @@
+/* *****************************************************************************
+* File Name          : gbin2asc.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Gateway stream (ascii/hex and binary frames) to ascii/hex lines
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 gbin2asc.c gatewaybin.c ../../Ourwares/hexcodec.c -I../../Ourwares -o gbin2asc
+./gbin2asc < /dev/ttyUSB0 | ../canfmt/canfmt
+./gbin2asc -r 1 > /dev/ttyUSB0    (ascii/hex line asking the gateway for binary)
+
+Output lines are the same as the gateway sends in ascii/hex mode, so
+'canfmt' and the other tools work unchanged.  Counts go to stderr at EOF.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdint.h>
+#include "gatewaybin.h"
+
+static void out(struct GBINMSG* pm, void* parg)
+{
+	char line[GBIN_ASCMAX];
+	gbin_fmtline(line, pm);
+	fputs(line, stdout);
+	return;
+}
+
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	struct GBIN gbin;
+	uint8_t b[4096];
+	char line[GBIN_ASCMAX];
+	uint8_t mode = GBIN_MODE_ASCII;
+	int n;
+	int c;
+
+	while ((c = getopt(argc, argv, "br:")) != -1)
+	{
+		switch (c)
+		{
+		case 'b': // Stream starts in binary
+			mode = GBIN_MODE_BIN;
+			break;
+		case 'r': // Print the mode request line, and quit
+			gbin_modereq(line, 0, atoi(optarg));
+			fputs(line, stdout);
+			return 0;
+		default:
+			fprintf(stderr, "usage: %s [-b] [-r mode] < stream\n", argv[0]);
+			return 1;
+		}
+	}
+
+	gbin_init(&gbin, mode);
+	while ((n = fread(b, 1, sizeof(b), stdin)) > 0)
+	{
+		gbin_feed(&gbin, b, n, out, NULL);
+	}
+	fflush(stdout);
+	fprintf(stderr, "msgs %u chkerr %u sizeerr %u seqgap %u mode %u\n",
+		gbin.msgs, gbin.chkerr, gbin.sizeerr, gbin.seqgap, gbin.mode);
+	return 0;
+}
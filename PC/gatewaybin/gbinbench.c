@@ -0,0 +1,135 @@
+/* *****************************************************************************
+* File Name          : gbinbench.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Ascii/hex vs binary gateway format: link rate and decode rate
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 gbinbench.c gatewaybin.c ../../Ourwares/hexcodec.c -I../../Ourwares -o gbinbench && ./gbinbench
+
+Makes random CAN msgs (dlc 0-8, with some '\n' and escape bytes), sends
+them as the gateway would--ascii/hex, a mode switch, then binary--through
+'gbin_feed', and checks every msg comes back unchanged.  Then reports
+bytes per msg, msgs/sec a serial link can carry (10 bits per byte), and
+msgs/sec this PC decodes.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "gatewaybin.h"
+
+#define NMSG 200000
+
+static struct GBINMSG* pmsg; // [NMSG] msgs sent
+static int nchk;             // Index of next msg to check
+static int nbad;             // Msgs that did not match
+
+static void check(struct GBINMSG* pm, void* parg)
+{
+	struct GBINMSG* ps = &pmsg[nchk++];
+	if ((pm->id != ps->id) || (pm->seq != ps->seq) || (pm->dlc != ps->dlc) ||
+		 (memcmp(pm->uc, ps->uc, pm->dlc) != 0))
+		nbad += 1;
+	return;
+}
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec + ts.tv_nsec * 1E-9);
+}
+/* Encode 'ct' msgs starting at 'i', in format 'mode' */
+static int enc(uint8_t* pout, int i, int ct, uint8_t mode)
+{
+	uint8_t* p = pout;
+	for (; ct > 0; ct--, i++)
+	{
+		if (mode == GBIN_MODE_BIN)
+			p += gbin_fmtframe(p, &pmsg[i]);
+		else
+			p += gbin_fmtline((char*)p, &pmsg[i]);
+	}
+	return (p - pout);
+}
+/* Decode 'n' bytes 'reps' times; return msgs/sec */
+static double rate(uint8_t* p, int n, uint8_t mode, int msgs, int reps)
+{
+	struct GBIN gbin;
+	double t0 = now();
+	int i;
+	for (i = 0; i < reps; i++)
+	{
+		gbin_init(&gbin, mode);
+		gbin_feed(&gbin, p, n, NULL, NULL);
+	}
+	return ((double)msgs * reps) / (now() - t0);
+}
+
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	static const int baud[] = {115200, 460800, 921600, 2000000};
+	struct GBIN gbin;
+	uint8_t* pasc;
+	uint8_t* pbin;
+	uint8_t* ps;
+	int nasc, nbin, n;
+	int half = NMSG / 2;
+	int i, j;
+
+	pmsg = (struct GBINMSG*)calloc(NMSG + 1, sizeof(struct GBINMSG));
+	pasc = (uint8_t*)malloc(NMSG * GBIN_ASCMAX);
+	pbin = (uint8_t*)malloc(NMSG * (GBIN_RAWMAX * 2 + 1));
+	ps   = (uint8_t*)malloc(NMSG * GBIN_ASCMAX);
+	if ((pmsg == NULL) || (pasc == NULL) || (pbin == NULL) || (ps == NULL)) return 1;
+
+	srand(1);
+	for (i = 0; i <= NMSG; i++)
+	{
+		pmsg[i].seq = i;
+		pmsg[i].id  = (rand() & 0x7ff) << 21;
+		pmsg[i].dlc = rand() % 9;
+		for (j = 0; j < pmsg[i].dlc; j++)
+		{
+			switch (rand() & 7)
+			{
+			case 0:  pmsg[i].uc[j] = GBIN_FRAME;  break;
+			case 1:  pmsg[i].uc[j] = GBIN_ESCAPE; break;
+			default: pmsg[i].uc[j] = rand();      break;
+			}
+		}
+	}
+
+	/* Round trip: first half ascii/hex, mode switch reply, second half binary. */
+	pmsg[half].id    = GBIN_CANID_GATEMODE;
+	pmsg[half].dlc   = 2;
+	pmsg[half].uc[0] = GBIN_MODE_BIN;
+	pmsg[half].uc[1] = 1;
+	n  = enc(ps, 0, half + 1, GBIN_MODE_ASCII);
+	n += enc(ps + n, half + 1, NMSG - half - 1, GBIN_MODE_BIN);
+	gbin_init(&gbin, GBIN_MODE_ASCII);
+	for (i = 0; i < n; i += 61) // Arbitrary chunks, as from a read()
+		gbin_feed(&gbin, ps + i, ((n - i) < 61) ? (n - i) : 61, check, NULL);
+	printf("round trip: msgs %d/%d bad %d chkerr %u sizeerr %u seqgap %u\n",
+		nchk, NMSG, nbad, gbin.chkerr, gbin.sizeerr, gbin.seqgap);
+
+	/* Same msgs, each format alone */
+	nasc = enc(pasc, 0, NMSG, GBIN_MODE_ASCII);
+	nbin = enc(pbin, 0, NMSG, GBIN_MODE_BIN);
+	printf("bytes/msg:  ascii %.2f  binary %.2f  (ratio %.2f)\n",
+		(double)nasc / NMSG, (double)nbin / NMSG, (double)nasc / nbin);
+	for (i = 0; i < (int)(sizeof(baud)/sizeof(baud[0])); i++)
+	{
+		printf("%8d baud msgs/sec: ascii %7.0f  binary %7.0f\n", baud[i],
+			(baud[i] / 10.0) / ((double)nasc / NMSG), (baud[i] / 10.0) / ((double)nbin / NMSG));
+	}
+	printf("decode msgs/sec: ascii %.3g  binary %.3g\n",
+		rate(pasc, nasc, GBIN_MODE_ASCII, NMSG, 10), rate(pbin, nbin, GBIN_MODE_BIN, NMSG, 10));
+	return (nbad != 0) || (nchk != NMSG);
+}
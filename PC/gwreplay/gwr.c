@@ -0,0 +1,340 @@
+/* *****************************************************************************
+* File Name          : gwr.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Replay a gateway log through the firmware PC->CAN parsers
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 gwr.c gwreplay.c ../../Ourwares/gateway_PCtoCAN.c ../../Ourwares/PC_gateway_comm.c ../../Ourwares/hexcodec.c -Istub -I../../Ourwares -o gwr
+
+Log on stdin.  Uart DMA path (GatewayTask), as fast as it goes--
+./gwr < ../../docs/data/log200220-2.txt
+
+Real time (paced by the 64/sec time sync msgs), or 'N' times real time--
+./gwr -r 1 < log
+./gwr -r 20 < log
+
+-c chunk: chars stored by the DMA between unloads; 'min:max' = random
+   sizes (seeded with -s).  Less than the DMA buffer size (-d, default 128).
+-l lines: CAN msg line buffers (default 16)
+-a 1|2: char by char path instead (PC_msg_getASCII, then CANuncompress or
+   CANuncompress_G)
+-o: each msg to stdout: line seq id dlc error payload (same input, same
+   output: a run can be diffed against another)
+-f every: error detection check: about one fault per 'every' lines (see
+   gwreplay.h) is put in a copy of the log; the copy and the log are both
+   run and every line's error bits are checked against what the fault
+   should give.  Exit 1 on any miss.  With -a, the lines each kind of
+   fault got flagged are counted (that path has no sequence check).
+-s seed: faults and random chunks (same seed, same run)
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <time.h>
+#include "gwreplay.h"
+
+#define SYNCID 0x00400000 // CANID_HB_TIMESYNC: 64 per sec
+#define TICKHZ 64
+
+struct RUN
+{
+	/* Settings */
+	int      asc;       // 0 = DMA path; 1, 2 = char path mode
+	uint16_t dmasize;
+	uint8_t  numline;
+	uint32_t cmin;      // Chunk size range
+	uint32_t cmax;
+	uint32_t seed;
+	double   speed;     // 0 = max; else times real time
+	int      print;
+	uint8_t* perr;      // Save error bits (DMA) or -return (char path) per msg, if not NULL
+	uint32_t nerr;      // Room in 'perr'
+
+	/* Results */
+	uint32_t nmsg;
+	uint32_t nbits[8];  // Msgs with each error bit
+	uint32_t nbad;      // Char path: msgs with ret != 1
+	uint32_t ntick;
+	uint32_t lost;
+	double   lagmax;    // Paced: most behind, secs
+	double   secs;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec + ts.tv_nsec * 1E-9);
+}
+static void msg(const struct GWRMSG* pm, void* parg)
+{
+	struct RUN* pr = (struct RUN*)parg;
+	int i;
+
+	if (pm->id == SYNCID) pr->ntick += 1;
+	if (pr->asc == 0)
+	{
+		for (i = 0; i < 8; i++)
+			if ((pm->err & (1 << i)) != 0) pr->nbits[i] += 1;
+	}
+	else if (pm->ret != 1)
+		pr->nbad += 1;
+	if ((pr->perr != NULL) && (pm->line < pr->nerr))
+		pr->perr[pm->line] = (pr->asc == 0) ? pm->err : (uint8_t)(1 - pm->ret);
+	pr->nmsg += 1;
+	if (pr->print == 0) return;
+
+	printf("%8u %02X %08X %u %3d ", pm->line, pm->seq, pm->id, pm->dlc, (pr->asc == 0) ? pm->err : pm->ret);
+	for (i = 0; (i < pm->dlc) && (i < 8); i++)
+		printf("%02X", pm->uc[i]);
+	printf("\n");
+	return;
+}
+/* Feed a log in chunks, pacing to the time sync msgs if asked */
+static int run(struct RUN* pr, const char* pc, size_t n)
+{
+	struct GWRDMA dma;
+	struct GWRASC asc;
+	struct timespec ts;
+	uint32_t x = (pr->seed == 0) ? 0x2545f491 : pr->seed;
+	uint32_t k;
+	double t0, t, tgt;
+
+	if (pr->asc == 0)
+	{
+		if (gwr_dma_init(&dma, pr->dmasize, pr->numline) != 0) return -1;
+	}
+	else
+		gwr_asc_init(&asc, pr->asc);
+
+	t0 = now();
+	while (n > 0)
+	{
+		k = pr->cmin;
+		if (pr->cmax > pr->cmin)
+		{
+			x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+			k += x % (pr->cmax - pr->cmin + 1);
+		}
+		if (k > n) k = n;
+		if (pr->asc == 0)
+			gwr_dma_feed(&dma, pc, k, msg, pr);
+		else
+			gwr_asc_feed(&asc, pc, k, msg, pr);
+		pc += k;
+		n  -= k;
+
+		if (pr->speed > 0)
+		{ // Paced: wait for when this tick is due
+			tgt = (double)pr->ntick / TICKHZ / pr->speed;
+			t = now() - t0;
+			if (t < tgt)
+			{
+				t = tgt - t;
+				ts.tv_sec  = t;
+				ts.tv_nsec = (t - ts.tv_sec) * 1E9;
+				nanosleep(&ts, NULL);
+			}
+			else if ((t - tgt) > pr->lagmax)
+				pr->lagmax = t - tgt;
+		}
+	}
+	pr->secs = now() - t0;
+	if (pr->asc == 0)
+	{
+		pr->lost = dma.lost;
+		gwr_dma_free(&dma);
+	}
+	return 0;
+}
+static void stats(const struct RUN* pr, size_t n, const char* pname)
+{
+	static const char* bitname[6] = {"nothex", "chksum", "short", "seq", "toomany", "dlc"};
+	int i;
+
+	fprintf(stderr, "%s: %u msgs, %.1f MB in %.3f s: %.1f MB/s, %.2f M msgs/s", pname, pr->nmsg,
+		n / 1E6, pr->secs, n / pr->secs / 1E6, pr->nmsg / pr->secs / 1E6);
+	if (pr->ntick != 0) fprintf(stderr, ", %.1f s of log", (double)pr->ntick / TICKHZ);
+	fprintf(stderr, "\n");
+	if (pr->speed > 0) fprintf(stderr, "  paced x%g: most behind %.3f s\n", pr->speed, pr->lagmax);
+	if (pr->asc != 0)
+	{
+		fprintf(stderr, "  not OK (getASCII/uncompress): %u\n", pr->nbad);
+		return;
+	}
+	fprintf(stderr, " ");
+	for (i = 0; i < 6; i++)
+		fprintf(stderr, " %s %u", bitname[i], pr->nbits[i]);
+	fprintf(stderr, "  lost %u\n", pr->lost);
+	return;
+}
+/* Error detection check */
+static int faults(struct RUN* pr, const char* pin, size_t n, uint32_t every)
+{
+	static const char* fname[GWRF_NUM] = {"none", "flip", "nothex", "short", "drop"};
+	struct GWRLINE* pl;
+	struct RUN rbase = *pr;
+	struct RUN rflt  = *pr;
+	uint8_t* pbase;
+	uint8_t* pflt;
+	uint8_t b, e;
+	uint32_t nput[GWRF_NUM] = {0};
+	uint32_t nhit[GWRF_NUM] = {0};
+	uint32_t nl;
+	uint32_t i;
+	uint32_t nmiss = 0;
+	size_t nout;
+	char* pout;
+
+	if (gwr_inject(pin, n, every, pr->seed, &pout, &nout, &pl, &nl) != 0) return -1;
+	pbase = (uint8_t*)calloc(n + 1, 1);
+	pflt  = (uint8_t*)calloc(nl + 1, 1);
+	if ((pbase == NULL) || (pflt == NULL)) return -1;
+	rbase.perr = pbase;
+	rbase.nerr = n + 1;
+	rflt.perr  = pflt;
+	rflt.nerr  = nl + 1;
+	rbase.print = rflt.print = 0;
+	rbase.speed = rflt.speed = 0;
+	if ((run(&rbase, pin, n) != 0) || (run(&rflt, pout, nout) != 0)) return -1;
+	stats(&rflt, nout, "faults");
+
+	if ((rbase.lost != 0) || (rflt.lost != 0))
+	{
+		fprintf(stderr, "line buffers overrun (chunk too big for -l): no check\n");
+		return 1;
+	}
+	if (rflt.nmsg != nl)
+	{
+		fprintf(stderr, "msgs %u, lines %u: MISMATCH\n", rflt.nmsg, nl);
+		return 1;
+	}
+	for (i = 0; i < nl; i++)
+	{
+		b = pbase[pl[i].orig];
+		e = pflt[i];
+		nput[pl[i].fault] += 1;
+		if (pr->asc != 0)
+		{ // Char path: flagged or not
+			if (e != 0) nhit[pl[i].fault] += 1;
+			continue;
+		}
+		if ( ((pl[i].fault != 0) && ((e & pl[i].exp) == pl[i].exp))
+		  || ((pl[i].fault == 0) && (e == (b | pl[i].exp))) )
+		{
+			nhit[pl[i].fault] += 1;
+			continue;
+		}
+		if (nmiss++ < 10)
+			fprintf(stderr, "  line %u (log line %u) fault %s: error %02X, expected %02X%s\n", i, pl[i].orig,
+				fname[pl[i].fault], e, pl[i].exp | ((pl[i].fault == 0) ? b : 0),
+				(pl[i].fault == 0) ? " exactly" : " at least");
+	}
+	for (i = 1; i < GWRF_NUM; i++)
+		fprintf(stderr, "  %-7s %6u put, %6u %s\n", fname[i], nput[i], nhit[i], (pr->asc == 0) ? "detected" : "flagged");
+	if (pr->asc == 0)
+		fprintf(stderr, "  other   %6u lines, %6u as the log without faults (plus seq after short)\n", nput[0], nhit[0]);
+	free(pout);
+	free(pl);
+	free(pbase);
+	free(pflt);
+	if (nmiss != 0)
+	{
+		fprintf(stderr, "FAIL: %u lines not as expected\n", nmiss);
+		return 1;
+	}
+	fprintf(stderr, "%s\n", (pr->asc == 0) ? "PASS" : "(char path: counts only)");
+	return 0;
+}
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	struct RUN r;
+	uint32_t every = 0;
+	size_t size = 1 << 20;
+	size_t n = 0;
+	size_t k;
+	char* pin;
+	char* ps;
+	int c;
+
+	memset(&r, 0, sizeof(r));
+	r.dmasize = GWR_DMASIZE;
+	r.numline = GWR_NUMLINE;
+	r.cmin = r.cmax = 64;
+	r.seed = 1;
+
+	while ((c = getopt(argc, argv, "r:c:d:l:a:f:s:o")) != -1)
+	{
+		switch (c)
+		{
+		case 'r': r.speed = strtod(optarg, NULL); break;
+		case 'c':
+			r.cmin = r.cmax = strtoul(optarg, &ps, 10);
+			if (*ps == ':') r.cmax = strtoul(ps + 1, NULL, 10);
+			break;
+		case 'd': r.dmasize = atoi(optarg); break;
+		case 'l': r.numline = atoi(optarg); break;
+		case 'a':
+			r.asc = atoi(optarg);
+			if ((r.asc != 1) && (r.asc != 2)) goto usage;
+			break;
+		case 'f': every = strtoul(optarg, NULL, 10); break;
+		case 's': r.seed = strtoul(optarg, NULL, 0); break;
+		case 'o': r.print = 1; break;
+		default:
+			goto usage;
+		}
+	}
+	if ((optind != argc) || (r.cmin == 0) || (r.cmax < r.cmin) || (r.numline == 0)) goto usage;
+	if ((r.asc == 0) && (r.cmax >= r.dmasize))
+	{
+		fprintf(stderr, "gwr: chunk must be less than the DMA buffer (%u)\n", r.dmasize);
+		return 1;
+	}
+
+	/* The whole log */
+	pin = (char*)malloc(size);
+	while (pin != NULL)
+	{
+		k = fread(pin + n, 1, size - n, stdin);
+		n += k;
+		if (k == 0) break;
+		if (n == size)
+		{
+			size *= 2;
+			pin = (char*)realloc(pin, size);
+		}
+	}
+	if (pin == NULL)
+	{
+		fprintf(stderr, "gwr: out of memory\n");
+		return 1;
+	}
+
+	if (every != 0)
+	{
+		c = faults(&r, pin, n, every);
+		if (c < 0) fprintf(stderr, "gwr: out of memory\n");
+		return (c != 0);
+	}
+	if (run(&r, pin, n) != 0)
+	{
+		fprintf(stderr, "gwr: out of memory\n");
+		return 1;
+	}
+	fflush(stdout);
+	stats(&r, n, (r.asc == 0) ? "dma" : "ascii");
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-r speed] [-c chunk|min:max] [-d dmasize] [-l lines] [-a 1|2] [-f every] [-s seed] [-o] < log\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,125 @@
+/* *****************************************************************************
+* File Name          : gwrbench.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : gwreplay: parser throughput vs DMA chunk size, and the char path
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 gwrbench.c gwreplay.c ../../Ourwares/gateway_PCtoCAN.c ../../Ourwares/PC_gateway_comm.c ../../Ourwares/hexcodec.c -Istub -I../../Ourwares -o gwrbench
+./gwrbench ../../docs/data/log200220-2.txt [MB]
+
+The sample log is copied in memory to 'MB' (default 64).  Each run hashes
+the msgs it gets (line, id, dlc, payload, error); the DMA runs must all
+give the same hash whatever the chunk size.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "gwreplay.h"
+
+struct SUM
+{
+	uint64_t n;
+	uint64_t h;
+};
+static void sum(const struct GWRMSG* pm, void* parg)
+{
+	struct SUM* ps = (struct SUM*)parg;
+	uint64_t h = 14695981039346656037ull;
+	const uint8_t* pc = (const uint8_t*)pm;
+	size_t i;
+
+	for (i = 0; i < sizeof(struct GWRMSG); i++)
+		h = (h ^ pc[i]) * 1099511628211ull;
+	ps->n += 1;
+	ps->h += h;
+	return;
+}
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec + ts.tv_nsec * 1E-9);
+}
+
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	static const uint32_t chunk[] = {1, 16, 64, 127};
+	struct GWRDMA dma;
+	struct GWRASC asc;
+	struct SUM s;
+	struct SUM s0;
+	size_t nmb = 64;
+	size_t nsmp;
+	size_t n;
+	size_t i;
+	size_t k;
+	char* plog;
+	FILE* fp;
+	unsigned j;
+	int mode;
+	double t;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s samplelog [MB]\n", argv[0]);
+		return 1;
+	}
+	if (argc > 2) nmb = atoi(argv[2]);
+
+	/* Big log from copies of the sample */
+	fp = fopen(argv[1], "r");
+	if (fp == NULL)
+	{
+		perror(argv[1]);
+		return 1;
+	}
+	fseek(fp, 0, SEEK_END);
+	nsmp = ftell(fp);
+	rewind(fp);
+	n = ((nmb << 20) / nsmp + 1) * nsmp;
+	plog = (char*)malloc(n);
+	if ((plog == NULL) || (nsmp == 0) || (fread(plog, 1, nsmp, fp) != nsmp)) return 1;
+	fclose(fp);
+	for (i = nsmp; i < n; i += nsmp)
+		memcpy(plog + i, plog, nsmp);
+
+	printf("%.1f MB\n%-22s %9s %8s %10s %s\n", n / 1E6, "path", "msgs", "MB/s", "M msgs/s", "hash");
+	memset(&s0, 0, sizeof(s0));
+	for (j = 0; j < sizeof(chunk) / sizeof(chunk[0]); j++)
+	{
+		memset(&s, 0, sizeof(s));
+		if (gwr_dma_init(&dma, GWR_DMASIZE, GWR_NUMLINE) != 0) return 1;
+		t = now();
+		for (i = 0; i < n; i += k)
+		{
+			k = (n - i < chunk[j]) ? (n - i) : chunk[j];
+			gwr_dma_feed(&dma, plog + i, k, sum, &s);
+		}
+		t = now() - t;
+		if (j == 0) s0 = s;
+		printf("dma, chunk %3u         %9lu %8.1f %10.2f %016lx%s%s\n", chunk[j], (unsigned long)s.n,
+			n / t / 1E6, s.n / t / 1E6, (unsigned long)s.h,
+			((s.n == s0.n) && (s.h == s0.h)) ? "" : "  DIFFERENT", (dma.lost != 0) ? "  LOST" : "");
+		gwr_dma_free(&dma);
+	}
+	for (mode = 2; mode >= 1; mode--)
+	{
+		memset(&s, 0, sizeof(s));
+		gwr_asc_init(&asc, mode);
+		t = now();
+		gwr_asc_feed(&asc, plog, n, sum, &s);
+		t = now() - t;
+		printf("char, %-16s %9lu %8.1f %10.2f %016lx\n", (mode == 2) ? "CANuncompress_G" : "CANuncompress",
+			(unsigned long)s.n, n / t / 1E6, s.n / t / 1E6, (unsigned long)s.h);
+	}
+	free(plog);
+	return 0;
+}
@@ -0,0 +1,374 @@
+/* *****************************************************************************
+* File Name          : gwreplay.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Replay gateway logs through the firmware PC->CAN parsers on the PC
+****************************************************************************** */
+/*
+Library for 'gwr' and 'gwrbench' (see those for gcc lines).
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "gwreplay.h"
+#include "hexcodec.h"
+
+uint32_t gwr_notify; // Counted by the xTaskNotifyFromISR stand-in (stub/task.h)
+
+/* PC_gateway_comm.c: PC_msg_prepASCII sends with this; not used here */
+void vSerialTaskSendQueueBuf(struct SERIALSENDTASKBCB** ppbcb)
+{
+	return;
+}
+/* ************************************************************************************************************
+ * int gwr_dma_init(struct GWRDMA* p, uint16_t dmasize, uint8_t numline);
+ * @brief	: Set up a simulated uart DMA receive in CAN mode (as xSerialTaskRxAdduart)
+ * @param	: p = pointer to sim
+ * @param	: dmasize = chars in circular DMA buffer
+ * @param	: numline = number of CAN msg line buffers
+ * @return	: 0 = OK; -1 = out of memory
+ * ************************************************************************************************************ */
+int gwr_dma_init(struct GWRDMA* p, uint16_t dmasize, uint8_t numline)
+{
+	struct SERIALRCVBCB* pb = &p->bcb;
+	uint16_t linesize = sizeof(struct CANRCVBUFPLUS);
+	char* pbuf;
+
+	memset(p, 0, sizeof(struct GWRDMA));
+	p->huart.hdmarx = &p->hdma;
+	p->hdma.ndtr    = dmasize;
+
+	pbuf = (char*)calloc(numline, linesize);
+	if (pbuf == NULL) return -1;
+	pb->pnext     = pb;
+	pb->phuart    = &p->huart;
+	pb->tskhandle = (osThreadId)p; // Not NULL: unload notifies (counted)
+	pb->linesize  = linesize;
+	pb->numline   = numline;
+	pb->numlinexsize = numline * linesize;
+	pb->pbegin    = pbuf;
+	pb->padd      = pbuf;
+	pb->ptake     = pbuf;
+	pb->pwork     = pbuf;
+	pb->pworkend  = pbuf + linesize - 2;
+	pb->pend      = pbuf + numline * linesize;
+	pb->dmaflag   = 1;
+	pb->CANmode   = 1;
+
+	pbuf = (char*)calloc(dmasize, sizeof(char));
+	if (pbuf == NULL) return -1;
+	pb->pbegindma = pbuf;
+	pb->penddma   = pbuf + dmasize;
+	pb->ptakedma  = pbuf;
+	pb->dmasize   = dmasize;
+
+	if (gateway_PCtoCAN_init(pb) == NULL) return -1;
+	return 0;
+}
+/* ************************************************************************************************************
+ * void gwr_dma_free(struct GWRDMA* p);
+ * @brief	: Release sim buffers
+ * ************************************************************************************************************ */
+void gwr_dma_free(struct GWRDMA* p)
+{
+	free(p->bcb.pbegin);
+	free(p->bcb.pbegindma);
+	free(p->bcb.pgptc);
+	memset(p, 0, sizeof(struct GWRDMA));
+	return;
+}
+/* ************************************************************************************************************
+ * uint32_t gwr_dma_feed(struct GWRDMA* p, const char* pc, uint32_t n,
+ *	void (*pmsg)(const struct GWRMSG* pm, void* parg), void* parg);
+ * @brief	: DMA stores 'n' chars, then unload and take the CAN msgs
+ * @param	: p = pointer to sim
+ * @param	: pc = chars
+ * @param	: n = number of chars (less than dmasize)
+ * @param	: pmsg = called with each CAN msg (NULL = none)
+ * @param	: parg = passed to 'pmsg'
+ * @return	: number of CAN msgs taken
+ * ************************************************************************************************************ */
+uint32_t gwr_dma_feed(struct GWRDMA* p, const char* pc, uint32_t n,
+	void (*pmsg)(const struct GWRMSG* pm, void* parg), void* parg)
+{
+	struct CANRCVBUFPLUS* pcanp;
+	struct GWRMSG m;
+	uint32_t size = p->bcb.dmasize;
+	uint32_t k;
+	uint32_t ntaken = 0;
+	uint32_t nnote;
+
+	/* DMA: store, wrapping; NDTR counts down and reloads */
+	while (n > 0)
+	{
+		k = size - p->wr;
+		if (k > n) k = n;
+		memcpy(p->bcb.pbegindma + p->wr, pc, k);
+		pc += k;
+		n  -= k;
+		p->wr += k;
+		if (p->wr == size) p->wr = 0;
+	}
+	p->hdma.ndtr = size - p->wr;
+
+	/* Task: unload, then take the CAN msgs */
+	nnote = gwr_notify;
+	gateway_PCtoCAN_unloaddma(&p->bcb);
+	nnote = gwr_notify - nnote;
+	while ((pcanp = gateway_PCtoCAN_getCAN(&p->bcb)) != NULL)
+	{
+		if (pmsg != NULL)
+		{
+			m.line = p->line;
+			m.id   = pcanp->can.id;
+			m.dlc  = pcanp->can.dlc;
+			m.seq  = pcanp->seq;
+			m.err  = pcanp->error;
+			m.ret  = 0;
+			memset(m.uc, 0, 8); // Line buffers are reused: past dlc is an old msg
+			memcpy(m.uc, pcanp->can.cd.uc, (m.dlc > 8) ? 8 : m.dlc);
+			(*pmsg)(&m, parg);
+		}
+		p->line += 1;
+		ntaken  += 1;
+	}
+	if (nnote > ntaken)
+	{ // Here, line buffers went all the way around before being taken
+		p->lost += nnote - ntaken;
+		p->line += nnote - ntaken;
+	}
+	return ntaken;
+}
+/* ************************************************************************************************************
+ * void gwr_asc_init(struct GWRASC* p, int mode);
+ * @brief	: Set up the char by char path
+ * @param	: mode = 1 CANuncompress; 2 CANuncompress_G (gateway lines)
+ * ************************************************************************************************************ */
+void gwr_asc_init(struct GWRASC* p, int mode)
+{
+	memset(p, 0, sizeof(struct GWRASC));
+	p->mode = mode;
+	p->pg.mode_link = mode;
+	PC_msg_initg(&p->pg);
+	return;
+}
+/* ************************************************************************************************************
+ * uint32_t gwr_asc_feed(struct GWRASC* p, const char* pc, uint32_t n,
+ *	void (*pmsg)(const struct GWRMSG* pm, void* parg), void* parg);
+ * @brief	: Chars through PC_msg_getASCII and uncompress (as USB_PC_get_msg_mode)
+ * @return	: number of msgs (lines) completed
+ * ************************************************************************************************************ */
+uint32_t gwr_asc_feed(struct GWRASC* p, const char* pc, uint32_t n,
+	void (*pmsg)(const struct GWRMSG* pm, void* parg), void* parg)
+{
+	struct CANRCVBUF can;
+	struct GWRMSG m;
+	uint32_t nmsg = 0;
+	int ret;
+	int temp;
+
+	while (n > 0)
+	{
+		n -= 1;
+		ret = PC_msg_getASCII(&p->pg, (u8)*pc++);
+		if (ret == 0) continue;
+
+		memset(&can, 0, sizeof(can));
+		if (ret >= 1)
+		{
+			temp = (p->mode == 1) ? CANuncompress(&can, &p->pg.cmprs) : CANuncompress_G(&can, &p->pg.cmprs);
+			if (temp < 0) ret = temp - 4;
+		}
+		if (pmsg != NULL)
+		{
+			m.line = p->line;
+			m.id   = can.id;
+			m.dlc  = can.dlc;
+			m.seq  = p->pg.seq;
+			m.err  = 0;
+			m.ret  = ret;
+			memcpy(m.uc, can.cd.uc, 8);
+			(*pmsg)(&m, parg);
+		}
+		PC_msg_initg(&p->pg); // Caller's job after a msg (errors re-init too)
+		p->line += 1;
+		nmsg    += 1;
+	}
+	return nmsg;
+}
+/* ************************************************************************************************************
+ * Fault injection
+ * ************************************************************************************************************ */
+struct LN
+{
+	size_t   s;     // Start
+	uint32_t len;   // Chars, without terminator
+	int16_t  seq;   // Gateway line seq; -1 = not a gateway line
+};
+static uint32_t xrand(uint32_t* ps)
+{
+	uint32_t x = *ps;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*ps = x;
+	return x;
+}
+static int gateline(const char* pc, uint32_t len)
+{
+	uint8_t b[GATEWAYPCTOCANASC / 2];
+
+	if ((len < 14) || (len > GATEWAYPCTOCANASC) || ((len & 1) != 0)) return -1;
+	if (hexcodec_decode(b, pc, len) != (int)(len / 2)) return -1;
+	if ((b[5] > 8) || (len != (2u * (7 + b[5])))) return -1;
+	return b[0];
+}
+/* Line k has seq one more than line k-1 (both gateway lines) */
+static int consec(const struct LN* pl, uint32_t k)
+{
+	return ((pl[k].seq >= 0) && (pl[k - 1].seq >= 0) && (pl[k].seq == ((pl[k - 1].seq + 1) & 0xff)));
+}
+/* A char position in the id, payload or checksum (not seq or dlc) */
+static uint32_t charpos(uint32_t len, uint32_t* pseed)
+{
+	uint32_t k = xrand(pseed) % (len - 4);
+	return (k < 8) ? (2 + k) : (4 + k);
+}
+/* ************************************************************************************************************
+ * int gwr_inject(const char* pin, size_t n, uint32_t every, uint32_t seed,
+ *	char** ppout, size_t* pnout, struct GWRLINE** ppl, uint32_t* pnl);
+ * @brief	: Copy of a log with faults put in
+ * @param	: pin = log chars
+ * @param	: n = number of chars
+ * @param	: every = about one fault per 'every' lines
+ * @param	: seed = random seed (same seed, same faults)
+ * @param	: ppout = log with faults (malloc'd)
+ * @param	: pnout = its number of chars
+ * @param	: ppl = per line of the output: original line, fault, expected errors (malloc'd)
+ * @param	: pnl = number of lines
+ * @return	: 0 = OK; -1 = out of memory
+ * ************************************************************************************************************ */
+int gwr_inject(const char* pin, size_t n, uint32_t every, uint32_t seed,
+	char** ppout, size_t* pnout, struct GWRLINE** ppl, uint32_t* pnl)
+{
+	struct LN* pln = NULL;
+	struct LN* ptmp;
+	struct GWRLINE* pl;
+	char* po;
+	size_t size = 0;
+	size_t s = 0;
+	size_t i;
+	uint32_t nln = 0;
+	uint32_t nl = 0;
+	uint32_t k;
+	uint32_t pos;
+	uint32_t x = (seed == 0) ? 0x9e3779b9 : seed;
+	uint8_t pending = 0; // Expected bits for the line after a fault
+	uint8_t f;
+	char c;
+
+	if (every == 0) every = 1;
+
+	/* Lines: each terminator ('\n' or '\r', as the parser) ends one */
+	for (i = 0; i < n; i++)
+	{
+		if ((pin[i] != '\n') && (pin[i] != '\r')) continue;
+		if (nln == size)
+		{
+			size = (size == 0) ? 4096 : (size * 2);
+			ptmp = (struct LN*)realloc(pln, size * sizeof(struct LN));
+			if (ptmp == NULL)
+			{
+				free(pln);
+				return -1;
+			}
+			pln = ptmp;
+		}
+		pln[nln].s   = s;
+		pln[nln].len = i - s;
+		pln[nln].seq = gateline(pin + s, i - s);
+		nln += 1;
+		s = i + 1;
+	}
+
+	po = (char*)malloc(n + 1);
+	pl = (struct GWRLINE*)malloc((nln + 1) * sizeof(struct GWRLINE));
+	if ((po == NULL) || (pl == NULL))
+	{
+		free(pln);
+		free(po);
+		free(pl);
+		return -1;
+	}
+	*ppout = po;
+	*ppl   = pl;
+
+	for (k = 0; k < nln; k++)
+	{
+		f = 0;
+		if ((pending == 0) && (k >= 2) && ((k + 1) < nln) && (pln[k].seq >= 0)
+		 && ((xrand(&x) % every) == 0))
+		{
+			f = 1 + (xrand(&x) % (GWRF_NUM - 1));
+			if (((f == GWRF_SHORT) || (f == GWRF_DROP)) && !(consec(pln, k) && consec(pln, k + 1)))
+				f = GWRF_FLIP; // Seq check needs seq counting up around it
+		}
+		if (f == GWRF_DROP)
+		{ // Here, left out: the next line has the seq error
+			pending = 0x80 | PCTOCAN_ERR_SEQ;
+			continue;
+		}
+
+		pl[nl].orig  = k;
+		pl[nl].fault = 0;
+		pl[nl].exp   = pending & ~0x80;
+		if (pending != 0)
+		{
+			pl[nl].fault = ((pending & 0x80) != 0) ? GWRF_DROP : 0;
+			pending = 0;
+		}
+		memcpy(po, pin + pln[k].s, pln[k].len + 1);
+		switch (f)
+		{
+		case GWRF_FLIP:
+			pos = charpos(pln[k].len, &x);
+			c = po[pos];
+			do
+			{
+				po[pos] = "0123456789ABCDEF"[xrand(&x) & 0xf];
+			} while (po[pos] == c);
+			pl[nl].fault = f;
+			pl[nl].exp   = PCTOCAN_ERR_CHKSUM;
+			po += pln[k].len + 1;
+			break;
+		case GWRF_NOTHEX:
+			pos = charpos(pln[k].len, &x);
+			po[pos] = "GHJKLMNPQRSTUVWXYZ g:@/"[xrand(&x) % 23];
+			pl[nl].fault = f;
+			pl[nl].exp   = PCTOCAN_ERR_NOTHEX;
+			po += pln[k].len + 1;
+			break;
+		case GWRF_SHORT: // Checksum cut off: no seq update, so the next line has a seq error
+			po[pln[k].len - 2] = po[pln[k].len];
+			pl[nl].fault = f;
+			pl[nl].exp   = PCTOCAN_ERR_SHORT;
+			pending = PCTOCAN_ERR_SEQ;
+			po += pln[k].len - 1;
+			break;
+		default:
+			po += pln[k].len + 1;
+			break;
+		}
+		nl += 1;
+	}
+	/* Chars after the last terminator (a msg not finished) */
+	s = (nln == 0) ? 0 : (pln[nln - 1].s + pln[nln - 1].len + 1);
+	memcpy(po, pin + s, n - s);
+	po += n - s;
+
+	*pnout = po - *ppout;
+	*pnl   = nl;
+	free(pln);
+	return 0;
+}
@@ -0,0 +1,131 @@
+/* *****************************************************************************
+* File Name          : gwreplay.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Replay gateway logs through the firmware PC->CAN parsers on the PC
+****************************************************************************** */
+/*
+The firmware files are compiled as they are, with 'stub/' ahead of the
+FreeRTOS/HAL includes--
+  Ourwares/gateway_PCtoCAN.c  uart DMA path (GatewayTask, SerialTaskReceive)
+  Ourwares/PC_gateway_comm.c  char by char path (USB_PC_gateway.c):
+                              PC_msg_getASCII, then CANuncompress (mode 1)
+                              or CANuncompress_G (mode 2)
+
+DMA path: chars go into a circular buffer the way the uart DMA puts them
+there (NDTR counting down), 'chunk' chars between calls to
+'gateway_PCtoCAN_unloaddma', and the CAN msg line buffers are then taken
+with 'gateway_PCtoCAN_getCAN', as GatewayTask does.  Firmware sizes:
+128 char DMA buffer, 16 line buffers.  A chunk with more lines than line
+buffers overwrites ones not yet taken; those are counted in 'lost'.
+
+Faults for the error detection check ('gwr_inject'), put only on gateway
+lines with consecutive sequence numbers around them--
+  GWRF_FLIP    an id/payload/checksum hex char changed to another hex char
+  GWRF_NOTHEX  an id/payload/checksum char changed to a non-hex char
+  GWRF_SHORT   the last two chars (checksum) cut off
+  GWRF_DROP    line left out
+*/
+
+#ifndef __GWREPLAY
+#define __GWREPLAY
+
+#include <stdint.h>
+#include <stddef.h>
+#include "SerialTaskReceive.h"
+#include "gateway_PCtoCAN.h"
+#include "PC_gateway_comm.h"
+
+#define GWR_DMASIZE  128  // GatewayTask: xSerialTaskRxAdduart(...,16,20,128,1)
+#define GWR_NUMLINE  16
+
+/* One CAN msg out of a parser */
+struct GWRMSG
+{
+	uint32_t line;      // Line number (from 0) in the stream fed
+	uint32_t id;
+	uint8_t  dlc;
+	uint8_t  seq;
+	uint8_t  err;       // DMA path: PCTOCAN_ERR_... bits
+	int8_t   ret;       // Char path: PC_msg_getASCII return; uncompress error - 4
+	uint8_t  uc[8];
+};
+
+/* DMA path */
+struct GWRDMA
+{
+	struct SERIALRCVBCB bcb;
+	UART_HandleTypeDef  huart;
+	DMA_HandleTypeDef   hdma;
+	uint32_t wr;        // DMA store index
+	uint32_t line;      // Msgs taken
+	uint32_t lost;      // Line buffers overwritten before taken
+};
+
+/* Char by char path */
+struct GWRASC
+{
+	struct PCTOGATEWAY pg;
+	int      mode;      // 1 = CANuncompress; 2 = CANuncompress_G
+	uint32_t line;
+};
+
+/* Fault check: one per line of the stream with faults */
+#define GWRF_FLIP   1
+#define GWRF_NOTHEX 2
+#define GWRF_SHORT  3
+#define GWRF_DROP   4
+#define GWRF_NUM    5
+
+struct GWRLINE
+{
+	uint32_t orig;      // Line number in the stream without faults
+	uint8_t  fault;     // GWRF_... put on this line; 0 = none
+	uint8_t  exp;       // Error bits: fault != 0, at least these; else baseline | these, exactly
+};
+
+/* ************************************************************************************************************ */
+int gwr_dma_init(struct GWRDMA* p, uint16_t dmasize, uint8_t numline);
+/* @brief	: Set up a simulated uart DMA receive in CAN mode (as xSerialTaskRxAdduart)
+ * @param	: p = pointer to sim
+ * @param	: dmasize = chars in circular DMA buffer
+ * @param	: numline = number of CAN msg line buffers
+ * @return	: 0 = OK; -1 = out of memory
+ * ************************************************************************************************************ */
+void gwr_dma_free(struct GWRDMA* p);
+/* @brief	: Release sim buffers
+ * ************************************************************************************************************ */
+uint32_t gwr_dma_feed(struct GWRDMA* p, const char* pc, uint32_t n,
+	void (*pmsg)(const struct GWRMSG* pm, void* parg), void* parg);
+/* @brief	: DMA stores 'n' chars, then unload and take the CAN msgs
+ * @param	: p = pointer to sim
+ * @param	: pc = chars
+ * @param	: n = number of chars (less than dmasize)
+ * @param	: pmsg = called with each CAN msg (NULL = none)
+ * @param	: parg = passed to 'pmsg'
+ * @return	: number of CAN msgs taken
+ * ************************************************************************************************************ */
+void gwr_asc_init(struct GWRASC* p, int mode);
+/* @brief	: Set up the char by char path
+ * @param	: mode = 1 CANuncompress; 2 CANuncompress_G (gateway lines)
+ * ************************************************************************************************************ */
+uint32_t gwr_asc_feed(struct GWRASC* p, const char* pc, uint32_t n,
+	void (*pmsg)(const struct GWRMSG* pm, void* parg), void* parg);
+/* @brief	: Chars through PC_msg_getASCII and uncompress
+ * @return	: number of msgs (lines) completed
+ * ************************************************************************************************************ */
+int gwr_inject(const char* pin, size_t n, uint32_t every, uint32_t seed,
+	char** ppout, size_t* pnout, struct GWRLINE** ppl, uint32_t* pnl);
+/* @brief	: Copy of a log with faults put in
+ * @param	: pin = log chars
+ * @param	: n = number of chars
+ * @param	: every = about one fault per 'every' lines
+ * @param	: seed = random seed (same seed, same faults)
+ * @param	: ppout = log with faults (malloc'd)
+ * @param	: pnout = its number of chars
+ * @param	: ppl = per line of the output: original line, fault, expected errors (malloc'd)
+ * @param	: pnl = number of lines
+ * @return	: 0 = OK; -1 = out of memory
+ * ************************************************************************************************************ */
+
+#endif
@@ -0,0 +1,37 @@
+/* *****************************************************************************
+* File Name          : stm32f4xx_hal.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : gwreplay: host stand-in for the uart/dma handles of the gateway parser
+****************************************************************************** */
+/*
+The DMA "NDTR" register is a plain word the replay sets as it writes chars
+into the simulated circular buffer (gwreplay.c).
+*/
+
+#ifndef __STM32F4xx_HAL_H
+#define __STM32F4xx_HAL_H
+
+#include <stdint.h>
+
+typedef struct
+{
+	volatile uint32_t ndtr; // Items left before the circular buffer wraps
+} DMA_HandleTypeDef;
+
+typedef struct
+{
+	DMA_HandleTypeDef* hdmarx;
+} UART_HandleTypeDef;
+
+typedef enum
+{
+	HAL_OK = 0,
+	HAL_ERROR,
+	HAL_BUSY,
+	HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+#define __HAL_DMA_GET_COUNTER(h) ((h)->ndtr)
+
+#endif
@@ -0,0 +1,38 @@
+/* *****************************************************************************
+* File Name          : task.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : gwreplay: host stand-in for FreeRTOS task notify calls
+****************************************************************************** */
+/*
+A notify from the DMA unload (one per CAN msg line) is counted in
+'gwr_notify' (gwreplay.c), so the replay can tell if line buffers were
+overwritten before they were taken.
+*/
+
+#ifndef INC_TASK_H
+#define INC_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef enum
+{
+	eNoAction = 0,
+	eSetBits,
+	eIncrement,
+	eSetValueWithOverwrite,
+	eSetValueWithoutOverwrite
+} eNotifyAction;
+
+extern uint32_t gwr_notify;
+
+static inline BaseType_t xTaskNotifyFromISR(TaskHandle_t h, uint32_t v, eNotifyAction a, BaseType_t* pw)
+{
+	gwr_notify += 1;
+	return pdPASS;
+}
+#define portYIELD_FROM_ISR(x) ((void)(x))
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+
+#endif
@@ -0,0 +1,370 @@
+/* *****************************************************************************
+* File Name          : gwshm.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Gateway CAN msgs fanned out to local programs through shared memory
+****************************************************************************** */
+/*
+Library for 'gwshmd', 'gwshmcat' and 'gwshmbench' (see those for gcc lines).
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "gwshm.h"
+
+#define WAITMS 100 // Longest futex wait: daemon still there?
+
+static uint64_t nowns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec);
+}
+/* ************************************************************************************************************
+ * int gwshm_create(struct GWSHM* p, const char* name, uint32_t nslot);
+ * @brief	: Make (or remake) the shared memory ring
+ * @param	: p = pointer to daemon side
+ * @param	: name = shm name, e.g. GWSHM_NAME
+ * @param	: nslot = ring slots (power of 2)
+ * @return	: 0 = OK; -1 = error (errno)
+ * ************************************************************************************************************ */
+int gwshm_create(struct GWSHM* p, const char* name, uint32_t nslot)
+{
+	struct GWSHMHDR* ph;
+	int fd;
+
+	memset(p, 0, sizeof(struct GWSHM));
+	if ((nslot < 2) || ((nslot & (nslot - 1)) != 0))
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	snprintf(p->name, sizeof(p->name), "%s", name);
+	p->size = sizeof(struct GWSHMHDR) + (size_t)nslot * sizeof(struct GWSHMMSG);
+	p->mask = nslot - 1;
+
+	/* A new object: readers of an old one keep theirs */
+	shm_unlink(name);
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0) return -1;
+	if (ftruncate(fd, p->size) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	ph = (struct GWSHMHDR*)mmap(NULL, p->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ph == MAP_FAILED) return -1;
+
+	ph->nslot    = nslot;
+	ph->slotsize = sizeof(struct GWSHMMSG);
+	ph->pid      = getpid();
+	ph->state    = GWSHM_RUN;
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(ph->magic, GWSHM_MAGIC, sizeof(ph->magic)); // Last: readers check it
+	p->ph = ph;
+	return 0;
+}
+/* ************************************************************************************************************
+ * void gwshm_publish(struct GWSHM* p, const struct GBINMSG* pm, uint64_t t);
+ * @brief	: Put a msg in the ring
+ * @param	: p = pointer to daemon side
+ * @param	: pm = pointer to msg
+ * @param	: t = time it came in (ns)
+ * ************************************************************************************************************ */
+void gwshm_publish(struct GWSHM* p, const struct GBINMSG* pm, uint64_t t)
+{
+	struct GWSHMMSG* ps = &p->ph->slot[p->n & p->mask];
+
+	__atomic_store_n(&ps->seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE); // 'seq' 0 seen before any of the new msg
+	ps->t    = t;
+	ps->id   = pm->id;
+	ps->dlc  = pm->dlc;
+	ps->gseq = pm->seq;
+	memcpy(ps->uc, pm->uc, 8);
+	p->n += 1;
+	__atomic_store_n(&ps->seq, p->n, __ATOMIC_RELEASE);
+	__atomic_store_n(&p->ph->head, p->n, __ATOMIC_RELEASE);
+	return;
+}
+/* ************************************************************************************************************
+ * void gwshm_wake(struct GWSHM* p);
+ * @brief	: Wake readers waiting for msgs (after a batch of gwshm_publish)
+ * ************************************************************************************************************ */
+void gwshm_wake(struct GWSHM* p)
+{
+	__atomic_add_fetch(&p->ph->wake, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&p->ph->nwait, __ATOMIC_SEQ_CST) != 0)
+		syscall(SYS_futex, &p->ph->wake, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+	return;
+}
+/* Daemon loop: gbin_feed callback */
+struct PUB
+{
+	struct GWSHM* p;
+	uint64_t t;
+};
+static void pub(struct GBINMSG* pm, void* parg)
+{
+	struct PUB* pp = (struct PUB*)parg;
+	gwshm_publish(pp->p, pm, pp->t);
+	return;
+}
+/* ************************************************************************************************************
+ * int gwshm_run(struct GWSHM* p, int fd, struct GBIN* pg, volatile int* pstop);
+ * @brief	: Daemon loop: read the port, decode, publish, until end of file or '*pstop'
+ * @param	: p = pointer to daemon side
+ * @param	: fd = port
+ * @param	: pg = decoder (gbin_init'd); its counts are copied to the header
+ * @param	: pstop = set non-zero (e.g. by a signal) to stop
+ * @return	: 0 = end of file or stopped; -1 = read error (errno)
+ * ************************************************************************************************************ */
+int gwshm_run(struct GWSHM* p, int fd, struct GBIN* pg, volatile int* pstop)
+{
+	struct GWSHMHDR* ph = p->ph;
+	struct pollfd pfd;
+	struct PUB pb;
+	uint8_t buf[GWSHM_RDSZ];
+	ssize_t k;
+
+	pb.p = p;
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	while (*pstop == 0)
+	{
+		/* Wait with a timeout, so 'pstop' is seen without a signal */
+		k = poll(&pfd, 1, WAITMS);
+		if (k == 0) continue;
+		if ((k < 0) && (errno == EINTR)) continue;
+		k = read(fd, buf, sizeof(buf));
+		if (k == 0) return 0;
+		if (k < 0)
+		{
+			if ((errno == EINTR) || (errno == EAGAIN)) continue;
+			return -1;
+		}
+		pb.t = nowns();
+		gbin_feed(pg, buf, k, pub, &pb);
+		ph->bytes  += k;
+		ph->chkerr  = pg->chkerr;
+		ph->sizeerr = pg->sizeerr;
+		ph->seqgap  = pg->seqgap;
+		gwshm_wake(p);
+	}
+	return 0;
+}
+/* ************************************************************************************************************
+ * void gwshm_close(struct GWSHM* p, int unlink);
+ * @brief	: Mark the ring stopped (readers end when caught up) and unmap it
+ * @param	: unlink = 1 = remove the shm name
+ * ************************************************************************************************************ */
+void gwshm_close(struct GWSHM* p, int unlink)
+{
+	if (p->ph == NULL) return;
+	__atomic_store_n(&p->ph->state, GWSHM_STOP, __ATOMIC_RELEASE);
+	gwshm_wake(p);
+	munmap(p->ph, p->size);
+	if (unlink != 0) shm_unlink(p->name);
+	p->ph = NULL;
+	return;
+}
+/* ************************************************************************************************************
+ * int gwshm_attach(struct GWSHMC* pc, const char* name);
+ * @brief	: Attach a reader; it gets msgs from now on
+ * @param	: pc = pointer to reader side
+ * @param	: name = shm name
+ * @return	: 0 = OK; -1 = error (errno); -2 = not a gwshm ring
+ * ************************************************************************************************************ */
+int gwshm_attach(struct GWSHMC* pc, const char* name)
+{
+	struct GWSHMHDR* ph;
+	struct stat sb;
+	int32_t zero;
+	int fd;
+	int i;
+
+	memset(pc, 0, sizeof(struct GWSHMC));
+	pc->icon = -1;
+	fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0) return -1;
+	if (fstat(fd, &sb) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	if ((size_t)sb.st_size < sizeof(struct GWSHMHDR))
+	{
+		close(fd);
+		return -2;
+	}
+	ph = (struct GWSHMHDR*)mmap(NULL, sb.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ph == MAP_FAILED) return -1;
+	pc->ph   = ph;
+	pc->size = sb.st_size;
+	if ((memcmp(ph->magic, GWSHM_MAGIC, sizeof(ph->magic)) != 0) || (ph->slotsize != sizeof(struct GWSHMMSG))
+	 || (sb.st_size < (off_t)(sizeof(struct GWSHMHDR) + (size_t)ph->nslot * sizeof(struct GWSHMMSG))))
+	{
+		gwshm_detach(pc);
+		return -2;
+	}
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	pc->mask = ph->nslot - 1;
+	pc->next = __atomic_load_n(&ph->head, __ATOMIC_ACQUIRE);
+
+	/* An entry, if there is a free one */
+	for (i = 0; i < GWSHM_MAXCON; i++)
+	{
+		zero = 0;
+		if (__atomic_compare_exchange_n(&ph->con[i].pid, &zero, getpid(), 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+		{
+			ph->con[i].nread = 0;
+			ph->con[i].lost  = 0;
+			pc->icon = i;
+			break;
+		}
+	}
+	return 0;
+}
+static void lost(struct GWSHMC* pc, uint64_t n)
+{
+	pc->lost += n;
+	if (pc->icon >= 0) __atomic_store_n(&pc->ph->con[pc->icon].lost, pc->lost, __ATOMIC_RELAXED);
+	return;
+}
+/* Wait for 'wake' to move on from 'w' (or 'ms' to go by) */
+static void waitwake(struct GWSHMHDR* ph, uint32_t w, int ms)
+{
+	struct timespec ts;
+
+	ts.tv_sec  = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000;
+	syscall(SYS_futex, &ph->wake, FUTEX_WAIT, w, &ts, NULL, 0);
+	return;
+}
+/* ************************************************************************************************************
+ * int gwshm_next(struct GWSHMC* pc, const struct GWSHMMSG** pp, int waitms);
+ * @brief	: Next msg, in place in the ring (check it with gwshm_done when finished with it)
+ * @param	: pc = pointer to reader side
+ * @param	: pp = pointer to msg pointer (set)
+ * @param	: waitms = wait for one: 0 = don't; -1 = for ever
+ * @return	: 1 = msg; 0 = none yet; -1 = daemon stopped and all read
+ * ************************************************************************************************************ */
+int gwshm_next(struct GWSHMC* pc, const struct GWSHMMSG** pp, int waitms)
+{
+	struct GWSHMHDR* ph = pc->ph;
+	const struct GWSHMMSG* ps;
+	uint64_t h;
+	uint64_t seq;
+	uint32_t w;
+	int ms;
+
+	for (;;)
+	{
+		h = __atomic_load_n(&ph->head, __ATOMIC_ACQUIRE);
+		if (h > pc->next)
+		{
+			if ((h - pc->next) > ph->nslot)
+			{ // Here, the writer went round the ring past us
+				lost(pc, h - pc->next - ph->nslot);
+				pc->next = h - ph->nslot;
+			}
+			ps  = &ph->slot[pc->next & pc->mask];
+			seq = __atomic_load_n(&ps->seq, __ATOMIC_ACQUIRE);
+			if (seq != (pc->next + 1))
+			{ // Here, being written over, or already was
+				lost(pc, 1);
+				pc->next += 1;
+				continue;
+			}
+			pc->pcur = ps;
+			*pp = ps;
+			return 1;
+		}
+
+		/* Caught up */
+		if (__atomic_load_n(&ph->state, __ATOMIC_ACQUIRE) == GWSHM_STOP) return -1;
+		if (waitms == 0) return 0;
+
+		w = __atomic_load_n(&ph->wake, __ATOMIC_SEQ_CST);
+		__atomic_add_fetch(&ph->nwait, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&ph->head, __ATOMIC_SEQ_CST) == h)
+		{
+			ms = ((waitms < 0) || (waitms > WAITMS)) ? WAITMS : waitms;
+			waitwake(ph, w, ms);
+			if (waitms > 0) waitms -= (ms < waitms) ? ms : waitms;
+			if ((__atomic_load_n(&ph->head, __ATOMIC_ACQUIRE) == h) && (kill(ph->pid, 0) != 0) && (errno == ESRCH))
+			{ // Here, daemon gone without marking the ring stopped
+				__atomic_sub_fetch(&ph->nwait, 1, __ATOMIC_SEQ_CST);
+				return -1;
+			}
+		}
+		__atomic_sub_fetch(&ph->nwait, 1, __ATOMIC_SEQ_CST);
+		if ((waitms == 0) && (__atomic_load_n(&ph->head, __ATOMIC_ACQUIRE) == h)) return 0;
+	}
+}
+/* ************************************************************************************************************
+ * int gwshm_done(struct GWSHMC* pc);
+ * @brief	: Finished with the msg gwshm_next gave
+ * @return	: 0 = OK; -1 = it was written over while in use (counted lost)
+ * ************************************************************************************************************ */
+int gwshm_done(struct GWSHMC* pc)
+{
+	uint64_t seq;
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE); // Reads of the msg done before 'seq' is looked at again
+	seq = __atomic_load_n(&pc->pcur->seq, __ATOMIC_RELAXED);
+	pc->next += 1;
+	if (seq != pc->next)
+	{
+		lost(pc, 1);
+		return -1;
+	}
+	pc->nread += 1;
+	if (pc->icon >= 0) __atomic_store_n(&pc->ph->con[pc->icon].nread, pc->nread, __ATOMIC_RELAXED);
+	return 0;
+}
+/* ************************************************************************************************************
+ * int gwshm_read(struct GWSHMC* pc, struct GWSHMMSG* pm, int waitms);
+ * @brief	: Next msg, copied
+ * @param	: pm = pointer to copy
+ * @return	: as gwshm_next
+ * ************************************************************************************************************ */
+int gwshm_read(struct GWSHMC* pc, struct GWSHMMSG* pm, int waitms)
+{
+	const struct GWSHMMSG* ps;
+	int ret;
+
+	do
+	{
+		ret = gwshm_next(pc, &ps, waitms);
+		if (ret != 1) return ret;
+		memcpy(pm, ps, sizeof(struct GWSHMMSG));
+	} while (gwshm_done(pc) != 0);
+	return 1;
+}
+/* ************************************************************************************************************
+ * void gwshm_detach(struct GWSHMC* pc);
+ * @brief	: Detach a reader
+ * ************************************************************************************************************ */
+void gwshm_detach(struct GWSHMC* pc)
+{
+	if (pc->ph == NULL) return;
+	if (pc->icon >= 0) __atomic_store_n(&pc->ph->con[pc->icon].pid, 0, __ATOMIC_RELEASE);
+	munmap(pc->ph, pc->size);
+	pc->ph = NULL;
+	return;
+}
@@ -0,0 +1,168 @@
+/* *****************************************************************************
+* File Name          : gwshm.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Gateway CAN msgs fanned out to local programs through shared memory
+****************************************************************************** */
+/*
+One program ('gwshmd') owns the gateway serial/USB port, decodes what comes
+in once (gatewaybin: ascii/hex lines or binary frames, following the
+gateway's format switch) and puts each good msg in a ring in POSIX shared
+memory.  Any number of programs attach and read the ring; the daemon never
+waits for them and does not know how many there are.
+
+Ring: GWSHM_NSLOT (power of 2) slots of 32 bytes.  Msg n (from 0) goes in
+slot n & (nslot - 1).  The writer--
+  slot.seq = 0, fence, msg, slot.seq = n + 1 (release), head = n + 1 (release)
+A reader keeps its own 'next' and reads msg 'next' when head > next: it
+checks slot.seq == next + 1 before and after using the slot.  If the
+writer got round the ring first (head - next > nslot, or seq changed) the
+msgs in between are gone: they are counted in that reader's 'lost' and it
+carries on from the oldest msg still there.  So a slow reader loses msgs,
+and nobody else is held up.
+
+Readers that catch up wait on a futex ('wake', bumped after each read()
+of the port); the daemon only makes the wake call if one is waiting.
+
+A reader can use a msg in place (gwshm_next, then gwshm_done to check it
+was not written over meanwhile) or copy it out (gwshm_read).  Readers take
+an entry in 'con[]' so the daemon can show who is attached and what they
+lost; more than GWSHM_MAXCON readers still work, without an entry.
+*/
+
+#ifndef __GWSHM
+#define __GWSHM
+
+#include <stdint.h>
+#include "gatewaybin.h"
+
+#define GWSHM_NAME   "/gwshm"     // Default shm name (/dev/shm/gwshm)
+#define GWSHM_MAGIC  "GWSHM01"
+#define GWSHM_NSLOT  (1 << 16)    // Default ring size: about 10 sec of a full 2 Mbaud port
+#define GWSHM_MAXCON 16           // Readers with an entry in the header
+#define GWSHM_RDSZ   4096         // Daemon port read size
+
+/* Header 'state' */
+#define GWSHM_RUN    1
+#define GWSHM_STOP   2            // Daemon gone: readers end when caught up
+
+/* One msg (one slot) */
+struct GWSHMMSG
+{
+	uint64_t seq;     // Msg number + 1 (0 = being written)
+	uint64_t t;       // CLOCK_MONOTONIC ns of the port read it came in
+	uint32_t id;
+	uint8_t  dlc;
+	uint8_t  gseq;    // Gateway sequence number
+	uint8_t  spare[2];
+	uint8_t  uc[8];
+};
+
+/* A reader's entry (own cache line: readers do not slow each other) */
+struct GWSHMCON
+{
+	int32_t  pid;     // 0 = free
+	uint32_t spare;
+	uint64_t nread;   // Msgs read
+	uint64_t lost;    // Msgs written over before read
+} __attribute__((aligned(64)));
+
+struct GWSHMHDR
+{
+	char     magic[8];
+	uint32_t nslot;
+	uint32_t slotsize;
+	int32_t  pid;     // Daemon
+	uint32_t state;   // GWSHM_RUN, GWSHM_STOP
+	/* Daemon counts */
+	uint64_t bytes;
+	uint64_t chkerr;
+	uint64_t sizeerr;
+	uint64_t seqgap;
+	/* Writer, each on its own cache line */
+	uint64_t head __attribute__((aligned(64)));  // Msgs written
+	uint32_t wake __attribute__((aligned(64)));  // Futex, bumped after each batch
+	uint32_t nwait;                              // Readers waiting on 'wake'
+	struct GWSHMCON con[GWSHM_MAXCON];
+	struct GWSHMMSG slot[] __attribute__((aligned(64)));
+};
+
+/* Daemon side */
+struct GWSHM
+{
+	struct GWSHMHDR* ph;
+	size_t   size;
+	uint64_t n;       // Next msg number
+	uint32_t mask;
+	char     name[64];
+};
+
+/* Reader side */
+struct GWSHMC
+{
+	struct GWSHMHDR* ph;
+	const struct GWSHMMSG* pcur; // Msg gwshm_next gave
+	size_t   size;
+	uint64_t next;    // Next msg number to read
+	uint64_t nread;
+	uint64_t lost;
+	uint32_t mask;
+	int      icon;    // Entry in 'con[]'; -1 = none
+};
+
+/* ************************************************************************************************************ */
+int gwshm_create(struct GWSHM* p, const char* name, uint32_t nslot);
+/* @brief	: Make (or remake) the shared memory ring
+ * @param	: p = pointer to daemon side
+ * @param	: name = shm name, e.g. GWSHM_NAME
+ * @param	: nslot = ring slots (power of 2)
+ * @return	: 0 = OK; -1 = error (errno)
+ * ************************************************************************************************************ */
+void gwshm_publish(struct GWSHM* p, const struct GBINMSG* pm, uint64_t t);
+/* @brief	: Put a msg in the ring
+ * @param	: p = pointer to daemon side
+ * @param	: pm = pointer to msg
+ * @param	: t = time it came in (ns)
+ * ************************************************************************************************************ */
+void gwshm_wake(struct GWSHM* p);
+/* @brief	: Wake readers waiting for msgs (after a batch of gwshm_publish)
+ * ************************************************************************************************************ */
+int gwshm_run(struct GWSHM* p, int fd, struct GBIN* pg, volatile int* pstop);
+/* @brief	: Daemon loop: read the port, decode, publish, until end of file or '*pstop'
+ * @param	: p = pointer to daemon side
+ * @param	: fd = port
+ * @param	: pg = decoder (gbin_init'd); its counts are copied to the header
+ * @param	: pstop = set non-zero (e.g. by a signal) to stop
+ * @return	: 0 = end of file or stopped; -1 = read error (errno)
+ * ************************************************************************************************************ */
+void gwshm_close(struct GWSHM* p, int unlink);
+/* @brief	: Mark the ring stopped (readers end when caught up) and unmap it
+ * @param	: unlink = 1 = remove the shm name
+ * ************************************************************************************************************ */
+int gwshm_attach(struct GWSHMC* pc, const char* name);
+/* @brief	: Attach a reader; it gets msgs from now on
+ * @param	: pc = pointer to reader side
+ * @param	: name = shm name
+ * @return	: 0 = OK; -1 = error (errno); -2 = not a gwshm ring
+ * ************************************************************************************************************ */
+int gwshm_next(struct GWSHMC* pc, const struct GWSHMMSG** pp, int waitms);
+/* @brief	: Next msg, in place in the ring (check it with gwshm_done when finished with it)
+ * @param	: pc = pointer to reader side
+ * @param	: pp = pointer to msg pointer (set)
+ * @param	: waitms = wait for one: 0 = don't; -1 = for ever
+ * @return	: 1 = msg; 0 = none yet; -1 = daemon stopped and all read
+ * ************************************************************************************************************ */
+int gwshm_done(struct GWSHMC* pc);
+/* @brief	: Finished with the msg gwshm_next gave
+ * @return	: 0 = OK; -1 = it was written over while in use (counted lost)
+ * ************************************************************************************************************ */
+int gwshm_read(struct GWSHMC* pc, struct GWSHMMSG* pm, int waitms);
+/* @brief	: Next msg, copied
+ * @param	: pm = pointer to copy
+ * @return	: as gwshm_next
+ * ************************************************************************************************************ */
+void gwshm_detach(struct GWSHMC* pc);
+/* @brief	: Detach a reader
+ * ************************************************************************************************************ */
+
+#endif
@@ -0,0 +1,266 @@
+/* *****************************************************************************
+* File Name          : gwshmbench.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : gwshm: throughput and latency with 1 to 8 readers, a pty as the gateway
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 gwshmbench.c gwshm.c ../gatewaybin/gatewaybin.c ../../Ourwares/hexcodec.c -I. -I../gatewaybin -I../../Ourwares -pthread -o gwshmbench
+./gwshmbench ../../docs/data/log200220-2.txt [MB [maxreaders]]
+
+pty: the daemon loop (gwshm_run, as gwshmd) reads the slave side of a
+pty; the log (copied to 'MB', default 16) is written into the master side
+as fast as it will go.  1, 2, 4, 8 reader processes attach first and wait
+on the futex.  Shown: msgs/s through the port and ring, for each reader
+msgs and losses, and the latency from the daemon's port read to a reader
+having the msg (us: median, 99%, max).  Each reader also checks every msg
+against the log, in order.
+
+ring: no port; the msgs are published from memory as fast as they go (a
+wake every 64), to show what the readers keep up with.  Losses here are
+expected when readers have fewer cores than they need.
+*/
+
+#define _XOPEN_SOURCE 600 // posix_openpt
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <termios.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "gwshm.h"
+
+#define MAXRD 8
+#define NHIST 20001  // Latency buckets: 1 us up to 20 ms, then one for the rest
+
+struct RES
+{
+	volatile int ready;
+	int      bad;     // Msgs not as in the log
+	uint64_t n;
+	uint64_t lost;
+	uint64_t hist[NHIST];
+};
+
+static struct GBINMSG* pmsg; // The log's msgs, in order
+static uint64_t nmsg;
+static volatile int stop;
+
+static uint64_t nowns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec);
+}
+static void add(struct GBINMSG* pm, void* parg)
+{
+	pmsg[nmsg++] = *pm;
+	return;
+}
+
+/* Reader process */
+static void reader(const char* name, struct RES* pr)
+{
+	struct GWSHMC sc;
+	const struct GWSHMMSG* ps;
+	uint64_t lat;
+	uint64_t k;
+	int ok;
+
+	if (gwshm_attach(&sc, name) != 0) _exit(1);
+	pr->ready = 1;
+	while (gwshm_next(&sc, &ps, -1) == 1)
+	{
+		lat = (nowns() - ps->t) / 1000;
+		k = ps->seq - 1;
+		ok = (ps->id == pmsg[k % nmsg].id) && (ps->dlc == pmsg[k % nmsg].dlc) && (memcmp(ps->uc, pmsg[k % nmsg].uc, 8) == 0);
+		if (gwshm_done(&sc) != 0) continue;
+		if (ok == 0) pr->bad += 1;
+		pr->hist[(lat < (NHIST - 1)) ? lat : (NHIST - 1)] += 1;
+	}
+	pr->n    = sc.nread;
+	pr->lost = sc.lost;
+	gwshm_detach(&sc);
+	_exit(0);
+}
+/* Latency percentile over all readers (us) */
+static unsigned pct(struct RES* pr, int nrd, double f)
+{
+	uint64_t tot = 0;
+	uint64_t sum = 0;
+	unsigned i;
+	int j;
+
+	for (j = 0; j < nrd; j++)
+		for (i = 0; i < NHIST; i++)
+			tot += pr[j].hist[i];
+	for (i = 0; i < NHIST; i++)
+	{
+		for (j = 0; j < nrd; j++)
+			sum += pr[j].hist[i];
+		if ((sum > 0) && (sum >= (f * tot))) return i;
+	}
+	return 0;
+}
+
+struct DMN
+{
+	struct GWSHM* p;
+	int fd;
+};
+static void* dmnthread(void* parg)
+{
+	struct DMN* pd = (struct DMN*)parg;
+	struct GBIN g;
+
+	gbin_init(&g, GBIN_MODE_ASCII);
+	gwshm_run(pd->p, pd->fd, &g, &stop);
+	return NULL;
+}
+
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	static const char* kind[2] = {"pty", "ring"};
+	struct GWSHM shm;
+	struct GBIN g;
+	struct DMN dmn;
+	struct RES* pres;
+	struct termios tio;
+	pthread_t th;
+	char name[32];
+	size_t nmb = 16;
+	size_t nsmp;
+	size_t n;
+	size_t i;
+	ssize_t k;
+	uint64_t t0, t1;
+	uint64_t nlost, nmin;
+	char* plog;
+	FILE* fp;
+	int maxrd = MAXRD;
+	int nrd;
+	int bad;
+	int mode;
+	int fdm, fds;
+	int j;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s samplelog [MB [maxreaders]]\n", argv[0]);
+		return 1;
+	}
+	if (argc > 2) nmb = atoi(argv[2]);
+	if (argc > 3) maxrd = atoi(argv[3]);
+	if ((maxrd < 1) || (maxrd > MAXRD)) maxrd = MAXRD;
+
+	/* Log, copied to 'nmb' MB, and its msgs */
+	fp = fopen(argv[1], "r");
+	if (fp == NULL)
+	{
+		perror(argv[1]);
+		return 1;
+	}
+	fseek(fp, 0, SEEK_END);
+	nsmp = ftell(fp);
+	rewind(fp);
+	n = ((nmb << 20) / nsmp + 1) * nsmp;
+	plog = (char*)malloc(n);
+	if ((plog == NULL) || (nsmp == 0) || (fread(plog, 1, nsmp, fp) != nsmp)) return 1;
+	fclose(fp);
+	for (i = nsmp; i < n; i += nsmp)
+		memcpy(plog + i, plog, nsmp);
+	pmsg = (struct GBINMSG*)malloc((n / 14 + 1) * sizeof(struct GBINMSG));
+	if (pmsg == NULL) return 1;
+	gbin_init(&g, GBIN_MODE_ASCII);
+	gbin_feed(&g, (uint8_t*)plog, n, add, NULL);
+
+	pres = (struct RES*)mmap(NULL, MAXRD * sizeof(struct RES), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (pres == MAP_FAILED) return 1;
+	snprintf(name, sizeof(name), "/gwshmbench.%d", getpid());
+
+	printf("%.1f MB, %lu msgs; ring %u slots\n", n / 1E6, (unsigned long)nmsg, GWSHM_NSLOT);
+	printf("%-4s %7s %10s %8s %12s %10s %6s %6s %8s\n", "", "readers", "msgs/s", "MB/s", "fewest read", "lost", "p50us", "p99us", "maxus");
+	for (mode = 0; mode < 2; mode++)
+	{
+		for (nrd = 1; nrd <= maxrd; nrd *= 2)
+		{
+			memset(pres, 0, MAXRD * sizeof(struct RES));
+			if (gwshm_create(&shm, name, GWSHM_NSLOT) != 0)
+			{
+				perror(name);
+				return 1;
+			}
+			for (j = 0; j < nrd; j++)
+			{
+				if (fork() == 0) reader(name, &pres[j]);
+			}
+			for (j = 0; j < nrd; j++)
+				while (pres[j].ready == 0) usleep(1000);
+
+			if (mode == 0)
+			{ // pty: the daemon reads the slave side; the log goes in the master
+				fdm = posix_openpt(O_RDWR | O_NOCTTY);
+				if ((fdm < 0) || (grantpt(fdm) != 0) || (unlockpt(fdm) != 0)) return 1;
+				fds = open(ptsname(fdm), O_RDWR | O_NOCTTY);
+				if (fds < 0) return 1;
+				tcgetattr(fds, &tio);
+				cfmakeraw(&tio);
+				tcsetattr(fds, TCSANOW, &tio);
+				stop = 0;
+				dmn.p  = &shm;
+				dmn.fd = fds;
+				pthread_create(&th, NULL, dmnthread, &dmn);
+				t0 = nowns();
+				for (i = 0; i < n; i += k)
+				{
+					k = write(fdm, plog + i, ((n - i) < 4096) ? (n - i) : 4096);
+					if (k <= 0) return 1;
+				}
+				while ((__atomic_load_n(&shm.ph->head, __ATOMIC_ACQUIRE) < nmsg) && ((nowns() - t0) < 30000000000ull))
+					usleep(100);
+				t1 = nowns();
+				stop = 1;
+				pthread_join(th, NULL);
+				close(fds);
+				close(fdm);
+			}
+			else
+			{ // ring: publish from memory
+				t0 = nowns();
+				for (i = 0; i < nmsg; i++)
+				{
+					gwshm_publish(&shm, &pmsg[i], nowns());
+					if ((i & 63) == 63) gwshm_wake(&shm);
+				}
+				t1 = nowns();
+			}
+			gwshm_close(&shm, 1);
+			for (j = 0; j < nrd; j++)
+				wait(NULL);
+
+			nlost = 0;
+			nmin  = UINT64_MAX;
+			bad   = 0;
+			for (j = 0; j < nrd; j++)
+			{
+				nlost += pres[j].lost;
+				bad   += pres[j].bad;
+				if (pres[j].n < nmin) nmin = pres[j].n;
+			}
+			printf("%-4s %7d %10.0f %8.1f %12lu %10lu %6u %6u %8u%s\n", kind[mode], nrd, nmsg / ((t1 - t0) * 1E-9),
+				(mode == 0) ? (n / ((t1 - t0) * 1E-3)) : 0.0, (unsigned long)nmin, (unsigned long)nlost,
+				pct(pres, nrd, 0.5), pct(pres, nrd, 0.99), pct(pres, nrd, 1.0), (bad == 0) ? "" : "  BAD MSGS");
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,99 @@
+/* *****************************************************************************
+* File Name          : gwshmcat.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Read the gwshmd ring: msgs out as gateway ascii/hex lines
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 gwshmcat.c gwshm.c ../gatewaybin/gatewaybin.c ../../Ourwares/hexcodec.c -I. -I../gatewaybin -I../../Ourwares -pthread -o gwshmcat
+
+./gwshmcat | ../canfmt/canfmt
+./gwshmcat -c 6400 > tenseconds.txt
+
+The lines are what the gateway sent in ascii mode (also when it is in
+binary), so logs and the PC tools see the same thing as with minicom.
+-n shm name, -c stop after that many msgs.  Msgs lost (this reader too
+slow) are counted on stderr at the end.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <signal.h>
+#include "gwshm.h"
+
+static volatile int stop;
+static void sigstop(int sig)
+{
+	stop = 1;
+	return;
+}
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	struct GWSHMC sc;
+	struct GBINMSG m;
+	struct sigaction sa;
+	const struct GWSHMMSG* ps;
+	const char* name = GWSHM_NAME;
+	uint64_t count = 0;
+	char ln[GBIN_ASCMAX];
+	int n;
+	int c;
+	int ret;
+
+	while ((c = getopt(argc, argv, "n:c:")) != -1)
+	{
+		switch (c)
+		{
+		case 'n': name  = optarg; break;
+		case 'c': count = strtoull(optarg, NULL, 10); break;
+		default:
+			goto usage;
+		}
+	}
+	if (optind != argc) goto usage;
+
+	ret = gwshm_attach(&sc, name);
+	if (ret != 0)
+	{
+		fprintf(stderr, "gwshmcat: %s: %s\n", name, (ret == -2) ? "not a gwshm ring" : "no daemon (shm not there)");
+		return 1;
+	}
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = sigstop;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	while ((stop == 0) && ((count == 0) || (sc.nread < count)))
+	{
+		ret = gwshm_next(&sc, &ps, 200);
+		if (ret < 0) break;
+		if (ret == 0)
+		{ // Nothing for a while: push out what is buffered
+			fflush(stdout);
+			continue;
+		}
+		m.id  = ps->id;
+		m.seq = ps->gseq;
+		m.dlc = ps->dlc;
+		memcpy(m.uc, ps->uc, 8);
+		if (gwshm_done(&sc) != 0) continue; // Written over meanwhile (counted)
+		n = gbin_fmtline(ln, &m);
+		if (fwrite(ln, 1, n, stdout) != (size_t)n) break;
+	}
+	fflush(stdout);
+	if (sc.lost != 0) fprintf(stderr, "gwshmcat: %lu msgs, %lu lost\n", (unsigned long)sc.nread, (unsigned long)sc.lost);
+	gwshm_detach(&sc);
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-n shmname] [-c count]\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,171 @@
+/* *****************************************************************************
+* File Name          : gwshmd.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : Own the gateway port; CAN msgs to a shared memory ring (gwshm.h)
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 gwshmd.c gwshm.c ../gatewaybin/gatewaybin.c ../../Ourwares/hexcodec.c -I. -I../gatewaybin -I../../Ourwares -pthread -o gwshmd
+
+Instead of 'minicom | tee'--
+./gwshmd -v /dev/ttyUSB0 &
+./gwshmcat | ../canfmt/canfmt -m ../canfmt/dmoc.map
+./gwshmcat > today.txt
+
+-b baud (default 2000000, the gateway uart), -n shm name (default /gwshm),
+-s ring slots (power of 2), -B the gateway starts in binary format, -v
+once a second to stderr: msgs/sec, errors and each reader's msgs and
+losses.  The port can be any file: a pty stands in for the gateway in
+tests (see gwshmbench.c), and a log file replays (at full speed).  Stops on
+SIGINT/SIGTERM or end of file; readers then end when they have caught up.
+The daemon only reads: PC->gateway msgs are sent by other means.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <termios.h>
+#include "gwshm.h"
+
+static volatile int stop;
+static void sigstop(int sig)
+{
+	stop = 1;
+	return;
+}
+
+/* Port: raw, 8N1, no flow control */
+static const struct
+{
+	int     baud;
+	speed_t speed;
+} speeds[] =
+{
+	{9600, B9600}, {19200, B19200}, {38400, B38400}, {57600, B57600}, {115200, B115200},
+	{230400, B230400}, {460800, B460800}, {921600, B921600}, {1000000, B1000000},
+	{2000000, B2000000}, {3000000, B3000000}, {4000000, B4000000},
+};
+static int port(int fd, int baud)
+{
+	struct termios tio;
+	unsigned i;
+
+	if (isatty(fd) == 0) return 0; // File or pipe: as it is
+	for (i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++)
+		if (speeds[i].baud == baud) break;
+	if (i == sizeof(speeds) / sizeof(speeds[0])) return -2;
+	if (tcgetattr(fd, &tio) != 0) return -1;
+	cfmakeraw(&tio);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+	tio.c_cc[VMIN]  = 1;
+	tio.c_cc[VTIME] = 0;
+	cfsetispeed(&tio, speeds[i].speed);
+	cfsetospeed(&tio, speeds[i].speed);
+	if (tcsetattr(fd, TCSANOW, &tio) != 0) return -1;
+	tcflush(fd, TCIFLUSH);
+	return 0;
+}
+
+/* -v: once a second */
+static void* stats(void* parg)
+{
+	struct GWSHM* p = (struct GWSHM*)parg;
+	struct GWSHMHDR* ph = p->ph;
+	uint64_t nlast = 0;
+	uint64_t n;
+	int i;
+
+	while (stop == 0)
+	{
+		sleep(1);
+		n = __atomic_load_n(&ph->head, __ATOMIC_RELAXED);
+		fprintf(stderr, "%8lu msgs/s  total %lu  chksum %lu size %lu seqgap %lu |", (unsigned long)(n - nlast),
+			(unsigned long)n, (unsigned long)ph->chkerr, (unsigned long)ph->sizeerr, (unsigned long)ph->seqgap);
+		for (i = 0; i < GWSHM_MAXCON; i++)
+		{
+			if (__atomic_load_n(&ph->con[i].pid, __ATOMIC_RELAXED) == 0) continue;
+			fprintf(stderr, " %d: %lu lost %lu", ph->con[i].pid, (unsigned long)ph->con[i].nread,
+				(unsigned long)ph->con[i].lost);
+		}
+		fprintf(stderr, "\n");
+		nlast = n;
+	}
+	return NULL;
+}
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	struct GWSHM shm;
+	struct GBIN g;
+	struct sigaction sa;
+	pthread_t th;
+	const char* name = GWSHM_NAME;
+	uint32_t nslot = GWSHM_NSLOT;
+	uint8_t mode = GBIN_MODE_ASCII;
+	int baud = 2000000;
+	int verbose = 0;
+	int fd;
+	int c;
+	int ret;
+
+	while ((c = getopt(argc, argv, "b:n:s:Bv")) != -1)
+	{
+		switch (c)
+		{
+		case 'b': baud  = atoi(optarg);    break;
+		case 'n': name  = optarg;          break;
+		case 's': nslot = strtoul(optarg, NULL, 0); break;
+		case 'B': mode  = GBIN_MODE_BIN;   break;
+		case 'v': verbose = 1;             break;
+		default:
+			goto usage;
+		}
+	}
+	if (optind != (argc - 1)) goto usage;
+
+	fd = open(argv[optind], O_RDONLY | O_NOCTTY);
+	if (fd < 0)
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+	ret = port(fd, baud);
+	if (ret != 0)
+	{
+		fprintf(stderr, "gwshmd: %s: %s\n", argv[optind], (ret == -2) ? "baud rate not in the list" : strerror(errno));
+		return 1;
+	}
+	if (gwshm_create(&shm, name, nslot) != 0)
+	{
+		fprintf(stderr, "gwshmd: %s: %s\n", name, strerror(errno));
+		return 1;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = sigstop;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	if (verbose != 0) pthread_create(&th, NULL, stats, &shm);
+
+	gbin_init(&g, mode);
+	ret = gwshm_run(&shm, fd, &g, &stop);
+	if (ret != 0) perror(argv[optind]);
+	stop = 1;
+	if (verbose != 0) pthread_join(th, NULL);
+	gwshm_close(&shm, 1);
+	return (ret != 0);
+
+usage:
+	fprintf(stderr, "usage: %s [-b baud] [-n shmname] [-s slots] [-B] [-v] port\n", argv[0]);
+	return 1;
+}
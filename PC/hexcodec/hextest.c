@@ -0,0 +1,432 @@
+/* *****************************************************************************
+* File Name          : hextest.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : hextest: checks and throughput of the ascii/hex codec and the PC->CAN line decode
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 hextest.c ../../Ourwares/hexcodec.c ../../Ourwares/gateway_PCtoCAN.c ../../Ourwares/PC_gateway_comm.c -Istub -I../../Ourwares -o hextest
+./hextest [test...]
+
+hexcodec.c and gateway_PCtoCAN.c are compiled as they are.  The
+references are written the plain way (a char compare for each nibble,
+sprintf); 'old' in the bench is the code hexcodec replaced: a 16 char
+table and two stores per byte (gateway_CANtoPC.c), and a 256 byte table
+that read anything not hex as 0 (gateway_PCtoCAN.c).  Each test runs in
+its own process.  Prints PASS/FAIL for each; exit code is the number
+that failed.
+
+codec (user-043): every byte encodes as sprintf("%02X") does, nothing
+written past 2n; all 65536 char pairs give hexcodec_pair's byte, or -1,
+as the reference does (upper and lower case; control chars, space, '/',
+':', '@', 'G', '`', 'g', DEL, 0x80-0xFF); 1M random strings, 0-40 chars,
+some odd, some with a char from each of those classes, decode to the
+reference's bytes and return (n, -1 odd, -2 not hex).
+
+pctocan (user-043): lines built from random msgs, in upper, lower and
+mixed case, through gateway_PCtoCAN_line: good ones give the msg and no
+error bits; each of the error bits (not hex, checksum, short, seq, too
+many, dlc) is set by the line that should set it, and only by it.  One
+char of a good line replaced with one that is not hex, 200000 lines: all
+flagged PCTOCAN_ERR_NOTHEX.  The old table read those chars as 0, and
+22439 of the lines (11%) decoded with no error bit at all.
+
+bench (user-043), MB/s of bytes in (encode) or chars in (decode), 16 MB
+in 15 byte (30 char) calls as the gateway makes them, best of 5:
+            old    new
+  encode    961   1682
+  decode   1977   1924
+x86, gcc -O2.  Encode is 1 table load and 1 halfword store per byte (was
+2 + 2).  Decode is the same 2 table loads and 1 store per byte as before,
+plus an or; it now checks every char for about the same time.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "hexcodec.h"
+#include "gateway_PCtoCAN.h"
+#include "PC_gateway_comm.h"
+
+/* PC_gateway_comm.c: PC_msg_prepASCII sends with this; not used here */
+void vSerialTaskSendQueueBuf(struct SERIALSENDTASKBCB** ppbcb)
+{
+	return;
+}
+
+static char why[256];
+static int fail(const char* fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	vsnprintf(why, sizeof(why), fmt, ap);
+	va_end(ap);
+	return 1;
+}
+static uint32_t rng = 12345;
+static uint32_t rnd(void)
+{ // xorshift
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+static uint64_t nsnow(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* ======= References ==================================================================================== */
+static int refnib(uint8_t c)
+{ // Nibble, or -1
+	if ((c >= '0') && (c <= '9')) return c - '0';
+	if ((c >= 'A') && (c <= 'F')) return c - 'A' + 10;
+	if ((c >= 'a') && (c <= 'f')) return c - 'a' + 10;
+	return -1;
+}
+static int refpair(const char* p)
+{
+	int h = refnib(p[0]);
+	int l = refnib(p[1]);
+	if ((h < 0) || (l < 0)) return -1;
+	return (h << 4) | l;
+}
+/* Chars that are not hex, one of each kind */
+static const uint8_t nothex[] = {0x00, 0x09, '\n', '\r', ' ', '/', ':', '@', 'G', '`', 'g', 'Z', 'x', 0x7F, 0x80, 0xC1, 0xFF};
+#define NNOTHEX (int)(sizeof(nothex) / sizeof(nothex[0]))
+
+/* The code hexcodec replaced (bench, and the old not-hex count) */
+static const char oldh[16] = {'0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F'};
+static __attribute__((noinline)) int old_encode(char* pout, const uint8_t* pin, int n)
+{
+	int i;
+	for (i = 0; i < n; i++)
+	{
+		*pout++ = oldh[(pin[i] >> 4) & 0x0f];
+		*pout++ = oldh[pin[i] & 0x0f];
+	}
+	return (2 * n);
+}
+static uint8_t oldbin[256];
+static void oldbin_init(void)
+{ // Zero for anything not hex
+	int i;
+	for (i = 0; i < 256; i++) oldbin[i] = (refnib(i) < 0) ? 0 : refnib(i);
+	return;
+}
+static __attribute__((noinline)) int old_decode(uint8_t* pout, const char* pin, int nchar)
+{
+	const uint8_t* p = (const uint8_t*)pin;
+	int n = nchar >> 1;
+	int i;
+	for (i = 0; i < n; i++, p += 2)
+		*pout++ = (oldbin[p[0]] << 4) | oldbin[p[1]];
+	return n;
+}
+
+/* ======= codec: encode, pair, decode against the references ============================================ */
+static int t_codec(void)
+{
+	uint8_t in[256];
+	char out[2 * 256 + 8];
+	char ref[2 * 256 + 8];
+	char s[48];
+	uint8_t b[32];
+	uint8_t bref[32];
+	int i, j, k, n, nc, r, want, odd, bad;
+
+	/* Every byte, and nothing past the end */
+	for (i = 0; i < 256; i++) in[i] = i;
+	memset(out, 0x55, sizeof(out));
+	if (hexcodec_encode(out, in, 256) != 512) return fail("encode count");
+	for (i = 0; i < 256; i++) sprintf(&ref[2 * i], "%02X", i);
+	if (memcmp(out, ref, 512) != 0) return fail("encode of 0-255");
+	if (out[512] != 0x55) return fail("encode wrote past 2n");
+	for (k = 0; k < 100000; k++)
+	{
+		n = rnd() % 20;
+		for (i = 0; i < n; i++) in[i] = rnd();
+		memset(out, 0x55, sizeof(out));
+		if (hexcodec_encode(out, in, n) != 2 * n) return fail("encode %d bytes: count", n);
+		for (i = 0; i < n; i++) sprintf(&ref[2 * i], "%02X", in[i]);
+		if ((memcmp(out, ref, 2 * n) != 0) || (out[2 * n] != 0x55)) return fail("encode %d bytes", n);
+	}
+
+	/* Every pair of chars */
+	for (i = 0; i < 256; i++)
+		for (j = 0; j < 256; j++)
+		{
+			s[0] = i; s[1] = j;
+			r = hexcodec_pair(s);
+			if (r != refpair(s)) return fail("pair %02X %02X: %d, want %d", i, j, r, refpair(s));
+		}
+
+	/* Strings: random case, odd lengths, a char that is not hex now and then */
+	for (k = 0; k < 1000000; k++)
+	{
+		nc = rnd() % 41;
+		for (i = 0; i < nc; i++)
+		{
+			r = rnd();
+			s[i] = ((r & 0x100) != 0) ? "0123456789ABCDEF"[r & 15] : "0123456789abcdef"[r & 15];
+		}
+		if ((nc != 0) && ((rnd() & 3) == 0)) s[rnd() % nc] = nothex[rnd() % NNOTHEX];
+
+		odd = nc & 1;
+		bad = 0;
+		for (i = 0; i < (nc >> 1); i++)
+		{
+			r = refpair(&s[2 * i]);
+			if (r < 0) bad = 1;
+			bref[i] = r;
+		}
+		want = (odd != 0) ? -1 : (bad != 0) ? -2 : (nc >> 1);
+		memset(b, 0xAA, sizeof(b));
+		r = hexcodec_decode(b, s, nc);
+		if (r != want) return fail("decode '%.*s' (%d): %d, want %d", nc, s, nc, r, want);
+		for (i = 0; i < (nc >> 1); i++)
+			if ((refpair(&s[2 * i]) >= 0) && (b[i] != bref[i])) return fail("decode '%.*s': byte %d", nc, s, i);
+		if (b[nc >> 1] != 0xAA) return fail("decode wrote past nchar/2");
+	}
+	return 0;
+}
+
+/* ======= pctocan: gateway_PCtoCAN_line error bits ====================================================== */
+struct PCLINE
+{
+	uint8_t seq;
+	uint32_t id;
+	uint8_t dlc;     // As sent (may be > 8)
+	uint8_t pay[8];
+	int chkadd;      // Added to the checksum (0 = good)
+	int extra;       // Pairs after the checksum
+};
+static int mkline(char* s, const struct PCLINE* pl, int kase)
+{ // Ascii/hex line; kase: 0 upper, 1 lower, 2 mixed
+	uint8_t b[32];
+	int n = 0;
+	int i, k;
+
+	b[n++] = pl->seq;
+	b[n++] = pl->id; b[n++] = pl->id >> 8; b[n++] = pl->id >> 16; b[n++] = pl->id >> 24;
+	b[n++] = pl->dlc;
+	k = (pl->dlc > 8) ? 8 : pl->dlc;
+	for (i = 0; i < k; i++) b[n++] = pl->pay[i];
+	b[n] = CANgenchksum(b, n) + pl->chkadd;
+	n += 1;
+	for (i = 0; i < pl->extra; i++) b[n++] = rnd();
+	for (i = 0; i < n; i++) sprintf(&s[2 * i], "%02X", b[i]);
+	for (i = 0; i < 2 * n; i++)
+		if ((kase == 1) || ((kase == 2) && ((rnd() & 1) != 0))) s[i] = (s[i] >= 'A') ? s[i] + 32 : s[i];
+	return 2 * n;
+}
+static uint8_t line(struct GATEWAYPCTOCAN* p, const char* s, int nc, uint8_t ctrseq, struct CANRCVBUF* pcan)
+{ // As the unload does it: chars saved up to the longest line, 'ctr' counts on
+	memset(p, 0, sizeof(struct GATEWAYPCTOCAN));
+	memcpy(p->asc, s, (nc < GATEWAYPCTOCANASC) ? nc : GATEWAYPCTOCANASC);
+	p->ctr    = nc;
+	p->ctrseq = ctrseq;
+	memset(pcan, 0, sizeof(struct CANRCVBUF));
+	return gateway_PCtoCAN_line(p, pcan);
+}
+static void rndline(struct PCLINE* pl)
+{
+	int i;
+	memset(pl, 0, sizeof(struct PCLINE));
+	pl->seq = rnd();
+	pl->id  = rnd();
+	pl->dlc = rnd() % 9;
+	for (i = 0; i < 8; i++) pl->pay[i] = rnd();
+	return;
+}
+static int t_pctocan(void)
+{
+	struct GATEWAYPCTOCAN d;
+	struct CANRCVBUF can;
+	struct PCLINE pl;
+	char s[64];
+	uint8_t b[32];
+	int nc, k, e;
+	long flagged = 0;
+	long oldmissed = 0;
+	long tries = 0;
+
+	oldbin_init();
+	for (k = 0; k < 200000; k++)
+	{
+		rndline(&pl);
+
+		/* Good, any case */
+		nc = mkline(s, &pl, k % 3);
+		e = line(&d, s, nc, pl.seq - 1, &can);
+		if (e != 0) return fail("good line '%.*s': error %02X", nc, s, e);
+		if ((can.id != pl.id) || (can.dlc != pl.dlc) || (memcmp(can.cd.uc, pl.pay, pl.dlc) != 0) || (d.binseq != pl.seq))
+			return fail("good line '%.*s': msg", nc, s);
+
+		/* Each error on its own */
+		if ((e = line(&d, s, nc, pl.seq, &can)) != PCTOCAN_ERR_SEQ) return fail("seq: %02X", e);
+		if (d.ctrseq != pl.seq) return fail("seq not reset");
+		if ((e = line(&d, s, nc - 1, pl.seq - 1, &can)) != PCTOCAN_ERR_SHORT) return fail("odd: %02X", e);
+		if ((e = line(&d, s, nc - 2, pl.seq - 1, &can)) != PCTOCAN_ERR_SHORT) return fail("a byte short: %02X", e);
+		if ((e = line(&d, s, 12, pl.seq - 1, &can)) != PCTOCAN_ERR_SHORT) return fail("6 bytes: %02X", e);
+		pl.chkadd = 1 + rnd() % 255;
+		nc = mkline(s, &pl, k % 3);
+		if ((e = line(&d, s, nc, pl.seq - 1, &can)) != PCTOCAN_ERR_CHKSUM) return fail("checksum: %02X", e);
+		pl.chkadd = 0;
+		pl.extra  = 1;
+		nc = mkline(s, &pl, k % 3);
+		if ((e = line(&d, s, nc, pl.seq - 1, &can)) != PCTOCAN_ERR_TOOMANY)
+			return fail("a byte too many (dlc %d): %02X", pl.dlc, e);
+		pl.extra = 0;
+		pl.dlc   = 9 + rnd() % 247;
+		nc = mkline(s, &pl, k % 3);
+		if (((e = line(&d, s, nc, pl.seq - 1, &can)) & PCTOCAN_ERR_DLC) == 0) return fail("dlc %d: %02X", pl.dlc, e);
+		if (can.dlc != 8) return fail("dlc %d stored", can.dlc);
+
+		/* A char replaced with one that is not hex */
+		rndline(&pl);
+		nc = mkline(s, &pl, k % 3);
+		s[rnd() % nc] = nothex[rnd() % NNOTHEX];
+		tries += 1;
+		e = line(&d, s, nc, pl.seq - 1, &can);
+		if ((e & PCTOCAN_ERR_NOTHEX) == 0) return fail("'%.*s': not flagged (%02X)", nc, s, e);
+		flagged += 1;
+		old_decode(b, s, nc); // The old path: checksum of what the 0 read as
+		if ((CANgenchksum(b, nc / 2 - 1) == b[nc / 2 - 1]) && (b[0] == pl.seq) && ((7 + b[5]) == (nc / 2)))
+			oldmissed += 1;
+	}
+	printf("    pctocan: a char replaced, %ld lines: %ld flagged; the old table let %ld through\n",
+		tries, flagged, oldmissed);
+	return 0;
+}
+
+/* ======= bench: MB/s against the code it replaced ====================================================== */
+#define BENCHMB 16
+#define BENCHREP 5 // Best of
+static int t_bench(void)
+{
+	int nb = BENCHMB << 20;
+	uint8_t* pin  = (uint8_t*)malloc(nb);
+	char*    pasc = (char*)malloc(2 * nb);
+	char*    pold = (char*)malloc(2 * nb);
+	uint8_t* pout = (uint8_t*)malloc(nb);
+	double mbs[2][2] = {{0}};
+	double x;
+	uint64_t t0;
+	int i, k, j, r = 0;
+
+	if ((pin == NULL) || (pasc == NULL) || (pold == NULL) || (pout == NULL)) return fail("malloc");
+	oldbin_init();
+	for (i = 0; i < nb; i++) pin[i] = rnd();
+	memset(pasc, 0, 2 * nb); // Fault the pages in before timing
+	memset(pold, 0, 2 * nb);
+	memset(pout, 0, nb);
+
+	/* Line sized calls, as the gateway makes them (15 bytes, 30 chars) */
+	for (j = 0; j < BENCHREP; j++)
+	{
+		for (k = 0; k < 2; k++)
+		{
+			t0 = nsnow();
+			for (i = 0; (i + 15) <= nb; i += 15)
+			{
+				if (k == 0)
+					old_encode(pold + 2 * i, pin + i, 15);
+				else
+					hexcodec_encode(pasc + 2 * i, pin + i, 15);
+			}
+			x = nb / ((nsnow() - t0) / 1E9) / 1E6;
+			if (x > mbs[0][k]) mbs[0][k] = x;
+		}
+		for (k = 0; k < 2; k++)
+		{
+			t0 = nsnow();
+			for (i = 0; (i + 30) <= 2 * nb; i += 30)
+			{
+				if (k == 0)
+					r |= old_decode(pout + i / 2, pasc + i, 30);
+				else
+					r |= hexcodec_decode(pout + i / 2, pasc + i, 30);
+			}
+			x = 2.0 * nb / ((nsnow() - t0) / 1E9) / 1E6;
+			if (x > mbs[1][k]) mbs[1][k] = x;
+		}
+	}
+	if (memcmp(pold, pasc, 2 * (nb - nb % 15)) != 0) return fail("old and new encode differ");
+	if (r < 0) return fail("decode flagged good chars");
+	if (memcmp(pout, pin, nb - nb % 15) != 0) return fail("decode: not the bytes encoded");
+	printf("            old    new\n");
+	printf("  encode %6.0f %6.0f\n", mbs[0][0], mbs[0][1]);
+	printf("  decode %6.0f %6.0f\n", mbs[1][0], mbs[1][1]);
+	free(pin); free(pasc); free(pold); free(pout);
+	return 0;
+}
+
+struct TEST
+{
+	const char* name;
+	int (*fn)(void);
+};
+static const struct TEST test[] =
+{
+	{"codec",   t_codec},
+	{"pctocan", t_pctocan},
+	{"bench",   t_bench},
+};
+#define NTEST (int)(sizeof(test) / sizeof(test[0]))
+
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	int nfail = 0;
+	int st;
+	int i, j;
+	int fd[2];
+	pid_t pid;
+	ssize_t n;
+
+	for (i = 0; i < NTEST; i++)
+	{
+		if (argc > 1)
+		{
+			for (j = 1; j < argc; j++)
+				if (strcmp(argv[j], test[i].name) == 0) break;
+			if (j == argc) continue;
+		}
+		if (pipe(fd) != 0) return 1;
+		fflush(stdout);
+		pid = fork();
+		if (pid == 0)
+		{
+			close(fd[0]);
+			why[0] = 0;
+			st = test[i].fn();
+			fflush(stdout);
+			if (write(fd[1], why, strlen(why)) < 0) _exit(1);
+			_exit(st);
+		}
+		close(fd[1]);
+		memset(why, 0, sizeof(why));
+		n = read(fd[0], why, sizeof(why) - 1);
+		close(fd[0]);
+		waitpid(pid, &st, 0);
+		if ((n >= 0) && WIFEXITED(st) && (WEXITSTATUS(st) == 0))
+			printf("PASS %s\n", test[i].name);
+		else
+		{
+			nfail += 1;
+			printf("FAIL %s: %s\n", test[i].name, (why[0] != 0) ? why : "crashed");
+		}
+	}
+	return nfail;
+}
@@ -0,0 +1,32 @@
+/* *****************************************************************************
+* File Name          : FreeRTOS.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : hextest: host stand-in for the FreeRTOS types the gateway parser uses
+****************************************************************************** */
+/*
+Only what 'Ourwares/gateway_PCtoCAN.c' and 'PC_gateway_comm.c' (and the
+headers they pull in) need to compile.  The test calls
+'gateway_PCtoCAN_line' directly; the DMA unload is compiled, not run.
+*/
+
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef long          BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t      TickType_t;
+typedef void*         SemaphoreHandle_t;
+typedef void*         QueueHandle_t;
+typedef void*         TaskHandle_t;
+
+#define pdFALSE        ((BaseType_t)0)
+#define pdTRUE         ((BaseType_t)1)
+#define pdPASS         pdTRUE
+#define errQUEUE_FULL  ((BaseType_t)0)
+#define portMAX_DELAY  ((TickType_t)0xffffffffUL)
+
+#endif
@@ -0,0 +1,22 @@
+/* *****************************************************************************
+* File Name          : cmsis_os.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : hextest: host stand-in for the CMSIS-RTOS handle types
+****************************************************************************** */
+
+#ifndef _CMSIS_OS_H
+#define _CMSIS_OS_H
+
+#include "FreeRTOS.h"
+
+typedef void* osThreadId;
+typedef void* osMessageQId;
+
+/* semphr.h comes in with the real cmsis_os.h */
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t t)
+{
+	return pdTRUE;
+}
+
+#endif
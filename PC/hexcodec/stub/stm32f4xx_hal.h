@@ -0,0 +1,33 @@
+/* *****************************************************************************
+* File Name          : stm32f4xx_hal.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : hextest: host stand-in for the uart/dma handles of the gateway parser
+****************************************************************************** */
+
+#ifndef __STM32F4xx_HAL_H
+#define __STM32F4xx_HAL_H
+
+#include <stdint.h>
+
+typedef struct
+{
+	volatile uint32_t ndtr;
+} DMA_HandleTypeDef;
+
+typedef struct
+{
+	DMA_HandleTypeDef* hdmarx;
+} UART_HandleTypeDef;
+
+typedef enum
+{
+	HAL_OK = 0,
+	HAL_ERROR,
+	HAL_BUSY,
+	HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+#define __HAL_DMA_GET_COUNTER(h) ((h)->ndtr)
+
+#endif
@@ -0,0 +1,30 @@
+/* *****************************************************************************
+* File Name          : task.h
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : hextest: host stand-in for FreeRTOS task notify calls
+****************************************************************************** */
+
+#ifndef INC_TASK_H
+#define INC_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef enum
+{
+	eNoAction = 0,
+	eSetBits,
+	eIncrement,
+	eSetValueWithOverwrite,
+	eSetValueWithoutOverwrite
+} eNotifyAction;
+
+static inline BaseType_t xTaskNotifyFromISR(TaskHandle_t h, uint32_t v, eNotifyAction a, BaseType_t* pw)
+{
+	return pdPASS;
+}
+#define portYIELD_FROM_ISR(x) ((void)(x))
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+
+#endif
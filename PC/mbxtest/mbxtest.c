@@ -0,0 +1,1833 @@
+/* *****************************************************************************
+* File Name          : mbxtest.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : mbxtest: checks and timings of MailboxTask and its helpers on the PC
+****************************************************************************** */
+
+/*
+gcc -Wall -O2 -DGATEWAYTASKINCLUDED mbxtest.c pthrtos.c ../../Ourwares/mbxhist.c ../../Ourwares/mbxgate.c ../../Ourwares/paydesc.c ../../Ourwares/payload_extract.c -I../cansim/stub -I../../Ourwares -lpthread -lm -o mbxtest
+./mbxtest [test...]
+
+MailboxTask.c is compiled as it is, included here so the tests can reach
+its static functions (lookup, loadmbx, ...).  The FreeRTOS calls run on
+threads (pthrtos.c), so MailboxTask, the readers and the registering
+tasks really run at the same time.  CAN msgs come from a ring that stands
+in for the can_iface.c circular buffer; DTWTIME is the monotonic clock at
+168 MHz, or a value the test sets ('dtwset').
+
+Each test runs in its own process (MailboxTask keeps its pools and
+tables).  Prints PASS/FAIL for each; exit code is the number that failed.
+Timings are printed with the test; they are for the PC, not the M4, so
+only the ratios mean much.
+
+lookup (user-031), ns and table reads for each lookup, 1/2 hits--
+  n   binary  linear   reads: binary linear
+  4     8.7     5.1            5.9    6.5
+ 16    21.6    19.3            7.4   24.6
+ 40    30.9    25.1            8.8   60.7
+On the PC the linear pass is as fast or faster: 40 mailboxes are in the
+L1 cache and its loop branch predicts well, while the search's compares do
+not.  The M4 has no cache for the SRAM and next to no branch prediction,
+so there the reads count: the search does 9 at n = 40, the pass 61 (every
+msg without a mailbox, most of the bus, costs the pass all 80).
+
+seqlock (user-032), 2 s, one CPU: two readers, 28M reads each, none torn;
+the plain copies made alongside were torn 16 and 13 times.  With the
+'seq' recheck taken out of MailboxTask_read, 4 and 5 reads were torn.
+
+paydecode (user-033), ns per msg: the codes the switch decoded, 3.0
+switch, 13.0 table; the DMOC codes (the switch only copied them) 2.1,
+13.7.  The descriptor loop costs about 10 ns a msg more on the PC (on the
+M4 perhaps 100 cycles), against a few thousand mailbox msgs a second: well
+under 0.1% of the CPU, for decoding every code instead of half of them.
+
+notify (user-034): 200000 bursts of 1-24 msgs, mostly DMOC, to mailboxes
+with 3 tasks subscribed (GevcuTask 4 DMOC ids; one id with 3 subscribers,
+one with a subscriber that has notifications off).  Each task got one
+xTaskNotify per batch it had msgs in, never more, with the same bits as
+ORing them frame by frame.  2497299 msgs: 3591073 xTaskNotify calls the
+per-frame path made (hits) became 559024 (calls), 2.80 per batch; so at
+most that many wakeups, against up to 24 for GevcuTask alone.  With
+loadmbx notifying per frame again, or the flush skipping a task, it fails.
+
+hist (user-036), ns to add a sample and read the window, against shifting
+the samples and recomputing: n 8, 37.8 vs 12.0; n 64, 37.3 vs 15.5.  The
+PC does the recompute with vector instructions; the M4 has none, and there
+the recompute grows with n (several hundred cycles at 64) while the
+window stays constant.  At the depth of 8 GevcuTask uses either is cheap.
+
+family (user-037): a msg with no mailbox costs the same with three
+families registered as with none (5.2 vs 5.3 ns): the candidate table
+rejects it with one read.
+
+rcu (user-038): two tasks register 40 mailboxes while 2M msgs flow; every
+msg after a registration returned reached its mailbox, none went to the
+wrong one, and every published table was whole and sorted.  Holding
+MailboxTask mid batch, a registration that needs the table just replaced
+waits until it is released (it did not, with the wait taken out).  Past
+MBXPOOLSIZE, MailboxTask_add traps (33) rather than returning NULL.
+
+gate (user-039): for each policy 200000 random put/get bursts on an 8
+slot ring match a reference queue msg for msg, and 'added', 'dropped',
+'coalesced', 'lost' and 'hwm' match its counts.  With a producer task
+and the test as consumer, 2M msgs: none torn or got twice, order kept
+(except where coalesced), added + dropped + coalesced = put, got + lost =
+added, and under coalesce the newest msg of each id always got through.
+The consumer taking a slot between the producer's read of 'ridx' and its
+compare and swap is a few instructions wide; one CPU here never hit it.
+
+snap (user-040): 10.8M sets of 5 mailboxes copied in 2 s while a task
+loads them round by round: none torn, none mixed across batches (135
+copied again, 0 gave up).  Without the epoch recheck, copies tore.  The
+live history had the copy's newest sample in all but 164 sets; in those
+a msg had come in since, which is why GevcuEvents_09 checks 'dtw'.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
+#include <setjmp.h>
+#include <math.h>
+#include <sys/wait.h>
+#include "../../Ourwares/MailboxTask.c"
+
+#define NRING  256  // CAN msgs ring (power of 2)
+
+/* ======= Stand-ins for the firmware around MailboxTask ================================================= */
+uint32_t SystemCoreClock = 168000000;
+osThreadId GatewayTaskHandle;
+uint32_t pthrtos_notes(TaskHandle_t h, uint32_t* pval); // pthrtos.c
+
+static struct CAN_CTLBLOCK ctl0; // CAN1, canidx 0
+static struct CANTAKEPTR take0;
+
+/* CAN msgs for MailboxTask, as the can_iface.c circular buffer */
+static struct CANRCVBUFN ring[NRING];
+static volatile uint32_t ringadd;
+static volatile uint32_t ringtake;
+static volatile int ringstall; // 1 = hold MailboxTask at its next get; 2 = held
+
+/* DTWTIME */
+static volatile int dtwman;      // 1 = DTWTIME is 'dtwset'
+static volatile uint32_t dtwset;
+
+/* morse_trap: a test that expects one sets 'ptrapjmp' */
+static jmp_buf* volatile ptrapjmp;
+static volatile uint16_t traplast;
+
+static uint64_t nsnow(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+uint32_t cansim_dtw(void)
+{
+	if (dtwman != 0) return dtwset;
+	return (uint32_t)(nsnow() * 21 / 125);
+}
+void morse_trap(uint16_t x)
+{
+	traplast = x;
+	if (ptrapjmp != NULL) longjmp(*ptrapjmp, x);
+	fprintf(stderr, "morse_trap(%u)\n", x);
+	_exit(2);
+}
+struct CANTAKEPTR* can_iface_mbx_init(struct CAN_CTLBLOCK* pctl, osThreadId tskhandle, uint32_t notebit)
+{
+	return &take0;
+}
+struct CANRCVBUFN* can_iface_get_CANmsg(struct CANTAKEPTR* p)
+{
+	struct CANRCVBUFN* pncan;
+
+	if (ringstall == 1)
+	{ // Mid batch: past its wait, not back to it
+		ringstall = 2;
+		while (ringstall == 2) sched_yield();
+	}
+	if (ringtake == __atomic_load_n(&ringadd, __ATOMIC_ACQUIRE)) return NULL;
+	pncan = &ring[ringtake & (NRING - 1)];
+	__atomic_store_n(&ringtake, (ringtake + 1), __ATOMIC_RELEASE);
+	return pncan;
+}
+
+/* ======= Helpers ======================================================================================= */
+static char why[256];
+static int fail(const char* fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	vsnprintf(why, sizeof(why), fmt, ap);
+	va_end(ap);
+	return 1;
+}
+static uint32_t rng = 12345;
+static uint32_t rnd(void)
+{ // xorshift
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+/* MailboxTask for CAN1 as main.c sets it up.
+   task = 1: MailboxTask runs (a thread).  task = 0: the test thread is
+   "MailboxTask" and calls the static functions itself. */
+static struct MAILBOXCANNUM* mbxsetup(int task, uint16_t arraysize)
+{
+	ctl0.canidx = 0;
+	if (task != 0)
+	{
+		xMailboxTaskCreate(1);
+	}
+	else
+	{
+		mbxaddmutex = xSemaphoreCreateMutex();
+		gatebufsetup(&mbxgate[0]);
+		MailboxTaskHandle = xTaskGetCurrentTaskHandle();
+	}
+	if (MailboxTask_add_CANlist(&ctl0, arraysize) == NULL) return NULL;
+	return &mbxcannum[0];
+}
+/* A CAN msg for MailboxTask (the CAN RX0 callback) */
+static void put(uint32_t id, uint8_t dlc, const uint8_t* puc)
+{
+	struct CANRCVBUFN* pncan;
+
+	while ((ringadd - __atomic_load_n(&ringtake, __ATOMIC_ACQUIRE)) >= (NRING - 8))
+		sched_yield(); // MailboxTask behind
+	pncan = &ring[ringadd & (NRING - 1)];
+	memset(pncan, 0, sizeof(struct CANRCVBUFN));
+	pncan->can.id  = id;
+	pncan->can.dlc = dlc;
+	if (puc != NULL) memcpy(&pncan->can.cd.uc[0], puc, 8);
+	pncan->toa  = DTWTIME;
+	pncan->pctl = &ctl0;
+	__atomic_store_n(&ringadd, (ringadd + 1), __ATOMIC_RELEASE);
+	xTaskNotify(MailboxTaskHandle, MBXNOTEBITCAN1, eSetBits);
+	return;
+}
+
+/* ======= lookup: binary search vs the linear scan it replaced (user-031) ================================ */
+/* The old lookup: a pass down the mailbox pointers in the order added */
+static struct MAILBOXCAN* linear(struct MAILBOXCAN** ppmbx, int n, uint32_t canid)
+{
+	int i;
+	for (i = 0; i < n; i++)
+	{
+		if ((*(ppmbx + i))->ncan.can.id == canid)
+			return *(ppmbx + i);
+	}
+	return NULL;
+}
+/* Table reads for one lookup: ids, and the mailbox pointer for a hit */
+static int binreads(struct MBXTABLE* ptbl, uint32_t canid)
+{
+	int lo = 0;
+	int hi = ptbl->n;
+	int r = 2; // Quick reject
+	int mid;
+
+	if ((canid < ptbl->pidarray[0]) || (canid > ptbl->pidarray[ptbl->n - 1])) return r;
+	while (lo < hi)
+	{
+		mid = (lo + hi) >> 1;
+		r += 1;
+		if (ptbl->pidarray[mid] < canid)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	r += 1; // Compare at 'lo'
+	if ((lo < ptbl->n) && (ptbl->pidarray[lo] == canid)) r += 1;
+	return r;
+}
+static int linreads(struct MAILBOXCAN** ppmbx, int n, uint32_t canid)
+{ // Pointer and id for each mailbox passed
+	int i;
+	for (i = 0; i < n; i++)
+	{
+		if ((*(ppmbx + i))->ncan.can.id == canid)
+			return 2 * (i + 1);
+	}
+	return 2 * n;
+}
+static double nsper(struct MAILBOXCANNUM* pmbxnum, struct MAILBOXCAN** padded, int n,
+	const uint32_t* pprobe, int nprobe, int old)
+{
+	struct MAILBOXCAN* volatile sink;
+	uint64_t t0;
+	int rep;
+	int i;
+
+	t0 = nsnow();
+	for (rep = 0; rep < 256; rep++)
+	{
+		for (i = 0; i < nprobe; i++)
+		{
+			if (old != 0)
+				sink = linear(padded, n, pprobe[i]);
+			else
+				sink = lookup(pmbxnum, pprobe[i]);
+		}
+	}
+	(void)sink;
+	return (double)(nsnow() - t0) / (256.0 * nprobe);
+}
+static int t_lookup(void)
+{
+	static const int nbench[] = {4, 8, 16, 24, 32, 40};
+	struct MAILBOXCANNUM* pmbxnum = mbxsetup(0, 48);
+	struct MAILBOXCAN* padded[40];
+	struct MBXTABLE* ptbl;
+	uint32_t probe[4096];
+	uint32_t id;
+	int n = 0;
+	int b = 0;
+	int i, j;
+
+	if (pmbxnum == NULL) return fail("MailboxTask_add_CANlist");
+	printf("    lookup: per lookup, binary vs linear: ns (PC), memory reads (as on the M4)\n");
+	printf("             n   1/2 hits: ns       reads    no hits: ns       reads\n");
+	while (n < 40)
+	{
+		id = rnd() & ~0x3u; // Our format: IDE, RTR bits clear
+		if (id == 0) continue;
+		if (linear(padded, n, id) != NULL) continue;
+		padded[n] = MailboxTask_add(&ctl0, id, NULL, 0, 0, 0);
+		if (padded[n] == NULL) return fail("add %d", n);
+		n += 1;
+
+		/* Table sorted, ids in step with the mailboxes */
+		ptbl = pmbxnum->ptbl;
+		if (ptbl->n != n) return fail("table n %d, added %d", ptbl->n, n);
+		for (i = 0; i < n; i++)
+		{
+			if ((i > 0) && (ptbl->pidarray[i - 1] >= ptbl->pidarray[i]))
+				return fail("not sorted at %d of %d", i, n);
+			if (ptbl->pmbxarray[i]->ncan.can.id != ptbl->pidarray[i])
+				return fail("id %08X at %d, mailbox %08X", ptbl->pidarray[i], i, ptbl->pmbxarray[i]->ncan.can.id);
+		}
+
+		/* Same answer as the linear scan: members, neighbours, ends, random */
+		for (i = 0; i < 25000; i++)
+		{
+			switch (i & 3)
+			{
+			case 0: id = padded[rnd() % n]->ncan.can.id; break;
+			case 1: id = padded[rnd() % n]->ncan.can.id + ((rnd() & 1) ? 1 : -1); break;
+			case 2: id = (rnd() & 1) ? ptbl->pidarray[0] - (rnd() & 7) : ptbl->pidarray[n - 1] + (rnd() & 7); break;
+			default: id = rnd(); break;
+			}
+			if (lookup(pmbxnum, id) != linear(padded, n, id))
+				return fail("n %d, id %08X: lookup %p, linear %p", n, id,
+					(void*)lookup(pmbxnum, id), (void*)linear(padded, n, id));
+		}
+		if (lookup(pmbxnum, 0) != NULL) return fail("id 0 found");
+		if (lookup(pmbxnum, 0xFFFFFFFF) != linear(padded, n, 0xFFFFFFFF)) return fail("id FFFFFFFF");
+
+		/* Timings at a few sizes */
+		if ((b < (int)(sizeof(nbench) / sizeof(nbench[0]))) && (n == nbench[b]))
+		{
+			double ns[4];
+			uint32_t rd[4] = {0, 0, 0, 0};
+			for (j = 0; j < 4096; j++)
+			{
+				probe[j] = ((j & 1) != 0) ? padded[rnd() % n]->ncan.can.id : rnd();
+				rd[0] += binreads(ptbl, probe[j]);
+				rd[1] += linreads(padded, n, probe[j]);
+			}
+			ns[0] = nsper(pmbxnum, padded, n, probe, 4096, 0);
+			ns[1] = nsper(pmbxnum, padded, n, probe, 4096, 1);
+			for (j = 0; j < 4096; j++)
+			{
+				probe[j] = rnd() | 1; // Never an id added
+				rd[2] += binreads(ptbl, probe[j]);
+				rd[3] += linreads(padded, n, probe[j]);
+			}
+			ns[2] = nsper(pmbxnum, padded, n, probe, 4096, 0);
+			ns[3] = nsper(pmbxnum, padded, n, probe, 4096, 1);
+			printf("            %2d   %5.1f %5.1f  %5.1f %5.1f     %5.1f %5.1f  %5.1f %5.1f\n", n,
+				ns[0], ns[1], rd[0] / 4096.0, rd[1] / 4096.0, ns[2], ns[3], rd[2] / 4096.0, rd[3] / 4096.0);
+			b += 1;
+		}
+	}
+	return 0;
+}
+
+/* ======= seqlock: MailboxTask_read against MailboxTask loading the mailbox (user-032) ===================== */
+/* Msg k (from 0) has payload k, ~k (U32_U32), so a whole copy has
+   ui[1] == ~ui[0], readings == payload, and 'ctr' == k + 1. */
+#define SEQID 0x40000000
+struct SEQRDR
+{
+	struct MAILBOXCAN* pmbx;
+	uint32_t reads;   // MailboxTask_read calls
+	uint32_t giveup;  // Returned -1
+	uint32_t torn;    // Returned 0, copy not whole
+	uint32_t rawtorn; // Plain copies (no seqlock) not whole
+	uint32_t back;    // Copy older than the one before
+};
+static volatile int seqstop;
+static int seqwhole(struct MAILBOXCAN* pc)
+{
+	return ((pc->ncan.can.cd.ui[1] == ~pc->ncan.can.cd.ui[0]) &&
+	        (pc->mbx.u.i32[0] == pc->ncan.can.cd.ui[0]) &&
+	        (pc->mbx.u.i32[1] == pc->ncan.can.cd.ui[1]) &&
+	        (pc->ctr == (pc->ncan.can.cd.ui[0] + 1)));
+}
+static void StartSeqReader(void const* argument)
+{
+	struct SEQRDR* pr = (struct SEQRDR*)argument;
+	struct MAILBOXCAN c;
+	uint32_t last = 0;
+
+	while (seqstop == 0)
+	{
+		pr->reads += 1;
+		if (MailboxTask_read(pr->pmbx, &c) != 0)
+		{
+			pr->giveup += 1;
+		}
+		else
+		{
+			if (seqwhole(&c) == 0) pr->torn += 1;
+			if (c.ctr < last) pr->back += 1;
+			last = c.ctr;
+		}
+		memcpy(&c, (void*)pr->pmbx, sizeof(c));
+		if (seqwhole(&c) == 0) pr->rawtorn += 1;
+	}
+	for (;;) osDelay(1000);
+}
+static int t_seqlock(void)
+{
+	struct SEQRDR rdr[2];
+	struct MAILBOXCAN* pmbx;
+	uint32_t pay[2];
+	uint64_t tend;
+	uint32_t k = 0;
+	int i;
+
+	if (mbxsetup(1, 16) == NULL) return fail("MailboxTask_add_CANlist");
+	pmbx = MailboxTask_add(&ctl0, SEQID, NULL, 0, 0, 4); // U32_U32
+	if (pmbx == NULL) return fail("MailboxTask_add");
+	pay[0] = 0; pay[1] = ~0u;
+	put(SEQID, 8, (uint8_t*)pay); // Whole before the readers start
+	while (pmbx->ctr != 1) sched_yield();
+
+	memset(rdr, 0, sizeof(rdr));
+	for (i = 0; i < 2; i++)
+	{
+		osThreadDef(SeqReader, StartSeqReader, osPriorityNormal, 0, 128);
+		rdr[i].pmbx = pmbx;
+		osThreadCreate(osThread(SeqReader), &rdr[i]);
+	}
+	tend = nsnow() + 2000000000ull;
+	for (k = 1; nsnow() < tend; k++)
+	{
+		pay[0] = k; pay[1] = ~k;
+		put(SEQID, 8, (uint8_t*)pay);
+	}
+	while (ringtake != ringadd) sched_yield();
+	seqstop = 1;
+	osDelay(10);
+
+	printf("   seqlock: %u msgs; reads %u %u, gave up %u %u, torn %u %u; plain copies torn %u %u\n",
+		k, rdr[0].reads, rdr[1].reads, rdr[0].giveup, rdr[1].giveup,
+		rdr[0].torn, rdr[1].torn, rdr[0].rawtorn, rdr[1].rawtorn);
+	if (pmbx->ctr != k) return fail("ctr %u, %u msgs", pmbx->ctr, k);
+	for (i = 0; i < 2; i++)
+	{
+		if (rdr[i].torn != 0) return fail("reader %d: %u torn copies", i, rdr[i].torn);
+		if (rdr[i].back != 0) return fail("reader %d: %u copies went back", i, rdr[i].back);
+		if (rdr[i].reads < 1000) return fail("reader %d: %u reads", i, rdr[i].reads);
+	}
+	return 0;
+}
+
+/* ======= paydecode: table decoders vs the switch they replaced (user-033) ================================ */
+/* Payload type codes (paycnvt.c) */
+#define PT_FF          1
+#define PT_FF_FF       2
+#define PT_U32         3
+#define PT_U32_U32     4
+#define PT_U8_U32      5
+#define PT_S32         6
+#define PT_S32_S32     7
+#define PT_U8_S32      8
+#define PT_xFF        11
+#define PT_xxFF       12
+#define PT_xxU32      13
+#define PT_xxS32      14
+#define PT_U8_U8_U32  15
+#define PT_U8_U8_S32  16
+#define PT_U8_U8_FF   17
+#define PT_U8_FF      21
+#define PT_U8         23
+#define PT_UNIXTIME   24
+#define PT_U8_U8_U8_U32 26
+#define PT_U8_VAR     36
+#define PT_UNDEF     255
+
+/* payload_extract.c before the descriptors (ba0b0b2^), codes as numbers */
+static void oldextract(struct MAILBOXCAN* pmbx)
+{
+	switch (pmbx->paytype)
+	{
+	case PT_U8:
+	case PT_U8_VAR:
+		if (pmbx->ncan.can.dlc >= 1)
+		{
+			pmbx->mbx.pre8[0] = pmbx->ncan.can.cd.uc[0];
+		}
+		break;		
+	case PT_FF:
+	case PT_U32:
+	case PT_S32:
+		if (pmbx->ncan.can.dlc >= 4)
+		{
+			pmbx->mbx.u.i32[0] = pmbx->ncan.can.cd.ui[0];
+			pmbx->ctr +=1 ;
+		}
+		break;	
+	case PT_xFF:
+		if (pmbx->ncan.can.dlc >= 5)
+		{
+			pmbx->mbx.u.i8[0] = pmbx->ncan.can.cd.uc[1];
+			pmbx->mbx.u.i8[1] = pmbx->ncan.can.cd.uc[2];
+			pmbx->mbx.u.i8[2] = pmbx->ncan.can.cd.uc[3];
+			pmbx->mbx.u.i8[3] = pmbx->ncan.can.cd.uc[4];
+			pmbx->ctr +=1 ;
+		}
+		break;	
+	case PT_xxFF:
+	case PT_xxU32:
+	case PT_xxS32:
+		if (pmbx->ncan.can.dlc >= 6)
+		{
+			pmbx->mbx.u.i8[0] = pmbx->ncan.can.cd.uc[2];
+			pmbx->mbx.u.i8[1] = pmbx->ncan.can.cd.uc[3];
+			pmbx->mbx.u.i8[2] = pmbx->ncan.can.cd.uc[4];
+			pmbx->mbx.u.i8[3] = pmbx->ncan.can.cd.uc[5];
+			pmbx->ctr +=1 ;
+		}
+		break;
+	case PT_U8_FF:
+	case PT_U8_U32:
+	case PT_U8_S32:
+	case PT_UNIXTIME:
+		if (pmbx->ncan.can.dlc >= 5)
+		{ 
+			pmbx->mbx.pre8[0] = pmbx->ncan.can.cd.uc[0];
+			pmbx->mbx.u.i8[0] = pmbx->ncan.can.cd.uc[1];
+			pmbx->mbx.u.i8[1] = pmbx->ncan.can.cd.uc[2];
+			pmbx->mbx.u.i8[2] = pmbx->ncan.can.cd.uc[3];
+			pmbx->mbx.u.i8[3] = pmbx->ncan.can.cd.uc[4];
+			pmbx->ctr +=1 ;		
+		}
+		break;	
+	case PT_U8_U8_FF:
+	case PT_U8_U8_U32:
+	case PT_U8_U8_S32:
+		if (pmbx->ncan.can.dlc >= 6)
+		{ 
+			pmbx->mbx.pre8[0] = pmbx->ncan.can.cd.uc[0];
+			pmbx->mbx.pre8[1] = pmbx->ncan.can.cd.uc[1];
+			pmbx->mbx.u.i8[0] = pmbx->ncan.can.cd.uc[2];
+			pmbx->mbx.u.i8[1] = pmbx->ncan.can.cd.uc[3];
+			pmbx->mbx.u.i8[2] = pmbx->ncan.can.cd.uc[4];
+			pmbx->mbx.u.i8[3] = pmbx->ncan.can.cd.uc[5];
+			pmbx->ctr +=1 ;		
+		}
+		break;
+	case PT_U8_U8_U8_U32:
+		if (pmbx->ncan.can.dlc >= 7)
+		{ 
+			pmbx->mbx.pre8[0] = pmbx->ncan.can.cd.uc[0];
+			pmbx->mbx.pre8[1] = pmbx->ncan.can.cd.uc[1];
+			pmbx->mbx.pre8[2] = pmbx->ncan.can.cd.uc[2];
+			pmbx->mbx.u.i8[0] = pmbx->ncan.can.cd.uc[3];
+			pmbx->mbx.u.i8[1] = pmbx->ncan.can.cd.uc[4];
+			pmbx->mbx.u.i8[2] = pmbx->ncan.can.cd.uc[5];
+			pmbx->mbx.u.i8[3] = pmbx->ncan.can.cd.uc[6];
+			pmbx->ctr +=1 ;		
+		}
+		break;
+	case PT_FF_FF:
+	case PT_U32_U32:
+	case PT_S32_S32:
+		if (pmbx->ncan.can.dlc >= 8)
+		{
+			pmbx->mbx.u.i64 = pmbx->ncan.can.cd.ull;
+			pmbx->ctr +=1 ;
+		}
+		break;	
+	case PT_UNDEF:
+	default: 
+		{
+			pmbx->mbx.u.i64 = pmbx->ncan.can.cd.ull;
+			pmbx->ctr +=1 ;
+		}
+		break;	
+	}
+	return;
+}
+/* Codes the switch decoded (the rest it copied raw) */
+static const uint8_t oldcodes[] = {PT_U8, PT_U8_VAR, PT_FF, PT_U32, PT_S32, PT_xFF, PT_xxFF, PT_xxU32,
+	PT_xxS32, PT_U8_FF, PT_U8_U32, PT_U8_S32, PT_UNIXTIME, PT_U8_U8_FF, PT_U8_U8_U32, PT_U8_U8_S32,
+	PT_U8_U8_U8_U32, PT_FF_FF, PT_U32_U32, PT_S32_S32, 20, PT_UNDEF, 100};
+
+/* Expected layout of the codes the switch did not decode, from the list
+   in paycnvt.c: source byte, format, and where it goes (pre8 index, or
+   union byte + 8) */
+struct PAYEXP
+{
+	uint8_t code;
+	uint8_t dlc;
+	uint8_t n;
+	uint8_t f[5][3]; // {payload byte, PAYFMT_, destination}
+};
+#define PU(x) ((x) + 8)
+static const struct PAYEXP payexp[] =
+{
+	{ 9, 2, 1, {{0, PAYFMT_HF,  PU(0)}}},
+	{10, 3, 1, {{0, PAYFMT_F34F, PU(0)}}},
+	{18, 2, 1, {{0, PAYFMT_U16, PU(0)}}},
+	{19, 2, 1, {{0, PAYFMT_S16, PU(0)}}},
+	{22, 3, 2, {{0, PAYFMT_U8, 0}, {1, PAYFMT_HF, PU(0)}}},
+	{25, 2, 2, {{0, PAYFMT_U8, 0}, {1, PAYFMT_U8, 1}}},
+	{27, 4, 2, {{0, PAYFMT_I16, PU(0)}, {2, PAYFMT_I16, PU(2)}}},
+	{28, 7, 3, {{0, PAYFMT_I16, PU(0)}, {2, PAYFMT_I16, PU(2)}, {6, PAYFMT_U8, PU(4)}}},
+	{29, 3, 3, {{0, PAYFMT_U8, 0}, {1, PAYFMT_U8, 1}, {2, PAYFMT_U8, 2}}},
+	{30, 7, 2, {{0, PAYFMT_I16, PU(0)}, {6, PAYFMT_U8, PU(2)}}},
+	{31, 8, 4, {{0, PAYFMT_I16, PU(0)}, {2, PAYFMT_I16, PU(2)}, {4, PAYFMT_I16, PU(4)}, {6, PAYFMT_I16, PU(6)}}},
+	{32, 7, 2, {{0, PAYFMT_I16, PU(0)}, {5, PAYFMT_I16, PU(2)}}},
+	{33, 7, 4, {{0, PAYFMT_I16, PU(0)}, {2, PAYFMT_I16, PU(2)}, {4, PAYFMT_I16, PU(4)}, {6, PAYFMT_U8, PU(6)}}},
+	{34, 7, 4, {{0, PAYFMT_I16, PU(0)}, {2, PAYFMT_I16, PU(2)}, {5, PAYFMT_U8, PU(4)}, {6, PAYFMT_U8, PU(5)}}},
+	{35, 2, 1, {{0, PAYFMT_I16, PU(0)}}},
+	{37, 5, 5, {{0, PAYFMT_U8, 0}, {1, PAYFMT_S8, 1}, {2, PAYFMT_S8, 2}, {3, PAYFMT_S8, 3}, {4, PAYFMT_S8, PU(0)}}},
+	{249, 6, 3, {{0, PAYFMT_U8, 0}, {1, PAYFMT_U8, 1}, {2, PAYFMT_U32, PU(0)}}},
+	{250, 6, 3, {{0, PAYFMT_U8, 0}, {1, PAYFMT_U8, 1}, {2, PAYFMT_U32, PU(0)}}},
+};
+#define NPAYEXP (int)(sizeof(payexp) / sizeof(payexp[0]))
+
+static int paycheck(const struct PAYEXP* pe, struct MAILBOXCAN* pm)
+{ // 0 = readings as expected
+	const uint8_t* p = &pm->ncan.can.cd.uc[0];
+	union {uint32_t u; float f;} x;
+	_Float16 h;
+	uint8_t got[12];
+	uint8_t want[12];
+	uint16_t s;
+	int i;
+
+	memcpy(&got[0], &pm->mbx.pre8[0], 4);
+	memcpy(&got[4], &pm->mbx.u.i8[0], 8);
+	memset(want, 0, sizeof(want));
+	for (i = 0; i < pe->n; i++)
+	{
+		uint8_t* pw = &want[(pe->f[i][2] < 8) ? pe->f[i][2] : (pe->f[i][2] - 8 + 4)];
+		uint8_t off = pe->f[i][0];
+		switch (pe->f[i][1])
+		{
+		case PAYFMT_U8:
+		case PAYFMT_S8:  pw[0] = p[off]; break;
+		case PAYFMT_U16:
+		case PAYFMT_S16: pw[0] = p[off]; pw[1] = p[off + 1]; break;
+		case PAYFMT_I16: pw[0] = p[off + 1]; pw[1] = p[off]; break;
+		case PAYFMT_U32: memcpy(pw, &p[off], 4); break;
+		case PAYFMT_HF:
+			s = p[off] | (p[off + 1] << 8);
+			memcpy(&h, &s, 2);
+			x.f = (float)h;
+			memcpy(pw, &x.u, 4);
+			if (x.f != x.f)
+			{ // Any NaN will do (the quiet bit differs)
+				memcpy(&x.u, &got[pw - want], 4);
+				if (x.f != x.f) memcpy(pw, &x.u, 4);
+			}
+			break;
+		case PAYFMT_F34F:
+			pw[0] = 0; pw[1] = p[off]; pw[2] = p[off + 1]; pw[3] = p[off + 2];
+			break;
+		}
+	}
+	return memcmp(got, want, sizeof(got));
+}
+static double nsdecode(struct MAILBOXCAN* pm, int nm, int old)
+{
+	uint64_t t0 = nsnow();
+	int rep;
+	int i;
+
+	for (rep = 0; rep < 2000; rep++)
+	{
+		for (i = 0; i < nm; i++)
+		{
+			if (old != 0)
+				oldextract(&pm[i]);
+			else
+				payload_extract(&pm[i]);
+		}
+		__asm__ volatile("" ::: "memory");
+	}
+	return (double)(nsnow() - t0) / (2000.0 * nm);
+}
+static int t_paydecode(void)
+{
+	static const uint8_t dmoc[] = {27, 28, 30, 31, 32, 33, 34, 35};
+	static struct MAILBOXCAN ma, mb, mm[512];
+	union {uint32_t u; float f;} x, y;
+	_Float16 h;
+	uint16_t s;
+	int c, d, i, k, r;
+	int nm;
+
+	/* Same readings as the switch, every dlc, random payloads */
+	for (c = 0; c < (int)sizeof(oldcodes); c++)
+	{
+		for (d = 0; d <= 8; d++)
+		{
+			for (i = 0; i < 500; i++)
+			{
+				memset(&ma, 0, sizeof(ma));
+				ma.paytype = oldcodes[c];
+				ma.ncan.can.dlc = d;
+				for (k = 0; k < 8; k++) ma.ncan.can.cd.uc[k] = rnd();
+				mb = ma;
+				oldextract(&ma);
+				r = payload_extract(&mb);
+				if (memcmp(&ma.mbx, &mb.mbx, sizeof(ma.mbx)) != 0)
+					return fail("code %u dlc %d: readings differ from the switch", oldcodes[c], d);
+				if ((oldcodes[c] == PT_U8) || (oldcodes[c] == PT_U8_VAR))
+				{ // The switch did not count these
+					if (mb.ctr != ((d >= 1) ? 1 : 0)) return fail("code %u dlc %d: ctr %u", oldcodes[c], d, mb.ctr);
+				}
+				else if (ma.ctr != mb.ctr)
+					return fail("code %u dlc %d: ctr %u, switch %u", oldcodes[c], d, mb.ctr, ma.ctr);
+				if ((r != 0) != (mb.ctr == 0))
+					return fail("code %u dlc %d: returned %d, ctr %u", oldcodes[c], d, r, mb.ctr);
+			}
+		}
+	}
+
+	/* The codes the switch copied raw, from the list */
+	for (c = 0; c < NPAYEXP; c++)
+	{
+		for (d = 0; d <= 8; d++)
+		{
+			for (i = 0; i < 500; i++)
+			{
+				memset(&mb, 0, sizeof(mb));
+				mb.paytype = payexp[c].code;
+				mb.ncan.can.dlc = d;
+				for (k = 0; k < 8; k++) mb.ncan.can.cd.uc[k] = rnd();
+				r = payload_extract(&mb);
+				if (d < payexp[c].dlc)
+				{
+					if ((r != -1) || (mb.ctr != 0) || (mb.mbx.u.i64 != 0) || (memcmp(mb.mbx.pre8, "\0\0\0\0", 4) != 0))
+						return fail("code %u dlc %d: short payload stored", payexp[c].code, d);
+					continue;
+				}
+				if ((r != 0) || (mb.ctr != 1)) return fail("code %u dlc %d: returned %d", payexp[c].code, d, r);
+				if (paycheck(&payexp[c], &mb) != 0)
+					return fail("code %u dlc %d: readings not as the list", payexp[c].code, d);
+			}
+		}
+	}
+
+	/* Every half float */
+	for (k = 0; k < 65536; k++)
+	{
+		s = k;
+		memcpy(&h, &s, 2);
+		x.f = paydesc_halftofloat(s);
+		y.f = (float)h;
+		if ((y.f != y.f) ? (x.f == x.f) : (x.u != y.u))
+			return fail("half %04X: %08X, want %08X", k, x.u, y.u);
+	}
+
+	/* Timings: the codes both decode, then the DMOC types */
+	for (nm = 0; nm < 512; nm++)
+	{
+		memset(&mm[nm], 0, sizeof(mm[nm]));
+		mm[nm].paytype = oldcodes[rnd() % (sizeof(oldcodes) - 3)];
+		mm[nm].ncan.can.dlc = 8;
+		mm[nm].ncan.can.cd.ull = ((uint64_t)rnd() << 32) | rnd();
+	}
+	x.f = nsdecode(mm, 512, 1);
+	y.f = nsdecode(mm, 512, 0);
+	for (nm = 0; nm < 512; nm++)
+		mm[nm].paytype = dmoc[rnd() % sizeof(dmoc)];
+	printf(" paydecode: ns/msg, switch vs table: switch codes %.1f %.1f; DMOC codes %.1f (raw copy) %.1f\n",
+		x.f, y.f, nsdecode(mm, 512, 1), nsdecode(mm, 512, 0));
+	return 0;
+}
+
+/* ======= notify: one xTaskNotify per task per drained batch (user-034) ================================== */
+#define NOTEBATCHES 200000
+#define NOTETASKS   3        // GevcuTask, a contactor task, a logger
+struct NOTESUB
+{
+	uint32_t id;
+	int task;                // Index of subscribing task; -1 = no mailbox
+	uint32_t bit;
+	uint8_t skip;
+};
+static const struct NOTESUB notesub[] =
+{ // DMOC ids from the GEVCU setup, plus other subscribers of some of them
+	{0x47400000, 0, (1 <<  8), 0}, // dmoc_actualtorq
+	{0x47600000, 0, (1 <<  9), 0}, // dmoc_speed
+	{0xCA000000, 0, (1 << 13), 0}, // dmoc_hv_status
+	{0xCA200000, 0, (1 << 14), 0}, // dmoc_hv_temps
+	{0x00400000, 0, (1 <<  6), 0}, // gps_sync: three tasks
+	{0x00400000, 1, (1 <<  2), 0},
+	{0x00400000, 2, (1 << 20), 0},
+	{0xE3800000, 1, (1 <<  0), 0}, // contactor keepalive response
+	{0xCA000000, 2, (1 <<  5), 0}, // hv_status logged too
+	{0x47400000, 2, (1 <<  7), 1}, // ...torque, notifications disabled
+	{0x05683004, -1, 0, 0},        // Bus traffic without a mailbox
+	{0xE1000000, -1, 0, 0},
+};
+#define NNOTESUB (int)(sizeof(notesub) / sizeof(notesub[0]))
+static void msgat(struct MAILBOXCANNUM* pmbxnum, uint32_t id, uint32_t toa)
+{ // MailboxTask gets a msg that arrived at DTW 'toa'
+	struct CANRCVBUFN ncan;
+
+	memset(&ncan, 0, sizeof(ncan));
+	ncan.can.id  = id;
+	ncan.can.dlc = 1;
+	ncan.toa     = toa;
+	ncan.pctl    = &ctl0;
+	loadmbx(pmbxnum, &ncan);
+	return;
+}
+static void StartIdle(void const* argument)
+{ // A task that is notified, but never reads them (the test looks)
+	for (;;) osDelay(1000);
+}
+static int t_notify(void)
+{
+	struct MAILBOXCANNUM* pmbxnum = mbxsetup(0, 16);
+	osThreadId th[NOTETASKS];
+	uint32_t refbits[NOTETASKS];
+	uint64_t refcalls = 0; // xTaskNotify calls the per-frame path made
+	uint64_t calls = 0;
+	uint64_t msgs = 0;
+	uint32_t v;
+	uint32_t n;
+	int b, i, j, k;
+
+	if (pmbxnum == NULL) return fail("MailboxTask_add_CANlist");
+	for (k = 0; k < NOTETASKS; k++)
+	{
+		osThreadDef(Idle, StartIdle, osPriorityNormal, 0, 128);
+		th[k] = osThreadCreate(osThread(Idle), NULL);
+	}
+	for (j = 0; j < NNOTESUB; j++)
+	{
+		if (notesub[j].task < 0) continue;
+		if (MailboxTask_add(&ctl0, notesub[j].id, th[notesub[j].task], notesub[j].bit, notesub[j].skip, 23) == NULL)
+			return fail("MailboxTask_add %08X", notesub[j].id);
+	}
+
+	/* Bursts as MailboxTask drains them: 1-24 msgs, DMOC ids most often */
+	for (b = 0; b < NOTEBATCHES; b++)
+	{
+		memset(refbits, 0, sizeof(refbits));
+		n = 1 + rnd() % 24;
+		for (i = 0; i < (int)n; i++)
+		{
+			k = rnd() % (NNOTESUB + 4);
+			if (k >= NNOTESUB) k = rnd() % 4; // DMOC
+			msgat(pmbxnum, notesub[k].id, 0);
+			msgs += 1;
+			for (j = 0; j < NNOTESUB; j++)
+			{ // The old path: xTaskNotify for each subscriber of each msg
+				if ((notesub[j].id != notesub[k].id) || (notesub[j].task < 0) || (notesub[j].skip != 0))
+					continue;
+				refbits[notesub[j].task] |= notesub[j].bit;
+				refcalls += 1;
+			}
+		}
+		notify_flush();
+		for (k = 0; k < NOTETASKS; k++)
+		{
+			n = pthrtos_notes(th[k], &v);
+			if (n != ((refbits[k] != 0) ? 1 : 0))
+				return fail("batch %d: task %d notified %u times, bits %X", b, k, n, refbits[k]);
+			if (v != refbits[k])
+				return fail("batch %d: task %d got %X, per frame %X", b, k, v, refbits[k]);
+			calls += n;
+		}
+	}
+	if ((mbxnotestats.hits != refcalls) || (mbxnotestats.calls != calls))
+		return fail("stats: hits %u (want %lu) calls %u (want %lu)", mbxnotestats.hits,
+			(unsigned long)refcalls, mbxnotestats.calls, (unsigned long)calls);
+	printf("    notify: %lu msgs in %d batches; %lu per frame xTaskNotify -> %lu (%.2f per batch, max %u merged)\n",
+		(unsigned long)msgs, NOTEBATCHES, (unsigned long)refcalls, (unsigned long)calls,
+		(double)calls / NOTEBATCHES, mbxnotestats.hitsmax);
+	return 0;
+}
+
+/* ======= stale: mailbox age and staleness across the DTW wrap (user-035) ================================ */
+static uint32_t notesgot(void)
+{ // Notification bits MailboxTask sent the test task
+	uint32_t v = 0;
+	notify_flush();
+	if (xTaskNotifyWait(0, 0xFFFFFFFF, &v, 0) != pdTRUE) return 0;
+	return v;
+}
+#define STALEID  0x50000000
+#define STALEID2 0x50200000
+#define DTWMS    168000u // DTW ticks per ms
+static int t_stale(void)
+{
+	struct MAILBOXCANNUM* pmbxnum = mbxsetup(0, 8);
+	struct MAILBOXCAN* pmbx;
+	struct MAILBOXCAN* pmbx2;
+	jmp_buf jb;
+	uint32_t t0;
+	uint32_t d;
+	uint32_t v;
+	int i;
+
+	if (pmbxnum == NULL) return fail("MailboxTask_add_CANlist");
+	dtwman = 1;
+	dtwset = 0xFFFFFFFF - 150 * DTWMS; // 150 ms before the wrap
+	pmbx  = MailboxTask_add(&ctl0, STALEID,  NULL, 0x10, 0, 23); // U8
+	pmbx2 = MailboxTask_add(&ctl0, STALEID2, NULL, 0x20, 0, 23);
+	if ((pmbx == NULL) || (pmbx2 == NULL)) return fail("MailboxTask_add");
+
+	/* 100 ms period, max age 3 periods; the other never gets a msg */
+	t0 = dtwset;
+	MailboxTask_set_age(pmbx,  100, 0, 0x100);
+	MailboxTask_set_age(pmbx2, 100, 250, 0x200);
+	if (pmbx->maxage != 300 * DTWMS) return fail("maxage %u", pmbx->maxage);
+	msgat(pmbxnum, STALEID, t0);
+	if (notesgot() != 0x10) return fail("msg notification");
+
+	/* Across the wrap, fresh up to the max age */
+	for (d = 0; d <= 300 * DTWMS; d += DTWMS)
+	{
+		dtwset = t0 + d;
+		stale_sweep();
+		if (MailboxTask_age(pmbx) != d) return fail("age %u at %u (wrap at %u)", MailboxTask_age(pmbx), d, -t0);
+		if (MailboxTask_fresh(pmbx) != 1) return fail("not fresh at %u ms", d / DTWMS);
+		if ((d <= 250 * DTWMS) && (MailboxTask_fresh(pmbx2) != 1)) return fail("no msg: not fresh at %u ms", d / DTWMS);
+		if ((d > 250 * DTWMS) && (MailboxTask_fresh(pmbx2) != 0)) return fail("no msg: fresh at %u ms", d / DTWMS);
+		if (pmbx->stale != 0) return fail("stale at %u ms", d / DTWMS);
+		v = notesgot(); // The one without msgs, once, at the first sweep past 250 ms
+		if (v != ((d == 251 * DTWMS) ? 0x200 : 0)) return fail("notified %X at %u ms", v, d / DTWMS);
+	}
+	if (pmbx2->stale == 0) return fail("no msg: not marked stale");
+
+	/* Past the max age: 'fresh' says so before the sweep; the sweep marks and notifies */
+	dtwset = t0 + 300 * DTWMS + 1;
+	if (MailboxTask_fresh(pmbx) != 0) return fail("fresh past max age");
+	if (pmbx->stale != 0) return fail("marked before the sweep");
+	stale_sweep();
+	if (pmbx->stale == 0) return fail("sweep did not mark");
+	if (MailboxTask_age(pmbx) != MBXAGESTALE) return fail("age of a stale mailbox %u", MailboxTask_age(pmbx));
+	if (notesgot() != 0x100) return fail("stale notification");
+	stale_sweep();
+	if (notesgot() != 0) return fail("stale notified twice");
+
+	/* Next msg clears it */
+	msgat(pmbxnum, STALEID, dtwset);
+	if ((pmbx->stale != 0) || (MailboxTask_fresh(pmbx) != 1) || (MailboxTask_age(pmbx) != 0))
+		return fail("msg did not clear stale");
+	if (notesgot() != 0x10) return fail("msg notification after stale");
+
+	/* A time stamp a little ahead of DTWTIME (TTCM) */
+	msgat(pmbxnum, STALEID, dtwset + 500);
+	if ((MailboxTask_age(pmbx) != 0) || (MailboxTask_fresh(pmbx) != 1)) return fail("toa ahead: age %u", MailboxTask_age(pmbx));
+	stale_sweep();
+	if (pmbx->stale != 0) return fail("toa ahead: marked stale");
+	notesgot();
+
+	/* Ages from anywhere on the clock, up to 2^31 - 1 */
+	MailboxTask_set_age(pmbx, 0, 0, 0); // No staleness
+	for (i = 0; i < 100000; i++)
+	{
+		t0 = rnd();
+		d  = rnd() & 0x7FFFFFFF;
+		msgat(pmbxnum, STALEID, t0);
+		dtwset = t0 + d;
+		if (MailboxTask_age(pmbx) != d) return fail("age %u, want %u (toa %08X)", MailboxTask_age(pmbx), d, t0);
+		if (MailboxTask_fresh(pmbx) != 1) return fail("no max age, not fresh");
+	}
+
+	/* Longest max age, and one too long for the DTW wrap */
+	MailboxTask_set_age(pmbx, 1000, MBXMAXAGEMS, 0x100);
+	if (pmbx->maxage >= 0x80000000) return fail("max age %u over 2^31", pmbx->maxage);
+	ptrapjmp = &jb;
+	if (setjmp(jb) == 0)
+	{
+		MailboxTask_set_age(pmbx, 1000, MBXMAXAGEMS + 1, 0x100);
+		return fail("max age over %u ms accepted", MBXMAXAGEMS);
+	}
+	ptrapjmp = NULL;
+	if (traplast != 37) return fail("trap %u", traplast);
+	return 0;
+}
+
+/* ======= hist: history windows against brute force (user-036) =========================================== */
+struct BRUTE
+{
+	float v[64];
+	uint32_t dtw[64];
+	int n;   // Depth
+	int ct;  // Samples (newest at [0])
+};
+static void bruteadd(struct BRUTE* pb, uint32_t dtw, float v)
+{
+	int i;
+	for (i = pb->n - 1; i > 0; i--)
+	{
+		pb->v[i]   = pb->v[i - 1];
+		pb->dtw[i] = pb->dtw[i - 1];
+	}
+	pb->v[0] = v;
+	pb->dtw[0] = dtw;
+	if (pb->ct < pb->n) pb->ct += 1;
+	return;
+}
+static void bruteval(struct BRUTE* pb, double* pavg, float* pmin, float* pmax)
+{
+	double sum = 0;
+	int i;
+
+	*pmin = pb->v[0]; *pmax = pb->v[0];
+	for (i = 0; i < pb->ct; i++)
+	{
+		sum += pb->v[i];
+		if (pb->v[i] < *pmin) *pmin = pb->v[i];
+		if (pb->v[i] > *pmax) *pmax = pb->v[i];
+	}
+	*pavg = sum / pb->ct;
+	return;
+}
+static int t_hist(void)
+{
+	static const uint16_t depth[] = {2, 3, 5, 8, 17, 32, 64};
+	struct MAILBOXCANNUM* pmbxnum;
+	struct MAILBOXCAN* pmbx;
+	struct MBXHIST h;
+	struct MBXHISTVAL hv;
+	struct MBXHISTSAMP* ps;
+	struct BRUTE b;
+	double avg, bd, err, errmax = 0;
+	float mn, mx, d;
+	uint32_t dtw;
+	uint64_t t0;
+	uint8_t pay[8];
+	int di, i, k, r;
+
+	for (di = 0; di < (int)(sizeof(depth) / sizeof(depth[0])); di++)
+	{
+		if (mbxhist_init(&h, depth[di], 0) != 0) return fail("mbxhist_init %u", depth[di]);
+		memset(&b, 0, sizeof(b));
+		b.n = depth[di];
+		if (mbxhist_val(&h, &hv, 1, 168000000) != -1) return fail("val with no samples");
+		dtw = 0xFFFFFFFF - 5000 * 168000; // 5 s before the DTW wrap
+		for (i = 0; i < 20000; i++)
+		{
+			/* Values with ties, steps and ramps; now and then two at the same time */
+			float v = (float)((int)(rnd() % 41) - 20) * 0.25f;
+			if ((i & 0x400) != 0) v = (float)(i & 0xFF) * 3.5f;
+			if ((rnd() % 50) != 0) dtw += 168000 + (rnd() % 40000);
+			mbxhist_add(&h, dtw, v);
+			bruteadd(&b, dtw, v);
+
+			k = 1 + rnd() % (depth[di] - 1);
+			if (mbxhist_val(&h, &hv, k, 168000000) != 0) return fail("val");
+			bruteval(&b, &avg, &mn, &mx);
+			if (hv.ct != b.ct) return fail("n %u: ct %u, want %d", depth[di], hv.ct, b.ct);
+			if ((hv.last != b.v[0]) || (hv.dtw != b.dtw[0])) return fail("n %u: last", depth[di]);
+			if ((hv.min != mn) || (hv.max != mx))
+				return fail("n %u sample %d: min %g max %g, want %g %g", depth[di], i, hv.min, hv.max, mn, mx);
+			err = fabs(hv.avg - avg);
+			if (err > errmax) errmax = err;
+			if (err > 1E-3) return fail("n %u sample %d: avg %g, want %g", depth[di], i, hv.avg, avg);
+			for (r = 0; r < b.ct; r++)
+			{
+				ps = mbxhist_get(&h, r);
+				if ((ps == NULL) || (ps->v != b.v[r]) || (ps->dtw != b.dtw[r])) return fail("n %u: get %d", depth[di], r);
+			}
+			if (mbxhist_get(&h, b.ct) != NULL) return fail("n %u: get past ct", depth[di]);
+
+			/* Derivative: none until k back exists, or with no time between */
+			r = mbxhist_deriv(&h, k, 168000000, &d);
+			if ((k >= b.ct) || (b.dtw[0] == b.dtw[k]))
+			{
+				if ((r != -1) || (hv.deriv != 0)) return fail("n %u: deriv with k %d, ct %d", depth[di], k, b.ct);
+				continue;
+			}
+			bd = (b.v[0] - b.v[k]) * (168000000.0 / (uint32_t)(b.dtw[0] - b.dtw[k]));
+			if ((r != 0) || (fabs(d - bd) > 1E-4 * (1 + fabs(bd))) || (hv.deriv != d))
+				return fail("n %u sample %d: deriv %g, want %g", depth[di], i, d, bd);
+		}
+	}
+
+	/* Float round off does not build up: 2M samples around 1000 */
+	mbxhist_init(&h, 16, 0);
+	memset(&b, 0, sizeof(b));
+	b.n = 16;
+	for (i = 0; i < 2000000; i++)
+	{
+		float v = 1000.0f + (float)(rnd() % 1000) * 0.001f;
+		mbxhist_add(&h, i, v);
+		bruteadd(&b, i, v);
+	}
+	bruteval(&b, &avg, &mn, &mx);
+	if (fabs(mbxhist_avg(&h) - avg) > 1E-3) return fail("avg after 2M samples %f, want %f", mbxhist_avg(&h), avg);
+
+	/* Timing: add and read the window, against recomputing it */
+	printf("      hist: avg error max %.2g; ns add+read vs recompute:", errmax);
+	for (di = 0; di < (int)(sizeof(depth) / sizeof(depth[0])); di++)
+	{
+		if ((depth[di] != 8) && (depth[di] != 64)) continue;
+		mbxhist_init(&h, depth[di], 0);
+		memset(&b, 0, sizeof(b));
+		b.n = depth[di];
+		t0 = nsnow();
+		for (i = 0; i < 1000000; i++)
+		{
+			mbxhist_add(&h, i, (float)(rnd() & 0xFFF));
+			mbxhist_val(&h, &hv, 4, 168000000);
+		}
+		err = (double)(nsnow() - t0) / 1000000;
+		t0 = nsnow();
+		for (i = 0; i < 1000000; i++)
+		{
+			bruteadd(&b, i, (float)(rnd() & 0xFFF));
+			bruteval(&b, &avg, &mn, &mx);
+		}
+		bd = (double)(nsnow() - t0) / 1000000;
+		printf(" n %u %.1f %.1f;", depth[di], err, bd);
+	}
+	printf("\n");
+
+	/* Through MailboxTask: DMOC speed (I16_I16), field 1, 4 deep */
+	pmbxnum = mbxsetup(0, 8);
+	if (pmbxnum == NULL) return fail("MailboxTask_add_CANlist");
+	pmbx = MailboxTask_add(&ctl0, 0x47400000, NULL, 0, 0, 27);
+	if (pmbx == NULL) return fail("MailboxTask_add");
+	if (MailboxTask_hist_get(pmbx, &hv, 1) != -1) return fail("hist_get with no history");
+	MailboxTask_add_hist(pmbx, 4, 1);
+	if (MailboxTask_hist_get(pmbx, &hv, 1) != -1) return fail("hist_get with no samples");
+	memset(&b, 0, sizeof(b));
+	b.n = 4;
+	dtw = 0xFFFFFFFF - 3 * 168000 * 15; // Wraps in the 4th msg
+	for (i = 0; i < 12; i++)
+	{
+		struct CANRCVBUFN ncan;
+		int16_t sp = (int16_t)(i * i * 50 - 1000);
+		memset(&ncan, 0, sizeof(ncan));
+		for (k = 0; k < 8; k++) pay[k] = rnd();
+		pay[2] = (uint16_t)sp >> 8; pay[3] = sp & 0xFF;
+		ncan.can.id  = 0x47400000;
+		ncan.can.dlc = (i == 6) ? 3 : 8; // Short: no sample
+		memcpy(&ncan.can.cd.uc[0], pay, 8);
+		ncan.toa  = dtw;
+		ncan.pctl = &ctl0;
+		loadmbx(pmbxnum, &ncan);
+		if (i != 6) bruteadd(&b, dtw, (float)(uint16_t)sp);
+		dtw += 168000 * 15; // 15 ms
+		if (MailboxTask_hist_get(pmbx, &hv, 3) != 0) return fail("hist_get");
+		bruteval(&b, &avg, &mn, &mx);
+		if ((hv.ct != b.ct) || (hv.last != b.v[0]) || (hv.min != mn) || (hv.max != mx) || (fabs(hv.avg - avg) > 1E-6 * (1 + fabs(avg))))
+			return fail("msg %d: window %g %g %g %g, want %g %g %g %g", i, hv.last, hv.avg, hv.min, hv.max, b.v[0], avg, mn, mx);
+		if (b.ct > 3)
+		{
+			bd = (b.v[0] - b.v[3]) * (168000000.0 / (uint32_t)(b.dtw[0] - b.dtw[3]));
+			if (fabs(hv.deriv - bd) > 1E-4 * (1 + fabs(bd))) return fail("msg %d: deriv %g, want %g", i, hv.deriv, bd);
+		}
+	}
+	return 0;
+}
+
+/* ======= family: mask/match families against a reference (user-037) ==================================== */
+#define FAMSTD(x) ((uint32_t)(x) << 21)          // 11b id, our format
+#define FAMEXT(x) (((uint32_t)(x) << 3) | 0x4)   // 29b id, our format
+static void StartHolder(void const* argument)
+{ // Holds the registration mutex while 'famhold' is set
+	volatile int* phold = (volatile int*)argument;
+	xSemaphoreTake(mbxaddmutex, portMAX_DELAY);
+	*phold = 2;
+	while (*phold != 0) sched_yield();
+	xSemaphoreGive(mbxaddmutex);
+	for (;;) osDelay(1000);
+}
+static int t_family(void)
+{
+	struct MAILBOXCANNUM* pmbxnum = mbxsetup(0, 40);
+	struct MBXFAMILY* pf[3];
+	struct MAILBOXCAN* pexact;
+	struct MAILBOXCAN* pmbx;
+	struct CANRCVBUFN ncan;
+	uint32_t id, v;
+	uint32_t pool[3] = {4, 8, 2};
+	uint32_t mbrs[3][16];
+	uint32_t nmbr[3] = {0, 0, 0};
+	uint32_t over[3] = {0, 0, 0};
+	volatile int famhold;
+	jmp_buf jb;
+	uint64_t t0;
+	double ns[2];
+	int exact;
+	int f, i;
+	int k = 0;
+
+	if (pmbxnum == NULL) return fail("MailboxTask_add_CANlist");
+
+	/* Before any family: ns per msg with no mailbox */
+	memset(&ncan, 0, sizeof(ncan));
+	ncan.pctl = &ctl0;
+	pexact = MailboxTask_add(&ctl0, FAMSTD(0x104), NULL, 0x1, 0, 23); // In family 0's range
+	t0 = nsnow();
+	for (i = 0; i < 1000000; i++)
+	{
+		ncan.can.id = FAMSTD(0x200 + (i & 0xFF));
+		loadmbx(pmbxnum, &ncan);
+	}
+	ns[0] = (double)(nsnow() - t0) / 1000000;
+
+	/* 11b ids 100-10F; 29b ids with the top 11 bits 3A0; 11b ids 7F0-7FF, odd only */
+	pf[0] = MailboxTask_add_family(&ctl0, FAMSTD(0x100), FAMSTD(0x7F0) | 0x4, pool[0], NULL, 0x10, 0, 23);
+	pf[1] = MailboxTask_add_family(&ctl0, FAMEXT(0x3A0 << 18), 0xFFE00004, pool[1], NULL, 0x20, 0, 4);
+	pf[2] = MailboxTask_add_family(&ctl0, FAMSTD(0x7F1), FAMSTD(0x7F1) | 0x4, pool[2], NULL, 0, 0, 23);
+	if ((pf[0] == NULL) || (pf[1] == NULL) || (pf[2] == NULL)) return fail("MailboxTask_add_family");
+	if (pmbxnum->reserved != 14) return fail("reserved %u", pmbxnum->reserved);
+	ptrapjmp = &jb;
+	if (setjmp(jb) == 0)
+	{
+		MailboxTask_add_family(&ctl0, FAMSTD(0x400), FAMSTD(0x7FF), 30, NULL, 0, 0, 23);
+		return fail("family past the sorted table accepted");
+	}
+	ptrapjmp = NULL;
+	if (traplast != 43) return fail("trap %u", traplast);
+
+	/* Same ids, no member yet: ns per msg with families */
+	t0 = nsnow();
+	for (i = 0; i < 1000000; i++)
+	{
+		ncan.can.id = FAMSTD(0x200 + (i & 0xFF));
+		loadmbx(pmbxnum, &ncan);
+	}
+	ns[1] = (double)(nsnow() - t0) / 1000000;
+	if (notesgot() != 0) return fail("notified for ids not in a mailbox");
+
+	/* A registration in progress: the member is made with a later msg */
+	{
+		static const uint32_t ext = FAMEXT((0x3A0 << 18) | 0x12345);
+		osThreadDef(Holder, StartHolder, osPriorityNormal, 0, 128);
+
+		famhold = 1;
+		osThreadCreate(osThread(Holder), (void*)&famhold);
+		while (famhold != 2) sched_yield();
+		k = pf[1]->overct;
+		ncan.can.id = ext;
+		if (loadmbx(pmbxnum, &ncan) != NULL) return fail("member made during a registration");
+		if (pf[1]->overct != (uint32_t)k + 1) return fail("not counted");
+		famhold = 0;
+		osDelay(5);
+		if ((pmbx = loadmbx(pmbxnum, &ncan)) == NULL) return fail("member not made after the registration");
+		if (lookup(pmbxnum, ext) != pmbx) return fail("member not in the table");
+		notesgot();
+		mbrs[1][nmbr[1]++] = ext;
+		over[1] += 1;
+	}
+	/* Random msgs: std and ext ids near and in the families */
+	for (i = 0; i < 200000; i++)
+	{
+		switch (rnd() % 4)
+		{
+		case 0:  id = FAMSTD(0x0F8 + (rnd() % 0x20)) | ((rnd() & 7) == 0 ? 0x2 : 0); break; // (RTR too)
+		case 1:  id = FAMEXT((0x39F << 18) + (rnd() % (3 << 18))); break;
+		case 2:  id = FAMSTD(0x7E8 + (rnd() % 0x18)); break;
+		default: id = rnd() & ~0x1u; break;
+		}
+		if (id == 0) continue;
+
+		/* Reference: exact mailbox, else the first family that matches */
+		exact = (id == FAMSTD(0x104));
+		for (f = 0; f < 3; f++)
+			if ((id & pf[f]->mask) == pf[f]->match) break;
+		if ((exact == 0) && (f < 3))
+		{
+			for (k = 0; k < (int)nmbr[f]; k++)
+				if (mbrs[f][k] == id) break;
+			if (k == (int)nmbr[f])
+			{
+				if (nmbr[f] < pool[f]) mbrs[f][nmbr[f]++] = id;
+				else over[f] += 1;
+			}
+		}
+
+		ncan.can.id  = id;
+		ncan.can.dlc = 8;
+		ncan.can.cd.ui[0] = i;
+		ncan.can.cd.ui[1] = ~i;
+		pmbx = loadmbx(pmbxnum, &ncan);
+		v = notesgot();
+		if (exact != 0)
+		{
+			if ((pmbx != pexact) || (v != 0x1)) return fail("%08X: exact mailbox not used", id);
+			continue;
+		}
+		if (f == 3)
+		{
+			if ((pmbx != NULL) || (v != 0)) return fail("%08X: not in a family, got a mailbox", id);
+			continue;
+		}
+		if (k >= (int)pool[f])
+		{
+			if ((pmbx != NULL) || (v != 0)) return fail("%08X: mailbox past the pool", id);
+			continue;
+		}
+		if ((pmbx == NULL) || (pmbx->ncan.can.id != id) || (pmbx->paytype != pf[f]->paytype))
+			return fail("%08X: family %d member", id, f);
+		if ((pmbx < pf[f]->ppool) || (pmbx >= (pf[f]->ppool + pf[f]->poolsize)))
+			return fail("%08X: member not from family %d pool", id, f);
+		if (lookup(pmbxnum, id) != pmbx) return fail("%08X: member not in the table", id);
+		if (v != pf[f]->note.notebit) return fail("%08X: notified %X", id, v);
+		if ((pf[f]->paytype == 4) && ((pmbx->mbx.u.i32[0] != (uint32_t)i) || (pmbx->mbx.u.i32[1] != ~(uint32_t)i)))
+			return fail("%08X: readings", id);
+	}
+	for (f = 0; f < 3; f++)
+	{
+		if ((pf[f]->ct != nmbr[f]) || (pf[f]->overct != over[f]))
+			return fail("family %d: %u members %u over, want %u %u", f, pf[f]->ct, pf[f]->overct, nmbr[f], over[f]);
+	}
+	if (pmbxnum->reserved != (14 - nmbr[0] - nmbr[1] - nmbr[2])) return fail("reserved %u at the end", pmbxnum->reserved);
+
+	printf("    family: %u %u %u members, %u %u %u over; ns/msg with no mailbox: %.1f, with 3 families %.1f\n",
+		pf[0]->ct, pf[1]->ct, pf[2]->ct, pf[0]->overct, pf[1]->overct, pf[2]->overct, ns[0], ns[1]);
+	return 0;
+}
+
+/* ======= rcu: registrations while MailboxTask looks up (user-038) ======================================= */
+#define RCUNID   40       // Ids registered
+#define RCULOG   (1 << 22) // Msgs logged
+struct RCUREG
+{
+	const uint32_t* pid; // Ids to register, every other one
+	int n;
+	uint32_t regpos[RCUNID]; // 'ringadd' when MailboxTask_add returned
+	struct MAILBOXCAN* pmbx[RCUNID];
+	uint64_t ns;         // Time in MailboxTask_add
+	volatile int done;
+};
+static volatile uint32_t rcutblbad;
+static void StartRcuReg(void const* argument)
+{
+	struct RCUREG* pr = (struct RCUREG*)argument;
+	uint64_t t0;
+	int i;
+
+	for (i = 0; i < pr->n; i++)
+	{
+		osDelay(2);
+		t0 = nsnow();
+		pr->pmbx[i]   = MailboxTask_add(&ctl0, pr->pid[i], NULL, 0, 0, 4); // U32_U32
+		pr->regpos[i] = ringadd;
+		pr->ns += nsnow() - t0;
+	}
+	pr->done = 1;
+	for (;;) osDelay(1000);
+}
+static void StartRcuCheck(void const* argument)
+{ // Published tables are whole: sorted, ids in step, never shrink
+	struct MBXTABLE* ptbl;
+	uint16_t nlast = 0;
+	int i;
+
+	for (;;)
+	{
+		ptbl = mbxcannum[0].ptbl;
+		if (ptbl->n < nlast) rcutblbad += 1;
+		nlast = ptbl->n;
+		for (i = 0; i < ptbl->n; i++)
+		{
+			if ((i > 0) && (ptbl->pidarray[i - 1] >= ptbl->pidarray[i])) rcutblbad += 1;
+			if (ptbl->pmbxarray[i]->ncan.can.id != ptbl->pidarray[i]) rcutblbad += 1;
+		}
+		sched_yield();
+	}
+}
+static int t_rcu(void)
+{
+	static uint32_t id[RCUNID];
+	static uint8_t log[RCULOG]; // Id index of each msg; 0xFF = not a registered id
+	struct RCUREG reg[2];
+	struct MAILBOXCAN* pmbx;
+	uint32_t pay[2];
+	uint32_t pos, after, total, last;
+	uint32_t extra = 0;
+	jmp_buf jb;
+	int i, k, r;
+
+	if (mbxsetup(1, 48) == NULL) return fail("MailboxTask_add_CANlist");
+	for (i = 0; i < RCUNID; i++)
+	{
+		do
+		{
+			id[i] = rnd() & ~0x7u;
+			for (k = 0; k < i; k++)
+				if (id[k] == id[i]) break;
+		} while ((id[i] == 0) || (k < i));
+	}
+
+	/* Two tasks register, interleaved; one checks the tables; msgs flow throughout */
+	memset(reg, 0, sizeof(reg));
+	for (r = 0; r < 2; r++)
+	{
+		osThreadDef(RcuReg, StartRcuReg, osPriorityNormal, 0, 128);
+		reg[r].pid = &id[r * (RCUNID / 2)];
+		reg[r].n   = RCUNID / 2;
+		osThreadCreate(osThread(RcuReg), &reg[r]);
+	}
+	{
+		osThreadDef(RcuCheck, StartRcuCheck, osPriorityNormal, 0, 128);
+		osThreadCreate(osThread(RcuCheck), NULL);
+	}
+	for (pos = 0; pos < RCULOG; pos++)
+	{
+		if ((reg[0].done != 0) && (reg[1].done != 0) && (pos > (RCULOG / 2))) break;
+		k = rnd() % (RCUNID + 8);
+		pay[1] = pos;
+		if (k < RCUNID)
+		{
+			pay[0] = id[k];
+			log[pos] = k;
+		}
+		else
+		{
+			pay[0] = rnd() | 1; // Never registered
+			log[pos] = 0xFF;
+		}
+		put(pay[0], 8, (uint8_t*)pay);
+	}
+	if ((reg[0].done == 0) || (reg[1].done == 0)) return fail("registrations not done after %u msgs", pos);
+	while (ringtake != ringadd) sched_yield();
+	osDelay(5);
+
+	if (rcutblbad != 0) return fail("%u bad published tables", rcutblbad);
+	if (mbxcannum[0].ptbl->n != RCUNID) return fail("table n %u", mbxcannum[0].ptbl->n);
+	for (i = 0; i < RCUNID; i++)
+	{
+		r = i / (RCUNID / 2);
+		k = i % (RCUNID / 2);
+		pmbx = reg[r].pmbx[k];
+		if (lookup(&mbxcannum[0], id[i]) != pmbx) return fail("id %08X not found", id[i]);
+
+		/* Every msg after the registration reached the mailbox; none of another id did */
+		after = 0; total = 0; last = 0;
+		for (pos = 0; pos < ringadd; pos++)
+		{
+			if (log[pos] != i) continue;
+			total += 1;
+			last = pos;
+			if (pos >= reg[r].regpos[k]) after += 1;
+		}
+		if ((pmbx->ctr < after) || (pmbx->ctr > total))
+			return fail("id %08X: %u msgs loaded, %u after registration, %u in all", id[i], pmbx->ctr, after, total);
+		if ((pmbx->ncan.can.id != id[i]) || (pmbx->mbx.u.i32[0] != id[i]) || (pmbx->mbx.u.i32[1] != last))
+			return fail("id %08X: mailbox holds %08X pos %u, last %u", id[i], pmbx->mbx.u.i32[0], pmbx->mbx.u.i32[1], last);
+		extra += pmbx->ctr - after;
+	}
+	printf("       rcu: %u msgs, %u loaded before MailboxTask_add returned; %.1f us per registration\n",
+		ringadd, extra, (reg[0].ns + reg[1].ns) / 1000.0 / RCUNID);
+
+	/* Grace period: with MailboxTask held in a batch, the first add publishes
+	   and a second (which needs the table just replaced) waits for its release */
+	ringstall = 1;
+	put(0x0FFFFFF0, 8, (uint8_t*)pay);
+	while (ringstall != 2) sched_yield();
+	pmbx = MailboxTask_add(&ctl0, 0x0FFFFFE0, NULL, 0, 0, 4);
+	memset(&reg[0], 0, sizeof(reg[0]));
+	extra = 0x0FFFFFD0;
+	reg[0].pid = &extra;
+	reg[0].n   = 1;
+	{
+		osThreadDef(RcuReg, StartRcuReg, osPriorityNormal, 0, 128);
+		osThreadCreate(osThread(RcuReg), &reg[0]);
+	}
+	osDelay(20);
+	k = reg[0].done;
+	ringstall = 0;
+	if (k != 0) return fail("table reused while MailboxTask was in a batch");
+	for (i = 0; (i < 100) && (reg[0].done == 0); i++) osDelay(1);
+	if (reg[0].done == 0) return fail("registration still waiting after release");
+	if ((lookup(&mbxcannum[0], 0x0FFFFFE0) != pmbx) || (lookup(&mbxcannum[0], 0x0FFFFFD0) != reg[0].pmbx[0]))
+		return fail("grace period registrations not found");
+
+	/* Pool used up: trap, not NULL */
+	ptrapjmp = &jb;
+	if (setjmp(jb) == 0)
+	{
+		for (i = 0; i < MBXPOOLSIZE; i++)
+			MailboxTask_add(&ctl0, 0x10000000 + (i << 3), NULL, 0, 0, 4);
+		return fail("no trap past %u mailboxes", MBXPOOLSIZE);
+	}
+	ptrapjmp = NULL;
+	if ((traplast != 33) || (mbxpoolct != MBXPOOLSIZE)) return fail("trap %u at %u mailboxes", traplast, mbxpoolct);
+	return 0;
+}
+
+/* ======= gate: handoff ring policies and loss counts (user-039) ======================================== */
+#define GATESIZE 8
+#define GATEN    (1 << 21) // Msgs per concurrent run
+static const char* gatepolname[3] = {"dropnewest", "dropoldest", "coalesce"};
+static uint32_t gateid(uint32_t seq)
+{
+	return ((seq * 2654435761u) % 5) << 21; // Five 11b ids
+}
+static void gatemsg(struct CANRCVBUFN* pncan, uint32_t seq)
+{
+	memset(pncan, 0, sizeof(*pncan));
+	pncan->can.id  = gateid(seq);
+	pncan->can.dlc = 8;
+	pncan->can.cd.ui[0] = seq;
+	pncan->can.cd.ui[1] = seq ^ pncan->can.id;
+	return;
+}
+/* Reference: the msgs pending, oldest first; counts as mbxgate keeps them */
+static int gateref(int policy)
+{
+	struct MBXGATE g;
+	struct CANRCVBUFN ncan;
+	uint32_t q[GATESIZE + 1];
+	struct MBXGATESTATS st;
+	uint32_t seq = 0;
+	int n = 0;
+	int i, k, step;
+
+	if (mbxgate_init(&g, GATESIZE, policy) != 0) return fail("mbxgate_init");
+	memset(&st, 0, sizeof(st));
+	for (step = 0; step < 200000; step++)
+	{
+		k = rnd() % 3; // Bursts of puts outrun the gets
+		for (i = rnd() % ((k == 0) ? 24 : 4); i > 0; i--, seq++)
+		{
+			gatemsg(&ncan, seq);
+			mbxgate_put(&g, &ncan);
+			if (n < GATESIZE)
+			{
+				q[n++] = seq;
+				st.added += 1;
+				if (n > st.hwm) st.hwm = n;
+				continue;
+			}
+			if (policy == MBXGATE_DROPOLDEST)
+			{
+				memmove(&q[0], &q[1], (GATESIZE - 1) * sizeof(q[0]));
+				q[GATESIZE - 1] = seq;
+				st.added += 1;
+				st.lost  += 1; // Counted by the consumer, when it gets there
+				continue;
+			}
+			if (policy == MBXGATE_COALESCE)
+			{
+				for (k = n - 1; k >= 0; k--)
+					if (gateid(q[k]) == ncan.can.id) break;
+				if (k >= 0)
+				{
+					q[k] = seq;
+					st.coalesced += 1;
+					continue;
+				}
+			}
+			st.dropped += 1;
+		}
+		for (i = rnd() % 6; i > 0; i--)
+		{
+			k = mbxgate_get(&g, &ncan);
+			if (k != (n != 0)) return fail("%s: get %d with %d pending", gatepolname[policy], k, n);
+			if (k == 0) break;
+			if (ncan.can.cd.ui[0] != q[0])
+				return fail("%s: got %u, expected %u", gatepolname[policy], ncan.can.cd.ui[0], q[0]);
+			if ((ncan.can.id != gateid(q[0])) || (ncan.can.cd.ui[1] != (q[0] ^ ncan.can.id)))
+				return fail("%s: msg %u garbled", gatepolname[policy], q[0]);
+			memmove(&q[0], &q[1], (n - 1) * sizeof(q[0]));
+			n -= 1;
+		}
+	}
+	while (mbxgate_get(&g, &ncan) != 0) n -= 1;
+	if (n != 0) return fail("%s: %d msgs not got", gatepolname[policy], n);
+	if ((g.stats.added != st.added) || (g.stats.dropped != st.dropped) ||
+		 (g.stats.coalesced != st.coalesced) || (g.stats.lost != st.lost) || (g.stats.hwm != st.hwm))
+		return fail("%s: added %u %u dropped %u %u coalesced %u %u lost %u %u hwm %u %u", gatepolname[policy],
+			g.stats.added, st.added, g.stats.dropped, st.dropped, g.stats.coalesced, st.coalesced,
+			g.stats.lost, st.lost, g.stats.hwm, st.hwm);
+	if (mbxgate_losses(&g) != (st.dropped + st.lost)) return fail("%s: mbxgate_losses", gatepolname[policy]);
+	return 0;
+}
+struct GATEPROD
+{
+	struct MBXGATE* pg;
+	uint8_t* pdrop;  // [GATEN] 1 = put dropped it
+	volatile int done;
+};
+static void StartGateProd(void const* argument)
+{ // MailboxTask side
+	struct GATEPROD* pp = (struct GATEPROD*)argument;
+	struct CANRCVBUFN ncan;
+	uint32_t x = 0x9E3779B9;
+	uint32_t seq;
+	uint32_t d;
+
+	for (seq = 0; seq < GATEN; seq++)
+	{
+		gatemsg(&ncan, seq);
+		d = pp->pg->stats.dropped;
+		mbxgate_put(pp->pg, &ncan);
+		pp->pdrop[seq] = (pp->pg->stats.dropped != d);
+		x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+		if ((x & 15) == 0) sched_yield(); // Let the consumer fall behind, and catch up
+	}
+	pp->done = 1;
+	for (;;) osDelay(1000);
+}
+static int gateconc(int policy)
+{ // GatewayTask side: order, integrity, every msg accounted for
+	static uint8_t seen[GATEN];
+	static uint8_t drop[GATEN];
+	struct MBXGATE g;
+	struct GATEPROD prod;
+	struct CANRCVBUFN ncan;
+	uint32_t got = 0;
+	uint32_t last = 0;
+	uint32_t seq;
+	uint32_t idlast = 0;
+	int done;
+
+	if (mbxgate_init(&g, GATESIZE, policy) != 0) return fail("mbxgate_init");
+	memset(seen, 0, sizeof(seen));
+	prod.pg    = &g;
+	prod.pdrop = drop;
+	prod.done  = 0;
+	{
+		osThreadDef(GateProd, StartGateProd, osPriorityNormal, 0, 128);
+		osThreadCreate(osThread(GateProd), &prod);
+	}
+	do
+	{
+		done = prod.done;
+		while (mbxgate_get(&g, &ncan) != 0)
+		{
+			seq = ncan.can.cd.ui[0];
+			if ((seq >= GATEN) || (ncan.can.id != gateid(seq)) || (ncan.can.cd.ui[1] != (seq ^ ncan.can.id)))
+				return fail("%s: torn msg %08X %08X %08X", gatepolname[policy], ncan.can.id, ncan.can.cd.ui[0], ncan.can.cd.ui[1]);
+			if (seen[seq] != 0) return fail("%s: msg %u got twice", gatepolname[policy], seq);
+			seen[seq] = 1;
+			if ((policy != MBXGATE_COALESCE) && (got != 0) && (seq <= last))
+				return fail("%s: msg %u after %u", gatepolname[policy], seq, last);
+			last = seq;
+			got += 1;
+		}
+		sched_yield();
+	} while (done == 0);
+
+	if ((g.stats.added + g.stats.dropped + g.stats.coalesced) != GATEN)
+		return fail("%s: added %u dropped %u coalesced %u of %u", gatepolname[policy],
+			g.stats.added, g.stats.dropped, g.stats.coalesced, GATEN);
+	if ((got + g.stats.lost) != g.stats.added)
+		return fail("%s: got %u lost %u of %u added", gatepolname[policy], got, g.stats.lost, g.stats.added);
+	if ((policy != MBXGATE_DROPOLDEST) && (g.stats.lost != 0))
+		return fail("%s: %u lost", gatepolname[policy], g.stats.lost);
+	if (policy == MBXGATE_COALESCE)
+	{ // The newest msg of each id that was not dropped is never replaced away
+		for (seq = GATEN; (seq > 0) && (idlast != 0x1F); seq--)
+		{
+			if ((idlast & (1 << (gateid(seq - 1) >> 21))) != 0) continue;
+			if (drop[seq - 1] != 0) continue;
+			idlast |= (1 << (gateid(seq - 1) >> 21));
+			if (seen[seq - 1] == 0) return fail("%s: last msg of id %08X (%u) lost", gatepolname[policy], gateid(seq - 1), seq - 1);
+		}
+	}
+	printf("%10s: got %7u, dropped %7u, coalesced %7u, lost %7u, hwm %u\n", gatepolname[policy],
+		got, g.stats.dropped, g.stats.coalesced, g.stats.lost, g.stats.hwm);
+	return 0;
+}
+static int t_gate(void)
+{
+	struct MBXGATE g;
+	int policy;
+
+	if (mbxgate_init(&g, 6, MBXGATE_DROPNEWEST) != -1) return fail("size 6 accepted");
+	if (mbxgate_init(&g, 8, 3) != -3) return fail("policy 3 accepted");
+	for (policy = MBXGATE_DROPNEWEST; policy <= MBXGATE_COALESCE; policy++)
+	{
+		if (gateref(policy) != 0) return 1;
+		if (gateconc(policy) != 0) return 1;
+	}
+	return 0;
+}
+
+/* ======= snap: a set of mailboxes copied as of one batch (user-040) ==================================== */
+#define SNAPN  5
+#define SNAPID(j) (0x20000000u + ((uint32_t)(j) << 3))
+static volatile int snapstop;
+static void StartSnapProd(void const* argument)
+{ // Each round loads the set in order; DTW counts msgs so each toa is unique
+	uint32_t pay[2];
+	uint32_t k;
+	int j;
+
+	for (k = 1; snapstop == 0; k++)
+	{
+		for (j = 0; j < SNAPN; j++)
+		{
+			pay[0] = k; pay[1] = ~k;
+			dtwset += 1;
+			put(SNAPID(j), 8, (uint8_t*)pay);
+		}
+	}
+	for (;;) osDelay(1000);
+}
+static int t_snap(void)
+{
+	struct MAILBOXCAN* pmbx[SNAPN];
+	struct MBXSNAP snap;
+	struct MBXHISTVAL hv;
+	struct MAILBOXCAN* pc;
+	uint32_t pay[2] = {0, ~0u};
+	uint32_t ok = 0, gaveup = 0, histsame = 0, histnewer = 0;
+	uint64_t tend;
+	int j;
+
+	if (mbxsetup(1, 16) == NULL) return fail("MailboxTask_add_CANlist");
+	dtwman = 1;
+	dtwset = 1;
+	for (j = 0; j < SNAPN; j++)
+		pmbx[j] = MailboxTask_add(&ctl0, SNAPID(j), NULL, 0, 0, 4); // U32_U32
+	if (MailboxTask_add_hist(pmbx[0], 8, 0) == NULL) return fail("MailboxTask_add_hist");
+	if (MailboxTask_snap_init(&snap, pmbx, SNAPN) != 0) return fail("MailboxTask_snap_init");
+	for (j = 0; j < SNAPN; j++)
+		put(SNAPID(j), 8, (uint8_t*)pay);
+	while (pmbx[SNAPN - 1]->ctr == 0) sched_yield();
+
+	{
+		osThreadDef(SnapProd, StartSnapProd, osPriorityNormal, 0, 128);
+		osThreadCreate(osThread(SnapProd), NULL);
+	}
+	tend = nsnow() + 2000000000ull;
+	while (nsnow() < tend)
+	{
+		if (MailboxTask_snap(&snap) != 0)
+		{
+			gaveup += 1;
+			continue;
+		}
+		ok += 1;
+		if ((snap.epoch & 1) != 0) return fail("epoch %u odd", snap.epoch);
+		for (j = 0; j < SNAPN; j++)
+		{
+			pc = &snap.pcopy[j];
+			if ((pc->ncan.can.cd.ui[1] != ~pc->ncan.can.cd.ui[0]) ||
+				 (pc->mbx.u.i32[0] != pc->ncan.can.cd.ui[0]) || (pc->seq & 1) != 0)
+				return fail("copy %d torn: %u %08X readings %u", j, pc->ncan.can.cd.ui[0], pc->ncan.can.cd.ui[1], pc->mbx.u.i32[0]);
+			/* Loaded in order, so between batches: k0 >= k1 >= ... >= k4 >= k0 - 1 */
+			if ((j > 0) && (pc->ncan.can.cd.ui[0] > snap.pcopy[j - 1].ncan.can.cd.ui[0]))
+				return fail("copies mixed: mailbox %d at %u, %d at %u", j - 1, snap.pcopy[j - 1].ncan.can.cd.ui[0], j, pc->ncan.can.cd.ui[0]);
+		}
+		if ((snap.pcopy[SNAPN - 1].ncan.can.cd.ui[0] + 1) < snap.pcopy[0].ncan.can.cd.ui[0])
+			return fail("copies mixed: mailbox 0 at %u, %d at %u", snap.pcopy[0].ncan.can.cd.ui[0], SNAPN - 1, snap.pcopy[SNAPN - 1].ncan.can.cd.ui[0]);
+
+		/* History read live, used only when its newest sample is the copy's (GevcuEvents_09) */
+		if (MailboxTask_hist_get(pmbx[0], &hv, 1) != 0) return fail("MailboxTask_hist_get");
+		if (hv.dtw == snap.pcopy[0].ncan.toa)
+		{
+			if (hv.last != (float)snap.pcopy[0].ncan.can.cd.ui[0])
+				return fail("history at the copy's toa has %.0f, copy %u", hv.last, snap.pcopy[0].ncan.can.cd.ui[0]);
+			histsame += 1;
+		}
+		else if ((int32_t)(hv.dtw - snap.pcopy[0].ncan.toa) < 0)
+			return fail("history older than the copy");
+		else
+			histnewer += 1;
+	}
+	snapstop = 1;
+	if (ok == 0) return fail("no snapshot in 2 s");
+	printf("      snap: %u sets (%u copied again), %u gave up; history as of the copy %u, newer %u\n",
+		ok, snap.redo, gaveup, histsame, histnewer);
+	return 0;
+}
+
+struct TEST
+{
+	const char* name;
+	int (*fn)(void);
+};
+static const struct TEST test[] =
+{
+	{"lookup",    t_lookup},
+	{"seqlock",   t_seqlock},
+	{"paydecode", t_paydecode},
+	{"notify",    t_notify},
+	{"stale",     t_stale},
+	{"hist",      t_hist},
+	{"family",    t_family},
+	{"rcu",       t_rcu},
+	{"gate",      t_gate},
+	{"snap",      t_snap},
+};
+#define NTEST (int)(sizeof(test) / sizeof(test[0]))
+
+/* ************************************************************************************************************ */
+/*  Yes, this is where it starts.                                                                               */
+/* ************************************************************************************************************ */
+int main(int argc, char **argv)
+{
+	int nfail = 0;
+	int st;
+	int i, j;
+	int fd[2];
+	pid_t pid;
+	ssize_t n;
+
+	for (i = 0; i < NTEST; i++)
+	{
+		if (argc > 1)
+		{
+			for (j = 1; j < argc; j++)
+				if (strcmp(argv[j], test[i].name) == 0) break;
+			if (j == argc) continue;
+		}
+		if (pipe(fd) != 0) return 1;
+		fflush(stdout);
+		pid = fork();
+		if (pid == 0)
+		{
+			close(fd[0]);
+			why[0] = 0;
+			st = test[i].fn();
+			fflush(stdout);
+			if (write(fd[1], why, strlen(why)) < 0) _exit(1);
+			_exit(st);
+		}
+		close(fd[1]);
+		memset(why, 0, sizeof(why));
+		n = read(fd[0], why, sizeof(why) - 1);
+		close(fd[0]);
+		waitpid(pid, &st, 0);
+		if ((n >= 0) && WIFEXITED(st) && (WEXITSTATUS(st) == 0))
+			printf("PASS %s\n", test[i].name);
+		else
+		{
+			nfail += 1;
+			printf("FAIL %s: %s\n", test[i].name, (why[0] != 0) ? why : "crashed");
+		}
+	}
+	return nfail;
+}
@@ -0,0 +1,253 @@
+/* *****************************************************************************
+* File Name          : pthrtos.c
+* Date First Issued  : 10/19/2026
+* Board              : Linux PC
+* Description        : mbxtest: FreeRTOS tasks, notifications, mutexes on threads
+****************************************************************************** */
+/*
+Each task is a thread, so tasks really do run at the same time (more so
+than on the board, where they only interleave).  The FreeRTOS tick is
+512 Hz of the monotonic clock.  Priorities are ignored.  The thread that
+calls these without being made by 'osThreadCreate' (main) is a task too.
+
+Declarations are the ones PC/cansim/stub has for simrtos.c.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include "cmsis_os.h"
+#include "semphr.h"
+
+struct SIMTASK
+{
+	pthread_t th;
+	pthread_mutex_t m;
+	pthread_cond_t  c;
+	os_pthread fn;
+	void* arg;
+	uint32_t nval;  // Notification value
+	int npend;      // Notification pending
+	uint32_t ncall; // xTaskNotify calls made to this task (see 'pthrtos_notes')
+};
+
+static __thread struct SIMTASK* pself;
+static struct SIMTASK tmain;
+static pthread_once_t tmainonce = PTHREAD_ONCE_INIT;
+static volatile int running; // 1 = a task was created ("scheduler running")
+
+static void taskinit(struct SIMTASK* pt)
+{ // Timed waits are on the monotonic clock
+	pthread_condattr_t ca;
+
+	pthread_mutex_init(&pt->m, NULL);
+	pthread_condattr_init(&ca);
+	pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+	pthread_cond_init(&pt->c, &ca);
+	return;
+}
+static void tmaininit(void)
+{
+	taskinit(&tmain);
+	return;
+}
+
+static uint64_t nsnow(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+static struct SIMTASK* self(void)
+{
+	if (pself != NULL) return pself;
+	pthread_once(&tmainonce, tmaininit);
+	return &tmain;
+}
+static void deadline(struct timespec* pts, TickType_t ticks)
+{
+	uint64_t ns;
+
+	clock_gettime(CLOCK_MONOTONIC, pts);
+	ns = (uint64_t)pts->tv_nsec + (uint64_t)ticks * (1000000000ull / configTICK_RATE_HZ);
+	pts->tv_sec  += ns / 1000000000ull;
+	pts->tv_nsec  = ns % 1000000000ull;
+	return;
+}
+static void* entry(void* parg)
+{
+	pself = (struct SIMTASK*)parg;
+	pself->fn(pself->arg);
+	return NULL;
+}
+
+/* ======= cmsis_os ====================================================================================== */
+osThreadId osThreadCreate(const osThreadDef_t* pdef, void* argument)
+{
+	struct SIMTASK* pt = (struct SIMTASK*)calloc(1, sizeof(struct SIMTASK));
+
+	if (pt == NULL) return NULL;
+	taskinit(pt);
+	pt->fn  = pdef->pthread;
+	pt->arg = argument;
+	running = 1;
+	if (pthread_create(&pt->th, NULL, entry, pt) != 0) return NULL;
+	pthread_detach(pt->th);
+	return pt;
+}
+int osDelay(uint32_t millisec)
+{
+	TickType_t ticks = millisec / portTICK_PERIOD_MS;
+
+	vTaskDelay((ticks == 0) ? 1 : ticks);
+	return 0;
+}
+
+/* ======= Tasks ========================================================================================= */
+TickType_t xTaskGetTickCount(void)
+{
+	return (TickType_t)(nsnow() / (1000000000ull / configTICK_RATE_HZ));
+}
+TickType_t xTaskGetTickCountFromISR(void)
+{
+	return xTaskGetTickCount();
+}
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+	return self();
+}
+BaseType_t xTaskGetSchedulerState(void)
+{
+	return (running != 0) ? taskSCHEDULER_RUNNING : taskSCHEDULER_NOT_STARTED;
+}
+void vTaskPrioritySet(TaskHandle_t h, UBaseType_t prio)
+{
+	return;
+}
+void vTaskSuspend(TaskHandle_t h)
+{
+	for (;;) pause();
+}
+void vTaskDelay(TickType_t ticks)
+{
+	struct timespec ts;
+
+	deadline(&ts, ticks);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+	return;
+}
+void taskYIELD(void)
+{
+	sched_yield();
+	return;
+}
+BaseType_t xTaskNotify(TaskHandle_t h, uint32_t v, eNotifyAction a)
+{
+	if (h == NULL) return pdFAIL;
+	pthread_mutex_lock(&h->m);
+	switch (a)
+	{
+	case eSetBits:               h->nval |= v; break;
+	case eIncrement:             h->nval += 1; break;
+	case eSetValueWithOverwrite: h->nval  = v; break;
+	case eSetValueWithoutOverwrite:
+		if (h->npend != 0)
+		{
+			pthread_mutex_unlock(&h->m);
+			return pdFAIL;
+		}
+		h->nval = v;
+		break;
+	default: break;
+	}
+	h->npend  = 1;
+	h->ncall += 1;
+	pthread_cond_signal(&h->c);
+	pthread_mutex_unlock(&h->m);
+	return pdPASS;
+}
+BaseType_t xTaskNotifyFromISR(TaskHandle_t h, uint32_t v, eNotifyAction a, BaseType_t* pw)
+{
+	if (pw != NULL) *pw = pdTRUE;
+	return xTaskNotify(h, v, a);
+}
+BaseType_t xTaskNotifyWait(uint32_t clrentry, uint32_t clrexit, uint32_t* pval, TickType_t ticks)
+{
+	struct SIMTASK* pt = self();
+	struct timespec ts;
+	BaseType_t ret = pdFALSE;
+
+	pthread_mutex_lock(&pt->m);
+	if (pt->npend == 0)
+	{
+		pt->nval &= ~clrentry;
+		if (ticks == portMAX_DELAY)
+		{
+			while (pt->npend == 0)
+				pthread_cond_wait(&pt->c, &pt->m);
+		}
+		else if (ticks != 0)
+		{
+			deadline(&ts, ticks);
+			while ((pt->npend == 0) && (pthread_cond_timedwait(&pt->c, &pt->m, &ts) != ETIMEDOUT));
+		}
+	}
+	if (pval != NULL) *pval = pt->nval;
+	if (pt->npend != 0)
+	{
+		pt->npend = 0;
+		pt->nval &= ~clrexit;
+		ret = pdTRUE;
+	}
+	pthread_mutex_unlock(&pt->m);
+	return ret;
+}
+
+/* ======= Mutexes ======================================================================================= */
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+	pthread_mutex_t* pm = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
+
+	if (pm != NULL) pthread_mutex_init(pm, NULL);
+	return pm;
+}
+BaseType_t xSemaphoreTake(SemaphoreHandle_t h, TickType_t ticks)
+{
+	struct timespec ts;
+
+	if (ticks == 0)
+		return (pthread_mutex_trylock((pthread_mutex_t*)h) == 0) ? pdPASS : pdFAIL;
+	if (ticks == portMAX_DELAY)
+		return (pthread_mutex_lock((pthread_mutex_t*)h) == 0) ? pdPASS : pdFAIL;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec  += ticks / configTICK_RATE_HZ;
+	ts.tv_nsec += (ticks % configTICK_RATE_HZ) * (1000000000ull / configTICK_RATE_HZ);
+	if (ts.tv_nsec >= 1000000000) { ts.tv_sec += 1; ts.tv_nsec -= 1000000000; }
+	return (pthread_mutex_timedlock((pthread_mutex_t*)h, &ts) == 0) ? pdPASS : pdFAIL;
+}
+BaseType_t xSemaphoreGive(SemaphoreHandle_t h)
+{
+	return (pthread_mutex_unlock((pthread_mutex_t*)h) == 0) ? pdPASS : pdFAIL;
+}
+
+/* ======= For the tests ================================================================================= */
+/* xTaskNotify calls made to task 'h' and the bits set since the last look;
+   clears both, and the pending notification. */
+uint32_t pthrtos_notes(TaskHandle_t h, uint32_t* pval)
+{
+	uint32_t n;
+
+	pthread_mutex_lock(&h->m);
+	n = h->ncall;
+	if (pval != NULL) *pval = h->nval;
+	h->ncall = 0;
+	h->nval  = 0;
+	h->npend = 0;
+	pthread_mutex_unlock(&h->m);
+	return n;
+}
@@ -260,6 +260,12 @@ int main(void)
 	pctl0 = can_iface_init(&hcan1, 0, 32, 32);
 	if (pctl0 == NULL) morse_trap(7); // Panic LED flashing
 	if (pctl0->ret < 0) morse_trap(77);
+	/* Bus-off: drop buffered commands rather than send them stale after the restart */
+	can_iface_errstate_config(pctl0, CANPOOL_FLUSH, CANBACKOFFMIN, CANBACKOFFMAX);
+#ifdef CANRATELIMITINCLUDED
+	/* Flood guard for CAN1 TX, e.g. PC->CAN through GatewayTask (GatewayTask.h) */
+	if (can_iface_ratelimit_add(pctl0, 0, 0, GATECAN1RATE, GATECAN1BURST, CANRATE_DEFER) < 0) morse_trap(78);
+#endif
 
 	// CAN 2
 #ifdef CONFIGCAN2
@@ -347,16 +353,11 @@ DiscoveryF4 LEDs --
 	/* Setup semaphore for yprint and sprintf et al. */
 	yprintf_init();
 
-	/* USB-CDC buffering */
-	#define NUMCDCBUFF 4	// Number of CDC task local buffers
-	#define CDCBUFFSIZE 64*4	// Best buff size is multiples of usb packet size
-	struct CDCBUFFPTR* pret;
-	pret = cdc_txbuff_init(NUMCDCBUFF, CDCBUFFSIZE); // Setup local buffers
+	/* USB-CDC buffering (double buffer, swapped on USB TX complete) */
+	#define CDCBUFFSIZE 64*8	// Best buff size is multiples of usb packet size
+	struct CDCTXDBL* pret;
+	pret = cdc_txbuff_init(CDCBUFFSIZE); // Setup buffer pair
 	if (pret == NULL) morse_trap(223);
-	
-	/* USB-CDC queue and task creation */
-	Qidret = xCdcTxTaskSendCreate(3); // arg = Priority level
-	if (Qidret < 0) morse_trap(221); // Panic LED flashing
 
   /* definition and creation of CanTxTask - CAN driver TX interface. */
   Qidret = xCanTxTaskCreate(2, 64); // CanTask priority, Number of msgs in queue
@@ -408,14 +409,24 @@ DiscoveryF4 LEDs --
 	HAL_CAN_ActivateNotification(&hcan1, \
 		CAN_IT_TX_MAILBOX_EMPTY     |  \
 		CAN_IT_RX_FIFO0_MSG_PENDING |  \
-		CAN_IT_RX_FIFO1_MSG_PENDING    );
+		CAN_IT_RX_FIFO1_MSG_PENDING |  \
+		CAN_IT_ERROR_WARNING        |  \
+		CAN_IT_ERROR_PASSIVE        |  \
+		CAN_IT_BUSOFF               |  \
+		CAN_IT_LAST_ERROR_CODE      |  \
+		CAN_IT_ERROR                   );
 
 	/* Select interrupts for CAN2 */
 #ifdef CONFIGCAN2
 	HAL_CAN_ActivateNotification(&hcan2, \
 		CAN_IT_TX_MAILBOX_EMPTY     |  \
 		CAN_IT_RX_FIFO0_MSG_PENDING |  \
-		CAN_IT_RX_FIFO1_MSG_PENDING    );
+		CAN_IT_RX_FIFO1_MSG_PENDING |  \
+		CAN_IT_ERROR_WARNING        |  \
+		CAN_IT_ERROR_PASSIVE        |  \
+		CAN_IT_BUSOFF               |  \
+		CAN_IT_LAST_ERROR_CODE      |  \
+		CAN_IT_ERROR                   );
 #endif
 
 	/* Switch logic from queue loaded by Spi interrupts. */
@@ -633,7 +644,7 @@ static void MX_CAN1_Init(void)
   hcan1.Init.SyncJumpWidth = CAN_SJW_1TQ;
   hcan1.Init.TimeSeg1 = CAN_BS1_5TQ;
   hcan1.Init.TimeSeg2 = CAN_BS2_1TQ;
-  hcan1.Init.TimeTriggeredMode = DISABLE;
+  hcan1.Init.TimeTriggeredMode = ENABLE;
   hcan1.Init.AutoBusOff = DISABLE;
   hcan1.Init.AutoWakeUp = DISABLE;
   hcan1.Init.AutoRetransmission = DISABLE;
@@ -1377,7 +1388,8 @@ case  3: stackwatermark_show(MailboxTaskHandle,&pbuf4,"MailboxTask--");break;
 case  4: stackwatermark_show(ADCTaskHandle    ,&pbuf1,"ADCTask------");break;
 case  5: stackwatermark_show(SerialTaskReceiveHandle,&pbuf2,"SerialRcvTask");break;
 case  6: stackwatermark_show(GatewayTaskHandle,&pbuf3,"GatewayTask--");break;
-case  7: stackwatermark_show(CdcTxTaskSendHandle,&pbuf4,"CdcTxTask----");break;
+case  7: yprintf(&pbuf4,"\n\rCdcTx: xfers %u bytes %u chained %u full %u failed %u",cdctxdbl.stats.xfers,\
+				cdctxdbl.stats.bytes,cdctxdbl.stats.chained,cdctxdbl.stats.full,cdctxdbl.stats.failed);break;
 case  8: stackwatermark_show(SpiOutTaskHandle, &pbuf1,"SpiOutTask---");break;
 case  9: stackwatermark_show(GevcuTaskHandle,  &pbuf2,"GevcuTask----");break;
 case 10: stackwatermark_show(BeepTaskHandle,   &pbuf3,"BeepTask-----");break;
@@ -28,6 +28,7 @@
 #include "task.h"
 #include "cdc_rxbuffTaskCAN.h"
 #include "morse.h"
+#include "cdc_txbuff.h"
 
 uint32_t cdcifctr;
 
@@ -354,6 +355,7 @@ static int8_t CDC_TransmitCplt_FS(uint8_t *Buf, uint32_t *Len, uint8_t epnum)
   UNUSED(Buf);
   UNUSED(Len);
   UNUSED(epnum);
+  cdc_txbuff_txcplt(); // Start buffer filled while this one was sending
   /* USER CODE END 13 */
   return result;
 }